@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup generic
+ * @{
+ */
+/** @file
+ */
+
+#ifndef ABI_PROFILE_H_
+#define ABI_PROFILE_H_
+
+#include <stdint.h>
+
+/** Maximum number of kernel stack frames recorded per sample */
+#define PROFILE_KSTACK_DEPTH  8
+
+/** Maximum number of user stack frames recorded per sample */
+#define PROFILE_USTACK_DEPTH  8
+
+/** Maximum length of a kernel symbol name returned by PROFILE_SYMBOL */
+#define PROFILE_SYMBOL_MAX  128
+
+/** Sample was taken while the CPU was executing user code */
+#define PROFILE_SAMPLE_USPACE  0x01
+
+/** Sample was taken while the CPU had no thread to run */
+#define PROFILE_SAMPLE_IDLE  0x02
+
+typedef enum {
+	/** Start sampling at the given frequency, discard old samples */
+	PROFILE_START,
+	/** Stop sampling, keep the collected samples */
+	PROFILE_STOP,
+	/** Drain collected samples */
+	PROFILE_READ,
+	/** Resolve a kernel address to a symbol name */
+	PROFILE_SYMBOL
+} profile_operation_t;
+
+/** Profiling sample
+ *
+ * Both stacks are stored innermost frame first. The first entry
+ * of the stack the CPU was executing in is the interrupted PC.
+ */
+typedef struct {
+	uint64_t task_id;
+	uint64_t thread_id;
+	uint32_t cpu;
+	uint16_t flags;
+	uint8_t kframes;
+	uint8_t uframes;
+	uintptr_t kstack[PROFILE_KSTACK_DEPTH];
+	uintptr_t ustack[PROFILE_USTACK_DEPTH];
+} profile_sample_t;
+
+#endif
+
+/** @}
+ */
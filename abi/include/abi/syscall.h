@@ -101,6 +101,8 @@ typedef enum {
 	
 	SYS_KLOG,
 	
+	SYS_PROFILE,
+	
 	SYSCALL_END
 } syscall_t;
 
@@ -47,6 +47,11 @@
 /** Maximum name sizes */
 #define TASK_NAME_BUFLEN  20
 #define EXC_NAME_BUFLEN   20
+#define SLAB_NAME_BUFLEN  20
+#define LOCK_NAME_BUFLEN  40
+
+/** Number of lock wait and hold time histogram buckets */
+#define LOCK_HIST_BUCKETS  16
 
 /** Item value type
  *
@@ -133,6 +138,56 @@ typedef struct {
 	uint64_t count;              /**< Number of handled exceptions */
 } stats_exc_t;
 
+/** Statistics about a single slab cache
+ *
+ */
+typedef struct {
+	char name[SLAB_NAME_BUFLEN];  /**< Cache name */
+	uint64_t size;                /**< Object size (bytes) */
+	uint64_t frames;              /**< Frames per slab */
+	uint64_t objects;             /**< Objects per slab */
+	uint64_t colors;              /**< Number of slab colors */
+	uint64_t slabs;               /**< Allocated slabs */
+	uint64_t allocated;           /**< Allocated objects */
+	uint64_t cached;              /**< Objects cached in magazines */
+	uint64_t magazines;           /**< Full magazines in the depot */
+	uint64_t empty_magazines;     /**< Empty magazines in the depot */
+	uint64_t mag_size;            /**< Current magazine size */
+	uint64_t contention;          /**< Contended depot accesses */
+} stats_slab_t;
+
+/** Lock class type */
+typedef enum {
+	LOCK_TYPE_SPINLOCK,
+	LOCK_TYPE_MUTEX,
+	LOCK_TYPE_SEMAPHORE,
+	LOCK_TYPE_CONDVAR
+} lock_type_t;
+
+/** Statistics about a single lock class
+ *
+ * A lock class is formed by all spinlocks of the same name, or by all
+ * mutexes, semaphores and condition variables initialized at the same
+ * place in the source code.
+ *
+ * Times are in CPU cycles. Bucket i of the histograms counts events
+ * taking from 4^i to 4^(i + 1) - 1 cycles, the last bucket also counts
+ * all longer events. Only contended acquisitions have a wait time.
+ *
+ */
+typedef struct {
+	char name[LOCK_NAME_BUFLEN];  /**< Lock name or initialization site */
+	lock_type_t type;             /**< Lock class type */
+	uint64_t acquisitions;        /**< Successful acquisitions */
+	uint64_t contentions;         /**< Acquisitions which had to wait */
+	uint64_t wait_cycles;         /**< Total time spinning or sleeping */
+	uint64_t wait_max;            /**< Longest wait */
+	uint64_t hold_cycles;         /**< Total time the lock was held */
+	uint64_t hold_max;            /**< Longest hold */
+	uint64_t wait_hist[LOCK_HIST_BUCKETS];  /**< Wait time histogram */
+	uint64_t hold_hist[LOCK_HIST_BUCKETS];  /**< Hold time histogram */
+} stats_lock_t;
+
 /** Load fixed-point value */
 typedef uint32_t load_t;
 
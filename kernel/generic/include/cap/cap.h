@@ -66,6 +66,11 @@ struct phone;
 struct kobject;
 typedef struct kobject_ops {
 	bool (*reclaim)(struct kobject *);
+	/**
+	 * Optionally take over an unreferenced object for reuse instead of
+	 * destroying it. Returns true if the object was taken over.
+	 */
+	bool (*recycle)(struct kobject *);
 	void (*destroy)(void *);
 } kobject_ops_t;
 
@@ -83,6 +83,18 @@ typedef struct cpu {
 	uint64_t idle_cycles;
 	uint64_t busy_cycles;
 	
+	/**
+	 * State interrupted by the exception being handled.
+	 */
+	struct istate *istate;
+	
+#ifdef CONFIG_LOCKSTAT
+	/**
+	 * Lock statistics counters, indexed by lock class.
+	 */
+	struct lockstat_counters *lockstat;
+#endif
+	
 	/**
 	 * Processor ID assigned by kernel.
 	 */
@@ -46,6 +46,7 @@
 
 struct answerbox;
 struct task;
+struct thread;
 
 typedef enum {
 	/** Phone is free and can be allocated */
@@ -83,6 +84,14 @@ typedef struct answerbox {
 	
 	/** Phones connected to this answerbox. */
 	list_t connected_phones;
+	/**
+	 * Calls and answers sent to this answerbox which have not been
+	 * moved to the calls and answers lists yet. Senders push onto this
+	 * lock-free stack without taking the answerbox lock; the holder of
+	 * the lock drains it (see ipc_answerbox_drain()).
+	 */
+	struct call *incoming;
+	
 	/** Received calls. */
 	list_t calls;
 	list_t dispatched_calls;  /* Should be hash table in the future */
@@ -126,6 +135,9 @@ typedef struct call {
 	/** Answerbox link. */
 	link_t ab_link;
 	
+	/** Link in the incoming stack of an answerbox. */
+	struct call *incoming_next;
+	
 	unsigned int flags;
 
 	/** Protects the forget member. */
@@ -181,6 +193,7 @@ extern answerbox_t *ipc_phone_0;
 extern void ipc_init(void);
 
 extern call_t *ipc_call_alloc(unsigned int);
+extern void ipc_call_cache_flush(struct thread *);
 extern void ipc_call_free(call_t *);
 extern void ipc_call_hold(call_t *);
 extern void ipc_call_release(call_t *);
@@ -190,7 +203,7 @@ extern errno_t ipc_call(phone_t *, call_t *);
 extern call_t *ipc_wait_for_call(answerbox_t *, uint32_t, unsigned int);
 extern errno_t ipc_forward(call_t *, phone_t *, answerbox_t *, unsigned int);
 extern void ipc_answer(answerbox_t *, call_t *);
-extern void _ipc_answer_free_call(call_t *, bool);
+extern void _ipc_answer_free_call(call_t *);
 
 extern void ipc_phone_init(phone_t *, struct task *);
 extern bool ipc_phone_connect(phone_t *, answerbox_t *);
@@ -39,6 +39,7 @@
 #include <synch/spinlock.h>
 #include <atomic.h>
 #include <mm/frame.h>
+#include <abi/sysinfo.h>
 
 /** Minimum size to be allocated by malloc */
 #define SLAB_MIN_MALLOC_W  4
@@ -46,9 +47,21 @@
 /** Maximum size to be allocated by malloc */
 #define SLAB_MAX_MALLOC_W  22
 
-/** Initial Magazine size (TODO: dynamically growing magazines) */
+/** Initial magazine size */
 #define SLAB_MAG_SIZE  4
 
+/** Maximum magazine size, magazines grow by doubling */
+#define SLAB_MAG_SIZE_MAX  64
+
+/** Number of magazine sizes between SLAB_MAG_SIZE and SLAB_MAG_SIZE_MAX */
+#define SLAB_MAG_SIZES  5
+
+/** Contended depot accesses after which the magazine size is doubled */
+#define SLAB_MAG_CONTENTION  16
+
+/** Granularity of slab coloring (a common cache line size) */
+#define SLAB_COLOR_ALIGN  64
+
 /** If object size is less, store control structure inside SLAB */
 #define SLAB_INSIDE_SIZE  (PAGE_SIZE >> 3)
 
@@ -92,6 +105,8 @@ typedef struct {
 	
 	/** Size of slab position - align_up(sizeof(obj)) */
 	size_t size;
+	/** Alignment of objects */
+	size_t align;
 	
 	errno_t (*constructor)(void *obj, unsigned int kmflag);
 	size_t (*destructor)(void *obj);
@@ -102,6 +117,8 @@ typedef struct {
 	/* Computed values */
 	size_t frames;   /**< Number of frames to be allocated */
 	size_t objects;  /**< Number of objects that fit in */
+	size_t color_step;  /**< Offset between successive slab colors */
+	size_t colors;      /**< Number of slab colors */
 	
 	/* Statistics */
 	atomic_t allocated_slabs;
@@ -109,13 +126,24 @@ typedef struct {
 	atomic_t cached_objs;
 	/** How many magazines in magazines list */
 	atomic_t magazine_counter;
+	/** How many magazines in empty magazines list */
+	atomic_t empty_counter;
+	/** Number of contended accesses to the magazine depot */
+	atomic_t contention;
+	/** Color of the next allocated slab */
+	atomic_t next_color;
 	
 	/* Slabs */
 	list_t full_slabs;     /**< List of full slabs */
 	list_t partial_slabs;  /**< List of partial slabs */
 	IRQ_SPINLOCK_DECLARE(slablock);
-	/* Magazines */
-	list_t magazines;  /**< List o full magazines */
+	/* Magazine depot */
+	list_t magazines;        /**< List of full magazines */
+	list_t empty_magazines;  /**< List of empty magazines */
+	/** Size of newly allocated magazines */
+	size_t mag_size;
+	/** Value of contention when the magazine size was last adjusted */
+	atomic_count_t contention_base;
 	IRQ_SPINLOCK_DECLARE(maglock);
 	
 	/** CPU cache */
@@ -138,6 +166,9 @@ extern void slab_enable_cpucache(void);
 /* kconsole debug */
 extern void slab_print_list(void);
 
+/* statistics */
+extern size_t slab_stats_get(stats_slab_t *, size_t);
+
 /* malloc support */
 extern void *malloc(size_t, unsigned int)
     __attribute__((malloc));
@@ -183,6 +183,17 @@ typedef struct thread {
 	
 	/** Thread's priority. Implemented as index to CPU->rq */
 	int priority;
+	
+	/**
+	 * Thread woken up by this thread to which the CPU should be handed
+	 * off once this thread blocks, see thread_ready_handoff(). The hint
+	 * is only valid as long as the thread is found in the run queue
+	 * handoff_rq of handoff_cpu. Accessed by this thread with interrupts
+	 * disabled.
+	 */
+	struct thread *handoff;
+	cpu_t *handoff_cpu;
+	int handoff_rq;
 	/** Thread ID. */
 	thread_id_t tid;
 
@@ -204,6 +215,12 @@ typedef struct thread {
 	/** Thread's kernel stack. */
 	uint8_t *kstack;
 	
+	/**
+	 * IPC call structure kept for reuse by ipc_call_alloc().
+	 * Accessed only by the thread itself with interrupts disabled.
+	 */
+	struct call *ipc_call;
+	
 #ifdef CONFIG_UDEBUG
 	/**
 	 * If true, the scheduler will print a stack trace
@@ -233,6 +250,7 @@ extern thread_t *thread_create(void (*)(void *), void *, task_t *,
 extern void thread_wire(thread_t *, cpu_t *);
 extern void thread_attach(thread_t *, task_t *);
 extern void thread_ready(thread_t *);
+extern void thread_ready_handoff(thread_t *);
 extern void thread_exit(void) __attribute__((noreturn));
 extern void thread_interrupt(thread_t *);
 extern bool thread_interrupted(thread_t *);
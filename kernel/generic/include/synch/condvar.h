@@ -45,6 +45,9 @@ typedef struct {
 	waitq_t wq;
 } condvar_t;
 
+#define condvar_initialize(cv) \
+	_condvar_initialize((cv), LOCKSTAT_SITE)
+
 #define condvar_wait(cv, mtx) \
 	_condvar_wait_timeout((cv), (mtx), SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE)
 #define condvar_wait_timeout(cv, mtx, usec) \
@@ -58,7 +61,7 @@ typedef struct {
 	_condvar_wait_timeout_spinlock_impl((cv), NULL, (usec), (flags))
 #endif
 
-extern void condvar_initialize(condvar_t *cv);
+extern void _condvar_initialize(condvar_t *, const char *);
 extern void condvar_signal(condvar_t *cv);
 extern void condvar_broadcast(condvar_t *cv);
 extern errno_t _condvar_wait_timeout(condvar_t *cv, mutex_t *mtx, uint32_t usec,
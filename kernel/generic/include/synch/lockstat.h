@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup sync
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_LOCKSTAT_H_
+#define KERN_LOCKSTAT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <macros.h>
+#include <abi/sysinfo.h>
+
+#ifdef CONFIG_LOCKSTAT
+
+/** Lock class of locks initialized at the place of use of the macro */
+#define LOCKSTAT_SITE  __FILE__ ":" STRING(__LINE__)
+
+/** Class of locks which are not accounted individually */
+#define LOCKSTAT_CLASS_NONE  0
+
+extern void lockstat_init(void);
+extern unsigned int lockstat_class(const char *, lock_type_t);
+extern void lockstat_acquired(unsigned int, bool, uint64_t);
+extern void lockstat_released(unsigned int, uint64_t);
+extern size_t lockstat_get(stats_lock_t *, size_t);
+
+#else /* CONFIG_LOCKSTAT */
+
+#define LOCKSTAT_SITE  NULL
+
+#endif /* CONFIG_LOCKSTAT */
+
+#endif
+
+/** @}
+ */
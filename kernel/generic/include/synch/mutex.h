@@ -38,6 +38,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <synch/semaphore.h>
+#include <synch/lockstat.h>
 #include <abi/synch.h>
 
 typedef enum {
@@ -53,8 +54,15 @@ typedef struct {
 	semaphore_t sem;
 	struct thread *owner;
 	unsigned nesting;
+#ifdef CONFIG_LOCKSTAT
+	unsigned int lsclass;
+	uint64_t acquired;
+#endif
 } mutex_t;
 
+#define mutex_initialize(mtx, type) \
+	_mutex_initialize((mtx), (type), LOCKSTAT_SITE)
+
 #define mutex_lock(mtx) \
 	_mutex_lock_timeout((mtx), SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE)
 
@@ -64,7 +72,7 @@ typedef struct {
 #define mutex_lock_timeout(mtx, usec) \
 	_mutex_lock_timeout((mtx), (usec), SYNCH_FLAGS_NON_BLOCKING)
 
-extern void mutex_initialize(mutex_t *, mutex_type_t);
+extern void _mutex_initialize(mutex_t *, mutex_type_t, const char *);
 extern bool mutex_locked(mutex_t *);
 extern errno_t _mutex_lock_timeout(mutex_t *, uint32_t, unsigned int);
 extern void mutex_unlock(mutex_t *);
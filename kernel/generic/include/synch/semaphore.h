@@ -44,6 +44,9 @@ typedef struct {
 	waitq_t wq;
 } semaphore_t;
 
+#define semaphore_initialize(s, val) \
+	_semaphore_initialize((s), (val), LOCKSTAT_SITE)
+
 #define semaphore_down(s) \
 	_semaphore_down_timeout((s), SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE)
 
@@ -57,7 +60,7 @@ typedef struct {
 	(_semaphore_down_timeout((s), SYNCH_NO_TIMEOUT, \
 		SYNCH_FLAGS_INTERRUPTIBLE) != EINTR)
 
-extern void semaphore_initialize(semaphore_t *, int);
+extern void _semaphore_initialize(semaphore_t *, int, const char *);
 extern errno_t _semaphore_down_timeout(semaphore_t *, uint32_t, unsigned int);
 extern void semaphore_up(semaphore_t *);
 extern int semaphore_count_get(semaphore_t *);
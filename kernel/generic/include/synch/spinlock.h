@@ -36,6 +36,7 @@
 #define KERN_SPINLOCK_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <arch/barrier.h>
 #include <assert.h>
 #include <preemption.h>
@@ -47,9 +48,16 @@
 typedef struct spinlock {
 	atomic_t val;
 	
-#ifdef CONFIG_DEBUG_SPINLOCK
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
 	const char *name;
-#endif /* CONFIG_DEBUG_SPINLOCK */
+#endif
+	
+#ifdef CONFIG_LOCKSTAT
+	/** Lock class, resolved from the name on first use */
+	unsigned int lsclass;
+	/** Cycle counter at the time of acquisition */
+	uint64_t acquired;
+#endif /* CONFIG_LOCKSTAT */
 } spinlock_t;
 
 /*
@@ -64,7 +72,7 @@ typedef struct spinlock {
  * for statically allocated spinlocks. They declare (either as global
  * or static) symbol and initialize the lock.
  */
-#ifdef CONFIG_DEBUG_SPINLOCK
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
 
 #define SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	spinlock_t lock_name = { \
@@ -78,13 +86,14 @@ typedef struct spinlock {
 		.val = { 0 } \
 	}
 
-#define ASSERT_SPINLOCK(expr, lock) \
-	assert_verbose(expr, (lock)->name)
-
+/*
+ * Lock statistics are gathered by the out-of-line variants
+ * of the spinlock operations, just like the deadlock detection.
+ */
 #define spinlock_lock(lock)    spinlock_lock_debug((lock))
 #define spinlock_unlock(lock)  spinlock_unlock_debug((lock))
 
-#else /* CONFIG_DEBUG_SPINLOCK */
+#else
 
 #define SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	spinlock_t lock_name = { \
@@ -96,12 +105,21 @@ typedef struct spinlock {
 		.val = { 0 } \
 	}
 
-#define ASSERT_SPINLOCK(expr, lock) \
-	assert(expr)
-
 #define spinlock_lock(lock)    atomic_lock_arch(&(lock)->val)
 #define spinlock_unlock(lock)  spinlock_unlock_nondebug((lock))
 
+#endif
+
+#ifdef CONFIG_DEBUG_SPINLOCK
+
+#define ASSERT_SPINLOCK(expr, lock) \
+	assert_verbose(expr, (lock)->name)
+
+#else /* CONFIG_DEBUG_SPINLOCK */
+
+#define ASSERT_SPINLOCK(expr, lock) \
+	assert(expr)
+
 #endif /* CONFIG_DEBUG_SPINLOCK */
 
 #define SPINLOCK_INITIALIZE(lock_name) \
@@ -208,7 +226,7 @@ typedef struct {
  * for statically allocated interrupts-disabled spinlocks. They declare (either
  * as global or static symbol) and initialize the lock.
  */
-#ifdef CONFIG_DEBUG_SPINLOCK
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
 
 #define IRQ_SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	irq_spinlock_t lock_name = { \
@@ -230,7 +248,7 @@ typedef struct {
 		.ipl = 0 \
 	}
 
-#else /* CONFIG_DEBUG_SPINLOCK */
+#else
 
 #define IRQ_SPINLOCK_INITIALIZE_NAME(lock_name, desc_name) \
 	irq_spinlock_t lock_name = { \
@@ -250,7 +268,7 @@ typedef struct {
 		.ipl = 0 \
 	}
 
-#endif /* CONFIG_DEBUG_SPINLOCK */
+#endif
 
 #else /* CONFIG_SMP */
 
@@ -37,12 +37,15 @@
 
 #include <typedefs.h>
 #include <synch/spinlock.h>
+#include <synch/lockstat.h>
 #include <abi/synch.h>
 #include <adt/list.h>
 
 typedef enum {
 	WAKEUP_FIRST = 0,
-	WAKEUP_ALL
+	WAKEUP_ALL,
+	/** Wake up the first thread, hand off the CPU to it on blocking */
+	WAKEUP_HANDOFF
 } wakeup_mode_t;
 
 /** Wait queue structure.
@@ -63,14 +66,22 @@ typedef struct {
 	
 	/** List of sleeping threads for which there was no missed_wakeup. */
 	list_t sleepers;
+	
+#ifdef CONFIG_LOCKSTAT
+	/** Lock class for lock statistics */
+	unsigned int lsclass;
+#endif
 } waitq_t;
 
+#define waitq_initialize(wq) \
+	_waitq_initialize((wq), LOCKSTAT_SITE)
+
 #define waitq_sleep(wq) \
 	waitq_sleep_timeout((wq), SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE, NULL)
 
 struct thread;
 
-extern void waitq_initialize(waitq_t *);
+extern void _waitq_initialize(waitq_t *, const char *);
 extern errno_t waitq_sleep_timeout(waitq_t *, uint32_t, unsigned int, bool *);
 extern ipl_t waitq_sleep_prepare(waitq_t *);
 extern errno_t waitq_sleep_timeout_unsafe(waitq_t *, uint32_t, unsigned int, bool *);
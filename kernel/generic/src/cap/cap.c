@@ -437,6 +437,9 @@ void kobject_add_ref(kobject_t *kobj)
 void kobject_put(kobject_t *kobj)
 {
 	if (atomic_postdec(&kobj->refcnt) == 1) {
+		if ((kobj->ops->recycle) && (kobj->ops->recycle(kobj)))
+			return;
+		
 		kobj->ops->destroy(kobj->raw);
 		free(kobj);
 	}
@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup generic
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Statistical sampling profiler.
+ *
+ * When enabled, the clock interrupt handler records the interrupted task,
+ * thread and a short kernel and user stack into a ring buffer of the
+ * current CPU. Userspace drains the rings with the PROFILE_READ operation
+ * and resolves the kernel addresses with PROFILE_SYMBOL.
+ *
+ * Samples are taken from the clock tick, so the highest sampling frequency
+ * is HZ. Lower frequencies are rounded to a whole number of ticks.
+ */
+
+#include <profile.h>
+#include <abi/profile.h>
+#include <align.h>
+#include <arch.h>
+#include <arch/barrier.h>
+#include <config.h>
+#include <cpu.h>
+#include <errno.h>
+#include <interrupt.h>
+#include <macros.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <arch/mm/page.h>
+#include <mm/slab.h>
+#include <proc/task.h>
+#include <proc/thread.h>
+#include <security/perm.h>
+#include <stacktrace.h>
+#include <str.h>
+#include <symtab.h>
+#include <synch/mutex.h>
+#include <synch/spinlock.h>
+#include <syscall/copy.h>
+#include <sysinfo/sysinfo.h>
+#include <time/clock.h>
+
+/** Number of samples buffered per CPU */
+#define PROFILE_RING_SAMPLES  512
+
+/*
+ * The frame records of all architectures with a user stack walker lie
+ * within this window around the frame pointer.
+ */
+#define PROFILE_FRAME_BELOW  (4 * sizeof(uintptr_t))
+#define PROFILE_FRAME_ABOVE  (2 * sizeof(uintptr_t))
+
+/** Per-CPU sample ring */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+	
+	profile_sample_t *samples;
+	
+	/** Index of the oldest sample */
+	size_t head;
+	/** Number of samples in the ring */
+	size_t count;
+	/** Number of samples lost because the ring was full */
+	uint64_t dropped;
+	/** Clock ticks since the last sample */
+	unsigned int ticks;
+} profile_ring_t;
+
+/** Serializes profiler control operations */
+static mutex_t profile_lock;
+
+/** Array of config.cpu_count rings, allocated on first start */
+static profile_ring_t *profile_rings = NULL;
+
+/** Number of clock ticks between samples, zero if not sampling */
+static volatile unsigned int profile_interval = 0;
+
+/** Check whether a frame pointer lies within a kernel stack.
+ *
+ * The interrupted code runs either on the stack of the current thread
+ * or, in the scheduler, on the stack of the current CPU.
+ *
+ */
+static bool profile_kframe_valid(uintptr_t fp)
+{
+	uintptr_t base;
+	
+	if (THREAD) {
+		base = (uintptr_t) THREAD->kstack;
+		if ((fp >= base + PROFILE_FRAME_BELOW) &&
+		    (fp + PROFILE_FRAME_ABOVE <= base + STACK_SIZE))
+			return true;
+	}
+	
+	base = (uintptr_t) CPU->stack;
+	return ((fp >= base + PROFILE_FRAME_BELOW) &&
+	    (fp + PROFILE_FRAME_ABOVE <= base + STACK_SIZE));
+}
+
+/** Check whether a user page can be read without a page fault.
+ *
+ * The page fault handler may block, which is not possible from
+ * the clock interrupt, so only resident pages are read.
+ *
+ */
+static bool profile_upage_present(uintptr_t addr)
+{
+	return page_mapping_readable(AS, ALIGN_DOWN(addr, PAGE_SIZE));
+}
+
+static bool profile_uframe_valid(uintptr_t fp)
+{
+	if (fp < PROFILE_FRAME_BELOW)
+		return false;
+	
+	return (profile_upage_present(fp - PROFILE_FRAME_BELOW) &&
+	    profile_upage_present(fp + PROFILE_FRAME_ABOVE - 1));
+}
+
+/** Record the kernel stack of the interrupted context. */
+static void profile_walk_kernel(profile_sample_t *sample, istate_t *istate)
+{
+	stack_trace_context_t ctx = {
+		.fp = istate_get_fp(istate),
+		.pc = istate_get_pc(istate),
+		.istate = istate
+	};
+	
+	while (sample->kframes < PROFILE_KSTACK_DEPTH) {
+		sample->kstack[sample->kframes++] = ctx.pc;
+		
+		if ((!profile_kframe_valid(ctx.fp)) ||
+		    (!kst_ops.stack_trace_context_validate(&ctx)))
+			break;
+		
+		uintptr_t fp;
+		uintptr_t pc;
+		if ((!kst_ops.return_address_get(&ctx, &pc)) ||
+		    (!kst_ops.frame_pointer_prev(&ctx, &fp)))
+			break;
+		
+		/* The stack grows down, so outer frames lie above */
+		if (fp <= ctx.fp)
+			break;
+		
+		ctx.fp = fp;
+		ctx.pc = pc;
+	}
+}
+
+/** Record the user stack described by a userspace state. */
+static void profile_walk_uspace(profile_sample_t *sample, istate_t *istate)
+{
+	stack_trace_context_t ctx = {
+		.fp = istate_get_fp(istate),
+		.pc = istate_get_pc(istate),
+		.istate = istate
+	};
+	
+	sample->ustack[sample->uframes++] = ctx.pc;
+	
+	/*
+	 * Walking the outer frames reads the user stack, so the address
+	 * space must not change underneath. Follow the locking rules of
+	 * as_page_fault(), but do not block in the clock interrupt. If the
+	 * address space is busy, the sample has the innermost frame only.
+	 */
+	if ((AS == NULL) || (mutex_trylock(&AS->lock) != EOK))
+		return;
+	
+	while (sample->uframes < PROFILE_USTACK_DEPTH) {
+		if ((!ust_ops.stack_trace_context_validate(&ctx)) ||
+		    (!profile_uframe_valid(ctx.fp)))
+			break;
+		
+		uintptr_t fp;
+		uintptr_t pc;
+		if ((!ust_ops.return_address_get(&ctx, &pc)) ||
+		    (!ust_ops.frame_pointer_prev(&ctx, &fp)))
+			break;
+		
+		if (fp <= ctx.fp)
+			break;
+		
+		ctx.fp = fp;
+		ctx.pc = pc;
+		sample->ustack[sample->uframes++] = ctx.pc;
+	}
+	
+	mutex_unlock(&AS->lock);
+}
+
+static void profile_sample(profile_sample_t *sample, istate_t *istate)
+{
+	sample->cpu = CPU->id;
+	sample->flags = 0;
+	sample->kframes = 0;
+	sample->uframes = 0;
+	
+	if (THREAD) {
+		sample->task_id = THREAD->task->taskid;
+		sample->thread_id = THREAD->tid;
+	} else {
+		sample->task_id = 0;
+		sample->thread_id = 0;
+		sample->flags |= PROFILE_SAMPLE_IDLE;
+	}
+	
+	if (istate_from_uspace(istate)) {
+		sample->flags |= PROFILE_SAMPLE_USPACE;
+		profile_walk_uspace(sample, istate);
+		return;
+	}
+	
+	profile_walk_kernel(sample, istate);
+	
+	/*
+	 * A userspace thread executing in the kernel has its userspace
+	 * state saved at the bottom of its kernel stack.
+	 */
+	if ((THREAD) && (THREAD->uspace))
+		profile_walk_uspace(sample, istate_get(THREAD));
+}
+
+/** Take a sample of the current CPU
+ *
+ * Called from the clock interrupt handler
+ * (assuming interrupts_disable()'d).
+ *
+ */
+void profile_tick(void)
+{
+	unsigned int interval = profile_interval;
+	if (interval == 0)
+		return;
+	
+	istate_t *istate = CPU->istate;
+	if (istate == NULL)
+		return;
+	
+	profile_ring_t *ring = &profile_rings[CPU->id];
+	
+	irq_spinlock_lock(&ring->lock, false);
+	
+	if (++ring->ticks < interval) {
+		irq_spinlock_unlock(&ring->lock, false);
+		return;
+	}
+	
+	ring->ticks = 0;
+	
+	if (ring->count == PROFILE_RING_SAMPLES) {
+		ring->dropped++;
+		irq_spinlock_unlock(&ring->lock, false);
+		return;
+	}
+	
+	size_t idx = (ring->head + ring->count) % PROFILE_RING_SAMPLES;
+	profile_sample(&ring->samples[idx], istate);
+	ring->count++;
+	
+	irq_spinlock_unlock(&ring->lock, false);
+}
+
+static sysarg_t profile_get_frequency(struct sysinfo_item *item, void *data)
+{
+	unsigned int interval = profile_interval;
+	
+	return (interval != 0) ? HZ / interval : 0;
+}
+
+static sysarg_t profile_get_dropped(struct sysinfo_item *item, void *data)
+{
+	sysarg_t dropped = 0;
+	
+	mutex_lock(&profile_lock);
+	
+	if (profile_rings != NULL) {
+		for (unsigned int i = 0; i < config.cpu_count; i++) {
+			irq_spinlock_lock(&profile_rings[i].lock, true);
+			dropped += profile_rings[i].dropped;
+			irq_spinlock_unlock(&profile_rings[i].lock, true);
+		}
+	}
+	
+	mutex_unlock(&profile_lock);
+	
+	return dropped;
+}
+
+/** Initialize the profiler and its sysinfo items */
+void profile_init(void)
+{
+	mutex_initialize(&profile_lock, MUTEX_PASSIVE);
+	
+	sysinfo_set_item_gen_val("profile.frequency", NULL,
+	    profile_get_frequency, NULL);
+	sysinfo_set_item_gen_val("profile.dropped", NULL,
+	    profile_get_dropped, NULL);
+}
+
+/** Allocate the sample rings (with profile_lock held). */
+static errno_t profile_rings_alloc(void)
+{
+	if (profile_rings != NULL)
+		return EOK;
+	
+	profile_ring_t *rings = malloc(config.cpu_count * sizeof(profile_ring_t),
+	    FRAME_ATOMIC);
+	if (rings == NULL)
+		return ENOMEM;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		irq_spinlock_initialize(&rings[i].lock, "profile.ring.lock");
+		rings[i].samples = malloc(PROFILE_RING_SAMPLES *
+		    sizeof(profile_sample_t), FRAME_ATOMIC);
+		if (rings[i].samples == NULL) {
+			while (i-- > 0)
+				free(rings[i].samples);
+			free(rings);
+			return ENOMEM;
+		}
+		
+		rings[i].head = 0;
+		rings[i].count = 0;
+		rings[i].dropped = 0;
+		rings[i].ticks = 0;
+	}
+	
+	profile_rings = rings;
+	return EOK;
+}
+
+/** Start sampling (with profile_lock held). */
+static errno_t profile_start(sysarg_t frequency)
+{
+	errno_t rc = profile_rings_alloc();
+	if (rc != EOK)
+		return rc;
+	
+	/* Stop sampling while the rings are reset */
+	profile_interval = 0;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		irq_spinlock_lock(&profile_rings[i].lock, true);
+		profile_rings[i].head = 0;
+		profile_rings[i].count = 0;
+		profile_rings[i].dropped = 0;
+		profile_rings[i].ticks = 0;
+		irq_spinlock_unlock(&profile_rings[i].lock, true);
+	}
+	
+	unsigned int interval = 1;
+	if ((frequency != 0) && (frequency < HZ))
+		interval = HZ / frequency;
+	
+	/* Make the rings visible before the clock starts using them */
+	write_barrier();
+	profile_interval = interval;
+	
+	return EOK;
+}
+
+/** Drain samples into a userspace buffer (with profile_lock held).
+ *
+ * @param buf    Userspace buffer.
+ * @param size   Size of the buffer.
+ * @param nread  Place to store the number of bytes copied.
+ *
+ * @return EOK on success or an error code from @ref errno.h.
+ *
+ */
+static errno_t profile_read(void *buf, size_t size, size_t *nread)
+{
+	size_t copied = 0;
+	
+	*nread = 0;
+	if (profile_rings == NULL)
+		return EOK;
+	
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		profile_ring_t *ring = &profile_rings[i];
+		
+		while (copied + sizeof(profile_sample_t) <= size) {
+			profile_sample_t sample;
+			
+			irq_spinlock_lock(&ring->lock, true);
+			
+			if (ring->count == 0) {
+				irq_spinlock_unlock(&ring->lock, true);
+				break;
+			}
+			
+			sample = ring->samples[ring->head];
+			ring->head = (ring->head + 1) % PROFILE_RING_SAMPLES;
+			ring->count--;
+			
+			irq_spinlock_unlock(&ring->lock, true);
+			
+			errno_t rc = copy_to_uspace((uint8_t *) buf + copied,
+			    &sample, sizeof(sample));
+			if (rc != EOK)
+				return rc;
+			
+			copied += sizeof(sample);
+		}
+	}
+	
+	*nread = copied;
+	return EOK;
+}
+
+/** Resolve a kernel address to a symbol name.
+ *
+ * @param addr    Kernel address.
+ * @param buf     Userspace buffer for the NULL-terminated name.
+ * @param size    Size of the buffer.
+ * @param offset  Place to store the offset of @a addr within the symbol.
+ *
+ * @return EOK on success or an error code from @ref errno.h.
+ *
+ */
+static errno_t profile_symbol(uintptr_t addr, void *buf, size_t size,
+    size_t *offset)
+{
+	const char *name;
+	uintptr_t off;
+	char sym[PROFILE_SYMBOL_MAX];
+	
+	if (size == 0)
+		return EINVAL;
+	
+	errno_t rc = symtab_name_lookup(addr, &name, &off);
+	if (rc != EOK)
+		return rc;
+	
+	str_cpy(sym, min(size, PROFILE_SYMBOL_MAX), name);
+	
+	rc = copy_to_uspace(buf, sym, str_size(sym) + 1);
+	if (rc != EOK)
+		return rc;
+	
+	*offset = off;
+	return EOK;
+}
+
+/** Control the profiler and read samples
+ *
+ * @param operation  Profiler operation.
+ * @param arg        Sampling frequency for PROFILE_START,
+ *                   address for PROFILE_SYMBOL.
+ * @param buf        Userspace buffer for PROFILE_READ and PROFILE_SYMBOL.
+ * @param size       Size of @a buf.
+ * @param uspace_nread  Place to store the number of bytes read
+ *                   or the symbol offset.
+ *
+ * @return EOK on success, EPERM if the caller lacks the PERM_PROFILE
+ *         permission or another error code from @ref errno.h.
+ *
+ */
+sys_errno_t sys_profile(sysarg_t operation, sysarg_t arg, void *buf,
+    size_t size, size_t *uspace_nread)
+{
+	size_t val = 0;
+	errno_t rc;
+	
+	/* Samples reveal the stacks of all tasks and the kernel */
+	if (!(perm_get(TASK) & PERM_PROFILE))
+		return EPERM;
+	
+	mutex_lock(&profile_lock);
+	
+	switch (operation) {
+	case PROFILE_START:
+		rc = profile_start(arg);
+		break;
+	case PROFILE_STOP:
+		profile_interval = 0;
+		rc = EOK;
+		break;
+	case PROFILE_READ:
+		rc = profile_read(buf, size, &val);
+		break;
+	case PROFILE_SYMBOL:
+		rc = profile_symbol(arg, buf, size, &val);
+		break;
+	default:
+		rc = ENOTSUP;
+		break;
+	}
+	
+	mutex_unlock(&profile_lock);
+	
+	if ((rc == EOK) && (uspace_nread != NULL) &&
+	    ((operation == PROFILE_READ) || (operation == PROFILE_SYMBOL)))
+		rc = copy_to_uspace(uspace_nread, &val, sizeof(val));
+	
+	return (sys_errno_t) rc;
+}
+
+/** @}
+ */
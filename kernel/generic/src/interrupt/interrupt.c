@@ -128,8 +128,26 @@ NO_TRACE void exc_dispatch(unsigned int n, istate_t *istate)
 		THREAD->udebug.uspace_state = istate;
 #endif
 	
+	/*
+	 * Let the profiler see the interrupted state. Exceptions nest,
+	 * so the state of the enclosing exception is restored afterwards.
+	 */
+	istate_t *prev_istate = NULL;
+	if (CPU) {
+		prev_istate = CPU->istate;
+		CPU->istate = istate;
+	}
+	
 	exc_table[n].handler(n + IVT_FIRST, istate);
 	
+	/*
+	 * The handler might have rescheduled us onto another CPU. The
+	 * enclosing state belongs to this thread, so it is restored on
+	 * whichever CPU the thread runs now.
+	 */
+	if (CPU)
+		CPU->istate = prev_istate;
+	
 #ifdef CONFIG_UDEBUG
 	if (THREAD)
 		THREAD->udebug.uspace_state = NULL;
@@ -35,6 +35,9 @@
 /* Lock ordering
  *
  * First the answerbox, then the phone.
+ *
+ * Calls and answers are delivered to an answerbox without taking its
+ * lock, see ipc_answerbox_push().
  */
 
 #include <assert.h>
@@ -86,18 +89,59 @@ static void _ipc_call_init(call_t *call)
 	call->buffer = NULL;
 }
 
+/** Release the resources held by a call which is not referenced anymore. */
+static void call_release_resources(call_t *call)
+{
+	if (call->buffer) {
+		free(call->buffer);
+		call->buffer = NULL;
+	}
+	if (call->caller_phone) {
+		kobject_put(call->caller_phone->kobject);
+		call->caller_phone = NULL;
+	}
+}
+
+/** Keep an unreferenced call in the current thread for reuse.
+ *
+ * Typically, the thread which receives the answer to a request is the one
+ * which sent it and which is about to send another one, so the call
+ * structure together with its kernel object is kept instead of going
+ * back to the allocators.
+ *
+ * @param kobj Kernel object of the call.
+ *
+ * @return True if the call was taken over by the current thread.
+ *
+ */
+static bool call_recycle(kobject_t *kobj)
+{
+	call_t *call = kobj->call;
+	
+	if (!THREAD)
+		return false;
+	
+	call_release_resources(call);
+	
+	ipl_t ipl = interrupts_disable();
+	bool recycled = (THREAD->ipc_call == NULL);
+	if (recycled)
+		THREAD->ipc_call = call;
+	interrupts_restore(ipl);
+	
+	return recycled;
+}
+
 static void call_destroy(void *arg)
 {
 	call_t *call = (call_t *) arg;
 
-	if (call->buffer)
-		free(call->buffer);
-	if (call->caller_phone)
-		kobject_put(call->caller_phone->kobject);
+	call_release_resources(call);
 	slab_free(call_cache, call);
 }
 
 static kobject_ops_t call_kobject_ops = {
+	.recycle = call_recycle,
 	.destroy = call_destroy
 };
 
@@ -106,6 +150,9 @@ static kobject_ops_t call_kobject_ops = {
  * The call is initialized, so that the reply will be directed to
  * TASK->answerbox.
  *
+ * The call structure most recently released by the current thread is
+ * reused if available, avoiding both the slab and the kobject allocation.
+ *
  * @param flags Parameters for slab_alloc (e.g FRAME_ATOMIC).
  *
  * @return If flags permit it, return NULL, or initialized kernel
@@ -114,13 +161,28 @@ static kobject_ops_t call_kobject_ops = {
  */
 call_t *ipc_call_alloc(unsigned int flags)
 {
-	call_t *call = slab_alloc(call_cache, flags);
-	if (!call)
-		return NULL;
-	kobject_t *kobj = (kobject_t *) malloc(sizeof(kobject_t), flags);
-	if (!kobj) {
-		slab_free(call_cache, call);
-		return NULL;
+	call_t *call = NULL;
+	kobject_t *kobj;
+	
+	/* Fast path: reuse the call cached by the current thread */
+	if (THREAD) {
+		ipl_t ipl = interrupts_disable();
+		call = THREAD->ipc_call;
+		THREAD->ipc_call = NULL;
+		interrupts_restore(ipl);
+	}
+	
+	if (call) {
+		kobj = call->kobject;
+	} else {
+		call = slab_alloc(call_cache, flags);
+		if (!call)
+			return NULL;
+		kobj = (kobject_t *) malloc(sizeof(kobject_t), flags);
+		if (!kobj) {
+			slab_free(call_cache, call);
+			return NULL;
+		}
 	}
 
 	_ipc_call_init(call);
@@ -130,6 +192,21 @@ call_t *ipc_call_alloc(unsigned int flags)
 	return call;
 }
 
+/** Free the call cached by a thread.
+ *
+ * @param thread Thread which is being destroyed.
+ *
+ */
+void ipc_call_cache_flush(thread_t *thread)
+{
+	call_t *call = thread->ipc_call;
+	if (call) {
+		thread->ipc_call = NULL;
+		free(call->kobject);
+		slab_free(call_cache, call);
+	}
+}
+
 /** Initialize an answerbox structure.
  *
  * @param box  Answerbox structure to be initialized.
@@ -142,6 +219,7 @@ void ipc_answerbox_init(answerbox_t *box, task_t *task)
 	irq_spinlock_initialize(&box->irq_lock, "ipc.box.irqlock");
 	waitq_initialize(&box->wq);
 	list_initialize(&box->connected_phones);
+	box->incoming = NULL;
 	list_initialize(&box->calls);
 	list_initialize(&box->dispatched_calls);
 	list_initialize(&box->answers);
@@ -149,6 +227,67 @@ void ipc_answerbox_init(answerbox_t *box, task_t *task)
 	box->task = task;
 }
 
+/** Deliver a call or an answer to an answerbox.
+ *
+ * The call is pushed onto the incoming stack of the answerbox using
+ * compare-and-swap, so that the sender does not contend for the
+ * answerbox lock of the recipient. Since the stack is only ever taken
+ * away as a whole, the push does not suffer from the ABA problem.
+ *
+ * @param box  Destination answerbox.
+ * @param call Call or answer (with IPC_CALL_ANSWERED set) to deliver.
+ *
+ */
+static void ipc_answerbox_push(answerbox_t *box, call_t *call)
+{
+	call_t *head = __atomic_load_n(&box->incoming, __ATOMIC_RELAXED);
+	
+	do {
+		call->incoming_next = head;
+	} while (!__atomic_compare_exchange_n(&box->incoming, &head, call,
+	    true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	
+	/*
+	 * The sender of a synchronous request and the server answering it
+	 * usually block right after this, waiting for the other party.
+	 * Let them switch straight to the thread receiving the call.
+	 * Kernel notifications sent from interrupt handlers fall back
+	 * to a plain wakeup in waitq_wakeup().
+	 */
+	waitq_wakeup(&box->wq, WAKEUP_HANDOFF);
+}
+
+/** Move the calls and answers delivered to an answerbox to its lists.
+ *
+ * The order in which the calls were pushed by a sender is preserved.
+ *
+ * @param box Answerbox which must be locked.
+ *
+ */
+static void ipc_answerbox_drain(answerbox_t *box)
+{
+	assert(irq_spinlock_locked(&box->lock));
+	
+	call_t *call = __atomic_exchange_n(&box->incoming, NULL,
+	    __ATOMIC_ACQUIRE);
+	
+	/* Reverse the stack to get the order of arrival */
+	call_t *first = NULL;
+	while (call) {
+		call_t *next = call->incoming_next;
+		call->incoming_next = first;
+		first = call;
+		call = next;
+	}
+	
+	for (call = first; call; call = call->incoming_next) {
+		if (call->flags & IPC_CALL_ANSWERED)
+			list_append(&call->ab_link, &box->answers);
+		else
+			list_append(&call->ab_link, &box->calls);
+	}
+}
+
 /** Connect a phone to an answerbox.
  *
  * This function must be passed a reference to phone->kobject.
@@ -270,11 +409,10 @@ errno_t ipc_call_sync(phone_t *phone, call_t *request)
 
 /** Answer a message which was not dispatched and is not listed in any queue.
  *
- * @param call       Call structure to be answered.
- * @param selflocked If true, then TASK->answebox is locked.
+ * @param call Call structure to be answered.
  *
  */
-void _ipc_answer_free_call(call_t *call, bool selflocked)
+void _ipc_answer_free_call(call_t *call)
 {
 	/* Count sent answer */
 	irq_spinlock_lock(&TASK->lock, true);
@@ -303,21 +441,12 @@ void _ipc_answer_free_call(call_t *call, bool selflocked)
 
 	answerbox_t *callerbox = call->callerbox ? call->callerbox :
 	    &call->sender->answerbox;
-	bool do_lock = ((!selflocked) || (callerbox != &TASK->answerbox));
 	
 	call->flags |= IPC_CALL_ANSWERED;
 	
 	call->data.task_id = TASK->taskid;
 	
-	if (do_lock)
-		irq_spinlock_lock(&callerbox->lock, true);
-	
-	list_append(&call->ab_link, &callerbox->answers);
-	
-	if (do_lock)
-		irq_spinlock_unlock(&callerbox->lock, true);
-	
-	waitq_wakeup(&callerbox->wq, WAKEUP_FIRST);
+	ipc_answerbox_push(callerbox, call);
 }
 
 /** Answer a message which is in a callee queue.
@@ -334,7 +463,7 @@ void ipc_answer(answerbox_t *box, call_t *call)
 	irq_spinlock_unlock(&box->lock, true);
 	
 	/* Send back answer */
-	_ipc_answer_free_call(call, false);
+	_ipc_answer_free_call(call);
 }
 
 static void _ipc_call_actions_internal(phone_t *phone, call_t *call,
@@ -374,7 +503,7 @@ void ipc_backsend_err(phone_t *phone, call_t *call, errno_t err)
 {
 	_ipc_call_actions_internal(phone, call, false);
 	IPC_SET_RETVAL(call->data, err);
-	_ipc_answer_free_call(call, false);
+	_ipc_answer_free_call(call);
 }
 
 /** Unsafe unchecking version of ipc_call.
@@ -398,11 +527,7 @@ static void _ipc_call(phone_t *phone, answerbox_t *box, call_t *call,
 	if (!(call->flags & IPC_CALL_FORWARDED))
 		_ipc_call_actions_internal(phone, call, preforget);
 	
-	irq_spinlock_lock(&box->lock, true);
-	list_append(&call->ab_link, &box->calls);
-	irq_spinlock_unlock(&box->lock, true);
-	
-	waitq_wakeup(&box->wq, WAKEUP_FIRST);
+	ipc_answerbox_push(box, call);
 }
 
 /** Send an asynchronous request using a phone to an answerbox.
@@ -542,6 +667,8 @@ restart:
 		return NULL;
 	
 	irq_spinlock_lock(&box->lock, true);
+	ipc_answerbox_drain(box);
+	
 	if (!list_empty(&box->irq_notifs)) {
 		/* Count received IRQ notification */
 		irq_cnt++;
@@ -598,6 +725,8 @@ restart:
 void ipc_cleanup_call_list(answerbox_t *box, list_t *lst)
 {
 	irq_spinlock_lock(&box->lock, true);
+	ipc_answerbox_drain(box);
+	
 	while (!list_empty(lst)) {
 		call_t *call = list_get_instance(list_first(lst), call_t,
 		    ab_link);
@@ -612,9 +741,10 @@ void ipc_cleanup_call_list(answerbox_t *box, list_t *lst)
 		ipc_data_t old = call->data;
 		IPC_SET_RETVAL(call->data, EHANGUP);
 		answer_preprocess(call, &old);
-		_ipc_answer_free_call(call, true);
+		_ipc_answer_free_call(call);
 
 		irq_spinlock_lock(&box->lock, true);
+		ipc_answerbox_drain(box);
 	}
 	irq_spinlock_unlock(&box->lock, true);
 }
@@ -1003,6 +1133,7 @@ void ipc_print_task(task_id_t taskid)
 	
 	irq_spinlock_lock(&task->lock, true);
 	irq_spinlock_lock(&task->answerbox.lock, false);
+	ipc_answerbox_drain(&task->answerbox);
 	
 #ifdef __32_BITS__
 	printf("[call id ] [method] [arg1] [arg2] [arg3] [arg4] [arg5]"
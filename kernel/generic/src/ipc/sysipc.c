@@ -545,7 +545,7 @@ error:
 	IPC_SET_RETVAL(call->data, EFORWARD);
 	(void) answer_preprocess(call, need_old ? &old : NULL);
 	if (after_forward)
-		_ipc_answer_free_call(call, false);
+		_ipc_answer_free_call(call);
 	else
 		ipc_answer(&TASK->answerbox, call);
 
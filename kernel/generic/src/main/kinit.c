@@ -262,7 +262,8 @@ void kinit(void *arg)
 				 */
 				perm_set(programs[i].task,
 				    PERM_PERM | PERM_MEM_MANAGER |
-				    PERM_IO_MANAGER | PERM_IRQ_REG);
+				    PERM_IO_MANAGER | PERM_IRQ_REG |
+				    PERM_PROFILE);
 				
 				if (!ipc_phone_0) {
 					ipc_phone_0 = &programs[i].task->answerbox;
@@ -78,6 +78,7 @@
 #include <synch/waitq.h>
 #include <synch/futex.h>
 #include <synch/workqueue.h>
+#include <synch/lockstat.h>
 #include <smp/smp_call.h>
 #include <arch/arch.h>
 #include <arch.h>
@@ -91,6 +92,7 @@
 #include <ipc/event.h>
 #include <sysinfo/sysinfo.h>
 #include <sysinfo/stats.h>
+#include <profile.h>
 #include <lib/ra.h>
 #include <cap/cap.h>
 
@@ -272,6 +274,10 @@ void main_bsp_separated_stack(void)
 	cpu_init();
 	calibrate_delay_loop();
 	ARCH_OP(post_cpu_init);
+	
+#ifdef CONFIG_LOCKSTAT
+	lockstat_init();
+#endif
 
 	smp_call_init();
 	workq_global_init();
@@ -298,6 +304,7 @@ void main_bsp_separated_stack(void)
 	kio_init();
 	log_init();
 	stats_init();
+	profile_init();
 	
 	/*
 	 * Create kernel task.
@@ -176,6 +176,29 @@ NO_TRACE void page_mapping_update(as_t *as, uintptr_t page, bool nolock,
 	    ALIGN_DOWN(page, PAGE_SIZE), nolock, pte);
 }
 
+/** Check whether a virtual page is mapped readable.
+ *
+ * Unlike a read access, the check never faults and thus never blocks.
+ * The caller holds the address space mutex so that the answer stays
+ * valid until the page has been accessed.
+ *
+ * @param as   Address space to which page belongs.
+ * @param page Virtual page.
+ *
+ * @return True if @a page is present and readable in @a as.
+ *
+ */
+bool page_mapping_readable(as_t *as, uintptr_t page)
+{
+	pte_t pte;
+	
+	page_table_lock(as, false);
+	bool found = page_mapping_find(as, page, false, &pte);
+	page_table_unlock(as, false);
+	
+	return (found && PTE_PRESENT(&pte) && PTE_READABLE(&pte));
+}
+
 /** Make the mapping shared by all page tables (not address spaces).
  * 
  * @param base Starting virtual address of the range that is made global.
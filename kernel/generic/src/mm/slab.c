@@ -40,13 +40,6 @@
  * with the following exceptions:
  * @li empty slabs are deallocated immediately 
  *     (in Linux they are kept in linked list, in Solaris ???)
- * @li empty magazines are deallocated when not needed
- *     (in Solaris they are held in linked list in slab cache)
- *
- * Following features are not currently supported but would be easy to do:
- * @li cache coloring
- * @li dynamic magazine growing (different magazine sizes are already
- *     supported, but we would need to adjust allocation strategy)
  *
  * The slab allocator supports per-CPU caches ('magazines') to facilitate
  * good SMP scaling.
@@ -57,9 +50,17 @@
  * it is used, otherwise a new one is allocated. 
  *
  * When an object is being deallocated, it is put to a CPU-bound magazine.
- * If there is no such magazine, a new one is allocated (if this fails, 
- * the object is deallocated into slab). If the magazine is full, it is
- * put into cpu-shared list of magazines and a new one is allocated.
+ * If there is no such magazine, an empty one is taken from the cache's
+ * depot or a new one is allocated (if this fails, the object is
+ * deallocated into slab). If the magazine is full, it is put into
+ * the depot's list of full magazines and an empty one is taken instead.
+ *
+ * Each cache thus has a depot of full and empty magazines, so CPUs do not
+ * compete for the single system magazine cache. Contention on the depot
+ * lock is counted; whenever it reaches SLAB_MAG_CONTENTION, the size of
+ * newly allocated magazines is doubled (up to SLAB_MAG_SIZE_MAX), so that
+ * CPUs go to the depot less often. Reclaim halves the size again.
+ * Magazines of a stale size are freed when they become empty.
  *
  * The CPU-bound magazine is actually a pair of magazines in order to avoid
  * thrashing when somebody is allocating/deallocating 1 item at the magazine
@@ -71,6 +72,10 @@
  * of magazines).
  *
  * The slab information structure is kept inside the data area, if possible.
+ * The space wasted at the end of a slab is used for cache coloring:
+ * consecutive slabs place their first object at different offsets (in
+ * multiples of SLAB_COLOR_ALIGN) so that objects at the same index in
+ * different slabs do not map to the same CPU cache lines.
  * The cache can be marked that it should not use magazines. This is used
  * only for slab related caches to avoid deadlocks and infinite recursion
  * (the slab allocator uses itself for allocating all it's control structures).
@@ -84,16 +89,6 @@
  * magazines.
  *
  * @todo
- * For better CPU-scaling the magazine allocation strategy should
- * be extended. Currently, if the cache does not have magazine, it asks
- * for non-cpu cached magazine cache to provide one. It might be feasible
- * to add cpu-cached magazine cache (which would allocate it's magazines
- * from non-cpu-cached mag. cache). This would provide a nice per-cpu
- * buffer. The other possibility is to use the per-cache 
- * 'empty-magazine-list', which decreases competing for 1 per-system
- * magazine cache.
- *
- * @todo
  * It might be good to add granularity of locks even to slab level,
  * we could then try_spinlock over all partial slabs and thus improve
  * scalability even on slab level.
@@ -115,12 +110,21 @@
 #include <bitops.h>
 #include <macros.h>
 #include <cpu.h>
+#include <str.h>
 
 IRQ_SPINLOCK_STATIC_INITIALIZE(slab_cache_lock);
 static LIST_INITIALIZE(slab_cache_list);
 
-/** Magazine cache */
-static slab_cache_t mag_cache;
+/** Magazine caches, one for each magazine size */
+static slab_cache_t mag_cache[SLAB_MAG_SIZES];
+
+static const char *mag_cache_names[SLAB_MAG_SIZES] = {
+	"slab_magazine_t-4",
+	"slab_magazine_t-8",
+	"slab_magazine_t-16",
+	"slab_magazine_t-32",
+	"slab_magazine_t-64"
+};
 
 /** Cache for cache descriptors */
 static slab_cache_t slab_cache_cache;
@@ -162,6 +166,7 @@ static const char *malloc_names[] =  {
 typedef struct {
 	slab_cache_t *cache;  /**< Pointer to parent cache. */
 	link_t link;          /**< List of full/partial slabs. */
+	void *base;           /**< Start address of the slab frames. */
 	void *start;          /**< Start address of first available item. */
 	size_t available;     /**< Count of available items in this slab. */
 	size_t nextavail;     /**< The index of next available item. */
@@ -209,7 +214,11 @@ NO_TRACE static slab_t *slab_space_alloc(slab_cache_t *cache,
 	for (i = 0; i < cache->frames; i++)
 		frame_set_parent(ADDR2PFN(KA2PA(data)) + i, slab, zone);
 	
-	slab->start = data;
+	/* Start each slab at the next color */
+	size_t color = atomic_postinc(&cache->next_color) % cache->colors;
+	
+	slab->base = data;
+	slab->start = data + color * cache->color_step;
 	slab->available = cache->objects;
 	slab->nextavail = 0;
 	slab->cache = cache;
@@ -228,7 +237,7 @@ NO_TRACE static slab_t *slab_space_alloc(slab_cache_t *cache,
  */
 NO_TRACE static size_t slab_space_free(slab_cache_t *cache, slab_t *slab)
 {
-	frame_free(KA2PA(slab->start), slab->cache->frames);
+	frame_free(KA2PA(slab->base), slab->cache->frames);
 	if (!(cache->flags & SLAB_CACHE_SLINSIDE))
 		slab_free(slab_extern_cache, slab);
 	
@@ -347,6 +356,79 @@ NO_TRACE static void *slab_obj_create(slab_cache_t *cache, unsigned int flags)
 /* CPU-Cache slab functions */
 /****************************/
 
+/** Return index of the magazine cache for a given magazine size */
+NO_TRACE static size_t mag_cache_index(size_t size)
+{
+	return fnzb(size) - fnzb(SLAB_MAG_SIZE);
+}
+
+/** Allocate an empty magazine of a given size
+ *
+ * We do not want to sleep just because of caching,
+ * especially we do not want reclaiming to start, as
+ * this would deadlock.
+ *
+ */
+NO_TRACE static slab_magazine_t *magazine_alloc(size_t size)
+{
+	slab_magazine_t *mag = slab_alloc(&mag_cache[mag_cache_index(size)],
+	    FRAME_ATOMIC | FRAME_NO_RECLAIM);
+	if (!mag)
+		return NULL;
+	
+	mag->size = size;
+	mag->busy = 0;
+	
+	return mag;
+}
+
+/** Free memory associated with an empty magazine */
+NO_TRACE static void magazine_free(slab_magazine_t *mag)
+{
+	slab_free(&mag_cache[mag_cache_index(mag->size)], mag);
+}
+
+/** Lock the magazine depot of a cache, counting contention
+ *
+ * @return Interrupt priority level to be passed to depot_unlock()
+ *
+ */
+NO_TRACE static ipl_t depot_lock(slab_cache_t *cache)
+{
+	ipl_t ipl = interrupts_disable();
+	
+	if (!irq_spinlock_trylock(&cache->maglock)) {
+		atomic_inc(&cache->contention);
+		irq_spinlock_lock(&cache->maglock, false);
+	}
+	
+	return ipl;
+}
+
+/** Unlock the magazine depot of a cache */
+NO_TRACE static void depot_unlock(slab_cache_t *cache, ipl_t ipl)
+{
+	irq_spinlock_unlock(&cache->maglock, false);
+	interrupts_restore(ipl);
+}
+
+/** Grow magazines if the depot has been contended too often
+ *
+ * Expects the depot to be locked.
+ *
+ */
+NO_TRACE static void depot_adjust(slab_cache_t *cache)
+{
+	atomic_count_t contention = atomic_get(&cache->contention);
+	
+	if (contention - cache->contention_base >= SLAB_MAG_CONTENTION) {
+		if (cache->mag_size < SLAB_MAG_SIZE_MAX)
+			cache->mag_size <<= 1;
+		
+		cache->contention_base = contention;
+	}
+}
+
 /** Find a full magazine in cache, take it from list and return it
  *
  * @param first If true, return first, else last mag.
@@ -358,7 +440,7 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 	slab_magazine_t *mag = NULL;
 	link_t *cur;
 	
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = depot_lock(cache);
 	if (!list_empty(&cache->magazines)) {
 		if (first)
 			cur = list_first(&cache->magazines);
@@ -369,7 +451,8 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 		list_remove(&mag->link);
 		atomic_dec(&cache->magazine_counter);
 	}
-	irq_spinlock_unlock(&cache->maglock, true);
+	depot_adjust(cache);
+	depot_unlock(cache, ipl);
 
 	return mag;
 }
@@ -380,12 +463,59 @@ NO_TRACE static slab_magazine_t *get_mag_from_cache(slab_cache_t *cache,
 NO_TRACE static void put_mag_to_cache(slab_cache_t *cache,
     slab_magazine_t *mag)
 {
-	irq_spinlock_lock(&cache->maglock, true);
+	ipl_t ipl = depot_lock(cache);
 	
 	list_prepend(&mag->link, &cache->magazines);
 	atomic_inc(&cache->magazine_counter);
+	depot_adjust(cache);
 	
-	irq_spinlock_unlock(&cache->maglock, true);
+	depot_unlock(cache, ipl);
+}
+
+/** Get an empty magazine from the depot or allocate a new one
+ *
+ * @return Empty magazine of the current magazine size or NULL
+ *
+ */
+NO_TRACE static slab_magazine_t *get_empty_mag(slab_cache_t *cache)
+{
+	slab_magazine_t *mag = NULL;
+	
+	ipl_t ipl = depot_lock(cache);
+	size_t size = cache->mag_size;
+	if (!list_empty(&cache->empty_magazines)) {
+		mag = list_get_instance(list_first(&cache->empty_magazines),
+		    slab_magazine_t, link);
+		list_remove(&mag->link);
+		atomic_dec(&cache->empty_counter);
+	}
+	depot_unlock(cache, ipl);
+	
+	/* Magazines of a stale size are replaced when they come back empty */
+	if ((mag) && (mag->size != size)) {
+		magazine_free(mag);
+		mag = NULL;
+	}
+	
+	if (!mag)
+		mag = magazine_alloc(size);
+	
+	return mag;
+}
+
+/** Return an empty magazine to the depot
+ *
+ */
+NO_TRACE static void put_empty_mag(slab_cache_t *cache, slab_magazine_t *mag)
+{
+	assert(mag->busy == 0);
+	
+	ipl_t ipl = depot_lock(cache);
+	
+	list_prepend(&mag->link, &cache->empty_magazines);
+	atomic_inc(&cache->empty_counter);
+	
+	depot_unlock(cache, ipl);
 }
 
 /** Free all objects in magazine and free memory associated with magazine
@@ -404,7 +534,7 @@ NO_TRACE static size_t magazine_destroy(slab_cache_t *cache,
 		atomic_dec(&cache->cached_objs);
 	}
 	
-	slab_free(&mag_cache, mag);
+	magazine_free(mag);
 	
 	return frames;
 }
@@ -435,8 +565,9 @@ NO_TRACE static slab_magazine_t *get_full_current_mag(slab_cache_t *cache)
 	if (!newmag)
 		return NULL;
 	
+	/* The last magazine is empty here, keep it in the depot */
 	if (lastmag)
-		magazine_destroy(cache, lastmag);
+		put_empty_mag(cache, lastmag);
 	
 	cache->mag_cache[CPU->id].last = cmag;
 	cache->mag_cache[CPU->id].current = newmag;
@@ -497,22 +628,11 @@ NO_TRACE static slab_magazine_t *make_empty_current_mag(slab_cache_t *cache)
 		}
 	}
 	
-	/* current | last are full | nonexistent, allocate new */
-	
-	/*
-	 * We do not want to sleep just because of caching,
-	 * especially we do not want reclaiming to start, as
-	 * this would deadlock.
-	 *
-	 */
-	slab_magazine_t *newmag = slab_alloc(&mag_cache,
-	    FRAME_ATOMIC | FRAME_NO_RECLAIM);
+	/* current | last are full | nonexistent, get an empty one */
+	slab_magazine_t *newmag = get_empty_mag(cache);
 	if (!newmag)
 		return NULL;
 	
-	newmag->size = SLAB_MAG_SIZE;
-	newmag->busy = 0;
-	
 	/* Flush last to magazine list */
 	if (lastmag)
 		put_mag_to_cache(cache, lastmag);
@@ -621,6 +741,8 @@ NO_TRACE static void _slab_cache_create(slab_cache_t *cache, const char *name,
 	size = ALIGN_UP(size, align);
 	
 	cache->size = size;
+	cache->align = align;
+	cache->mag_size = SLAB_MAG_SIZE;
 	cache->constructor = constructor;
 	cache->destructor = destructor;
 	cache->flags = flags;
@@ -628,6 +750,7 @@ NO_TRACE static void _slab_cache_create(slab_cache_t *cache, const char *name,
 	list_initialize(&cache->full_slabs);
 	list_initialize(&cache->partial_slabs);
 	list_initialize(&cache->magazines);
+	list_initialize(&cache->empty_magazines);
 	
 	irq_spinlock_initialize(&cache->slablock, "slab.cache.slablock");
 	irq_spinlock_initialize(&cache->maglock, "slab.cache.maglock");
@@ -651,6 +774,15 @@ NO_TRACE static void _slab_cache_create(slab_cache_t *cache, const char *name,
 	if (badness(cache) > sizeof(slab_t))
 		cache->flags |= SLAB_CACHE_SLINSIDE;
 	
+	/* Use the space left over in each slab for coloring */
+	size_t waste = FRAMES2SIZE(cache->frames) -
+	    cache->objects * cache->size;
+	if (cache->flags & SLAB_CACHE_SLINSIDE)
+		waste -= sizeof(slab_t);
+	
+	cache->color_step = max(align, SLAB_COLOR_ALIGN);
+	cache->colors = waste / cache->color_step + 1;
+	
 	/* Add cache to cache list */
 	irq_spinlock_lock(&slab_cache_lock, true);
 	list_append(&cache->link, &slab_cache_list);
@@ -698,6 +830,35 @@ NO_TRACE static size_t _slab_reclaim(slab_cache_t *cache, unsigned int flags)
 			break;
 	}
 	
+	/*
+	 * Empty magazines hold no objects, release them all. They are
+	 * only collected under the depot lock and freed after it is
+	 * dropped.
+	 *
+	 * Memory is short, so also halve the size of newly allocated
+	 * magazines. Magazines of the previous size are replaced when
+	 * they come back empty.
+	 */
+	list_t empty;
+	list_initialize(&empty);
+	
+	ipl_t ipl = depot_lock(cache);
+	list_concat(&empty, &cache->empty_magazines);
+	atomic_set(&cache->empty_counter, 0);
+	
+	if (cache->mag_size > SLAB_MAG_SIZE)
+		cache->mag_size >>= 1;
+	
+	cache->contention_base = atomic_get(&cache->contention);
+	depot_unlock(cache, ipl);
+	
+	while (!list_empty(&empty)) {
+		mag = list_get_instance(list_first(&empty), slab_magazine_t,
+		    link);
+		list_remove(&mag->link);
+		magazine_free(mag);
+	}
+	
 	if (flags & SLAB_RECLAIM_ALL) {
 		/* Free cpu-bound magazines */
 		/* Destroy CPU magazines */
@@ -822,7 +983,7 @@ size_t slab_reclaim(unsigned int flags)
 void slab_print_list(void)
 {
 	printf("[cache name      ] [size  ] [pages ] [obj/pg] [slabs ]"
-	    " [cached] [alloc ] [ctl]\n");
+	    " [cached] [alloc ] [colors] [magsz ] [ctl]\n");
 	
 	size_t skip = 0;
 	while (true) {
@@ -873,24 +1034,71 @@ void slab_print_list(void)
 		long allocated_slabs = atomic_get(&cache->allocated_slabs);
 		long cached_objs = atomic_get(&cache->cached_objs);
 		long allocated_objs = atomic_get(&cache->allocated_objs);
+		size_t colors = cache->colors;
+		size_t mag_size = cache->mag_size;
 		unsigned int flags = cache->flags;
 		
 		irq_spinlock_unlock(&slab_cache_lock, true);
 		
-		printf("%-18s %8zu %8zu %8zu %8ld %8ld %8ld %-5s\n",
+		printf("%-18s %8zu %8zu %8zu %8ld %8ld %8ld %8zu %8zu %-5s\n",
 		    name, size, frames, objects, allocated_slabs,
-		    cached_objs, allocated_objs,
+		    cached_objs, allocated_objs, colors, mag_size,
 		    flags & SLAB_CACHE_SLINSIDE ? "in" : "out");
 	}
 }
 
+/** Get statistics of slab caches
+ *
+ * @param stats Array to store the statistics to (can be NULL)
+ * @param count Number of items in the array
+ *
+ * @return Number of existing slab caches, which can be larger
+ *         than the number of stored items.
+ *
+ */
+size_t slab_stats_get(stats_slab_t *stats, size_t count)
+{
+	size_t i = 0;
+	
+	irq_spinlock_lock(&slab_cache_lock, true);
+	
+	list_foreach(slab_cache_list, link, slab_cache_t, cache) {
+		if (i < count) {
+			str_cpy(stats[i].name, SLAB_NAME_BUFLEN, cache->name);
+			stats[i].size = cache->size;
+			stats[i].frames = cache->frames;
+			stats[i].objects = cache->objects;
+			stats[i].colors = cache->colors;
+			stats[i].slabs = atomic_get(&cache->allocated_slabs);
+			stats[i].allocated = atomic_get(&cache->allocated_objs);
+			stats[i].cached = atomic_get(&cache->cached_objs);
+			stats[i].magazines = atomic_get(&cache->magazine_counter);
+			stats[i].empty_magazines =
+			    atomic_get(&cache->empty_counter);
+			stats[i].mag_size = cache->mag_size;
+			stats[i].contention = atomic_get(&cache->contention);
+		}
+		
+		i++;
+	}
+	
+	irq_spinlock_unlock(&slab_cache_lock, true);
+	
+	return i;
+}
+
 void slab_cache_init(void)
 {
-	/* Initialize magazine cache */
-	_slab_cache_create(&mag_cache, "slab_magazine_t",
-	    sizeof(slab_magazine_t) + SLAB_MAG_SIZE * sizeof(void *),
-	    sizeof(uintptr_t), NULL, NULL, SLAB_CACHE_NOMAGAZINE |
-	    SLAB_CACHE_SLINSIDE);
+	/* Initialize magazine caches */
+	size_t i;
+	size_t size;
+	
+	for (i = 0, size = SLAB_MAG_SIZE; i < SLAB_MAG_SIZES; i++, size <<= 1) {
+		_slab_cache_create(&mag_cache[i], mag_cache_names[i],
+		    sizeof(slab_magazine_t) + size * sizeof(void *),
+		    sizeof(uintptr_t), NULL, NULL, SLAB_CACHE_NOMAGAZINE |
+		    SLAB_CACHE_SLINSIDE);
+	}
 	
 	/* Initialize slab_cache cache */
 	_slab_cache_create(&slab_cache_cache, "slab_cache_cache",
@@ -902,9 +1110,6 @@ void slab_cache_init(void)
 	    NULL, NULL, SLAB_CACHE_SLINSIDE | SLAB_CACHE_MAGDEFERRED);
 	
 	/* Initialize structures for malloc */
-	size_t i;
-	size_t size;
-	
 	for (i = 0, size = (1 << SLAB_MIN_MALLOC_W);
 	    i < (SLAB_MAX_MALLOC_W - SLAB_MIN_MALLOC_W + 1);
 	    i++, size <<= 1) {
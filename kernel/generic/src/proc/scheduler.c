@@ -267,6 +267,76 @@ loop:
 	goto loop;
 }
 
+/** Take the thread to which the blocking thread hands off the CPU
+ *
+ * The thread is taken out of the run queue to which it was readied by
+ * thread_ready_handoff(), unless it has already been scheduled or stolen
+ * in the meantime. The handoff is not done if there is a ready thread
+ * of higher priority on this CPU or if the thread cannot migrate here.
+ *
+ * @param thread Thread readied by the blocking thread. It may not be
+ *               dereferenced before it is found in the run queue.
+ * @param cpu    CPU to whose run queue the thread was readied.
+ * @param i      Index of the run queue.
+ * @param ticks  Remaining time slice of the blocking thread, which is
+ *               donated to the thread.
+ *
+ * @return Thread to be scheduled or NULL.
+ *
+ */
+static thread_t *find_handoff_thread(thread_t *thread, cpu_t *cpu, int i,
+    uint64_t ticks)
+{
+	assert(CPU != NULL);
+	
+	/* Do not bypass higher-priority threads */
+	int j;
+	for (j = 0; j < i; j++) {
+		if (CPU->rq[j].n > 0)
+			return NULL;
+	}
+	
+	irq_spinlock_lock(&(cpu->rq[i].lock), false);
+	
+	/* Search rq from the back, where the thread has been appended */
+	bool found = false;
+	list_foreach_rev(cpu->rq[i].rq, rq_link, thread_t, cur) {
+		if (cur == thread) {
+			found = true;
+			break;
+		}
+	}
+	
+	if (!found) {
+		irq_spinlock_unlock(&(cpu->rq[i].lock), false);
+		return NULL;
+	}
+	
+	irq_spinlock_lock(&thread->lock, false);
+	
+	if ((cpu != CPU) && ((thread->wired) || (thread->nomigrate) ||
+	    (thread->fpu_context_engaged))) {
+		irq_spinlock_unlock(&thread->lock, false);
+		irq_spinlock_unlock(&(cpu->rq[i].lock), false);
+		return NULL;
+	}
+	
+	atomic_dec(&cpu->nrdy);
+	atomic_dec(&nrdy);
+	
+	cpu->rq[i].n--;
+	list_remove(&thread->rq_link);
+	irq_spinlock_unlock(&(cpu->rq[i].lock), false);
+	
+	thread->cpu = CPU;
+	thread->ticks = (ticks > 0) ? ticks : us2ticks((i + 1) * 10000);
+	thread->priority = i;  /* Correct rq index */
+	thread->stolen = false;
+	irq_spinlock_unlock(&thread->lock, false);
+	
+	return thread;
+}
+
 /** Prevent rq starvation
  *
  * Prevent low priority threads from starving in rq's.
@@ -417,10 +487,28 @@ void scheduler_separated_stack(void)
 	if (old_as)
 		as_hold(old_as);
 	
+	thread_t *handoff = NULL;
+	cpu_t *handoff_cpu = NULL;
+	int handoff_rq = 0;
+	uint64_t handoff_ticks = 0;
+	
 	if (THREAD) {
 		/* Must be run after the switch to scheduler stack */
 		after_thread_ran();
 		
+		/*
+		 * The handoff hint is used only if the thread blocks,
+		 * otherwise it is just dropped.
+		 */
+		if (THREAD->state == Sleeping) {
+			handoff = THREAD->handoff;
+			handoff_cpu = THREAD->handoff_cpu;
+			handoff_rq = THREAD->handoff_rq;
+			handoff_ticks = THREAD->ticks;
+		}
+		
+		THREAD->handoff = NULL;
+		
 		switch (THREAD->state) {
 		case Running:
 			irq_spinlock_unlock(&THREAD->lock, false);
@@ -485,7 +573,12 @@ repeat:
 		THREAD = NULL;
 	}
 	
-	THREAD = find_best_thread();
+	if (handoff)
+		THREAD = find_handoff_thread(handoff, handoff_cpu, handoff_rq,
+		    handoff_ticks);
+	
+	if (!THREAD)
+		THREAD = find_best_thread();
 	
 	irq_spinlock_lock(&THREAD->lock, false);
 	int priority = THREAD->priority;
@@ -66,6 +66,7 @@
 #include <mm/slab.h>
 #include <main/uinit.h>
 #include <syscall/copy.h>
+#include <ipc/ipc.h>
 #include <errno.h>
 
 /** Thread states */
@@ -275,10 +276,12 @@ static void before_thread_is_ready(thread_t *thread)
  *
  * Switch thread to the ready state.
  *
- * @param thread Thread to make ready.
+ * @param thread  Thread to make ready.
+ * @param handoff Remember the thread in THREAD as the one to which the CPU
+ *                is to be handed off when THREAD blocks.
  *
  */
-void thread_ready(thread_t *thread)
+static void _thread_ready(thread_t *thread, bool handoff)
 {
 	irq_spinlock_lock(&thread->lock, true);
 	
@@ -316,12 +319,50 @@ void thread_ready(thread_t *thread)
 	
 	list_append(&thread->rq_link, &cpu->rq[i].rq);
 	cpu->rq[i].n++;
+	
+	if ((handoff) && (THREAD) && (THREAD != thread)) {
+		THREAD->handoff = thread;
+		THREAD->handoff_cpu = cpu;
+		THREAD->handoff_rq = i;
+	}
+	
 	irq_spinlock_unlock(&(cpu->rq[i].lock), true);
 	
 	atomic_inc(&nrdy);
 	atomic_inc(&cpu->nrdy);
 }
 
+/** Make thread ready
+ *
+ * Switch thread to the ready state.
+ *
+ * @param thread Thread to make ready.
+ *
+ */
+void thread_ready(thread_t *thread)
+{
+	_thread_ready(thread, false);
+}
+
+/** Make thread ready and hand off the CPU to it when the current thread blocks
+ *
+ * Used when the current thread is likely to block waiting for the thread
+ * being woken up, e.g. when sending a synchronous IPC request or an answer.
+ * When the current thread blocks before the woken up thread gets scheduled
+ * elsewhere, the scheduler switches to it directly, bypassing the run queue
+ * selection, and the woken up thread inherits the rest of the time slice.
+ *
+ * Must be called on behalf of THREAD, never from an interrupt handler,
+ * see waitq_wakeup().
+ *
+ * @param thread Thread to make ready.
+ *
+ */
+void thread_ready_handoff(thread_t *thread)
+{
+	_thread_ready(thread, true);
+}
+
 /** Create new thread
  *
  * Create a new thread.
@@ -396,6 +437,11 @@ thread_t *thread_create(void (* func)(void *), void *arg, task_t *task,
 	
 	thread->workq = NULL;
 	
+	thread->ipc_call = NULL;
+	thread->handoff = NULL;
+	thread->handoff_cpu = NULL;
+	thread->handoff_rq = 0;
+	
 	thread->fpu_context_exists = false;
 	thread->fpu_context_engaged = false;
 	
@@ -456,6 +502,12 @@ void thread_destroy(thread_t *thread, bool irq_res)
 	 * Drop the reference to the containing task.
 	 */
 	task_release(thread->task);
+	
+	/*
+	 * Free the cached IPC call, the thread cannot use it anymore.
+	 */
+	ipc_call_cache_flush(thread);
+	
 	slab_free(thread_cache, thread);
 }
 
@@ -44,10 +44,17 @@
 /** Initialize condition variable.
  *
  * @param cv		Condition variable.
+ * @param site		Lock class of the condition variable,
+ *			see LOCKSTAT_SITE.
  */
-void condvar_initialize(condvar_t *cv)
+void _condvar_initialize(condvar_t *cv, const char *site)
 {
-	waitq_initialize(&cv->wq);
+	_waitq_initialize(&cv->wq, site);
+	
+#ifdef CONFIG_LOCKSTAT
+	if (site != NULL)
+		cv->wq.lsclass = lockstat_class(site, LOCK_TYPE_CONDVAR);
+#endif
 }
 
 /** Signal the condition has become true to the first waiting thread by waking
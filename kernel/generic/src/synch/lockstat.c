@@ -0,0 +1,466 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup sync
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Lock contention statistics.
+ *
+ * Locks are accounted by lock classes. All spinlocks of the same name form
+ * a class, mutexes, semaphores and condition variables form a class per
+ * the place in the source code they are initialized at. The spinlock of
+ * a wait queue is named after that place as well. Bare wait queues are
+ * used to wait for events, so sleeping in them is not accounted.
+ *
+ * Each CPU keeps its own counters for every class, so that recording
+ * an event never touches shared cache lines nor takes a lock. The counters
+ * are summed up only when the statistics are read.
+ */
+
+#include <synch/lockstat.h>
+#include <abi/sysinfo.h>
+#include <arch.h>
+#include <arch/asm.h>
+#include <arch/barrier.h>
+#include <arch/cycle.h>
+#include <atomic.h>
+#include <bitops.h>
+#include <config.h>
+#include <cpu.h>
+#include <gsort.h>
+#include <macros.h>
+#include <mm/slab.h>
+#include <mem.h>
+#include <print.h>
+#include <str.h>
+#include <console/console.h>
+#include <console/kconsole.h>
+#include <console/cmd.h>
+
+/** Maximum number of lock classes */
+#define LOCKSTAT_CLASSES  512
+
+/** Class of locks which did not fit into the class table */
+#define LOCKSTAT_CLASS_OTHER  1
+
+/** Size of the class hash table (power of two) */
+#define LOCKSTAT_HASH_SIZE  (2 * LOCKSTAT_CLASSES)
+
+typedef struct {
+	const char *name;
+	lock_type_t type;
+} lockstat_class_t;
+
+/** Per-CPU counters of a lock class */
+typedef struct lockstat_counters {
+	uint64_t acquisitions;
+	uint64_t contentions;
+	uint64_t wait_cycles;
+	uint64_t wait_max;
+	uint64_t hold_cycles;
+	uint64_t hold_max;
+	uint64_t wait_hist[LOCK_HIST_BUCKETS];
+	uint64_t hold_hist[LOCK_HIST_BUCKETS];
+} lockstat_counters_t;
+
+static lockstat_class_t lockstat_classes[LOCKSTAT_CLASSES] = {
+	[LOCKSTAT_CLASS_NONE] = {
+		.name = "(none)",
+		.type = LOCK_TYPE_SPINLOCK
+	},
+	[LOCKSTAT_CLASS_OTHER] = {
+		.name = "(other)",
+		.type = LOCK_TYPE_SPINLOCK
+	}
+};
+
+static unsigned int lockstat_class_count = 2;
+
+/** Class indices hashed by name and type, zero if unused */
+static uint16_t lockstat_hash[LOCKSTAT_HASH_SIZE];
+
+/*
+ * The class table is protected by a bare test-and-set lock, as the class
+ * of a spinlock is looked up from within spinlock_lock() itself.
+ */
+static atomic_t lockstat_class_lock = { 0 };
+
+/** Counters become usable once allocated for all CPUs */
+static bool lockstat_ready = false;
+
+static size_t lockstat_hash_index(const char *name, lock_type_t type)
+{
+	uintptr_t key = (uintptr_t) name ^ type;
+	
+	return ((key >> 3) ^ (key >> 13)) & (LOCKSTAT_HASH_SIZE - 1);
+}
+
+/** Get the lock class of a lock name or initialization site
+ *
+ * @param name Name of a spinlock or the initialization site of other
+ *             locks, as generated by LOCKSTAT_SITE. Classes are looked up
+ *             by the address of the string, not by its contents.
+ * @param type Lock type.
+ *
+ * @return Index of the class.
+ *
+ */
+unsigned int lockstat_class(const char *name, lock_type_t type)
+{
+	if (name == NULL)
+		return LOCKSTAT_CLASS_OTHER;
+	
+	ipl_t ipl = interrupts_disable();
+	while (test_and_set(&lockstat_class_lock));
+	CS_ENTER_BARRIER();
+	
+	unsigned int cls = LOCKSTAT_CLASS_OTHER;
+	size_t i = lockstat_hash_index(name, type);
+	
+	while (lockstat_hash[i] != 0) {
+		lockstat_class_t *class = &lockstat_classes[lockstat_hash[i]];
+		if ((class->name == name) && (class->type == type)) {
+			cls = lockstat_hash[i];
+			goto out;
+		}
+		
+		i = (i + 1) & (LOCKSTAT_HASH_SIZE - 1);
+	}
+	
+	if (lockstat_class_count < LOCKSTAT_CLASSES) {
+		/*
+		 * lockstat_get() reads the classes without the lock, so
+		 * the class must be filled in before the count includes it.
+		 */
+		cls = lockstat_class_count;
+		lockstat_classes[cls].name = name;
+		lockstat_classes[cls].type = type;
+		write_barrier();
+		lockstat_class_count = cls + 1;
+		lockstat_hash[i] = cls;
+	}
+	
+out:
+	CS_LEAVE_BARRIER();
+	atomic_set(&lockstat_class_lock, 0);
+	interrupts_restore(ipl);
+	
+	return cls;
+}
+
+/** Get the histogram bucket of a time in cycles */
+static unsigned int lockstat_bucket(uint64_t cycles)
+{
+	if (cycles == 0)
+		return 0;
+	
+	return min(fnzb64(cycles) / 2, LOCK_HIST_BUCKETS - 1);
+}
+
+/** Get the counters of the current CPU (with interrupts disabled). */
+static lockstat_counters_t *lockstat_counters(unsigned int cls)
+{
+	if ((!lockstat_ready) || (CPU == NULL) || (CPU->lockstat == NULL))
+		return NULL;
+	
+	return &CPU->lockstat[cls];
+}
+
+/** Record an acquisition of a lock
+ *
+ * @param cls       Lock class.
+ * @param contended The lock was not available at first.
+ * @param wait      Cycles spent spinning or sleeping if contended.
+ *
+ */
+void lockstat_acquired(unsigned int cls, bool contended, uint64_t wait)
+{
+	if (cls == LOCKSTAT_CLASS_NONE)
+		return;
+	
+	ipl_t ipl = interrupts_disable();
+	
+	lockstat_counters_t *counters = lockstat_counters(cls);
+	if (counters != NULL) {
+		counters->acquisitions++;
+		
+		if (contended) {
+			counters->contentions++;
+			counters->wait_cycles += wait;
+			counters->wait_max = max(counters->wait_max, wait);
+			counters->wait_hist[lockstat_bucket(wait)]++;
+		}
+	}
+	
+	interrupts_restore(ipl);
+}
+
+/** Record a release of a lock
+ *
+ * @param cls  Lock class.
+ * @param hold Cycles the lock was held for.
+ *
+ */
+void lockstat_released(unsigned int cls, uint64_t hold)
+{
+	if (cls == LOCKSTAT_CLASS_NONE)
+		return;
+	
+	ipl_t ipl = interrupts_disable();
+	
+	lockstat_counters_t *counters = lockstat_counters(cls);
+	if (counters != NULL) {
+		counters->hold_cycles += hold;
+		counters->hold_max = max(counters->hold_max, hold);
+		counters->hold_hist[lockstat_bucket(hold)]++;
+	}
+	
+	interrupts_restore(ipl);
+}
+
+/** Get lock class statistics
+ *
+ * The counters of all CPUs are summed up. Classes which have
+ * never been acquired are included as well.
+ *
+ * @param stats Array of stats_lock_t structures to fill in.
+ * @param count Number of items in the array.
+ *
+ * @return Number of lock classes. This number may be larger
+ *         than the number of stored items.
+ *
+ */
+size_t lockstat_get(stats_lock_t *stats, size_t count)
+{
+	size_t classes = lockstat_class_count;
+	
+	/* Pairs with the write barrier in lockstat_class() */
+	read_barrier();
+	
+	for (size_t cls = LOCKSTAT_CLASS_OTHER; cls < classes; cls++) {
+		size_t i = cls - LOCKSTAT_CLASS_OTHER;
+		if (i >= count)
+			break;
+		
+		memsetb(&stats[i], sizeof(stats_lock_t), 0);
+		str_cpy(stats[i].name, LOCK_NAME_BUFLEN,
+		    lockstat_classes[cls].name);
+		stats[i].type = lockstat_classes[cls].type;
+		
+		if (!lockstat_ready)
+			continue;
+		
+		for (unsigned int c = 0; c < config.cpu_count; c++) {
+			lockstat_counters_t *counters = &cpus[c].lockstat[cls];
+			
+			stats[i].acquisitions += counters->acquisitions;
+			stats[i].contentions += counters->contentions;
+			stats[i].wait_cycles += counters->wait_cycles;
+			stats[i].wait_max = max(stats[i].wait_max,
+			    counters->wait_max);
+			stats[i].hold_cycles += counters->hold_cycles;
+			stats[i].hold_max = max(stats[i].hold_max,
+			    counters->hold_max);
+			
+			for (unsigned int b = 0; b < LOCK_HIST_BUCKETS; b++) {
+				stats[i].wait_hist[b] += counters->wait_hist[b];
+				stats[i].hold_hist[b] += counters->hold_hist[b];
+			}
+		}
+	}
+	
+	return classes - LOCKSTAT_CLASS_OTHER;
+}
+
+/** Reset the counters of all CPUs
+ *
+ * Events recorded concurrently on other CPUs may survive the reset.
+ *
+ */
+static void lockstat_reset(void)
+{
+	if (!lockstat_ready)
+		return;
+	
+	for (unsigned int c = 0; c < config.cpu_count; c++) {
+		ipl_t ipl = interrupts_disable();
+		memsetb(cpus[c].lockstat,
+		    LOCKSTAT_CLASSES * sizeof(lockstat_counters_t), 0);
+		interrupts_restore(ipl);
+	}
+}
+
+#ifdef CONFIG_KCONSOLE
+
+static char flag_buf[MAX_CMDLINE + 1];
+
+static int cmp_wait(void *a, void *b, void *arg)
+{
+	uint64_t wa = ((stats_lock_t *) a)->wait_cycles;
+	uint64_t wb = ((stats_lock_t *) b)->wait_cycles;
+	
+	if (wa == wb)
+		return 0;
+	
+	return (wa > wb) ? -1 : 1;
+}
+
+static const char *lock_type_name(lock_type_t type)
+{
+	switch (type) {
+	case LOCK_TYPE_SPINLOCK:
+		return "spin";
+	case LOCK_TYPE_MUTEX:
+		return "mutex";
+	case LOCK_TYPE_SEMAPHORE:
+		return "sema";
+	case LOCK_TYPE_CONDVAR:
+		return "condvar";
+	}
+	
+	return "?";
+}
+
+/** Print lock classes ordered by the total wait time
+ *
+ */
+static int cmd_lockstat(cmd_arg_t *argv)
+{
+	bool all;
+	
+	if (str_cmp(flag_buf, "-r") == 0) {
+		lockstat_reset();
+		printf("Lock statistics reset.\n");
+		return 1;
+	} else if (str_cmp(flag_buf, "-a") == 0)
+		all = true;
+	else if (str_cmp(flag_buf, "") == 0)
+		all = false;
+	else {
+		printf("Unknown argument \"%s\".\n", flag_buf);
+		return 1;
+	}
+	
+	size_t count = lockstat_get(NULL, 0);
+	stats_lock_t *stats = malloc(count * sizeof(stats_lock_t), FRAME_ATOMIC);
+	if (stats == NULL) {
+		printf("Not enough memory.\n");
+		return 1;
+	}
+	
+	count = min(count, lockstat_get(stats, count));
+	gsort(stats, count, sizeof(stats_lock_t), cmp_wait, NULL);
+	
+	printf("[type]  [acquired] [contended] [wait avg] [wait max]"
+	    " [hold avg] [hold max] [name]\n");
+	
+	size_t rows = 1;
+	for (size_t i = 0; i < count; i++) {
+		if ((!all) && (stats[i].contentions == 0))
+			continue;
+		
+		uint64_t acquired;
+		char acquired_suffix;
+		order_suffix(stats[i].acquisitions, &acquired, &acquired_suffix);
+		
+		uint64_t contended;
+		char contended_suffix;
+		order_suffix(stats[i].contentions, &contended, &contended_suffix);
+		
+		uint64_t wait_avg = (stats[i].contentions != 0) ?
+		    stats[i].wait_cycles / stats[i].contentions : 0;
+		uint64_t hold_avg = (stats[i].acquisitions != 0) ?
+		    stats[i].hold_cycles / stats[i].acquisitions : 0;
+		
+		printf("%-7s %9" PRIu64 "%c %10" PRIu64 "%c %10" PRIu64
+		    " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %s\n",
+		    lock_type_name(stats[i].type), acquired, acquired_suffix,
+		    contended, contended_suffix, wait_avg, stats[i].wait_max,
+		    hold_avg, stats[i].hold_max, stats[i].name);
+		
+		PAGING(rows, 1, ;, ;);
+	}
+	
+	free(stats);
+	return 1;
+}
+
+static cmd_arg_t lockstat_argv = {
+	.type = ARG_TYPE_STRING_OPTIONAL,
+	.buffer = flag_buf,
+	.len = sizeof(flag_buf)
+};
+
+static cmd_info_t lockstat_info = {
+	.name = "lockstat",
+	.description = "Print contended lock classes in cycles "
+	    "(use -a for all classes, -r to reset).",
+	.func = cmd_lockstat,
+	.help = NULL,
+	.argc = 1,
+	.argv = &lockstat_argv
+};
+
+#endif /* CONFIG_KCONSOLE */
+
+/** Initialize lock statistics
+ *
+ * Allocate the counters of all CPUs. Must be called after cpu_init()
+ * on the bootstrap CPU. Locks acquired before are not accounted.
+ *
+ */
+void lockstat_init(void)
+{
+	for (unsigned int c = 0; c < config.cpu_count; c++) {
+		cpus[c].lockstat = malloc(LOCKSTAT_CLASSES *
+		    sizeof(lockstat_counters_t), FRAME_ATOMIC);
+		if (cpus[c].lockstat == NULL) {
+			printf("Cannot allocate lock statistics.\n");
+			return;
+		}
+		
+		memsetb(cpus[c].lockstat,
+		    LOCKSTAT_CLASSES * sizeof(lockstat_counters_t), 0);
+	}
+	
+	write_barrier();
+	lockstat_ready = true;
+	
+#ifdef CONFIG_KCONSOLE
+	cmd_initialize(&lockstat_info);
+	if (!cmd_register(&lockstat_info))
+		printf("Cannot register command %s\n", lockstat_info.name);
+#endif
+}
+
+/** @}
+ */
@@ -44,17 +44,35 @@
 #include <cpu.h>
 #include <proc/thread.h>
 
+#ifdef CONFIG_LOCKSTAT
+#include <arch/cycle.h>
+#endif
+
 /** Initialize mutex.
  *
  * @param mtx   Mutex.
  * @param type  Type of the mutex.
+ * @param site  Lock class of the mutex, see LOCKSTAT_SITE.
  */
-void mutex_initialize(mutex_t *mtx, mutex_type_t type)
+void _mutex_initialize(mutex_t *mtx, mutex_type_t type, const char *site)
 {
 	mtx->type = type;
 	mtx->owner = NULL;
 	mtx->nesting = 0;
-	semaphore_initialize(&mtx->sem, 1);
+	
+	/*
+	 * The underlying semaphore is not accounted on its own, the mutex
+	 * keeps track of both the waiting and the holding time. Only the
+	 * wait queue spinlock is named after the site of the mutex.
+	 */
+	_waitq_initialize(&mtx->sem.wq, site);
+	waitq_count_set(&mtx->sem.wq, 1);
+	
+#ifdef CONFIG_LOCKSTAT
+	mtx->lsclass = site ? lockstat_class(site, LOCK_TYPE_MUTEX) :
+	    LOCKSTAT_CLASS_NONE;
+	mtx->acquired = 0;
+#endif
 }
 
 /** Find out whether the mutex is currently locked.
@@ -70,6 +88,48 @@ bool mutex_locked(mutex_t *mtx)
 
 #define MUTEX_DEADLOCK_THRESHOLD	100000000
 
+#ifdef CONFIG_LOCKSTAT
+
+static void mutex_lockstat_acquired(mutex_t *mtx, bool contended,
+    uint64_t start)
+{
+	uint64_t now = get_cycle();
+	
+	mtx->acquired = now;
+	lockstat_acquired(mtx->lsclass, contended, contended ? now - start : 0);
+}
+
+#endif
+
+/** Take the semaphore of a passive or recursive mutex.
+ *
+ * The waiting time is accounted only if the mutex was not available
+ * right away.
+ *
+ */
+static errno_t mutex_sem_down(mutex_t *mtx, uint32_t usec, unsigned int flags)
+{
+#ifdef CONFIG_LOCKSTAT
+	errno_t rc = semaphore_trydown(&mtx->sem);
+	if (rc == EOK) {
+		mutex_lockstat_acquired(mtx, false, 0);
+		return EOK;
+	}
+	
+	if ((flags & SYNCH_FLAGS_NON_BLOCKING) && (usec == SYNCH_NO_TIMEOUT))
+		return rc;
+	
+	uint64_t start = get_cycle();
+	rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+	if (rc == EOK)
+		mutex_lockstat_acquired(mtx, true, start);
+	
+	return rc;
+#else
+	return _semaphore_down_timeout(&mtx->sem, usec, flags);
+#endif
+}
+
 /** Acquire mutex.
  *
  * Timeout mode and non-blocking mode can be requested.
@@ -89,7 +149,7 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 	errno_t rc;
 
 	if (mtx->type == MUTEX_PASSIVE && THREAD) {
-		rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+		rc = mutex_sem_down(mtx, usec, flags);
 	} else if (mtx->type == MUTEX_RECURSIVE) {
 		assert(THREAD);
 
@@ -97,7 +157,7 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 			mtx->nesting++;
 			return EOK;
 		} else {
-			rc = _semaphore_down_timeout(&mtx->sem, usec, flags);
+			rc = mutex_sem_down(mtx, usec, flags);
 			if (rc == EOK) {
 				mtx->owner = THREAD;
 				mtx->nesting = 1;
@@ -110,6 +170,9 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 		
 		unsigned int cnt = 0;
 		bool deadlock_reported = false;
+#ifdef CONFIG_LOCKSTAT
+		uint64_t start = get_cycle();
+#endif
 		do {
 			if (cnt++ > MUTEX_DEADLOCK_THRESHOLD) {
 				printf("cpu%u: looping on active mutex %p\n",
@@ -122,6 +185,12 @@ errno_t _mutex_lock_timeout(mutex_t *mtx, uint32_t usec, unsigned int flags)
 		} while (rc != EOK && !(flags & SYNCH_FLAGS_NON_BLOCKING));
 		if (deadlock_reported)
 			printf("cpu%u: not deadlocked\n", CPU->id);
+		
+#ifdef CONFIG_LOCKSTAT
+		if (rc == EOK)
+			mutex_lockstat_acquired(mtx,
+			    (cnt > 1) || deadlock_reported, start);
+#endif
 	}
 
 	return rc;
@@ -139,6 +208,11 @@ void mutex_unlock(mutex_t *mtx)
 			return;
 		mtx->owner = NULL;
 	}
+	
+#ifdef CONFIG_LOCKSTAT
+	lockstat_released(mtx->lsclass, get_cycle() - mtx->acquired);
+#endif
+	
 	semaphore_up(&mtx->sem);
 }
 
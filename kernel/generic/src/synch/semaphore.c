@@ -45,14 +45,20 @@
  *
  * Initialize semaphore.
  *
- * @param sem Semaphore.
- * @param val Maximal number of threads allowed to enter critical section.
+ * @param sem  Semaphore.
+ * @param val  Maximal number of threads allowed to enter critical section.
+ * @param site Lock class of the semaphore, see LOCKSTAT_SITE.
  *
  */
-void semaphore_initialize(semaphore_t *sem, int val)
+void _semaphore_initialize(semaphore_t *sem, int val, const char *site)
 {
-	waitq_initialize(&sem->wq);
+	_waitq_initialize(&sem->wq, site);
 	waitq_count_set(&sem->wq, val);
+	
+#ifdef CONFIG_LOCKSTAT
+	if (site != NULL)
+		sem->wq.lsclass = lockstat_class(site, LOCK_TYPE_SEMAPHORE);
+#endif
 }
 
 /** Semaphore down
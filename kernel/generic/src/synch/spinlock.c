@@ -45,6 +45,11 @@
 #include <symtab.h>
 #include <stacktrace.h>
 #include <cpu.h>
+#include <synch/lockstat.h>
+
+#ifdef CONFIG_LOCKSTAT
+#include <arch/cycle.h>
+#endif
 
 #ifdef CONFIG_SMP
 
@@ -56,29 +61,70 @@
 void spinlock_initialize(spinlock_t *lock, const char *name)
 {
 	atomic_set(&lock->val, 0);
-#ifdef CONFIG_DEBUG_SPINLOCK
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
 	lock->name = name;
 #endif
+#ifdef CONFIG_LOCKSTAT
+	lock->lsclass = 0;
+#endif
 }
 
-#ifdef CONFIG_DEBUG_SPINLOCK
+#ifdef CONFIG_LOCKSTAT
+
+/** Account a successful acquisition of a spinlock
+ *
+ * @param lock      Spinlock which has just been locked.
+ * @param contended The spinlock was not available at first.
+ * @param start     Cycle counter when the spinning began.
+ *
+ */
+static void spinlock_lockstat_acquired(spinlock_t *lock, bool contended,
+    uint64_t start)
+{
+	lock->acquired = get_cycle();
+	
+	if (lock->lsclass == 0)
+		lock->lsclass = lockstat_class(lock->name, LOCK_TYPE_SPINLOCK);
+	
+	lockstat_acquired(lock->lsclass, contended,
+	    contended ? lock->acquired - start : 0);
+}
+
+#endif /* CONFIG_LOCKSTAT */
+
+#if defined(CONFIG_DEBUG_SPINLOCK) || defined(CONFIG_LOCKSTAT)
 
 /** Lock spinlock
  *
  * Lock spinlock.
  * This version has limitted ability to report 
- * possible occurence of deadlock.
+ * possible occurence of deadlock and accounts
+ * the lock in lock statistics.
  *
  * @param lock Pointer to spinlock_t structure.
  *
  */
 void spinlock_lock_debug(spinlock_t *lock)
 {
+#ifdef CONFIG_DEBUG_SPINLOCK
 	size_t i = 0;
 	bool deadlock_reported = false;
+#endif
+#ifdef CONFIG_LOCKSTAT
+	bool contended = false;
+	uint64_t start = 0;
+#endif
 	
 	preemption_disable();
 	while (test_and_set(&lock->val)) {
+#ifdef CONFIG_LOCKSTAT
+		if (!contended) {
+			contended = true;
+			start = get_cycle();
+		}
+#endif
+		
+#ifdef CONFIG_DEBUG_SPINLOCK
 		/*
 		 * We need to be careful about particular locks
 		 * which are directly used to report deadlocks
@@ -110,15 +156,22 @@ void spinlock_lock_debug(spinlock_t *lock)
 			i = 0;
 			deadlock_reported = true;
 		}
+#endif
 	}
 	
+#ifdef CONFIG_DEBUG_SPINLOCK
 	if (deadlock_reported)
 		printf("cpu%u: not deadlocked\n", CPU->id);
+#endif
 	
 	/*
 	 * Prevent critical section code from bleeding out this way up.
 	 */
 	CS_ENTER_BARRIER();
+	
+#ifdef CONFIG_LOCKSTAT
+	spinlock_lockstat_acquired(lock, contended, start);
+#endif
 }
 
 /** Unlock spinlock
@@ -131,6 +184,10 @@ void spinlock_unlock_debug(spinlock_t *lock)
 {
 	ASSERT_SPINLOCK(spinlock_locked(lock), lock);
 	
+#ifdef CONFIG_LOCKSTAT
+	lockstat_released(lock->lsclass, get_cycle() - lock->acquired);
+#endif
+	
 	/*
 	 * Prevent critical section code from bleeding out this way down.
 	 */
@@ -165,6 +222,11 @@ bool spinlock_trylock(spinlock_t *lock)
 	if (!ret)
 		preemption_enable();
 	
+#ifdef CONFIG_LOCKSTAT
+	if (ret)
+		spinlock_lockstat_acquired(lock, false, 0);
+#endif
+	
 	return ret;
 }
 
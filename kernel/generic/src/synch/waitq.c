@@ -60,19 +60,37 @@
 static void waitq_sleep_timed_out(void *);
 static void waitq_complete_wakeup(waitq_t *);
 
+#ifdef CONFIG_LOCKSTAT
+#define WAITQ_LOCKSTAT(wq, slept, start) \
+	lockstat_acquired((wq)->lsclass, (slept), \
+	    (slept) ? get_cycle() - (start) : 0)
+#else
+#define WAITQ_LOCKSTAT(wq, slept, start)
+#endif
+
 
 /** Initialize wait queue
  *
  * Initialize wait queue.
  *
- * @param wq Pointer to wait queue to be initialized.
+ * Sleeping in a bare wait queue is waiting for an event rather than
+ * for a lock, so the wait queue is accounted only if a semaphore or
+ * a condition variable sets its lock class.
+ *
+ * @param wq   Pointer to wait queue to be initialized.
+ * @param site Initialization site naming the class of the wait queue
+ *             spinlock, see LOCKSTAT_SITE. NULL for a shared class.
  *
  */
-void waitq_initialize(waitq_t *wq)
+void _waitq_initialize(waitq_t *wq, const char *site)
 {
-	irq_spinlock_initialize(&wq->lock, "wq.lock");
+	irq_spinlock_initialize(&wq->lock, (site != NULL) ? site : "wq.lock");
 	list_initialize(&wq->sleepers);
 	wq->missed_wakeups = 0;
+	
+#ifdef CONFIG_LOCKSTAT
+	wq->lsclass = LOCKSTAT_CLASS_NONE;
+#endif
 }
 
 /** Handle timeout during waitq_sleep_timeout() call
@@ -379,6 +397,7 @@ errno_t waitq_sleep_timeout_unsafe(waitq_t *wq, uint32_t usec, unsigned int flag
 	/* Checks whether to go to sleep at all */
 	if (wq->missed_wakeups) {
 		wq->missed_wakeups--;
+		WAITQ_LOCKSTAT(wq, false, 0);
 		return EOK;
 	} else {
 		if (PARAM_NON_BLOCKING(flags, usec)) {
@@ -391,6 +410,10 @@ errno_t waitq_sleep_timeout_unsafe(waitq_t *wq, uint32_t usec, unsigned int flag
 	 * Now we are firmly decided to go to sleep.
 	 *
 	 */
+#ifdef CONFIG_LOCKSTAT
+	uint64_t sleep_start = get_cycle();
+#endif
+	
 	irq_spinlock_lock(&THREAD->lock, false);
 	
 	if (flags & SYNCH_FLAGS_INTERRUPTIBLE) {
@@ -412,6 +435,7 @@ errno_t waitq_sleep_timeout_unsafe(waitq_t *wq, uint32_t usec, unsigned int flag
 			/* Short emulation of scheduler() return code. */
 			THREAD->last_cycle = get_cycle();
 			irq_spinlock_unlock(&THREAD->lock, false);
+			WAITQ_LOCKSTAT(wq, true, sleep_start);
 			return EINTR;
 		}
 	} else
@@ -423,6 +447,7 @@ errno_t waitq_sleep_timeout_unsafe(waitq_t *wq, uint32_t usec, unsigned int flag
 			/* Short emulation of scheduler() return code. */
 			THREAD->last_cycle = get_cycle();
 			irq_spinlock_unlock(&THREAD->lock, false);
+			WAITQ_LOCKSTAT(wq, true, sleep_start);
 			return ETIMEOUT;
 		}
 		
@@ -450,6 +475,7 @@ errno_t waitq_sleep_timeout_unsafe(waitq_t *wq, uint32_t usec, unsigned int flag
 	/* wq->lock is released in scheduler_separated_stack() */
 	scheduler();
 	
+	WAITQ_LOCKSTAT(wq, true, sleep_start);
 	return EOK;
 }
 
@@ -462,11 +488,21 @@ errno_t waitq_sleep_timeout_unsafe(waitq_t *wq, uint32_t usec, unsigned int flag
  * timeout.
  *
  * @param wq   Pointer to wait queue.
- * @param mode Wakeup mode.
+ * @param mode Wakeup mode. WAKEUP_HANDOFF is turned into WAKEUP_FIRST
+ *             when called with interrupts disabled.
  *
  */
 void waitq_wakeup(waitq_t *wq, wakeup_mode_t mode)
 {
+	/*
+	 * An interrupt handler runs on behalf of an unrelated interrupted
+	 * thread, which must not hand off its CPU. Threads wake up each
+	 * other with interrupts enabled, only interrupt handlers and code
+	 * holding spinlocks do so with interrupts disabled.
+	 */
+	if ((mode == WAKEUP_HANDOFF) && (interrupts_disabled()))
+		mode = WAKEUP_FIRST;
+	
 	irq_spinlock_lock(&wq->lock, true);
 	_waitq_wakeup_unsafe(wq, mode);
 	irq_spinlock_unlock(&wq->lock, true);
@@ -524,9 +560,12 @@ static void waitq_complete_wakeup(waitq_t *wq)
  * @param wq   Pointer to wait queue.
  * @param mode If mode is WAKEUP_FIRST, then the longest waiting
  *             thread, if any, is woken up. If mode is WAKEUP_ALL, then
- *             all waiting threads, if any, are woken up. If there are
- *             no waiting threads to be woken up, the missed wakeup is
- *             recorded in the wait queue.
+ *             all waiting threads, if any, are woken up. WAKEUP_HANDOFF
+ *             acts like WAKEUP_FIRST, but the current thread will hand
+ *             off the CPU to the woken up thread when it blocks (see
+ *             thread_ready_handoff()). If there are no waiting threads
+ *             to be woken up, the missed wakeup is recorded in the wait
+ *             queue.
  *
  */
 void _waitq_wakeup_unsafe(waitq_t *wq, wakeup_mode_t mode)
@@ -576,7 +615,10 @@ loop:
 	thread->sleep_queue = NULL;
 	irq_spinlock_unlock(&thread->lock, false);
 	
-	thread_ready(thread);
+	if (mode == WAKEUP_HANDOFF)
+		thread_ready_handoff(thread);
+	else
+		thread_ready(thread);
 	
 	if (mode == WAKEUP_ALL)
 		goto loop;
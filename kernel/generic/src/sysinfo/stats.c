@@ -40,8 +40,10 @@
 #include <sysinfo/sysinfo.h>
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
+#include <synch/lockstat.h>
 #include <time/clock.h>
 #include <mm/frame.h>
+#include <mm/slab.h>
 #include <proc/task.h>
 #include <proc/thread.h>
 #include <interrupt.h>
@@ -617,6 +619,78 @@ static void *get_stats_exceptions(struct sysinfo_item *item, size_t *size,
 	return ((void *) stats_exceptions);
 }
 
+/** Get slab cache statistics
+ *
+ * @param item    Sysinfo item (unused).
+ * @param size    Size of the returned data.
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Data containing several stats_slab_t structures.
+ *         If the return value is not NULL, it should be freed
+ *         in the context of the sysinfo request.
+ */
+static void *get_stats_slabs(struct sysinfo_item *item, size_t *size,
+    bool dry_run, void *data)
+{
+	size_t count = slab_stats_get(NULL, 0);
+	*size = sizeof(stats_slab_t) * count;
+	
+	if (dry_run)
+		return NULL;
+	
+	stats_slab_t *stats_slabs = (stats_slab_t *) malloc(*size, FRAME_ATOMIC);
+	if (stats_slabs == NULL) {
+		/* No free space for allocation */
+		*size = 0;
+		return NULL;
+	}
+	
+	/* Caches might have been destroyed in the meantime */
+	count = min(count, slab_stats_get(stats_slabs, count));
+	*size = sizeof(stats_slab_t) * count;
+	
+	return ((void *) stats_slabs);
+}
+
+#ifdef CONFIG_LOCKSTAT
+
+/** Get lock contention statistics
+ *
+ * @param item    Sysinfo item (unused).
+ * @param size    Size of the returned data.
+ * @param dry_run Do not get the data, just calculate the size.
+ * @param data    Unused.
+ *
+ * @return Data containing several stats_lock_t structures.
+ *         If the return value is not NULL, it should be freed
+ *         in the context of the sysinfo request.
+ */
+static void *get_stats_locks(struct sysinfo_item *item, size_t *size,
+    bool dry_run, void *data)
+{
+	size_t count = lockstat_get(NULL, 0);
+	*size = sizeof(stats_lock_t) * count;
+	
+	if ((dry_run) || (count == 0))
+		return NULL;
+	
+	stats_lock_t *stats_locks = (stats_lock_t *) malloc(*size, FRAME_ATOMIC);
+	if (stats_locks == NULL) {
+		/* No free space for allocation */
+		*size = 0;
+		return NULL;
+	}
+	
+	/* New lock classes might have been registered in the meantime */
+	count = min(count, lockstat_get(stats_locks, count));
+	*size = sizeof(stats_lock_t) * count;
+	
+	return ((void *) stats_locks);
+}
+
+#endif /* CONFIG_LOCKSTAT */
+
 /** Get exception statistics
  *
  * Get statistics of a given exception. The exception number
@@ -811,6 +885,10 @@ void stats_init(void)
 	sysinfo_set_item_gen_data("system.tasks", NULL, get_stats_tasks, NULL);
 	sysinfo_set_item_gen_data("system.threads", NULL, get_stats_threads, NULL);
 	sysinfo_set_item_gen_data("system.exceptions", NULL, get_stats_exceptions, NULL);
+	sysinfo_set_item_gen_data("system.slabs", NULL, get_stats_slabs, NULL);
+#ifdef CONFIG_LOCKSTAT
+	sysinfo_set_item_gen_data("system.locks", NULL, get_stats_locks, NULL);
+#endif
 	sysinfo_set_subtree_fn("system.tasks", NULL, get_stats_task, NULL);
 	sysinfo_set_subtree_fn("system.threads", NULL, get_stats_thread, NULL);
 	sysinfo_set_subtree_fn("system.exceptions", NULL, get_stats_exception, NULL);
@@ -57,6 +57,7 @@
 #include <mm/frame.h>
 #include <ddi/ddi.h>
 #include <arch/cycle.h>
+#include <profile.h>
 
 /* Pointer to variable with uptime */
 uptime_t *uptime;
@@ -149,6 +150,9 @@ void clock(void)
 	/* Account CPU usage */
 	cpu_update_accounting();
 	
+	/* Sample the interrupted context */
+	profile_tick();
+	
 	/*
 	 * To avoid lock ordering problems,
 	 * run all expired timeouts as you visit them.
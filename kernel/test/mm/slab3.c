@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <test.h>
+#include <mm/slab.h>
+#include <print.h>
+#include <proc/thread.h>
+#include <synch/semaphore.h>
+#include <atomic.h>
+#include <mem.h>
+#include <mm/frame.h>
+#include <mm/page.h>
+
+#define ITEM_SIZE   64
+#define ITEM_COUNT  1024
+
+/* Slabs of several frames with more than a page left for coloring */
+#define COLOR_ITEM_SIZE  5464
+
+#define THREADS         4
+#define THR_ITEM_COUNT  256
+#define THR_ROUNDS      100
+
+static void *data[ITEM_COUNT];
+
+static slab_cache_t *thr_cache;
+static semaphore_t thr_sem;
+
+static void set_mag_size(slab_cache_t *cache, size_t size)
+{
+	irq_spinlock_lock(&cache->maglock, true);
+	cache->mag_size = size;
+	cache->contention_base = atomic_get(&cache->contention);
+	irq_spinlock_unlock(&cache->maglock, true);
+}
+
+static void alloc_all(slab_cache_t *cache)
+{
+	for (size_t i = 0; i < ITEM_COUNT; i++) {
+		data[i] = slab_alloc(cache, 0);
+		memsetb(data[i], ITEM_SIZE, 0);
+	}
+}
+
+static void free_all(slab_cache_t *cache)
+{
+	for (size_t i = 0; i < ITEM_COUNT; i++)
+		slab_free(cache, data[i]);
+}
+
+/** Check that the depot keeps empty magazines and reclaim shrinks them */
+static const char *testdepot(void)
+{
+	slab_cache_t *cache = slab_cache_create("test_depot", ITEM_SIZE, 0,
+	    NULL, NULL, 0);
+	
+	/* Pretend the depot has been contended enough to grow magazines */
+	set_mag_size(cache, SLAB_MAG_SIZE_MAX);
+	
+	TPRINTF("Filling the depot...");
+	
+	/*
+	 * Freeing fills magazines and puts them to the depot, allocating
+	 * the objects again returns the emptied magazines to the depot.
+	 */
+	alloc_all(cache);
+	free_all(cache);
+	alloc_all(cache);
+	
+	TPRINTF("done (%" PRIua " full, %" PRIua " empty magazines).\n",
+	    atomic_get(&cache->magazine_counter),
+	    atomic_get(&cache->empty_counter));
+	
+	const char *err = NULL;
+	
+	if (atomic_get(&cache->empty_counter) == 0) {
+		err = "No empty magazines in the depot";
+		goto out;
+	}
+	
+	TPRINTF("Reclaiming...");
+	slab_reclaim(0);
+	TPRINTF("done (magazine size %zu).\n", cache->mag_size);
+	
+	if (atomic_get(&cache->empty_counter) != 0) {
+		err = "Reclaim left empty magazines in the depot";
+		goto out;
+	}
+	
+	if (cache->mag_size >= SLAB_MAG_SIZE_MAX) {
+		err = "Reclaim did not shrink magazines";
+		goto out;
+	}
+	
+	/* Repeated reclaim shrinks down to the initial size */
+	for (size_t i = 0; i < SLAB_MAG_SIZES; i++)
+		slab_reclaim(0);
+	
+	if (cache->mag_size != SLAB_MAG_SIZE)
+		err = "Reclaim did not shrink magazines to the initial size";
+	
+out:
+	free_all(cache);
+	slab_cache_destroy(cache);
+	
+	return err;
+}
+
+/** Check that colored multi-frame slabs return all their frames */
+static const char *testcolor(void)
+{
+	slab_cache_t *cache = slab_cache_create("test_color", COLOR_ITEM_SIZE,
+	    0, NULL, NULL, SLAB_CACHE_NOMAGAZINE);
+	
+	TPRINTF("%zu frames, %zu objects and %zu colors per slab\n",
+	    cache->frames, cache->objects, cache->colors);
+	
+	const char *err = NULL;
+	
+	if ((cache->frames < 2) || (cache->colors < 2)) {
+		err = "Cache does not have colored multi-frame slabs";
+		goto out;
+	}
+	
+	/* Go through all colors several times */
+	size_t count = min(ITEM_COUNT, 2 * cache->objects * cache->colors);
+	size_t free_frames = frame_total_free_get();
+	
+	for (size_t round = 0; round < 4; round++) {
+		for (size_t i = 0; i < count; i++) {
+			data[i] = slab_alloc(cache, 0);
+			memsetb(data[i], COLOR_ITEM_SIZE, 0);
+			
+			/* The object must lie within a single slab */
+			uintptr_t first = KA2PA(data[i]);
+			uintptr_t last = first + COLOR_ITEM_SIZE - 1;
+			if (frame_get_parent(ADDR2PFN(first), 0) !=
+			    frame_get_parent(ADDR2PFN(last), 0))
+				err = "Object reaches past its slab";
+		}
+		
+		/* Without magazines, empty slabs are freed right away */
+		for (size_t i = 0; i < count; i++)
+			slab_free(cache, data[i]);
+		
+		if (err != NULL)
+			goto out;
+	}
+	
+	if (frame_total_free_get() != free_frames)
+		err = "Frames of freed slabs were not returned";
+	
+out:
+	slab_cache_destroy(cache);
+	
+	return err;
+}
+
+static void depottest(void *arg)
+{
+	void *items[THR_ITEM_COUNT];
+	
+	thread_detach(THREAD);
+	
+	for (size_t j = 0; j < THR_ROUNDS; j++) {
+		for (size_t i = 0; i < THR_ITEM_COUNT; i++)
+			items[i] = slab_alloc(thr_cache, 0);
+		for (size_t i = 0; i < THR_ITEM_COUNT; i++)
+			slab_free(thr_cache, items[i]);
+	}
+	
+	semaphore_up(&thr_sem);
+}
+
+/** Run several threads through the depot concurrently */
+static void testthreads(void)
+{
+	thr_cache = slab_cache_create("test_depot_threads", ITEM_SIZE, 0,
+	    NULL, NULL, 0);
+	
+	semaphore_initialize(&thr_sem, 0);
+	
+	size_t running = 0;
+	for (size_t i = 0; i < THREADS; i++) {
+		thread_t *thread = thread_create(depottest, NULL, TASK,
+		    THREAD_FLAG_NONE, "depottest");
+		if (!thread) {
+			TPRINTF("Could not create thread %zu\n", i);
+			continue;
+		}
+		
+		thread_ready(thread);
+		running++;
+	}
+	
+	for (size_t i = 0; i < running; i++)
+		semaphore_down(&thr_sem);
+	
+	TPRINTF("Depot contention %" PRIua ", magazine size %zu\n",
+	    atomic_get(&thr_cache->contention), thr_cache->mag_size);
+	
+	slab_cache_destroy(thr_cache);
+}
+
+const char *test_slab3(void)
+{
+	const char *err = testdepot();
+	if (err != NULL)
+		return err;
+	
+	err = testcolor();
+	if (err != NULL)
+		return err;
+	
+	testthreads();
+	
+	return NULL;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <test.h>
+#include <arch.h>
+#include <arch/asm.h>
+#include <preemption.h>
+#include <print.h>
+#include <proc/thread.h>
+#include <synch/waitq.h>
+
+#define ROUNDS  10000
+
+static waitq_t ping;
+static waitq_t pong;
+
+static void peer(void *arg)
+{
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		waitq_sleep(&ping);
+		waitq_wakeup(&pong, WAKEUP_HANDOFF);
+	}
+	
+	/* Woken up from thread context and then with interrupts disabled */
+	waitq_sleep(&ping);
+	waitq_sleep(&ping);
+}
+
+/** Wake up a wait queue with a handoff and get the hint left in THREAD.
+ *
+ * Preemption is disabled, so that the scheduler cannot consume the hint
+ * before it is read.
+ *
+ */
+static thread_t *wakeup_hint(waitq_t *wq, bool intr)
+{
+	preemption_disable();
+	
+	ipl_t ipl = interrupts_disable();
+	THREAD->handoff = NULL;
+	if (!intr)
+		interrupts_restore(ipl);
+	
+	waitq_wakeup(wq, WAKEUP_HANDOFF);
+	
+	if (!intr)
+		ipl = interrupts_disable();
+	thread_t *hint = THREAD->handoff;
+	interrupts_restore(ipl);
+	
+	preemption_enable();
+	return hint;
+}
+
+static void wait_for_sleeper(waitq_t *wq)
+{
+	while (true) {
+		irq_spinlock_lock(&wq->lock, true);
+		bool sleeping = !list_empty(&wq->sleepers);
+		irq_spinlock_unlock(&wq->lock, true);
+		
+		if (sleeping)
+			return;
+		
+		thread_usleep(1000);
+	}
+}
+
+const char *test_handoff1(void)
+{
+	waitq_initialize(&ping);
+	waitq_initialize(&pong);
+	
+	thread_t *thread = thread_create(peer, NULL, TASK, THREAD_FLAG_NONE,
+	    "handoff1");
+	if (thread == NULL)
+		return "Unable to create thread";
+	
+	thread_ready(thread);
+	
+	TPRINTF("Ping-pong of %d rounds...\n", ROUNDS);
+	
+	unsigned int hinted = 0;
+	for (unsigned int i = 0; i < ROUNDS; i++) {
+		if (wakeup_hint(&ping, false) == thread)
+			hinted++;
+		
+		waitq_sleep(&pong);
+	}
+	
+	TPRINTF("%u wakeups of a sleeping thread left a handoff hint\n",
+	    hinted);
+	
+	const char *err = NULL;
+	
+	/* The CPU is handed off to the peer once this thread blocks */
+	wait_for_sleeper(&ping);
+	if (wakeup_hint(&ping, false) != thread)
+		err = "Waking up a sleeping thread did not leave a handoff hint";
+	
+	/* An interrupt handler must not hand off the interrupted thread */
+	wait_for_sleeper(&ping);
+	if ((wakeup_hint(&ping, true) != NULL) && (err == NULL))
+		err = "Handoff hint left with interrupts disabled";
+	
+	thread_join(thread);
+	thread_detach(thread);
+	
+	return err;
+}
@@ -50,8 +50,10 @@ test_t tests[] = {
 #include <mm/mapping1.def>
 #include <mm/slab1.def>
 #include <mm/slab2.def>
+#include <mm/slab3.def>
 #include <synch/semaphore1.def>
 #include <synch/semaphore2.def>
+#include <synch/handoff1.def>
 #include <synch/rcu1.def>
 #include <synch/workqueue2.def>
 #include <synch/workqueue3.def>
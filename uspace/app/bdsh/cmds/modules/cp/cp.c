@@ -416,6 +416,9 @@ static int copy_file(const char *src, const char *dest,
 		return -1;	
 	}
 
+	/* The source is read front to back, let VFS read ahead. */
+	(void) vfs_advise(fd1, VFS_ADVICE_SEQUENTIAL);
+
 	total = st.size;
 	if (vb)
 		printf("%" PRIu64 " bytes to copy\n", total);
@@ -38,6 +38,8 @@
 #include <dirent.h>
 #include <getopt.h>
 #include <vfs/vfs.h>
+#include <ipc/vfs.h>
+#include <mem.h>
 #include <str.h>
 
 #include "ls.h"
@@ -47,6 +49,9 @@
 #include "entry.h"
 #include "cmds.h"
 
+/** Size of the buffer for directory entries read in one batch. */
+#define LS_BATCH_SIZE 4096
+
 static const char *cmdname = "ls";
 
 static ls_job_t ls;
@@ -58,6 +63,20 @@ static struct option const long_options[] = {
 	{ 0, 0, 0, 0 }
 };
 
+/** Directory entries read ahead together with their attributes. */
+typedef struct {
+	/** Buffer with the entries. */
+	void *buf;
+	/** Number of valid bytes in @c buf. */
+	size_t len;
+	/** Offset of the next entry to return from @c buf. */
+	size_t off;
+	/** Position of the first entry not read yet. */
+	aoff64_t pos;
+	/** File system cannot read directories in batches. */
+	bool single;
+} ls_batch_t;
+
 /* Prototypes for the ls command, excluding entry points. */
 static unsigned int ls_start(ls_job_t *);
 static void ls_print(struct dir_elem_t *);
@@ -119,6 +138,90 @@ static int ls_cmp(const void *a, const void *b)
 		return 1;
 }
 
+/** Get the next entry of a directory.
+ *
+ * Entries are read in batches together with their type and size so that
+ * most of them need not be looked up again. If the file system cannot do
+ * that, readdir() is used instead and @a *dep is set to NULL.
+ *
+ * @param dirp		Directory stream.
+ * @param batch		Batch of entries read ahead.
+ * @param name		Output parameter for the entry name.
+ * @param dep		Output parameter for the entry record or NULL.
+ *
+ * @return		EOK on success, ENOENT if there are no more entries
+ *			or another error code.
+ */
+static errno_t ls_next(DIR *dirp, ls_batch_t *batch, const char **name,
+    vfs_dirent_t **dep)
+{
+	struct dirent *dp;
+	vfs_dirent_t *de;
+	errno_t rc;
+	
+	if (!batch->single && batch->off >= batch->len) {
+		rc = vfs_read_dir(dirp->fd, &batch->pos, VFS_READDIR_ATTRS,
+		    batch->buf, LS_BATCH_SIZE, &batch->len);
+		if (rc == ENOTSUP || rc == ELIMIT) {
+			/* Continue with readdir() where the batches ended. */
+			dirp->pos = batch->pos;
+			batch->single = true;
+		} else if (rc != EOK) {
+			return rc;
+		} else if (batch->len == 0) {
+			return ENOENT;
+		}
+		
+		batch->off = 0;
+	}
+	
+	if (batch->single) {
+		dp = readdir(dirp);
+		if (!dp)
+			return ENOENT;
+		
+		*name = dp->d_name;
+		*dep = NULL;
+		return EOK;
+	}
+	
+	de = (vfs_dirent_t *) ((uint8_t *) batch->buf + batch->off);
+	batch->off += de->reclen;
+	
+	*name = de->name;
+	*dep = de;
+	return EOK;
+}
+
+/** Fill in the attributes of an entry from its directory record.
+ *
+ * A zero size is also reported by file systems that do not provide sizes,
+ * so empty files have to be looked up like entries of an unknown type.
+ *
+ * @param de		Directory record.
+ * @param s		Attributes to fill in.
+ *
+ * @return		True if @a s has been filled in.
+ */
+static bool ls_attrs(vfs_dirent_t *de, vfs_stat_t *s)
+{
+	memset(s, 0, sizeof(vfs_stat_t));
+	
+	switch (de->type) {
+	case VFS_DT_DIR:
+		s->is_directory = true;
+		return true;
+	case VFS_DT_FILE:
+		if (de->size == 0)
+			return false;
+		s->is_file = true;
+		s->size = de->size;
+		return true;
+	default:
+		return false;
+	}
+}
+
 /** Scan a directory.
  *
  * Scan the content of a directory and print it.
@@ -139,7 +242,9 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 	char *buff;
 	struct dir_elem_t *tmp;
 	struct dir_elem_t *tosort;
-	struct dirent *dp;
+	ls_batch_t batch;
+	vfs_dirent_t *de;
+	const char *name;
 	
 	if (!dirp)
 		return -1;
@@ -157,7 +262,12 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 		return -1;
 	}
 	
-	while ((dp = readdir(dirp))) {
+	memset(&batch, 0, sizeof(batch));
+	batch.buf = malloc(LS_BATCH_SIZE);
+	if (!batch.buf)
+		batch.single = true;
+	
+	while ((rc = ls_next(dirp, &batch, &name, &de)) == EOK) {
 		if (nbdirs + 1 > alloc_blocks) {
 			alloc_blocks += alloc_blocks;
 			
@@ -171,13 +281,20 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 		}
 		
 		/* fill the name field */
-		tosort[nbdirs].name = (char *) malloc(str_size(dp->d_name) + 1);
+		tosort[nbdirs].name = (char *) malloc(str_size(name) + 1);
 		if (!tosort[nbdirs].name) {
 			cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
 			goto out;
 		}
 
-		str_cpy(tosort[nbdirs].name, str_size(dp->d_name) + 1, dp->d_name);
+		str_cpy(tosort[nbdirs].name, str_size(name) + 1, name);
+		
+		/* Only look up the entries whose attributes are not known. */
+		if (de != NULL && ls_attrs(de, &tosort[nbdirs].s)) {
+			nbdirs++;
+			continue;
+		}
+		
 		len = snprintf(buff, PATH_MAX - 1, "%s/%s", d, tosort[nbdirs].name);
 		buff[len] = '\0';
 
@@ -189,6 +306,11 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 		}
 	}
 	
+	if (rc != ENOENT) {
+		cli_error(CL_EFAIL, "ls: failed to scan %s", d);
+		goto out;
+	}
+	
 	if (ls.sort)
 		qsort(&tosort[0], nbdirs, sizeof(struct dir_elem_t), ls_cmp);
 	
@@ -218,6 +340,7 @@ out:
 	for(i = 0; i < nbdirs; i++)
 		free(tosort[i].name);
 	free(tosort);
+	free(batch.buf);
 	free(buff);
 
 	return nbdirs;
@@ -35,8 +35,14 @@
  * This program measures time for various actions and writes the results
  * to a file.
  *
+ * File workloads issue block-sized requests directly via VFS from several
+ * fibrils at once (the queue depth), so that the block cache, the file
+ * system servers and the block device drivers see concurrent requests.
+ * Random offsets are derived from the operation number only, which keeps
+ * the results reproducible for any queue depth.
  */
 
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -46,72 +52,456 @@
 #include <byteorder.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <getopt.h>
+#include <macros.h>
 #include <time.h>
 #include <dirent.h>
 #include <str.h>
+#include <vfs/vfs.h>
 
 #define NAME	"bnchmark"
-#define BUFSIZE 8096
 #define MBYTE (1024*1024)
 
-typedef errno_t(*measure_func_t)(void *);
+/** Default size of a single request */
+#define DEFAULT_BLOCK_SIZE	8192
+/** Default size of the file created by the write workloads */
+#define DEFAULT_FILE_SIZE	(16 * MBYTE)
+/** Default number of operations of the random, fsync and metadata tests */
+#define DEFAULT_OPS		1024
+/** Maximum queue depth (number of worker fibrils) */
+#define MAX_DEPTH		64
+/** Initial size of the latency array if the number of operations is unknown */
+#define LAT_INITIAL		256
+
 typedef unsigned long umseconds_t; /* milliseconds */
 
+/** Parameters of a benchmark run */
+typedef struct {
+	const char *path;
+	size_t block_size;
+	aoff64_t file_size;
+	size_t ops;
+	size_t depth;
+} bench_params_t;
+
+typedef struct bench_run bench_run_t;
+
+/** Perform a single operation of a pass.
+ *
+ * @param run	Benchmark run
+ * @param idx	Number of the operation within the pass
+ * @param buf	Worker buffer of block_size bytes
+ * @param bytes	Place to store the number of bytes transferred
+ */
+typedef errno_t (*bench_op_t)(bench_run_t *, size_t, void *, size_t *);
+
+/** State of a benchmark run, shared by the worker fibrils */
+struct bench_run {
+	bench_params_t *params;
+	/** File used by the file workloads */
+	int fd;
+	/** Size of the file in blocks */
+	size_t blocks;
+
+	fibril_mutex_t lock;
+	fibril_condvar_t done_cv;
+	/** Operation of the current pass */
+	bench_op_t op;
+	/** Number of operations in the current pass */
+	size_t pass_ops;
+	/** Next operation to hand out */
+	size_t next;
+	/** Number of workers still running */
+	size_t running;
+	/** First error encountered */
+	errno_t rc;
+
+	/** Total operations and bytes */
+	size_t ops;
+	uint64_t bytes;
+	/** Latencies of all operations in microseconds */
+	uint32_t *lat;
+	size_t lat_size;
+};
+
+/** Benchmark test */
+typedef struct {
+	const char *name;
+	/** Prepare the run, not measured */
+	errno_t (*setup)(bench_run_t *);
+	/** The measured part */
+	errno_t (*run)(bench_run_t *);
+	/** Clean up after the run, not measured */
+	void (*cleanup)(bench_run_t *);
+	/** Number of operations the run performs, NULL if not known */
+	size_t (*expected_ops)(bench_run_t *);
+} bench_test_t;
+
 static void syntax_print(void);
 
-static errno_t measure(measure_func_t fn, void* data, umseconds_t *result)
+/** Mix operation number into a pseudo-random value (splitmix64). */
+static uint64_t bench_mix(uint64_t x)
 {
-	struct timeval start_time;
-	gettimeofday(&start_time, NULL);
-	
-	errno_t rc = fn(data);
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+static void bench_record(bench_run_t *run, suseconds_t usec, size_t bytes)
+{
+	assert(fibril_mutex_is_locked(&run->lock));
+
+	if (run->ops >= run->lat_size && run->lat != NULL) {
+		size_t size = max(2 * run->lat_size, LAT_INITIAL);
+		uint32_t *lat = realloc(run->lat, size * sizeof(uint32_t));
+		if (lat != NULL) {
+			run->lat = lat;
+			run->lat_size = size;
+		}
+	}
+
+	/* Without memory, latencies of further operations are not kept. */
+	if (run->ops < run->lat_size)
+		run->lat[run->ops] = (uint32_t) usec;
+	run->ops++;
+	run->bytes += bytes;
+}
+
+static errno_t bench_worker(void *arg)
+{
+	bench_run_t *run = (bench_run_t *) arg;
+	struct timeval start;
+	struct timeval end;
+	size_t bytes;
+	size_t idx;
+	errno_t rc = EOK;
+
+	void *buf = malloc(run->params->block_size);
+	if (buf == NULL)
+		rc = ENOMEM;
+	else
+		memset(buf, 0xa5, run->params->block_size);
+
+	fibril_mutex_lock(&run->lock);
+
+	while (rc == EOK && run->rc == EOK && run->next < run->pass_ops) {
+		idx = run->next++;
+		fibril_mutex_unlock(&run->lock);
+
+		bytes = 0;
+		getuptime(&start);
+		rc = run->op(run, idx, buf, &bytes);
+		getuptime(&end);
+
+		fibril_mutex_lock(&run->lock);
+		if (rc == EOK)
+			bench_record(run, tv_sub_diff(&end, &start), bytes);
+	}
+
+	if (rc != EOK && run->rc == EOK)
+		run->rc = rc;
+
+	run->running--;
+	fibril_condvar_broadcast(&run->done_cv);
+	fibril_mutex_unlock(&run->lock);
+
+	free(buf);
+	return EOK;
+}
+
+/** Run one pass of operations with queue depth concurrent workers.
+ *
+ * @param run	Benchmark run
+ * @param op	Operation
+ * @param ops	Number of operations in the pass
+ */
+static errno_t bench_pass(bench_run_t *run, bench_op_t op, size_t ops)
+{
+	size_t depth = min(run->params->depth, max(ops, 1));
+	size_t i;
+
+	fibril_mutex_lock(&run->lock);
+	run->op = op;
+	run->pass_ops = ops;
+	run->next = 0;
+	run->running = 0;
+
+	for (i = 0; i < depth; i++) {
+		fid_t fid = fibril_create(bench_worker, run);
+		if (fid == 0) {
+			if (run->rc == EOK)
+				run->rc = ENOMEM;
+			break;
+		}
+
+		run->running++;
+		fibril_add_ready(fid);
+	}
+
+	while (run->running > 0)
+		fibril_condvar_wait(&run->done_cv, &run->lock);
+
+	errno_t rc = run->rc;
+	fibril_mutex_unlock(&run->lock);
+
+	return rc;
+}
+
+static errno_t bench_open(bench_run_t *run, int flags, int mode)
+{
+	errno_t rc = vfs_lookup_open(run->params->path, WALK_REGULAR | flags,
+	    mode, &run->fd);
 	if (rc != EOK) {
-		fprintf(stderr, "measured function failed\n");
+		fprintf(stderr, "Failed opening file: %s\n", run->params->path);
 		return rc;
 	}
-	
-	struct timeval final_time;
-	gettimeofday(&final_time, NULL);
-	
-	/* Calculate time difference in milliseconds */
-	*result = ((final_time.tv_usec - start_time.tv_usec) / 1000) +
-	    ((final_time.tv_sec - start_time.tv_sec) * 1000);
+
 	return EOK;
 }
 
-static errno_t sequential_read_file(void *data)
+static void bench_close(bench_run_t *run)
 {
-	char *path = (char *) data;
-	char *buf = malloc(BUFSIZE);
-	
-	if (buf == NULL)
-		return ENOMEM;
-	
-	FILE *file = fopen(path, "r");
-	if (file == NULL) {
-		fprintf(stderr, "Failed opening file: %s\n", path);
-		free(buf);
-		return EIO;
+	if (run->fd >= 0) {
+		vfs_put(run->fd);
+		run->fd = -1;
 	}
-	
-	while (!feof(file)) {
-		fread(buf, 1, BUFSIZE, file);
-		if (ferror(file)) {
-			fprintf(stderr, "Failed reading file\n");
-			fclose(file);
-			free(buf);
-			return EIO;
-		}
+}
+
+/** Open existing file for the read workloads. */
+static errno_t read_setup(bench_run_t *run)
+{
+	vfs_stat_t st;
+	errno_t rc;
+
+	rc = bench_open(run, 0, MODE_READ);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_stat(run->fd, &st);
+	if (rc != EOK)
+		return rc;
+
+	run->blocks = (st.size + run->params->block_size - 1) /
+	    run->params->block_size;
+	if (run->blocks == 0) {
+		fprintf(stderr, "File is empty: %s\n", run->params->path);
+		return EINVAL;
 	}
-	
-	fclose(file);
-	free(buf);
+
 	return EOK;
 }
 
-static errno_t sequential_read_dir(void *data)
+/** Create file of the requested size for the write workloads. */
+static errno_t write_setup(bench_run_t *run)
+{
+	errno_t rc;
+
+	rc = bench_open(run, WALK_MAY_CREATE, MODE_READ | MODE_WRITE);
+	if (rc != EOK)
+		return rc;
+
+	run->blocks = run->params->file_size / run->params->block_size;
+	if (run->blocks == 0) {
+		fprintf(stderr, "File size smaller than block size.\n");
+		return EINVAL;
+	}
+
+	return vfs_resize(run->fd, run->blocks * run->params->block_size);
+}
+
+/** Start sequential writes with an empty file. */
+static errno_t seq_write_setup(bench_run_t *run)
+{
+	errno_t rc;
+
+	rc = write_setup(run);
+	if (rc != EOK)
+		return rc;
+
+	return vfs_resize(run->fd, 0);
+}
+
+static errno_t block_read(bench_run_t *run, size_t block, void *buf,
+    size_t *bytes)
+{
+	aoff64_t pos = (aoff64_t) block * run->params->block_size;
+
+	return vfs_read(run->fd, &pos, buf, run->params->block_size, bytes);
+}
+
+static errno_t block_write(bench_run_t *run, size_t block, void *buf,
+    size_t *bytes)
+{
+	aoff64_t pos = (aoff64_t) block * run->params->block_size;
+
+	return vfs_write(run->fd, &pos, buf, run->params->block_size, bytes);
+}
+
+static errno_t seq_read_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	return block_read(run, idx, buf, bytes);
+}
+
+static errno_t seq_write_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	return block_write(run, idx, buf, bytes);
+}
+
+static errno_t rand_read_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	return block_read(run, bench_mix(idx) % run->blocks, buf, bytes);
+}
+
+static errno_t rand_write_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	return block_write(run, bench_mix(idx) % run->blocks, buf, bytes);
+}
+
+static errno_t fsync_write_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	errno_t rc;
+
+	rc = block_write(run, idx % run->blocks, buf, bytes);
+	if (rc != EOK)
+		return rc;
+
+	return vfs_sync(run->fd);
+}
+
+static errno_t sequential_read_file(bench_run_t *run)
+{
+	(void) vfs_advise(run->fd, VFS_ADVICE_SEQUENTIAL);
+	return bench_pass(run, seq_read_op, run->blocks);
+}
+
+static errno_t sequential_write_file(bench_run_t *run)
+{
+	return bench_pass(run, seq_write_op, run->blocks);
+}
+
+static errno_t random_read_file(bench_run_t *run)
 {
-	char *path = (char *) data;
+	(void) vfs_advise(run->fd, VFS_ADVICE_RANDOM);
+	return bench_pass(run, rand_read_op, run->params->ops);
+}
+
+static errno_t random_write_file(bench_run_t *run)
+{
+	(void) vfs_advise(run->fd, VFS_ADVICE_RANDOM);
+	return bench_pass(run, rand_write_op, run->params->ops);
+}
+
+static errno_t fsync_write_file(bench_run_t *run)
+{
+	return bench_pass(run, fsync_write_op, run->params->ops);
+}
+
+static errno_t meta_path(bench_run_t *run, size_t idx, char **path)
+{
+	if (asprintf(path, "%s/" NAME "-%zu", run->params->path, idx) < 0)
+		return ENOMEM;
+
+	return EOK;
+}
+
+static errno_t meta_create_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	char *path;
+	int fd;
+	errno_t rc;
+
+	rc = meta_path(run, idx, &path);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_lookup_open(path, WALK_REGULAR | WALK_MUST_CREATE,
+	    MODE_WRITE, &fd);
+	free(path);
+	if (rc != EOK)
+		return rc;
+
+	return vfs_put(fd);
+}
+
+static errno_t meta_stat_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	vfs_stat_t st;
+	char *path;
+	errno_t rc;
+
+	rc = meta_path(run, idx, &path);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_stat_path(path, &st);
+	free(path);
+	return rc;
+}
+
+static errno_t meta_unlink_op(bench_run_t *run, size_t idx, void *buf,
+    size_t *bytes)
+{
+	char *path;
+	errno_t rc;
+
+	rc = meta_path(run, idx, &path);
+	if (rc != EOK)
+		return rc;
+
+	rc = vfs_unlink_path(path);
+	free(path);
+	return rc;
+}
+
+/** Create, stat and unlink files in a directory.
+ *
+ * Each phase is completed for all files before the next one starts, so
+ * the directory really grows to the requested number of entries.
+ */
+static errno_t metadata_dir(bench_run_t *run)
+{
+	errno_t rc;
+
+	rc = bench_pass(run, meta_create_op, run->params->ops);
+	if (rc != EOK)
+		return rc;
+
+	rc = bench_pass(run, meta_stat_op, run->params->ops);
+	if (rc != EOK)
+		return rc;
+
+	return bench_pass(run, meta_unlink_op, run->params->ops);
+}
+
+/** Remove files possibly left behind by a failed metadata run. */
+static void metadata_cleanup(bench_run_t *run)
+{
+	char *path;
+	size_t i;
+
+	for (i = 0; i < run->params->ops; i++) {
+		if (meta_path(run, i, &path) != EOK)
+			return;
+		(void) vfs_unlink_path(path);
+		free(path);
+	}
+}
+
+static errno_t sequential_read_dir(bench_run_t *run)
+{
+	struct timeval start;
+	struct timeval end;
+	char *path = (char *) run->params->path;
 	
 	DIR *dir = opendir(path);
 	if (dir == NULL) {
@@ -121,41 +511,256 @@ static errno_t sequential_read_dir(void *data)
 
 	struct dirent *dp;
 	
-	while ((dp = readdir(dir))) {
-		/* Do nothing */
+	while (true) {
+		getuptime(&start);
+		dp = readdir(dir);
+		getuptime(&end);
+		if (dp == NULL)
+			break;
+
+		fibril_mutex_lock(&run->lock);
+		bench_record(run, tv_sub_diff(&end, &start), 0);
+		fibril_mutex_unlock(&run->lock);
 	}
 	
 	closedir(dir);
 	return EOK;
 }
 
+static size_t file_blocks_ops(bench_run_t *run)
+{
+	return run->blocks;
+}
+
+static size_t params_ops(bench_run_t *run)
+{
+	return run->params->ops;
+}
+
+static size_t metadata_ops(bench_run_t *run)
+{
+	/* Create, stat and unlink each file. */
+	return 3 * run->params->ops;
+}
+
+static bench_test_t tests[] = {
+	{
+		.name = "sequential-file-read",
+		.setup = read_setup,
+		.run = sequential_read_file,
+		.cleanup = bench_close,
+		.expected_ops = file_blocks_ops
+	},
+	{
+		.name = "sequential-file-write",
+		.setup = seq_write_setup,
+		.run = sequential_write_file,
+		.cleanup = bench_close,
+		.expected_ops = file_blocks_ops
+	},
+	{
+		.name = "random-file-read",
+		.setup = read_setup,
+		.run = random_read_file,
+		.cleanup = bench_close,
+		.expected_ops = params_ops
+	},
+	{
+		.name = "random-file-write",
+		.setup = write_setup,
+		.run = random_write_file,
+		.cleanup = bench_close,
+		.expected_ops = params_ops
+	},
+	{
+		.name = "fsync-file-write",
+		.setup = write_setup,
+		.run = fsync_write_file,
+		.cleanup = bench_close,
+		.expected_ops = params_ops
+	},
+	{
+		.name = "metadata-dir",
+		.run = metadata_dir,
+		.cleanup = metadata_cleanup,
+		.expected_ops = metadata_ops
+	},
+	{
+		.name = "sequential-dir-read",
+		.run = sequential_read_dir
+	},
+	{
+		.name = NULL
+	}
+};
+
+static int lat_cmp(const void *a, const void *b)
+{
+	uint32_t la = *(const uint32_t *) a;
+	uint32_t lb = *(const uint32_t *) b;
+
+	return (la > lb) - (la < lb);
+}
+
+/** Get latency percentile of the run.
+ *
+ * @param run	Benchmark run with sorted latencies
+ * @param pct	Percentile (0 to 100)
+ */
+static uint32_t lat_percentile(bench_run_t *run, unsigned pct)
+{
+	size_t n = min(run->ops, run->lat_size);
+
+	if (n == 0)
+		return 0;
+
+	return run->lat[((n - 1) * pct) / 100];
+}
+
+static errno_t measure(bench_test_t *test, bench_run_t *run,
+    umseconds_t *result)
+{
+	errno_t rc;
+
+	if (test->setup != NULL) {
+		rc = test->setup(run);
+		if (rc != EOK)
+			goto out;
+	}
+
+	/* The array grows if the number of operations is not known. */
+	run->lat_size = LAT_INITIAL;
+	if (test->expected_ops != NULL && test->expected_ops(run) > 0)
+		run->lat_size = test->expected_ops(run);
+
+	run->lat = calloc(run->lat_size, sizeof(uint32_t));
+	if (run->lat == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	struct timeval start_time;
+	gettimeofday(&start_time, NULL);
+
+	rc = test->run(run);
+	if (rc != EOK) {
+		fprintf(stderr, "measured function failed\n");
+		goto out;
+	}
+
+	struct timeval final_time;
+	gettimeofday(&final_time, NULL);
+
+	/* Calculate time difference in milliseconds */
+	*result = ((final_time.tv_usec - start_time.tv_usec) / 1000) +
+	    ((final_time.tv_sec - start_time.tv_sec) * 1000);
+
+	qsort(run->lat, min(run->ops, run->lat_size), sizeof(uint32_t),
+	    lat_cmp);
+out:
+	if (test->cleanup != NULL)
+		test->cleanup(run);
+	return rc;
+}
+
+static errno_t parse_size(const char *str, uint64_t *result)
+{
+	const char *end;
+	uint64_t val;
+	errno_t rc;
+
+	rc = str_uint64_t(str, &end, 10, false, &val);
+	if (rc != EOK)
+		return rc;
+
+	switch (*end) {
+	case 'k':
+	case 'K':
+		val *= 1024;
+		end++;
+		break;
+	case 'm':
+	case 'M':
+		val *= MBYTE;
+		end++;
+		break;
+	case 'g':
+	case 'G':
+		val *= 1024 * MBYTE;
+		end++;
+		break;
+	}
+
+	if (*end != '\0' || val == 0)
+		return EINVAL;
+
+	*result = val;
+	return EOK;
+}
+
 int main(int argc, char **argv)
 {
 	errno_t rc;
 	umseconds_t milliseconds_taken = 0;
-	char *path = NULL;
-	measure_func_t fn = NULL;
+	bench_params_t params;
+	bench_test_t *test;
+	bench_run_t run;
 	int iteration;
 	int iterations;
 	char *log_str = NULL;
 	char *test_type = NULL;
 	char *endptr;
+	uint64_t val;
+	int c;
 	
-	if (argc < 5) {
+	params.block_size = DEFAULT_BLOCK_SIZE;
+	params.file_size = DEFAULT_FILE_SIZE;
+	params.ops = DEFAULT_OPS;
+	params.depth = 1;
+
+	while ((c = getopt(argc, argv, "b:s:n:q:")) != -1) {
+		rc = parse_size(optarg, &val);
+		if (rc != EOK) {
+			fprintf(stderr, NAME ": Error, invalid value of "
+			    "option -%c.\n", c);
+			syntax_print();
+			return 1;
+		}
+
+		switch (c) {
+		case 'b':
+			params.block_size = val;
+			break;
+		case 's':
+			params.file_size = val;
+			break;
+		case 'n':
+			params.ops = val;
+			break;
+		case 'q':
+			params.depth = min(val, MAX_DEPTH);
+			break;
+		default:
+			syntax_print();
+			return 1;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 4) {
 		fprintf(stderr, NAME ": Error, argument missing.\n");
 		syntax_print();
 		return 1;
 	}
 	
-	if (argc > 5) {
+	if (argc > 4) {
 		fprintf(stderr, NAME ": Error, too many arguments.\n");
 		syntax_print();
 		return 1;
 	}
 	
-	// Skip program name
-	--argc; ++argv;
-
 	iterations = strtol(*argv, &endptr, 10);
 	if (*endptr != '\0') {
 		printf(NAME ": Error, invalid argument (iterations).\n");
@@ -170,28 +775,40 @@ int main(int argc, char **argv)
 	log_str = *argv;
 
 	--argc; ++argv;
-	path = *argv;
+	params.path = *argv;
 	
-	if (str_cmp(test_type, "sequential-file-read") == 0) {
-		fn = sequential_read_file;
+	for (test = tests; test->name != NULL; test++) {
+		if (str_cmp(test_type, test->name) == 0)
+			break;
 	}
-	else if (str_cmp(test_type, "sequential-dir-read") == 0) {
-		fn = sequential_read_dir;
-	}
-	else {
+
+	if (test->name == NULL) {
 		fprintf(stderr, "Error, unknown test type\n");
 		syntax_print();
 		return 1;
 	}
 
 	for (iteration = 0; iteration < iterations; iteration++) {
-		rc = measure(fn, path, &milliseconds_taken);
+		memset(&run, 0, sizeof(run));
+		run.params = &params;
+		run.fd = -1;
+		fibril_mutex_initialize(&run.lock);
+		fibril_condvar_initialize(&run.done_cv);
+
+		rc = measure(test, &run, &milliseconds_taken);
 		if (rc != EOK) {
 			fprintf(stderr, "Error: %s\n", str_error(rc));
+			free(run.lat);
 			return 1;
 		}
 	
-		printf("%s;%s;%s;%lu;ms\n", test_type, path, log_str, milliseconds_taken);
+		printf("%s;%s;%s;%lu;ms;%zu;ops;%" PRIu64 ";B;%" PRIu32 ";%"
+		    PRIu32 ";%" PRIu32 ";%" PRIu32 ";us\n", test_type,
+		    params.path, log_str, milliseconds_taken, run.ops, run.bytes,
+		    lat_percentile(&run, 50), lat_percentile(&run, 90),
+		    lat_percentile(&run, 99), lat_percentile(&run, 100));
+
+		free(run.lat);
 	}
 
 	return 0;
@@ -200,13 +817,29 @@ int main(int argc, char **argv)
 
 static void syntax_print(void)
 {
-	fprintf(stderr, "syntax: " NAME " <iterations> <test type> <log-str> <path>\n");
+	fprintf(stderr, "syntax: " NAME " [<options>] <iterations> <test type> <log-str> <path>\n");
 	fprintf(stderr, "  <iterations>    number of times to run a given test\n");
 	fprintf(stderr, "  <test-type>     one of:\n");
 	fprintf(stderr, "                    sequential-file-read\n");
+	fprintf(stderr, "                    sequential-file-write\n");
+	fprintf(stderr, "                    random-file-read\n");
+	fprintf(stderr, "                    random-file-write\n");
+	fprintf(stderr, "                    fsync-file-write\n");
+	fprintf(stderr, "                    metadata-dir\n");
 	fprintf(stderr, "                    sequential-dir-read\n");
 	fprintf(stderr, "  <log-str>       a string to attach to results\n");
 	fprintf(stderr, "  <path>          file/directory to use for testing\n");
+	fprintf(stderr, "options (sizes accept K, M and G suffixes):\n");
+	fprintf(stderr, "  -b <size>       size of a single request (default %u)\n",
+	    DEFAULT_BLOCK_SIZE);
+	fprintf(stderr, "  -s <size>       file size for write tests (default %u)\n",
+	    DEFAULT_FILE_SIZE);
+	fprintf(stderr, "  -n <count>      operations of random, fsync and "
+	    "metadata tests (default %u)\n", DEFAULT_OPS);
+	fprintf(stderr, "  -q <depth>      number of requests in flight "
+	    "(default 1, max %u)\n", MAX_DEPTH);
+	fprintf(stderr, "output: <test>;<path>;<log-str>;<time>;ms;<ops>;ops;"
+	    "<bytes>;B;<p50>;<p90>;<p99>;<max>;us\n");
 }
 
 /**
@@ -36,11 +36,15 @@
  */
 
 #include <dlfcn.h>
+#include <errno.h>
 #include <libdltest.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+#include <task.h>
 
 /** libdltest library handle */
 static void *handle;
@@ -48,6 +52,11 @@ static void *handle;
 /** If true, do not run dlfcn tests */
 static bool no_dlfcn = false;
 
+/** Number of program spawns in startup benchmark */
+#define BENCH_SPAWNS 20
+/** Number of dlsym() calls in symbol lookup benchmark */
+#define BENCH_LOOKUPS 10000
+
 /** Test dlsym() function */
 static bool test_dlsym(void)
 {
@@ -945,14 +954,81 @@ static int test_lnk(void)
 
 #endif /* DLTEST_LINKED */
 
+/** Measure program startup time and symbol lookup time.
+ *
+ * Startup time is measured by repeatedly spawning this program with
+ * the @c -e option, which makes it exit right away. This covers loading
+ * and relocating the program and all its libraries.
+ */
+static int bench_startup(void)
+{
+	struct timeval t0, t1;
+	task_wait_t wait;
+	task_exit_t texit;
+	suseconds_t usec;
+	int retval;
+	unsigned i;
+	errno_t rc;
+
+	printf("Spawning dltest %u times... ", BENCH_SPAWNS);
+
+	getuptime(&t0);
+	for (i = 0; i < BENCH_SPAWNS; i++) {
+		rc = task_spawnl(NULL, &wait, "/app/dltest", "/app/dltest",
+		    "-e", NULL);
+		if (rc != EOK) {
+			printf("FAILED (spawn: %s)\n", str_error(rc));
+			return 1;
+		}
+
+		rc = task_wait(&wait, &texit, &retval);
+		if (rc != EOK || texit != TASK_EXIT_NORMAL || retval != 0) {
+			printf("FAILED (task did not exit normally)\n");
+			return 1;
+		}
+	}
+	getuptime(&t1);
+
+	usec = tv_sub_diff(&t1, &t0);
+	printf("%lld us per startup\n", (long long) usec / BENCH_SPAWNS);
+
+	handle = dlopen("libdltest.so.0", 0);
+	if (handle == NULL) {
+		printf("dlopen() FAILED\n");
+		return 1;
+	}
+
+	printf("Calling dlsym() %u times... ", BENCH_LOOKUPS);
+
+	getuptime(&t0);
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		if (dlsym(handle, "dl_get_constant") == NULL) {
+			printf("FAILED\n");
+			return 1;
+		}
+	}
+	getuptime(&t1);
+
+	usec = tv_sub_diff(&t1, &t0);
+	printf("%lld ns per lookup\n",
+	    (long long) usec * 1000 / BENCH_LOOKUPS);
+
+	return 0;
+}
+
 static void print_syntax(void)
 {
-	fprintf(stderr, "syntax: dltest [-n]\n");
+	fprintf(stderr, "syntax: dltest [-n|-b|-e]\n");
 	fprintf(stderr, "\t-n Do not run dlfcn tests\n");
+	fprintf(stderr, "\t-b Run startup and symbol lookup benchmark\n");
+	fprintf(stderr, "\t-e Exit immediately (used by benchmark)\n");
 }
 
 int main(int argc, char *argv[])
 {
+	if (argc == 2 && str_cmp(argv[1], "-e") == 0)
+		return 0;
+
 	printf("Dynamic linking test\n");
 
 	if (argc > 1) {
@@ -963,6 +1039,8 @@ int main(int argc, char *argv[])
 
 		if (str_cmp(argv[1], "-n") == 0) {
 			no_dlfcn = true;
+		} else if (str_cmp(argv[1], "-b") == 0) {
+			return bench_startup();
 		} else {
 			print_syntax();
 			return 1;
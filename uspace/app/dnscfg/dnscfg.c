@@ -53,6 +53,7 @@ static void print_syntax(void)
 	printf("\t%s get-ns\n", NAME);
 	printf("\t%s set-ns <server-addr>\n", NAME);
 	printf("\t%s unset-ns\n", NAME);
+	printf("\t%s flush-cache\n", NAME);
 }
 
 static errno_t dnscfg_set_ns(int argc, char *argv[])
@@ -104,6 +105,18 @@ static errno_t dnscfg_unset_ns(void)
 	return EOK;
 }
 
+static errno_t dnscfg_flush_cache(void)
+{
+	errno_t rc = dnsr_cache_flush();
+	if (rc != EOK) {
+		printf("%s: Failed flushing DNS cache (%s)\n",
+		    NAME, str_error(rc));
+		return rc;
+	}
+	
+	return EOK;
+}
+
 static errno_t dnscfg_print(void)
 {
 	inet_addr_t addr;
@@ -133,6 +146,8 @@ int main(int argc, char *argv[])
 		return dnscfg_set_ns(argc - 2, argv + 2);
 	else if (str_cmp(argv[1], "unset-ns") == 0)
 		return dnscfg_unset_ns();
+	else if (str_cmp(argv[1], "flush-cache") == 0)
+		return dnscfg_flush_cache();
 	else {
 		printf("%s: Unknown command '%s'.\n", NAME, argv[1]);
 		print_syntax();
@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <inet/addr.h>
 #include <inet/dnsr.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str.h>
@@ -44,6 +45,37 @@
 static void print_syntax(void)
 {
 	printf("Syntax: %s [-4|-6] <host-name>\n", NAME);
+	printf("        %s -s\n", NAME);
+}
+
+static errno_t dnsres_print_stats(void)
+{
+	dnsr_cache_stats_t stats;
+	errno_t rc = dnsr_get_cache_stats(&stats);
+	if (rc != EOK) {
+		printf("%s: Error getting cache statistics.\n", NAME);
+		return rc;
+	}
+	
+	uint64_t lookups = stats.hits + stats.neg_hits + stats.misses +
+	    stats.coalesced;
+	
+	printf("Cache entries: %zu\n", stats.entries);
+	printf("Lookups: %" PRIu64 "\n", lookups);
+	printf("Hits: %" PRIu64 " (negative: %" PRIu64 ")\n",
+	    stats.hits + stats.neg_hits, stats.neg_hits);
+	printf("Misses: %" PRIu64 "\n", stats.misses);
+	printf("Coalesced: %" PRIu64 "\n", stats.coalesced);
+	printf("Refreshed: %" PRIu64 "\n", stats.refreshes);
+	printf("Expired: %" PRIu64 "\n", stats.expired);
+	printf("Evicted: %" PRIu64 "\n", stats.evicted);
+	
+	if (lookups > 0) {
+		printf("Hit ratio: %" PRIu64 "%%\n",
+		    (stats.hits + stats.neg_hits) * 100 / lookups);
+	}
+	
+	return EOK;
 }
 
 int main(int argc, char *argv[])
@@ -53,6 +85,9 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 	
+	if ((argc == 2) && (str_cmp(argv[1], "-s") == 0))
+		return dnsres_print_stats();
+	
 	uint16_t ver;
 	char *hname;
 	
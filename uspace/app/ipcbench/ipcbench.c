@@ -0,0 +1,593 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup ipcbench IPC benchmark
+ * @brief Measure latency and throughput of IPC primitives.
+ * @{
+ */
+/**
+ * @file
+ *
+ * Every test runs a number of round trips against the ipcbench-echo
+ * server from each worker and records the latency of every round trip.
+ * Workers are fibrils of the main thread and separate threads, each with
+ * its own connection to the server. Latencies are measured in CPU cycles
+ * where the cycle counter is readable from user space, in microseconds
+ * otherwise.
+ */
+
+#include <as.h>
+#include <async.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <ipc/ipcbench.h>
+#include <ipc/services.h>
+#include <libarch/cycle.h>
+#include <loc.h>
+#include <macros.h>
+#include <mem.h>
+#include <stats.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+#include <task.h>
+#include <thread.h>
+
+#define NAME  "ipcbench"
+
+#define ECHO_SERVER  "/srv/ipcbench-echo"
+
+/** Default number of round trips per worker */
+#define DEFAULT_ITERATIONS  10000
+/** Round trips per worker not included in the results */
+#define WARMUP_ITERATIONS  100
+/** Maximum number of workers of each kind */
+#define MAX_WORKERS  64
+/** Number of log2 histogram buckets */
+#define HIST_BUCKETS  64
+
+typedef struct ipcbench_worker ipcbench_worker_t;
+typedef errno_t (*ipcbench_op_t)(ipcbench_worker_t *);
+
+/** Benchmark test */
+typedef struct {
+	const char *name;
+	ipcbench_op_t op;
+	/** Transfer sizes to run the test with, zero-terminated */
+	const size_t *sizes;
+} ipcbench_test_t;
+
+/** Run of one test by all workers */
+typedef struct {
+	fibril_mutex_t lock;
+	fibril_condvar_t done_cv;
+	/** Number of workers still running */
+	size_t running;
+	/** First error encountered */
+	errno_t rc;
+} ipcbench_run_t;
+
+/** Worker issuing round trips over its own connection */
+struct ipcbench_worker {
+	ipcbench_run_t *run;
+	async_sess_t *sess;
+	ipcbench_op_t op;
+	/** Transfer size */
+	size_t size;
+	/** Data transfer buffer */
+	void *buf;
+	/** Area shared out to the server */
+	void *area;
+	/** Latency of each round trip */
+	uint64_t *samples;
+	size_t iterations;
+};
+
+static service_id_t echo_sid;
+static bool use_cycles;
+
+static size_t no_sizes[] = { 0, 0 };
+static size_t data_sizes[] = { 16, 256, 4096, IPCBENCH_DATA_MAX, 0 };
+static size_t share_sizes[] = { 4096, IPCBENCH_DATA_MAX, 0 };
+
+static uint64_t ipcbench_now(void)
+{
+	struct timeval tv;
+
+	if (use_cycles)
+		return get_cycle();
+
+	getuptime(&tv);
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static errno_t op_ping(ipcbench_worker_t *worker)
+{
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	errno_t rc = async_req_0_0(exch, IPCBENCH_PING);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+static errno_t op_echo(ipcbench_worker_t *worker)
+{
+	sysarg_t r1, r2, r3, r4, r5;
+
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	errno_t rc = async_req_5_5(exch, IPCBENCH_ECHO, 1, 2, 3, 4, 5,
+	    &r1, &r2, &r3, &r4, &r5);
+	async_exchange_end(exch);
+
+	if (rc == EOK && (r1 != 1 || r2 != 2 || r3 != 3 || r4 != 4 || r5 != 5))
+		rc = EIO;
+
+	return rc;
+}
+
+static errno_t op_data_read(ipcbench_worker_t *worker)
+{
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	aid_t req = async_send_0(exch, IPCBENCH_DATA_READ, NULL);
+	errno_t rc = async_data_read_start(exch, worker->buf, worker->size);
+	async_exchange_end(exch);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return (rc != EOK) ? rc : retval;
+}
+
+static errno_t op_data_write(ipcbench_worker_t *worker)
+{
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	aid_t req = async_send_0(exch, IPCBENCH_DATA_WRITE, NULL);
+	errno_t rc = async_data_write_start(exch, worker->buf, worker->size);
+	async_exchange_end(exch);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return (rc != EOK) ? rc : retval;
+}
+
+static errno_t op_share_in(ipcbench_worker_t *worker)
+{
+	void *dst;
+
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	aid_t req = async_send_0(exch, IPCBENCH_SHARE_IN, NULL);
+	errno_t rc = async_share_in_start_0_0(exch, worker->size, &dst);
+	async_exchange_end(exch);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	if (rc == EOK)
+		as_area_destroy(dst);
+
+	return (rc != EOK) ? rc : retval;
+}
+
+static errno_t op_share_out(ipcbench_worker_t *worker)
+{
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	aid_t req = async_send_0(exch, IPCBENCH_SHARE_OUT, NULL);
+	errno_t rc = async_share_out_start(exch, worker->area,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	async_exchange_end(exch);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return (rc != EOK) ? rc : retval;
+}
+
+static errno_t op_forward(ipcbench_worker_t *worker)
+{
+	async_exch_t *exch = async_exchange_begin(worker->sess);
+	errno_t rc = async_req_0_0(exch, IPCBENCH_FORWARD);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+static ipcbench_test_t tests[] = {
+	{ "ping", op_ping, no_sizes },
+	{ "echo5", op_echo, no_sizes },
+	{ "data-read", op_data_read, data_sizes },
+	{ "data-write", op_data_write, data_sizes },
+	{ "share-in", op_share_in, share_sizes },
+	{ "share-out", op_share_out, share_sizes },
+	{ "forward", op_forward, no_sizes },
+	{ NULL, NULL, NULL }
+};
+
+static void ipcbench_worker_run(ipcbench_worker_t *worker)
+{
+	ipcbench_run_t *run = worker->run;
+	errno_t rc = EOK;
+	uint64_t start;
+	size_t i;
+
+	for (i = 0; i < WARMUP_ITERATIONS && rc == EOK; i++)
+		rc = worker->op(worker);
+
+	for (i = 0; i < worker->iterations && rc == EOK; i++) {
+		start = ipcbench_now();
+		rc = worker->op(worker);
+		worker->samples[i] = ipcbench_now() - start;
+	}
+
+	fibril_mutex_lock(&run->lock);
+	if (rc != EOK && run->rc == EOK)
+		run->rc = rc;
+	run->running--;
+	fibril_condvar_broadcast(&run->done_cv);
+	fibril_mutex_unlock(&run->lock);
+}
+
+static errno_t ipcbench_worker_fibril(void *arg)
+{
+	ipcbench_worker_run((ipcbench_worker_t *) arg);
+	return EOK;
+}
+
+static void ipcbench_worker_thread(void *arg)
+{
+	ipcbench_worker_run((ipcbench_worker_t *) arg);
+}
+
+static errno_t ipcbench_worker_init(ipcbench_worker_t *worker,
+    ipcbench_run_t *run, ipcbench_op_t op, size_t size, uint64_t *samples,
+    size_t iterations)
+{
+	memset(worker, 0, sizeof(ipcbench_worker_t));
+	worker->run = run;
+	worker->op = op;
+	worker->size = size;
+	worker->samples = samples;
+	worker->iterations = iterations;
+	worker->area = AS_MAP_FAILED;
+
+	worker->sess = loc_service_connect(echo_sid, INTERFACE_DDF, 0);
+	if (worker->sess == NULL)
+		return EIO;
+
+	if (size > 0) {
+		worker->buf = calloc(1, size);
+		if (worker->buf == NULL)
+			return ENOMEM;
+
+		worker->area = as_area_create(AS_AREA_ANY, size,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    AS_AREA_UNPAGED);
+		if (worker->area == AS_MAP_FAILED)
+			return ENOMEM;
+	}
+
+	return EOK;
+}
+
+static void ipcbench_worker_fini(ipcbench_worker_t *worker)
+{
+	if (worker->area != AS_MAP_FAILED)
+		as_area_destroy(worker->area);
+	free(worker->buf);
+	if (worker->sess != NULL)
+		async_hangup(worker->sess);
+}
+
+static int sample_cmp(const void *a, const void *b)
+{
+	uint64_t sa = *(const uint64_t *) a;
+	uint64_t sb = *(const uint64_t *) b;
+
+	return (sa > sb) - (sa < sb);
+}
+
+/** Print results of a test.
+ *
+ * The summary line and the log2 histogram are semicolon-separated so that
+ * the output of different runs can be compared by scripts.
+ */
+static void ipcbench_report(const char *name, size_t size, size_t threads,
+    size_t fibrils, uint64_t *samples, size_t count, uint64_t usec)
+{
+	const char *unit = use_cycles ? "cycles" : "us";
+	size_t hist[HIST_BUCKETS];
+	size_t last = 0;
+	size_t i;
+
+	qsort(samples, count, sizeof(uint64_t), sample_cmp);
+
+	printf("%s;%zu;%zu;%zu;%zu;ops;%" PRIu64 ";ops/s;%" PRIu64 ";%"
+	    PRIu64 ";%" PRIu64 ";%s\n", name, size, threads, fibrils, count,
+	    (usec > 0) ? (uint64_t) count * 1000000 / usec : 0,
+	    samples[(count - 1) / 2], samples[((count - 1) * 99) / 100],
+	    samples[count - 1], unit);
+
+	/* Bucket b holds samples in [2^(b-1), 2^b), bucket 0 holds zeros. */
+	memset(hist, 0, sizeof(hist));
+	for (i = 0; i < count; i++) {
+		size_t b = 0;
+		uint64_t v = samples[i];
+
+		while (v != 0 && b < HIST_BUCKETS - 1) {
+			v >>= 1;
+			b++;
+		}
+
+		hist[b]++;
+		last = max(last, b);
+	}
+
+	printf("%s;%zu;hist;%s", name, size, unit);
+	for (i = 0; i <= last; i++)
+		printf(";%zu", hist[i]);
+	printf("\n");
+}
+
+static errno_t ipcbench_test_run(ipcbench_test_t *test, size_t size,
+    size_t threads, size_t fibrils, size_t iterations)
+{
+	size_t nworkers = threads + fibrils;
+	ipcbench_worker_t *workers;
+	uint64_t *samples;
+	ipcbench_run_t run;
+	struct timeval start;
+	struct timeval end;
+	size_t i;
+	errno_t rc = EOK;
+
+	workers = calloc(nworkers, sizeof(ipcbench_worker_t));
+	samples = calloc(nworkers * iterations, sizeof(uint64_t));
+	if (workers == NULL || samples == NULL) {
+		free(workers);
+		free(samples);
+		return ENOMEM;
+	}
+
+	fibril_mutex_initialize(&run.lock);
+	fibril_condvar_initialize(&run.done_cv);
+	run.running = 0;
+	run.rc = EOK;
+
+	for (i = 0; i < nworkers; i++) {
+		rc = ipcbench_worker_init(&workers[i], &run, test->op, size,
+		    &samples[i * iterations], iterations);
+		if (rc != EOK) {
+			nworkers = i + 1;
+			goto out;
+		}
+	}
+
+	gettimeofday(&start, NULL);
+
+	fibril_mutex_lock(&run.lock);
+
+	for (i = 0; i < nworkers; i++) {
+		if (i < threads) {
+			thread_id_t tid;
+
+			rc = thread_create(ipcbench_worker_thread, &workers[i],
+			    NAME, &tid);
+		} else {
+			fid_t fid = fibril_create(ipcbench_worker_fibril,
+			    &workers[i]);
+			rc = (fid != 0) ? EOK : ENOMEM;
+			if (rc == EOK)
+				fibril_add_ready(fid);
+		}
+
+		if (rc != EOK)
+			break;
+
+		run.running++;
+	}
+
+	while (run.running > 0)
+		fibril_condvar_wait(&run.done_cv, &run.lock);
+
+	if (rc == EOK)
+		rc = run.rc;
+
+	fibril_mutex_unlock(&run.lock);
+
+	gettimeofday(&end, NULL);
+
+	if (rc == EOK) {
+		ipcbench_report(test->name, size, threads, fibrils, samples,
+		    nworkers * iterations, tv_sub_diff(&end, &start));
+	}
+
+out:
+	for (i = 0; i < nworkers; i++)
+		ipcbench_worker_fini(&workers[i]);
+
+	free(workers);
+	free(samples);
+	return rc;
+}
+
+/** Connect to the echo server, start it if it is not running. */
+static errno_t ipcbench_echo_start(task_id_t *task)
+{
+	errno_t rc;
+
+	*task = 0;
+
+	rc = loc_service_get_id(SERVICE_NAME_IPCBENCH, &echo_sid, 0);
+	if (rc == EOK)
+		return EOK;
+
+	rc = task_spawnl(task, NULL, ECHO_SERVER, ECHO_SERVER, NULL);
+	if (rc != EOK) {
+		fprintf(stderr, "Failed starting %s: %s\n", ECHO_SERVER,
+		    str_error(rc));
+		return rc;
+	}
+
+	return loc_service_get_id(SERVICE_NAME_IPCBENCH, &echo_sid,
+	    IPC_FLAG_BLOCKING);
+}
+
+static void print_syntax(void)
+{
+	ipcbench_test_t *test;
+
+	printf("Syntax: %s [-n <iterations>] [-t <threads>] [-f <fibrils>] "
+	    "[<test> ...]\n", NAME);
+	printf("  -n <iterations>  round trips per worker (default %u)\n",
+	    DEFAULT_ITERATIONS);
+	printf("  -t <threads>     workers running in separate threads "
+	    "(default 0)\n");
+	printf("  -f <fibrils>     workers running as fibrils of the main "
+	    "thread (default 1)\n");
+	printf("Tests (default all):");
+	for (test = tests; test->name != NULL; test++)
+		printf(" %s", test->name);
+	printf("\n");
+	printf("Output: <test>;<size>;<threads>;<fibrils>;<count>;ops;<rate>;"
+	    "ops/s;<p50>;<p99>;<max>;<unit>\n");
+	printf("        <test>;<size>;hist;<unit>;<log2 buckets>...\n");
+}
+
+int main(int argc, char *argv[])
+{
+	size_t iterations = DEFAULT_ITERATIONS;
+	size_t threads = 0;
+	size_t fibrils = 1;
+	ipcbench_test_t *test;
+	task_id_t echo_task;
+	size_t ncpus = 0;
+	const size_t *size;
+	errno_t rc;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:t:f:")) != -1) {
+		size_t *val;
+
+		switch (c) {
+		case 'n':
+			val = &iterations;
+			break;
+		case 't':
+			val = &threads;
+			break;
+		case 'f':
+			val = &fibrils;
+			break;
+		default:
+			print_syntax();
+			return 1;
+		}
+
+		rc = str_size_t(optarg, NULL, 10, true, val);
+		if (rc != EOK) {
+			printf("Invalid value of option -%c.\n", c);
+			print_syntax();
+			return 1;
+		}
+	}
+
+	if (iterations == 0 || threads > MAX_WORKERS || fibrils > MAX_WORKERS ||
+	    threads + fibrils == 0) {
+		printf("Invalid number of iterations or workers.\n");
+		print_syntax();
+		return 1;
+	}
+
+	for (c = optind; c < argc; c++) {
+		for (test = tests; test->name != NULL; test++) {
+			if (str_cmp(argv[c], test->name) == 0)
+				break;
+		}
+
+		if (test->name == NULL) {
+			printf("Unknown test '%s'.\n", argv[c]);
+			print_syntax();
+			return 1;
+		}
+	}
+
+	/* The cycle counter reads as zero where it is not available. */
+	use_cycles = get_cycle() != 0;
+
+	stats_cpu_t *cpus = stats_get_cpus(&ncpus);
+	free(cpus);
+
+	rc = ipcbench_echo_start(&echo_task);
+	if (rc != EOK) {
+		printf("Echo server not available: %s\n", str_error(rc));
+		return 2;
+	}
+
+	printf("# %s: cpus=%zu unit=%s iterations=%zu\n", NAME, ncpus,
+	    use_cycles ? "cycles" : "us", iterations);
+
+	for (test = tests; test->name != NULL; test++) {
+		bool selected = (optind == argc);
+
+		for (c = optind; c < argc; c++) {
+			if (str_cmp(argv[c], test->name) == 0)
+				selected = true;
+		}
+
+		if (!selected)
+			continue;
+
+		size = test->sizes;
+		do {
+			rc = ipcbench_test_run(test, *size, threads, fibrils,
+			    iterations);
+			if (rc != EOK) {
+				printf("Test %s failed: %s\n", test->name,
+				    str_error(rc));
+				goto out;
+			}
+		} while (*(++size) != 0);
+	}
+
+out:
+	if (echo_task != 0)
+		task_kill(echo_task);
+
+	return (rc == EOK) ? 0 : 2;
+}
+
+/** @}
+ */
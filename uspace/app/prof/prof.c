@@ -0,0 +1,598 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup prof Sampling profiler
+ * @brief Statistical profiling of tasks and the kernel.
+ * @{
+ */
+/**
+ * @file
+ *
+ * The kernel samples the interrupted task, thread and a short kernel and
+ * user stack on every CPU from the clock interrupt. This tool collects the
+ * samples for a while, resolves kernel addresses through the kernel symbol
+ * table and user addresses through the ELF symbol table of the task's
+ * executable, and prints either a flat profile of the functions the CPUs
+ * were executing, or folded stacks for flame graph tools.
+ */
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <async.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <profile.h>
+#include <qsort.h>
+#include <stats.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <symtab.h>
+#include <sysinfo.h>
+
+#define NAME  "prof"
+
+#define DEFAULT_DURATION  5
+
+/** Interval between draining the kernel buffers */
+#define DRAIN_INTERVAL  100000
+
+#define DRAIN_SAMPLES  64
+
+/** Maximum length of a folded stack */
+#define STACK_BUF_SIZE  2048
+
+/** Known task */
+typedef struct {
+	link_t link;
+	task_id_t id;
+	char name[TASK_NAME_BUFLEN];
+	/** Symbol table of the task's executable, NULL if not found */
+	symtab_t *symtab;
+	bool symtab_loaded;
+} prof_task_t;
+
+/** Symbol cache key */
+typedef struct {
+	task_id_t task_id;
+	uintptr_t addr;
+	bool kernel;
+} sym_key_t;
+
+/** Symbol cache entry */
+typedef struct {
+	ht_link_t link;
+	sym_key_t key;
+	char *name;
+} sym_entry_t;
+
+/** Aggregated line of output */
+typedef struct {
+	char *key;
+	size_t count;
+} prof_line_t;
+
+static profile_sample_t *samples = NULL;
+static size_t samples_count = 0;
+static size_t samples_alloc = 0;
+
+static LIST_INITIALIZE(tasks);
+static hash_table_t sym_cache;
+
+static size_t sym_key_hash(void *arg)
+{
+	sym_key_t *key = (sym_key_t *) arg;
+
+	return hash_combine(hash_mix(key->addr),
+	    hash_combine(hash_mix(key->task_id), key->kernel));
+}
+
+static size_t sym_hash(const ht_link_t *item)
+{
+	sym_entry_t *entry = hash_table_get_inst(item, sym_entry_t, link);
+	return sym_key_hash(&entry->key);
+}
+
+static bool sym_key_equal(void *arg, const ht_link_t *item)
+{
+	sym_key_t *key = (sym_key_t *) arg;
+	sym_entry_t *entry = hash_table_get_inst(item, sym_entry_t, link);
+
+	return key->addr == entry->key.addr &&
+	    key->task_id == entry->key.task_id &&
+	    key->kernel == entry->key.kernel;
+}
+
+static bool sym_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	sym_entry_t *entry = hash_table_get_inst(item1, sym_entry_t, link);
+	return sym_key_equal(&entry->key, item2);
+}
+
+static void sym_remove(ht_link_t *item)
+{
+	sym_entry_t *entry = hash_table_get_inst(item, sym_entry_t, link);
+
+	free(entry->name);
+	free(entry);
+}
+
+static hash_table_ops_t sym_cache_ops = {
+	.hash = sym_hash,
+	.key_hash = sym_key_hash,
+	.key_equal = sym_key_equal,
+	.equal = sym_equal,
+	.remove_callback = sym_remove
+};
+
+static prof_task_t *task_find(task_id_t id)
+{
+	list_foreach(tasks, link, prof_task_t, task) {
+		if (task->id == id)
+			return task;
+	}
+
+	return NULL;
+}
+
+/** Remember the names of all currently running tasks.
+ *
+ * Tasks are remembered for the whole run, so that samples of tasks
+ * which have exited in the meantime can still be attributed.
+ */
+static void tasks_update(void)
+{
+	size_t count;
+	stats_task_t *stats = stats_get_tasks(&count);
+	if (stats == NULL)
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		if (task_find(stats[i].task_id) != NULL)
+			continue;
+
+		prof_task_t *task = calloc(1, sizeof(prof_task_t));
+		if (task == NULL)
+			break;
+
+		task->id = stats[i].task_id;
+		str_cpy(task->name, TASK_NAME_BUFLEN, stats[i].name);
+		list_append(&task->link, &tasks);
+	}
+
+	free(stats);
+}
+
+/** Load the symbol table of the task's executable. */
+static symtab_t *task_symtab(prof_task_t *task)
+{
+	static const char *paths[] = {
+		"/app/%s",
+		"/srv/%s",
+		"/drv/%s/%s"
+	};
+	char *file_name;
+
+	if (task->symtab_loaded)
+		return task->symtab;
+
+	task->symtab_loaded = true;
+
+	for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+		if (asprintf(&file_name, paths[i], task->name, task->name) < 0)
+			break;
+
+		errno_t rc = symtab_load(file_name, &task->symtab);
+		free(file_name);
+		if (rc == EOK)
+			break;
+	}
+
+	return task->symtab;
+}
+
+/** Resolve an address to a function name.
+ *
+ * @param task_id Task the address belongs to.
+ * @param addr    Address.
+ * @param kernel  The address is a kernel address.
+ *
+ * @return Function name or the address itself, NULL if out of memory.
+ */
+static const char *sym_resolve(task_id_t task_id, uintptr_t addr, bool kernel)
+{
+	sym_key_t key = {
+		.task_id = kernel ? 0 : task_id,
+		.addr = addr,
+		.kernel = kernel
+	};
+
+	ht_link_t *item = hash_table_find(&sym_cache, &key);
+	if (item != NULL)
+		return hash_table_get_inst(item, sym_entry_t, link)->name;
+
+	sym_entry_t *entry = malloc(sizeof(sym_entry_t));
+	if (entry == NULL)
+		return NULL;
+
+	entry->key = key;
+	entry->name = NULL;
+
+	if (kernel) {
+		char name[PROFILE_SYMBOL_MAX];
+		size_t offs;
+
+		if (profile_symbol(addr, name, sizeof(name), &offs) == EOK)
+			entry->name = str_dup(name);
+	} else {
+		prof_task_t *task = task_find(task_id);
+		symtab_t *symtab = (task != NULL) ? task_symtab(task) : NULL;
+		char *name;
+		size_t offs;
+
+		if ((symtab != NULL) &&
+		    (symtab_addr_to_name(symtab, addr, &name, &offs) == EOK))
+			entry->name = str_dup(name);
+	}
+
+	if (entry->name == NULL &&
+	    asprintf(&entry->name, "%p", (void *) addr) < 0) {
+		free(entry);
+		return NULL;
+	}
+
+	hash_table_insert(&sym_cache, &entry->link);
+	return entry->name;
+}
+
+/** Return the address of the call instruction for a return address.
+ *
+ * All frames but the innermost one hold return addresses, which may
+ * already lie in the next function if the call was the last instruction.
+ */
+static uintptr_t frame_addr(const uintptr_t *stack, size_t frame)
+{
+	return (frame > 0) ? stack[frame] - 1 : stack[frame];
+}
+
+static const char *sample_task_name(const profile_sample_t *sample)
+{
+	if (sample->flags & PROFILE_SAMPLE_IDLE)
+		return "idle";
+
+	prof_task_t *task = task_find(sample->task_id);
+	return (task != NULL) ? task->name : "?";
+}
+
+static errno_t samples_drain(void)
+{
+	static profile_sample_t buf[DRAIN_SAMPLES];
+	bool unknown_task = false;
+	size_t nread;
+	errno_t rc;
+
+	do {
+		rc = profile_read(buf, DRAIN_SAMPLES, &nread);
+		if (rc != EOK)
+			return rc;
+
+		if (samples_count + nread > samples_alloc) {
+			size_t nalloc = max(2 * samples_alloc,
+			    samples_count + nread);
+			profile_sample_t *nsamples = realloc(samples,
+			    nalloc * sizeof(profile_sample_t));
+			if (nsamples == NULL)
+				return ENOMEM;
+
+			samples = nsamples;
+			samples_alloc = nalloc;
+		}
+
+		for (size_t i = 0; i < nread; i++) {
+			if (!(buf[i].flags & PROFILE_SAMPLE_IDLE) &&
+			    task_find(buf[i].task_id) == NULL)
+				unknown_task = true;
+
+			samples[samples_count++] = buf[i];
+		}
+	} while (nread == DRAIN_SAMPLES);
+
+	/* Learn the names of new tasks while they are still running */
+	if (unknown_task)
+		tasks_update();
+
+	return EOK;
+}
+
+/** Build the flat profile key of a sample.
+ *
+ * The key names the task and the function the CPU was executing.
+ */
+static char *sample_flat_key(const profile_sample_t *sample)
+{
+	const char *sym;
+	const char *mode;
+	char *key;
+
+	if ((sample->flags & PROFILE_SAMPLE_USPACE) && sample->uframes > 0) {
+		sym = sym_resolve(sample->task_id, sample->ustack[0], false);
+		mode = "";
+	} else if (sample->kframes > 0) {
+		sym = sym_resolve(sample->task_id, sample->kstack[0], true);
+		mode = "[k] ";
+	} else
+		return NULL;
+
+	if (sym == NULL)
+		return NULL;
+
+	if (asprintf(&key, "%-20s %s%s", sample_task_name(sample), mode,
+	    sym) < 0)
+		return NULL;
+
+	return key;
+}
+
+/** Build the folded stack of a sample.
+ *
+ * Frames are listed from the outermost user frame to the innermost kernel
+ * frame, kernel frames are annotated with the customary _[k] suffix.
+ */
+static char *sample_folded_key(const profile_sample_t *sample)
+{
+	char buf[STACK_BUF_SIZE];
+	const char *sym;
+
+	str_cpy(buf, sizeof(buf), sample_task_name(sample));
+
+	for (size_t i = sample->uframes; i > 0; i--) {
+		sym = sym_resolve(sample->task_id,
+		    frame_addr(sample->ustack, i - 1), false);
+		if (sym == NULL)
+			return NULL;
+
+		str_append(buf, sizeof(buf), ";");
+		str_append(buf, sizeof(buf), sym);
+	}
+
+	if (!(sample->flags & PROFILE_SAMPLE_USPACE)) {
+		for (size_t i = sample->kframes; i > 0; i--) {
+			sym = sym_resolve(sample->task_id,
+			    frame_addr(sample->kstack, i - 1), true);
+			if (sym == NULL)
+				return NULL;
+
+			str_append(buf, sizeof(buf), ";");
+			str_append(buf, sizeof(buf), sym);
+			str_append(buf, sizeof(buf), "_[k]");
+		}
+	}
+
+	return str_dup(buf);
+}
+
+static int line_key_cmp(const void *a, const void *b)
+{
+	return str_cmp(((const prof_line_t *) a)->key,
+	    ((const prof_line_t *) b)->key);
+}
+
+static int line_count_cmp(const void *a, const void *b)
+{
+	size_t ca = ((const prof_line_t *) a)->count;
+	size_t cb = ((const prof_line_t *) b)->count;
+
+	if (ca != cb)
+		return (ca > cb) ? -1 : 1;
+
+	return line_key_cmp(a, b);
+}
+
+/** Aggregate samples by key and print them.
+ *
+ * @param folded Print folded stacks instead of the flat profile.
+ * @param task_id Only include samples of this task, zero for all tasks.
+ *
+ * @return EOK on success, ENOMEM if out of memory.
+ */
+static errno_t report(bool folded, task_id_t task_id)
+{
+	prof_line_t *lines;
+	size_t nlines = 0;
+	size_t total = 0;
+
+	lines = calloc(max(samples_count, 1), sizeof(prof_line_t));
+	if (lines == NULL)
+		return ENOMEM;
+
+	for (size_t i = 0; i < samples_count; i++) {
+		if (task_id != 0 && samples[i].task_id != task_id)
+			continue;
+
+		char *key = folded ? sample_folded_key(&samples[i]) :
+		    sample_flat_key(&samples[i]);
+		if (key == NULL)
+			continue;
+
+		lines[nlines].key = key;
+		lines[nlines].count = 1;
+		nlines++;
+		total++;
+	}
+
+	/* Merge lines with equal keys */
+	qsort(lines, nlines, sizeof(prof_line_t), line_key_cmp);
+
+	size_t n = 0;
+	for (size_t i = 0; i < nlines; i++) {
+		if (n > 0 && str_cmp(lines[n - 1].key, lines[i].key) == 0) {
+			lines[n - 1].count++;
+			free(lines[i].key);
+			continue;
+		}
+
+		lines[n++] = lines[i];
+	}
+
+	if (folded) {
+		for (size_t i = 0; i < n; i++)
+			printf("%s %zu\n", lines[i].key, lines[i].count);
+	} else {
+		qsort(lines, n, sizeof(prof_line_t), line_count_cmp);
+
+		printf("%8s %7s  %-20s %s\n", "samples", "percent", "task",
+		    "function");
+		for (size_t i = 0; i < n; i++) {
+			uint64_t permille = (uint64_t) lines[i].count * 1000 /
+			    total;
+			printf("%8zu %5" PRIu64 ".%" PRIu64 "%%  %s\n",
+			    lines[i].count, permille / 10, permille % 10,
+			    lines[i].key);
+		}
+	}
+
+	for (size_t i = 0; i < n; i++)
+		free(lines[i].key);
+	free(lines);
+
+	return EOK;
+}
+
+static void print_syntax(void)
+{
+	printf("Syntax: %s [-f <frequency>] [-d <seconds>] [-t <task ID>] "
+	    "[-F]\n", NAME);
+	printf("  -f <frequency>  samples per second and CPU "
+	    "(default and maximum: clock tick rate)\n");
+	printf("  -d <seconds>    duration of the profiling run "
+	    "(default %u)\n", DEFAULT_DURATION);
+	printf("  -t <task ID>    report only samples of this task\n");
+	printf("  -F              print folded stacks for flame graphs "
+	    "instead of a flat profile\n");
+}
+
+int main(int argc, char *argv[])
+{
+	size_t frequency = 0;
+	size_t duration = DEFAULT_DURATION;
+	uint64_t task_id = 0;
+	bool folded = false;
+	errno_t rc;
+	int c;
+
+	while ((c = getopt(argc, argv, "f:d:t:F")) != -1) {
+		switch (c) {
+		case 'f':
+			rc = str_size_t(optarg, NULL, 10, true, &frequency);
+			break;
+		case 'd':
+			rc = str_size_t(optarg, NULL, 10, true, &duration);
+			break;
+		case 't':
+			rc = str_uint64_t(optarg, NULL, 10, true, &task_id);
+			break;
+		case 'F':
+			folded = true;
+			rc = EOK;
+			break;
+		default:
+			print_syntax();
+			return 1;
+		}
+
+		if (rc != EOK) {
+			printf("Invalid value of option -%c.\n", c);
+			print_syntax();
+			return 1;
+		}
+	}
+
+	if (optind != argc) {
+		print_syntax();
+		return 1;
+	}
+
+	if (!hash_table_create(&sym_cache, 0, 0, &sym_cache_ops)) {
+		printf("%s: Out of memory.\n", NAME);
+		return 2;
+	}
+
+	tasks_update();
+
+	rc = profile_start(frequency);
+	if (rc != EOK) {
+		printf("%s: Cannot start profiling: %s.\n", NAME,
+		    str_error(rc));
+		return 2;
+	}
+
+	sysarg_t actual = 0;
+	(void) sysinfo_get_value("profile.frequency", &actual);
+	fprintf(stderr, "Sampling at %" PRIun " Hz for %zu s.\n", actual,
+	    duration);
+
+	for (size_t t = 0; t < duration * 1000000 / DRAIN_INTERVAL; t++) {
+		async_usleep(DRAIN_INTERVAL);
+
+		rc = samples_drain();
+		if (rc != EOK)
+			break;
+	}
+
+	(void) profile_stop();
+	if (rc == EOK)
+		rc = samples_drain();
+
+	if (rc != EOK) {
+		printf("%s: Error reading samples: %s.\n", NAME, str_error(rc));
+		return 2;
+	}
+
+	sysarg_t dropped = 0;
+	(void) sysinfo_get_value("profile.dropped", &dropped);
+	fprintf(stderr, "Collected %zu samples, %" PRIun " dropped.\n",
+	    samples_count, dropped);
+
+	rc = report(folded, task_id);
+	if (rc != EOK) {
+		printf("%s: Out of memory.\n", NAME);
+		return 2;
+	}
+
+	return 0;
+}
+
+/** @}
+ */
@@ -53,6 +53,9 @@
 #define HOUR    3600
 #define MINUTE  60
 
+/** Number of lock classes whose wait histogram is printed */
+#define LOCK_HIST_TOP  5
+
 static void list_tasks(void)
 {
 	size_t count;
@@ -163,6 +166,115 @@ static void list_cpus(void)
 	free(cpus);
 }
 
+static void list_slabs(void)
+{
+	size_t count;
+	stats_slab_t *slabs = stats_get_slabs(&count);
+	
+	if (slabs == NULL) {
+		fprintf(stderr, "%s: Unable to get slab statistics\n", NAME);
+		return;
+	}
+	
+	printf("[cache name        ] [size  ] [slabs ] [alloc ] [cached]"
+	    " [colors] [magsz] [fullmg] [emptmg] [contention]\n");
+	
+	size_t i;
+	for (i = 0; i < count; i++) {
+		printf("%-20s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+		    " %8" PRIu64 " %7" PRIu64 " %8" PRIu64 " %8" PRIu64
+		    " %12" PRIu64 "\n", slabs[i].name, slabs[i].size,
+		    slabs[i].slabs, slabs[i].allocated, slabs[i].cached,
+		    slabs[i].colors, slabs[i].mag_size, slabs[i].magazines,
+		    slabs[i].empty_magazines, slabs[i].contention);
+	}
+	
+	free(slabs);
+}
+
+static int lock_cmp(const void *a, const void *b)
+{
+	const stats_lock_t *la = (const stats_lock_t *) a;
+	const stats_lock_t *lb = (const stats_lock_t *) b;
+	
+	if (la->wait_cycles != lb->wait_cycles)
+		return (la->wait_cycles < lb->wait_cycles) ? 1 : -1;
+	
+	if (la->acquisitions != lb->acquisitions)
+		return (la->acquisitions < lb->acquisitions) ? 1 : -1;
+	
+	return 0;
+}
+
+static const char *lock_type_name(lock_type_t type)
+{
+	switch (type) {
+	case LOCK_TYPE_SPINLOCK:
+		return "spin";
+	case LOCK_TYPE_MUTEX:
+		return "mutex";
+	case LOCK_TYPE_SEMAPHORE:
+		return "sema";
+	case LOCK_TYPE_CONDVAR:
+		return "condvar";
+	}
+	
+	return "?";
+}
+
+static void list_locks(void)
+{
+	size_t count;
+	stats_lock_t *locks = stats_get_locks(&count);
+	
+	if (locks == NULL) {
+		fprintf(stderr, "%s: Unable to get lock statistics "
+		    "(kernel compiled without CONFIG_LOCKSTAT?)\n", NAME);
+		return;
+	}
+	
+	qsort(locks, count, sizeof(stats_lock_t), lock_cmp);
+	
+	printf("[lock class                            ] [type ]"
+	    " [acquired  ] [contended ] [avg wait] [max wait  ]"
+	    " [avg hold] [max hold  ]\n");
+	
+	size_t i;
+	for (i = 0; i < count; i++) {
+		if (locks[i].acquisitions == 0)
+			continue;
+		
+		uint64_t avg_wait = (locks[i].contentions > 0) ?
+		    locks[i].wait_cycles / locks[i].contentions : 0;
+		uint64_t avg_hold = locks[i].hold_cycles / locks[i].acquisitions;
+		
+		printf("%-40s %-7s %12" PRIu64 " %12" PRIu64 " %10" PRIu64
+		    " %12" PRIu64 " %10" PRIu64 " %12" PRIu64 "\n",
+		    locks[i].name, lock_type_name(locks[i].type),
+		    locks[i].acquisitions, locks[i].contentions, avg_wait,
+		    locks[i].wait_max, avg_hold, locks[i].hold_max);
+	}
+	
+	/* Wait time distribution of the most contended classes */
+	for (i = 0; (i < count) && (i < LOCK_HIST_TOP); i++) {
+		if (locks[i].contentions == 0)
+			break;
+		
+		printf("\nWait cycles of %s:\n", locks[i].name);
+		
+		unsigned int b;
+		for (b = 0; b < LOCK_HIST_BUCKETS; b++) {
+			if (locks[i].wait_hist[b] == 0)
+				continue;
+			
+			printf("  < 4^%-2u %12" PRIu64 "\n", b + 1,
+			    locks[i].wait_hist[b]);
+		}
+	}
+	
+	free(locks);
+}
+
 static void print_load(void)
 {
 	size_t count;
@@ -201,7 +313,7 @@ static void print_uptime(void)
 static void usage(const char *name)
 {
 	printf(
-	    "Usage: %s [-t task_id] [-a] [-c] [-l] [-u]\n" \
+	    "Usage: %s [-t task_id] [-a] [-c] [-s] [-k] [-l] [-u]\n" \
 	    "\n" \
 	    "Options:\n" \
 	    "\t-t task_id\n" \
@@ -216,6 +328,14 @@ static void usage(const char *name)
 	    "\t--cpus\n" \
 	    "\t\tList CPUs\n" \
 	    "\n" \
+	    "\t-s\n" \
+	    "\t--slabs\n" \
+	    "\t\tList kernel slab caches\n" \
+	    "\n" \
+	    "\t-k\n" \
+	    "\t--locks\n" \
+	    "\t\tList kernel lock contention statistics\n" \
+	    "\n" \
 	    "\t-l\n" \
 	    "\t--load\n" \
 	    "\t\tPrint system load\n" \
@@ -239,6 +359,8 @@ int main(int argc, char *argv[])
 	bool toggle_threads = false;
 	bool toggle_all = false;
 	bool toggle_cpus = false;
+	bool toggle_slabs = false;
+	bool toggle_locks = false;
 	bool toggle_load = false;
 	bool toggle_uptime = false;
 	
@@ -269,6 +391,20 @@ int main(int argc, char *argv[])
 			continue;
 		}
 		
+		/* Slab caches */
+		if ((off = arg_parse_short_long(argv[i], "-s", "--slabs")) != -1) {
+			toggle_tasks = false;
+			toggle_slabs = true;
+			continue;
+		}
+		
+		/* Lock statistics */
+		if ((off = arg_parse_short_long(argv[i], "-k", "--locks")) != -1) {
+			toggle_tasks = false;
+			toggle_locks = true;
+			continue;
+		}
+		
 		/* Threads */
 		if ((off = arg_parse_short_long(argv[i], "-t", "--task=")) != -1) {
 			// TODO: Support for 64b range
@@ -310,6 +446,12 @@ int main(int argc, char *argv[])
 	if (toggle_cpus)
 		list_cpus();
 	
+	if (toggle_slabs)
+		list_slabs();
+	
+	if (toggle_locks)
+		list_locks();
+	
 	if (toggle_load)
 		print_load();
 	
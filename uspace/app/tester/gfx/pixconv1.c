@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <mem.h>
+#include <sys/time.h>
+#include <io/pixel.h>
+#include <pixconv.h>
+#include "../tester.h"
+
+/** Dimensions of the converted screen */
+#define SCREEN_WIDTH   1920
+#define SCREEN_HEIGHT  1080
+
+/** Number of full-screen updates measured per visual */
+#define ROUNDS  5
+
+typedef struct {
+	const char *name;
+	pixel2visual_t pixel2visual;
+	pixel2visual_row_t pixel2visual_row;
+	size_t pixel_bytes;
+	/** Byte of each pixel that is not compared (unused channel), or -1 */
+	int ignore;
+} pixconv_visual_t;
+
+static pixconv_visual_t visuals[] = {
+	{ "RGB 0888", pixel2rgb_0888, pixel2rgb_0888_row, 4, 0 },
+	{ "BGR 0888", pixel2bgr_0888, pixel2bgr_0888_row, 4, 0 },
+	{ "RGB 8880", pixel2rgb_8880, pixel2rgb_8880_row, 4, 3 },
+	{ "BGR 8880", pixel2bgr_8880, pixel2bgr_8880_row, 4, 3 },
+	{ "RGB 888", pixel2rgb_888, pixel2rgb_888_row, 3, -1 },
+	{ "BGR 888", pixel2bgr_888, pixel2bgr_888_row, 3, -1 },
+	{ "RGB 565 LE", pixel2rgb_565_le, pixel2rgb_565_le_row, 2, -1 },
+	{ "RGB 565 BE", pixel2rgb_565_be, pixel2rgb_565_be_row, 2, -1 },
+	{ "RGB 555 LE", pixel2rgb_555_le, pixel2rgb_555_le_row, 2, -1 },
+	{ "RGB 555 BE", pixel2rgb_555_be, pixel2rgb_555_be_row, 2, -1 },
+	{ "BGR 323", pixel2bgr_323, pixel2bgr_323_row, 1, -1 }
+};
+
+/** Convert the screen pixel by pixel, as the framebuffer drivers used to */
+static void convert_pixels(pixconv_visual_t *vis, uint8_t *dst,
+    pixel_t *src)
+{
+	for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+		for (size_t x = 0; x < SCREEN_WIDTH; x++) {
+			vis->pixel2visual(dst + (y * SCREEN_WIDTH + x) *
+			    vis->pixel_bytes, src[y * SCREEN_WIDTH + x]);
+		}
+	}
+}
+
+/** Convert the screen row by row */
+static void convert_rows(pixconv_visual_t *vis, uint8_t *dst, pixel_t *src)
+{
+	for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+		vis->pixel2visual_row(dst + y * SCREEN_WIDTH * vis->pixel_bytes,
+		    src + y * SCREEN_WIDTH, SCREEN_WIDTH);
+	}
+}
+
+static bool compare(pixconv_visual_t *vis, uint8_t *a, uint8_t *b)
+{
+	size_t size = SCREEN_WIDTH * SCREEN_HEIGHT * vis->pixel_bytes;
+
+	for (size_t i = 0; i < size; i++) {
+		if (vis->ignore >= 0 &&
+		    (int) (i % vis->pixel_bytes) == vis->ignore)
+			continue;
+
+		if (a[i] != b[i])
+			return false;
+	}
+
+	return true;
+}
+
+const char *test_pixconv1(void)
+{
+	size_t npixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+	const char *err = NULL;
+
+	pixel_t *src = malloc(npixels * sizeof(pixel_t));
+	uint8_t *ref = malloc(npixels * sizeof(pixel_t));
+	uint8_t *dst = malloc(npixels * sizeof(pixel_t));
+	if (src == NULL || ref == NULL || dst == NULL) {
+		err = "Failed allocating buffers";
+		goto out;
+	}
+
+	uint32_t seed = 12345;
+	for (size_t i = 0; i < npixels; i++) {
+		seed = seed * 1103515245 + 12345;
+		src[i] = seed;
+	}
+
+	TPRINTF("Full-screen update of %ux%u pixels, average of %u rounds\n",
+	    SCREEN_WIDTH, SCREEN_HEIGHT, ROUNDS);
+
+	for (size_t i = 0; i < sizeof(visuals) / sizeof(visuals[0]); i++) {
+		pixconv_visual_t *vis = &visuals[i];
+		struct timeval t0, t1, t2;
+
+		getuptime(&t0);
+		for (unsigned r = 0; r < ROUNDS; r++)
+			convert_pixels(vis, ref, src);
+		getuptime(&t1);
+		for (unsigned r = 0; r < ROUNDS; r++)
+			convert_rows(vis, dst, src);
+		getuptime(&t2);
+
+		TPRINTF("%-12s per pixel %7lld us, per row %7lld us\n",
+		    vis->name,
+		    (long long) tv_sub_diff(&t1, &t0) / ROUNDS,
+		    (long long) tv_sub_diff(&t2, &t1) / ROUNDS);
+
+		if (!compare(vis, ref, dst)) {
+			err = "Row conversion differs from pixel conversion";
+			goto out;
+		}
+	}
+
+out:
+	free(src);
+	free(ref);
+	free(dst);
+	return err;
+}
@@ -39,11 +39,10 @@
 
 const char text[] = "Hello world!";
 
-int fd;
-
 static void *create_paged_area(size_t size)
 {
 	size_t nwr;
+	int fd;
 	errno_t rc;
 
 	TPRINTF("Creating temporary file...\n");
@@ -71,14 +70,23 @@ static void *create_paged_area(size_t size)
 		return NULL;
 	}
 	
+	sysarg_t pager_id;
+	rc = vfs_pager_ref(fd, &pager_id);
+	if (rc != EOK) {
+		vfs_put(fd);
+		return NULL;
+	}
+	
 	TPRINTF("Creating AS area...\n");
 	
 	void *result = async_as_area_create(AS_AREA_ANY, size,
-	    AS_AREA_READ | AS_AREA_CACHEABLE, vfs_pager_sess, fd, 0, 0);
-	if (result == AS_MAP_FAILED) {
-		vfs_put(fd);
+	    AS_AREA_READ | AS_AREA_CACHEABLE, vfs_pager_sess, pager_id, 0, 0);
+	
+	/* The area does not need the file handle */
+	vfs_put(fd);
+	
+	if (result == AS_MAP_FAILED)
 		return NULL;
-	}
 	
 	return result;
 }
@@ -104,7 +112,6 @@ const char *test_pager1(void)
 	touch_area(buffer, buffer_len);
 
 	as_area_destroy(buffer);	
-	vfs_put(fd);
 	
 	return NULL;
 }
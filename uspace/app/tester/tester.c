@@ -76,6 +76,7 @@ test_t tests[] = {
 #include "mm/pager1.def"
 #include "hw/serial/serial1.def"
 #include "chardev/chardev1.def"
+#include "gfx/pixconv1.def"
 	{NULL, NULL, NULL, false}
 };
 
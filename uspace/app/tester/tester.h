@@ -110,6 +110,7 @@ extern const char *test_serial1(void);
 extern const char *test_devman1(void);
 extern const char *test_devman2(void);
 extern const char *test_chardev1(void);
+extern const char *test_pixconv1(void);
 
 extern test_t tests[];
 
@@ -31,7 +31,9 @@
  */
 
 #include <as.h>
+#include <assert.h>
 #include <errno.h>
+#include <macros.h>
 #include <stdio.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -116,8 +118,7 @@ static errno_t write_blocks(ddf_fun_t *, uint64_t, size_t, void *);
 
 static errno_t ahci_identify_device(sata_dev_t *);
 static errno_t ahci_set_highest_ultra_dma_mode(sata_dev_t *);
-static errno_t ahci_rb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
-static errno_t ahci_wb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
+static errno_t ahci_rw_fpdma(sata_dev_t *, uint64_t, size_t, uint8_t *, bool);
 
 static void ahci_sata_devices_create(ahci_dev_t *, ddf_dev_t *);
 static ahci_dev_t *ahci_ahci_create(ddf_dev_t *);
@@ -229,32 +230,7 @@ static errno_t read_blocks(ddf_fun_t *fun, uint64_t blocknum,
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
 	
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate read buffer.");
-		return rc;
-	}
-	
-	memset(buf, 0, sata->block_size);
-	
-	fibril_mutex_lock(&sata->lock);
-	
-	for (size_t cur = 0; cur < count; cur++) {
-		rc = ahci_rb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-		
-		memcpy((void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    ibuf, sata->block_size);
-	}
-	
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-	
-	return rc;
+	return ahci_rw_fpdma(sata, blocknum, count, (uint8_t *) buf, false);
 }
 
 /** Write data blocks into SATA device.
@@ -272,148 +248,207 @@ static errno_t write_blocks(ddf_fun_t *fun, uint64_t blocknum,
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
 	
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	errno_t rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate write buffer.");
-		return rc;
-	}
-	
-	fibril_mutex_lock(&sata->lock);
-	
-	for (size_t cur = 0; cur < count; cur++) {
-		memcpy(ibuf, (void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    sata->block_size);
-		rc = ahci_wb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-	}
-	
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-	
-	return rc;
+	return ahci_rw_fpdma(sata, blocknum, count, (uint8_t *) buf, true);
 }
 
 /*----------------------------------------------------------------------------*/
 /*-- AHCI Commands -----------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 
-/** Wait for interrupt event.
+/** Allocate a free command slot.
+ *
+ * Must be called with the device lock held.
  *
  * @param sata SATA device structure.
+ * @param wait Wait for a slot to become free if there is none.
  *
- * @return Value of interrupt state register.
+ * @return Number of the allocated slot or AHCI_MAX_SLOTS if there
+ *         is no free slot and @a wait is false.
  *
  */
-static ahci_port_is_t ahci_wait_event(sata_dev_t *sata)
+static unsigned int ahci_slot_get(sata_dev_t *sata, bool wait)
 {
-	fibril_mutex_lock(&sata->event_lock);
-	
-	sata->event_pxis = 0;
-	while (sata->event_pxis == 0)
-		fibril_condvar_wait(&sata->event_condvar, &sata->event_lock);
+	while (sata->free_slots == 0) {
+		if (!wait)
+			return AHCI_MAX_SLOTS;
+		
+		fibril_condvar_wait(&sata->slot_cv, &sata->lock);
+	}
 	
-	ahci_port_is_t pxis = sata->event_pxis;
+	unsigned int slot = 0;
+	while ((sata->free_slots & (1U << slot)) == 0)
+		slot++;
 	
-	if (ahci_port_is_permanent_error(pxis))
-		sata->is_invalid_device = true;
+	sata->free_slots &= ~(1U << slot);
+	return slot;
+}
+
+/** Return a command slot to the free slots.
+ *
+ * Must be called with the device lock held.
+ *
+ * @param sata SATA device structure.
+ * @param slot Slot to free.
+ *
+ */
+static void ahci_slot_put(sata_dev_t *sata, unsigned int slot)
+{
+	sata->free_slots |= 1U << slot;
+	fibril_condvar_signal(&sata->slot_cv);
+}
+
+/** Fill command header and PRDT of a command slot.
+ *
+ * The data buffer is described by as many PRDT entries as needed to keep
+ * each of them within the byte count limit of a single entry.
+ *
+ * @param sata  SATA device structure.
+ * @param slot  Command slot.
+ * @param phys  Physical address of data buffer.
+ * @param size  Size of data buffer.
+ * @param flags Command header flags.
+ *
+ */
+static void ahci_cmd_prepare(sata_dev_t *sata, unsigned int slot,
+    uintptr_t phys, size_t size, uint16_t flags)
+{
+	volatile ahci_cmd_prdt_t *prdt =
+	    (ahci_cmd_prdt_t *) (&sata->slots[slot].cmd_table[0x20]);
 	
-	fibril_mutex_unlock(&sata->event_lock);
+	unsigned int entries = 0;
+	while (size > 0) {
+		size_t chunk = min(size, (size_t) AHCI_PRD_MAX_BYTES);
+		
+		assert(entries < AHCI_PRDT_MAX);
+		prdt[entries].data_address_low = LO(phys);
+		prdt[entries].data_address_upper = HI(phys);
+		prdt[entries].reserved1 = 0;
+		prdt[entries].dbc = chunk - 1;
+		prdt[entries].reserved2 = 0;
+		prdt[entries].ioc = 0;
+		
+		phys += chunk;
+		size -= chunk;
+		entries++;
+	}
 	
-	return pxis;
+	volatile ahci_cmdhdr_t *hdr = &sata->cmd_header[slot];
+	hdr->prdtl = entries;
+	hdr->flags = AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK | flags;
+	hdr->bytesprocessed = 0;
 }
 
-/** Set AHCI registers for identifying SATA device.
+/** Issue the command prepared in a command slot.
+ *
+ * Must be called with the device lock held.
  *
  * @param sata SATA device structure.
- * @param phys Physical address of working buffer.
+ * @param slot Command slot.
+ * @param ncq  The command is a native queued command.
  *
  */
-static void ahci_identify_device_cmd(sata_dev_t *sata, uintptr_t phys)
+static void ahci_slot_issue(sata_dev_t *sata, unsigned int slot, bool ncq)
 {
-	volatile sata_std_command_frame_t *cmd =
-	    (sata_std_command_frame_t *) sata->cmd_table;
+	sata->slots[slot].done = false;
+	sata->slots[slot].error = false;
+	sata->active_slots |= 1U << slot;
 	
-	cmd->fis_type = SATA_CMD_FIS_TYPE;
-	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0xec;
-	cmd->features = 0;
-	cmd->lba_lower = 0;
-	cmd->device = 0;
-	cmd->lba_upper = 0;
-	cmd->features_upper = 0;
-	cmd->count = 0;
-	cmd->reserved1 = 0;
-	cmd->control = 0;
-	cmd->reserved2 = 0;
+	if (ncq)
+		sata->port->pxsact = 1U << slot;
 	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-	
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = SATA_IDENTIFY_DEVICE_BUFFER_LENGTH - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
-	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_2DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
-	
-	/* Run command. */
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	sata->port->pxci = 1U << slot;
 }
 
-/** Set AHCI registers for identifying packet SATA device.
+/** Wait for completion of the command issued in a command slot.
+ *
+ * Must be called with the device lock held.
  *
  * @param sata SATA device structure.
- * @param phys Physical address of working buffer.
+ * @param slot Command slot.
+ * @param pxis Place to store interrupt state the command completed with
+ *             or NULL.
+ *
+ * @return EOK if the command succeeded, EINTR otherwise.
+ *
+ */
+static errno_t ahci_slot_wait(sata_dev_t *sata, unsigned int slot,
+    ahci_port_is_t *pxis)
+{
+	ahci_slot_t *s = &sata->slots[slot];
+	
+	while (!s->done)
+		fibril_condvar_wait(&s->done_cv, &sata->lock);
+	
+	if (pxis != NULL)
+		*pxis = s->pxis;
+	
+	return s->error ? EINTR : EOK;
+}
+
+/** Prepare a standard (non-queued) command in a command slot.
+ *
+ * @param sata     SATA device structure.
+ * @param slot     Command slot.
+ * @param command  ATA command.
+ * @param features Features register value.
+ * @param count    Count register value.
+ * @param phys     Physical address of working buffer.
+ * @param size     Size of working buffer.
  *
  */
-static void ahci_identify_packet_device_cmd(sata_dev_t *sata, uintptr_t phys)
+static void ahci_std_cmd(sata_dev_t *sata, unsigned int slot, uint8_t command,
+    uint8_t features, uint16_t count, uintptr_t phys, size_t size)
 {
 	volatile sata_std_command_frame_t *cmd =
-	    (sata_std_command_frame_t *) sata->cmd_table;
+	    (sata_std_command_frame_t *) sata->slots[slot].cmd_table;
 	
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0xa1;
-	cmd->features = 0;
+	cmd->command = command;
+	cmd->features = features;
 	cmd->lba_lower = 0;
 	cmd->device = 0;
 	cmd->lba_upper = 0;
 	cmd->features_upper = 0;
-	cmd->count = 0;
+	cmd->count = count;
 	cmd->reserved1 = 0;
 	cmd->control = 0;
 	cmd->reserved2 = 0;
 	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-	
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = SATA_IDENTIFY_DEVICE_BUFFER_LENGTH - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
-	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_2DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
-	
-	/* Run command. */
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	ahci_cmd_prepare(sata, slot, phys, size, AHCI_CMDHDR_FLAGS_2DWCMD);
+}
+
+/** Run a standard command and wait for its completion.
+ *
+ * Standard commands cannot be mixed with native queued commands. They are
+ * only used while the device is being initialized and nothing else runs.
+ *
+ * @param sata     SATA device structure.
+ * @param command  ATA command.
+ * @param features Features register value.
+ * @param count    Count register value.
+ * @param phys     Physical address of working buffer.
+ * @param size     Size of working buffer.
+ *
+ * @return Interrupt state the command has completed with.
+ *
+ */
+static ahci_port_is_t ahci_std_cmd_run(sata_dev_t *sata, uint8_t command,
+    uint8_t features, uint16_t count, uintptr_t phys, size_t size)
+{
+	ahci_port_is_t pxis;
+	
+	fibril_mutex_lock(&sata->lock);
+	
+	unsigned int slot = ahci_slot_get(sata, true);
+	ahci_std_cmd(sata, slot, command, features, count, phys, size);
+	ahci_slot_issue(sata, slot, false);
+	(void) ahci_slot_wait(sata, slot, &pxis);
+	ahci_slot_put(sata, slot);
+	
+	fibril_mutex_unlock(&sata->lock);
+	
+	return pxis;
 }
 
 /** Fill device identification in SATA device structure.
@@ -443,10 +478,8 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 	
 	memset(idata, 0, SATA_IDENTIFY_DEVICE_BUFFER_LENGTH);
 	
-	fibril_mutex_lock(&sata->lock);
-	
-	ahci_identify_device_cmd(sata, phys);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	ahci_port_is_t pxis = ahci_std_cmd_run(sata, 0xec, 0, 0, phys,
+	    SATA_IDENTIFY_DEVICE_BUFFER_LENGTH);
 	
 	if (sata->is_invalid_device) {
 		ddf_msg(LVL_ERROR,
@@ -455,8 +488,8 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 	}
 	
 	if (ahci_port_is_tfes(pxis)) {
-		ahci_identify_packet_device_cmd(sata, phys);
-		pxis = ahci_wait_event(sata);
+		pxis = ahci_std_cmd_run(sata, 0xa1, 0, 0, phys,
+		    SATA_IDENTIFY_DEVICE_BUFFER_LENGTH);
 		
 		if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
 			ddf_msg(LVL_ERROR,
@@ -478,6 +511,14 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 		goto error;
 	}
 	
+	/*
+	 * Queue as many commands as both the HBA and the device can take.
+	 * The queue depth reported by the device is zero-based.
+	 */
+	ahci_ghc_cap_t cap;
+	cap.u32 = sata->ahci->memregs->ghc.cap;
+	sata->slot_count = min(cap.ncs, idata->queue_depth & 0x1f) + 1;
+	
 	uint16_t logsec = idata->physical_logic_sector_size;
 	if ((logsec & 0xc000) == 0x4000) {
 		/* Length of sector may be larger than 512 B */
@@ -539,64 +580,16 @@ static errno_t ahci_identify_device(sata_dev_t *sata)
 		}
 	}
 	
-	fibril_mutex_unlock(&sata->lock);
 	dmamem_unmap_anonymous(idata);
 	
 	return EOK;
-	
+
 error:
-	fibril_mutex_unlock(&sata->lock);
 	dmamem_unmap_anonymous(idata);
 	
 	return EINTR;
 }
 
-/** Set AHCI registers for setting SATA device transfer mode.
- *
- * @param sata SATA device structure.
- * @param phys Physical address of working buffer.
- * @param mode Required mode.
- *
- */
-static void ahci_set_mode_cmd(sata_dev_t *sata, uintptr_t phys, uint8_t mode)
-{
-	volatile sata_std_command_frame_t *cmd =
-	    (sata_std_command_frame_t *) sata->cmd_table;
-	
-	cmd->fis_type = SATA_CMD_FIS_TYPE;
-	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0xef;
-	cmd->features = 0x03;
-	cmd->lba_lower = 0;
-	cmd->device = 0;
-	cmd->lba_upper = 0;
-	cmd->features_upper = 0;
-	cmd->count = mode;
-	cmd->reserved1 = 0;
-	cmd->control = 0;
-	cmd->reserved2 = 0;
-	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-	
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = SATA_SET_FEATURE_BUFFER_LENGTH - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
-	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_2DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
-	
-	/* Run command. */
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
-}
-
 /** Set highest ultra DMA mode supported by SATA device.
  *
  * @param sata SATA device structure.
@@ -637,11 +630,9 @@ static errno_t ahci_set_highest_ultra_dma_mode(sata_dev_t *sata)
 	
 	memset(idata, 0, SATA_SET_FEATURE_BUFFER_LENGTH);
 	
-	fibril_mutex_lock(&sata->lock);
-	
 	uint8_t mode = 0x40 | (sata->highest_udma_mode & 0x07);
-	ahci_set_mode_cmd(sata, phys, mode);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	ahci_port_is_t pxis = ahci_std_cmd_run(sata, 0xef, 0x03, mode, phys,
+	    SATA_SET_FEATURE_BUFFER_LENGTH);
 	
 	if (sata->is_invalid_device) {
 		ddf_msg(LVL_ERROR,
@@ -656,35 +647,38 @@ static errno_t ahci_set_highest_ultra_dma_mode(sata_dev_t *sata)
 		goto error;
 	}
 	
-	fibril_mutex_unlock(&sata->lock);
 	dmamem_unmap_anonymous(idata);
 	
 	return EOK;
-	
+
 error:
-	fibril_mutex_unlock(&sata->lock);
 	dmamem_unmap_anonymous(idata);
 	
 	return EINTR;
 }
 
-/** Set AHCI registers for reading one sector from the SATA device using FPDMA.
+/** Prepare an FPDMA read or write in a command slot.
+ *
+ * The data are transferred from or to the DMA buffer of the slot. The slot
+ * number doubles as the NCQ tag of the command.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param slot     Command slot.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
+ * @param write    Write to the device rather than read from it.
  *
  */
-static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_fpdma_cmd(sata_dev_t *sata, unsigned int slot,
+    uint64_t blocknum, size_t count, bool write)
 {
 	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	    (sata_ncq_command_frame_t *) sata->slots[slot].cmd_table;
 	
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x60;
-	cmd->tag = 0;
+	cmd->command = write ? 0x61 : 0x60;
+	cmd->tag = slot << 3;
 	cmd->control = 0;
 	
 	cmd->reserved1 = 0;
@@ -694,8 +688,8 @@ static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->reserved5 = 0;
 	cmd->reserved6 = 0;
 	
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	cmd->sector_count_low = count & 0xff;
+	cmd->sector_count_high = (count >> 8) & 0xff;
 	
 	cmd->lba0 = blocknum & 0xff;
 	cmd->lba1 = (blocknum >> 8) & 0xff;
@@ -704,141 +698,138 @@ static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->lba4 = (blocknum >> 32) & 0xff;
 	cmd->lba5 = (blocknum >> 40) & 0xff;
 	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-	
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
-	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
-	
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	ahci_cmd_prepare(sata, slot, sata->slots[slot].buf_phys,
+	    count * sata->block_size, AHCI_CMDHDR_FLAGS_5DWCMD |
+	    (write ? AHCI_CMDHDR_FLAGS_WRITE : 0));
 }
 
-/** Read one sector from the SATA device using FPDMA.
- *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+/** Read or write blocks using FPDMA.
  *
- * @return EOK if succeed, error code otherwise
- *
- */
-static errno_t ahci_rb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
-{
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA read from invalid device", sata->model);
-		return EINTR;
-	}
-	
-	ahci_rb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
-	
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA read", sata->model);
-		return EINTR;
-	}
-	
-	return EOK;
-}
-
-/** Set AHCI registers for writing one sector to the SATA device, use FPDMA.
+ * The transfer is split into pieces fitting the DMA buffers of the command
+ * slots. Pieces are queued at the device in as many slots as are free, so
+ * that the device can work on several of them at once, and they are reaped
+ * in the order in which they were issued.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
+ * @param buf      Data buffer.
+ * @param write    Write to the device rather than read from it.
  *
  * @return EOK if succeed, error code otherwise
  *
  */
-static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static errno_t ahci_rw_fpdma(sata_dev_t *sata, uint64_t blocknum,
+    size_t count, uint8_t *buf, bool write)
 {
-	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	/* Pieces in flight in the order in which they were issued. */
+	struct {
+		unsigned int slot;
+		uint8_t *buf;
+		size_t count;
+	} queue[AHCI_MAX_SLOTS];
+	
+	size_t per_slot = AHCI_SLOT_BUF_SIZE / sata->block_size;
+	size_t head = 0;
+	size_t inflight = 0;
+	errno_t rc = EOK;
 	
-	cmd->fis_type = SATA_CMD_FIS_TYPE;
-	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x61;
-	cmd->tag = 0;
-	cmd->control = 0;
-	
-	cmd->reserved1 = 0;
-	cmd->reserved2 = 0;
-	cmd->reserved3 = 0;
-	cmd->reserved4 = 0;
-	cmd->reserved5 = 0;
-	cmd->reserved6 = 0;
+	fibril_mutex_lock(&sata->lock);
 	
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	while (((count > 0) && (rc == EOK)) || (inflight > 0)) {
+		if ((rc == EOK) && (sata->is_invalid_device)) {
+			ddf_msg(LVL_ERROR, "%s: FPDMA %s invalid device",
+			    sata->model, write ? "write to" : "read from");
+			rc = EINTR;
+		}
+		
+		if ((count > 0) && (rc == EOK)) {
+			/* Only block if there is nothing to reap. */
+			unsigned int slot = ahci_slot_get(sata, inflight == 0);
+			if (slot < AHCI_MAX_SLOTS) {
+				size_t n = min(count, per_slot);
+				
+				if (write) {
+					fibril_mutex_unlock(&sata->lock);
+					memcpy(sata->slots[slot].buf, buf,
+					    n * sata->block_size);
+					fibril_mutex_lock(&sata->lock);
+				}
+				
+				ahci_fpdma_cmd(sata, slot, blocknum, n, write);
+				ahci_slot_issue(sata, slot, true);
+				
+				size_t tail = (head + inflight) % AHCI_MAX_SLOTS;
+				queue[tail].slot = slot;
+				queue[tail].buf = buf;
+				queue[tail].count = n;
+				inflight++;
+				
+				buf += n * sata->block_size;
+				blocknum += n;
+				count -= n;
+				continue;
+			}
+		}
+		
+		/* Reap the oldest piece. */
+		unsigned int slot = queue[head].slot;
+		errno_t wrc = ahci_slot_wait(sata, slot, NULL);
+		if (wrc != EOK) {
+			if (rc == EOK) {
+				ddf_msg(LVL_ERROR,
+				    "%s: Unrecoverable error during FPDMA %s",
+				    sata->model, write ? "write" : "read");
+			}
+			
+			rc = wrc;
+		} else if (!write) {
+			fibril_mutex_unlock(&sata->lock);
+			memcpy(queue[head].buf, sata->slots[slot].buf,
+			    queue[head].count * sata->block_size);
+			fibril_mutex_lock(&sata->lock);
+		}
+		
+		ahci_slot_put(sata, slot);
+		head = (head + 1) % AHCI_MAX_SLOTS;
+		inflight--;
+	}
 	
-	cmd->lba0 = blocknum & 0xff;
-	cmd->lba1 = (blocknum >> 8) & 0xff;
-	cmd->lba2 = (blocknum >> 16) & 0xff;
-	cmd->lba3 = (blocknum >> 24) & 0xff;
-	cmd->lba4 = (blocknum >> 32) & 0xff;
-	cmd->lba5 = (blocknum >> 40) & 0xff;
+	fibril_mutex_unlock(&sata->lock);
 	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-	
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
-	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_WRITE |
-	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
-	
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	return rc;
 }
 
-/** Write one sector into the SATA device, use FPDMA.
+/** Restart command processing of a port after an error.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical addres of buffer with sector data.
- * @param blocknum Block number to write.
+ * Clearing PxCMD.ST makes the HBA drop all commands in PxCI and PxSACT.
+ * Must be called with the device lock held.
  *
- * @return EOK if succeed, error code otherwise
+ * @param sata SATA device structure.
  *
  */
-static errno_t ahci_wb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static void ahci_port_restart(sata_dev_t *sata)
 {
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA write to invalid device", sata->model);
-		return EINTR;
-	}
+	ahci_port_cmd_t pxcmd;
 	
-	ahci_wb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	pxcmd.u32 = sata->port->pxcmd;
+	pxcmd.st = 0;
+	sata->port->pxcmd = pxcmd.u32;
 	
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA write", sata->model);
-		return EINTR;
+	/* The HBA has 500 ms to stop processing the command list. */
+	for (unsigned int i = 0; i < 50; i++) {
+		pxcmd.u32 = sata->port->pxcmd;
+		if (pxcmd.cr == 0)
+			break;
+		
+		async_usleep(10000);
 	}
 	
-	return EOK;
+	/* Clear error status. */
+	sata->port->pxserr = 0xffffffff;
+	
+	pxcmd.st = 1;
+	sata->port->pxcmd = pxcmd.u32;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -906,16 +897,41 @@ static void ahci_interrupt(ipc_call_t *icall, ddf_dev_t *dev)
 	if (sata == NULL)
 		return;
 	
-	/* Evaluate port event */
-	if ((ahci_port_is_end_of_operation(pxis)) ||
-	    (ahci_port_is_error(pxis))) {
-		fibril_mutex_lock(&sata->event_lock);
+	fibril_mutex_lock(&sata->lock);
+	
+	/*
+	 * A command has completed once the HBA has cleared both its bit in
+	 * PxCI and, for native queued commands, its bit in PxSACT.
+	 */
+	uint32_t busy = sata->port->pxsact | sata->port->pxci;
+	uint32_t done = sata->active_slots & ~busy;
+	uint32_t failed = 0;
+	
+	if (ahci_port_is_error(pxis)) {
+		if (ahci_port_is_permanent_error(pxis))
+			sata->is_invalid_device = true;
 		
-		sata->event_pxis = pxis;
-		fibril_condvar_signal(&sata->event_condvar);
+		/* The device aborts all outstanding commands on error. */
+		failed = sata->active_slots & busy;
+	}
+	
+	for (unsigned int slot = 0; slot < AHCI_MAX_SLOTS; slot++) {
+		if (((done | failed) & (1U << slot)) == 0)
+			continue;
 		
-		fibril_mutex_unlock(&sata->event_lock);
+		ahci_slot_t *s = &sata->slots[slot];
+		s->done = true;
+		s->error = (failed & (1U << slot)) != 0;
+		s->pxis = pxis;
+		fibril_condvar_signal(&s->done_cv);
 	}
+	
+	sata->active_slots &= ~(done | failed);
+	
+	if ((failed != 0) && (!sata->is_invalid_device))
+		ahci_port_restart(sata);
+	
+	fibril_mutex_unlock(&sata->lock);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -968,16 +984,27 @@ static sata_dev_t *ahci_sata_allocate(ahci_dev_t *ahci, volatile ahci_port_t *po
 	sata->port->pxclb = LO(phys);
 	sata->cmd_header = (ahci_cmdhdr_t *) virt_cmd;
 	
-	/* Allocate and init command table structure. */
-	rc = dmamem_map_anonymous(size, DMAMEM_4GiB,
+	/* Allocate and init command tables of all command slots. */
+	size_t table_size = AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE;
+	rc = dmamem_map_anonymous(table_size, DMAMEM_4GiB,
 	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
 	if (rc != EOK)
 		goto error_table;
 	
-	memset(virt_table, 0, size);
-	sata->cmd_header->cmdtableu = HI(phys);
-	sata->cmd_header->cmdtable = LO(phys);
-	sata->cmd_table = (uint32_t*) virt_table;
+	memset(virt_table, 0, table_size);
+	for (unsigned int slot = 0; slot < AHCI_MAX_SLOTS; slot++) {
+		uintptr_t table_phys = phys + slot * AHCI_CMD_TABLE_SIZE;
+		
+		sata->cmd_header[slot].cmdtableu = HI(table_phys);
+		sata->cmd_header[slot].cmdtable = LO(table_phys);
+		sata->slots[slot].cmd_table = (uint32_t *)
+		    ((uint8_t *) virt_table + slot * AHCI_CMD_TABLE_SIZE);
+	}
+	
+	/* Only one slot is used until the queue depth is known. */
+	sata->slot_count = 1;
+	sata->free_slots = 1;
+	sata->active_slots = 0;
 	
 	return sata;
 	
@@ -990,6 +1017,49 @@ error_retfis:
 	return NULL;
 }
 
+/** Allocate DMA buffers of the command slots used for data transfers.
+ *
+ * The buffers are allocated once and kept for the lifetime of the device
+ * so that reads and writes do not have to map DMA memory each time.
+ *
+ * @param sata SATA device structure.
+ *
+ * @return EOK if succeed, error code otherwise.
+ *
+ */
+static errno_t ahci_slot_buffers_alloc(sata_dev_t *sata)
+{
+	unsigned int slot;
+	errno_t rc = EOK;
+	
+	for (slot = 0; slot < sata->slot_count; slot++) {
+		ahci_slot_t *s = &sata->slots[slot];
+		
+		s->buf = AS_AREA_ANY;
+		rc = dmamem_map_anonymous(AHCI_SLOT_BUF_SIZE, DMAMEM_4GiB,
+		    AS_AREA_READ | AS_AREA_WRITE, 0, &s->buf_phys, &s->buf);
+		if (rc != EOK)
+			break;
+	}
+	
+	/* Make do with as many slots as there are buffers for. */
+	if (slot == 0) {
+		ddf_msg(LVL_ERROR, "%s: Cannot allocate DMA buffers.",
+		    sata->model);
+		return rc;
+	}
+	
+	fibril_mutex_lock(&sata->lock);
+	sata->slot_count = slot;
+	sata->free_slots = (slot == AHCI_MAX_SLOTS) ? 0xffffffff :
+	    (1U << slot) - 1;
+	fibril_mutex_unlock(&sata->lock);
+	
+	ddf_msg(LVL_NOTE, "%s: Using %u command slots.", sata->model,
+	    sata->slot_count);
+	return EOK;
+}
+
 /** Initialize and start SATA hardware device.
  *
  * @param sata SATA device structure.
@@ -1054,8 +1124,9 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	
 	/* Initialize synchronization structures */
 	fibril_mutex_initialize(&sata->lock);
-	fibril_mutex_initialize(&sata->event_lock);
-	fibril_condvar_initialize(&sata->event_condvar);
+	fibril_condvar_initialize(&sata->slot_cv);
+	for (unsigned int slot = 0; slot < AHCI_MAX_SLOTS; slot++)
+		fibril_condvar_initialize(&sata->slots[slot].done_cv);
 	
 	ahci_sata_hw_start(sata);
 	
@@ -1067,6 +1138,10 @@ static errno_t ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	if (ahci_set_highest_ultra_dma_mode(sata) != EOK)
 		goto error;
 	
+	/* Enable queueing of data transfers. */
+	if (ahci_slot_buffers_alloc(sata) != EOK)
+		goto error;
+	
 	/* Add device to the system */
 	char sata_dev_name[16];
 	snprintf(sata_dev_name, 16, "ahci_%u", sata_devices_count);
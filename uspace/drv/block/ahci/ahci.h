@@ -35,11 +35,28 @@
 
 #include <async.h>
 #include <ddf/interrupt.h>
+#include <fibril_synch.h>
 #include <stdio.h>
 #include <stddef.h>
 #include <stdint.h>
 #include "ahci_hw.h"
 
+/** Maximum number of command slots of a port. */
+#define AHCI_MAX_SLOTS  32
+
+/** Size of the command table of each command slot. */
+#define AHCI_CMD_TABLE_SIZE  4096
+
+/** Number of PRDT entries fitting in a command table. */
+#define AHCI_PRDT_MAX \
+	((AHCI_CMD_TABLE_SIZE - 0x80) / sizeof(ahci_cmd_prdt_t))
+
+/** Maximum number of bytes described by a single PRDT entry. */
+#define AHCI_PRD_MAX_BYTES  (4 * 1024 * 1024)
+
+/** Size of the DMA buffer kept by each command slot. */
+#define AHCI_SLOT_BUF_SIZE  (64 * 1024)
+
 /** AHCI Device. */
 typedef struct {
 	/** Pointer to ddf device. */
@@ -55,6 +72,30 @@ typedef struct {
 	async_sess_t *parent_sess;
 } ahci_dev_t;
 
+/** Command slot of a SATA port. */
+typedef struct {
+	/** Pointer to command table. */
+	volatile uint32_t *cmd_table;
+	
+	/** DMA buffer for data transfers. */
+	void *buf;
+	
+	/** Physical address of the DMA buffer. */
+	uintptr_t buf_phys;
+	
+	/** Signalled when the command in this slot completes. */
+	fibril_condvar_t done_cv;
+	
+	/** Command in this slot has completed. */
+	bool done;
+	
+	/** Command in this slot has failed. */
+	bool error;
+	
+	/** Interrupt state the command has completed with. */
+	ahci_port_is_t pxis;
+} ahci_slot_t;
+
 /** SATA Device. */
 typedef struct {
 	/** Pointer to AHCI device. */
@@ -72,23 +113,26 @@ typedef struct {
 	/** Pointer to SATA port. */
 	volatile ahci_port_t *port;
 	
-	/** Pointer to command header. */
+	/** Pointer to command list, one command header per slot. */
 	volatile ahci_cmdhdr_t *cmd_header;
 	
-	/** Pointer to command table. */
-	volatile uint32_t *cmd_table;
+	/** Command slots. */
+	ahci_slot_t slots[AHCI_MAX_SLOTS];
 	
-	/** Mutex for single operation on device. */
-	fibril_mutex_t lock;
+	/** Number of usable command slots. */
+	unsigned int slot_count;
 	
-	/** Mutex for event signaling condition variable. */
-	fibril_mutex_t event_lock;
+	/** Bitmap of free command slots. */
+	uint32_t free_slots;
 	
-	/** Event signaling condition variable. */
-	fibril_condvar_t event_condvar;
+	/** Bitmap of slots with a command issued to the HBA. */
+	uint32_t active_slots;
 	
-	/** Event interrupt state. */
-	ahci_port_is_t event_pxis;
+	/** Signalled when a command slot is freed. */
+	fibril_condvar_t slot_cv;
+	
+	/** Mutex protecting command slots and port registers. */
+	fibril_mutex_t lock;
 	
 	/** Number of device data blocks. */
 	uint64_t blocks;
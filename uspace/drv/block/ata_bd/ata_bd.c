@@ -35,20 +35,24 @@
  * @brief ATA disk driver
  *
  * This driver supports CHS, 28-bit and 48-bit LBA addressing, as well as
- * PACKET devices. It only uses PIO transfers. There is no support DMA
- * or any other fancy features such as S.M.A.R.T, removable devices, etc.
+ * PACKET devices. Register devices on a PCI IDE controller with bus master
+ * support are accessed using multi-sector DMA transfers completed by an
+ * interrupt, otherwise PIO transfers are used. There is no support for
+ * any other fancy features such as S.M.A.R.T, removable devices, etc.
  *
  * This driver is based on the ATA-1, ATA-2, ATA-3 and ATA/ATAPI-4 through 7
  * standards, as published by the ANSI, NCITS and INCITS standards bodies,
  * which are freely available. This driver contains no vendor-specific
  * code at this moment.
  *
- * The driver services a single controller which can have up to two disks
- * attached.
+ * The driver services a single controller (ISA) or the two channels of
+ * a PCI IDE controller, each of which can have up to two disks attached.
  */
 
 #include <ddi.h>
+#include <ddf/interrupt.h>
 #include <ddf/log.h>
+#include <device/hw_res.h>
 #include <async.h>
 #include <as.h>
 #include <bd_srv.h>
@@ -65,6 +69,7 @@
 #include <errno.h>
 #include <byteorder.h>
 #include <macros.h>
+#include <bitops.h>
 
 #include "ata_hw.h"
 #include "ata_bd.h"
@@ -83,6 +88,9 @@ static const size_t identify_data_size = 512;
 
 static errno_t ata_bd_init_io(ata_ctrl_t *ctrl);
 static void ata_bd_fini_io(ata_ctrl_t *ctrl);
+static void ata_bd_init_dma(ata_ctrl_t *ctrl);
+static void ata_bd_fini_dma(ata_ctrl_t *ctrl);
+static void ata_irq_handler(ipc_call_t *icall, ddf_dev_t *dev);
 
 static errno_t ata_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t ata_bd_close(bd_srv_t *);
@@ -100,6 +108,9 @@ static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t cnt,
 static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
     const void *buf);
 static errno_t ata_rcmd_flush_cache(disk_t *disk);
+static errno_t ata_dma_xfer(disk_t *disk, uint64_t ba, size_t cnt, bool write);
+static void ata_dma_fail(disk_t *disk);
+static errno_t ata_dma_mode_set(disk_t *disk, identify_data_t *idata);
 static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id);
 static errno_t ata_identify_dev(disk_t *disk, void *buf);
 static errno_t ata_identify_pkt_dev(disk_t *disk, void *buf);
@@ -151,8 +162,16 @@ errno_t ata_ctrl_init(ata_ctrl_t *ctrl, ata_base_t *res)
 	ddf_msg(LVL_DEBUG, "ata_ctrl_init()");
 
 	fibril_mutex_initialize(&ctrl->lock);
+	fibril_mutex_initialize(&ctrl->irq_lock);
+	fibril_condvar_initialize(&ctrl->irq_cv);
 	ctrl->cmd_physical = res->cmd;
 	ctrl->ctl_physical = res->ctl;
+	ctrl->bmi_physical = res->bmi;
+	ctrl->irq = res->irq;
+	ctrl->irq_cap = CAP_NIL;
+	ctrl->bm = NULL;
+	ctrl->prdt = NULL;
+	ctrl->dma_buf = NULL;
 
 	ddf_msg(LVL_NOTE, "I/O address %p/%p", (void *) ctrl->cmd_physical,
 	    (void *) ctrl->ctl_physical);
@@ -161,10 +180,13 @@ errno_t ata_ctrl_init(ata_ctrl_t *ctrl, ata_base_t *res)
 	if (rc != EOK)
 		return rc;
 
+	ata_bd_init_dma(ctrl);
+
 	for (i = 0; i < MAX_DISKS; i++) {
 		ddf_msg(LVL_NOTE, "Identify drive %d...", i);
 
-		rc = disk_init(ctrl, &ctrl->disk[i], i);
+		rc = disk_init(ctrl, &ctrl->disk[i],
+		    ctrl->chan * MAX_DISKS + i);
 
 		if (rc == EOK) {
 			disk_print_summary(&ctrl->disk[i]);
@@ -328,16 +350,193 @@ static errno_t ata_bd_init_io(ata_ctrl_t *ctrl)
 
 	ctrl->ctl = vaddr;
 
+	if (ctrl->bmi_physical != 0) {
+		rc = pio_enable((void *) ctrl->bmi_physical, sizeof(ata_bm_t),
+		    &vaddr);
+		if (rc != EOK) {
+			ddf_msg(LVL_WARN, "Cannot initialize bus master I/O "
+			    "space.");
+			vaddr = NULL;
+		}
+
+		ctrl->bm = vaddr;
+	}
+
 	return EOK;
 }
 
 /** Clean up device I/O. */
 static void ata_bd_fini_io(ata_ctrl_t *ctrl)
 {
-	(void) ctrl;
+	ata_bd_fini_dma(ctrl);
 	/* XXX TODO */
 }
 
+/** Set up bus master DMA.
+ *
+ * Allocates the PRD table and the DMA bounce buffer and installs the channel
+ * interrupt handler. If any of this fails, the channel falls back to PIO.
+ */
+static void ata_bd_init_dma(ata_ctrl_t *ctrl)
+{
+	async_sess_t *parent_sess;
+	irq_code_t irq_code;
+	errno_t rc;
+
+	if (ctrl->bm == NULL)
+		return;
+
+	if (ctrl->irq < 0) {
+		ddf_msg(LVL_WARN, "No IRQ for bus master DMA.");
+		goto error;
+	}
+
+	ctrl->prdt = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(PAGE_SIZE, DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl->prdt_phys,
+	    (void **) &ctrl->prdt);
+	if (rc != EOK) {
+		ddf_msg(LVL_WARN, "Cannot allocate PRD table.");
+		ctrl->prdt = NULL;
+		goto error;
+	}
+
+	ctrl->dma_buf = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(ATA_DMA_BUF_SIZE, DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl->dma_buf_phys,
+	    &ctrl->dma_buf);
+	if (rc != EOK) {
+		ddf_msg(LVL_WARN, "Cannot allocate DMA buffer.");
+		ctrl->dma_buf = NULL;
+		goto error;
+	}
+
+	/*
+	 * The interrupt is ours if the bus master reports it. Clear it
+	 * in the bus master and read the device status to deassert INTRQ.
+	 */
+	ctrl->irq_ranges[0].base = ctrl->bmi_physical;
+	ctrl->irq_ranges[0].size = sizeof(ata_bm_t);
+	ctrl->irq_ranges[1].base = ctrl->cmd_physical;
+	ctrl->irq_ranges[1].size = sizeof(ata_cmd_t);
+
+	ctrl->irq_cmds[0].cmd = CMD_PIO_READ_8;
+	ctrl->irq_cmds[0].addr = (void *) (ctrl->bmi_physical +
+	    offsetof(ata_bm_t, status));
+	ctrl->irq_cmds[0].dstarg = 1;
+
+	ctrl->irq_cmds[1].cmd = CMD_AND;
+	ctrl->irq_cmds[1].value = BMS_INTR;
+	ctrl->irq_cmds[1].srcarg = 1;
+	ctrl->irq_cmds[1].dstarg = 3;
+
+	ctrl->irq_cmds[2].cmd = CMD_PREDICATE;
+	ctrl->irq_cmds[2].value = 4;
+	ctrl->irq_cmds[2].srcarg = 3;
+
+	ctrl->irq_cmds[3].cmd = CMD_PIO_WRITE_A_8;
+	ctrl->irq_cmds[3].addr = ctrl->irq_cmds[0].addr;
+	ctrl->irq_cmds[3].srcarg = 1;
+
+	ctrl->irq_cmds[4].cmd = CMD_PIO_READ_8;
+	ctrl->irq_cmds[4].addr = (void *) (ctrl->cmd_physical +
+	    offsetof(ata_cmd_t, status));
+	ctrl->irq_cmds[4].dstarg = 2;
+
+	ctrl->irq_cmds[5].cmd = CMD_LOAD;
+	ctrl->irq_cmds[5].value = ctrl->chan;
+	ctrl->irq_cmds[5].dstarg = 4;
+
+	ctrl->irq_cmds[6].cmd = CMD_ACCEPT;
+
+	irq_code.rangecount = sizeof(ctrl->irq_ranges) /
+	    sizeof(irq_pio_range_t);
+	irq_code.ranges = ctrl->irq_ranges;
+	irq_code.cmdcount = sizeof(ctrl->irq_cmds) / sizeof(irq_cmd_t);
+	irq_code.cmds = ctrl->irq_cmds;
+
+	rc = register_interrupt_handler(ctrl->dev, ctrl->irq, ata_irq_handler,
+	    &irq_code, &ctrl->irq_cap);
+	if (rc != EOK) {
+		ddf_msg(LVL_WARN, "Failed registering interrupt handler.");
+		ctrl->irq_cap = CAP_NIL;
+		goto error;
+	}
+
+	parent_sess = ddf_dev_parent_sess_get(ctrl->dev);
+	if (parent_sess == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	rc = hw_res_enable_interrupt(parent_sess, ctrl->irq);
+	if (rc != EOK) {
+		ddf_msg(LVL_WARN, "Failed enabling interrupt.");
+		goto error;
+	}
+
+	/* Let the devices assert INTRQ. */
+	pio_write_8(&ctrl->ctl->device_control, 0);
+
+	ddf_msg(LVL_NOTE, "Bus master I/O address %p, IRQ %d",
+	    (void *) ctrl->bmi_physical, ctrl->irq);
+	return;
+error:
+	ddf_msg(LVL_WARN, "Bus master DMA not available, using PIO.");
+	ata_bd_fini_dma(ctrl);
+}
+
+/** Release bus master DMA resources. */
+static void ata_bd_fini_dma(ata_ctrl_t *ctrl)
+{
+	if (ctrl->irq_cap != CAP_NIL) {
+		unregister_interrupt_handler(ctrl->dev, ctrl->irq_cap);
+		ctrl->irq_cap = CAP_NIL;
+	}
+
+	if (ctrl->dma_buf != NULL) {
+		dmamem_unmap_anonymous(ctrl->dma_buf);
+		ctrl->dma_buf = NULL;
+	}
+
+	if (ctrl->prdt != NULL) {
+		dmamem_unmap_anonymous(ctrl->prdt);
+		ctrl->prdt = NULL;
+	}
+
+	ctrl->bm = NULL;
+}
+
+/** Channel interrupt handler.
+ *
+ * Records the status read by the interrupt pseudocode and wakes up
+ * the fibril waiting for DMA completion.
+ */
+static void ata_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	ata_dev_t *adev = (ata_dev_t *) ddf_dev_data_get(dev);
+	unsigned chan = IPC_GET_ARG4(*icall);
+	ata_ctrl_t *ctrl = NULL;
+	unsigned i;
+
+	for (i = 0; i < MAX_CHANNELS; i++) {
+		if (adev->ctrl[i].bm != NULL && adev->ctrl[i].chan == chan) {
+			ctrl = &adev->ctrl[i];
+			break;
+		}
+	}
+
+	if (ctrl == NULL)
+		return;
+
+	fibril_mutex_lock(&ctrl->irq_lock);
+	ctrl->irq_bm_status = IPC_GET_ARG1(*icall);
+	ctrl->irq_status = IPC_GET_ARG2(*icall);
+	ctrl->irq_fired = true;
+	fibril_condvar_broadcast(&ctrl->irq_cv);
+	fibril_mutex_unlock(&ctrl->irq_lock);
+}
+
 /** Initialize a disk.
  *
  * Probes for a disk, determines its parameters and initializes
@@ -361,6 +560,7 @@ static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id)
 	d->ctrl = ctrl;
 	d->disk_id = disk_id;
 	d->present = false;
+	d->dma = false;
 	d->afun = NULL;
 
 	/* Try identify command. */
@@ -491,6 +691,21 @@ static errno_t disk_init(ata_ctrl_t *ctrl, disk_t *d, int disk_id)
 	} else {
 		/* Assume register Read always uses 512-byte blocks. */
 		d->block_size = 512;
+
+		/*
+		 * DMA commands are only issued with LBA addressing. The
+		 * firmware sets the drive's DMA capable bit in the bus master
+		 * status once it has set up the controller timing for it.
+		 */
+		if (ctrl->bm != NULL && d->amode != am_chs &&
+		    (idata.caps & rd_cap_dma) != 0 &&
+		    (pio_read_8(&ctrl->bm->status) &
+		    (disk_dev_idx(d) != 0 ? BMS_DRV1_DMA : BMS_DRV0_DMA)) != 0) {
+			if (ata_dma_mode_set(d, &idata) == EOK)
+				d->dma = true;
+			else
+				ddf_msg(LVL_WARN, "Cannot set DMA mode, using PIO.");
+		}
 	}
 
 	d->present = true;
@@ -512,25 +727,39 @@ static errno_t ata_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     void *buf, size_t size)
 {
 	disk_t *disk = bd_srv_disk(bd);
+	size_t nblocks;
+	bool dma;
 	errno_t rc;
 
 	if (size < cnt * disk->block_size)
 		return EINVAL;
 
 	while (cnt > 0) {
+		nblocks = 1;
+		dma = disk->dma;
+
 		if (disk->dev_type == ata_reg_dev) {
-			rc = ata_rcmd_read(disk, ba, 1, buf);
+			if (dma) {
+				nblocks = min(cnt,
+				    ATA_DMA_BUF_SIZE / disk->block_size);
+			}
+
+			rc = ata_rcmd_read(disk, ba, nblocks, buf);
 		} else {
 			rc = ata_pcmd_read_12(disk, ba, 1, buf,
 			    disk->block_size);
 		}
 
+		/* DMA has been disabled, retry using PIO. */
+		if (rc == EIO && dma)
+			continue;
+
 		if (rc != EOK)
 			return rc;
 
-		++ba;
-		--cnt;
-		buf += disk->block_size;
+		ba += nblocks;
+		cnt -= nblocks;
+		buf += nblocks * disk->block_size;
 	}
 
 	return EOK;
@@ -549,6 +778,8 @@ static errno_t ata_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
 	disk_t *disk = bd_srv_disk(bd);
+	size_t nblocks;
+	bool dma;
 	errno_t rc;
 
 	if (disk->dev_type != ata_reg_dev)
@@ -558,13 +789,24 @@ static errno_t ata_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		return EINVAL;
 
 	while (cnt > 0) {
-		rc = ata_rcmd_write(disk, ba, 1, buf);
+		nblocks = 1;
+		dma = disk->dma;
+
+		if (dma)
+			nblocks = min(cnt, ATA_DMA_BUF_SIZE / disk->block_size);
+
+		rc = ata_rcmd_write(disk, ba, nblocks, buf);
+
+		/* DMA has been disabled, retry using PIO. */
+		if (rc == EIO && dma)
+			continue;
+
 		if (rc != EOK)
 			return rc;
 
-		++ba;
-		--cnt;
-		buf += disk->block_size;
+		ba += nblocks;
+		cnt -= nblocks;
+		buf += nblocks * disk->block_size;
 	}
 
 	return EOK;
@@ -1008,6 +1250,17 @@ static errno_t ata_rcmd_read(disk_t *disk, uint64_t ba, size_t blk_cnt,
 	block_coord_t bc;
 	errno_t rc;
 
+	if (disk->dma) {
+		fibril_mutex_lock(&ctrl->lock);
+		rc = ata_dma_xfer(disk, ba, blk_cnt, false);
+		if (rc == EOK)
+			memcpy(buf, ctrl->dma_buf, blk_cnt * disk->block_size);
+		else if (rc == EIO)
+			ata_dma_fail(disk);
+		fibril_mutex_unlock(&ctrl->lock);
+		return rc;
+	}
+
 	/* Silence warning. */
 	memset(&bc, 0, sizeof(bc));
 
@@ -1068,6 +1321,16 @@ static errno_t ata_rcmd_write(disk_t *disk, uint64_t ba, size_t cnt,
 	block_coord_t bc;
 	errno_t rc;
 
+	if (disk->dma) {
+		fibril_mutex_lock(&ctrl->lock);
+		memcpy(ctrl->dma_buf, buf, cnt * disk->block_size);
+		rc = ata_dma_xfer(disk, ba, cnt, true);
+		if (rc == EIO)
+			ata_dma_fail(disk);
+		fibril_mutex_unlock(&ctrl->lock);
+		return rc;
+	}
+
 	/* Silence warning. */
 	memset(&bc, 0, sizeof(bc));
 
@@ -1150,6 +1413,252 @@ static errno_t ata_rcmd_flush_cache(disk_t *disk)
 	return rc;
 }
 
+/** Fill in the PRD table for a transfer of @a size bytes.
+ *
+ * The bounce buffer is physically contiguous, it only needs to be split
+ * where it crosses a 64 KiB boundary.
+ */
+static void ata_dma_prdt_setup(ata_ctrl_t *ctrl, size_t size)
+{
+	uintptr_t addr = ctrl->dma_buf_phys;
+	size_t chunk;
+	unsigned i = 0;
+
+	while (size > 0) {
+		chunk = min(size, PRD_BOUNDARY - (addr % PRD_BOUNDARY));
+
+		/* Byte count of 0 stands for 64 KiB. */
+		ctrl->prdt[i].addr = addr;
+		ctrl->prdt[i].count = chunk & 0xffff;
+		ctrl->prdt[i].flags = 0;
+
+		addr += chunk;
+		size -= chunk;
+		++i;
+	}
+
+	ctrl->prdt[i - 1].flags = PRD_EOT;
+}
+
+/** Reset the channel after a DMA command that did not complete. */
+static void ata_dma_abort(ata_ctrl_t *ctrl)
+{
+	pio_write_8(&ctrl->ctl->device_control, DCR_SRST);
+	async_usleep(10);
+	pio_write_8(&ctrl->ctl->device_control, 0);
+	async_usleep(2000);
+
+	(void) wait_status(ctrl, 0, ~SR_BSY, NULL, TIMEOUT_BSY);
+}
+
+/** Transfer blocks between the device and the DMA bounce buffer.
+ *
+ * The caller must hold the controller lock.
+ *
+ * @param disk		Disk
+ * @param ba		Address of the first block.
+ * @param cnt		Number of blocks to transfer.
+ * @param write		@c true to write to the device, @c false to read.
+ *
+ * @return EOK on success, EINVAL if the range is invalid, EIO on error.
+ */
+static errno_t ata_dma_xfer(disk_t *disk, uint64_t ba, size_t cnt, bool write)
+{
+	ata_ctrl_t *ctrl = disk->ctrl;
+	uint8_t drv_head;
+	uint8_t bm_cmd;
+	uint8_t bm_status;
+	uint8_t status;
+	block_coord_t bc;
+	bool done;
+	errno_t rc;
+
+	assert(cnt * disk->block_size <= ATA_DMA_BUF_SIZE);
+	assert(disk->amode != am_chs);
+
+	/* Silence warning. */
+	memset(&bc, 0, sizeof(bc));
+
+	/* Compute block coordinates. */
+	if (ba + cnt > disk->blocks || coord_calc(disk, ba, &bc) != EOK)
+		return EINVAL;
+
+	/* New value for Drive/Head register */
+	drv_head =
+	    ((disk_dev_idx(disk) != 0) ? DHR_DRV : 0) | DHR_LBA |
+	    (bc.h & 0x0f);
+
+	if (wait_status(ctrl, 0, ~SR_BSY, NULL, TIMEOUT_BSY) != EOK)
+		return EIO;
+
+	pio_write_8(&ctrl->cmd->drive_head, drv_head);
+
+	if (wait_status(ctrl, SR_DRDY, ~SR_BSY, NULL, TIMEOUT_DRDY) != EOK)
+		return EIO;
+
+	ata_dma_prdt_setup(ctrl, cnt * disk->block_size);
+
+	/* Set direction, point to the PRD table and clear stale status. */
+	bm_cmd = write ? 0 : BMC_WRITE_MEM;
+	pio_write_8(&ctrl->bm->command, bm_cmd);
+	pio_write_32(&ctrl->bm->prdt_addr, ctrl->prdt_phys);
+	pio_write_8(&ctrl->bm->status, pio_read_8(&ctrl->bm->status) |
+	    BMS_INTR | BMS_ERR);
+
+	fibril_mutex_lock(&ctrl->irq_lock);
+	ctrl->irq_fired = false;
+	ctrl->irq_bm_status = 0;
+	ctrl->irq_status = 0;
+	fibril_mutex_unlock(&ctrl->irq_lock);
+
+	/* Program block coordinates into the device. */
+	coord_sc_program(ctrl, &bc, cnt);
+
+	if (disk->amode == am_lba48) {
+		pio_write_8(&ctrl->cmd->command, write ?
+		    CMD_WRITE_DMA_EXT : CMD_READ_DMA_EXT);
+	} else {
+		pio_write_8(&ctrl->cmd->command, write ?
+		    CMD_WRITE_DMA : CMD_READ_DMA);
+	}
+
+	pio_write_8(&ctrl->bm->command, bm_cmd | BMC_START);
+
+	/*
+	 * Wait for the completion interrupt. The interrupt line may be
+	 * shared, so after each wakeup check that the transfer is really
+	 * over: the bus master must be idle and either have seen the device
+	 * interrupt or the device must no longer be busy. The interrupt
+	 * handler clears BMS_INTR and reading the status register there
+	 * clears the device interrupt, so merge in what it recorded.
+	 */
+	rc = EOK;
+	done = false;
+	fibril_mutex_lock(&ctrl->irq_lock);
+	while (!done) {
+		while (!ctrl->irq_fired && rc == EOK) {
+			rc = fibril_condvar_wait_timeout(&ctrl->irq_cv,
+			    &ctrl->irq_lock, TIMEOUT_DMA * 10000);
+		}
+		ctrl->irq_fired = false;
+
+		bm_status = pio_read_8(&ctrl->bm->status) |
+		    (ctrl->irq_bm_status & BMS_INTR);
+		status = pio_read_8(&ctrl->ctl->alt_status) |
+		    (ctrl->irq_status & (SR_ERR | SR_DWF));
+
+		if ((bm_status & BMS_ERR) != 0 ||
+		    ((bm_status & BMS_ACTIVE) == 0 &&
+		    ((bm_status & BMS_INTR) != 0 || (status & SR_BSY) == 0)))
+			done = true;
+		else if (rc != EOK)
+			break;
+	}
+	fibril_mutex_unlock(&ctrl->irq_lock);
+
+	/* Stop the bus master. */
+	pio_write_8(&ctrl->bm->command, bm_cmd);
+
+	if (!done) {
+		ddf_msg(LVL_ERROR, "DMA command timed out.");
+		return EIO;
+	}
+
+	if ((bm_status & BMS_ERR) != 0 || (status & (SR_ERR | SR_DWF)) != 0) {
+		ddf_msg(LVL_ERROR, "DMA command failed (bus master status "
+		    "0x%02x, status 0x%02x).", bm_status, status);
+		return EIO;
+	}
+
+	return EOK;
+}
+
+/** Give up on DMA after a failed transfer.
+ *
+ * Resets the channel, which may be left with the command half done, and
+ * switches the disk to PIO. The caller must hold the controller lock.
+ * Callers retry the transfer using PIO.
+ *
+ * @param disk		Disk
+ */
+static void ata_dma_fail(disk_t *disk)
+{
+	ddf_msg(LVL_WARN, "DMA transfer failed, falling back to PIO.");
+	ata_dma_abort(disk->ctrl);
+	disk->dma = false;
+}
+
+/** Select the highest mode set in the low bits of an identify word. */
+static uint8_t ata_dma_mode_pick(uint16_t modes)
+{
+	/* Modes selected by the firmware are in the high byte. */
+	if ((modes >> 8) != 0)
+		return fnzb32(modes >> 8);
+
+	return fnzb32(modes & 0xff);
+}
+
+/** Program the DMA transfer mode into the device.
+ *
+ * The firmware has set up the controller timing for the mode it selected,
+ * so that mode is kept. Otherwise the fastest Ultra DMA mode up to 2 is
+ * chosen, higher modes need an 80-conductor cable. Multiword DMA is used
+ * if the device does not support Ultra DMA.
+ *
+ * @param disk		Disk
+ * @param idata		Identify data of the disk.
+ *
+ * @return EOK on success, ENOTSUP if the device reports no DMA mode,
+ *         EIO on error.
+ */
+static errno_t ata_dma_mode_set(disk_t *disk, identify_data_t *idata)
+{
+	ata_ctrl_t *ctrl = disk->ctrl;
+	uint16_t udma = idata->udma & 0x0707;
+	uint16_t mw_dma = idata->mw_dma & 0x0707;
+	uint8_t drv_head;
+	uint8_t mode;
+	errno_t rc;
+
+	if ((idata->validity & idv_word88) != 0 && udma != 0)
+		mode = XFER_UDMA | ata_dma_mode_pick(udma);
+	else if (mw_dma != 0)
+		mode = XFER_MWDMA | ata_dma_mode_pick(mw_dma);
+	else
+		return ENOTSUP;
+
+	/* New value for Drive/Head register */
+	drv_head =
+	    (disk_dev_idx(disk) != 0) ? DHR_DRV : 0;
+
+	fibril_mutex_lock(&ctrl->lock);
+
+	if (wait_status(ctrl, 0, ~SR_BSY, NULL, TIMEOUT_BSY) != EOK) {
+		fibril_mutex_unlock(&ctrl->lock);
+		return EIO;
+	}
+
+	pio_write_8(&ctrl->cmd->drive_head, drv_head);
+
+	if (wait_status(ctrl, SR_DRDY, ~SR_BSY, NULL, TIMEOUT_DRDY) != EOK) {
+		fibril_mutex_unlock(&ctrl->lock);
+		return EIO;
+	}
+
+	pio_write_8(&ctrl->cmd->features, SF_SET_XFER_MODE);
+	pio_write_8(&ctrl->cmd->sector_count, mode);
+	pio_write_8(&ctrl->cmd->command, CMD_SET_FEATURES);
+
+	rc = ata_pio_nondata(disk);
+
+	fibril_mutex_unlock(&ctrl->lock);
+
+	if (rc == EOK)
+		ddf_msg(LVL_NOTE, "DMA transfer mode 0x%02x.", mode);
+
+	return rc;
+}
+
 /** Calculate block coordinates.
  *
  * Calculates block coordinates in the best coordinate system supported
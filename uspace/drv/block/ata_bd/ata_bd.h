@@ -38,6 +38,7 @@
 #include <async.h>
 #include <bd_srv.h>
 #include <ddf/driver.h>
+#include <ddf/interrupt.h>
 #include <fibril_synch.h>
 #include <str.h>
 #include <stdint.h>
@@ -46,17 +47,26 @@
 
 #define NAME "ata_bd"
 
+/** Maximum number of channels serviced by one device (PCI IDE controller). */
+#define MAX_CHANNELS 2
+
+/** Size of the DMA bounce buffer of a channel. */
+#define ATA_DMA_BUF_SIZE 0x10000
+
 /** Base addresses for ATA I/O blocks. */
 typedef struct {
 	uintptr_t cmd;	/**< Command block base address. */
 	uintptr_t ctl;	/**< Control block base address. */
+	uintptr_t bmi;	/**< Bus master registers base address or 0. */
+	int irq;	/**< Channel IRQ or -1. */
 } ata_base_t;
 
 /** Timeout definitions. Unit is 10 ms. */
 enum ata_timeout {
 	TIMEOUT_PROBE	=  100, /*  1 s */
 	TIMEOUT_BSY	=  100, /*  1 s */
-	TIMEOUT_DRDY	= 1000  /* 10 s */
+	TIMEOUT_DRDY	= 1000, /* 10 s */
+	TIMEOUT_DMA	= 1000  /* 10 s */
 };
 
 enum ata_dev_type {
@@ -123,6 +133,9 @@ typedef struct {
 
 	char model[STR_BOUNDS(40) + 1];
 
+	/** Use bus master DMA for block transfers */
+	bool dma;
+
 	int disk_id;
 } disk_t;
 
@@ -135,17 +148,58 @@ typedef struct ata_ctrl {
 	/** I/O base address of the control registers */
 	uintptr_t ctl_physical;
 
+	/** I/O base address of the bus master registers or 0 */
+	uintptr_t bmi_physical;
+	/** Channel number */
+	unsigned chan;
+
 	/** Command registers */
 	ata_cmd_t *cmd;
 	/** Control registers */
 	ata_ctl_t *ctl;
+	/** Bus master registers or @c NULL if DMA is not available */
+	ata_bm_t *bm;
+
+	/** Physical region descriptor table */
+	ata_prd_t *prdt;
+	uintptr_t prdt_phys;
+	/** DMA bounce buffer */
+	void *dma_buf;
+	uintptr_t dma_buf_phys;
+
+	/** Channel IRQ or -1 */
+	int irq;
+	/** IRQ capability handle */
+	cap_handle_t irq_cap;
+	/** IRQ pseudocode */
+	irq_pio_range_t irq_ranges[2];
+	irq_cmd_t irq_cmds[7];
 
 	/** Per-disk state. */
 	disk_t disk[MAX_DISKS];
 
 	fibril_mutex_t lock;
+
+	/** Protects @c irq_fired and @c irq_status */
+	fibril_mutex_t irq_lock;
+	/** Signalled when the channel interrupt arrives */
+	fibril_condvar_t irq_cv;
+	/** Interrupt arrived since the last DMA command was started */
+	bool irq_fired;
+	/** Bus master status read by the interrupt pseudocode */
+	uint8_t irq_bm_status;
+	/** Device status read by the interrupt pseudocode */
+	uint8_t irq_status;
 } ata_ctrl_t;
 
+/** ATA device (ISA controller or PCI IDE function) */
+typedef struct {
+	/** Number of channels */
+	unsigned channels;
+	/** Per-channel controllers */
+	ata_ctrl_t ctrl[MAX_CHANNELS];
+} ata_dev_t;
+
 typedef struct ata_fun {
 	ddf_fun_t *fun;
 	disk_t *disk;
@@ -133,12 +133,68 @@ enum ata_command {
 	CMD_READ_SECTORS_EXT	= 0x24,
 	CMD_WRITE_SECTORS	= 0x30,
 	CMD_WRITE_SECTORS_EXT	= 0x34,
+	CMD_READ_DMA_EXT	= 0x25,
+	CMD_WRITE_DMA_EXT	= 0x35,
 	CMD_PACKET		= 0xA0,
 	CMD_IDENTIFY_PKT_DEV	= 0xA1,
+	CMD_READ_DMA		= 0xC8,
+	CMD_WRITE_DMA		= 0xCA,
 	CMD_IDENTIFY_DRIVE	= 0xEC,
-	CMD_FLUSH_CACHE		= 0xE7
+	CMD_FLUSH_CACHE		= 0xE7,
+	CMD_SET_FEATURES	= 0xEF
 };
 
+/** Subcommands of Set Features, written to the features register. */
+enum ata_set_features {
+	SF_SET_XFER_MODE	= 0x03  /**< Set transfer mode */
+};
+
+/** Transfer mode values for Set Features, ORed with the mode number. */
+enum ata_xfer_mode {
+	XFER_MWDMA		= 0x20, /**< Multiword DMA */
+	XFER_UDMA		= 0x40  /**< Ultra DMA */
+};
+
+/** Bus Master IDE registers of one channel. */
+typedef struct {
+	uint8_t command;
+	uint8_t pad0;
+	uint8_t status;
+	uint8_t pad1;
+	uint32_t prdt_addr;
+} ata_bm_t;
+
+enum bm_command_bits {
+	BMC_WRITE_MEM	= 0x08, /**< Bus master writes to memory (device read) */
+	BMC_START	= 0x01  /**< Start bus master operation */
+};
+
+enum bm_status_bits {
+	BMS_SIMPLEX	= 0x80, /**< Simplex only */
+	BMS_DRV1_DMA	= 0x40, /**< Drive 1 DMA capable */
+	BMS_DRV0_DMA	= 0x20, /**< Drive 0 DMA capable */
+	BMS_INTR	= 0x04, /**< Interrupt (write 1 to clear) */
+	BMS_ERR		= 0x02, /**< Error (write 1 to clear) */
+	BMS_ACTIVE	= 0x01  /**< Bus master IDE active */
+};
+
+/** Physical Region Descriptor. */
+typedef struct {
+	/** Physical address of the memory region */
+	uint32_t addr;
+	/** Byte count, 0 means 64 KiB */
+	uint16_t count;
+	/** Flags */
+	uint16_t flags;
+} ata_prd_t;
+
+enum prd_flags {
+	PRD_EOT		= 0x8000 /**< End of table */
+};
+
+/** Memory regions described by a PRD must not cross a 64 KiB boundary. */
+#define PRD_BOUNDARY	0x10000
+
 /** Data returned from identify device and identify packet device command. */
 typedef struct {
 	uint16_t gen_conf;
@@ -236,6 +292,12 @@ enum ata_pktdev_caps {
 	pd_cap_dma		= 0x0100
 };
 
+/** Bits of @c identify_data_t.validity */
+enum ata_validity {
+	idv_words64_70		= 0x0002, /**< Words 64-70 are valid */
+	idv_word88		= 0x0004  /**< Word 88 (Ultra DMA) is valid */
+};
+
 /** Bits of @c identify_data_t.cmd_set1 */
 enum ata_cs1 {
 	cs1_addr48	= 0x0400	/**< 48-bit address feature set */
@@ -36,6 +36,7 @@
 #include <ddf/driver.h>
 #include <ddf/log.h>
 #include <device/hw_res_parsed.h>
+#include <pci_dev_iface.h>
 
 #include "ata_bd.h"
 #include "main.h"
@@ -61,10 +62,55 @@ static driver_t ata_driver = {
 	.driver_ops = &driver_ops
 };
 
-static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
+/** PCI command register and its bus master enable bit */
+#define PCI_CMD		0x04
+#define PCI_CMD_MASTER	0x0004
+
+/** Size of the bus master register block of a PCI IDE controller */
+#define BMI_SIZE	16
+
+/** Command block of the legacy secondary channel */
+#define LEGACY_SEC_CMD	0x170
+
+/** Fill in resources of one channel from its command and control ranges. */
+static errno_t ata_get_chan_res(addr_range_t *cmd_rng, addr_range_t *ctl_rng,
+    ata_base_t *ata_res)
+{
+	if (RNGSZ(*ctl_rng) < sizeof(ata_ctl_t))
+		return EINVAL;
+
+	if (RNGSZ(*cmd_rng) < sizeof(ata_cmd_t))
+		return EINVAL;
+
+	ata_res->cmd = RNGABS(*cmd_rng);
+	ata_res->ctl = RNGABS(*ctl_rng);
+	ata_res->bmi = 0;
+	ata_res->irq = -1;
+	return EOK;
+}
+
+/** Get HW resources of the ATA device.
+ *
+ * An ISA device is a single channel described by a command and a control
+ * block range and no IRQ. A PCI IDE controller provides the command and
+ * control blocks of its compatibility mode channels, optionally the bus
+ * master register block and the IRQs of the channels (in this order, see
+ * pciintel).
+ *
+ * @param dev		DDF device
+ * @param ata_res	Array of @c MAX_CHANNELS channel resources to fill in
+ * @param nchan		Place to store number of channels
+ * @return		EOK on success or an error code
+ */
+static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res,
+    unsigned *nchan)
 {
 	async_sess_t *parent_sess;
 	hw_res_list_parsed_t hw_res;
+	addr_range_t *ranges;
+	uintptr_t bmi;
+	unsigned n;
+	unsigned i;
 	errno_t rc;
 
 	parent_sess = ddf_dev_parent_sess_get(dev);
@@ -76,32 +122,72 @@ static errno_t ata_get_res(ddf_dev_t *dev, ata_base_t *ata_res)
 	if (rc != EOK)
 		return rc;
 
-	if (hw_res.io_ranges.count != 2) {
-		rc = EINVAL;
-		goto error;
-	}
-
-	addr_range_t *cmd_rng = &hw_res.io_ranges.ranges[0];
-	addr_range_t *ctl_rng = &hw_res.io_ranges.ranges[1];
-	ata_res->cmd = RNGABS(*cmd_rng);
-	ata_res->ctl = RNGABS(*ctl_rng);
-
-	if (RNGSZ(*ctl_rng) < sizeof(ata_ctl_t)) {
-		rc = EINVAL;
-		goto error;
-	}
-
-	if (RNGSZ(*cmd_rng) < sizeof(ata_cmd_t)) {
+	ranges = hw_res.io_ranges.ranges;
+	n = hw_res.irqs.count;
+
+	if (n == 0 && hw_res.io_ranges.count == 2) {
+		/* ISA controller, no DMA, polled operation */
+		rc = ata_get_chan_res(&ranges[0], &ranges[1], &ata_res[0]);
+		if (rc != EOK)
+			goto error;
+
+		*nchan = 1;
+	} else if (n > 0 && n <= MAX_CHANNELS &&
+	    hw_res.io_ranges.count >= 2 * n) {
+		/* PCI IDE controller */
+		bmi = 0;
+		if (hw_res.io_ranges.count > 2 * n &&
+		    RNGSZ(ranges[2 * n]) >= BMI_SIZE)
+			bmi = RNGABS(ranges[2 * n]);
+
+		for (i = 0; i < n; i++) {
+			rc = ata_get_chan_res(&ranges[2 * i], &ranges[2 * i + 1],
+			    &ata_res[i]);
+			if (rc != EOK)
+				goto error;
+
+			ata_res[i].irq = hw_res.irqs.irqs[i];
+
+			if (bmi != 0) {
+				ata_res[i].bmi = bmi;
+				/* The secondary channel has the second half. */
+				if (ata_res[i].cmd == LEGACY_SEC_CMD)
+					ata_res[i].bmi += sizeof(ata_bm_t);
+			}
+		}
+
+		*nchan = n;
+	} else {
 		rc = EINVAL;
 		goto error;
 	}
 
+	hw_res_list_parsed_clean(&hw_res);
 	return EOK;
 error:
 	hw_res_list_parsed_clean(&hw_res);
 	return rc;
 }
 
+/** Enable bus mastering of a PCI IDE controller. */
+static errno_t ata_enable_bus_master(ddf_dev_t *dev)
+{
+	async_sess_t *parent_sess;
+	uint16_t cmd;
+	errno_t rc;
+
+	parent_sess = ddf_dev_parent_sess_get(dev);
+	if (parent_sess == NULL)
+		return ENOMEM;
+
+	rc = pci_config_space_read_16(parent_sess, PCI_CMD, &cmd);
+	if (rc != EOK)
+		return rc;
+
+	return pci_config_space_write_16(parent_sess, PCI_CMD,
+	    cmd | PCI_CMD_MASTER);
+}
+
 /** Add new device
  *
  * @param  dev New device
@@ -109,27 +195,49 @@ error:
  */
 static errno_t ata_dev_add(ddf_dev_t *dev)
 {
+	ata_dev_t *adev;
 	ata_ctrl_t *ctrl;
-	ata_base_t res;
+	ata_base_t res[MAX_CHANNELS];
+	unsigned nchan;
+	unsigned i;
 	errno_t rc;
 
-	rc = ata_get_res(dev, &res);
+	rc = ata_get_res(dev, res, &nchan);
 	if (rc != EOK) {
 		ddf_msg(LVL_ERROR, "Invalid HW resource configuration.");
 		return EINVAL;
 	}
 
-	ctrl = ddf_dev_data_alloc(dev, sizeof(ata_ctrl_t));
-	if (ctrl == NULL) {
+	adev = ddf_dev_data_alloc(dev, sizeof(ata_dev_t));
+	if (adev == NULL) {
 		ddf_msg(LVL_ERROR, "Failed allocating soft state.");
 		rc = ENOMEM;
 		goto error;
 	}
 
-	ctrl->dev = dev;
+	if (res[0].bmi != 0) {
+		rc = ata_enable_bus_master(dev);
+		if (rc != EOK) {
+			ddf_msg(LVL_WARN, "Failed enabling bus mastering, "
+			    "using PIO.");
+			for (i = 0; i < nchan; i++)
+				res[i].bmi = 0;
+		}
+	}
 
-	rc = ata_ctrl_init(ctrl, &res);
-	if (rc != EOK) {
+	/* Channels without any disks are not kept. */
+	adev->channels = 0;
+	for (i = 0; i < nchan; i++) {
+		ctrl = &adev->ctrl[adev->channels];
+		ctrl->dev = dev;
+		ctrl->chan = i;
+
+		rc = ata_ctrl_init(ctrl, &res[i]);
+		if (rc == EOK)
+			++adev->channels;
+	}
+
+	if (adev->channels == 0) {
 		ddf_msg(LVL_ERROR, "Failed initializing ATA controller.");
 		rc = EIO;
 		goto error;
@@ -283,20 +391,36 @@ error:
 
 static errno_t ata_dev_remove(ddf_dev_t *dev)
 {
-	ata_ctrl_t *ctrl = (ata_ctrl_t *)ddf_dev_data_get(dev);
+	ata_dev_t *adev = (ata_dev_t *)ddf_dev_data_get(dev);
+	unsigned i;
+	errno_t rc;
 
 	ddf_msg(LVL_DEBUG, "ata_dev_remove(%p)", dev);
 
-	return ata_ctrl_remove(ctrl);
+	for (i = 0; i < adev->channels; i++) {
+		rc = ata_ctrl_remove(&adev->ctrl[i]);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
 }
 
 static errno_t ata_dev_gone(ddf_dev_t *dev)
 {
-	ata_ctrl_t *ctrl = (ata_ctrl_t *)ddf_dev_data_get(dev);
+	ata_dev_t *adev = (ata_dev_t *)ddf_dev_data_get(dev);
+	unsigned i;
+	errno_t rc;
 
 	ddf_msg(LVL_DEBUG, "ata_dev_gone(%p)", dev);
 
-	return ata_ctrl_gone(ctrl);
+	for (i = 0; i < adev->channels; i++) {
+		rc = ata_ctrl_gone(&adev->ctrl[i]);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
 }
 
 static errno_t ata_fun_online(ddf_fun_t *fun)
@@ -0,0 +1,745 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup virtio-blk
+ * @{
+ */
+/** @file
+ * Virtio block device driver
+ *
+ * Requests are placed in up to VIRTIO_BLK_QUEUES_MAX virtqueues. Each
+ * request uses a single ring descriptor pointing to an indirect table if
+ * the device supports it. Large transfers are split into several requests
+ * which are kept in flight together, the device is notified once per batch
+ * and all completions are collected in one pass of the interrupt handler.
+ */
+
+#include <as.h>
+#include <assert.h>
+#include <ddf/driver.h>
+#include <ddf/interrupt.h>
+#include <ddf/log.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <mem.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include <virtio.h>
+#include "virtio-blk.h"
+
+#define NAME	"virtio-blk"
+
+#define VIRTIO_BLK_FUN_NAME	"a"
+
+static errno_t virtio_blk_dev_add(ddf_dev_t *);
+static errno_t virtio_blk_dev_remove(ddf_dev_t *);
+static errno_t virtio_blk_dev_gone(ddf_dev_t *);
+static errno_t virtio_blk_fun_online(ddf_fun_t *);
+static errno_t virtio_blk_fun_offline(ddf_fun_t *);
+
+static void virtio_blk_bd_connection(ipc_callid_t, ipc_call_t *, void *);
+
+static driver_ops_t driver_ops = {
+	.dev_add = virtio_blk_dev_add,
+	.dev_remove = virtio_blk_dev_remove,
+	.dev_gone = virtio_blk_dev_gone,
+	.fun_online = virtio_blk_fun_online,
+	.fun_offline = virtio_blk_fun_offline
+};
+
+static driver_t virtio_blk_driver = {
+	.name = NAME,
+	.driver_ops = &driver_ops
+};
+
+static errno_t virtio_blk_bd_open(bd_srvs_t *, bd_srv_t *);
+static errno_t virtio_blk_bd_close(bd_srv_t *);
+static errno_t virtio_blk_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *,
+    size_t);
+static errno_t virtio_blk_bd_write_blocks(bd_srv_t *, aoff64_t, size_t,
+    const void *, size_t);
+static errno_t virtio_blk_bd_get_block_size(bd_srv_t *, size_t *);
+static errno_t virtio_blk_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+static errno_t virtio_blk_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
+
+static bd_ops_t virtio_blk_bd_ops = {
+	.open = virtio_blk_bd_open,
+	.close = virtio_blk_bd_close,
+	.read_blocks = virtio_blk_bd_read_blocks,
+	.write_blocks = virtio_blk_bd_write_blocks,
+	.get_block_size = virtio_blk_bd_get_block_size,
+	.get_num_blocks = virtio_blk_bd_get_num_blocks,
+	.sync_cache = virtio_blk_bd_sync_cache
+};
+
+static virtio_blk_t *bd_srv_virtio_blk(bd_srv_t *bd)
+{
+	return (virtio_blk_t *) bd->srvs->sarg;
+}
+
+/** Collect completed requests of a queue.
+ *
+ * Drains the used ring, then re-enables the interrupt and drains again if
+ * more requests completed in the meantime.
+ */
+static void virtio_blk_queue_complete(virtio_blk_queue_t *q)
+{
+	virtq_t *vq = q->vq;
+	uint16_t head;
+	uint32_t len;
+	bool any = false;
+
+	fibril_mutex_lock(&vq->lock);
+
+	do {
+		while (virtio_virtq_consume_used(vq, &head, &len)) {
+			q->slot[q->desc_slot[head]].done = true;
+			virtio_virtq_desc_free(vq, head);
+			any = true;
+		}
+	} while (virtio_virtq_enable_interrupt(vq));
+
+	if (any)
+		fibril_condvar_broadcast(&q->done_cv);
+
+	fibril_mutex_unlock(&vq->lock);
+}
+
+static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) ddf_dev_data_get(dev);
+	unsigned i;
+
+	if ((VIRTIO_IRQ_GET_ISR(*icall) & VIRTIO_ISR_QUEUE) == 0)
+		return;
+
+	for (i = 0; i < vblk->nqueues; i++)
+		virtio_blk_queue_complete(&vblk->queue[i]);
+}
+
+/** Get a free request slot.
+ *
+ * The caller must hold the queue lock.
+ *
+ * @param q		Request queue
+ * @param wait		Wait for a slot to become free
+ * @return		Request slot or @c NULL if none is free and @a wait
+ *			is @c false
+ */
+static virtio_blk_slot_t *virtio_blk_slot_get(virtio_blk_queue_t *q,
+    bool wait)
+{
+	virtio_blk_slot_t *slot;
+
+	while (q->nfree == 0) {
+		if (!wait)
+			return NULL;
+		fibril_condvar_wait(&q->slot_cv, &q->vq->lock);
+	}
+
+	slot = &q->slot[q->free_slot[--q->nfree]];
+	slot->done = false;
+	return slot;
+}
+
+/** Return a request slot. The caller must hold the queue lock. */
+static void virtio_blk_slot_put(virtio_blk_queue_t *q, virtio_blk_slot_t *slot)
+{
+	q->free_slot[q->nfree++] = slot - q->slot;
+	fibril_condvar_signal(&q->slot_cv);
+}
+
+/** Place a request in the available ring.
+ *
+ * The device is not notified. The caller must hold the queue lock.
+ *
+ * @param vblk		Virtio block device
+ * @param q		Request queue
+ * @param slot		Request slot
+ * @param type		Request type
+ * @param sector	First sector
+ * @param size		Number of bytes to transfer from/to the slot buffer
+ */
+static void virtio_blk_submit(virtio_blk_t *vblk, virtio_blk_queue_t *q,
+    virtio_blk_slot_t *slot, uint32_t type, uint64_t sector, size_t size)
+{
+	virtq_t *vq = q->vq;
+	virtq_desc_t desc[3];
+	unsigned ndesc = 0;
+	uint16_t head;
+	errno_t rc;
+
+	slot->dma->hdr.type = type;
+	slot->dma->hdr.reserved = 0;
+	slot->dma->hdr.sector = sector;
+	slot->dma->status = 0xff;
+
+	desc[ndesc].addr = slot->dma_phys +
+	    offsetof(virtio_blk_req_dma_t, hdr);
+	desc[ndesc].len = sizeof(virtio_blk_req_hdr_t);
+	desc[ndesc].flags = 0;
+	ndesc++;
+
+	if (size > 0) {
+		desc[ndesc].addr = slot->buf_phys;
+		desc[ndesc].len = size;
+		desc[ndesc].flags = (type == VIRTIO_BLK_T_IN) ?
+		    VIRTQ_DESC_F_WRITE : 0;
+		ndesc++;
+	}
+
+	desc[ndesc].addr = slot->dma_phys +
+	    offsetof(virtio_blk_req_dma_t, status);
+	desc[ndesc].len = 1;
+	desc[ndesc].flags = VIRTQ_DESC_F_WRITE;
+	ndesc++;
+
+	/* Slots are sized so that there are always enough descriptors. */
+	rc = virtio_virtq_chain_add(vq, desc, ndesc,
+	    vblk->indirect ? slot->dma->indirect : NULL,
+	    slot->dma_phys + offsetof(virtio_blk_req_dma_t, indirect), &head);
+	assert(rc == EOK);
+	(void) rc;
+
+	q->desc_slot[head] = slot - q->slot;
+	virtio_virtq_produce_available(vq, head);
+}
+
+/** Pick a request queue for the next operation. */
+static virtio_blk_queue_t *virtio_blk_queue_pick(virtio_blk_t *vblk)
+{
+	unsigned i = vblk->next_queue;
+
+	vblk->next_queue = (i + 1) % vblk->nqueues;
+	return &vblk->queue[i];
+}
+
+/** Read or write blocks.
+ *
+ * The transfer is split into requests of at most VIRTIO_BLK_BUF_SIZE bytes,
+ * up to VIRTIO_BLK_PIPELINE of which are in flight at a time. A new slot is
+ * waited for only if no request of this operation is in flight, so that
+ * concurrent operations cannot starve each other of slots.
+ */
+static errno_t virtio_blk_rw(virtio_blk_t *vblk, bool write, aoff64_t ba,
+    size_t cnt, void *buf)
+{
+	virtio_blk_queue_t *q;
+	virtio_blk_slot_t *slot;
+	struct {
+		virtio_blk_slot_t *slot;
+		void *buf;
+		size_t size;
+	} pend[VIRTIO_BLK_PIPELINE];
+	unsigned first = 0;
+	unsigned npend = 0;
+	unsigned last;
+	size_t nblocks;
+	size_t size;
+	errno_t rc = EOK;
+
+	if (ba + cnt > vblk->blocks || ba + cnt < ba)
+		return ELIMIT;
+
+	q = virtio_blk_queue_pick(vblk);
+
+	fibril_mutex_lock(&q->vq->lock);
+
+	while (cnt > 0 || npend > 0) {
+		if (cnt > 0 && npend < VIRTIO_BLK_PIPELINE) {
+			slot = virtio_blk_slot_get(q, npend == 0);
+			if (slot != NULL) {
+				nblocks = min(cnt,
+				    VIRTIO_BLK_BUF_SIZE / vblk->block_size);
+				size = nblocks * vblk->block_size;
+
+				if (write)
+					memcpy(slot->buf, buf, size);
+
+				virtio_blk_submit(vblk, q, slot, write ?
+				    VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+				    ba * (vblk->block_size /
+				    VIRTIO_BLK_SECTOR_SIZE), size);
+
+				last = (first + npend) % VIRTIO_BLK_PIPELINE;
+				pend[last].slot = slot;
+				pend[last].buf = buf;
+				pend[last].size = size;
+				npend++;
+
+				ba += nblocks;
+				cnt -= nblocks;
+				buf += size;
+				continue;
+			}
+		}
+
+		/* Notify the device once for the whole batch. */
+		virtio_virtq_kick(q->vq);
+
+		slot = pend[first].slot;
+		while (!slot->done)
+			fibril_condvar_wait(&q->done_cv, &q->vq->lock);
+
+		if (slot->dma->status != VIRTIO_BLK_S_OK) {
+			ddf_msg(LVL_ERROR, "Request failed with status %u.",
+			    slot->dma->status);
+			rc = EIO;
+			/* Do not issue any more requests. */
+			cnt = 0;
+		} else if (!write) {
+			memcpy(pend[first].buf, slot->buf, pend[first].size);
+		}
+
+		virtio_blk_slot_put(q, slot);
+		first = (first + 1) % VIRTIO_BLK_PIPELINE;
+		npend--;
+	}
+
+	fibril_mutex_unlock(&q->vq->lock);
+	return rc;
+}
+
+static errno_t virtio_blk_bd_open(bd_srvs_t *bds, bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t virtio_blk_bd_close(bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t virtio_blk_bd_read_blocks(bd_srv_t *bd, aoff64_t ba,
+    size_t cnt, void *buf, size_t size)
+{
+	virtio_blk_t *vblk = bd_srv_virtio_blk(bd);
+
+	if (size < cnt * vblk->block_size)
+		return EINVAL;
+
+	return virtio_blk_rw(vblk, false, ba, cnt, buf);
+}
+
+static errno_t virtio_blk_bd_write_blocks(bd_srv_t *bd, aoff64_t ba,
+    size_t cnt, const void *buf, size_t size)
+{
+	virtio_blk_t *vblk = bd_srv_virtio_blk(bd);
+
+	if (vblk->ro)
+		return EROFS;
+
+	if (size < cnt * vblk->block_size)
+		return EINVAL;
+
+	return virtio_blk_rw(vblk, true, ba, cnt, (void *) buf);
+}
+
+static errno_t virtio_blk_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
+{
+	virtio_blk_t *vblk = bd_srv_virtio_blk(bd);
+
+	*rsize = vblk->block_size;
+	return EOK;
+}
+
+static errno_t virtio_blk_bd_get_num_blocks(bd_srv_t *bd, aoff64_t *rnb)
+{
+	virtio_blk_t *vblk = bd_srv_virtio_blk(bd);
+
+	*rnb = vblk->blocks;
+	return EOK;
+}
+
+/** Flush the volatile write cache of the device. */
+static errno_t virtio_blk_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	virtio_blk_t *vblk = bd_srv_virtio_blk(bd);
+	virtio_blk_queue_t *q;
+	virtio_blk_slot_t *slot;
+	errno_t rc;
+
+	/* Without the flush feature, the device has no write cache. */
+	if (!vblk->flush)
+		return EOK;
+
+	q = virtio_blk_queue_pick(vblk);
+
+	fibril_mutex_lock(&q->vq->lock);
+
+	slot = virtio_blk_slot_get(q, true);
+	virtio_blk_submit(vblk, q, slot, VIRTIO_BLK_T_FLUSH, 0, 0);
+	virtio_virtq_kick(q->vq);
+
+	while (!slot->done)
+		fibril_condvar_wait(&q->done_cv, &q->vq->lock);
+
+	rc = (slot->dma->status == VIRTIO_BLK_S_OK) ? EOK : EIO;
+	virtio_blk_slot_put(q, slot);
+
+	fibril_mutex_unlock(&q->vq->lock);
+	return rc;
+}
+
+/** Set up a request queue on top of virtqueue @a num. */
+static errno_t virtio_blk_queue_init(virtio_blk_t *vblk, unsigned num)
+{
+	virtio_blk_queue_t *q = &vblk->queue[num];
+	virtio_dev_t *vdev = &vblk->virtio_dev;
+	unsigned per_req;
+	unsigned i;
+	errno_t rc;
+
+	rc = virtio_pci_virtq_setup(vdev, num);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed setting up virtqueue %u: %s", num,
+		    str_error(rc));
+		return rc;
+	}
+
+	q->vq = &vdev->queue[num];
+	fibril_condvar_initialize(&q->done_cv);
+	fibril_condvar_initialize(&q->slot_cv);
+
+	/* Make sure that every slot can always get its descriptors. */
+	per_req = vblk->indirect ? 1 : 3;
+	q->nslots = min(VIRTIO_BLK_SLOTS, q->vq->queue_size / per_req);
+	if (q->nslots == 0)
+		return EINVAL;
+
+	q->desc_slot = calloc(q->vq->queue_size, sizeof(uint16_t));
+	if (q->desc_slot == NULL)
+		return ENOMEM;
+
+	q->req_dma = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(q->nslots * sizeof(virtio_blk_req_dma_t),
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &q->req_dma_phys,
+	    &q->req_dma);
+	if (rc != EOK) {
+		q->req_dma = NULL;
+		return rc;
+	}
+
+	q->buf_dma = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(q->nslots * VIRTIO_BLK_BUF_SIZE,
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &q->buf_dma_phys,
+	    &q->buf_dma);
+	if (rc != EOK) {
+		q->buf_dma = NULL;
+		return rc;
+	}
+
+	for (i = 0; i < q->nslots; i++) {
+		q->slot[i].dma = (virtio_blk_req_dma_t *) q->req_dma + i;
+		q->slot[i].dma_phys = q->req_dma_phys +
+		    i * sizeof(virtio_blk_req_dma_t);
+		q->slot[i].buf = (uint8_t *) q->buf_dma +
+		    i * VIRTIO_BLK_BUF_SIZE;
+		q->slot[i].buf_phys = q->buf_dma_phys +
+		    i * VIRTIO_BLK_BUF_SIZE;
+		q->free_slot[i] = i;
+	}
+
+	q->nfree = q->nslots;
+	return EOK;
+}
+
+static void virtio_blk_queue_fini(virtio_blk_queue_t *q)
+{
+	if (q->buf_dma != NULL)
+		dmamem_unmap_anonymous(q->buf_dma);
+	if (q->req_dma != NULL)
+		dmamem_unmap_anonymous(q->req_dma);
+	free(q->desc_slot);
+}
+
+/** Release all resources of the device. */
+static void virtio_blk_fini(virtio_blk_t *vblk)
+{
+	unsigned i;
+
+	if (vblk->virtio_dev.irq_cap != CAP_NIL) {
+		unregister_interrupt_handler(vblk->dev,
+		    vblk->virtio_dev.irq_cap);
+		vblk->virtio_dev.irq_cap = CAP_NIL;
+	}
+
+	virtio_pci_dev_cleanup(&vblk->virtio_dev);
+
+	if (vblk->queue != NULL) {
+		for (i = 0; i < vblk->nqueues; i++)
+			virtio_blk_queue_fini(&vblk->queue[i]);
+		free(vblk->queue);
+		vblk->queue = NULL;
+	}
+}
+
+/** Negotiate features, read the configuration and set up the queues. */
+static errno_t virtio_blk_init(virtio_blk_t *vblk)
+{
+	virtio_dev_t *vdev = &vblk->virtio_dev;
+	uint32_t features;
+	unsigned nqueues;
+	unsigned i;
+	errno_t rc;
+
+	rc = virtio_pci_dev_initialize(vblk->dev, vdev);
+	if (rc != EOK)
+		return rc;
+
+	features = virtio_pci_negotiate(vdev,
+	    VIRTIO_FEATURE(VIRTIO_BLK_F_RO) |
+	    VIRTIO_FEATURE(VIRTIO_BLK_F_BLK_SIZE) |
+	    VIRTIO_FEATURE(VIRTIO_BLK_F_FLUSH) |
+	    VIRTIO_FEATURE(VIRTIO_BLK_F_MQ) |
+	    VIRTIO_FEATURE(VIRTIO_F_RING_INDIRECT_DESC) |
+	    VIRTIO_FEATURE(VIRTIO_F_RING_EVENT_IDX));
+
+	vblk->ro = (features & VIRTIO_FEATURE(VIRTIO_BLK_F_RO)) != 0;
+	vblk->flush = (features & VIRTIO_FEATURE(VIRTIO_BLK_F_FLUSH)) != 0;
+	vblk->indirect =
+	    (features & VIRTIO_FEATURE(VIRTIO_F_RING_INDIRECT_DESC)) != 0;
+
+	vblk->block_size = VIRTIO_BLK_SECTOR_SIZE;
+	if ((features & VIRTIO_FEATURE(VIRTIO_BLK_F_BLK_SIZE)) != 0) {
+		vblk->block_size = virtio_pci_config_read_32(vdev,
+		    VIRTIO_BLK_CFG_BLK_SIZE);
+	}
+
+	if (vblk->block_size < VIRTIO_BLK_SECTOR_SIZE ||
+	    vblk->block_size > VIRTIO_BLK_BUF_SIZE ||
+	    vblk->block_size % VIRTIO_BLK_SECTOR_SIZE != 0) {
+		ddf_msg(LVL_ERROR, "Unsupported block size %zu.",
+		    vblk->block_size);
+		rc = ENOTSUP;
+		goto error;
+	}
+
+	vblk->blocks = virtio_pci_config_read_64(vdev,
+	    VIRTIO_BLK_CFG_CAPACITY) /
+	    (vblk->block_size / VIRTIO_BLK_SECTOR_SIZE);
+
+	nqueues = 1;
+	if ((features & VIRTIO_FEATURE(VIRTIO_BLK_F_MQ)) != 0) {
+		nqueues = virtio_pci_config_read_16(vdev,
+		    VIRTIO_BLK_CFG_NUM_QUEUES);
+		nqueues = max(1, min(nqueues, VIRTIO_BLK_QUEUES_MAX));
+	}
+
+	rc = virtio_pci_virtq_alloc(vdev, nqueues);
+	if (rc != EOK)
+		goto error;
+
+	vblk->queue = calloc(nqueues, sizeof(virtio_blk_queue_t));
+	if (vblk->queue == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	vblk->nqueues = nqueues;
+	vblk->next_queue = 0;
+
+	for (i = 0; i < nqueues; i++) {
+		rc = virtio_blk_queue_init(vblk, i);
+		if (rc != EOK)
+			goto error;
+	}
+
+	rc = virtio_pci_register_interrupt(vdev, vblk->dev,
+	    virtio_blk_irq_handler);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed registering interrupt handler.");
+		goto error;
+	}
+
+	virtio_pci_dev_ready(vdev);
+
+	ddf_msg(LVL_NOTE, "%" PRIu64 " blocks of %zu bytes, %u queue(s)%s%s%s",
+	    vblk->blocks, vblk->block_size, vblk->nqueues,
+	    vblk->indirect ? ", indirect descriptors" : "",
+	    vdev->queue[0].event_idx ? ", event index" : "",
+	    vblk->ro ? ", read-only" : "");
+
+	return EOK;
+error:
+	virtio_pci_dev_fail(vdev);
+	virtio_blk_fini(vblk);
+	return rc;
+}
+
+static errno_t virtio_blk_fun_create(virtio_blk_t *vblk)
+{
+	errno_t rc;
+	ddf_fun_t *fun = NULL;
+
+	fun = ddf_fun_create(vblk->dev, fun_exposed, VIRTIO_BLK_FUN_NAME);
+	if (fun == NULL) {
+		ddf_msg(LVL_ERROR, "Failed creating DDF function.");
+		rc = ENOMEM;
+		goto error;
+	}
+
+	/* Set up a connection handler. */
+	ddf_fun_set_conn_handler(fun, virtio_blk_bd_connection);
+
+	rc = ddf_fun_bind(fun);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed binding DDF function %s: %s",
+		    VIRTIO_BLK_FUN_NAME, str_error(rc));
+		goto error;
+	}
+
+	ddf_fun_add_to_category(fun, "disk");
+	vblk->fun = fun;
+
+	return EOK;
+error:
+	if (fun != NULL)
+		ddf_fun_destroy(fun);
+
+	return rc;
+}
+
+/** Add new device
+ *
+ * @param  dev New device
+ * @return     EOK on success or an error code.
+ */
+static errno_t virtio_blk_dev_add(ddf_dev_t *dev)
+{
+	virtio_blk_t *vblk;
+	errno_t rc;
+
+	vblk = ddf_dev_data_alloc(dev, sizeof(virtio_blk_t));
+	if (vblk == NULL) {
+		ddf_msg(LVL_ERROR, "Failed allocating soft state.");
+		return ENOMEM;
+	}
+
+	vblk->dev = dev;
+
+	bd_srvs_init(&vblk->bds);
+	vblk->bds.ops = &virtio_blk_bd_ops;
+	vblk->bds.sarg = vblk;
+
+	rc = virtio_blk_init(vblk);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed initializing device: %s",
+		    str_error(rc));
+		return rc;
+	}
+
+	rc = virtio_blk_fun_create(vblk);
+	if (rc != EOK) {
+		virtio_blk_fini(vblk);
+		return rc;
+	}
+
+	return EOK;
+}
+
+static errno_t virtio_blk_dev_remove_common(virtio_blk_t *vblk, bool surprise)
+{
+	errno_t rc;
+
+	if (vblk->fun != NULL) {
+		if (!surprise) {
+			rc = ddf_fun_offline(vblk->fun);
+			if (rc != EOK) {
+				ddf_msg(LVL_ERROR, "Error offlining function "
+				    "'%s'.", VIRTIO_BLK_FUN_NAME);
+				return rc;
+			}
+		}
+
+		rc = ddf_fun_unbind(vblk->fun);
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "Failed unbinding function '%s'.",
+			    VIRTIO_BLK_FUN_NAME);
+			return rc;
+		}
+
+		ddf_fun_destroy(vblk->fun);
+		vblk->fun = NULL;
+	}
+
+	virtio_blk_fini(vblk);
+	return EOK;
+}
+
+static errno_t virtio_blk_dev_remove(ddf_dev_t *dev)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) ddf_dev_data_get(dev);
+
+	ddf_msg(LVL_DEBUG, "virtio_blk_dev_remove(%p)", dev);
+	return virtio_blk_dev_remove_common(vblk, false);
+}
+
+static errno_t virtio_blk_dev_gone(ddf_dev_t *dev)
+{
+	virtio_blk_t *vblk = (virtio_blk_t *) ddf_dev_data_get(dev);
+
+	ddf_msg(LVL_DEBUG, "virtio_blk_dev_gone(%p)", dev);
+	return virtio_blk_dev_remove_common(vblk, true);
+}
+
+static errno_t virtio_blk_fun_online(ddf_fun_t *fun)
+{
+	ddf_msg(LVL_DEBUG, "virtio_blk_fun_online()");
+	return ddf_fun_online(fun);
+}
+
+static errno_t virtio_blk_fun_offline(ddf_fun_t *fun)
+{
+	ddf_msg(LVL_DEBUG, "virtio_blk_fun_offline()");
+	return ddf_fun_offline(fun);
+}
+
+/** Block device connection handler */
+static void virtio_blk_bd_connection(ipc_callid_t iid, ipc_call_t *icall,
+    void *arg)
+{
+	virtio_blk_t *vblk;
+	ddf_fun_t *fun = (ddf_fun_t *) arg;
+
+	vblk = (virtio_blk_t *) ddf_dev_data_get(ddf_fun_get_dev(fun));
+	bd_conn(iid, icall, &vblk->bds);
+}
+
+int main(int argc, char *argv[])
+{
+	printf(NAME ": HelenOS virtio block device driver\n");
+	ddf_log_init(NAME);
+	return ddf_driver_main(&virtio_blk_driver);
+}
+
+/** @}
+ */
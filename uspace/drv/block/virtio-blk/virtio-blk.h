@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup virtio-blk
+ * @{
+ */
+/** @file
+ * Virtio block device driver definitions
+ */
+
+#ifndef _VIRTIO_BLK_H_
+#define _VIRTIO_BLK_H_
+
+#include <bd_srv.h>
+#include <ddf/driver.h>
+#include <fibril_synch.h>
+#include <virtio.h>
+
+/** Device feature bits */
+#define VIRTIO_BLK_F_SIZE_MAX	1
+#define VIRTIO_BLK_F_SEG_MAX	2
+#define VIRTIO_BLK_F_GEOMETRY	4
+#define VIRTIO_BLK_F_RO		5
+#define VIRTIO_BLK_F_BLK_SIZE	6
+#define VIRTIO_BLK_F_FLUSH	9
+#define VIRTIO_BLK_F_MQ		12
+
+/** Offsets in the device configuration */
+#define VIRTIO_BLK_CFG_CAPACITY		0x00
+#define VIRTIO_BLK_CFG_BLK_SIZE		0x14
+#define VIRTIO_BLK_CFG_NUM_QUEUES	0x22
+
+/** Request types */
+#define VIRTIO_BLK_T_IN		0
+#define VIRTIO_BLK_T_OUT	1
+#define VIRTIO_BLK_T_FLUSH	4
+
+/** Request status */
+#define VIRTIO_BLK_S_OK		0
+#define VIRTIO_BLK_S_IOERR	1
+#define VIRTIO_BLK_S_UNSUPP	2
+
+/** Capacity and request sectors are always in 512-byte units. */
+#define VIRTIO_BLK_SECTOR_SIZE	512
+
+/** Maximum number of request queues used */
+#define VIRTIO_BLK_QUEUES_MAX	4
+/** Maximum number of requests in flight per queue */
+#define VIRTIO_BLK_SLOTS	16
+/** Size of the data buffer of a request */
+#define VIRTIO_BLK_BUF_SIZE	0x8000
+/** Maximum number of requests in flight per block device operation */
+#define VIRTIO_BLK_PIPELINE	4
+
+/** Request header */
+typedef struct {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t sector;
+} virtio_blk_req_hdr_t;
+
+/** Per-request DMA memory: indirect descriptor table, header and status */
+typedef struct {
+	virtq_desc_t indirect[3];
+	virtio_blk_req_hdr_t hdr;
+	uint8_t status;
+	uint8_t pad[15];
+} virtio_blk_req_dma_t;
+
+/** Request slot */
+typedef struct {
+	virtio_blk_req_dma_t *dma;
+	uintptr_t dma_phys;
+	/** Data buffer */
+	void *buf;
+	uintptr_t buf_phys;
+	/** The device has completed the request */
+	bool done;
+} virtio_blk_slot_t;
+
+/** Request queue */
+typedef struct {
+	/** Virtqueue, its lock protects the whole request queue */
+	virtq_t *vq;
+
+	/** Signalled when requests complete */
+	fibril_condvar_t done_cv;
+	/** Signalled when a slot is freed */
+	fibril_condvar_t slot_cv;
+
+	/** Request slots */
+	virtio_blk_slot_t slot[VIRTIO_BLK_SLOTS];
+	unsigned nslots;
+	/** Stack of free slot numbers */
+	unsigned free_slot[VIRTIO_BLK_SLOTS];
+	unsigned nfree;
+	/** Slot number of the request using a descriptor as its head */
+	uint16_t *desc_slot;
+
+	/** DMA memory of the request slots */
+	void *req_dma;
+	uintptr_t req_dma_phys;
+	void *buf_dma;
+	uintptr_t buf_dma_phys;
+} virtio_blk_queue_t;
+
+/** Virtio block device */
+typedef struct {
+	ddf_dev_t *dev;
+	ddf_fun_t *fun;
+	virtio_dev_t virtio_dev;
+	bd_srvs_t bds;
+
+	/** Number of blocks */
+	uint64_t blocks;
+	/** Block size */
+	size_t block_size;
+	/** Device is read-only */
+	bool ro;
+	/** Device supports the flush command */
+	bool flush;
+	/** Use indirect descriptors */
+	bool indirect;
+
+	/** Request queues */
+	virtio_blk_queue_t *queue;
+	unsigned nqueues;
+	/** Queue to use for the next operation */
+	unsigned next_queue;
+} virtio_blk_t;
+
+#endif
+
+/** @}
+ */
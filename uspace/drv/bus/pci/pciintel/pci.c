@@ -650,8 +650,12 @@ void pci_bus_scan(pci_bus_t *bus, int bus_num)
 			}
 			
 			pci_alloc_resource_list(fun);
-			pci_read_bars(fun);
-			pci_read_interrupt(fun);
+			if (pci_fun_is_ide_compat(fun)) {
+				pci_read_ide_compat(fun);
+			} else {
+				pci_read_bars(fun);
+				pci_read_interrupt(fun);
+			}
 
 			/* Propagate the PIO window to the function. */
 			fun->pio_window = bus->pio_win;
@@ -907,6 +911,57 @@ void pci_read_bars(pci_fun_t *fun)
 		addr = pci_read_bar(fun, addr);
 }
 
+/** Determine whether the function is an IDE controller in compatibility mode.
+ *
+ * A channel of an IDE controller in compatibility mode does not decode the
+ * addresses in its BARs and uses the legacy ISA I/O ports and IRQ instead.
+ * The legacy channels are not listed in isa.dev, so they must be exported
+ * here even if only one of the channels is in compatibility mode.
+ *
+ * @param fun	PCI function
+ * @return	@c true if the function is an IDE controller with at least one
+ *		channel in compatibility mode
+ */
+bool pci_fun_is_ide_compat(pci_fun_t *fun)
+{
+	return fun->class_code == PCI_CLASS_MASS_STORAGE &&
+	    fun->subclass_code == PCI_SUBCLASS_IDE &&
+	    (fun->prog_if & (PCI_IDE_PRI_NATIVE | PCI_IDE_SEC_NATIVE)) !=
+	    (PCI_IDE_PRI_NATIVE | PCI_IDE_SEC_NATIVE);
+}
+
+/** Add HW resources of a compatibility mode IDE controller.
+ *
+ * Only channels in compatibility mode are exported. The resources are listed
+ * in a fixed order: command and control block of each such channel, the bus
+ * master registers (if the controller implements BAR4) and finally the IRQ
+ * of each such channel, primary channel first.
+ *
+ * @param fun	PCI function
+ */
+void pci_read_ide_compat(pci_fun_t *fun)
+{
+	bool pri = (fun->prog_if & PCI_IDE_PRI_NATIVE) == 0;
+	bool sec = (fun->prog_if & PCI_IDE_SEC_NATIVE) == 0;
+
+	if (pri) {
+		pci_add_range(fun, 0x1f0, 8, true);
+		pci_add_range(fun, 0x3f0, 8, true);
+	}
+
+	if (sec) {
+		pci_add_range(fun, 0x170, 8, true);
+		pci_add_range(fun, 0x370, 8, true);
+	}
+
+	(void) pci_read_bar(fun, PCI_BASE_ADDR_4);
+
+	if (pri)
+		pci_add_interrupt(fun, 14);
+	if (sec)
+		pci_add_interrupt(fun, 15);
+}
+
 size_t pci_bar_mask_to_size(uint32_t mask)
 {
 	size_t size = mask & ~(mask - 1);
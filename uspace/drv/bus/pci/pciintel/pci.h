@@ -95,6 +95,8 @@ extern bool pci_alloc_resource_list(pci_fun_t *);
 extern void pci_clean_resource_list(pci_fun_t *);
 
 extern void pci_read_bars(pci_fun_t *);
+extern bool pci_fun_is_ide_compat(pci_fun_t *);
+extern void pci_read_ide_compat(pci_fun_t *);
 extern size_t pci_bar_mask_to_size(uint32_t);
 
 #endif
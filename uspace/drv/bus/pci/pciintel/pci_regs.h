@@ -94,6 +94,16 @@
 #define PCI_BRIDGE_INT_PIN		0x3D
 #define PCI_BRIDGE_CTL			0x3E
 
+/* Class codes */
+#define PCI_CLASS_MASS_STORAGE	0x01
+
+/* Mass storage subclass codes */
+#define PCI_SUBCLASS_IDE	0x01
+
+/* IDE programming interface flags */
+#define PCI_IDE_PRI_NATIVE	0x01
+#define PCI_IDE_SEC_NATIVE	0x04
+
 /* PCI command flags */
 #define PCI_COMMAND_IO            0x001
 #define PCI_COMMAND_MEMORY        0x002
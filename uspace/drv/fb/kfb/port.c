@@ -73,6 +73,7 @@ typedef struct {
 	visual_t visual;
 	
 	pixel2visual_t pixel2visual;
+	pixel2visual_row_t pixel2visual_row;
 	visual2pixel_t visual2pixel;
 	visual_mask_t visual_mask;
 	size_t pixel_bytes;
@@ -117,18 +118,26 @@ static errno_t kfb_handle_damage_pixels(visualizer_t *vs,
 	if (x_offset == 0 && y_offset == 0) {
 		/* Faster damage routine ignoring offsets. */
 		for (sysarg_t y = y0; y < height + y0; ++y) {
-			pixel_t *pixel = pixelmap_pixel_at(map, x0, y);
-			for (sysarg_t x = x0; x < width + x0; ++x) {
-				kfb.pixel2visual(kfb.addr + FB_POS(x, y), *pixel++);
-			}
+			kfb.pixel2visual_row(kfb.addr + FB_POS(x0, y),
+			    pixelmap_pixel_at(map, x0, y), width);
 		}
 	} else {
 		for (sysarg_t y = y0; y < height + y0; ++y) {
-			for (sysarg_t x = x0; x < width + x0; ++x) {
-				kfb.pixel2visual(kfb.addr + FB_POS(x, y),
-				    *pixelmap_pixel_at(map,
-				    (x + x_offset) % map->width,
-				    (y + y_offset) % map->height));
+			sysarg_t y_map = (y + y_offset) % map->height;
+			sysarg_t x_map = (x0 + x_offset) % map->width;
+			sysarg_t x = x0;
+
+			/* Convert the row in pieces that do not wrap around. */
+			while (x < width + x0) {
+				sysarg_t count = map->width - x_map;
+				if (count > width + x0 - x)
+					count = width + x0 - x;
+
+				kfb.pixel2visual_row(kfb.addr + FB_POS(x, y),
+				    pixelmap_pixel_at(map, x_map, y_map), count);
+
+				x += count;
+				x_map = 0;
 			}
 		}
 	}
@@ -234,66 +243,77 @@ errno_t port_init(ddf_dev_t *dev)
 	switch (visual) {
 	case VISUAL_INDIRECT_8:
 		kfb.pixel2visual = pixel2bgr_323;
+		kfb.pixel2visual_row = pixel2bgr_323_row;
 		kfb.visual2pixel = bgr_323_2pixel;
 		kfb.visual_mask = visual_mask_323;
 		kfb.pixel_bytes = 1;
 		break;
 	case VISUAL_RGB_5_5_5_LE:
 		kfb.pixel2visual = pixel2rgb_555_le;
+		kfb.pixel2visual_row = pixel2rgb_555_le_row;
 		kfb.visual2pixel = rgb_555_le_2pixel;
 		kfb.visual_mask = visual_mask_555;
 		kfb.pixel_bytes = 2;
 		break;
 	case VISUAL_RGB_5_5_5_BE:
 		kfb.pixel2visual = pixel2rgb_555_be;
+		kfb.pixel2visual_row = pixel2rgb_555_be_row;
 		kfb.visual2pixel = rgb_555_be_2pixel;
 		kfb.visual_mask = visual_mask_555;
 		kfb.pixel_bytes = 2;
 		break;
 	case VISUAL_RGB_5_6_5_LE:
 		kfb.pixel2visual = pixel2rgb_565_le;
+		kfb.pixel2visual_row = pixel2rgb_565_le_row;
 		kfb.visual2pixel = rgb_565_le_2pixel;
 		kfb.visual_mask = visual_mask_565;
 		kfb.pixel_bytes = 2;
 		break;
 	case VISUAL_RGB_5_6_5_BE:
 		kfb.pixel2visual = pixel2rgb_565_be;
+		kfb.pixel2visual_row = pixel2rgb_565_be_row;
 		kfb.visual2pixel = rgb_565_be_2pixel;
 		kfb.visual_mask = visual_mask_565;
 		kfb.pixel_bytes = 2;
 		break;
 	case VISUAL_RGB_8_8_8:
 		kfb.pixel2visual = pixel2rgb_888;
+		kfb.pixel2visual_row = pixel2rgb_888_row;
 		kfb.visual2pixel = rgb_888_2pixel;
 		kfb.visual_mask = visual_mask_888;
 		kfb.pixel_bytes = 3;
 		break;
 	case VISUAL_BGR_8_8_8:
 		kfb.pixel2visual = pixel2bgr_888;
+		kfb.pixel2visual_row = pixel2bgr_888_row;
 		kfb.visual2pixel = bgr_888_2pixel;
 		kfb.visual_mask = visual_mask_888;
 		kfb.pixel_bytes = 3;
 		break;
 	case VISUAL_RGB_8_8_8_0:
 		kfb.pixel2visual = pixel2rgb_8880;
+		kfb.pixel2visual_row = pixel2rgb_8880_row;
 		kfb.visual2pixel = rgb_8880_2pixel;
 		kfb.visual_mask = visual_mask_8880;
 		kfb.pixel_bytes = 4;
 		break;
 	case VISUAL_RGB_0_8_8_8:
 		kfb.pixel2visual = pixel2rgb_0888;
+		kfb.pixel2visual_row = pixel2rgb_0888_row;
 		kfb.visual2pixel = rgb_0888_2pixel;
 		kfb.visual_mask = visual_mask_0888;
 		kfb.pixel_bytes = 4;
 		break;
 	case VISUAL_BGR_0_8_8_8:
 		kfb.pixel2visual = pixel2bgr_0888;
+		kfb.pixel2visual_row = pixel2bgr_0888_row;
 		kfb.visual2pixel = bgr_0888_2pixel;
 		kfb.visual_mask = visual_mask_0888;
 		kfb.pixel_bytes = 4;
 		break;
 	case VISUAL_BGR_8_8_8_0:
 		kfb.pixel2visual = pixel2bgr_8880;
+		kfb.pixel2visual_row = pixel2bgr_8880_row;
 		kfb.visual2pixel = bgr_8880_2pixel;
 		kfb.visual_mask = visual_mask_8880;
 		kfb.pixel_bytes = 4;
@@ -1176,16 +1176,12 @@ static void e1000_receive_frames(nic_t *nic)
 	e1000_rx_descriptor_t *rx_descriptor = (e1000_rx_descriptor_t *)
 	    (e1000->rx_ring_virt + next_tail * sizeof(e1000_rx_descriptor_t));
 	
+	nic_rx_batch_begin(nic);
+	
 	while (rx_descriptor->status & 0x01) {
 		uint32_t frame_size = rx_descriptor->length - E1000_CRC_SIZE;
 		
-		nic_frame_t *frame = nic_alloc_frame(nic, frame_size);
-		if (frame != NULL) {
-			memcpy(frame->data, e1000->rx_frame_virt[next_tail], frame_size);
-			nic_received_frame(nic, frame);
-		} else {
-			ddf_msg(LVL_ERROR, "Memory allocation failed. Frame dropped.");
-		}
+		nic_rx_batch_add(nic, e1000->rx_frame_virt[next_tail], frame_size);
 		
 		e1000_fill_new_rx_descriptor(nic, next_tail);
 		
@@ -1196,6 +1192,8 @@ static void e1000_receive_frames(nic_t *nic)
 		    (e1000->rx_ring_virt + next_tail * sizeof(e1000_rx_descriptor_t));
 	}
 	
+	nic_rx_batch_end(nic);
+	
 	fibril_mutex_unlock(&e1000->rx_lock);
 }
 
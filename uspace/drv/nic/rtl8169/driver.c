@@ -978,8 +978,6 @@ static void rtl8169_receive_done(ddf_dev_t *dev)
 	nic_t *nic_data = nic_get_from_ddf_dev(dev);
 	rtl8169_t *rtl8169 = nic_get_specific(nic_data);
 	rtl8169_descr_t *descr;
-	nic_frame_list_t *frames = nic_alloc_frame_list();
-	nic_frame_t *frame;
 	void *buffer;
 	unsigned int tail, fsidx = 0;
 	int frame_size;
@@ -990,6 +988,8 @@ static void rtl8169_receive_done(ddf_dev_t *dev)
 
 	tail = rtl8169->rx_tail;
 
+	nic_rx_batch_begin(nic_data);
+
 	for (;;) {
 		descr = &rtl8169->rx_ring[tail];
 
@@ -1013,22 +1013,19 @@ static void rtl8169_receive_done(ddf_dev_t *dev)
 
 			frame_size = descr->control & 0x1fff;
 			buffer = rtl8169->rx_buff + (BUFFER_SIZE * tail);
-			frame = nic_alloc_frame(nic_data, frame_size);
-			memcpy(frame->data, buffer, frame_size);
-			nic_frame_list_append(frames, frame);
+			nic_rx_batch_add(nic_data, buffer, frame_size);
 		}
 
 		tail = (tail + 1) % RX_BUFFERS_COUNT;
 	}
 
+	nic_rx_batch_end(nic_data);
+
 	rtl8169_rx_ring_refill(rtl8169, rtl8169->rx_tail, tail);
 
 	rtl8169->rx_tail = tail;
 
 	fibril_mutex_unlock(&rtl8169->rx_lock);
-
-	nic_received_frame_list(nic_data, frames);
-
 }
 
 static void rtl8169_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
@@ -0,0 +1,663 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup virtio-net
+ * @{
+ */
+/** @file
+ * Virtio network device driver
+ *
+ * Up to VIRTIO_NET_PAIRS_MAX receive/transmit queue pairs are used if the
+ * device supports multiqueue. Every receive queue is kept full of buffers,
+ * received frames are drained from all queues in one pass of the interrupt
+ * handler, handed over to libnic as one batch and the buffers are reposted
+ * with a single notification per queue. Transmitted buffers are reclaimed
+ * lazily, so the device rarely needs to interrupt for them.
+ */
+
+#include <as.h>
+#include <assert.h>
+#include <async.h>
+#include <ddf/driver.h>
+#include <ddf/interrupt.h>
+#include <ddf/log.h>
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <nic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include <virtio.h>
+#include "virtio-net.h"
+
+#define NAME	"virtio-net"
+
+/** Number of attempts when polling for a control command to complete */
+#define VIRTIO_NET_CTRL_RETRIES	1000
+/** Delay between the attempts in microseconds */
+#define VIRTIO_NET_CTRL_DELAY	1000
+
+static ddf_dev_ops_t virtio_net_dev_ops;
+
+static errno_t virtio_net_dev_add(ddf_dev_t *);
+
+static nic_iface_t virtio_net_nic_iface;
+
+static driver_ops_t virtio_net_driver_ops = {
+	.dev_add = virtio_net_dev_add
+};
+
+static driver_t virtio_net_driver = {
+	.name = NAME,
+	.driver_ops = &virtio_net_driver_ops
+};
+
+/** Make a buffer available to the device.
+ *
+ * The virtio header and the frame are described by separate descriptors,
+ * as the legacy interface requires without VIRTIO_F_ANY_LAYOUT.
+ *
+ * @param vnet		Virtio network device
+ * @param q		Queue
+ * @param bufno		Buffer number
+ * @param len		Length of the frame (or the room for it)
+ * @param rx		@c true if the device writes into the buffer
+ * @return		EOK on success, ENOMEM if there are no free descriptors
+ */
+static errno_t virtio_net_buf_post(virtio_net_t *vnet, virtio_net_queue_t *q,
+    unsigned bufno, size_t len, bool rx)
+{
+	uintptr_t phys = q->buf_phys + bufno * VIRTIO_NET_BUF_SIZE;
+	virtq_desc_t desc[2];
+	uint16_t head;
+	errno_t rc;
+
+	desc[0].addr = phys;
+	desc[0].len = sizeof(virtio_net_hdr_t);
+	desc[0].flags = rx ? VIRTQ_DESC_F_WRITE : 0;
+	desc[1].addr = phys + sizeof(virtio_net_hdr_t);
+	desc[1].len = len;
+	desc[1].flags = rx ? VIRTQ_DESC_F_WRITE : 0;
+
+	rc = virtio_virtq_chain_add(q->vq, desc, 2,
+	    vnet->indirect ? &q->ind[2 * bufno] : NULL,
+	    q->ind_phys + 2 * bufno * sizeof(virtq_desc_t), &head);
+	if (rc != EOK)
+		return rc;
+
+	q->desc_buf[head] = bufno;
+	virtio_virtq_produce_available(q->vq, head);
+	return EOK;
+}
+
+/** Take a used buffer from the device.
+ *
+ * @param q		Queue
+ * @param bufno		Place to store the buffer number
+ * @param len		Place to store the number of bytes written by device
+ * @return		@c true if a buffer was returned
+ */
+static bool virtio_net_buf_reclaim(virtio_net_queue_t *q, unsigned *bufno,
+    uint32_t *len)
+{
+	uint16_t descno;
+
+	if (!virtio_virtq_consume_used(q->vq, &descno, len))
+		return false;
+
+	*bufno = q->desc_buf[descno];
+	virtio_virtq_desc_free(q->vq, descno);
+
+	return true;
+}
+
+/** Reclaim all transmitted buffers.
+ *
+ * @param q		Transmit queue, locked
+ */
+static void virtio_net_tx_reclaim(virtio_net_queue_t *q)
+{
+	unsigned bufno;
+	uint32_t len;
+
+	assert(fibril_mutex_is_locked(&q->vq->lock));
+
+	while (virtio_net_buf_reclaim(q, &bufno, &len))
+		q->free_buf[q->nfree++] = bufno;
+}
+
+/** Pass received frames to libnic and repost their buffers.
+ *
+ * @param vnet		Virtio network device
+ * @param nic		NIC
+ * @param q		Receive queue
+ */
+static void virtio_net_rx_drain(virtio_net_t *vnet, nic_t *nic,
+    virtio_net_queue_t *q)
+{
+	unsigned bufno;
+	uint32_t len;
+	uint8_t *buf;
+	bool reposted = false;
+
+	fibril_mutex_lock(&q->vq->lock);
+
+	do {
+		while (virtio_net_buf_reclaim(q, &bufno, &len)) {
+			buf = (uint8_t *) q->buf + bufno * VIRTIO_NET_BUF_SIZE;
+			if (len > sizeof(virtio_net_hdr_t)) {
+				nic_rx_batch_add(nic,
+				    buf + sizeof(virtio_net_hdr_t),
+				    len - sizeof(virtio_net_hdr_t));
+			}
+
+			/* The buffer's own descriptors have just been freed. */
+			(void) virtio_net_buf_post(vnet, q, bufno,
+			    VIRTIO_NET_BUF_SIZE - sizeof(virtio_net_hdr_t), true);
+			reposted = true;
+		}
+	} while (virtio_virtq_enable_interrupt(q->vq));
+
+	if (reposted)
+		virtio_virtq_kick(q->vq);
+
+	fibril_mutex_unlock(&q->vq->lock);
+}
+
+static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	nic_t *nic = nic_get_from_ddf_dev(dev);
+	virtio_net_t *vnet = (virtio_net_t *) nic_get_specific(nic);
+	unsigned i;
+
+	if ((VIRTIO_IRQ_GET_ISR(*icall) & VIRTIO_ISR_QUEUE) == 0)
+		return;
+
+	nic_rx_batch_begin(nic);
+	for (i = 0; i < vnet->npairs; i++)
+		virtio_net_rx_drain(vnet, nic, &vnet->rxq[i]);
+	nic_rx_batch_end(nic);
+
+	for (i = 0; i < vnet->npairs; i++) {
+		fibril_mutex_lock(&vnet->txq[i].vq->lock);
+		virtio_net_tx_reclaim(&vnet->txq[i]);
+		fibril_mutex_unlock(&vnet->txq[i].vq->lock);
+	}
+}
+
+/** Choose the transmit queue for a frame.
+ *
+ * IPv4 frames are spread by their addresses so that the frames of one
+ * connection stay in order, everything else goes to the first queue.
+ */
+static unsigned virtio_net_tx_select(virtio_net_t *vnet, const uint8_t *frame,
+    size_t size)
+{
+	uint32_t hash = 0;
+	unsigned i;
+
+	if (vnet->npairs == 1 || size < 34)
+		return 0;
+
+	/* EtherType IPv4 */
+	if (frame[12] != 0x08 || frame[13] != 0x00)
+		return 0;
+
+	/* Source and destination address */
+	for (i = 26; i < 34; i++)
+		hash = hash * 31 + frame[i];
+
+	return hash % vnet->npairs;
+}
+
+static void virtio_net_send(nic_t *nic, void *data, size_t size)
+{
+	virtio_net_t *vnet = (virtio_net_t *) nic_get_specific(nic);
+	virtio_net_queue_t *q;
+	unsigned bufno;
+	uint8_t *buf;
+	errno_t rc;
+
+	if (size > VIRTIO_NET_BUF_SIZE - sizeof(virtio_net_hdr_t)) {
+		nic_report_send_error(nic, NIC_SEC_OTHER, 1);
+		return;
+	}
+
+	q = &vnet->txq[virtio_net_tx_select(vnet, data, size)];
+
+	fibril_mutex_lock(&q->vq->lock);
+
+	if (q->nfree == 0)
+		virtio_net_tx_reclaim(q);
+
+	if (q->nfree == 0) {
+		fibril_mutex_unlock(&q->vq->lock);
+		nic_report_send_error(nic, NIC_SEC_BUFFER_FULL, 1);
+		return;
+	}
+
+	bufno = q->free_buf[--q->nfree];
+	buf = (uint8_t *) q->buf + bufno * VIRTIO_NET_BUF_SIZE;
+	memset(buf, 0, sizeof(virtio_net_hdr_t));
+	memcpy(buf + sizeof(virtio_net_hdr_t), data, size);
+
+	rc = virtio_net_buf_post(vnet, q, bufno, size, false);
+	if (rc != EOK) {
+		q->free_buf[q->nfree++] = bufno;
+		fibril_mutex_unlock(&q->vq->lock);
+		nic_report_send_error(nic, NIC_SEC_BUFFER_FULL, 1);
+		return;
+	}
+
+	virtio_virtq_kick(q->vq);
+	fibril_mutex_unlock(&q->vq->lock);
+}
+
+/** Set up one receive or transmit queue.
+ *
+ * @param vnet		Virtio network device
+ * @param q		Queue
+ * @param num		Virtqueue number
+ * @param rx		@c true for a receive queue
+ */
+static errno_t virtio_net_queue_init(virtio_net_t *vnet, virtio_net_queue_t *q,
+    uint16_t num, bool rx)
+{
+	virtio_dev_t *vdev = &vnet->virtio_dev;
+	unsigned per_buf;
+	unsigned i;
+	errno_t rc;
+
+	rc = virtio_pci_virtq_setup(vdev, num);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed setting up virtqueue %u: %s", num,
+		    str_error(rc));
+		return rc;
+	}
+
+	q->vq = &vdev->queue[num];
+
+	/* Make sure that every buffer can always get its descriptors. */
+	per_buf = vnet->indirect ? 1 : 2;
+	q->nbufs = min(VIRTIO_NET_BUFS, q->vq->queue_size / per_buf);
+	if (q->nbufs == 0)
+		return EINVAL;
+
+	q->desc_buf = calloc(q->vq->queue_size, sizeof(uint16_t));
+	if (q->desc_buf == NULL)
+		return ENOMEM;
+
+	q->buf = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(q->nbufs * VIRTIO_NET_BUF_SIZE,
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &q->buf_phys,
+	    &q->buf);
+	if (rc != EOK) {
+		q->buf = NULL;
+		return rc;
+	}
+
+	q->ind = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(q->nbufs * 2 * sizeof(virtq_desc_t),
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &q->ind_phys,
+	    (void **) &q->ind);
+	if (rc != EOK) {
+		q->ind = NULL;
+		return rc;
+	}
+
+	fibril_mutex_lock(&q->vq->lock);
+
+	if (rx) {
+		for (i = 0; i < q->nbufs; i++) {
+			rc = virtio_net_buf_post(vnet, q, i,
+			    VIRTIO_NET_BUF_SIZE - sizeof(virtio_net_hdr_t),
+			    true);
+			assert(rc == EOK);
+		}
+
+		q->nfree = 0;
+	} else {
+		for (i = 0; i < q->nbufs; i++)
+			q->free_buf[i] = i;
+
+		q->nfree = q->nbufs;
+	}
+
+	fibril_mutex_unlock(&q->vq->lock);
+	return EOK;
+}
+
+static void virtio_net_queue_fini(virtio_net_queue_t *q)
+{
+	if (q->ind != NULL)
+		dmamem_unmap_anonymous(q->ind);
+	if (q->buf != NULL)
+		dmamem_unmap_anonymous(q->buf);
+	free(q->desc_buf);
+
+	q->ind = NULL;
+	q->buf = NULL;
+	q->desc_buf = NULL;
+}
+
+/** Ask the device to use a number of queue pairs.
+ *
+ * The command is sent on the control virtqueue and polled for, it is only
+ * used once during initialization. The control virtqueue must have been set
+ * up before the device was made ready.
+ */
+static errno_t virtio_net_set_pairs(virtio_net_t *vnet, uint16_t ctrlq,
+    uint16_t pairs)
+{
+	virtio_dev_t *vdev = &vnet->virtio_dev;
+	virtq_t *vq;
+	virtio_net_ctrl_t *ctrl;
+	uintptr_t ctrl_phys;
+	virtq_desc_t desc[3];
+	uint16_t head;
+	uint16_t descno;
+	uint32_t len;
+	unsigned retries;
+	errno_t rc;
+
+	vq = &vdev->queue[ctrlq];
+
+	ctrl = AS_AREA_ANY;
+	rc = dmamem_map_anonymous(sizeof(virtio_net_ctrl_t), DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &ctrl_phys, (void **) &ctrl);
+	if (rc != EOK)
+		return rc;
+
+	ctrl->class = VIRTIO_NET_CTRL_MQ;
+	ctrl->command = VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET;
+	ctrl->pairs = pairs;
+	ctrl->ack = 0xff;
+
+	desc[0].addr = ctrl_phys + offsetof(virtio_net_ctrl_t, class);
+	desc[0].len = 2;
+	desc[0].flags = 0;
+	desc[1].addr = ctrl_phys + offsetof(virtio_net_ctrl_t, pairs);
+	desc[1].len = sizeof(uint16_t);
+	desc[1].flags = 0;
+	desc[2].addr = ctrl_phys + offsetof(virtio_net_ctrl_t, ack);
+	desc[2].len = 1;
+	desc[2].flags = VIRTQ_DESC_F_WRITE;
+
+	fibril_mutex_lock(&vq->lock);
+
+	rc = virtio_virtq_chain_add(vq, desc, 3, NULL, 0, &head);
+	if (rc != EOK)
+		goto out;
+
+	virtio_virtq_produce_available(vq, head);
+	virtio_virtq_kick(vq);
+
+	rc = ETIMEOUT;
+	for (retries = 0; retries < VIRTIO_NET_CTRL_RETRIES; retries++) {
+		if (virtio_virtq_consume_used(vq, &descno, &len)) {
+			rc = (ctrl->ack == VIRTIO_NET_OK) ? EOK : EIO;
+			break;
+		}
+
+		fibril_mutex_unlock(&vq->lock);
+		async_usleep(VIRTIO_NET_CTRL_DELAY);
+		fibril_mutex_lock(&vq->lock);
+	}
+
+out:
+	fibril_mutex_unlock(&vq->lock);
+
+	/* The device may still own the buffer if it did not answer. */
+	if (rc != ETIMEOUT)
+		dmamem_unmap_anonymous(ctrl);
+	return rc;
+}
+
+static void virtio_net_fini(virtio_net_t *vnet)
+{
+	unsigned i;
+
+	if (vnet->virtio_dev.irq_cap != CAP_NIL) {
+		unregister_interrupt_handler(vnet->dev,
+		    vnet->virtio_dev.irq_cap);
+		vnet->virtio_dev.irq_cap = CAP_NIL;
+	}
+
+	virtio_pci_dev_cleanup(&vnet->virtio_dev);
+
+	for (i = 0; i < VIRTIO_NET_PAIRS_MAX; i++) {
+		virtio_net_queue_fini(&vnet->rxq[i]);
+		virtio_net_queue_fini(&vnet->txq[i]);
+	}
+}
+
+static errno_t virtio_net_init(virtio_net_t *vnet)
+{
+	virtio_dev_t *vdev = &vnet->virtio_dev;
+	uint32_t features;
+	unsigned max_pairs;
+	unsigned nqueues;
+	unsigned i;
+	errno_t rc;
+
+	rc = virtio_pci_dev_initialize(vnet->dev, vdev);
+	if (rc != EOK)
+		return rc;
+
+	features = virtio_pci_negotiate(vdev,
+	    VIRTIO_FEATURE(VIRTIO_NET_F_MAC) |
+	    VIRTIO_FEATURE(VIRTIO_NET_F_CTRL_VQ) |
+	    VIRTIO_FEATURE(VIRTIO_NET_F_MQ) |
+	    VIRTIO_FEATURE(VIRTIO_F_RING_INDIRECT_DESC) |
+	    VIRTIO_FEATURE(VIRTIO_F_RING_EVENT_IDX));
+
+	vnet->indirect =
+	    (features & VIRTIO_FEATURE(VIRTIO_F_RING_INDIRECT_DESC)) != 0;
+
+	if ((features & VIRTIO_FEATURE(VIRTIO_NET_F_MAC)) != 0) {
+		for (i = 0; i < ETH_ADDR; i++) {
+			vnet->mac.address[i] = virtio_pci_config_read_8(vdev,
+			    VIRTIO_NET_CFG_MAC + i);
+		}
+	} else {
+		/* Locally administered address */
+		vnet->mac.address[0] = 0x02;
+		vnet->mac.address[5] = 0x01;
+	}
+
+	/* Multiqueue needs the control virtqueue to enable the pairs. */
+	max_pairs = 1;
+	nqueues = 2;
+	if ((features & VIRTIO_FEATURE(VIRTIO_NET_F_MQ)) != 0 &&
+	    (features & VIRTIO_FEATURE(VIRTIO_NET_F_CTRL_VQ)) != 0) {
+		max_pairs = virtio_pci_config_read_16(vdev,
+		    VIRTIO_NET_CFG_MAX_VQ_PAIRS);
+		if (max_pairs > 1) {
+			/* The control virtqueue follows all the pairs. */
+			nqueues = 2 * max_pairs + 1;
+		} else {
+			max_pairs = 1;
+		}
+	}
+
+	rc = virtio_pci_virtq_alloc(vdev, nqueues);
+	if (rc != EOK)
+		goto error;
+
+	vnet->npairs = min(max_pairs, VIRTIO_NET_PAIRS_MAX);
+
+	for (i = 0; i < vnet->npairs; i++) {
+		rc = virtio_net_queue_init(vnet, &vnet->rxq[i], 2 * i, true);
+		if (rc != EOK)
+			goto error;
+		rc = virtio_net_queue_init(vnet, &vnet->txq[i], 2 * i + 1,
+		    false);
+		if (rc != EOK)
+			goto error;
+	}
+
+	/* All queues must be set up before the device is made ready. */
+	if (max_pairs > 1) {
+		rc = virtio_pci_virtq_setup(vdev, 2 * max_pairs);
+		if (rc != EOK) {
+			/* The device keeps using the first pair only. */
+			ddf_msg(LVL_WARN, "Failed setting up control "
+			    "virtqueue: %s", str_error(rc));
+			max_pairs = 1;
+			vnet->npairs = 1;
+		}
+	}
+
+	rc = virtio_pci_register_interrupt(vdev, vnet->dev,
+	    virtio_net_irq_handler);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed registering interrupt handler.");
+		goto error;
+	}
+
+	virtio_pci_dev_ready(vdev);
+
+	for (i = 0; i < vnet->npairs; i++) {
+		fibril_mutex_lock(&vnet->rxq[i].vq->lock);
+		virtio_virtq_kick(vnet->rxq[i].vq);
+		fibril_mutex_unlock(&vnet->rxq[i].vq->lock);
+	}
+
+	if (max_pairs > 1) {
+		rc = virtio_net_set_pairs(vnet, 2 * max_pairs, vnet->npairs);
+		if (rc != EOK) {
+			/* The device keeps using the first pair only. */
+			ddf_msg(LVL_WARN, "Failed enabling %u queue pairs: %s",
+			    vnet->npairs, str_error(rc));
+			vnet->npairs = 1;
+		}
+	}
+
+	ddf_msg(LVL_NOTE, "%u queue pair(s)%s%s", vnet->npairs,
+	    vnet->indirect ? ", indirect descriptors" : "",
+	    vdev->queue[0].event_idx ? ", event index" : "");
+
+	return EOK;
+error:
+	virtio_pci_dev_fail(vdev);
+	virtio_net_fini(vnet);
+	return rc;
+}
+
+static void virtio_net_dev_cleanup(ddf_dev_t *dev)
+{
+	nic_t *nic = nic_get_from_ddf_dev(dev);
+	virtio_net_t *vnet = (virtio_net_t *) nic_get_specific(nic);
+
+	if (vnet != NULL) {
+		virtio_net_fini(vnet);
+		free(vnet);
+		nic_set_specific(nic, NULL);
+	}
+
+	nic_unbind_and_destroy(dev);
+}
+
+static errno_t virtio_net_dev_add(ddf_dev_t *dev)
+{
+	virtio_net_t *vnet;
+	ddf_fun_t *fun;
+	nic_t *nic;
+	errno_t rc;
+
+	nic = nic_create_and_bind(dev);
+	if (nic == NULL)
+		return ENOMEM;
+
+	nic_set_send_frame_handler(nic, virtio_net_send);
+
+	vnet = calloc(1, sizeof(virtio_net_t));
+	if (vnet == NULL) {
+		nic_unbind_and_destroy(dev);
+		return ENOMEM;
+	}
+
+	nic_set_specific(nic, vnet);
+	vnet->dev = dev;
+
+	rc = virtio_net_init(vnet);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Failed initializing device: %s",
+		    str_error(rc));
+		virtio_net_dev_cleanup(dev);
+		return rc;
+	}
+
+	rc = nic_report_address(nic, &vnet->mac);
+	if (rc != EOK) {
+		virtio_net_dev_cleanup(dev);
+		return rc;
+	}
+
+	fun = ddf_fun_create(nic_get_ddf_dev(nic), fun_exposed, "port0");
+	if (fun == NULL) {
+		virtio_net_dev_cleanup(dev);
+		return ENOMEM;
+	}
+
+	nic_set_ddf_fun(nic, fun);
+	ddf_fun_set_ops(fun, &virtio_net_dev_ops);
+
+	rc = ddf_fun_bind(fun);
+	if (rc != EOK) {
+		ddf_fun_destroy(fun);
+		virtio_net_dev_cleanup(dev);
+		return rc;
+	}
+
+	rc = ddf_fun_add_to_category(fun, DEVICE_CATEGORY_NIC);
+	if (rc != EOK) {
+		ddf_fun_unbind(fun);
+		ddf_fun_destroy(fun);
+		return rc;
+	}
+
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	printf("%s: HelenOS virtio network device driver\n", NAME);
+
+	nic_driver_init(NAME);
+	nic_driver_implement(&virtio_net_driver_ops, &virtio_net_dev_ops,
+	    &virtio_net_nic_iface);
+
+	return ddf_driver_main(&virtio_net_driver);
+}
+
+/** @}
+ */
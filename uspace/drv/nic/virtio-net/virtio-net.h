@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup virtio-net
+ * @{
+ */
+/** @file
+ * Virtio network device driver definitions
+ */
+
+#ifndef _VIRTIO_NET_H_
+#define _VIRTIO_NET_H_
+
+#include <ddf/driver.h>
+#include <nic.h>
+#include <virtio.h>
+
+/** Device feature bits */
+#define VIRTIO_NET_F_MAC	5
+#define VIRTIO_NET_F_STATUS	16
+#define VIRTIO_NET_F_CTRL_VQ	17
+#define VIRTIO_NET_F_MQ		22
+
+/** Offsets in the device configuration */
+#define VIRTIO_NET_CFG_MAC		0x00
+#define VIRTIO_NET_CFG_STATUS		0x06
+#define VIRTIO_NET_CFG_MAX_VQ_PAIRS	0x08
+
+/** Link is up */
+#define VIRTIO_NET_S_LINK_UP	0x01
+
+/** Control commands */
+#define VIRTIO_NET_CTRL_MQ			4
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET		0
+
+#define VIRTIO_NET_OK	0
+
+/** Maximum number of receive/transmit queue pairs used */
+#define VIRTIO_NET_PAIRS_MAX	4
+/** Maximum number of buffers per queue */
+#define VIRTIO_NET_BUFS		64
+/** Size of a buffer including the virtio header */
+#define VIRTIO_NET_BUF_SIZE	2048
+
+/** Header preceding every frame (without VIRTIO_NET_F_MRG_RXBUF) */
+typedef struct {
+	uint8_t flags;
+	uint8_t gso_type;
+	uint16_t hdr_len;
+	uint16_t gso_size;
+	uint16_t csum_start;
+	uint16_t csum_offset;
+} __attribute__((packed)) virtio_net_hdr_t;
+
+/** Control virtqueue command, followed by the data and the ack byte */
+typedef struct {
+	uint8_t class;
+	uint8_t command;
+	uint16_t pairs;
+	uint8_t ack;
+} __attribute__((packed)) virtio_net_ctrl_t;
+
+/** Receive or transmit queue */
+typedef struct {
+	/** Virtqueue, its lock protects the whole queue */
+	virtq_t *vq;
+
+	/** Number of buffers */
+	unsigned nbufs;
+	/** Stack of free buffer numbers (transmit queues only) */
+	unsigned free_buf[VIRTIO_NET_BUFS];
+	unsigned nfree;
+	/** Buffer number of the frame using a descriptor as its head */
+	uint16_t *desc_buf;
+
+	/** Buffers, each starting with virtio_net_hdr_t */
+	void *buf;
+	uintptr_t buf_phys;
+	/** Two-entry indirect descriptor table for each buffer */
+	virtq_desc_t *ind;
+	uintptr_t ind_phys;
+} virtio_net_queue_t;
+
+/** Virtio network device */
+typedef struct {
+	ddf_dev_t *dev;
+	virtio_dev_t virtio_dev;
+
+	/** Station address */
+	nic_address_t mac;
+	/** Use indirect descriptors */
+	bool indirect;
+
+	/** Queue pairs, the receive queue of pair i is virtqueue 2i */
+	virtio_net_queue_t rxq[VIRTIO_NET_PAIRS_MAX];
+	virtio_net_queue_t txq[VIRTIO_NET_PAIRS_MAX];
+	unsigned npairs;
+} virtio_net_t;
+
+#endif
+
+/** @}
+ */
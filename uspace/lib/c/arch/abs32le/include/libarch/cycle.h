@@ -0,0 +1 @@
+../../../../../../../kernel/arch/abs32le/include/arch/cycle.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../../../kernel/arch/amd64/include/arch/cycle.h
\ No newline at end of file
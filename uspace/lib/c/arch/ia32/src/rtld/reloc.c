@@ -45,11 +45,105 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/rtld_arch.h>
 
+/** Name of the PLT binding trampoline (see bind.S) */
+#define RTLD_BIND_START "__rtld_bind_start"
+
+uintptr_t __rtld_bind(module_t *, elf_word)
+    __attribute__((visibility("hidden")));
+
 void module_process_pre_arch(module_t *m)
 {
 	/* Unused */
 }
 
+/** Prepare module PLT for lazy binding.
+ *
+ * GOT[1] is set to the module and GOT[2] to the binding trampoline
+ * which PLT0 jumps to. The JUMP_SLOT entries initially point back
+ * into the PLT at link-time addresses, so they only need the bias.
+ *
+ * The module that defines the trampoline itself is bound eagerly,
+ * otherwise the binder would have to go through unresolved PLT
+ * entries of its own.
+ *
+ * @param m	Module
+ * @return	@c true if the module PLT will be bound lazily
+ */
+bool module_plt_lazy_arch(module_t *m)
+{
+	elf_rel_t *rt;
+	elf_symbol_t *sym_def;
+	module_t *dest;
+	uint32_t *got;
+	size_t rt_entries;
+	size_t i;
+
+	if (m->dyn.plt_rel != DT_REL || m->dyn.plt_got == NULL)
+		return false;
+
+	sym_def = symbol_def_find(RTLD_BIND_START, m, ssf_none, &dest);
+	if (sym_def == NULL || dest == m)
+		return false;
+
+	got = (uint32_t *) m->dyn.plt_got;
+	got[1] = (uint32_t) m;
+	got[2] = (uint32_t) symbol_get_addr(sym_def, dest, NULL);
+
+	rt = m->dyn.jmp_rel;
+	rt_entries = m->dyn.plt_rel_sz / sizeof(elf_rel_t);
+
+	for (i = 0; i < rt_entries; i++) {
+		if (ELF32_R_TYPE(rt[i].r_info) == R_386_JUMP_SLOT)
+			*(uint32_t *)(rt[i].r_offset + m->bias) += m->bias;
+	}
+
+	m->lazy_plt = true;
+	return true;
+}
+
+/** Resolve a lazily bound PLT entry.
+ *
+ * Called from the binding trampoline on the first call through a PLT
+ * entry. Patches the GOT slot so that subsequent calls go directly
+ * to the target.
+ *
+ * Other threads may be calling dlopen() or binding PLT entries at the
+ * same time, so the lookup is done with the runtime lock held. Only
+ * eagerly bound code (libc) runs with the lock held, so this cannot
+ * recurse.
+ *
+ * @param m	Module containing the PLT
+ * @param reloff Offset of the relocation in the jmp_rel table
+ * @return	Address of the target function
+ */
+uintptr_t __rtld_bind(module_t *m, elf_word reloff)
+{
+	elf_rel_t *rel;
+	elf_symbol_t *sym;
+	elf_symbol_t *sym_def;
+	module_t *dest;
+	char *name;
+	uintptr_t sym_addr;
+
+	rel = (elf_rel_t *)((uint8_t *) m->dyn.jmp_rel + reloff);
+	sym = &((elf_symbol_t *) m->dyn.sym_tab)[ELF32_R_SYM(rel->r_info)];
+	name = m->dyn.str_tab + sym->st_name;
+
+	futex_lock(&m->rtld->lock);
+
+	sym_def = symbol_def_find(name, m, ssf_none, &dest);
+	if (sym_def == NULL) {
+		printf("Definition of '%s' not found.\n", name);
+		abort();
+	}
+
+	sym_addr = (uintptr_t) symbol_get_addr(sym_def, dest, NULL);
+	*(uint32_t *)(rel->r_offset + m->bias) = sym_addr;
+
+	futex_unlock(&m->rtld->lock);
+	return sym_addr;
+}
+
 
 /**
  * Process (fixup) all relocations in a relocation table.
@@ -98,6 +192,10 @@ void rel_table_process(module_t *m, elf_rel_t *rt, size_t rt_size)
 		rel_type = ELF32_R_TYPE(r_info);
 		r_ptr = (uint32_t *)(r_offset + m->bias);
 
+		/* Resolved on first call by __rtld_bind() */
+		if (rel_type == R_386_JUMP_SLOT && m->lazy_plt)
+			continue;
+
 		if (sym->st_name != 0) {
 //			DPRINTF("rel_type: %x, rel_offset: 0x%x\n", rel_type, r_offset);
 			sym_def = symbol_def_find(str_tab + sym->st_name,
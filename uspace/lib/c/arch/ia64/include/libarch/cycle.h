@@ -0,0 +1 @@
+../../../../../../../kernel/arch/ia64/include/arch/cycle.h
\ No newline at end of file
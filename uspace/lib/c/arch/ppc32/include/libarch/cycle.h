@@ -0,0 +1 @@
+../../../../../../../kernel/arch/ppc32/include/arch/cycle.h
\ No newline at end of file
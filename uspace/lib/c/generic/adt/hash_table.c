@@ -267,15 +267,28 @@ ht_link_t *hash_table_find(const hash_table_t *h, void *key)
 	return NULL;
 }
 
-/** Find the next item equal to item. */
+/** Find the next item equal to item.
+ *
+ * The items equal to @a item are visited in a cycle: once all of them
+ * have been returned, the search wraps around to the first one. Callers
+ * iterating over all equal items must stop when they get back to the
+ * item they started with. NULL is returned only if there is no other
+ * equal item.
+ */
 ht_link_t *hash_table_find_next(const hash_table_t *h, ht_link_t *item)
 {
 	assert(item);
 	assert(h && h->bucket);
 
+	size_t idx = h->op->hash(item) % h->bucket_cnt;
+
 	/* Traverse the circular list until we reach the starting item again. */
 	for (link_t *cur = item->link.next; cur != &item->link; cur = cur->next) {
 		assert(cur);
+		/* The bucket head is not embedded in an item */
+		if (cur == &h->bucket[idx].head)
+			continue;
+
 		ht_link_t *cur_link = member_to_inst(cur, ht_link_t, link);
 		/* 
 		 * Is this is the item we are looking for? We could have first 
@@ -38,6 +38,10 @@
 #include <stddef.h>
 #include <errno.h>
 #include <assert.h>
+#include <str.h>
+
+/** Size of the buffer for entries read ahead from the file system. */
+#define DIR_BUF_SIZE  4096
 
 /** Open directory.
  *
@@ -71,6 +75,10 @@ DIR *opendir(const char *dirname)
 	
 	dirp->fd = fd;
 	dirp->pos = 0;
+	dirp->buf = NULL;
+	dirp->buf_len = 0;
+	dirp->buf_off = 0;
+	dirp->single = false;
 	return dirp;
 }
 
@@ -83,6 +91,47 @@ DIR *opendir(const char *dirname)
 struct dirent *readdir(DIR *dirp)
 {
 	errno_t rc;
+	
+	if (!dirp->single && dirp->buf_off >= dirp->buf_len) {
+		if (dirp->buf == NULL) {
+			dirp->buf = malloc(DIR_BUF_SIZE);
+			if (dirp->buf == NULL)
+				dirp->single = true;
+		}
+		
+		if (!dirp->single) {
+			aoff64_t npos = dirp->pos;
+			size_t len = 0;
+			
+			rc = vfs_read_dir(dirp->fd, &npos, 0, dirp->buf,
+			    DIR_BUF_SIZE, &len);
+			if (rc == ENOTSUP || rc == ELIMIT) {
+				/* Fall back to reading one entry at a time. */
+				dirp->single = true;
+			} else if (rc != EOK) {
+				errno = rc;
+				return NULL;
+			} else if (len == 0) {
+				errno = ENOENT;
+				return NULL;
+			}
+			
+			dirp->buf_len = len;
+			dirp->buf_off = 0;
+		}
+	}
+	
+	if (!dirp->single) {
+		vfs_dirent_t *de = (vfs_dirent_t *)
+		    ((uint8_t *) dirp->buf + dirp->buf_off);
+		
+		str_cpy(dirp->res.d_name, NAME_MAX + 1, de->name);
+		dirp->buf_off += de->reclen;
+		dirp->pos = de->next_pos;
+		
+		return &dirp->res;
+	}
+	
 	ssize_t len = 0;
 	
 	rc = vfs_read_short(dirp->fd, dirp->pos, &dirp->res.d_name[0],
@@ -104,6 +153,8 @@ struct dirent *readdir(DIR *dirp)
 void rewinddir(DIR *dirp)
 {
 	dirp->pos = 0;
+	dirp->buf_len = 0;
+	dirp->buf_off = 0;
 }
 
 /** Close directory.
@@ -114,6 +165,7 @@ void rewinddir(DIR *dirp)
 int closedir(DIR *dirp)
 {
 	errno_t rc = vfs_put(dirp->fd);
+	free(dirp->buf);
 	free(dirp);
 
 	if (rc == EOK) {
@@ -41,6 +41,7 @@
 
 #ifdef CONFIG_RTLD
 
+#include <futex.h>
 #include <rtld/module.h>
 #include <rtld/rtld.h>
 #include <rtld/symbol.h>
@@ -49,6 +50,8 @@ void *dlopen(const char *path, int flag)
 {
 	module_t *m;
 
+	futex_lock(&runtime_env->lock);
+
 	m = module_find(runtime_env, path);
 	if (m == NULL) {
 		m = module_load(runtime_env, path, mlf_local);
@@ -57,6 +60,8 @@ void *dlopen(const char *path, int flag)
 		module_process_relocs(m);
 	}
 
+	futex_unlock(&runtime_env->lock);
+
 	return (void *) m;
 }
 
@@ -67,13 +72,19 @@ void *dlsym(void *mod, const char *sym_name)
 {
 	elf_symbol_t *sd;
 	module_t *sm;
+	void *addr = NULL;
+
+	/* The search uses the BFS tags of the modules */
+	futex_lock(&runtime_env->lock);
 
 	sd = symbol_bfs_find(sym_name, (module_t *) mod, &sm);
 	if (sd != NULL) {
-		return symbol_get_addr(sd, sm, __tcb_get());
+		addr = symbol_get_addr(sd, sm, __tcb_get());
 	}
 
-	return NULL;
+	futex_unlock(&runtime_env->lock);
+
+	return addr;
 }
 
 #else /* CONFIG_RTLD not defined */
@@ -37,10 +37,12 @@
  * @brief	Userspace ELF module loader.
  *
  * This module allows loading ELF binaries (both executables and
- * shared objects) from VFS. The current implementation allocates
- * anonymous memory, fills it with segment data and then adjusts
- * the memory areas' flags to the final value. In the future,
- * the segments will be mapped directly from the file.
+ * shared objects) from VFS. Read-only segments are mapped directly
+ * from the file using the VFS pager, so that they are paged in on
+ * demand and their frames are shared by all tasks running the same
+ * image. Other segments are loaded into anonymous memory, which is
+ * filled with segment data and then has its flags adjusted to the
+ * final value.
  */
 
 #include <errno.h>
@@ -57,11 +59,38 @@
 #include <entry_point.h>
 #include <str_error.h>
 #include <stdlib.h>
+#include <async.h>
+#include <ns.h>
+#include <macros.h>
+#include <ipc/services.h>
 
 #include <elf/elf_load.h>
 
 #define DPRINTF(...)
 
+/*
+ * Dynamic section tags needed to detect text relocations. The rest of the
+ * dynamic section is the business of the dynamic linker.
+ */
+#define ELF_DT_NULL	0
+#define ELF_DT_TEXTREL	22
+#define ELF_DT_FLAGS	30
+#define ELF_DF_TEXTREL	0x4
+
+/** Dynamic section entry in the native ELF class. */
+typedef struct {
+#ifdef __64_BITS__
+	elf_sxword d_tag;
+	elf_xword d_val;
+#else
+	elf_sword d_tag;
+	elf_word d_val;
+#endif
+} elf_dyn_entry_t;
+
+/** Session with the VFS pager, shared by all loaded images. */
+static async_sess_t *elf_pager_sess;
+
 static const char *error_codes[] = {
 	"no error",
 	"invalid image",
@@ -76,6 +105,7 @@ static unsigned int elf_load_module(elf_ld_t *elf, size_t so_bias);
 static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry);
 static int section_header(elf_ld_t *elf, elf_section_header_t *entry);
 static int load_segment(elf_ld_t *elf, elf_segment_header_t *entry);
+static int dynamic_text_rel(elf_ld_t *elf, elf_segment_header_t *entry);
 
 /** Load ELF binary from a file.
  *
@@ -109,9 +139,12 @@ int elf_load_file(int file, size_t so_bias, eld_flags_t flags, elf_finfo_t *info
 	elf.fd = ofile;
 	elf.info = info;
 	elf.flags = flags;
+	elf.text_rel = false;
+	elf.pager_id = 0;
 
 	int ret = elf_load_module(&elf, so_bias);
 
+	/* Paged segments refer to the file by its pager ID */
 	vfs_put(ofile);
 	return ret;
 }
@@ -203,23 +236,45 @@ static unsigned int elf_load_module(elf_ld_t *elf, size_t so_bias)
 	elf->info->interp = NULL;
 	elf->info->dynamic = NULL;
 
-	/* Walk through all segment headers and process them. */
-	for (i = 0; i < header->e_phnum; i++) {
-		elf_segment_header_t segment_hdr;
+	/* Read all segment headers at once. */
+	size_t phdrs_size = header->e_phnum * sizeof(elf_segment_header_t);
+	elf_segment_header_t *phdrs = malloc(phdrs_size);
+	if (phdrs == NULL)
+		return EE_MEMORY;
 
-		pos = header->e_phoff + i * sizeof(elf_segment_header_t);
-		rc = vfs_read(elf->fd, &pos, &segment_hdr,
-		    sizeof(elf_segment_header_t), &nr);
-		if (rc != EOK || nr != sizeof(elf_segment_header_t)) {
-			DPRINTF("Read error.\n");
-			return EE_IO;
+	pos = header->e_phoff;
+	rc = vfs_read(elf->fd, &pos, phdrs, phdrs_size, &nr);
+	if (rc != EOK || nr != phdrs_size) {
+		DPRINTF("Read error.\n");
+		free(phdrs);
+		return EE_IO;
+	}
+
+	/*
+	 * Read-only segments can only be mapped from the file if nothing
+	 * needs to be patched in them.
+	 */
+	for (i = 0; i < header->e_phnum; i++) {
+		if (phdrs[i].p_type == PT_DYNAMIC) {
+			ret = dynamic_text_rel(elf, &phdrs[i]);
+			if (ret != EE_OK) {
+				free(phdrs);
+				return ret;
+			}
 		}
+	}
 
-		ret = segment_header(elf, &segment_hdr);
-		if (ret != EE_OK)
+	/* Walk through all segment headers and process them. */
+	for (i = 0; i < header->e_phnum; i++) {
+		ret = segment_header(elf, &phdrs[i]);
+		if (ret != EE_OK) {
+			free(phdrs);
 			return ret;
+		}
 	}
 
+	free(phdrs);
+
 	DPRINTF("Parse sections.\n");
 
 	/* Inspect all section headers and proccess them. */
@@ -275,6 +330,46 @@ static void tls_program_header(elf_ld_t *elf, elf_segment_header_t *hdr,
 	info->tls_align = hdr->p_align;
 }
 
+/** Find out whether an image has text relocations.
+ *
+ * @param elf   Pointer to loader state buffer.
+ * @param entry	PT_DYNAMIC program header.
+ *
+ * @return EE_OK on success, error code otherwise.
+ */
+static int dynamic_text_rel(elf_ld_t *elf, elf_segment_header_t *entry)
+{
+	elf_dyn_entry_t *dyn;
+	aoff64_t pos;
+	size_t nr;
+	size_t i;
+	errno_t rc;
+
+	dyn = malloc(entry->p_filesz);
+	if (dyn == NULL)
+		return EE_MEMORY;
+
+	pos = entry->p_offset;
+	rc = vfs_read(elf->fd, &pos, dyn, entry->p_filesz, &nr);
+	if (rc != EOK || nr != entry->p_filesz) {
+		DPRINTF("Read error.\n");
+		free(dyn);
+		return EE_IO;
+	}
+
+	for (i = 0; i < nr / sizeof(elf_dyn_entry_t); i++) {
+		if (dyn[i].d_tag == ELF_DT_NULL)
+			break;
+		if (dyn[i].d_tag == ELF_DT_TEXTREL ||
+		    (dyn[i].d_tag == ELF_DT_FLAGS &&
+		    (dyn[i].d_val & ELF_DF_TEXTREL) != 0))
+			elf->text_rel = true;
+	}
+
+	free(dyn);
+	return EE_OK;
+}
+
 /** Process segment header.
  *
  * @param elf   Pointer to loader state buffer.
@@ -323,6 +418,63 @@ static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry)
 	return EE_OK;
 }
 
+/** Get a session with the VFS pager.
+ *
+ * @return Session or NULL if the pager is not available.
+ */
+static async_sess_t *elf_pager_get(void)
+{
+	if (elf_pager_sess == NULL) {
+		elf_pager_sess = service_connect(SERVICE_VFS, INTERFACE_PAGER,
+		    0);
+	}
+
+	return elf_pager_sess;
+}
+
+/** Map a read-only segment from its file.
+ *
+ * The pages are brought in by the VFS pager when first touched. VFS hands
+ * out the same frame to every task mapping the same page of the file.
+ *
+ * @param elf	Loader state.
+ * @param entry Program header entry describing segment to be loaded.
+ * @param base	Page-aligned start of the segment.
+ * @param size	Size of the area.
+ * @param flags	Final flags of the area.
+ *
+ * @return EE_OK on success, EE_MEMORY if the segment cannot be mapped
+ *         and has to be loaded into anonymous memory instead.
+ */
+static int map_segment(elf_ld_t *elf, elf_segment_header_t *entry,
+    uintptr_t base, size_t size, int flags)
+{
+	/* Zero-filled parts and segments we have to patch need private memory */
+	if ((entry->p_flags & PF_W) != 0 || entry->p_filesz != entry->p_memsz ||
+	    elf->text_rel)
+		return EE_MEMORY;
+
+	/* The file offset must have the same alignment as the address */
+	if ((entry->p_offset % PAGE_SIZE) != (entry->p_vaddr % PAGE_SIZE))
+		return EE_MEMORY;
+
+	async_sess_t *pager = elf_pager_get();
+	if (pager == NULL)
+		return EE_MEMORY;
+
+	if (elf->pager_id == 0 && vfs_pager_ref(elf->fd, &elf->pager_id) != EOK)
+		return EE_MEMORY;
+
+	aoff64_t offset = entry->p_offset - (entry->p_vaddr - base);
+
+	void *a = async_as_area_create((uint8_t *) base + elf->bias, size,
+	    flags, pager, elf->pager_id, LOWER32(offset), UPPER32(offset));
+	if (a == AS_MAP_FAILED)
+		return EE_MEMORY;
+
+	return EE_OK;
+}
+
 /** Load segment described by program header entry.
  *
  * @param elf	Loader state.
@@ -379,6 +531,18 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	    (void *) (entry->p_vaddr + bias +
 	    ALIGN_UP(entry->p_memsz, PAGE_SIZE)));
 
+	if (map_segment(elf, entry, base, mem_sz, flags) == EE_OK) {
+		DPRINTF("Segment mapped from file.\n");
+		
+		if (flags & AS_AREA_EXEC) {
+			/* Enforce SMC coherence for the segment */
+			if (smc_coherence(seg_ptr, entry->p_filesz))
+				return EE_MEMORY;
+		}
+		
+		return EE_OK;
+	}
+
 	/*
 	 * For the course of loading, the area needs to be readable
 	 * and writeable.
@@ -33,11 +33,14 @@
  */
 
 #include <errno.h>
+#include <as.h>
 #include <inet/endpoint.h>
 #include <inet/udp.h>
 #include <ipc/services.h>
 #include <ipc/udp.h>
 #include <loc.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 
 static void udp_cb_conn(ipc_callid_t, ipc_call_t *, void *);
@@ -89,6 +92,7 @@ errno_t udp_create(udp_t **rudp)
 	list_initialize(&udp->assoc);
 	fibril_mutex_initialize(&udp->lock);
 	fibril_condvar_initialize(&udp->cv);
+	fibril_mutex_initialize(&udp->batch_lock);
 
 	rc = loc_service_get_id(SERVICE_NAME_UDP, &udp_svcid,
 	    IPC_FLAG_BLOCKING);
@@ -133,9 +137,56 @@ void udp_destroy(udp_t *udp)
 		fibril_condvar_wait(&udp->cv, &udp->lock);
 	fibril_mutex_unlock(&udp->lock);
 
+	if (udp->batch != NULL)
+		as_area_destroy(udp->batch);
+
 	free(udp);
 }
 
+/** Set up buffer for batched transfers.
+ *
+ * The buffer is created and shared with the UDP service on first use.
+ * Must be called with @c udp->batch_lock held.
+ *
+ * @param udp UDP client
+ * @return @c true if batched transfers can be used
+ */
+static bool udp_batch_setup(udp_t *udp)
+{
+	if (udp->batch != NULL)
+		return true;
+
+	if (udp->batch_failed)
+		return false;
+
+	void *batch = as_area_create(AS_AREA_ANY, UDP_BATCH_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (batch == AS_MAP_FAILED) {
+		udp->batch_failed = true;
+		return false;
+	}
+
+	async_exch_t *exch = async_exchange_begin(udp->sess);
+	aid_t req = async_send_0(exch, UDP_BATCH_SHARE, NULL);
+	errno_t rc = async_share_out_start(exch, batch,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	async_exchange_end(exch);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	if (rc != EOK || retval != EOK) {
+		/* Fall back to transferring one message per request */
+		as_area_destroy(batch);
+		udp->batch_failed = true;
+		return false;
+	}
+
+	udp->batch = batch;
+	return true;
+}
+
 /** Create new UDP association.
  *
  * Create a UDP association that allows sending and receiving messages.
@@ -284,6 +335,106 @@ errno_t udp_assoc_send_msg(udp_assoc_t *assoc, inet_ep_t *dest, void *data,
 	return rc;
 }
 
+/** Send messages from the sending part of the batch buffer.
+ *
+ * @param assoc Association
+ * @param count Number of messages in the batch buffer
+ * @param rsent Place to store number of messages sent
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t udp_assoc_send_batch(udp_assoc_t *assoc, size_t count,
+    size_t *rsent)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+
+	exch = async_exchange_begin(assoc->udp->sess);
+	aid_t req = async_send_2(exch, UDP_ASSOC_SEND_BATCH, assoc->id, count,
+	    &answer);
+	async_exchange_end(exch);
+
+	errno_t rc;
+	async_wait_for(req, &rc);
+
+	*rsent = IPC_GET_ARG1(answer);
+	return rc;
+}
+
+/** Send multiple messages via UDP association.
+ *
+ * Messages are copied into a buffer shared with the UDP service and sent
+ * using as few requests as possible. Sending stops at the first message
+ * that cannot be sent.
+ *
+ * @param assoc Association
+ * @param msgs  Messages
+ * @param count Number of messages
+ * @param rsent Place to store number of messages sent or @c NULL
+ *
+ * @return EOK if all messages were sent or an error code
+ */
+errno_t udp_assoc_send_msgs(udp_assoc_t *assoc, udp_smsg_t *msgs,
+    size_t count, size_t *rsent)
+{
+	udp_t *udp = assoc->udp;
+	size_t sent = 0;
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&udp->batch_lock);
+
+	while (sent < count) {
+		size_t space = UDP_BATCH_MSG_SPACE(msgs[sent].size);
+
+		if (!udp_batch_setup(udp) || space > UDP_BATCH_PART_SIZE) {
+			/* Does not fit into the batch buffer */
+			rc = udp_assoc_send_msg(assoc, msgs[sent].dest,
+			    msgs[sent].data, msgs[sent].size);
+			if (rc != EOK)
+				break;
+
+			sent++;
+			continue;
+		}
+
+		/* Fill the batch buffer */
+		size_t off = 0;
+		size_t n = 0;
+		while (sent + n < count) {
+			udp_smsg_t *smsg = &msgs[sent + n];
+
+			space = UDP_BATCH_MSG_SPACE(smsg->size);
+			if (space > UDP_BATCH_PART_SIZE - off)
+				break;
+
+			udp_batch_msg_t *bmsg = udp->batch + UDP_BATCH_TX_OFF +
+			    off;
+			bmsg->assoc_id = assoc->id;
+			bmsg->has_remote = (smsg->dest != NULL);
+			if (smsg->dest != NULL)
+				bmsg->remote = *smsg->dest;
+			bmsg->size = smsg->size;
+			memcpy(bmsg + 1, smsg->data, smsg->size);
+
+			off += space;
+			n++;
+		}
+
+		size_t bsent;
+		rc = udp_assoc_send_batch(assoc, n, &bsent);
+		sent += min(bsent, n);
+		if (rc != EOK)
+			break;
+	}
+
+	fibril_mutex_unlock(&udp->batch_lock);
+
+	if (rsent != NULL)
+		*rsent = sent;
+
+	return rc;
+}
+
 /** Get the user/callback argument for an association.
  *
  * @param assoc UDP association
@@ -322,6 +473,15 @@ errno_t udp_rmsg_read(udp_rmsg_t *rmsg, size_t off, void *buf, size_t bsize)
 	async_exch_t *exch;
 	ipc_call_t answer;
 
+	if (rmsg->data != NULL) {
+		/* Message was received in a batch */
+		if (off > rmsg->size)
+			return EINVAL;
+
+		memcpy(buf, rmsg->data + off, min(rmsg->size - off, bsize));
+		return EOK;
+	}
+
 	exch = async_exchange_begin(rmsg->udp->sess);
 	aid_t req = async_send_1(exch, UDP_RMSG_READ, off, &answer);
 	errno_t rc = async_data_read_start(exch, buf, bsize);
@@ -406,6 +566,7 @@ static errno_t udp_rmsg_info(udp_t *udp, udp_rmsg_t *rmsg)
 	rmsg->assoc_id = IPC_GET_ARG1(answer);
 	rmsg->size = IPC_GET_ARG2(answer);
 	rmsg->remote_ep = ep;
+	rmsg->data = NULL;
 	return EOK;
 }
 
@@ -445,10 +606,66 @@ static errno_t udp_assoc_get(udp_t *udp, sysarg_t id, udp_assoc_t **rassoc)
 	return EINVAL;
 }
 
+/** Receive batch of messages into the receiving part of batch buffer.
+ *
+ * @param udp    UDP client
+ * @param rcount Place to store number of messages received
+ *
+ * @return EOK on success, ENOENT if there are no messages or an error code
+ */
+static errno_t udp_rmsg_recv_batch(udp_t *udp, size_t *rcount)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+
+	exch = async_exchange_begin(udp->sess);
+	aid_t req = async_send_0(exch, UDP_RMSG_RECV_BATCH, &answer);
+	async_exchange_end(exch);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	if (retval != EOK)
+		return retval;
+
+	*rcount = IPC_GET_ARG1(answer);
+	return EOK;
+}
+
+/** Deliver messages from the receiving part of batch buffer.
+ *
+ * @param udp   UDP client
+ * @param count Number of messages in the batch buffer
+ */
+static void udp_rmsg_deliver_batch(udp_t *udp, size_t count)
+{
+	udp_assoc_t *assoc;
+	udp_rmsg_t rmsg;
+	size_t off = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		udp_batch_msg_t *bmsg = udp->batch + UDP_BATCH_RX_OFF + off;
+
+		rmsg.udp = udp;
+		rmsg.assoc_id = bmsg->assoc_id;
+		rmsg.size = bmsg->size;
+		rmsg.remote_ep = bmsg->remote;
+		rmsg.data = bmsg + 1;
+
+		off += UDP_BATCH_MSG_SPACE(bmsg->size);
+
+		if (udp_assoc_get(udp, rmsg.assoc_id, &assoc) != EOK)
+			continue;
+
+		if (assoc->cb != NULL && assoc->cb->recv_msg != NULL)
+			assoc->cb->recv_msg(assoc, &rmsg);
+	}
+}
+
 /** Handle 'data' event, i.e. some message(s) arrived.
  *
- * For each received message, get information about it, call @c recv_msg
- * callback and discard it.
+ * Received messages are fetched in batches if possible. Otherwise (or if
+ * a message is too large for the batch buffer), for each received message,
+ * get information about it, call @c recv_msg callback and discard it.
  *
  * @param udp UDP client
  * @param iid IPC message ID
@@ -458,20 +675,38 @@ static void udp_ev_data(udp_t *udp, ipc_callid_t iid, ipc_call_t *icall)
 {
 	udp_rmsg_t rmsg;
 	udp_assoc_t *assoc;
+	size_t count;
+	bool batch;
 	errno_t rc;
 
+	fibril_mutex_lock(&udp->batch_lock);
+	batch = udp_batch_setup(udp);
+	fibril_mutex_unlock(&udp->batch_lock);
+
 	while (true) {
+		if (batch) {
+			/*
+			 * The receiving part of the buffer is only used by
+			 * this fibril, no locking needed.
+			 */
+			rc = udp_rmsg_recv_batch(udp, &count);
+			if (rc != EOK)
+				break;
+
+			if (count > 0) {
+				udp_rmsg_deliver_batch(udp, count);
+				continue;
+			}
+		}
+
 		rc = udp_rmsg_info(udp, &rmsg);
 		if (rc != EOK) {
 			break;
 		}
 
 		rc = udp_assoc_get(udp, rmsg.assoc_id, &assoc);
-		if (rc != EOK) {
-			continue;
-		}
-
-		if (assoc->cb != NULL && assoc->cb->recv_msg != NULL)
+		if (rc == EOK && assoc->cb != NULL &&
+		    assoc->cb->recv_msg != NULL)
 			assoc->cb->recv_msg(assoc, &rmsg);
 
 		rc = udp_rmsg_discard(udp);
@@ -38,6 +38,8 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <mem.h>
+#include <macros.h>
 #include <async.h>
 #include <io/kio.h>
 #include <vfs/vfs.h>
@@ -48,6 +50,9 @@
 #include "../private/io.h"
 #include "../private/stdio.h"
 
+/** Default buffer size for streams backed by regular files. */
+#define FILE_BUFSIZ  (64 * 1024)
+
 static void _ffillbuf(FILE *stream);
 static void _fflushbuf(FILE *stream);
 
@@ -237,6 +242,32 @@ void setbuf(FILE *stream, void *buf)
 	}
 }
 
+/** Choose buffer size for a fully buffered stream.
+ *
+ * Regular files get a buffer of FILE_BUFSIZ rounded up to a multiple of the
+ * file system block size so that sequential access does not turn into a
+ * stream of small requests to VFS. The buffer is not made larger than needed
+ * to hold a small existing file.
+ *
+ * This costs a round trip to VFS, so it is only done when the buffer is
+ * first needed, not when the stream is opened.
+ */
+static size_t _fbufsize(FILE *stream)
+{
+	vfs_stat_t st;
+	
+	if (vfs_stat(stream->fd, &st) != EOK || !st.is_file)
+		return BUFSIZ;
+	
+	size_t bsize = st.blksize != 0 ? st.blksize : BUFSIZ;
+	size_t size = FILE_BUFSIZ;
+	if (st.size > 0 && st.size < size)
+		size = st.size;
+	
+	size = ((size + bsize - 1) / bsize) * bsize;
+	return max(size, (size_t) BUFSIZ);
+}
+
 static void _setvbuf(FILE *stream)
 {
 	/* FIXME: Use more complex rules for setting buffering options. */
@@ -250,7 +281,8 @@ static void _setvbuf(FILE *stream)
 		setvbuf(stream, NULL, _IONBF, 0);
 		break;
 	default:
-		setvbuf(stream, NULL, _IOFBF, BUFSIZ);
+		/* The size is chosen by _fallocbuf() */
+		setvbuf(stream, NULL, _IOFBF, 0);
 	}
 }
 
@@ -259,6 +291,9 @@ static int _fallocbuf(FILE *stream)
 {
 	assert(stream->buf == NULL);
 	
+	if (stream->buf_size == 0)
+		stream->buf_size = _fbufsize(stream);
+	
 	stream->buf = malloc(stream->buf_size);
 	if (stream->buf == NULL) {
 		errno = ENOMEM;
@@ -558,7 +593,6 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 	size_t now;
 	size_t data_avail;
 	size_t total_read;
-	size_t i;
 
 	if (size == 0 || nmemb == 0)
 		return 0;
@@ -591,6 +625,23 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 	}
 
 	while ((!stream->error) && (!stream->eof) && (bytes_left > 0)) {
+		if ((stream->buf_head == stream->buf_tail) &&
+		    (bytes_left >= stream->buf_size)) {
+			/*
+			 * The buffer is drained and the request would not fit
+			 * in it anyway, read directly into the destination.
+			 */
+			stream->buf_head = stream->buf_tail = stream->buf;
+			stream->buf_state = _bs_empty;
+			
+			now = _fread(dp, 1, bytes_left, stream);
+			if ((now < bytes_left) && (!stream->error))
+				stream->eof = true;
+			
+			total_read += now;
+			break;
+		}
+		
 		if (stream->buf_head == stream->buf_tail)
 			_ffillbuf(stream);
 
@@ -606,9 +657,7 @@ size_t fread(void *dest, size_t size, size_t nmemb, FILE *stream)
 		else
 			now = bytes_left;
 
-		for (i = 0; i < now; i++) {
-			dp[i] = stream->buf_tail[i];
-		}
+		memcpy(dp, stream->buf_tail, now);
 
 		dp += now;
 		stream->buf_tail += now;
@@ -665,6 +714,18 @@ size_t fwrite(const void *buf, size_t size, size_t nmemb, FILE *stream)
 	need_flush = false;
 	
 	while ((!stream->error) && (bytes_left > 0)) {
+		if ((stream->buf_head == stream->buf) &&
+		    (bytes_left >= stream->buf_size)) {
+			/*
+			 * Nothing is buffered and the data would fill the
+			 * buffer anyway, write them out directly.
+			 */
+			now = _fwrite(data, 1, bytes_left, stream);
+			total_written += now;
+			need_flush = (stream->btype == _IOLBF);
+			break;
+		}
+		
 		buf_free = stream->buf_size - (stream->buf_head - stream->buf);
 		if (bytes_left > buf_free)
 			now = buf_free;
@@ -31,20 +31,38 @@
  * @{
  */
 
+#include <as.h>
 #include <assert.h>
 #include <errno.h>
 #include <fibril_synch.h>
+#include <libarch/barrier.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <async.h>
+#include <align.h>
 #include <io/log.h>
 #include <ipc/logger.h>
+#include <mem.h>
 #include <str.h>
 #include <ns.h>
+#include "../private/log.h"
 
-/** Id of the first log we create at logger. */
-static sysarg_t default_log_id;
+/** First log we create at logger. */
+static log_t default_log;
+
+/** Ids of our logs at logger, indexed by slot.
+ *
+ * The log_t handed out to the application is the slot plus one, so that
+ * it never collides with LOG_NO_PARENT or LOG_DEFAULT.
+ */
+static sysarg_t log_ids[LOGGER_WRITER_LOGS_MAX];
+
+/** Log ring shared with the logger or NULL if not available. */
+static logger_ring_t *log_ring;
+
+/** Serializes producers of the log ring. */
+static FIBRIL_MUTEX_INITIALIZE(log_ring_guard);
 
 /** Log messages are printed under this name. */
 static const char *log_prog_name;
@@ -66,28 +84,40 @@ static async_sess_t *logger_session;
 /** Maximum length of a single log message (in bytes). */
 #define MESSAGE_BUFFER_SIZE 4096
 
+/** Translate log handle to its slot.
+ *
+ * @param log Log handle (LOG_DEFAULT is allowed).
+ * @return Slot of the log or LOGGER_WRITER_LOGS_MAX if the handle is invalid.
+ */
+static size_t log_slot(log_t log)
+{
+	if (log == LOG_DEFAULT)
+		log = default_log;
+
+	if (log == LOG_NO_PARENT || log > LOGGER_WRITER_LOGS_MAX)
+		return LOGGER_WRITER_LOGS_MAX;
+
+	return log - 1;
+}
+
 /** Send formatted message to the logger service.
  *
  * @param session Initialized IPC session with the logger.
- * @param log Log to use.
+ * @param slot Slot of the log to use.
  * @param level Verbosity level of the message.
  * @param message The actual message.
  * @return Error code of the conversion or EOK on success.
  */
-static errno_t logger_message(async_sess_t *session, log_t log, log_level_t level, char *message)
+static errno_t logger_message(async_sess_t *session, size_t slot,
+    log_level_t level, const char *message)
 {
 	async_exch_t *exchange = async_exchange_begin(session);
 	if (exchange == NULL) {
 		return ENOMEM;
 	}
-	if (log == LOG_DEFAULT)
-		log = default_log_id;
-
-	// FIXME: remove when all USB drivers use libc logging explicitly
-	str_rtrim(message, '\n');
 
 	aid_t reg_msg = async_send_2(exchange, LOGGER_WRITER_MESSAGE,
-	    log, level, NULL);
+	    log_ids[slot], level, NULL);
 	errno_t rc = async_data_write_start(exchange, message, str_size(message));
 	errno_t reg_msg_rc;
 	async_wait_for(reg_msg, &reg_msg_rc);
@@ -108,6 +138,150 @@ static errno_t logger_message(async_sess_t *session, log_t log, log_level_t leve
 	return reg_msg_rc;
 }
 
+/** Append a record to a log ring.
+ *
+ * The caller is the only producer of the ring.
+ *
+ * @param ring Log ring.
+ * @param slot Slot of the log to use.
+ * @param level Verbosity level of the message.
+ * @param message The actual message.
+ * @param kick Set to true if the logger waits for LOGGER_WRITER_KICK.
+ * @return True if the message was stored, false if the ring is full.
+ */
+bool logger_ring_append(logger_ring_t *ring, size_t slot, log_level_t level,
+    const char *message, bool *kick)
+{
+	size_t msg_size = str_size(message) + 1;
+	size_t size = ALIGN_UP(sizeof(logger_record_t) + msg_size,
+	    LOGGER_RING_ALIGN);
+	logger_record_t *rec;
+	uint32_t head;
+	uint32_t off;
+	uint32_t room;
+
+	*kick = false;
+
+	head = ring->head;
+	off = head % LOGGER_RING_DATA_SIZE;
+	room = LOGGER_RING_DATA_SIZE - (head - ring->tail);
+
+	/* Records do not wrap, skip the end of the area if needed. */
+	if (LOGGER_RING_DATA_SIZE - off < size) {
+		if (room < (LOGGER_RING_DATA_SIZE - off) + size)
+			return false;
+
+		rec = (logger_record_t *) &ring->data[off];
+		rec->size = LOGGER_RING_DATA_SIZE - off;
+		rec->slot = LOGGER_RECORD_PAD;
+		head += rec->size;
+		room -= rec->size;
+		off = 0;
+	}
+
+	if (room < size)
+		return false;
+
+	rec = (logger_record_t *) &ring->data[off];
+	rec->size = size;
+	rec->slot = slot;
+	rec->level = level;
+	rec->reserved = 0;
+	memcpy(rec + 1, message, msg_size);
+
+	/* Publish the record before the new position. */
+	write_barrier();
+	ring->head = head + size;
+
+	/* Pairs with the barrier of the logger setting the waiting flag. */
+	memory_barrier();
+	if (ring->waiting != 0) {
+		ring->waiting = 0;
+		*kick = true;
+	}
+
+	return true;
+}
+
+/** Append a message to the log ring shared with the logger.
+ *
+ * The logger is only notified if it has drained the ring and is waiting
+ * for more messages, so a burst of messages costs a single IPC.
+ *
+ * @param slot Slot of the log to use.
+ * @param level Verbosity level of the message.
+ * @param message The actual message.
+ * @return True if the message was stored, false if the ring is full.
+ */
+static bool logger_ring_put(size_t slot, log_level_t level,
+    const char *message)
+{
+	bool kick;
+
+	fibril_mutex_lock(&log_ring_guard);
+	bool stored = logger_ring_append(log_ring, slot, level, message,
+	    &kick);
+	fibril_mutex_unlock(&log_ring_guard);
+
+	if (kick) {
+		async_exch_t *exchange = async_exchange_begin(logger_session);
+		if (exchange != NULL) {
+			async_msg_0(exchange, LOGGER_WRITER_KICK);
+			async_exchange_end(exchange);
+		}
+	}
+
+	return stored;
+}
+
+/** Get the log ring shared with the logger.
+ *
+ * @return Log ring or NULL if messages are sent via IPC.
+ */
+logger_ring_t *log_ring_get(void)
+{
+	return log_ring;
+}
+
+/** Share a log ring with the logger.
+ *
+ * If the logger does not accept it, messages are sent one by one via IPC
+ * and filtering is left to the logger.
+ */
+static void logger_ring_create(void)
+{
+	logger_ring_t *ring = as_area_create(AS_AREA_ANY, sizeof(logger_ring_t),
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (ring == AS_MAP_FAILED)
+		return;
+
+	/* Let everything through until the logger publishes the levels. */
+	memset(ring, 0, sizeof(logger_ring_t));
+	memset((void *) ring->level, LVL_LIMIT - 1, LOGGER_WRITER_LOGS_MAX);
+	ring->waiting = 1;
+
+	async_exch_t *exchange = async_exchange_begin(logger_session);
+	if (exchange == NULL) {
+		as_area_destroy(ring);
+		return;
+	}
+
+	aid_t req = async_send_0(exchange, LOGGER_WRITER_RING, NULL);
+	errno_t rc = async_share_out_start(exchange, ring,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	async_exchange_end(exchange);
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	if (rc != EOK || retval != EOK) {
+		as_area_destroy(ring);
+		return;
+	}
+
+	log_ring = ring;
+}
+
 /** Get name of the log level.
  *
  * @param level The log level.
@@ -172,7 +346,9 @@ errno_t log_init(const char *prog_name)
 		return ENOMEM;
 	}
 
-	default_log_id = log_create(prog_name, LOG_NO_PARENT);
+	logger_ring_create();
+
+	default_log = log_create(prog_name, LOG_NO_PARENT);
 
 	return EOK;
 }
@@ -188,16 +364,22 @@ errno_t log_init(const char *prog_name)
  */
 log_t log_create(const char *name, log_t parent)
 {
+	sysarg_t parent_id = 0;
+
+	if (parent != LOG_NO_PARENT) {
+		size_t slot = log_slot(parent);
+		if (slot >= LOGGER_WRITER_LOGS_MAX)
+			return parent;
+		parent_id = log_ids[slot];
+	}
+
 	async_exch_t *exchange = async_exchange_begin(logger_session);
 	if (exchange == NULL)
 		return parent;
 
-	if (parent == LOG_DEFAULT)
-		parent = default_log_id;
-
 	ipc_call_t answer;
 	aid_t reg_msg = async_send_1(exchange, LOGGER_WRITER_CREATE_LOG,
-	    parent, &answer);
+	    parent_id, &answer);
 	errno_t rc = async_data_write_start(exchange, name, str_size(name));
 	errno_t reg_msg_rc;
 	async_wait_for(reg_msg, &reg_msg_rc);
@@ -207,7 +389,12 @@ log_t log_create(const char *name, log_t parent)
 	if ((rc != EOK) || (reg_msg_rc != EOK))
 		return parent;
 
-	return IPC_GET_ARG1(answer);
+	size_t slot = IPC_GET_ARG2(answer);
+	if (slot >= LOGGER_WRITER_LOGS_MAX)
+		return parent;
+
+	log_ids[slot] = IPC_GET_ARG1(answer);
+	return slot + 1;
 }
 
 /** Write an entry to the log.
@@ -239,12 +426,27 @@ void log_msgv(log_t ctx, log_level_t level, const char *fmt, va_list args)
 {
 	assert(level < LVL_LIMIT);
 
+	size_t slot = log_slot(ctx);
+	if (slot >= LOGGER_WRITER_LOGS_MAX)
+		return;
+
+	/* Filtered messages are dropped before formatting. */
+	if (log_ring != NULL && level > log_ring->level[slot])
+		return;
+
 	char *message_buffer = malloc(MESSAGE_BUFFER_SIZE);
 	if (message_buffer == NULL)
 		return;
 
 	vsnprintf(message_buffer, MESSAGE_BUFFER_SIZE, fmt, args);
-	logger_message(logger_session, ctx, level, message_buffer);
+
+	// FIXME: remove when all USB drivers use libc logging explicitly
+	str_rtrim(message_buffer, '\n');
+
+	/* The logger drains the ring before handling a message sent via IPC. */
+	if (log_ring == NULL || !logger_ring_put(slot, level, message_buffer))
+		logger_message(logger_session, slot, level, message_buffer);
+
 	free(message_buffer);
 }
 
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#include <libc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <abi/profile.h>
+#include <profile.h>
+
+/** Start sampling all CPUs.
+ *
+ * Samples left over from a previous run are discarded.
+ *
+ * @param frequency Sampling frequency in Hz, zero for the highest one.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t profile_start(unsigned int frequency)
+{
+	return (errno_t) __SYSCALL5(SYS_PROFILE, PROFILE_START,
+	    (sysarg_t) frequency, 0, 0, 0);
+}
+
+/** Stop sampling.
+ *
+ * The samples collected so far can still be read.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t profile_stop(void)
+{
+	return (errno_t) __SYSCALL5(SYS_PROFILE, PROFILE_STOP, 0, 0, 0, 0);
+}
+
+/** Read collected samples.
+ *
+ * @param samples Buffer for the samples.
+ * @param count   Capacity of the buffer in samples.
+ * @param nread   Place to store the number of samples read.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+errno_t profile_read(profile_sample_t *samples, size_t count, size_t *nread)
+{
+	size_t size;
+	errno_t rc = (errno_t) __SYSCALL5(SYS_PROFILE, PROFILE_READ, 0,
+	    (sysarg_t) samples, count * sizeof(profile_sample_t),
+	    (sysarg_t) &size);
+	if (rc != EOK)
+		return rc;
+	
+	*nread = size / sizeof(profile_sample_t);
+	return EOK;
+}
+
+/** Resolve a kernel address to a symbol name.
+ *
+ * @param addr   Kernel address.
+ * @param name   Buffer for the symbol name.
+ * @param size   Size of the buffer.
+ * @param offset Place to store the offset of @a addr within the symbol.
+ *
+ * @return EOK on success, ENOENT if there is no such symbol,
+ *         ENOTSUP if the kernel has no symbol table.
+ *
+ */
+errno_t profile_symbol(uintptr_t addr, char *name, size_t size,
+    size_t *offset)
+{
+	return (errno_t) __SYSCALL5(SYS_PROFILE, PROFILE_SYMBOL,
+	    (sysarg_t) addr, (sysarg_t) name, size, (sysarg_t) offset);
+}
+
+/** @}
+ */
@@ -83,7 +83,8 @@ errno_t module_create_static_exec(rtld_t *rtld, module_t **rmodule)
 
 /** (Eagerly) process all relocation tables in a module.
  *
- * Currently works as if LD_BIND_NOW was specified.
+ * PLT relocations are bound lazily where the architecture supports it
+ * and the module does not request immediate binding.
  */
 void module_process_relocs(module_t *m)
 {
@@ -94,8 +95,15 @@ void module_process_relocs(module_t *m)
 
 	module_process_pre_arch(m);
 
-	/* jmp_rel table */
-	if (m->dyn.jmp_rel != NULL) {
+	/*
+	 * jmp_rel table. Unless the module asks for immediate binding,
+	 * let the architecture arrange for PLT entries to be resolved
+	 * on first call.
+	 */
+	if (m->dyn.jmp_rel != NULL && !m->dyn.bind_now &&
+	    module_plt_lazy_arch(m)) {
+		DPRINTF("jmp_rel table bound lazily\n");
+	} else if (m->dyn.jmp_rel != NULL) {
 		DPRINTF("jmp_rel table\n");
 		if (m->dyn.plt_rel == DT_REL) {
 			DPRINTF("jmp_rel table type DT_REL\n");
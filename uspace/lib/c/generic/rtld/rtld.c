@@ -55,6 +55,8 @@ errno_t rtld_init_static(void)
 	runtime_env->next_bias = 0x2000000;
 	runtime_env->program = NULL;
 	runtime_env->next_id = 1;
+	futex_initialize(&runtime_env->sym_cache_lock, 1);
+	futex_initialize(&runtime_env->lock, 1);
 
 	rc = module_create_static_exec(runtime_env, NULL);
 	if (rc != EOK)
@@ -83,6 +85,8 @@ errno_t rtld_prog_process(elf_finfo_t *p_info, rtld_t **rre)
 		return ENOMEM;
 
 	env->next_id = 1;
+	futex_initialize(&env->sym_cache_lock, 1);
+	futex_initialize(&env->lock, 1);
 
 	prog = calloc(1, sizeof(module_t));
 	if (prog == NULL) {
@@ -44,6 +44,36 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/symbol.h>
 
+/** Number of buckets in the symbol cache */
+#define SYM_CACHE_BUCKETS  256
+
+/** Number of bits in a GNU hash Bloom filter word */
+#define BLOOM_BITS  (sizeof(uintptr_t) * 8)
+
+/** Symbol name together with its hash values */
+typedef struct {
+	const char *name;
+	/** GNU hash, always valid */
+	elf_word gnu_hash;
+	/** SysV hash, computed on first use */
+	elf_word sysv_hash;
+	bool sysv_valid;
+} sym_key_t;
+
+/** Cached result of a lookup in the global scope.
+ *
+ * Entries are never freed. The bucket array and the entries may come from
+ * the heap of the program loader, which we must not try to release.
+ */
+typedef struct symbol_cache_entry {
+	struct symbol_cache_entry *next;
+	const char *name;
+	elf_word hash;
+	symbol_search_flags_t flags;
+	elf_symbol_t *sym;
+	module_t *mod;
+} symbol_cache_entry_t;
+
 /*
  * Hash tables are 32-bit (elf_word) even for 64-bit ELF files.
  */
@@ -61,38 +91,116 @@ static elf_word elf_hash(const unsigned char *name)
 	return h;
 }
 
-static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
+static elf_word gnu_hash(const unsigned char *name)
+{
+	elf_word h = 5381;
+
+	while (*name)
+		h = (h << 5) + h + *name++;
+
+	return h;
+}
+
+static void sym_key_init(sym_key_t *key, const char *name)
+{
+	key->name = name;
+	key->gnu_hash = gnu_hash((const unsigned char *) name);
+	key->sysv_valid = false;
+}
+
+/** Look a symbol up using the SysV DT_HASH table. */
+static elf_symbol_t *def_find_sysv(sym_key_t *key, module_t *m)
 {
 	elf_symbol_t *sym_table;
-	elf_symbol_t *s, *sym;
+	elf_symbol_t *s;
 	elf_word nbucket;
 	/*elf_word nchain;*/
 	elf_word i;
 	char *s_name;
 	elf_word bucket;
 
-	DPRINTF("def_find_in_module('%s', %s)\n", name, m->dyn.soname);
+	if (!key->sysv_valid) {
+		key->sysv_hash = elf_hash((const unsigned char *) key->name);
+		key->sysv_valid = true;
+	}
 
 	sym_table = m->dyn.sym_tab;
 	nbucket = m->dyn.hash[0];
 	/*nchain = m->dyn.hash[1]; XXX Use to check HT range*/
 
-	bucket = elf_hash((unsigned char *)name) % nbucket;
+	bucket = key->sysv_hash % nbucket;
 	i = m->dyn.hash[2 + bucket];
 
-	sym = NULL;
 	while (i != STN_UNDEF) {
 		s = &sym_table[i];
 		s_name = m->dyn.str_tab + s->st_name;
 
-		if (str_cmp(name, s_name) == 0) {
-			sym = s;
-			break;
-		}
+		if (str_cmp(key->name, s_name) == 0)
+			return s;
 
 		i = m->dyn.hash[2 + nbucket + i];
 	}
 
+	return NULL;
+}
+
+/** Look a symbol up using the DT_GNU_HASH table.
+ *
+ * Most modules do not define most of the symbols looked for in them, so
+ * the Bloom filter lets us reject those without touching the hash chains
+ * or the string table.
+ */
+static elf_symbol_t *def_find_gnu(sym_key_t *key, module_t *m)
+{
+	elf_word *gh = m->dyn.gnu_hash;
+	elf_word nbuckets = gh[0];
+	elf_word symoffset = gh[1];
+	elf_word bloom_size = gh[2];
+	elf_word bloom_shift = gh[3];
+	uintptr_t *bloom = (uintptr_t *) &gh[4];
+	elf_word *buckets = (elf_word *) &bloom[bloom_size];
+	elf_word *chain = &buckets[nbuckets];
+	elf_symbol_t *sym_table = m->dyn.sym_tab;
+	elf_word h = key->gnu_hash;
+	elf_word i, h2;
+
+	uintptr_t word = bloom[(h / BLOOM_BITS) % bloom_size];
+	uintptr_t mask = ((uintptr_t) 1 << (h % BLOOM_BITS)) |
+	    ((uintptr_t) 1 << ((h >> bloom_shift) % BLOOM_BITS));
+	if ((word & mask) != mask)
+		return NULL;
+
+	i = buckets[h % nbuckets];
+	if (i < symoffset)
+		return NULL;
+
+	while (true) {
+		h2 = chain[i - symoffset];
+
+		if ((h | 1) == (h2 | 1) && str_cmp(key->name,
+		    m->dyn.str_tab + sym_table[i].st_name) == 0)
+			return &sym_table[i];
+
+		/* The lowest bit marks the end of the chain */
+		if ((h2 & 1) != 0)
+			break;
+		++i;
+	}
+
+	return NULL;
+}
+
+static elf_symbol_t *def_find_in_module(sym_key_t *key, module_t *m)
+{
+	elf_symbol_t *sym;
+
+	DPRINTF("def_find_in_module('%s', %s)\n", key->name, m->dyn.soname);
+
+	if (m->dyn.gnu_hash != NULL)
+		sym = def_find_gnu(key, m);
+	else
+		sym = def_find_sysv(key, m);
+
 	if (!sym)
 		return NULL;	/* Not found */
 
@@ -104,6 +212,72 @@ static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
 	return sym; /* Found */
 }
 
+/** Look up a symbol in the global scope cache.
+ *
+ * @return Cached definition or NULL if the symbol is not cached.
+ */
+static elf_symbol_t *sym_cache_find(rtld_t *rtld, sym_key_t *key,
+    symbol_search_flags_t flags, module_t **mod)
+{
+	symbol_cache_entry_t *e;
+	elf_symbol_t *sym = NULL;
+
+	futex_lock(&rtld->sym_cache_lock);
+
+	if (rtld->sym_cache != NULL) {
+		e = rtld->sym_cache[key->gnu_hash % SYM_CACHE_BUCKETS];
+		while (e != NULL) {
+			if (e->hash == key->gnu_hash && e->flags == flags &&
+			    str_cmp(e->name, key->name) == 0) {
+				sym = e->sym;
+				*mod = e->mod;
+				break;
+			}
+			e = e->next;
+		}
+	}
+
+	futex_unlock(&rtld->sym_cache_lock);
+	return sym;
+}
+
+/** Remember a symbol definition found in the global scope.
+ *
+ * Modules are only ever appended to the global scope, so once a definition
+ * is found, later lookups of the same name will find the same one. Failed
+ * lookups are not cached for the same reason.
+ */
+static void sym_cache_insert(rtld_t *rtld, sym_key_t *key,
+    symbol_search_flags_t flags, elf_symbol_t *sym, module_t *mod)
+{
+	symbol_cache_entry_t *e;
+	elf_word bucket = key->gnu_hash % SYM_CACHE_BUCKETS;
+
+	futex_lock(&rtld->sym_cache_lock);
+
+	if (rtld->sym_cache == NULL) {
+		rtld->sym_cache = calloc(SYM_CACHE_BUCKETS,
+		    sizeof(symbol_cache_entry_t *));
+		if (rtld->sym_cache == NULL)
+			goto out;
+	}
+
+	e = malloc(sizeof(symbol_cache_entry_t));
+	if (e == NULL)
+		goto out;
+
+	/* The name lives in the string table of the referencing module */
+	e->name = key->name;
+	e->hash = key->gnu_hash;
+	e->flags = flags;
+	e->sym = sym;
+	e->mod = mod;
+	e->next = rtld->sym_cache[bucket];
+	rtld->sym_cache[bucket] = e;
+out:
+	futex_unlock(&rtld->sym_cache_lock);
+}
+
 /** Find the definition of a symbol in a module and its deps.
  *
  * Search the module dependency graph is breadth-first, beginning
@@ -120,9 +294,12 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 {
 	module_t *m, *dm;
 	elf_symbol_t *sym, *s;
+	sym_key_t key;
 	list_t queue;
 	size_t i;
 
+	sym_key_init(&key, name);
+
 	/*
 	 * Do a BFS using the queue_link and bfs_tag fields.
 	 * Vertices (modules) are tagged the moment they are inserted
@@ -148,7 +325,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 		list_remove(&m->queue_link);
 
 		/* If ssf_noroot is specified, do not look in start module */
-		s = def_find_in_module(name, m);
+		s = def_find_in_module(&key, m);
 		if (s != NULL) {
 			/* Symbol found */
 			sym = s;
@@ -199,16 +376,20 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
     symbol_search_flags_t flags, module_t **mod)
 {
 	elf_symbol_t *s;
+	sym_key_t key;
 
 	DPRINTF("symbol_def_find('%s', origin='%s'\n",
 	    name, origin->dyn.soname);
+
+	sym_key_init(&key, name);
+
 	if (origin->dyn.symbolic && (!origin->exec || (flags & ssf_noexec) == 0)) {
 		DPRINTF("symbolic->find '%s' in module '%s'\n", name, origin->dyn.soname);
 		/*
 		 * Origin module has a DT_SYMBOLIC flag.
 		 * Try this module first
 		 */
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&key, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -218,13 +399,18 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 
 	/* Not DT_SYMBOLIC or no match. Now try other locations. */
 
+	s = sym_cache_find(origin->rtld, &key, flags, mod);
+	if (s != NULL)
+		return s;
+
 	list_foreach(origin->rtld->modules, modules_link, module_t, m) {
 		DPRINTF("module '%s' local?\n", m->dyn.soname);
 		if (!m->local && (!m->exec || (flags & ssf_noexec) == 0)) {
 			DPRINTF("!local->find '%s' in module '%s'\n", name, m->dyn.soname);
-			s = def_find_in_module(name, m);
+			s = def_find_in_module(&key, m);
 			if (s != NULL) {
 				/* Found */
+				sym_cache_insert(origin->rtld, &key, flags, s, m);
 				*mod = m;
 				return s;
 			}
@@ -237,7 +423,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 	    origin->dyn.soname);
 
 	if (!origin->exec || (flags & ssf_noexec) == 0) {
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(&key, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
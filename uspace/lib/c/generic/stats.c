@@ -236,6 +236,61 @@ stats_exc_t *stats_get_exceptions(size_t *count)
 	return stats_exceptions;
 }
 
+/** Get slab cache statistics
+ *
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_slab_t structures.
+ *         If non-NULL then it should be eventually freed
+ *         by free().
+ *
+ */
+stats_slab_t *stats_get_slabs(size_t *count)
+{
+	size_t size = 0;
+	stats_slab_t *stats_slabs =
+	    (stats_slab_t *) sysinfo_get_data("system.slabs", &size);
+	
+	if ((size % sizeof(stats_slab_t)) != 0) {
+		if (stats_slabs != NULL)
+			free(stats_slabs);
+		*count = 0;
+		return NULL;
+	}
+	
+	*count = size / sizeof(stats_slab_t);
+	return stats_slabs;
+}
+
+/** Get kernel lock contention statistics
+ *
+ * The statistics are available only if the kernel has been
+ * compiled with CONFIG_LOCKSTAT.
+ *
+ * @param count Number of records returned.
+ *
+ * @return Array of stats_lock_t structures.
+ *         If non-NULL then it should be eventually freed
+ *         by free().
+ *
+ */
+stats_lock_t *stats_get_locks(size_t *count)
+{
+	size_t size = 0;
+	stats_lock_t *stats_locks =
+	    (stats_lock_t *) sysinfo_get_data("system.locks", &size);
+	
+	if ((size % sizeof(stats_lock_t)) != 0) {
+		if (stats_locks != NULL)
+			free(stats_locks);
+		*count = 0;
+		return NULL;
+	}
+	
+	*count = size / sizeof(stats_lock_t);
+	return stats_locks;
+}
+
 /** Get single exception statistics
  *
  * @param excn Exception number we are interested in.
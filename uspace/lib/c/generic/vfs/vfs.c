@@ -224,6 +224,26 @@ char *vfs_absolutize(const char *path, size_t *retlen)
 	return ncwd_path;
 }
 
+/** Advise VFS about the expected access pattern of a file
+ *
+ * The advice is only a hint. For files advised as sequential, VFS reads ahead
+ * of the client so that the file system server has the data ready by the time
+ * it is requested.
+ *
+ * @param file          File handle
+ * @param advice        One of VFS_ADVICE_*
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_advise(int file, vfs_advice_t advice)
+{
+	async_exch_t *exch = vfs_exchange_begin();
+	errno_t rc = async_req_2_0(exch, VFS_IN_ADVISE, file, advice);
+	vfs_exchange_end(exch);
+	
+	return rc;
+}
+
 /** Clone a file handle
  *
  * The caller can choose whether to clone an existing file handle into another
@@ -791,6 +811,26 @@ errno_t vfs_put(int file)
 	return rc;
 }
 
+/** Get pager ID of an open file
+ *
+ * The ID can be used as the first pager argument of an area paged in by
+ * the VFS pager. It stays valid until the calling task terminates, so the
+ * file handle can be closed once the area is created.
+ *
+ * @param file  File handle opened for reading
+ * @param[out] id  Pager ID
+ *
+ * @return      EOK on success or an error code
+ */
+errno_t vfs_pager_ref(int file, sysarg_t *id)
+{
+	async_exch_t *exch = vfs_exchange_begin();
+	errno_t rc = async_req_1_1(exch, VFS_IN_PAGER_REF, file, id);
+	vfs_exchange_end(exch);
+	
+	return rc;
+}
+
 /** Receive a file handle from another VFS client
  *
  * @param high   If true, the received file handle will be allocated from high
@@ -908,6 +948,56 @@ errno_t vfs_read_short(int file, aoff64_t pos, void *buf, size_t nbyte,
 	return EOK;
 }
 
+/** Read a batch of directory entries
+ *
+ * Fill @a buf with as many vfs_dirent_t records as fit, starting at the
+ * directory position @a *pos. The file system server resumes at the position
+ * it returned last time, so consecutive calls do not rescan the directory.
+ * Zero bytes read with EOK means there are no more entries.
+ *
+ * @param file          Directory handle to read from
+ * @param[inout] pos    Position to read from, updated to the position of the
+ *			first entry that was not returned
+ * @param flags		VFS_READDIR_* flags
+ * @param buf           Buffer for the entries, @a nbyte bytes long
+ * @param nbyte         Size of the buffer
+ * @param[out] nread	Number of bytes of records stored in @a buf
+ *
+ * @return              EOK on success, ENOTSUP if the file system does not
+ *			support batched reading, ELIMIT if the buffer cannot
+ *			hold even a single entry or another error code
+ */
+errno_t vfs_read_dir(int file, aoff64_t *pos, int flags, void *buf,
+    size_t nbyte, size_t *nread)
+{
+	errno_t rc;
+	ipc_call_t answer;
+	aid_t req;
+	
+	if (nbyte > DATA_XFER_LIMIT)
+		nbyte = DATA_XFER_LIMIT;
+	
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	req = async_send_4(exch, VFS_IN_READDIR, file, LOWER32(*pos),
+	    UPPER32(*pos), flags, &answer);
+	rc = async_data_read_start(exch, buf, nbyte);
+
+	vfs_exchange_end(exch);
+	
+	if (rc == EOK)
+		async_wait_for(req, &rc);
+	else
+		async_forget(req);
+	
+	if (rc != EOK)
+		return rc;
+	
+	*nread = IPC_GET_ARG1(answer);
+	*pos = MERGE_LOUP32(IPC_GET_ARG2(answer), IPC_GET_ARG3(answer));
+	return EOK;
+}
+
 /** Rename a file or directory
  *
  * There is no file-handle-based variant to disallow attempts to introduce loops
@@ -38,6 +38,8 @@
 #define NAME_MAX  256
 
 #include <offset.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 struct dirent {
 	char d_name[NAME_MAX + 1];
@@ -47,6 +49,14 @@ typedef struct {
 	int fd;
 	struct dirent res;
 	aoff64_t pos;
+	/** Batch of entries read ahead from the file system. */
+	void *buf;
+	/** Number of valid bytes in @c buf. */
+	size_t buf_len;
+	/** Offset of the next entry to return from @c buf. */
+	size_t buf_off;
+	/** File system cannot read directories in batches. */
+	bool single;
 } DIR;
 
 extern DIR *opendir(const char *);
@@ -38,6 +38,7 @@
 #define ELF_MOD_H_
 
 #include <elf/elf.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <loader/pcb.h>
@@ -55,7 +56,10 @@
 #define EE_IO			7	/* Could not read file. */
 
 typedef enum {
-	/** Leave all segments in RW access mode. */
+	/**
+	 * Leave all segments in RW access mode. Read-only segments of images
+	 * without text relocations are still mapped read-only from the file.
+	 */
 	ELDF_RW = 1
 } eld_flags_t;
 
@@ -106,6 +110,12 @@ typedef struct {
 
 	/** Store extracted info here */
 	elf_finfo_t *info;
+
+	/** The image needs to relocate its read-only segments */
+	bool text_rel;
+
+	/** Pager ID of @c fd if some segments are paged in on demand, or 0 */
+	sysarg_t pager_id;
 } elf_ld_t;
 
 extern const char *elf_error(unsigned int);
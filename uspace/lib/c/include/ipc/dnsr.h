@@ -38,7 +38,9 @@
 typedef enum {
 	DNSR_NAME2HOST = IPC_FIRST_USER_METHOD,
 	DNSR_GET_SRVADDR,
-	DNSR_SET_SRVADDR
+	DNSR_SET_SRVADDR,
+	DNSR_GET_CACHE_STATS,
+	DNSR_CACHE_FLUSH
 } dnsr_request_t;
 
 #endif
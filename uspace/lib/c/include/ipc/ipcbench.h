@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libcipc
+ * @{
+ */
+/** @file
+ * IPC benchmark echo server protocol
+ */
+
+#ifndef LIBC_IPC_IPCBENCH_H_
+#define LIBC_IPC_IPCBENCH_H_
+
+#include <ipc/common.h>
+
+/** Largest data transfer or shared area used by the benchmark */
+#define IPCBENCH_DATA_MAX  (64 * 1024)
+
+typedef enum {
+	/** Answer immediately.
+	 *
+	 * Returns: EOK
+	 */
+	IPCBENCH_PING = IPC_FIRST_USER_METHOD,
+	/** Answer with the five arguments of the call.
+	 *
+	 * Arguments: five arbitrary values
+	 * Returns: EOK, the same five values
+	 */
+	IPCBENCH_ECHO,
+	/** Read data from the server.
+	 *
+	 * Returns: error code
+	 * Followed by: async_data_read_start() of up to IPCBENCH_DATA_MAX bytes
+	 */
+	IPCBENCH_DATA_READ,
+	/** Write data to the server, which discards it.
+	 *
+	 * Returns: error code
+	 * Followed by: async_data_write_start() of up to IPCBENCH_DATA_MAX
+	 * bytes
+	 */
+	IPCBENCH_DATA_WRITE,
+	/** Map an area of the server.
+	 *
+	 * Returns: error code
+	 * Followed by: async_share_in_start() of up to IPCBENCH_DATA_MAX bytes
+	 */
+	IPCBENCH_SHARE_IN,
+	/** Share an area with the server, which unmaps it immediately.
+	 *
+	 * Returns: error code
+	 * Followed by: async_share_out_start()
+	 */
+	IPCBENCH_SHARE_OUT,
+	/** Forward the call to the naming service as NS_PING.
+	 *
+	 * Returns: EOK (answered by the naming service)
+	 */
+	IPCBENCH_FORWARD
+} ipcbench_request_t;
+
+#endif
+
+/** @}
+ */
@@ -34,6 +34,7 @@
 #define LIBC_IPC_LOGGER_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	/** Set (global) default displayed logging level.
@@ -61,7 +62,7 @@ typedef enum {
 	/** Create new log.
 	 *
 	 * Arguments: parent log id (0 for top-level log).
-	 * Returns: error code, log id
+	 * Returns: error code, log id, slot of the log in the log ring
 	 * Followed by: string with log name.
 	 */
 	LOGGER_WRITER_CREATE_LOG = IPC_FIRST_USER_METHOD,
@@ -71,9 +72,70 @@ typedef enum {
 	 * Returns: error code
 	 * Followed by: string with the message.
 	 */
-	LOGGER_WRITER_MESSAGE
+	LOGGER_WRITER_MESSAGE,
+	/** Share a log ring (logger_ring_t) with the logger.
+	 *
+	 * Returns: error code
+	 * Followed by: async_share_out_start() of the ring.
+	 */
+	LOGGER_WRITER_RING,
+	/** Messages were appended to the log ring.
+	 *
+	 * Only sent when the logger asked for it by setting
+	 * logger_ring_t.waiting. The answer is ignored.
+	 */
+	LOGGER_WRITER_KICK
 } logger_writer_request_t;
 
+/** Maximum number of logs a writer client can create */
+#define LOGGER_WRITER_LOGS_MAX  100
+
+/** Size of the message area of the log ring (power of two) */
+#define LOGGER_RING_DATA_SIZE  16384
+
+/** Alignment of records in the log ring */
+#define LOGGER_RING_ALIGN  8
+
+/** Slot of a record only padding the end of the message area */
+#define LOGGER_RECORD_PAD  UINT16_MAX
+
+/** Record in the log ring, followed by the NUL-terminated message.
+ *
+ * Records never wrap around the end of the message area, the rest of the
+ * area is skipped using a padding record instead.
+ */
+typedef struct {
+	/** Size of the record including the header, aligned */
+	uint32_t size;
+	/** Slot of the log (as returned by LOGGER_WRITER_CREATE_LOG) */
+	uint16_t slot;
+	/** Message level (log_level_t) */
+	uint8_t level;
+	uint8_t reserved;
+} logger_record_t;
+
+/** Log ring shared between a writer client and the logger.
+ *
+ * The client is the only producer and the logger is the only consumer of
+ * the message area, so the positions need no locking. The logger also
+ * publishes the effective level of every log of the client so that the
+ * client can drop filtered messages without formatting them.
+ */
+typedef struct {
+	/** Effective level of each log slot, written by the logger */
+	volatile uint8_t level[LOGGER_WRITER_LOGS_MAX];
+
+	/** Producer position, written by the client */
+	volatile uint32_t head;
+	/** Consumer position, written by the logger */
+	volatile uint32_t tail;
+	/** Logger waits for LOGGER_WRITER_KICK before draining again */
+	volatile uint32_t waiting;
+
+	/** Message area */
+	uint8_t data[LOGGER_RING_DATA_SIZE];
+} logger_ring_t;
+
 #endif
 
 /** @}
@@ -55,6 +55,7 @@ typedef enum {
 #define SERVICE_NAME_CORECFG  "corecfg"
 #define SERVICE_NAME_DHCP     "net/dhcp"
 #define SERVICE_NAME_DNSR     "net/dnsr"
+#define SERVICE_NAME_IPCBENCH "ipcbench/echo"
 #define SERVICE_NAME_INET     "net/inet"
 #define SERVICE_NAME_NETCONF  "net/netconf"
 #define SERVICE_NAME_UDP      "net/udp"
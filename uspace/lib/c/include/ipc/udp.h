@@ -35,7 +35,10 @@
 #ifndef LIBC_IPC_UDP_H_
 #define LIBC_IPC_UDP_H_
 
+#include <align.h>
+#include <inet/endpoint.h>
 #include <ipc/common.h>
+#include <stddef.h>
 
 typedef enum {
 	UDP_CALLBACK_CREATE = IPC_FIRST_USER_METHOD,
@@ -45,13 +48,48 @@ typedef enum {
 	UDP_ASSOC_SEND_MSG,
 	UDP_RMSG_INFO,
 	UDP_RMSG_READ,
-	UDP_RMSG_DISCARD
+	UDP_RMSG_DISCARD,
+	UDP_BATCH_SHARE,
+	UDP_ASSOC_SEND_BATCH,
+	UDP_RMSG_RECV_BATCH
 } udp_request_t;
 
 typedef enum {
 	UDP_EV_DATA = IPC_FIRST_USER_METHOD
 } udp_event_t;
 
+/** Size of the buffer shared by client for batched transfers */
+#define UDP_BATCH_SIZE  (128 * 1024)
+
+/** Offset of the part of the batch buffer used for sending */
+#define UDP_BATCH_TX_OFF  0
+
+/** Offset of the part of the batch buffer used for receiving */
+#define UDP_BATCH_RX_OFF  (UDP_BATCH_SIZE / 2)
+
+/** Size of each part of the batch buffer */
+#define UDP_BATCH_PART_SIZE  (UDP_BATCH_SIZE / 2)
+
+/** Message in batch buffer
+ *
+ * Each message header is followed by @c size bytes of message data.
+ * The next header starts at the following multiple of sizeof(sysarg_t).
+ */
+typedef struct {
+	/** Association ID (receive only) */
+	sysarg_t assoc_id;
+	/** Remote endpoint */
+	inet_ep_t remote;
+	/** @c remote is set (send only) */
+	sysarg_t has_remote;
+	/** Message data size */
+	size_t size;
+} udp_batch_msg_t;
+
+/** Space taken in batch buffer by message with data of size @a size */
+#define UDP_BATCH_MSG_SPACE(size) \
+	((size_t) ALIGN_UP(sizeof(udp_batch_msg_t) + (size), sizeof(sysarg_t)))
+
 #endif
 
 /** @}
@@ -61,6 +61,17 @@ typedef struct {
 	unsigned int instance;
 	bool concurrent_read_write;
 	bool write_retains_size;
+	/**
+	 * The name space only changes through VFS, so VFS can cache the
+	 * results of name lookups.
+	 */
+	bool cache_lookups;
+	/**
+	 * File data are kept in a block cache, so VFS can read ahead of
+	 * sequential readers to have the data cached by the time they
+	 * ask for them.
+	 */
+	bool read_ahead;
 } vfs_info_t;
 
 /** Data returned by filesystem probe regarding a specific volume. */
@@ -70,13 +81,16 @@ typedef struct {
 } vfs_fs_probe_info_t;
 
 typedef enum {
-	VFS_IN_CLONE = IPC_FIRST_USER_METHOD,
+	VFS_IN_ADVISE = IPC_FIRST_USER_METHOD,
+	VFS_IN_CLONE,
 	VFS_IN_FSPROBE,
 	VFS_IN_FSTYPES,
 	VFS_IN_MOUNT,
 	VFS_IN_OPEN,
+	VFS_IN_PAGER_REF,
 	VFS_IN_PUT,
 	VFS_IN_READ,
+	VFS_IN_READDIR,
 	VFS_IN_REGISTER,
 	VFS_IN_RENAME,
 	VFS_IN_RESIZE,
@@ -100,6 +114,7 @@ typedef enum {
 	VFS_OUT_MOUNTED,
 	VFS_OUT_OPEN_NODE,
 	VFS_OUT_READ,
+	VFS_OUT_READDIR,
 	VFS_OUT_STAT,
 	VFS_OUT_STATFS,
 	VFS_OUT_SYNC,
@@ -184,6 +199,59 @@ enum {
 	VFS_MOUNT_NO_REF = 4,
 };
 
+/** Access pattern hints as passed by VFS_IN_ADVISE. */
+typedef enum {
+	/** No particular access pattern, the default. */
+	VFS_ADVICE_NORMAL = 0,
+	/** The file will be read sequentially, VFS should read ahead. */
+	VFS_ADVICE_SEQUENTIAL,
+	/** The file will be accessed randomly, reading ahead is useless. */
+	VFS_ADVICE_RANDOM
+} vfs_advice_t;
+
+/*
+ * Batched directory reading.
+ */
+
+/** Fill in the index and size of each returned directory entry. */
+#define VFS_READDIR_ATTRS	1
+
+/** Type of a node as reported by VFS_IN_READDIR. */
+enum {
+	VFS_DT_UNKNOWN = 0,
+	VFS_DT_FILE = 1,
+	VFS_DT_DIR = 2,
+};
+
+/** Directory entry record as returned by VFS_IN_READDIR.
+ *
+ * The records are packed back to back in the client buffer, each of them
+ * starting at an 8-byte boundary. The name is NUL-terminated. The index and
+ * size fields are only meaningful if VFS_READDIR_ATTRS was requested and the
+ * file system was able to provide them cheaply; otherwise they are zero.
+ */
+typedef struct {
+	/** Length of the whole record including the name and padding. */
+	uint32_t reclen;
+	/** One of VFS_DT_*. */
+	uint8_t type;
+	uint8_t pad[3];
+	/** Node index within the file system. */
+	uint64_t index;
+	/** Size of the node. */
+	uint64_t size;
+	/** Position of the entry following this one. */
+	uint64_t next_pos;
+	/** NUL-terminated name. */
+	char name[];
+} vfs_dirent_t;
+
+#define VFS_DIRENT_ALIGN(len)	(((len) + 7) & ~((size_t) 7))
+
+/** Size of a record holding a name of @a nlen bytes (without the NUL). */
+#define VFS_DIRENT_SIZE(nlen) \
+	VFS_DIRENT_ALIGN(sizeof(vfs_dirent_t) + (nlen) + 1)
+
 enum {
 	MODE_READ = 1,
 	MODE_WRITE = 2,
@@ -57,6 +57,9 @@ extern stats_thread_t *stats_get_thread(thread_id_t);
 extern stats_exc_t *stats_get_exceptions(size_t *);
 extern stats_exc_t *stats_get_exception(unsigned int);
 
+extern stats_slab_t *stats_get_slabs(size_t *);
+extern stats_lock_t *stats_get_locks(size_t *);
+
 extern void stats_print_load_fragment(load_t, unsigned int);
 extern const char *thread_get_state(state_t);
 
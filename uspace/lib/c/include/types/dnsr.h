@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/**
+ * @file
+ * @brief
+ */
+
+#ifndef LIBC_TYPES_DNSR_H_
+#define LIBC_TYPES_DNSR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** DNS resolver cache statistics */
+typedef struct {
+	/** Number of entries currently in the cache */
+	size_t entries;
+	/** Lookups answered with a cached address */
+	uint64_t hits;
+	/** Lookups answered with a cached negative answer */
+	uint64_t neg_hits;
+	/** Lookups that had to query the name server */
+	uint64_t misses;
+	/** Lookups that waited for an identical query already in flight */
+	uint64_t coalesced;
+	/** Background refreshes of frequently used entries */
+	uint64_t refreshes;
+	/** Entries discarded because their TTL expired */
+	uint64_t expired;
+	/** Entries discarded to make room for new ones */
+	uint64_t evicted;
+} dnsr_cache_stats_t;
+
+#endif
+
+/** @}
+ */
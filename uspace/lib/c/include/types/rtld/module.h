@@ -72,6 +72,8 @@ typedef struct module {
 
 	/** True iff relocations have already been processed in this module. */
 	bool relocated;
+	/** True iff PLT relocations are resolved lazily on first call. */
+	bool lazy_plt;
 
 	/** Link to list of all modules in runtime environment */
 	link_t modules_link;
@@ -37,6 +37,7 @@
 
 #include <adt/list.h>
 #include <elf/elf_mod.h>
+#include <futex.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -62,6 +63,17 @@ typedef struct rtld {
 
 	/** Temporary hack to place each module at different address. */
 	uintptr_t next_bias;
+
+	/**
+	 * Serializes run-time symbol lookups (dlsym(), lazy PLT binding)
+	 * with each other and with loading modules in dlopen()
+	 */
+	futex_t lock;
+
+	/** Buckets of the cache of symbols found in the global scope */
+	struct symbol_cache_entry **sym_cache;
+	/** Protects sym_cache */
+	futex_t sym_cache_lock;
 } rtld_t;
 
 #endif
@@ -65,6 +65,8 @@ typedef struct {
 	bool is_directory;
 	aoff64_t size;
 	service_id_t service;
+	/** Preferred I/O block size, zero if unknown. */
+	uint32_t blksize;
 } vfs_stat_t;
 
 typedef struct {
@@ -84,6 +86,7 @@ typedef struct {
 extern errno_t vfs_fhandle(FILE *, int *);
 
 extern char *vfs_absolutize(const char *, size_t *);
+extern errno_t vfs_advise(int, vfs_advice_t);
 extern errno_t vfs_clone(int, int, bool, int *);
 extern errno_t vfs_cwd_get(char *path, size_t);
 extern errno_t vfs_cwd_set(const char *path);
@@ -102,9 +105,11 @@ extern errno_t vfs_mount(int, const char *, service_id_t, const char *, unsigned
     unsigned, int *);
 extern errno_t vfs_open(int, int);
 extern errno_t vfs_pass_handle(async_exch_t *, int, async_exch_t *);
+extern errno_t vfs_pager_ref(int, sysarg_t *);
 extern errno_t vfs_put(int);
 extern errno_t vfs_read(int, aoff64_t *, void *, size_t, size_t *);
 extern errno_t vfs_read_short(int, aoff64_t, void *, size_t, ssize_t *);
+extern errno_t vfs_read_dir(int, aoff64_t *, int, void *, size_t, size_t *);
 extern errno_t vfs_receive_handle(bool, int *);
 extern errno_t vfs_rename_path(const char *, const char *);
 extern errno_t vfs_resize(int, aoff64_t);
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <align.h>
+#include <io/log.h>
+#include <ipc/logger.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../../generic/private/log.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(log);
+
+/** Message giving records that leave space at the end of the area */
+#define MESSAGE \
+	"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+
+#define RECORD_SIZE \
+	ALIGN_UP(sizeof(logger_record_t) + sizeof(MESSAGE), LOGGER_RING_ALIGN)
+
+static logger_ring_t *ring;
+
+/** Fill the ring with records of RECORD_SIZE bytes
+ *
+ * @return Number of records appended
+ */
+static size_t fill(void)
+{
+	size_t count = 0;
+	bool kick;
+
+	while (logger_ring_append(ring, 1, LVL_NOTE, MESSAGE, &kick))
+		count++;
+
+	return count;
+}
+
+/** Check the record at position @a pos in the ring */
+static void check_record(uint32_t pos, uint16_t slot, uint8_t level,
+    const char *message)
+{
+	logger_record_t *rec = (logger_record_t *)
+	    &ring->data[pos % LOGGER_RING_DATA_SIZE];
+
+	PCUT_ASSERT_INT_EQUALS(ALIGN_UP(sizeof(logger_record_t) +
+	    str_size(message) + 1, LOGGER_RING_ALIGN), rec->size);
+	PCUT_ASSERT_INT_EQUALS(slot, rec->slot);
+	PCUT_ASSERT_INT_EQUALS(level, rec->level);
+	PCUT_ASSERT_STR_EQUALS(message, (char *) (rec + 1));
+}
+
+PCUT_TEST_BEFORE
+{
+	ring = calloc(1, sizeof(logger_ring_t));
+	PCUT_ASSERT_NOT_NULL(ring);
+}
+
+PCUT_TEST_AFTER
+{
+	free(ring);
+}
+
+/** Appended records are aligned and hold the message */
+PCUT_TEST(append)
+{
+	bool kick;
+
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 3, LVL_WARN, "abc", &kick));
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 4, LVL_DEBUG, "", &kick));
+	PCUT_ASSERT_INT_EQUALS(0, ring->tail);
+
+	check_record(0, 3, LVL_WARN, "abc");
+	uint32_t pos = ((logger_record_t *) ring->data)->size;
+	check_record(pos, 4, LVL_DEBUG, "");
+	PCUT_ASSERT_INT_EQUALS(pos + ALIGN_UP(sizeof(logger_record_t) + 1,
+	    LOGGER_RING_ALIGN), ring->head);
+}
+
+/** The logger is only kicked when it waits for messages */
+PCUT_TEST(kick)
+{
+	bool kick;
+
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 0, LVL_NOTE, "a", &kick));
+	PCUT_ASSERT_FALSE(kick);
+
+	ring->waiting = 1;
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 0, LVL_NOTE, "b", &kick));
+	PCUT_ASSERT_TRUE(kick);
+	PCUT_ASSERT_INT_EQUALS(0, ring->waiting);
+
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 0, LVL_NOTE, "c", &kick));
+	PCUT_ASSERT_FALSE(kick);
+}
+
+/** A full ring refuses records and is left unchanged */
+PCUT_TEST(overflow)
+{
+	bool kick;
+
+	size_t count = fill();
+	PCUT_ASSERT_INT_EQUALS(LOGGER_RING_DATA_SIZE / RECORD_SIZE, count);
+	PCUT_ASSERT_INT_EQUALS(count * RECORD_SIZE, ring->head);
+
+	PCUT_ASSERT_TRUE(LOGGER_RING_DATA_SIZE - ring->head < RECORD_SIZE);
+
+	ring->waiting = 1;
+	PCUT_ASSERT_FALSE(logger_ring_append(ring, 1, LVL_NOTE, MESSAGE,
+	    &kick));
+	PCUT_ASSERT_INT_EQUALS(count * RECORD_SIZE, ring->head);
+	PCUT_ASSERT_FALSE(kick);
+	PCUT_ASSERT_INT_EQUALS(1, ring->waiting);
+}
+
+/** Records do not wrap, the end of the area is skipped using padding */
+PCUT_TEST(wrap)
+{
+	size_t count = fill();
+	uint32_t end = count * RECORD_SIZE;
+
+	/* The rest of the area is too short for a record */
+	PCUT_ASSERT_TRUE(end < LOGGER_RING_DATA_SIZE);
+
+	/* Consume two records */
+	ring->tail = 2 * RECORD_SIZE;
+
+	bool kick;
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 2, LVL_ERROR, MESSAGE,
+	    &kick));
+
+	logger_record_t *pad = (logger_record_t *) &ring->data[end];
+	PCUT_ASSERT_INT_EQUALS(LOGGER_RING_DATA_SIZE - end, pad->size);
+	PCUT_ASSERT_INT_EQUALS(LOGGER_RECORD_PAD, pad->slot);
+
+	check_record(LOGGER_RING_DATA_SIZE, 2, LVL_ERROR, MESSAGE);
+	PCUT_ASSERT_INT_EQUALS(LOGGER_RING_DATA_SIZE + RECORD_SIZE,
+	    ring->head);
+
+	/* The space of the other consumed record is still free */
+	PCUT_ASSERT_TRUE(logger_ring_append(ring, 2, LVL_ERROR, MESSAGE,
+	    &kick));
+	PCUT_ASSERT_FALSE(logger_ring_append(ring, 2, LVL_ERROR, MESSAGE,
+	    &kick));
+}
+
+/** Messages that do not fit in the ring go to the logger via IPC
+ *
+ * The logger drains the ring before it handles such a message to keep
+ * the order of messages, so the ring is empty afterwards.
+ */
+PCUT_TEST(fallback)
+{
+	PCUT_ASSERT_ERRNO_VAL(EOK, log_init("test-libc-log"));
+
+	logger_ring_t *lring = log_ring_get();
+	PCUT_ASSERT_NOT_NULL(lring);
+
+	/*
+	 * Fill the ring with messages the logger drops and do not kick it,
+	 * so that it does not drain the ring behind our back.
+	 */
+	bool kick;
+	while (logger_ring_append(lring, 0, LVL_DEBUG2, "x", &kick))
+		;
+
+	PCUT_ASSERT_TRUE(lring->head != lring->tail);
+
+	/* Use a level the logger lets through, else it is not sent at all */
+	log_msg(LOG_DEFAULT, lring->level[0], "Log ring overflow test "
+	    "message, sent via IPC");
+
+	PCUT_ASSERT_INT_EQUALS(lring->head, lring->tail);
+	PCUT_ASSERT_INT_EQUALS(1, lring->waiting);
+}
+
+PCUT_EXPORT(log);
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pcut/pcut.h>
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(stdio);
+
+#define TEST_FILE  "/tmp/test-libc-stdio"
+
+/** Larger than any buffer stdio chooses for a regular file */
+#define DATA_SIZE  (256 * 1024)
+
+static uint8_t *data;
+static uint8_t *rbuf;
+
+static uint8_t pattern(size_t i)
+{
+	return (uint8_t) (i % 251);
+}
+
+/** Check that @a len bytes in rbuf match the pattern starting at @a pos */
+static bool check_data(size_t pos, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (rbuf[i] != pattern(pos + i))
+			return false;
+	}
+	
+	return true;
+}
+
+static void write_file(size_t size)
+{
+	FILE *f = fopen(TEST_FILE, "wb");
+	PCUT_ASSERT_NOT_NULL(f);
+	PCUT_ASSERT_INT_EQUALS(size, fwrite(data, 1, size, f));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+PCUT_TEST_BEFORE
+{
+	data = malloc(DATA_SIZE);
+	PCUT_ASSERT_NOT_NULL(data);
+	rbuf = malloc(DATA_SIZE);
+	PCUT_ASSERT_NOT_NULL(rbuf);
+	
+	for (size_t i = 0; i < DATA_SIZE; i++)
+		data[i] = pattern(i);
+}
+
+PCUT_TEST_AFTER
+{
+	remove(TEST_FILE);
+	free(data);
+	free(rbuf);
+}
+
+/** A large read bypassing the buffer returns the right data */
+PCUT_TEST(read_large)
+{
+	write_file(DATA_SIZE);
+	
+	FILE *f = fopen(TEST_FILE, "rb");
+	PCUT_ASSERT_NOT_NULL(f);
+	PCUT_ASSERT_INT_EQUALS(DATA_SIZE, fread(rbuf, 1, DATA_SIZE, f));
+	PCUT_ASSERT_TRUE(check_data(0, DATA_SIZE));
+	PCUT_ASSERT_INT_EQUALS(DATA_SIZE, ftell(f));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+/** Small buffered reads followed by a large direct read keep the order */
+PCUT_TEST(read_mixed)
+{
+	write_file(DATA_SIZE);
+	
+	FILE *f = fopen(TEST_FILE, "rb");
+	PCUT_ASSERT_NOT_NULL(f);
+	
+	PCUT_ASSERT_INT_EQUALS(10, fread(rbuf, 1, 10, f));
+	PCUT_ASSERT_TRUE(check_data(0, 10));
+	
+	PCUT_ASSERT_INT_EQUALS(pattern(10), fgetc(f));
+	
+	size_t rest = DATA_SIZE - 11;
+	PCUT_ASSERT_INT_EQUALS(rest, fread(rbuf, 1, rest, f));
+	PCUT_ASSERT_TRUE(check_data(11, rest));
+	PCUT_ASSERT_INT_EQUALS(DATA_SIZE, ftell(f));
+	
+	PCUT_ASSERT_INT_EQUALS(0, fread(rbuf, 1, 1, f));
+	PCUT_ASSERT_TRUE(feof(f));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+/** A direct read past the end of the file stops at the end */
+PCUT_TEST(read_large_eof)
+{
+	write_file(1000);
+	
+	FILE *f = fopen(TEST_FILE, "rb");
+	PCUT_ASSERT_NOT_NULL(f);
+	
+	/* Buffer smaller than the file, so that the read goes direct */
+	setvbuf(f, NULL, _IOFBF, 16);
+	
+	PCUT_ASSERT_INT_EQUALS(1000, fread(rbuf, 1, DATA_SIZE, f));
+	PCUT_ASSERT_TRUE(check_data(0, 1000));
+	PCUT_ASSERT_TRUE(feof(f));
+	PCUT_ASSERT_FALSE(ferror(f));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+/** Reading after a seek works with both buffered and direct reads */
+PCUT_TEST(read_seek)
+{
+	write_file(DATA_SIZE);
+	
+	FILE *f = fopen(TEST_FILE, "rb");
+	PCUT_ASSERT_NOT_NULL(f);
+	
+	PCUT_ASSERT_INT_EQUALS(100, fread(rbuf, 1, 100, f));
+	PCUT_ASSERT_INT_EQUALS(0, fseek(f, 5000, SEEK_SET));
+	
+	size_t len = DATA_SIZE - 5000;
+	PCUT_ASSERT_INT_EQUALS(len, fread(rbuf, 1, len, f));
+	PCUT_ASSERT_TRUE(check_data(5000, len));
+	
+	PCUT_ASSERT_INT_EQUALS(0, fseek(f, 3, SEEK_SET));
+	PCUT_ASSERT_INT_EQUALS(100, fread(rbuf, 1, 100, f));
+	PCUT_ASSERT_TRUE(check_data(3, 100));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+/** Buffered data are written out before a large direct write */
+PCUT_TEST(write_mixed)
+{
+	FILE *f = fopen(TEST_FILE, "wb");
+	PCUT_ASSERT_NOT_NULL(f);
+	
+	PCUT_ASSERT_INT_EQUALS(10, fwrite(data, 1, 10, f));
+	PCUT_ASSERT_INT_EQUALS(data[10], fputc(data[10], f));
+	PCUT_ASSERT_INT_EQUALS(DATA_SIZE - 11,
+	    fwrite(data + 11, 1, DATA_SIZE - 11, f));
+	
+	/* Small write after the direct one goes to the buffer again */
+	PCUT_ASSERT_INT_EQUALS(10, fwrite(data, 1, 10, f));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+	
+	f = fopen(TEST_FILE, "rb");
+	PCUT_ASSERT_NOT_NULL(f);
+	PCUT_ASSERT_INT_EQUALS(DATA_SIZE, fread(rbuf, 1, DATA_SIZE, f));
+	PCUT_ASSERT_TRUE(check_data(0, DATA_SIZE));
+	PCUT_ASSERT_INT_EQUALS(10, fread(rbuf, 1, DATA_SIZE, f));
+	PCUT_ASSERT_TRUE(check_data(0, 10));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+/** A stream with a caller-supplied buffer uses the direct paths too */
+PCUT_TEST(user_buffer)
+{
+	static char ubuf[64];
+	
+	FILE *f = fopen(TEST_FILE, "wb");
+	PCUT_ASSERT_NOT_NULL(f);
+	setvbuf(f, ubuf, _IOFBF, sizeof(ubuf));
+	
+	PCUT_ASSERT_INT_EQUALS(5, fwrite(data, 1, 5, f));
+	PCUT_ASSERT_INT_EQUALS(4091, fwrite(data + 5, 1, 4091, f));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+	
+	f = fopen(TEST_FILE, "rb");
+	PCUT_ASSERT_NOT_NULL(f);
+	setvbuf(f, ubuf, _IOFBF, sizeof(ubuf));
+	
+	PCUT_ASSERT_INT_EQUALS(7, fread(rbuf, 1, 7, f));
+	PCUT_ASSERT_TRUE(check_data(0, 7));
+	PCUT_ASSERT_INT_EQUALS(4089, fread(rbuf, 1, DATA_SIZE, f));
+	PCUT_ASSERT_TRUE(check_data(7, 4089));
+	PCUT_ASSERT_INT_EQUALS(0, fclose(f));
+}
+
+PCUT_EXPORT(stdio);
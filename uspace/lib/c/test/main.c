@@ -33,9 +33,11 @@ PCUT_INIT
 
 PCUT_IMPORT(circ_buf);
 PCUT_IMPORT(fibril_timer);
+PCUT_IMPORT(log);
 PCUT_IMPORT(odict);
 PCUT_IMPORT(qsort);
 PCUT_IMPORT(sprintf);
+PCUT_IMPORT(stdio);
 PCUT_IMPORT(str);
 PCUT_IMPORT(table);
 
@@ -35,10 +35,22 @@
 
 #include <assert.h>
 #include <adt/list.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <filter.h>
 
 #include "drawctx.h"
 
+/** Maximum number of pixels sampled and composed at once */
+#define TRANSFER_SPAN  256
+
+/** Convert a coordinate to span fixed point representation */
+static int64_t transfer_fixed(double val)
+{
+	val *= (1 << FILTER_SPAN_FRAC);
+	return (val >= 0) ? (int64_t) (val + 0.5) : -(int64_t) (0.5 - val);
+}
+
 void drawctx_init(drawctx_t *context, surface_t *surface)
 {
 	assert(surface);
@@ -121,6 +133,155 @@ void drawctx_set_font(drawctx_t *context, font_t *font)
 	context->font = font;
 }
 
+/** Transfer a horizontal run of pixels one by one.
+ *
+ * Used by the span renderer for pixels whose samples fall outside of
+ * the source texture, where the extend mode has to be applied.
+ */
+static void drawctx_transfer_pixels(drawctx_t *context,
+    sysarg_t x, sysarg_t y, sysarg_t count)
+{
+	pixel_t *dst = pixelmap_pixel_at(
+	    surface_pixmap_access(context->surface), x, y);
+
+	for (sysarg_t i = 0; i < count; i++) {
+		pixel_t p_src = source_determine_pixel(context->source, x + i, y);
+		dst[i] = context->compose(p_src, dst[i]);
+	}
+}
+
+/** Transfer a rectangle using span kernels.
+ *
+ * Handles textured sources with an axis-aligned transformation (i.e.
+ * integer translation or scaling), the nearest and bilinear filters and
+ * the SRC and OVER composition operators. Each row is sampled into a
+ * span in fixed point arithmetic and composed at once; only the pixels
+ * whose samples lie outside of the texture go through the generic
+ * per-pixel path.
+ *
+ * @return @c false if the transfer cannot be done by span kernels
+ */
+static bool drawctx_transfer_spans(drawctx_t *context,
+    sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
+{
+	source_t *source = context->source;
+	transform_t *trans = &source->transform;
+
+	if (context->mask != NULL || context->shall_clip ||
+	    source->mask != NULL || source->texture == NULL ||
+	    ALPHA(source->alpha) == 0)
+		return false;
+
+	if (trans->matrix[0][1] != 0 || trans->matrix[1][0] != 0 ||
+	    trans->matrix[0][0] <= 0 || trans->matrix[1][1] <= 0)
+		return false;
+
+	compose_span_t compose = compose_span_get(context->compose);
+	filter_span_t sample = filter_span_get(source->filter);
+	if (compose == NULL || sample == NULL)
+		return false;
+
+	int64_t step = transfer_fixed(trans->matrix[0][0]);
+	if (step <= 0)
+		return false;
+
+	/* Clip to the destination surface */
+	sysarg_t dst_width, dst_height;
+	surface_get_resolution(context->surface, &dst_width, &dst_height);
+	if (x >= dst_width || y >= dst_height)
+		return true;
+	if (width > dst_width - x)
+		width = dst_width - x;
+	if (height > dst_height - y)
+		height = dst_height - y;
+	if (width == 0 || height == 0)
+		return true;
+
+	pixelmap_t *dst_map = surface_pixmap_access(context->surface);
+	pixelmap_t *src_map = surface_pixmap_access(source->texture);
+
+	int64_t x_lo, x_hi, y_lo, y_hi;
+	filter_span_bounds(source->filter, src_map->width, &x_lo, &x_hi);
+	filter_span_bounds(source->filter, src_map->height, &y_lo, &y_hi);
+
+	unsigned alpha = ALPHA(source->alpha);
+	bool direct = (sample == filter_span_nearest) &&
+	    (step == (1 << FILTER_SPAN_FRAC)) && (alpha == 255);
+
+	int64_t fx0 = transfer_fixed(trans->matrix[0][0] * x +
+	    trans->matrix[0][2]);
+
+	/* Range of pixels in each row which sample inside the texture */
+	sysarg_t first;
+	sysarg_t last;
+
+	if (fx0 > x_hi) {
+		first = width;
+		last = width;
+	} else {
+		first = (fx0 >= x_lo) ? 0 :
+		    (sysarg_t) ((x_lo - fx0 + step - 1) / step);
+		int64_t end = (x_hi - fx0) / step + 1;
+		last = (end < (int64_t) width) ? (sysarg_t) end : width;
+		if (first > last)
+			first = last;
+	}
+
+	pixel_t buf[TRANSFER_SPAN];
+
+	for (sysarg_t _y = y; _y < y + height; ++_y) {
+		int64_t fy = transfer_fixed(trans->matrix[1][1] * _y +
+		    trans->matrix[1][2]);
+
+		if (fy < y_lo || fy > y_hi || first == last) {
+			drawctx_transfer_pixels(context, x, _y, width);
+			continue;
+		}
+
+		drawctx_transfer_pixels(context, x, _y, first);
+		drawctx_transfer_pixels(context, x + last, _y, width - last);
+
+		pixel_t *dst = pixelmap_pixel_at(dst_map, x, _y);
+
+		if (direct) {
+			/* Integer translation, compose straight from texture */
+			int64_t sy = (fy + (1 << (FILTER_SPAN_FRAC - 1))) >>
+			    FILTER_SPAN_FRAC;
+			int64_t sx = (fx0 + (1 << (FILTER_SPAN_FRAC - 1))) >>
+			    FILTER_SPAN_FRAC;
+
+			if ((fx0 & ((1 << FILTER_SPAN_FRAC) - 1)) == 0) {
+				compose(dst + first, src_map->data +
+				    sy * src_map->width + sx + first,
+				    last - first);
+				continue;
+			}
+		}
+
+		for (sysarg_t i = first; i < last; i += TRANSFER_SPAN) {
+			size_t count = last - i;
+			if (count > TRANSFER_SPAN)
+				count = TRANSFER_SPAN;
+
+			sample(src_map, fx0 + (int64_t) i * step, fy, step,
+			    buf, count);
+
+			if (alpha < 255) {
+				for (size_t j = 0; j < count; j++) {
+					buf[j] = PIXEL(ALPHA(buf[j]) * alpha / 255,
+					    RED(buf[j]), GREEN(buf[j]),
+					    BLUE(buf[j]));
+				}
+			}
+
+			compose(dst + i, buf, count);
+		}
+	}
+
+	surface_add_damaged_region(context->surface, x, y, width, height);
+	return true;
+}
+
 void drawctx_transfer(drawctx_t *context,
     sysarg_t x, sysarg_t y, sysarg_t width, sysarg_t height)
 {
@@ -147,7 +308,7 @@ void drawctx_transfer(drawctx_t *context,
 		}
 		surface_add_damaged_region(context->surface, x, y, width, height);
 
-	} else {
+	} else if (!drawctx_transfer_spans(context, x, y, width, height)) {
 
 		bool clipped = false;
 		bool masked = false;
@@ -43,9 +43,35 @@
 typedef enum {
 	NIC_EV_ADDR_CHANGED = IPC_FIRST_USER_METHOD,
 	NIC_EV_RECEIVED,
-	NIC_EV_DEVICE_STATE
+	NIC_EV_DEVICE_STATE,
+	NIC_EV_RX_POOL,
+	NIC_EV_RECEIVED_BATCH
 } nic_event_t;
 
+/** Number of frame slots in the shared receive pool */
+#define NIC_RX_POOL_SLOTS  64
+
+/** Size of a single frame slot in the shared receive pool */
+#define NIC_RX_POOL_SLOT_SIZE  2048
+
+/** Receive pool descriptor */
+typedef struct {
+	/** Size of the frame stored in the corresponding slot */
+	uint32_t size;
+} nic_rx_desc_t;
+
+/** Receive pool shared between the NIC driver and its client
+ *
+ * The driver fills slots 0 .. n - 1 and their descriptors and then
+ * posts a single NIC_EV_RECEIVED_BATCH event with n as the argument.
+ * The client parses the frames in place and the slots are owned
+ * by the driver again once the event is answered.
+ */
+typedef struct {
+	nic_rx_desc_t desc[NIC_RX_POOL_SLOTS];
+	uint8_t slot[NIC_RX_POOL_SLOTS][NIC_RX_POOL_SLOT_SIZE];
+} nic_rx_pool_t;
+
 extern errno_t nic_send_frame(async_sess_t *, void *, size_t);
 extern errno_t nic_callback_create(async_sess_t *, async_port_handler_t, void *);
 extern errno_t nic_get_state(async_sess_t *, nic_device_state_t *);
@@ -1173,6 +1173,135 @@ skip:
 	}
 }
 
+/** Translate an on-disk directory entry type to VFS_DT_*.
+ *
+ * @param type EXT4_DIRECTORY_FILETYPE_* value
+ *
+ * @return VFS_DT_* value
+ *
+ */
+static int ext4_dirent_type(uint8_t type)
+{
+	switch (type) {
+	case EXT4_DIRECTORY_FILETYPE_REG_FILE:
+		return VFS_DT_FILE;
+	case EXT4_DIRECTORY_FILETYPE_DIR:
+		return VFS_DT_DIR;
+	default:
+		return VFS_DT_UNKNOWN;
+	}
+}
+
+/** Read a batch of directory entries.
+ *
+ * The entry type comes from the directory entry itself when the file system
+ * records it. The referenced i-node is only loaded if the client asked for
+ * attributes or the type is not known otherwise.
+ *
+ * @param service_id Device to read data from
+ * @param index      Number of the directory node
+ * @param pos        Position where the read should be started
+ * @param db         Buffer to fill with directory entries
+ * @param npos       Output value, position to resume reading at
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_readdir(service_id_t service_id, fs_index_t index,
+    aoff64_t pos, libfs_dirbuf_t *db, aoff64_t *npos)
+{
+	ext4_instance_t *inst;
+	errno_t rc = ext4_instance_get(service_id, &inst);
+	if (rc != EOK)
+		return rc;
+	
+	ext4_superblock_t *sb = inst->filesystem->superblock;
+	
+	ext4_inode_ref_t *inode_ref;
+	rc = ext4_filesystem_get_inode_ref(inst->filesystem, index, &inode_ref);
+	if (rc != EOK)
+		return rc;
+	
+	if (!ext4_inode_is_type(sb, inode_ref->inode,
+	    EXT4_INODE_MODE_DIRECTORY)) {
+		ext4_filesystem_put_inode_ref(inode_ref);
+		return ENOTDIR;
+	}
+	
+	ext4_directory_iterator_t it;
+	rc = ext4_directory_iterator_init(&it, inode_ref, pos);
+	if (rc != EOK) {
+		ext4_filesystem_put_inode_ref(inode_ref);
+		return rc;
+	}
+	
+	*npos = it.current_offset;
+	
+	char name[EXT4_DIRECTORY_FILENAME_LEN + 1];
+	while (it.current != NULL) {
+		uint32_t child = ext4_directory_entry_ll_get_inode(it.current);
+		uint16_t name_size = ext4_directory_entry_ll_get_name_length(sb,
+		    it.current);
+		
+		/* Skip unused entries as well as . and .. */
+		if ((child != 0) && !ext4_is_dots(it.current->name, name_size)) {
+			int type = ext4_dirent_type(
+			    ext4_directory_entry_ll_get_inode_type(sb, it.current));
+			uint64_t size = 0;
+			
+			if ((type == VFS_DT_UNKNOWN) ||
+			    ((db->flags & VFS_READDIR_ATTRS) != 0)) {
+				ext4_inode_ref_t *child_ref;
+				rc = ext4_filesystem_get_inode_ref(inst->filesystem,
+				    child, &child_ref);
+				if (rc != EOK)
+					break;
+				
+				if (ext4_inode_is_type(sb, child_ref->inode,
+				    EXT4_INODE_MODE_DIRECTORY))
+					type = VFS_DT_DIR;
+				else if (ext4_inode_is_type(sb, child_ref->inode,
+				    EXT4_INODE_MODE_FILE))
+					type = VFS_DT_FILE;
+				size = ext4_inode_get_size(sb, child_ref->inode);
+				
+				rc = ext4_filesystem_put_inode_ref(child_ref);
+				if (rc != EOK)
+					break;
+			}
+			
+			memcpy(name, &it.current->name, name_size);
+			name[name_size] = '\0';
+			
+			rc = libfs_dirbuf_add(db, name, type, child, size,
+			    it.current_offset +
+			    ext4_directory_entry_ll_get_entry_length(it.current));
+			if (rc != EOK)
+				break;
+		}
+		
+		rc = ext4_directory_iterator_next(&it);
+		if (rc != EOK)
+			break;
+		
+		*npos = it.current_offset;
+	}
+	
+	/*
+	 * Running out of buffer space just ends the batch, unless not even
+	 * a single entry fitted.
+	 */
+	if ((rc == ELIMIT) && (db->used > 0))
+		rc = EOK;
+	
+	errno_t rc2 = ext4_directory_iterator_fini(&it);
+	if (rc == EOK)
+		rc = rc2;
+	
+	rc2 = ext4_filesystem_put_inode_ref(inode_ref);
+	return rc == EOK ? rc2 : rc;
+}
+
 /** Read data from file.
  *
  * @param callid    IPC id of call (for communication)
@@ -1487,6 +1616,7 @@ vfs_out_ops_t ext4_ops = {
 	.mounted = ext4_mounted,
 	.unmounted = ext4_unmounted,
 	.read = ext4_read,
+	.readdir = ext4_readdir,
 	.write = ext4_write,
 	.truncate = ext4_truncate,
 	.close = ext4_close,
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libfs
+ * @{
+ */
+/**
+ * @file
+ * Extent map of a cluster chain.
+ *
+ * File systems which keep the allocation of a file in a linked list of
+ * clusters, such as FAT, can only find the cluster holding a given offset by
+ * walking the list. The extent map remembers the walked part of the chain as
+ * runs of contiguous clusters so that later lookups are a binary search.
+ */
+
+#include "extmap.h"
+#include <stdlib.h>
+
+/** Initialize an empty extent map.
+ *
+ * @param map	Extent map.
+ */
+void fs_extmap_init(fs_extmap_t *map)
+{
+	map->extents = NULL;
+	map->count = 0;
+	map->capacity = 0;
+}
+
+/** Free all extents of an extent map.
+ *
+ * The map is left empty and can be reused.
+ *
+ * @param map	Extent map.
+ */
+void fs_extmap_fini(fs_extmap_t *map)
+{
+	free(map->extents);
+	fs_extmap_init(map);
+}
+
+/** Get the number of logical clusters described by an extent map.
+ *
+ * @param map	Extent map.
+ *
+ * @return	Number of clusters from the start of the file that are mapped.
+ */
+uint32_t fs_extmap_mapped(fs_extmap_t *map)
+{
+	fs_extent_t *last;
+
+	if (map->count == 0)
+		return 0;
+
+	last = &map->extents[map->count - 1];
+	return last->lcl + last->count;
+}
+
+/** Translate a logical cluster to a physical cluster.
+ *
+ * @param map	Extent map.
+ * @param lcl	Logical cluster number within the file.
+ * @param pcl	Place to store the physical cluster number.
+ *
+ * @return	True if the cluster is mapped, false otherwise.
+ */
+bool fs_extmap_lookup(fs_extmap_t *map, uint32_t lcl, uint32_t *pcl)
+{
+	size_t lo = 0;
+	size_t hi = map->count;
+
+	if (lcl >= fs_extmap_mapped(map))
+		return false;
+
+	/* Find the last extent starting at or before lcl. */
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (map->extents[mid].lcl <= lcl)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	*pcl = map->extents[lo].pcl + (lcl - map->extents[lo].lcl);
+	return true;
+}
+
+/** Map the next logical cluster of a file.
+ *
+ * The cluster following the mapped prefix is mapped to @a pcl. If it
+ * continues the last extent, the extent is simply extended.
+ *
+ * @param map	Extent map.
+ * @param pcl	Physical cluster number.
+ *
+ * @return	EOK on success, ELIMIT if the map has reached its maximum
+ *		size or ENOMEM if out of memory.
+ */
+errno_t fs_extmap_append(fs_extmap_t *map, uint32_t pcl)
+{
+	fs_extent_t *last = NULL;
+	uint32_t lcl = fs_extmap_mapped(map);
+
+	if (map->count > 0) {
+		last = &map->extents[map->count - 1];
+		if (last->pcl + last->count == pcl) {
+			last->count++;
+			return EOK;
+		}
+	}
+
+	if (map->count == FS_EXTMAP_MAX)
+		return ELIMIT;
+
+	if (map->count == map->capacity) {
+		size_t ncap = map->capacity ? 2 * map->capacity : 4;
+		fs_extent_t *nextents;
+
+		nextents = realloc(map->extents, ncap * sizeof(fs_extent_t));
+		if (nextents == NULL)
+			return ENOMEM;
+
+		map->extents = nextents;
+		map->capacity = ncap;
+	}
+
+	map->extents[map->count].lcl = lcl;
+	map->extents[map->count].pcl = pcl;
+	map->extents[map->count].count = 1;
+	map->count++;
+
+	return EOK;
+}
+
+/** Forget the mapping of logical clusters past a given length.
+ *
+ * @param map	Extent map.
+ * @param ncl	Number of clusters which remain mapped.
+ */
+void fs_extmap_truncate(fs_extmap_t *map, uint32_t ncl)
+{
+	while (map->count > 0) {
+		fs_extent_t *last = &map->extents[map->count - 1];
+
+		if (last->lcl >= ncl) {
+			map->count--;
+			continue;
+		}
+
+		if (last->lcl + last->count > ncl)
+			last->count = ncl - last->lcl;
+		break;
+	}
+
+	if (map->count == 0)
+		fs_extmap_fini(map);
+}
+
+/** @}
+ */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup libfs
+ * @{
+ */
+/**
+ * @file
+ * Extent map of a cluster chain.
+ */
+
+#ifndef LIBFS_EXTMAP_H_
+#define LIBFS_EXTMAP_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum number of extents kept for one file. */
+#define FS_EXTMAP_MAX	1024
+
+/** Run of physically contiguous clusters. */
+typedef struct {
+	/** First logical cluster of the run. */
+	uint32_t lcl;
+	/** First physical cluster of the run. */
+	uint32_t pcl;
+	/** Number of clusters in the run. */
+	uint32_t count;
+} fs_extent_t;
+
+/** Map of logical clusters of a file to physical clusters.
+ *
+ * The map always describes a prefix of the file's cluster chain, i.e. the
+ * extents are sorted by their logical cluster, adjacent and start at logical
+ * cluster zero. It is filled lazily while the chain is walked.
+ */
+typedef struct {
+	fs_extent_t *extents;
+	size_t count;
+	size_t capacity;
+} fs_extmap_t;
+
+extern void fs_extmap_init(fs_extmap_t *);
+extern void fs_extmap_fini(fs_extmap_t *);
+extern uint32_t fs_extmap_mapped(fs_extmap_t *);
+extern bool fs_extmap_lookup(fs_extmap_t *, uint32_t, uint32_t *);
+extern errno_t fs_extmap_append(fs_extmap_t *, uint32_t);
+extern void fs_extmap_truncate(fs_extmap_t *, uint32_t);
+
+#endif
+
+/** @}
+ */
@@ -169,6 +169,59 @@ static void vfs_out_read(ipc_callid_t rid, ipc_call_t *req)
 		async_answer_0(rid, rc);
 }
 
+static void vfs_out_readdir(ipc_callid_t rid, ipc_call_t *req)
+{
+	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
+	fs_index_t index = (fs_index_t) IPC_GET_ARG2(*req);
+	aoff64_t pos = (aoff64_t) MERGE_LOUP32(IPC_GET_ARG3(*req),
+	    IPC_GET_ARG4(*req));
+	unsigned flags = (unsigned) IPC_GET_ARG5(*req);
+	libfs_dirbuf_t db;
+	ipc_callid_t callid;
+	aoff64_t npos;
+	size_t size;
+	errno_t rc;
+
+	if (!async_data_read_receive(&callid, &size)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+
+	if (vfs_out_ops->readdir == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		async_answer_0(rid, ENOTSUP);
+		return;
+	}
+
+	db.buf = malloc(size);
+	if (db.buf == NULL) {
+		async_answer_0(callid, ENOMEM);
+		async_answer_0(rid, ENOMEM);
+		return;
+	}
+	db.size = size;
+	db.used = 0;
+	db.flags = flags;
+
+	npos = pos;
+	rc = vfs_out_ops->readdir(service_id, index, pos, &db, &npos);
+	if (rc != EOK) {
+		free(db.buf);
+		async_answer_0(callid, rc);
+		async_answer_0(rid, rc);
+		return;
+	}
+
+	rc = async_data_read_finalize(callid, db.buf, db.used);
+	free(db.buf);
+
+	if (rc == EOK)
+		async_answer_3(rid, EOK, db.used, LOWER32(npos), UPPER32(npos));
+	else
+		async_answer_0(rid, rc);
+}
+
 static void vfs_out_write(ipc_callid_t rid, ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
@@ -314,6 +367,9 @@ static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case VFS_OUT_READ:
 			vfs_out_read(callid, &call);
 			break;
+		case VFS_OUT_READDIR:
+			vfs_out_readdir(callid, &call);
+			break;
 		case VFS_OUT_WRITE:
 			vfs_out_write(callid, &call);
 			break;
@@ -440,6 +496,44 @@ void fs_node_initialize(fs_node_t *fn)
 	memset(fn, 0, sizeof(fs_node_t));
 }
 
+/** Append a directory entry to a VFS_OUT_READDIR buffer.
+ *
+ * The index and size are only stored if the client asked for them with
+ * VFS_READDIR_ATTRS.
+ *
+ * @param db		Directory entry buffer.
+ * @param name		Name of the entry.
+ * @param type		VFS_DT_* type of the entry.
+ * @param index		Index of the node the entry refers to.
+ * @param size		Size of the node the entry refers to.
+ * @param next_pos	Position of the entry following this one.
+ *
+ * @return		EOK on success, ELIMIT if the entry does not fit.
+ */
+errno_t libfs_dirbuf_add(libfs_dirbuf_t *db, const char *name, int type,
+    fs_index_t index, aoff64_t size, aoff64_t next_pos)
+{
+	size_t nlen = str_size(name);
+	size_t reclen = VFS_DIRENT_SIZE(nlen);
+
+	if (reclen > db->size - db->used)
+		return ELIMIT;
+
+	vfs_dirent_t *de = (vfs_dirent_t *) (db->buf + db->used);
+	memset(de, 0, reclen);
+	de->reclen = reclen;
+	de->type = type;
+	if ((db->flags & VFS_READDIR_ATTRS) != 0) {
+		de->index = index;
+		de->size = size;
+	}
+	de->next_pos = next_pos;
+	memcpy(de->name, name, nlen + 1);
+
+	db->used += reclen;
+	return EOK;
+}
+
 static char plb_get_char(unsigned pos)
 {
 	return reg.plb_ro[pos % PLB_SIZE];
@@ -750,6 +844,9 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
 	stat.is_directory = ops->is_directory(fn);
 	stat.size = ops->size_get(fn);
 	stat.service = ops->service_get(fn);
+	if (ops->size_block != NULL &&
+	    ops->size_block(service_id, &stat.blksize) != EOK)
+		stat.blksize = 0;
 
 	ops->node_put(fn);
 
@@ -41,6 +41,14 @@
 #include <async.h>
 #include <loc.h>
 
+/** Buffer collecting directory entries for VFS_OUT_READDIR. */
+typedef struct {
+	uint8_t *buf;       /**< Start of the buffer. */
+	size_t size;        /**< Size of the buffer. */
+	size_t used;        /**< Number of bytes filled in so far. */
+	unsigned flags;     /**< VFS_READDIR_* flags requested by the client. */
+} libfs_dirbuf_t;
+
 typedef struct {
 	errno_t (* fsprobe)(service_id_t, vfs_fs_probe_info_t *);
 	errno_t (* mounted)(service_id_t, const char *, fs_index_t *, aoff64_t *);
@@ -52,6 +60,13 @@ typedef struct {
 	errno_t (* close)(service_id_t, fs_index_t);
 	errno_t (* destroy)(service_id_t, fs_index_t);
 	errno_t (* sync)(service_id_t, fs_index_t);
+	/*
+	 * Optional. Fill the buffer with as many entries as fit, starting at
+	 * the given position, and return the position of the first entry that
+	 * did not fit.
+	 */
+	errno_t (* readdir)(service_id_t, fs_index_t, aoff64_t, libfs_dirbuf_t *,
+	    aoff64_t *);
 } vfs_out_ops_t;
 
 typedef struct {
@@ -99,6 +114,9 @@ extern errno_t fs_register(async_sess_t *, vfs_info_t *, vfs_out_ops_t *,
 
 extern void fs_node_initialize(fs_node_t *);
 
+extern errno_t libfs_dirbuf_add(libfs_dirbuf_t *, const char *, int,
+    fs_index_t, aoff64_t, aoff64_t);
+
 extern errno_t fs_instance_create(service_id_t, void *);
 extern errno_t fs_instance_get(service_id_t, void **);
 extern errno_t fs_instance_destroy(service_id_t);
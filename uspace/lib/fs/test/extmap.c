@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <pcut/pcut.h>
+
+#include "../extmap.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(extmap);
+
+/** Check that logical cluster @a lcl maps to physical cluster @a pcl */
+static void test_lookup(fs_extmap_t *map, uint32_t lcl, uint32_t pcl)
+{
+	uint32_t found;
+
+	PCUT_ASSERT_TRUE(fs_extmap_lookup(map, lcl, &found));
+	PCUT_ASSERT_INT_EQUALS(pcl, found);
+}
+
+/** Map a chain of @a count clusters starting at @a pcl */
+static void test_append_run(fs_extmap_t *map, uint32_t pcl, uint32_t count)
+{
+	while (count-- > 0)
+		PCUT_ASSERT_ERRNO_VAL(EOK, fs_extmap_append(map, pcl++));
+}
+
+/** Empty map has nothing mapped */
+PCUT_TEST(empty)
+{
+	fs_extmap_t map;
+	uint32_t pcl;
+
+	fs_extmap_init(&map);
+	PCUT_ASSERT_INT_EQUALS(0, fs_extmap_mapped(&map));
+	PCUT_ASSERT_FALSE(fs_extmap_lookup(&map, 0, &pcl));
+
+	fs_extmap_truncate(&map, 10);
+	PCUT_ASSERT_INT_EQUALS(0, fs_extmap_mapped(&map));
+	fs_extmap_fini(&map);
+}
+
+/** Contiguous clusters are merged into one extent */
+PCUT_TEST(contiguous)
+{
+	fs_extmap_t map;
+	uint32_t pcl;
+
+	fs_extmap_init(&map);
+	test_append_run(&map, 100, 50);
+
+	PCUT_ASSERT_INT_EQUALS(1, map.count);
+	PCUT_ASSERT_INT_EQUALS(50, fs_extmap_mapped(&map));
+	test_lookup(&map, 0, 100);
+	test_lookup(&map, 49, 149);
+	PCUT_ASSERT_FALSE(fs_extmap_lookup(&map, 50, &pcl));
+
+	fs_extmap_fini(&map);
+	PCUT_ASSERT_INT_EQUALS(0, fs_extmap_mapped(&map));
+}
+
+/** Lookup in a fragmented chain */
+PCUT_TEST(fragmented)
+{
+	fs_extmap_t map;
+	uint32_t pcl;
+
+	fs_extmap_init(&map);
+	test_append_run(&map, 100, 3);	/* 0..2 */
+	test_append_run(&map, 50, 1);	/* 3 */
+	test_append_run(&map, 200, 4);	/* 4..7 */
+	test_append_run(&map, 99, 2);	/* 8..9 */
+
+	PCUT_ASSERT_INT_EQUALS(4, map.count);
+	PCUT_ASSERT_INT_EQUALS(10, fs_extmap_mapped(&map));
+
+	test_lookup(&map, 0, 100);
+	test_lookup(&map, 2, 102);
+	test_lookup(&map, 3, 50);
+	test_lookup(&map, 4, 200);
+	test_lookup(&map, 7, 203);
+	test_lookup(&map, 8, 99);
+	test_lookup(&map, 9, 100);
+	PCUT_ASSERT_FALSE(fs_extmap_lookup(&map, 10, &pcl));
+
+	fs_extmap_fini(&map);
+}
+
+/** Truncation inside an extent, at an extent boundary and to zero */
+PCUT_TEST(truncate)
+{
+	fs_extmap_t map;
+	uint32_t pcl;
+
+	fs_extmap_init(&map);
+	test_append_run(&map, 100, 3);	/* 0..2 */
+	test_append_run(&map, 50, 2);	/* 3..4 */
+	test_append_run(&map, 200, 4);	/* 5..8 */
+
+	/* Past the end */
+	fs_extmap_truncate(&map, 20);
+	PCUT_ASSERT_INT_EQUALS(9, fs_extmap_mapped(&map));
+
+	/* Inside the last extent */
+	fs_extmap_truncate(&map, 7);
+	PCUT_ASSERT_INT_EQUALS(3, map.count);
+	PCUT_ASSERT_INT_EQUALS(7, fs_extmap_mapped(&map));
+	test_lookup(&map, 6, 201);
+	PCUT_ASSERT_FALSE(fs_extmap_lookup(&map, 7, &pcl));
+
+	/* At an extent boundary */
+	fs_extmap_truncate(&map, 3);
+	PCUT_ASSERT_INT_EQUALS(1, map.count);
+	PCUT_ASSERT_INT_EQUALS(3, fs_extmap_mapped(&map));
+	test_lookup(&map, 2, 102);
+	PCUT_ASSERT_FALSE(fs_extmap_lookup(&map, 3, &pcl));
+
+	/* The chain can grow again after truncation */
+	test_append_run(&map, 103, 2);
+	PCUT_ASSERT_INT_EQUALS(1, map.count);
+	test_lookup(&map, 4, 104);
+
+	fs_extmap_truncate(&map, 0);
+	PCUT_ASSERT_INT_EQUALS(0, fs_extmap_mapped(&map));
+	PCUT_ASSERT_NULL(map.extents);
+	PCUT_ASSERT_FALSE(fs_extmap_lookup(&map, 0, &pcl));
+
+	fs_extmap_fini(&map);
+}
+
+/** The number of extents is limited */
+PCUT_TEST(limit)
+{
+	fs_extmap_t map;
+	uint32_t i;
+
+	fs_extmap_init(&map);
+
+	/* Every other cluster, so that each one is a separate extent */
+	for (i = 0; i < FS_EXTMAP_MAX; i++)
+		PCUT_ASSERT_ERRNO_VAL(EOK, fs_extmap_append(&map, 2 * i));
+
+	PCUT_ASSERT_INT_EQUALS(FS_EXTMAP_MAX, map.count);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, fs_extmap_append(&map, 2 * i));
+
+	/* Extending the last extent is still possible */
+	PCUT_ASSERT_ERRNO_VAL(EOK, fs_extmap_append(&map, 2 * (i - 1) + 1));
+	PCUT_ASSERT_INT_EQUALS(FS_EXTMAP_MAX + 1, fs_extmap_mapped(&map));
+
+	for (i = 0; i < FS_EXTMAP_MAX; i++)
+		test_lookup(&map, i, 2 * i);
+	test_lookup(&map, FS_EXTMAP_MAX, 2 * FS_EXTMAP_MAX - 1);
+
+	fs_extmap_fini(&map);
+}
+
+PCUT_EXPORT(extmap);
@@ -243,6 +243,9 @@ extern errno_t nic_report_poll_mode(nic_t *, nic_poll_mode_t, struct timeval *);
 extern void nic_query_address(nic_t *, nic_address_t *);
 extern void nic_received_frame(nic_t *, nic_frame_t *);
 extern void nic_received_frame_list(nic_t *, nic_frame_list_t *);
+extern void nic_rx_batch_begin(nic_t *);
+extern void nic_rx_batch_add(nic_t *, const void *, size_t);
+extern void nic_rx_batch_end(nic_t *);
 extern nic_poll_mode_t nic_query_poll_mode(nic_t *, struct timeval *);
 
 /* Statistics updates */
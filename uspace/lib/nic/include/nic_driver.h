@@ -45,11 +45,22 @@
 #include <fibril_synch.h>
 #include <nic/nic.h>
 #include <async.h>
+#include <nic_iface.h>
 
 #include "nic.h"
 #include "nic_rx_control.h"
 #include "nic_wol_virtues.h"
 
+/** State of the shared receive pool with respect to the current client */
+typedef enum {
+	/** The pool has not been offered to the client yet */
+	NIC_RX_POOL_UNKNOWN,
+	/** The client mapped the pool, frames are delivered in batches */
+	NIC_RX_POOL_ACTIVE,
+	/** The client does not support batches, frames are sent one by one */
+	NIC_RX_POOL_UNSUPPORTED
+} nic_rx_pool_state_t;
+
 struct sw_poll_info {
 	fid_t fibril;
 	volatile int run;
@@ -79,6 +90,19 @@ struct nic {
 	nic_address_t default_mac;
 	/** Client callback session */
 	async_sess_t *client_session;
+	/** Receive pool shared with the client (NULL if not created yet) */
+	nic_rx_pool_t *rx_pool;
+	/** Negotiation state of the receive pool */
+	nic_rx_pool_state_t rx_pool_state;
+	/** Number of frames stored in the receive pool and not yet posted */
+	size_t rx_pool_count;
+	/** Receive statistics of the frames processed in the current batch */
+	nic_device_stats_t rx_pool_stats;
+	/**
+	 * Lock serializing batched reception. Held between nic_rx_batch_begin
+	 * and nic_rx_batch_end, protects the rx_pool_* members.
+	 */
+	fibril_mutex_t rx_pool_lock;
 	/** Current polling mode of the NIC */
 	nic_poll_mode_t poll_mode;
 	/** Polling period (applicable when poll_mode == NIC_POLL_PERIODIC) */
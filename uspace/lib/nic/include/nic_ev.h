@@ -40,11 +40,14 @@
 
 #include <async.h>
 #include <nic/nic.h>
+#include <nic_iface.h>
 #include <stddef.h>
 
 extern errno_t nic_ev_addr_changed(async_sess_t *, const nic_address_t *);
 extern errno_t nic_ev_device_state(async_sess_t *, sysarg_t);
 extern errno_t nic_ev_received(async_sess_t *, void *, size_t);
+extern errno_t nic_ev_rx_pool(async_sess_t *, nic_rx_pool_t *);
+extern errno_t nic_ev_received_batch(async_sess_t *, size_t);
 
 #endif
 
@@ -506,6 +506,49 @@ void nic_set_tx_busy(nic_t *nic_data, int busy)
 	nic_data->tx_busy = busy;
 }
 
+/** Account a received frame in the statistics.
+ *
+ * @param nic_data
+ * @param stats		Statistics to update
+ * @param check		Result of the receive filter check
+ * @param frame_type	Type of the frame determined by the filter
+ * @param size		Size of the frame
+ *
+ * @return True if the frame should be passed to the client
+ */
+static bool nic_rx_account(nic_t *nic_data, nic_device_stats_t *stats,
+    bool check, nic_frame_type_t frame_type, size_t size)
+{
+	if (nic_data->state == NIC_STATE_ACTIVE && check) {
+		stats->receive_packets++;
+		stats->receive_bytes += size;
+		switch (frame_type) {
+		case NIC_FRAME_MULTICAST:
+			stats->receive_multicast++;
+			break;
+		case NIC_FRAME_BROADCAST:
+			stats->receive_broadcast++;
+			break;
+		default:
+			break;
+		}
+		return true;
+	}
+
+	switch (frame_type) {
+	case NIC_FRAME_UNICAST:
+		stats->receive_filtered_unicast++;
+		break;
+	case NIC_FRAME_MULTICAST:
+		stats->receive_filtered_multicast++;
+		break;
+	case NIC_FRAME_BROADCAST:
+		stats->receive_filtered_broadcast++;
+		break;
+	}
+	return false;
+}
+
 /**
  * This is the function that the driver should call when it receives a frame.
  * The frame is checked by filters and then sent up to the NIL layer or
@@ -525,36 +568,13 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 	fibril_rwlock_read_unlock(&nic_data->rxc_lock);
 	/* Update statistics */
 	fibril_rwlock_write_lock(&nic_data->stats_lock);
+	bool accept = nic_rx_account(nic_data, &nic_data->stats, check,
+	    frame_type, frame->size);
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
 
-	if (nic_data->state == NIC_STATE_ACTIVE && check) {
-		nic_data->stats.receive_packets++;
-		nic_data->stats.receive_bytes += frame->size;
-		switch (frame_type) {
-		case NIC_FRAME_MULTICAST:
-			nic_data->stats.receive_multicast++;
-			break;
-		case NIC_FRAME_BROADCAST:
-			nic_data->stats.receive_broadcast++;
-			break;
-		default:
-			break;
-		}
-		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+	if (accept) {
 		nic_ev_received(nic_data->client_session, frame->data,
 		    frame->size);
-	} else {
-		switch (frame_type) {
-		case NIC_FRAME_UNICAST:
-			nic_data->stats.receive_filtered_unicast++;
-			break;
-		case NIC_FRAME_MULTICAST:
-			nic_data->stats.receive_filtered_multicast++;
-			break;
-		case NIC_FRAME_BROADCAST:
-			nic_data->stats.receive_filtered_broadcast++;
-			break;
-		}
-		fibril_rwlock_write_unlock(&nic_data->stats_lock);
 	}
 	nic_release_frame(nic_data, frame);
 }
@@ -582,6 +602,139 @@ void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 	nic_driver_release_frame_list(frames);
 }
 
+/** Offer the shared receive pool to the current client.
+ *
+ * Called with rx_pool_lock held. If the pool cannot be created or the
+ * client does not support batched reception, frames are delivered one
+ * by one with nic_ev_received until the client changes.
+ *
+ * @param nic_data
+ */
+static void nic_rx_pool_setup(nic_t *nic_data)
+{
+	nic_data->rx_pool_state = NIC_RX_POOL_UNSUPPORTED;
+
+	if (nic_data->rx_pool == NULL) {
+		void *pool = as_area_create(AS_AREA_ANY, sizeof(nic_rx_pool_t),
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    AS_AREA_UNPAGED);
+		if (pool == AS_MAP_FAILED)
+			return;
+
+		nic_data->rx_pool = pool;
+	}
+
+	if (nic_ev_rx_pool(nic_data->client_session, nic_data->rx_pool) == EOK)
+		nic_data->rx_pool_state = NIC_RX_POOL_ACTIVE;
+}
+
+/** Post the frames stored in the receive pool to the client.
+ *
+ * Called with rx_pool_lock held. Returns after the client has processed
+ * the frames, so the slots can be reused immediately.
+ *
+ * @param nic_data
+ */
+static void nic_rx_pool_flush(nic_t *nic_data)
+{
+	if (nic_data->rx_pool_count == 0)
+		return;
+
+	nic_ev_received_batch(nic_data->client_session,
+	    nic_data->rx_pool_count);
+	nic_data->rx_pool_count = 0;
+}
+
+/**
+ * Start a batch of received frames. Drivers that receive several frames
+ * per interrupt should pass them with nic_rx_batch_add between
+ * nic_rx_batch_begin and nic_rx_batch_end instead of allocating
+ * nic_frame_t structures. The frames are then copied directly into a
+ * receive pool shared with the client and the client is notified once
+ * per batch.
+ *
+ * @param nic_data
+ */
+void nic_rx_batch_begin(nic_t *nic_data)
+{
+	fibril_mutex_lock(&nic_data->rx_pool_lock);
+
+	if (nic_data->rx_pool_state == NIC_RX_POOL_UNKNOWN &&
+	    nic_data->client_session != NULL)
+		nic_rx_pool_setup(nic_data);
+
+	nic_data->rx_pool_count = 0;
+	memset(&nic_data->rx_pool_stats, 0, sizeof(nic_device_stats_t));
+}
+
+/**
+ * Add a received frame to the current batch. The frame is checked by
+ * the filters and copied from the driver's buffer, which can be reused
+ * right after the call returns.
+ *
+ * @param nic_data
+ * @param data		Frame data
+ * @param size		Size of the frame
+ */
+void nic_rx_batch_add(nic_t *nic_data, const void *data, size_t size)
+{
+	assert(fibril_mutex_is_locked(&nic_data->rx_pool_lock));
+
+	fibril_rwlock_read_lock(&nic_data->rxc_lock);
+	nic_frame_type_t frame_type;
+	bool check = nic_rxc_check(&nic_data->rx_control, data, size,
+	    &frame_type);
+	fibril_rwlock_read_unlock(&nic_data->rxc_lock);
+
+	if (!nic_rx_account(nic_data, &nic_data->rx_pool_stats, check,
+	    frame_type, size))
+		return;
+
+	if (nic_data->rx_pool_state != NIC_RX_POOL_ACTIVE ||
+	    size > NIC_RX_POOL_SLOT_SIZE) {
+		/* Keep the order of frames already in the pool */
+		nic_rx_pool_flush(nic_data);
+		nic_ev_received(nic_data->client_session, (void *) data, size);
+		return;
+	}
+
+	if (nic_data->rx_pool_count == NIC_RX_POOL_SLOTS)
+		nic_rx_pool_flush(nic_data);
+
+	size_t idx = nic_data->rx_pool_count++;
+	memcpy(nic_data->rx_pool->slot[idx], data, size);
+	nic_data->rx_pool->desc[idx].size = size;
+}
+
+/**
+ * Finish a batch of received frames. The frames stored in the receive
+ * pool are posted to the client with a single notification and the
+ * statistics are updated.
+ *
+ * @param nic_data
+ */
+void nic_rx_batch_end(nic_t *nic_data)
+{
+	nic_rx_pool_flush(nic_data);
+
+	nic_device_stats_t *bstats = &nic_data->rx_pool_stats;
+
+	fibril_rwlock_write_lock(&nic_data->stats_lock);
+	nic_data->stats.receive_packets += bstats->receive_packets;
+	nic_data->stats.receive_bytes += bstats->receive_bytes;
+	nic_data->stats.receive_multicast += bstats->receive_multicast;
+	nic_data->stats.receive_broadcast += bstats->receive_broadcast;
+	nic_data->stats.receive_filtered_unicast +=
+	    bstats->receive_filtered_unicast;
+	nic_data->stats.receive_filtered_multicast +=
+	    bstats->receive_filtered_multicast;
+	nic_data->stats.receive_filtered_broadcast +=
+	    bstats->receive_filtered_broadcast;
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+
+	fibril_mutex_unlock(&nic_data->rx_pool_lock);
+}
+
 /** Allocate and initialize the driver data.
  *
  * @return Allocated structure or NULL.
@@ -606,6 +759,9 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	nic_data->fun = NULL;
 	nic_data->state = NIC_STATE_STOPPED;
 	nic_data->client_session = NULL;
+	nic_data->rx_pool = NULL;
+	nic_data->rx_pool_state = NIC_RX_POOL_UNKNOWN;
+	nic_data->rx_pool_count = 0;
 	nic_data->poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->default_poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->send_frame = NULL;
@@ -618,6 +774,7 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	fibril_rwlock_initialize(&nic_data->stats_lock);
 	fibril_rwlock_initialize(&nic_data->rxc_lock);
 	fibril_rwlock_initialize(&nic_data->wv_lock);
+	fibril_mutex_initialize(&nic_data->rx_pool_lock);
 	
 	memset(&nic_data->mac, 0, sizeof(nic_address_t));
 	memset(&nic_data->default_mac, 0, sizeof(nic_address_t));
@@ -655,6 +812,9 @@ nic_t *nic_create_and_bind(ddf_dev_t *device)
  */
 static void nic_destroy(nic_t *nic_data)
 {
+	if (nic_data->rx_pool != NULL)
+		as_area_destroy(nic_data->rx_pool);
+
 	free(nic_data->specific);
 }
 
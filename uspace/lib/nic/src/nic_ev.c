@@ -35,6 +35,7 @@
  * @brief
  */
 
+#include <as.h>
 #include <async.h>
 #include <nic_iface.h>
 #include <errno.h>
@@ -93,5 +94,49 @@ errno_t nic_ev_received(async_sess_t *sess, void *data, size_t size)
 	return retval;
 }
 
+/** Offer the shared receive pool to the client.
+ *
+ * @param sess Client callback session
+ * @param pool Address space area holding the nic_rx_pool_t
+ *
+ * @return EOK if the client mapped the pool, ENOTSUP if the client
+ *         does not support batched reception or another error code.
+ */
+errno_t nic_ev_rx_pool(async_sess_t *sess, nic_rx_pool_t *pool)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, NIC_EV_RX_POOL, &answer);
+	errno_t retval = async_share_out_start(exch, pool,
+	    AS_AREA_READ | AS_AREA_CACHEABLE);
+
+	async_exchange_end(exch);
+
+	if (retval != EOK) {
+		async_forget(req);
+		return retval;
+	}
+
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Frames received into the shared receive pool.
+ *
+ * @param sess  Client callback session
+ * @param count Number of frames stored in slots 0 .. count - 1
+ */
+errno_t nic_ev_received_batch(async_sess_t *sess, size_t count)
+{
+	errno_t rc;
+
+	async_exch_t *exch = async_exchange_begin(sess);
+	rc = async_req_1_0(exch, NIC_EV_RECEIVED_BATCH, count);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
 /** @}
  */
@@ -201,6 +201,11 @@ errno_t nic_callback_create_impl(ddf_fun_t *fun)
 		return ENOMEM;
 	}
 	
+	/* The receive pool is offered to the new client on first use */
+	fibril_mutex_lock(&nic->rx_pool_lock);
+	nic->rx_pool_state = NIC_RX_POOL_UNKNOWN;
+	fibril_mutex_unlock(&nic->rx_pool_lock);
+	
 	fibril_rwlock_write_unlock(&nic->main_lock);
 	return EOK;
 }
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <as.h>
+#include <errno.h>
+#include <mem.h>
+#include <nic_iface.h>
+#include <pcut/pcut.h>
+
+#include "../include/nic.h"
+#include "../include/nic_driver.h"
+#include "../include/nic_ev.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(rx_batch);
+
+/*
+ * Stub client
+ *
+ * Replaces the client notifications of nic_ev.c and records them in
+ * the order they were posted. All of nic_ev.c is replaced so that it is
+ * not linked in from the library.
+ */
+
+#define TEST_EVENTS_MAX  8
+
+typedef struct {
+	/** NIC_EV_RECEIVED or NIC_EV_RECEIVED_BATCH */
+	nic_event_t type;
+	/** Frame size or number of frames in the batch */
+	size_t arg;
+	/** First byte after the header of the frame or the first batch frame */
+	uint8_t tag;
+} test_event_t;
+
+static test_event_t test_events[TEST_EVENTS_MAX];
+static size_t test_events_cnt;
+/** Number of times the receive pool was offered */
+static unsigned test_pool_offers;
+/** Answer of the client to the pool offer */
+static errno_t test_pool_rc;
+
+static void test_event_add(nic_event_t type, size_t arg, uint8_t tag)
+{
+	PCUT_ASSERT_TRUE(test_events_cnt < TEST_EVENTS_MAX);
+	test_events[test_events_cnt].type = type;
+	test_events[test_events_cnt].arg = arg;
+	test_events[test_events_cnt].tag = tag;
+	test_events_cnt++;
+}
+
+errno_t nic_ev_addr_changed(async_sess_t *sess, const nic_address_t *addr)
+{
+	return EOK;
+}
+
+errno_t nic_ev_device_state(async_sess_t *sess, sysarg_t state)
+{
+	return EOK;
+}
+
+errno_t nic_ev_received(async_sess_t *sess, void *data, size_t size)
+{
+	test_event_add(NIC_EV_RECEIVED, size, ((uint8_t *) data)[2 * ETH_ADDR]);
+	return EOK;
+}
+
+errno_t nic_ev_rx_pool(async_sess_t *sess, nic_rx_pool_t *pool)
+{
+	test_pool_offers++;
+	return test_pool_rc;
+}
+
+static nic_t test_nic;
+
+errno_t nic_ev_received_batch(async_sess_t *sess, size_t count)
+{
+	test_event_add(NIC_EV_RECEIVED_BATCH, count,
+	    test_nic.rx_pool->slot[0][2 * ETH_ADDR]);
+	return EOK;
+}
+
+/** Fake client session, never used by the stubs */
+static int test_sess;
+
+static uint8_t test_frame[NIC_RX_POOL_SLOT_SIZE + 1];
+
+/** Pass a frame to the current batch
+ *
+ * @param dest First byte of the destination address (unicast if even)
+ * @param size Size of the frame
+ * @param tag  Byte stored right after the addresses
+ */
+static void test_frame_add(uint8_t dest, size_t size, uint8_t tag)
+{
+	memset(test_frame, 0, size);
+	test_frame[0] = dest;
+	test_frame[2 * ETH_ADDR] = tag;
+	nic_rx_batch_add(&test_nic, test_frame, size);
+}
+
+static void test_event_check(size_t i, nic_event_t type, size_t arg,
+    uint8_t tag)
+{
+	PCUT_ASSERT_INT_EQUALS(type, test_events[i].type);
+	PCUT_ASSERT_INT_EQUALS(arg, test_events[i].arg);
+	PCUT_ASSERT_INT_EQUALS(tag, test_events[i].tag);
+}
+
+PCUT_TEST_BEFORE
+{
+	memset(&test_nic, 0, sizeof(test_nic));
+	fibril_rwlock_initialize(&test_nic.stats_lock);
+	fibril_rwlock_initialize(&test_nic.rxc_lock);
+	fibril_mutex_initialize(&test_nic.rx_pool_lock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, nic_rxc_init(&test_nic.rx_control));
+
+	test_nic.state = NIC_STATE_ACTIVE;
+	test_nic.client_session = (async_sess_t *) &test_sess;
+	test_nic.rx_pool_state = NIC_RX_POOL_UNKNOWN;
+
+	test_events_cnt = 0;
+	test_pool_offers = 0;
+	test_pool_rc = EOK;
+}
+
+PCUT_TEST_AFTER
+{
+	if (test_nic.rx_pool != NULL)
+		as_area_destroy(test_nic.rx_pool);
+
+	nic_rxc_clear(&test_nic.rx_control);
+}
+
+/** Frames of a batch are stored in the pool and posted at once */
+PCUT_TEST(batch)
+{
+	nic_rx_batch_begin(&test_nic);
+	test_frame_add(0, 60, 1);
+	test_frame_add(0, 100, 2);
+	test_frame_add(0, NIC_RX_POOL_SLOT_SIZE, 3);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(1, test_pool_offers);
+	PCUT_ASSERT_INT_EQUALS(1, test_events_cnt);
+	test_event_check(0, NIC_EV_RECEIVED_BATCH, 3, 1);
+
+	PCUT_ASSERT_INT_EQUALS(60, test_nic.rx_pool->desc[0].size);
+	PCUT_ASSERT_INT_EQUALS(100, test_nic.rx_pool->desc[1].size);
+	PCUT_ASSERT_INT_EQUALS(NIC_RX_POOL_SLOT_SIZE,
+	    test_nic.rx_pool->desc[2].size);
+	PCUT_ASSERT_INT_EQUALS(2, test_nic.rx_pool->slot[1][2 * ETH_ADDR]);
+	PCUT_ASSERT_INT_EQUALS(3, test_nic.rx_pool->slot[2][2 * ETH_ADDR]);
+
+	PCUT_ASSERT_INT_EQUALS(3, test_nic.stats.receive_packets);
+	PCUT_ASSERT_INT_EQUALS(160 + NIC_RX_POOL_SLOT_SIZE,
+	    test_nic.stats.receive_bytes);
+
+	/* The pool is offered only once */
+	nic_rx_batch_begin(&test_nic);
+	test_frame_add(0, 60, 4);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(1, test_pool_offers);
+	PCUT_ASSERT_INT_EQUALS(2, test_events_cnt);
+	test_event_check(1, NIC_EV_RECEIVED_BATCH, 1, 4);
+	PCUT_ASSERT_INT_EQUALS(4, test_nic.stats.receive_packets);
+}
+
+/** Filtered frames are only counted */
+PCUT_TEST(filtered)
+{
+	nic_rx_batch_begin(&test_nic);
+	/* Multicast is blocked by default */
+	test_frame_add(1, 60, 1);
+	test_frame_add(0, 60, 2);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(1, test_events_cnt);
+	test_event_check(0, NIC_EV_RECEIVED_BATCH, 1, 2);
+
+	PCUT_ASSERT_INT_EQUALS(1, test_nic.stats.receive_packets);
+	PCUT_ASSERT_INT_EQUALS(1, test_nic.stats.receive_filtered_multicast);
+}
+
+/** A full pool is posted before more frames are stored */
+PCUT_TEST(pool_full)
+{
+	size_t i;
+
+	nic_rx_batch_begin(&test_nic);
+	for (i = 0; i <= NIC_RX_POOL_SLOTS; i++)
+		test_frame_add(0, 60, i);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(2, test_events_cnt);
+	test_event_check(0, NIC_EV_RECEIVED_BATCH, NIC_RX_POOL_SLOTS, 0);
+	test_event_check(1, NIC_EV_RECEIVED_BATCH, 1, NIC_RX_POOL_SLOTS);
+	PCUT_ASSERT_INT_EQUALS(NIC_RX_POOL_SLOTS + 1,
+	    test_nic.stats.receive_packets);
+}
+
+/** Frames larger than a slot are sent on their own, in order */
+PCUT_TEST(oversized)
+{
+	nic_rx_batch_begin(&test_nic);
+	test_frame_add(0, 60, 1);
+	test_frame_add(0, NIC_RX_POOL_SLOT_SIZE + 1, 2);
+	test_frame_add(0, 60, 3);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(3, test_events_cnt);
+	test_event_check(0, NIC_EV_RECEIVED_BATCH, 1, 1);
+	test_event_check(1, NIC_EV_RECEIVED, NIC_RX_POOL_SLOT_SIZE + 1, 2);
+	test_event_check(2, NIC_EV_RECEIVED_BATCH, 1, 3);
+}
+
+/** Clients without batch support get frames one by one */
+PCUT_TEST(unsupported)
+{
+	test_pool_rc = ENOTSUP;
+
+	nic_rx_batch_begin(&test_nic);
+	test_frame_add(0, 60, 1);
+	test_frame_add(0, 70, 2);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(2, test_events_cnt);
+	test_event_check(0, NIC_EV_RECEIVED, 60, 1);
+	test_event_check(1, NIC_EV_RECEIVED, 70, 2);
+
+	/* The pool is not offered again to the same client */
+	nic_rx_batch_begin(&test_nic);
+	test_frame_add(0, 60, 3);
+	nic_rx_batch_end(&test_nic);
+
+	PCUT_ASSERT_INT_EQUALS(1, test_pool_offers);
+	test_event_check(2, NIC_EV_RECEIVED, 60, 3);
+	PCUT_ASSERT_INT_EQUALS(3, test_nic.stats.receive_packets);
+}
+
+PCUT_EXPORT(rx_batch);
@@ -95,6 +95,47 @@ int posix_fcntl(int fd, int cmd, ...)
 	}
 }
 
+/**
+ * Advise the system about the expected access pattern of a file.
+ *
+ * The advice applies to the whole file, the range is only validated.
+ * Sequential advice makes VFS read ahead of the reader.
+ *
+ * @param fd File descriptor of the opened file.
+ * @param offset Start of the advised range.
+ * @param len Length of the advised range, zero meaning until the end.
+ * @param advice One of POSIX_FADV_*.
+ * @return Zero on success, error number otherwise.
+ */
+int posix_posix_fadvise(int fd, posix_off_t offset, posix_off_t len, int advice)
+{
+	vfs_advice_t vadvice;
+
+	if (offset < 0 || len < 0)
+		return EINVAL;
+
+	switch (advice) {
+	case POSIX_FADV_NORMAL:
+		vadvice = VFS_ADVICE_NORMAL;
+		break;
+	case POSIX_FADV_SEQUENTIAL:
+		vadvice = VFS_ADVICE_SEQUENTIAL;
+		break;
+	case POSIX_FADV_RANDOM:
+		vadvice = VFS_ADVICE_RANDOM;
+		break;
+	case POSIX_FADV_WILLNEED:
+	case POSIX_FADV_DONTNEED:
+	case POSIX_FADV_NOREUSE:
+		/* Nothing to do, the hints are purely advisory. */
+		return 0;
+	default:
+		return EINVAL;
+	}
+
+	return vfs_advise(fd, vadvice);
+}
+
 /**
  * Open, possibly create, a file.
  *
@@ -69,6 +69,7 @@ static int stat_to_posix(struct posix_stat *dest, vfs_stat_t *src)
 	
 	dest->st_nlink = src->lnkcnt;
 	dest->st_size = src->size;
+	dest->st_blksize = src->blksize != 0 ? src->blksize : BUFSIZ;
 
 	if (src->size > INT64_MAX) {
 		errno = ERANGE;
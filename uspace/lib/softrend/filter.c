@@ -34,9 +34,13 @@
  * @file
  */
 
+#include <mem.h>
 #include "filter.h"
 #include <io/pixel.h>
 
+#define SPAN_ONE   (1 << FILTER_SPAN_FRAC)
+#define SPAN_HALF  (1 << (FILTER_SPAN_FRAC - 1))
+
 
 static long round(double val)
 {
@@ -119,5 +123,118 @@ pixel_t filter_bicubic(pixelmap_t *pixmap, double x, double y,
 	return 0;
 }
 
+/** Sample a span with the nearest neighbour filter.
+ *
+ * @param pixmap Source pixmap
+ * @param fx     Horizontal coordinate of the first sample
+ * @param fy     Vertical coordinate of the span
+ * @param step   Horizontal distance between samples
+ * @param dst    Destination buffer
+ * @param count  Number of samples
+ */
+void filter_span_nearest(pixelmap_t *pixmap, int64_t fx, int64_t fy,
+    int64_t step, pixel_t *dst, size_t count)
+{
+	pixel_t *row = pixmap->data +
+	    ((fy + SPAN_HALF) >> FILTER_SPAN_FRAC) * pixmap->width;
+
+	/* Integer translation degenerates to a plain copy */
+	if (step == SPAN_ONE && (fx & (SPAN_ONE - 1)) == 0) {
+		memcpy(dst, row + (fx >> FILTER_SPAN_FRAC),
+		    count * sizeof(pixel_t));
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		dst[i] = row[(fx + SPAN_HALF) >> FILTER_SPAN_FRAC];
+		fx += step;
+	}
+}
+
+/** Linearly interpolate between two pixels.
+ *
+ * The red and blue channels and the alpha and green channels are
+ * processed pairwise in a single 32-bit multiplication.
+ *
+ * @param p First pixel
+ * @param q Second pixel
+ * @param w Weight of the second pixel (0 to 255)
+ */
+static inline pixel_t lerp_pixels(pixel_t p, pixel_t q, uint32_t w)
+{
+	uint32_t rb = (((p & 0x00ff00ff) * (256 - w) +
+	    (q & 0x00ff00ff) * w) >> 8) & 0x00ff00ff;
+	uint32_t ag = (((p >> 8) & 0x00ff00ff) * (256 - w) +
+	    ((q >> 8) & 0x00ff00ff) * w) & 0xff00ff00;
+
+	return rb | ag;
+}
+
+/** Sample a span with the bilinear filter.
+ *
+ * @param pixmap Source pixmap
+ * @param fx     Horizontal coordinate of the first sample
+ * @param fy     Vertical coordinate of the span
+ * @param step   Horizontal distance between samples
+ * @param dst    Destination buffer
+ * @param count  Number of samples
+ */
+void filter_span_bilinear(pixelmap_t *pixmap, int64_t fx, int64_t fy,
+    int64_t step, pixel_t *dst, size_t count)
+{
+	uint32_t wy = (fy >> (FILTER_SPAN_FRAC - 8)) & 0xff;
+	pixel_t *row1 = pixmap->data + (fy >> FILTER_SPAN_FRAC) * pixmap->width;
+	pixel_t *row2 = (wy != 0) ? row1 + pixmap->width : row1;
+
+	for (size_t i = 0; i < count; i++) {
+		sysarg_t x1 = fx >> FILTER_SPAN_FRAC;
+		uint32_t wx = (fx >> (FILTER_SPAN_FRAC - 8)) & 0xff;
+		sysarg_t x2 = (wx != 0) ? x1 + 1 : x1;
+
+		pixel_t top = lerp_pixels(row1[x1], row1[x2], wx);
+		pixel_t bottom = lerp_pixels(row2[x1], row2[x2], wx);
+		dst[i] = lerp_pixels(top, bottom, wy);
+
+		fx += step;
+	}
+}
+
+/** Get span sampler for a filter.
+ *
+ * @param filter Per-pixel filter
+ * @return Span sampler or NULL if the filter does not have one
+ */
+filter_span_t filter_span_get(filter_t filter)
+{
+	if (filter == filter_nearest)
+		return filter_span_nearest;
+
+	if (filter == filter_bilinear)
+		return filter_span_bilinear;
+
+	return NULL;
+}
+
+/** Get range of span coordinates that sample only inside a pixmap.
+ *
+ * @param filter Filter with a span sampler
+ * @param size   Pixmap width or height
+ * @param lo     Place to store the lowest valid coordinate
+ * @param hi     Place to store the highest valid coordinate
+ */
+void filter_span_bounds(filter_t filter, sysarg_t size, int64_t *lo,
+    int64_t *hi)
+{
+	int64_t last = ((int64_t) size - 1) << FILTER_SPAN_FRAC;
+
+	if (filter == filter_nearest) {
+		*lo = -SPAN_HALF;
+		*hi = last + SPAN_HALF - 1;
+	} else {
+		*lo = 0;
+		*hi = last;
+	}
+}
+
 /** @}
  */
@@ -36,14 +36,36 @@
 #ifndef SOFTREND_FILTER_H_
 #define SOFTREND_FILTER_H_
 
+#include <stddef.h>
+#include <stdint.h>
 #include <io/pixelmap.h>
 
 typedef pixel_t (*filter_t)(pixelmap_t *, double, double, pixelmap_extend_t);
 
+/** Number of fractional bits in span coordinates */
+#define FILTER_SPAN_FRAC  16
+
+/** Sample a horizontal span of a pixmap.
+ *
+ * Coordinates are fixed point with FILTER_SPAN_FRAC fractional bits.
+ * The caller guarantees that all samples lie within the bounds given
+ * by filter_span_bounds().
+ */
+typedef void (*filter_span_t)(pixelmap_t *, int64_t, int64_t, int64_t,
+    pixel_t *, size_t);
+
 extern pixel_t filter_nearest(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bilinear(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bicubic(pixelmap_t *, double, double, pixelmap_extend_t);
 
+extern void filter_span_nearest(pixelmap_t *, int64_t, int64_t, int64_t,
+    pixel_t *, size_t);
+extern void filter_span_bilinear(pixelmap_t *, int64_t, int64_t, int64_t,
+    pixel_t *, size_t);
+
+extern filter_span_t filter_span_get(filter_t);
+extern void filter_span_bounds(filter_t, sysarg_t, int64_t *, int64_t *);
+
 #endif
 
 /** @}
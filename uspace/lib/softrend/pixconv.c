@@ -35,6 +35,8 @@
  */
 
 #include <byteorder.h>
+#include <mem.h>
+#include <stdint.h>
 #include "pixconv.h"
 
 /** Pixel conversion and mask functions
@@ -147,6 +149,105 @@ void pixel2gray_8(void *dst, pixel_t pix)
 	*((uint8_t *) dst) = (red + green + blue) >> 24;
 }
 
+/** Row conversion functions
+ *
+ * These functions convert a row of ARGB pixels to a predefined format
+ * at once, which lets the compiler inline the per-pixel conversion and
+ * vectorize the loop. The 32-bit and 24-bit formats are converted four
+ * pixels at a time by byte shuffles where the compiler supports them.
+ * A format whose layout matches the in-memory layout of pixel_t is
+ * a plain copy; the alpha channel then ends up in the unused byte.
+ */
+
+#define PIXEL2VISUAL_ROW(name, bytes) \
+	void pixel2##name##_row(void *dst, const pixel_t *src, size_t count) \
+	{ \
+		uint8_t *pos = (uint8_t *) dst; \
+		for (size_t i = 0; i < count; i++) { \
+			pixel2##name(pos, src[i]); \
+			pos += (bytes); \
+		} \
+	}
+
+#ifdef __LE__
+
+#if defined(__GNUC__) && !defined(__clang__)
+
+/** Sixteen bytes, i.e. four pixels, processed by one shuffle. */
+typedef uint8_t pixconv_vec_t __attribute__((vector_size(16)));
+
+/** Shuffle four pixels at a time, convert the rest one by one.
+ *
+ * Indices 0 to 15 select a byte of the source pixels, index 16 selects
+ * a zero byte. Each group of four pixels produces @a bytes * 4 bytes.
+ */
+#define PIXEL2VISUAL_ROW_SHUFFLE(name, bytes, ...) \
+	void pixel2##name##_row(void *dst, const pixel_t *src, size_t count) \
+	{ \
+		static const pixconv_vec_t mask = { __VA_ARGS__ }; \
+		static const pixconv_vec_t zero = { 0 }; \
+		uint8_t *pos = (uint8_t *) dst; \
+		size_t i = 0; \
+		for (; i + 4 <= count; i += 4) { \
+			pixconv_vec_t vec; \
+			memcpy(&vec, src + i, sizeof(vec)); \
+			vec = __builtin_shuffle(vec, zero, mask); \
+			memcpy(pos, &vec, 4 * (bytes)); \
+			pos += 4 * (bytes); \
+		} \
+		for (; i < count; i++) { \
+			pixel2##name(pos, src[i]); \
+			pos += (bytes); \
+		} \
+	}
+
+PIXEL2VISUAL_ROW_SHUFFLE(rgb_0888, 4,
+    16, 2, 1, 0, 16, 6, 5, 4, 16, 10, 9, 8, 16, 14, 13, 12)
+PIXEL2VISUAL_ROW_SHUFFLE(bgr_0888, 4,
+    16, 0, 1, 2, 16, 4, 5, 6, 16, 8, 9, 10, 16, 12, 13, 14)
+PIXEL2VISUAL_ROW_SHUFFLE(rgb_8880, 4,
+    2, 1, 0, 16, 6, 5, 4, 16, 10, 9, 8, 16, 14, 13, 12, 16)
+PIXEL2VISUAL_ROW_SHUFFLE(rgb_888, 3,
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 16, 16, 16, 16)
+PIXEL2VISUAL_ROW_SHUFFLE(bgr_888, 3,
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 16, 16, 16, 16)
+
+#else
+
+PIXEL2VISUAL_ROW(rgb_0888, 4)
+PIXEL2VISUAL_ROW(bgr_0888, 4)
+PIXEL2VISUAL_ROW(rgb_8880, 4)
+PIXEL2VISUAL_ROW(rgb_888, 3)
+PIXEL2VISUAL_ROW(bgr_888, 3)
+
+#endif
+
+void pixel2bgr_8880_row(void *dst, const pixel_t *src, size_t count)
+{
+	memcpy(dst, src, count * sizeof(pixel_t));
+}
+
+#else
+
+void pixel2rgb_0888_row(void *dst, const pixel_t *src, size_t count)
+{
+	memcpy(dst, src, count * sizeof(pixel_t));
+}
+
+PIXEL2VISUAL_ROW(bgr_0888, 4)
+PIXEL2VISUAL_ROW(rgb_8880, 4)
+PIXEL2VISUAL_ROW(bgr_8880, 4)
+PIXEL2VISUAL_ROW(rgb_888, 3)
+PIXEL2VISUAL_ROW(bgr_888, 3)
+
+#endif
+
+PIXEL2VISUAL_ROW(rgb_555_be, 2)
+PIXEL2VISUAL_ROW(rgb_555_le, 2)
+PIXEL2VISUAL_ROW(rgb_565_be, 2)
+PIXEL2VISUAL_ROW(rgb_565_le, 2)
+PIXEL2VISUAL_ROW(bgr_323, 1)
+
 void visual_mask_8888(void *dst, bool mask)
 {
 	pixel2abgr_8888(dst, mask ? 0xffffffff : 0);
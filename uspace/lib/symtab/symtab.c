@@ -44,7 +44,7 @@
 #include <str_error.h>
 #include <vfs/vfs.h>
 
-#include "include/symtab.h"
+#include <symtab.h>
 
 static errno_t elf_hdr_check(elf_header_t *hdr);
 static errno_t section_hdr_load(int fd, const elf_header_t *ehdr, int idx,
@@ -32,8 +32,8 @@
 /** @file
  */
 
-#ifndef SYMTAB_H_
-#define SYMTAB_H_
+#ifndef LIBSYMTAB_SYMTAB_H_
+#define LIBSYMTAB_SYMTAB_H_
 
 #include <elf/elf.h>
 #include <stddef.h>
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libvirtio
+ * @{
+ */
+/** @file
+ * Virtio device and split virtqueue definitions
+ */
+
+#ifndef LIBVIRTIO_VIRTIO_H_
+#define LIBVIRTIO_VIRTIO_H_
+
+#include <ddf/driver.h>
+#include <ddf/interrupt.h>
+#include <ddi.h>
+#include <fibril_synch.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** PCI vendor ID of virtio devices */
+#define VIRTIO_PCI_VENDOR_ID	0x1af4
+
+/** Device status bits */
+#define VIRTIO_DEV_STATUS_RESET		0x00
+#define VIRTIO_DEV_STATUS_ACKNOWLEDGE	0x01
+#define VIRTIO_DEV_STATUS_DRIVER	0x02
+#define VIRTIO_DEV_STATUS_DRIVER_OK	0x04
+#define VIRTIO_DEV_STATUS_FAILED	0x80
+
+/** Device-independent feature bits */
+#define VIRTIO_F_NOTIFY_ON_EMPTY	24
+#define VIRTIO_F_RING_INDIRECT_DESC	28
+#define VIRTIO_F_RING_EVENT_IDX		29
+
+#define VIRTIO_FEATURE(bit)	(UINT32_C(1) << (bit))
+
+/** Virtqueue descriptor flags */
+#define VIRTQ_DESC_F_NEXT	0x0001
+#define VIRTQ_DESC_F_WRITE	0x0002
+#define VIRTQ_DESC_F_INDIRECT	0x0004
+
+/** Available ring flags */
+#define VIRTQ_AVAIL_F_NO_INTERRUPT	0x0001
+
+/** Used ring flags */
+#define VIRTQ_USED_F_NO_NOTIFY	0x0001
+
+/** Alignment of the used ring in the legacy virtqueue layout */
+#define VIRTQ_ALIGN	4096
+
+/** Virtqueue descriptor */
+typedef struct {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t flags;
+	uint16_t next;
+} virtq_desc_t;
+
+/** Available ring, followed by the 16-bit used_event field */
+typedef struct {
+	uint16_t flags;
+	uint16_t idx;
+	uint16_t ring[];
+} virtq_avail_t;
+
+typedef struct {
+	uint32_t id;
+	uint32_t len;
+} virtq_used_elem_t;
+
+/** Used ring, followed by the 16-bit avail_event field */
+typedef struct {
+	uint16_t flags;
+	uint16_t idx;
+	virtq_used_elem_t ring[];
+} virtq_used_t;
+
+/** Virtqueue
+ *
+ * All operations on the virtqueue must be serialized by the caller using
+ * @c lock.
+ */
+typedef struct {
+	fibril_mutex_t lock;
+
+	/** Queue number */
+	uint16_t index;
+	/** Number of descriptors */
+	uint16_t queue_size;
+
+	/** Ring memory */
+	void *virt;
+	uintptr_t phys;
+	size_t size;
+
+	virtq_desc_t *desc;
+	virtq_avail_t *avail;
+	virtq_used_t *used;
+	/** Used index at which the device should interrupt (event index) */
+	volatile uint16_t *used_event;
+	/** Available index at which the device wants a notification */
+	volatile uint16_t *avail_event;
+
+	/** Head of the free descriptor list */
+	uint16_t free_head;
+	/** Number of free descriptors */
+	uint16_t free_count;
+
+	/** Next used ring entry to consume */
+	uint16_t last_used_idx;
+	/** Available index at the time of the last notification */
+	uint16_t kicked_idx;
+
+	/** Use event index interrupt and notification suppression */
+	bool event_idx;
+
+	/** Notification register */
+	ioport16_t *notify;
+} virtq_t;
+
+/** Virtio device */
+typedef struct {
+	/** Parent session (PCI) */
+	async_sess_t *parent_sess;
+
+	/** Legacy I/O register block */
+	uintptr_t regs_phys;
+	size_t regs_size;
+	void *regs;
+
+	/** Interrupt line */
+	int irq;
+	cap_handle_t irq_cap;
+	irq_pio_range_t irq_ranges[1];
+	irq_cmd_t irq_cmds[4];
+
+	/** Negotiated features */
+	uint32_t features;
+
+	/** Virtqueues */
+	unsigned queues;
+	virtq_t *queue;
+} virtio_dev_t;
+
+/** Interrupt status bit reporting a used buffer notification */
+#define VIRTIO_ISR_QUEUE	0x01
+/** Interrupt status bit reporting a configuration change */
+#define VIRTIO_ISR_CONFIG	0x02
+
+/** Return the interrupt status read by the interrupt pseudocode. */
+#define VIRTIO_IRQ_GET_ISR(call)	((uint8_t) IPC_GET_ARG1(call))
+
+extern errno_t virtio_virtq_desc_alloc(virtq_t *, uint16_t *);
+extern void virtio_virtq_desc_free(virtq_t *, uint16_t);
+extern void virtio_virtq_desc_set(virtq_t *, uint16_t, uintptr_t, uint32_t,
+    uint16_t, uint16_t);
+extern errno_t virtio_virtq_chain_add(virtq_t *, const virtq_desc_t *,
+    unsigned, virtq_desc_t *, uintptr_t, uint16_t *);
+extern void virtio_virtq_produce_available(virtq_t *, uint16_t);
+extern void virtio_virtq_kick(virtq_t *);
+extern bool virtio_virtq_consume_used(virtq_t *, uint16_t *, uint32_t *);
+extern bool virtio_virtq_enable_interrupt(virtq_t *);
+extern void virtio_virtq_disable_interrupt(virtq_t *);
+
+extern errno_t virtio_pci_dev_initialize(ddf_dev_t *, virtio_dev_t *);
+extern void virtio_pci_dev_cleanup(virtio_dev_t *);
+extern uint32_t virtio_pci_negotiate(virtio_dev_t *, uint32_t);
+extern errno_t virtio_pci_virtq_alloc(virtio_dev_t *, unsigned);
+extern errno_t virtio_pci_virtq_setup(virtio_dev_t *, uint16_t);
+extern void virtio_pci_virtq_teardown(virtio_dev_t *, uint16_t);
+extern errno_t virtio_pci_register_interrupt(virtio_dev_t *, ddf_dev_t *,
+    interrupt_handler_t *);
+extern void virtio_pci_dev_ready(virtio_dev_t *);
+extern void virtio_pci_dev_fail(virtio_dev_t *);
+
+extern uint8_t virtio_pci_config_read_8(virtio_dev_t *, size_t);
+extern uint16_t virtio_pci_config_read_16(virtio_dev_t *, size_t);
+extern uint32_t virtio_pci_config_read_32(virtio_dev_t *, size_t);
+extern uint64_t virtio_pci_config_read_64(virtio_dev_t *, size_t);
+
+#endif
+
+/** @}
+ */
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libvirtio
+ * @{
+ */
+/** @file
+ * Virtio PCI transport (legacy interface)
+ *
+ * Devices are driven through the legacy I/O register block in BAR0, which
+ * QEMU and KVM expose on transitional devices by default. Interrupts are
+ * delivered via INTx, reading the ISR status register acknowledges them.
+ */
+
+#include <align.h>
+#include <as.h>
+#include <ddf/log.h>
+#include <device/hw_res.h>
+#include <device/hw_res_parsed.h>
+#include <errno.h>
+#include <mem.h>
+#include <pci_dev_iface.h>
+#include <stdlib.h>
+#include "virtio.h"
+
+/** Legacy virtio PCI register offsets */
+#define VIRTIO_PCI_DEVICE_FEATURES	0x00
+#define VIRTIO_PCI_GUEST_FEATURES	0x04
+#define VIRTIO_PCI_QUEUE_PFN		0x08
+#define VIRTIO_PCI_QUEUE_SIZE		0x0c
+#define VIRTIO_PCI_QUEUE_SEL		0x0e
+#define VIRTIO_PCI_QUEUE_NOTIFY		0x10
+#define VIRTIO_PCI_DEVICE_STATUS	0x12
+#define VIRTIO_PCI_ISR_STATUS		0x13
+/** Device-specific configuration (MSI-X disabled) */
+#define VIRTIO_PCI_CONFIG		0x14
+
+/** Queue addresses are given in units of this size. */
+#define VIRTIO_PCI_QUEUE_ADDR_SHIFT	12
+
+/** PCI command register and its bus master enable bit */
+#define PCI_CMD		0x04
+#define PCI_CMD_MASTER	0x0004
+
+#define REG(vdev, off)	((void *) ((uint8_t *) (vdev)->regs + (off)))
+
+static irq_cmd_t virtio_pci_irq_cmds[] = {
+	{
+		/* Read and acknowledge the interrupt status */
+		.cmd = CMD_PIO_READ_8,
+		.addr = NULL,
+		.dstarg = 1
+	},
+	{
+		.cmd = CMD_PREDICATE,
+		.value = 1,
+		.srcarg = 1
+	},
+	{
+		.cmd = CMD_ACCEPT
+	},
+	{
+		.cmd = CMD_DECLINE
+	}
+};
+
+static void virtio_pci_status_set(virtio_dev_t *vdev, uint8_t status)
+{
+	uint8_t cur = pio_read_8(REG(vdev, VIRTIO_PCI_DEVICE_STATUS));
+
+	pio_write_8(REG(vdev, VIRTIO_PCI_DEVICE_STATUS), cur | status);
+}
+
+/** Enable bus mastering, the device cannot access the rings otherwise. */
+static errno_t virtio_pci_enable_bus_master(virtio_dev_t *vdev)
+{
+	uint16_t cmd;
+	errno_t rc;
+
+	rc = pci_config_space_read_16(vdev->parent_sess, PCI_CMD, &cmd);
+	if (rc != EOK)
+		return rc;
+
+	return pci_config_space_write_16(vdev->parent_sess, PCI_CMD,
+	    cmd | PCI_CMD_MASTER);
+}
+
+/** Initialize a virtio PCI device.
+ *
+ * Maps the legacy register block, resets the device and announces the
+ * driver. The caller continues with virtio_pci_negotiate(), sets up the
+ * virtqueues and finishes with virtio_pci_dev_ready().
+ *
+ * @param dev		DDF device
+ * @param vdev		Virtio device structure to initialize
+ * @return		EOK on success or an error code
+ */
+errno_t virtio_pci_dev_initialize(ddf_dev_t *dev, virtio_dev_t *vdev)
+{
+	hw_res_list_parsed_t hw_res;
+	errno_t rc;
+
+	memset(vdev, 0, sizeof(virtio_dev_t));
+	vdev->irq = -1;
+	vdev->irq_cap = CAP_NIL;
+
+	vdev->parent_sess = ddf_dev_parent_sess_get(dev);
+	if (vdev->parent_sess == NULL)
+		return ENOMEM;
+
+	hw_res_list_parsed_init(&hw_res);
+	rc = hw_res_get_list_parsed(vdev->parent_sess, &hw_res, 0);
+	if (rc != EOK)
+		return rc;
+
+	if (hw_res.io_ranges.count < 1 || hw_res.irqs.count < 1 ||
+	    RNGSZ(hw_res.io_ranges.ranges[0]) < VIRTIO_PCI_CONFIG) {
+		ddf_msg(LVL_ERROR, "Legacy virtio register block not found.");
+		rc = ENOTSUP;
+		goto error;
+	}
+
+	vdev->regs_phys = RNGABS(hw_res.io_ranges.ranges[0]);
+	vdev->regs_size = RNGSZ(hw_res.io_ranges.ranges[0]);
+	vdev->irq = hw_res.irqs.irqs[0];
+
+	rc = pio_enable_range(&hw_res.io_ranges.ranges[0], &vdev->regs);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot enable access to the registers.");
+		goto error;
+	}
+
+	hw_res_list_parsed_clean(&hw_res);
+
+	rc = virtio_pci_enable_bus_master(vdev);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot enable bus mastering.");
+		return rc;
+	}
+
+	/* Reset the device and announce ourselves. */
+	pio_write_8(REG(vdev, VIRTIO_PCI_DEVICE_STATUS),
+	    VIRTIO_DEV_STATUS_RESET);
+	virtio_pci_status_set(vdev, VIRTIO_DEV_STATUS_ACKNOWLEDGE);
+	virtio_pci_status_set(vdev, VIRTIO_DEV_STATUS_DRIVER);
+
+	return EOK;
+error:
+	hw_res_list_parsed_clean(&hw_res);
+	return rc;
+}
+
+/** Negotiate features.
+ *
+ * @param vdev		Virtio device
+ * @param wanted	Features supported by the driver
+ * @return		Features supported by both the device and the driver
+ */
+uint32_t virtio_pci_negotiate(virtio_dev_t *vdev, uint32_t wanted)
+{
+	uint32_t features;
+
+	features = pio_read_32(REG(vdev, VIRTIO_PCI_DEVICE_FEATURES)) & wanted;
+	pio_write_32(REG(vdev, VIRTIO_PCI_GUEST_FEATURES), features);
+	vdev->features = features;
+
+	return features;
+}
+
+/** Allocate virtqueue structures.
+ *
+ * @param vdev		Virtio device
+ * @param count		Number of virtqueues the driver is going to use
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+errno_t virtio_pci_virtq_alloc(virtio_dev_t *vdev, unsigned count)
+{
+	vdev->queue = calloc(count, sizeof(virtq_t));
+	if (vdev->queue == NULL)
+		return ENOMEM;
+
+	vdev->queues = count;
+	return EOK;
+}
+
+/** Set up a virtqueue.
+ *
+ * The size of the virtqueue is dictated by the device in the legacy
+ * interface. The rings are laid out in a physically contiguous area as
+ * required by the legacy interface.
+ *
+ * @param vdev		Virtio device
+ * @param num		Queue number
+ * @return		EOK on success or an error code
+ */
+errno_t virtio_pci_virtq_setup(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *vq;
+	size_t avail_size;
+	size_t used_off;
+	size_t used_size;
+	uint16_t size;
+	uint16_t i;
+	errno_t rc;
+
+	if (num >= vdev->queues)
+		return EINVAL;
+
+	vq = &vdev->queue[num];
+
+	pio_write_16(REG(vdev, VIRTIO_PCI_QUEUE_SEL), num);
+	size = pio_read_16(REG(vdev, VIRTIO_PCI_QUEUE_SIZE));
+	if (size == 0)
+		return ENOENT;
+
+	avail_size = sizeof(virtq_avail_t) + (size + 1) * sizeof(uint16_t);
+	used_off = ALIGN_UP(size * sizeof(virtq_desc_t) + avail_size,
+	    VIRTQ_ALIGN);
+	used_size = sizeof(virtq_used_t) + size * sizeof(virtq_used_elem_t) +
+	    sizeof(uint16_t);
+
+	fibril_mutex_initialize(&vq->lock);
+	vq->index = num;
+	vq->queue_size = size;
+	vq->size = ALIGN_UP(used_off + used_size, PAGE_SIZE);
+	vq->virt = AS_AREA_ANY;
+
+	rc = dmamem_map_anonymous(vq->size, DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &vq->phys, &vq->virt);
+	if (rc != EOK) {
+		vq->virt = NULL;
+		return rc;
+	}
+
+	memset(vq->virt, 0, vq->size);
+
+	vq->desc = vq->virt;
+	vq->avail = (virtq_avail_t *) (vq->desc + size);
+	vq->used = (virtq_used_t *) ((uint8_t *) vq->virt + used_off);
+	vq->used_event = &vq->avail->ring[size];
+	vq->avail_event = (uint16_t *) &vq->used->ring[size];
+
+	for (i = 0; i < size; i++)
+		vq->desc[i].next = i + 1;
+	vq->free_head = 0;
+	vq->free_count = size;
+
+	vq->last_used_idx = 0;
+	vq->kicked_idx = 0;
+	vq->event_idx =
+	    (vdev->features & VIRTIO_FEATURE(VIRTIO_F_RING_EVENT_IDX)) != 0;
+	vq->notify = REG(vdev, VIRTIO_PCI_QUEUE_NOTIFY);
+
+	pio_write_32(REG(vdev, VIRTIO_PCI_QUEUE_PFN),
+	    vq->phys >> VIRTIO_PCI_QUEUE_ADDR_SHIFT);
+
+	return EOK;
+}
+
+/** Tear down a virtqueue.
+ *
+ * @param vdev		Virtio device
+ * @param num		Queue number
+ */
+void virtio_pci_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *vq = &vdev->queue[num];
+
+	if (vq->virt == NULL)
+		return;
+
+	pio_write_16(REG(vdev, VIRTIO_PCI_QUEUE_SEL), num);
+	pio_write_32(REG(vdev, VIRTIO_PCI_QUEUE_PFN), 0);
+
+	dmamem_unmap_anonymous(vq->virt);
+	vq->virt = NULL;
+}
+
+/** Register and enable the device interrupt.
+ *
+ * The handler gets the interrupt status in the first argument, see
+ * @c VIRTIO_IRQ_GET_ISR.
+ *
+ * @param vdev		Virtio device
+ * @param dev		DDF device
+ * @param handler	Interrupt handler
+ * @return		EOK on success or an error code
+ */
+errno_t virtio_pci_register_interrupt(virtio_dev_t *vdev, ddf_dev_t *dev,
+    interrupt_handler_t *handler)
+{
+	irq_code_t irq_code;
+	errno_t rc;
+
+	memcpy(vdev->irq_cmds, virtio_pci_irq_cmds, sizeof(vdev->irq_cmds));
+	vdev->irq_cmds[0].addr = (void *) (vdev->regs_phys +
+	    VIRTIO_PCI_ISR_STATUS);
+
+	vdev->irq_ranges[0].base = vdev->regs_phys;
+	vdev->irq_ranges[0].size = vdev->regs_size;
+
+	irq_code.rangecount = sizeof(vdev->irq_ranges) / sizeof(irq_pio_range_t);
+	irq_code.ranges = vdev->irq_ranges;
+	irq_code.cmdcount = sizeof(vdev->irq_cmds) / sizeof(irq_cmd_t);
+	irq_code.cmds = vdev->irq_cmds;
+
+	rc = register_interrupt_handler(dev, vdev->irq, handler, &irq_code,
+	    &vdev->irq_cap);
+	if (rc != EOK) {
+		vdev->irq_cap = CAP_NIL;
+		return rc;
+	}
+
+	rc = hw_res_enable_interrupt(vdev->parent_sess, vdev->irq);
+	if (rc != EOK) {
+		unregister_interrupt_handler(dev, vdev->irq_cap);
+		vdev->irq_cap = CAP_NIL;
+		return rc;
+	}
+
+	return EOK;
+}
+
+/** Tell the device that the driver is ready. */
+void virtio_pci_dev_ready(virtio_dev_t *vdev)
+{
+	virtio_pci_status_set(vdev, VIRTIO_DEV_STATUS_DRIVER_OK);
+}
+
+/** Tell the device that the driver gave up on it. */
+void virtio_pci_dev_fail(virtio_dev_t *vdev)
+{
+	virtio_pci_status_set(vdev, VIRTIO_DEV_STATUS_FAILED);
+}
+
+/** Reset the device and release all virtqueues.
+ *
+ * The interrupt handler must have been unregistered by the caller.
+ *
+ * @param vdev		Virtio device
+ */
+void virtio_pci_dev_cleanup(virtio_dev_t *vdev)
+{
+	unsigned i;
+
+	if (vdev->regs == NULL)
+		return;
+
+	pio_write_8(REG(vdev, VIRTIO_PCI_DEVICE_STATUS),
+	    VIRTIO_DEV_STATUS_RESET);
+
+	for (i = 0; i < vdev->queues; i++)
+		virtio_pci_virtq_teardown(vdev, i);
+
+	free(vdev->queue);
+	vdev->queue = NULL;
+	vdev->queues = 0;
+}
+
+uint8_t virtio_pci_config_read_8(virtio_dev_t *vdev, size_t off)
+{
+	return pio_read_8(REG(vdev, VIRTIO_PCI_CONFIG + off));
+}
+
+uint16_t virtio_pci_config_read_16(virtio_dev_t *vdev, size_t off)
+{
+	return pio_read_16(REG(vdev, VIRTIO_PCI_CONFIG + off));
+}
+
+uint32_t virtio_pci_config_read_32(virtio_dev_t *vdev, size_t off)
+{
+	return pio_read_32(REG(vdev, VIRTIO_PCI_CONFIG + off));
+}
+
+uint64_t virtio_pci_config_read_64(virtio_dev_t *vdev, size_t off)
+{
+	return (uint64_t) virtio_pci_config_read_32(vdev, off) |
+	    ((uint64_t) virtio_pci_config_read_32(vdev, off + 4) << 32);
+}
+
+/** @}
+ */
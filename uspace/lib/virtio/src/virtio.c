@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libvirtio
+ * @{
+ */
+/** @file
+ * Split virtqueue operations
+ *
+ * The driver side of a split virtqueue: descriptor allocation, publishing
+ * buffers in the available ring, consuming the used ring and interrupt and
+ * notification suppression, either using the ring flags or, if negotiated,
+ * the event index mechanism.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <libarch/barrier.h>
+#include "virtio.h"
+
+/** Determine whether the device asked to be notified.
+ *
+ * Returns @c true if @a event lies in the half-open interval of available
+ * indices <@a old_idx, @a new_idx) published since the last notification.
+ */
+static bool virtq_need_event(uint16_t event, uint16_t new_idx,
+    uint16_t old_idx)
+{
+	return (uint16_t) (new_idx - event - 1) < (uint16_t) (new_idx - old_idx);
+}
+
+/** Allocate a descriptor.
+ *
+ * @param vq		Virtqueue
+ * @param descno	Place to store the descriptor number
+ * @return		EOK on success, ENOMEM if no descriptor is free
+ */
+errno_t virtio_virtq_desc_alloc(virtq_t *vq, uint16_t *descno)
+{
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	if (vq->free_count == 0)
+		return ENOMEM;
+
+	*descno = vq->free_head;
+	vq->free_head = vq->desc[*descno].next;
+	vq->free_count--;
+	return EOK;
+}
+
+/** Free a descriptor chain.
+ *
+ * Frees the descriptor and all descriptors chained to it using
+ * @c VIRTQ_DESC_F_NEXT.
+ *
+ * @param vq		Virtqueue
+ * @param descno	Head of the descriptor chain
+ */
+void virtio_virtq_desc_free(virtq_t *vq, uint16_t descno)
+{
+	uint16_t next;
+	bool more;
+
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	do {
+		more = (vq->desc[descno].flags & VIRTQ_DESC_F_NEXT) != 0;
+		next = vq->desc[descno].next;
+
+		vq->desc[descno].flags = 0;
+		vq->desc[descno].next = vq->free_head;
+		vq->free_head = descno;
+		vq->free_count++;
+
+		descno = next;
+	} while (more);
+}
+
+/** Fill in a descriptor.
+ *
+ * @param vq		Virtqueue
+ * @param descno	Descriptor number
+ * @param addr		Physical address of the buffer
+ * @param len		Length of the buffer
+ * @param flags		Descriptor flags
+ * @param next		Next descriptor in the chain if @a flags contain
+ *			@c VIRTQ_DESC_F_NEXT
+ */
+void virtio_virtq_desc_set(virtq_t *vq, uint16_t descno, uintptr_t addr,
+    uint32_t len, uint16_t flags, uint16_t next)
+{
+	virtq_desc_t *d = &vq->desc[descno];
+
+	d->addr = addr;
+	d->len = len;
+	d->flags = flags;
+	d->next = next;
+}
+
+/** Build a descriptor chain for a buffer made of several parts.
+ *
+ * If @a indirect is not @c NULL, the parts are described in the indirect
+ * table (in DMA memory at @a indirect_phys) and only one ring descriptor is
+ * used. Otherwise a chain of @a n ring descriptors is allocated.
+ *
+ * @param vq		Virtqueue
+ * @param parts		Parts of the buffer, @c next is ignored
+ * @param n		Number of parts
+ * @param indirect	Indirect descriptor table with room for @a n entries
+ *			or @c NULL
+ * @param indirect_phys	Physical address of @a indirect
+ * @param head		Place to store the head of the chain
+ * @return		EOK on success, ENOMEM if there are not enough free
+ *			descriptors
+ */
+errno_t virtio_virtq_chain_add(virtq_t *vq, const virtq_desc_t *parts,
+    unsigned n, virtq_desc_t *indirect, uintptr_t indirect_phys,
+    uint16_t *head)
+{
+	uint16_t descno;
+	uint16_t next;
+	unsigned i;
+
+	assert(fibril_mutex_is_locked(&vq->lock));
+	assert(n > 0);
+
+	if (indirect != NULL) {
+		if (vq->free_count < 1)
+			return ENOMEM;
+
+		for (i = 0; i < n; i++) {
+			indirect[i] = parts[i];
+			indirect[i].flags &= ~VIRTQ_DESC_F_NEXT;
+			indirect[i].next = 0;
+			if (i + 1 < n) {
+				indirect[i].flags |= VIRTQ_DESC_F_NEXT;
+				indirect[i].next = i + 1;
+			}
+		}
+
+		(void) virtio_virtq_desc_alloc(vq, head);
+		virtio_virtq_desc_set(vq, *head, indirect_phys,
+		    n * sizeof(virtq_desc_t), VIRTQ_DESC_F_INDIRECT, 0);
+		return EOK;
+	}
+
+	if (vq->free_count < n)
+		return ENOMEM;
+
+	/* Allocate from the tail so that each descriptor knows its next. */
+	next = 0;
+	for (i = n; i > 0; i--) {
+		(void) virtio_virtq_desc_alloc(vq, &descno);
+		virtio_virtq_desc_set(vq, descno, parts[i - 1].addr,
+		    parts[i - 1].len, (parts[i - 1].flags & ~VIRTQ_DESC_F_NEXT) |
+		    ((i < n) ? VIRTQ_DESC_F_NEXT : 0), next);
+		next = descno;
+	}
+
+	*head = next;
+	return EOK;
+}
+
+/** Make a descriptor chain available to the device.
+ *
+ * The device is not notified, several chains can be published before
+ * calling virtio_virtq_kick() once.
+ *
+ * @param vq		Virtqueue
+ * @param descno	Head of the descriptor chain
+ */
+void virtio_virtq_produce_available(virtq_t *vq, uint16_t descno)
+{
+	uint16_t idx = vq->avail->idx;
+
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	vq->avail->ring[idx % vq->queue_size] = descno;
+
+	/* The ring entry must be visible before the index. */
+	write_barrier();
+	vq->avail->idx = idx + 1;
+}
+
+/** Notify the device about new available buffers if it wants to be.
+ *
+ * @param vq		Virtqueue
+ */
+void virtio_virtq_kick(virtq_t *vq)
+{
+	uint16_t new_idx;
+	uint16_t old_idx;
+	bool notify;
+
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	/* The index must be visible before we look at the suppression. */
+	memory_barrier();
+
+	new_idx = vq->avail->idx;
+	old_idx = vq->kicked_idx;
+	if (new_idx == old_idx)
+		return;
+
+	if (vq->event_idx) {
+		notify = virtq_need_event(*vq->avail_event, new_idx, old_idx);
+	} else {
+		notify = (*(volatile uint16_t *) &vq->used->flags &
+		    VIRTQ_USED_F_NO_NOTIFY) == 0;
+	}
+
+	vq->kicked_idx = new_idx;
+
+	if (notify)
+		pio_write_16(vq->notify, vq->index);
+}
+
+/** Consume one entry of the used ring.
+ *
+ * @param vq		Virtqueue
+ * @param descno	Place to store the head of the used descriptor chain
+ * @param len		Place to store the number of bytes written by the device
+ * @return		@c true if an entry was consumed, @c false if the used
+ *			ring is empty
+ */
+bool virtio_virtq_consume_used(virtq_t *vq, uint16_t *descno, uint32_t *len)
+{
+	virtq_used_elem_t *elem;
+
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	if (*(volatile uint16_t *) &vq->used->idx == vq->last_used_idx)
+		return false;
+
+	/* Do not read the entry before seeing the index. */
+	read_barrier();
+
+	elem = &vq->used->ring[vq->last_used_idx % vq->queue_size];
+	*descno = elem->id;
+	*len = elem->len;
+	vq->last_used_idx++;
+
+	return true;
+}
+
+/** Ask the device to interrupt on the next used buffer.
+ *
+ * With event index, the device is asked to interrupt once it passes the
+ * last consumed entry, which suppresses interrupts for buffers completed
+ * while the driver is still draining the ring.
+ *
+ * @param vq		Virtqueue
+ * @return		@c true if new used entries arrived in the meantime and
+ *			the caller should consume them without waiting for
+ *			an interrupt
+ */
+bool virtio_virtq_enable_interrupt(virtq_t *vq)
+{
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	if (vq->event_idx)
+		*vq->used_event = vq->last_used_idx;
+	else
+		vq->avail->flags &= ~VIRTQ_AVAIL_F_NO_INTERRUPT;
+
+	memory_barrier();
+
+	return *(volatile uint16_t *) &vq->used->idx != vq->last_used_idx;
+}
+
+/** Ask the device not to interrupt on used buffers.
+ *
+ * This is only a hint, the device may still interrupt.
+ *
+ * @param vq		Virtqueue
+ */
+void virtio_virtq_disable_interrupt(virtq_t *vq)
+{
+	assert(fibril_mutex_is_locked(&vq->lock));
+
+	/* With event index, used_event is simply not moved forward. */
+	if (!vq->event_idx)
+		vq->avail->flags |= VIRTQ_AVAIL_F_NO_INTERRUPT;
+}
+
+/** @}
+ */
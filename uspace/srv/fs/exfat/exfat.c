@@ -55,6 +55,8 @@ vfs_info_t exfat_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.cache_lookups = true,
+	.read_ahead = true,
 	.instance = 0,
 };
 
@@ -37,6 +37,7 @@
 #include "exfat_fat.h"
 #include <fibril_synch.h>
 #include <libfs.h>
+#include <extmap.h>
 #include <atomic.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -162,6 +163,8 @@ typedef struct exfat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	exfat_cluster_t	currc_cached_value;
+	/* Extents of the already walked part of a fragmented node's chain. */
+	fs_extmap_t	extmap;
 } exfat_node_t;
 
 
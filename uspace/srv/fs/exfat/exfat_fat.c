@@ -111,6 +111,65 @@ exfat_cluster_walk(exfat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+/** Find the physical cluster holding a logical cluster of a fragmented node.
+ *
+ * This works the same way as its FAT counterpart: the node's extent map is
+ * consulted first and the cluster chain is only walked past its end.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		exFAT node.
+ * @param lcl		Logical cluster number within the node.
+ * @param clp		Output parameter for the physical cluster number.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t exfat_extmap_get(exfat_bs_t *bs, exfat_node_t *nodep,
+    uint32_t lcl, exfat_cluster_t *clp)
+{
+	fs_extmap_t *map = &nodep->extmap;
+	exfat_cluster_t clst;
+	uint32_t curlcl;
+	bool record = true;
+	errno_t rc;
+
+	if (fs_extmap_lookup(map, lcl, clp))
+		return EOK;
+
+	curlcl = fs_extmap_mapped(map);
+	if (curlcl == 0) {
+		clst = nodep->firstc;
+		if (fs_extmap_append(map, clst) != EOK)
+			record = false;
+	} else {
+		curlcl--;
+		(void) fs_extmap_lookup(map, curlcl, &clst);
+	}
+
+	if (nodep->currc_cached_valid &&
+	    nodep->currc_cached_bn / SPC(bs) > curlcl &&
+	    nodep->currc_cached_bn / SPC(bs) <= lcl) {
+		/* The map is full, start with the "current" cluster. */
+		curlcl = nodep->currc_cached_bn / SPC(bs);
+		clst = nodep->currc_cached_value;
+		record = false;
+	}
+
+	while (curlcl < lcl) {
+		rc = exfat_get_cluster(bs, nodep->idx->service_id, clst, &clst);
+		if (rc != EOK)
+			return rc;
+		if (clst < EXFAT_CLST_FIRST || clst > EXFAT_CLST_LAST)
+			return EIO;
+		curlcl++;
+
+		if (record && fs_extmap_append(map, clst) != EOK)
+			record = false;
+	}
+
+	*clp = clst;
+	return EOK;
+}
+
 /** Read block from file located on a exFAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -125,38 +184,35 @@ errno_t
 exfat_block_get(block_t **block, exfat_bs_t *bs, exfat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	exfat_cluster_t firstc = nodep->firstc;
 	exfat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (nodep->fragmented) {
-		if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
-		    nodep->lastc_cached_valid) {
-			/*
-			 * This is a request to read a block within the last cluster
-			 * when fortunately we have the last cluster number cached.
-			 */
-			return block_get(block, nodep->idx->service_id, DATA_FS(bs) + 
-		        (nodep->lastc_cached_value-EXFAT_CLST_FIRST)*SPC(bs) + 
-			    (bn % SPC(bs)), flags);
-		}
+	if (!nodep->fragmented) {
+		return exfat_block_get_by_clst(block, bs,
+		    nodep->idx->service_id, false, nodep->firstc, NULL, bn,
+		    flags);
+	}
 
-		if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-			/*
-			* We can start with the cluster cached by the previous call to
-			* fat_block_get().
-			*/
-			firstc = nodep->currc_cached_value;
-			relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-		}
+	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
+	    nodep->lastc_cached_valid) {
+		/*
+		 * This is a request to read a block within the last cluster
+		 * when fortunately we have the last cluster number cached.
+		 */
+		return block_get(block, nodep->idx->service_id, DATA_FS(bs) + 
+		    (nodep->lastc_cached_value-EXFAT_CLST_FIRST)*SPC(bs) + 
+		    (bn % SPC(bs)), flags);
 	}
 
-	rc = exfat_block_get_by_clst(block, bs, nodep->idx->service_id,
-	    nodep->fragmented, firstc, &currc, relbn, flags);
+	rc = exfat_extmap_get(bs, nodep, bn / SPC(bs), &currc);
+	if (rc != EOK)
+		return rc;
+
+	rc = block_get(block, nodep->idx->service_id, DATA_FS(bs) +
+	    (currc - EXFAT_CLST_FIRST) * SPC(bs) + (bn % SPC(bs)), flags);
 	if (rc != EOK)
 		return rc;
 
@@ -437,6 +493,8 @@ exfat_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t mcl,
  *			argument is FAT_CLST_RES0, then all clusters will
  *			be chopped off.
  *
+ * The caller is expected to truncate the node's extent map.
+ *
  * @return		EOK on success or an error code.
  */
 errno_t exfat_chop_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t lcl)
@@ -111,6 +111,7 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	fs_extmap_init(&node->extmap);
 }
 
 static errno_t exfat_node_sync(exfat_node_t *node)
@@ -199,6 +200,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fs_extmap_fini(&nodep->extmap);
 		free(nodep->bp);
 		free(nodep);
 
@@ -237,6 +239,7 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fs_extmap_fini(&nodep->extmap);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -245,6 +248,7 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fs_extmap_fini(&nodep->extmap);
 		fn = FS_NODE(nodep);
 	} else {
 skip_cache:
@@ -465,15 +469,22 @@ static errno_t exfat_node_shrink(service_id_t service_id, exfat_node_t *nodep,
 		 * The node will be shrunk, clusters will be deallocated.
 		 */
 		if (size == 0) {
+			fs_extmap_truncate(&nodep->extmap, 0);
 			rc = exfat_chop_clusters(bs, nodep, 0);
 			if (rc != EOK)
 				return rc;
 		} else {
 			exfat_cluster_t lastc;
-			rc = exfat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
-			if (rc != EOK)
-				return rc;
+			uint32_t ncl = ROUND_UP(size, BPC(bs)) / BPC(bs);
+
+			/* Keep the mapping of the clusters which remain */
+			fs_extmap_truncate(&nodep->extmap, ncl);
+			if (!fs_extmap_lookup(&nodep->extmap, ncl - 1, &lastc)) {
+				rc = exfat_cluster_walk(bs, service_id,
+				    nodep->firstc, &lastc, NULL, ncl - 1);
+				if (rc != EOK)
+					return rc;
+			}
 			rc = exfat_chop_clusters(bs, nodep, lastc);
 			if (rc != EOK)
 				return rc;
@@ -618,6 +629,7 @@ errno_t exfat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fs_extmap_fini(&nodep->extmap);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -712,6 +724,7 @@ errno_t exfat_destroy_node(fs_node_t *fn)
 	} 
 
 	exfat_idx_destroy(nodep->idx);
+	fs_extmap_fini(&nodep->extmap);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -49,7 +49,9 @@
 
 vfs_info_t ext4fs_vfs_info = {
 	.name = NAME,
-	.instance = 0
+	.instance = 0,
+	.cache_lookups = true,
+	.read_ahead = true
 };
 
 int main(int argc, char **argv)
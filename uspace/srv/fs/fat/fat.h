@@ -37,6 +37,7 @@
 #include "fat_fat.h"
 #include <fibril_synch.h>
 #include <libfs.h>
+#include <extmap.h>
 #include <atomic.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -240,10 +241,14 @@ typedef struct fat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	fat_cluster_t	currc_cached_value;
+	/* Extents of the already walked part of the node's cluster chain. */
+	fs_extmap_t	extmap;
 } fat_node_t;
 
 typedef struct {
 	bool lfn_enabled;
+	/** Free cluster bitmap or NULL if the FAT has to be scanned. */
+	fat_alloc_t *alloc;
 } fat_instance_t;
 
 extern vfs_out_ops_t fat_ops;
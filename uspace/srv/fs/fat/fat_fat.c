@@ -47,6 +47,7 @@
 #include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 
@@ -54,8 +55,8 @@
 
 /**
  * The fat_alloc_lock mutex protects all copies of the File Allocation Table
- * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
+ * during allocation of clusters and the free cluster bitmaps. The lock does
+ * not have to be held durring deallocation of clusters in the FAT itself.
  */
 static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
 
@@ -112,6 +113,69 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Find the physical cluster holding a logical cluster of a node.
+ *
+ * The lookup is served from the node's extent map if possible. Otherwise the
+ * cluster chain is walked from the end of the mapped prefix, or from the
+ * "current" cluster if the map is full, and the walked clusters are added to
+ * the map.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param lcl		Logical cluster number within the node.
+ * @param clp		Output parameter for the physical cluster number.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_extmap_get(fat_bs_t *bs, fat_node_t *nodep, uint32_t lcl,
+    fat_cluster_t *clp)
+{
+	fs_extmap_t *map = &nodep->extmap;
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_cluster_t clst;
+	uint32_t curlcl;
+	bool record = true;
+	errno_t rc;
+
+	if (fs_extmap_lookup(map, lcl, clp))
+		return EOK;
+
+	curlcl = fs_extmap_mapped(map);
+	if (curlcl == 0) {
+		clst = nodep->firstc;
+		if (fs_extmap_append(map, clst) != EOK)
+			record = false;
+	} else {
+		curlcl--;
+		(void) fs_extmap_lookup(map, curlcl, &clst);
+	}
+
+	if (nodep->currc_cached_valid &&
+	    nodep->currc_cached_bn / SPC(bs) > curlcl &&
+	    nodep->currc_cached_bn / SPC(bs) <= lcl) {
+		/* The map is full, start with the "current" cluster. */
+		curlcl = nodep->currc_cached_bn / SPC(bs);
+		clst = nodep->currc_cached_value;
+		record = false;
+	}
+
+	while (curlcl < lcl) {
+		rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1, clst,
+		    &clst);
+		if (rc != EOK)
+			return rc;
+		if (clst < FAT_CLST_FIRST || clst >= clst_last1)
+			return EIO;
+		curlcl++;
+
+		if (record && fs_extmap_append(map, clst) != EOK)
+			record = false;
+	}
+
+	*clp = clst;
+	return EOK;
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +190,16 @@ errno_t
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
 	fat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,18 +211,12 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-	}
+	rc = fat_extmap_get(bs, nodep, bn / SPC(bs), &currc);
+	if (rc != EOK)
+		return rc;
 
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
+	rc = block_get(block, nodep->idx->service_id,
+	    CLBN2PBN(bs, currc, bn), flags);
 	if (rc != EOK)
 		return rc;
 
@@ -630,13 +688,13 @@ fat_set_cluster(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
  *
  * @param bs		Buffer holding the boot sector of the file system.
  * @param service_id	Service ID of the file system.
- * @param lifo		Chain of allocated clusters.
- * @param nclsts	Number of clusters in the lifo chain.
+ * @param clsts		Allocated clusters in the order of the chain.
+ * @param nclsts	Number of clusters in the chain.
  *
  * @return		EOK on success or an error code.
  */
 errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
-    fat_cluster_t *lifo, unsigned nclsts)
+    fat_cluster_t *clsts, unsigned nclsts)
 {
 	uint8_t fatno;
 	unsigned c;
@@ -645,8 +703,8 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 
 	for (fatno = FAT1 + 1; fatno < FATCNT(bs); fatno++) {
 		for (c = 0; c < nclsts; c++) {
-			rc = fat_set_cluster(bs, service_id, fatno, lifo[c],
-			    c == 0 ? clst_last1 : lifo[c - 1]);
+			rc = fat_set_cluster(bs, service_id, fatno, clsts[c],
+			    c + 1 == nclsts ? clst_last1 : clsts[c + 1]);
 			if (rc != EOK)
 				return rc;
 		}
@@ -655,6 +713,313 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+#define ALLOC_BITS	32
+
+static inline bool alloc_bit_test(fat_alloc_t *alloc, fat_cluster_t clst)
+{
+	return (alloc->bitmap[clst / ALLOC_BITS] &
+	    (1U << (clst % ALLOC_BITS))) != 0;
+}
+
+static inline void alloc_bit_set(fat_alloc_t *alloc, fat_cluster_t clst)
+{
+	alloc->bitmap[clst / ALLOC_BITS] |= 1U << (clst % ALLOC_BITS);
+}
+
+static inline void alloc_bit_clear(fat_alloc_t *alloc, fat_cluster_t clst)
+{
+	alloc->bitmap[clst / ALLOC_BITS] &= ~(1U << (clst % ALLOC_BITS));
+}
+
+/** Find the first cluster in a range whose bitmap bit has a given value.
+ *
+ * Whole bitmap words which cannot contain a match are skipped at once.
+ *
+ * @param alloc		Allocator state.
+ * @param clst		First cluster of the range.
+ * @param end		Cluster just past the end of the range.
+ * @param used		Look for a used cluster if true, for a free one
+ *			otherwise.
+ *
+ * @return		First matching cluster or @a end if there is none.
+ */
+static fat_cluster_t alloc_bit_find(fat_alloc_t *alloc, fat_cluster_t clst,
+    fat_cluster_t end, bool used)
+{
+	uint32_t skip = used ? 0 : (uint32_t) -1;
+
+	while (clst < end) {
+		if ((clst % ALLOC_BITS) == 0 &&
+		    alloc->bitmap[clst / ALLOC_BITS] == skip) {
+			clst += ALLOC_BITS;
+			continue;
+		}
+		if (alloc_bit_test(alloc, clst) == used)
+			return clst;
+		clst++;
+	}
+
+	return end;
+}
+
+/** Find a run of contiguous free clusters.
+ *
+ * @param alloc		Allocator state.
+ * @param clst		Cluster where to start the search.
+ * @param end		Cluster just past the end of the searched range.
+ * @param nclsts	Length of the run.
+ * @param start		Output parameter for the first cluster of the run.
+ *
+ * @return		True if a run has been found.
+ */
+static bool alloc_find_run(fat_alloc_t *alloc, fat_cluster_t clst,
+    fat_cluster_t end, unsigned nclsts, fat_cluster_t *start)
+{
+	fat_cluster_t used;
+
+	while (clst < end && end - clst >= nclsts) {
+		clst = alloc_bit_find(alloc, clst, end, false);
+		if (clst >= end || end - clst < nclsts)
+			break;
+
+		used = alloc_bit_find(alloc, clst, clst + nclsts, true);
+		if (used == clst + nclsts) {
+			*start = clst;
+			return true;
+		}
+		clst = used + 1;
+	}
+
+	return false;
+}
+
+/** Pick free clusters from the free cluster bitmap.
+ *
+ * A contiguous run of clusters at or after the next-free hint is preferred so
+ * that large files stay unfragmented. If there is no such run, the first free
+ * clusters found are used instead.
+ *
+ * @param alloc		Allocator state.
+ * @param nclsts	Number of clusters to pick.
+ * @param clsts		Array where to store the picked clusters.
+ *
+ * @return		EOK on success or ENOSPC.
+ */
+static errno_t alloc_pick(fat_alloc_t *alloc, unsigned nclsts,
+    fat_cluster_t *clsts)
+{
+	fat_cluster_t hint = alloc->next_free;
+	fat_cluster_t clst, end;
+	unsigned found;
+
+	if (alloc->free_count < nclsts)
+		return ENOSPC;
+
+	if (hint < FAT_CLST_FIRST || hint >= alloc->clusters)
+		hint = FAT_CLST_FIRST;
+
+	if (nclsts > 1 &&
+	    (alloc_find_run(alloc, hint, alloc->clusters, nclsts, &clst) ||
+	    alloc_find_run(alloc, FAT_CLST_FIRST,
+	    min(hint + nclsts - 1, alloc->clusters), nclsts, &clst))) {
+		for (found = 0; found < nclsts; found++)
+			clsts[found] = clst + found;
+		return EOK;
+	}
+
+	/* Search above the hint first, then wrap around below it. */
+	found = 0;
+	clst = hint;
+	end = alloc->clusters;
+	while (found < nclsts) {
+		clst = alloc_bit_find(alloc, clst, end, false);
+		if (clst >= end) {
+			if (end == hint)
+				break;
+			clst = FAT_CLST_FIRST;
+			end = hint;
+			continue;
+		}
+		clsts[found++] = clst++;
+	}
+
+	return found == nclsts ? EOK : ENOSPC;
+}
+
+/** Build the free cluster bitmap of a file system.
+ *
+ * The first FAT is read in its entirety. FAT16 and FAT32 are decoded one
+ * sector at a time, FAT12 entries may straddle sectors and are fetched one by
+ * one.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param ralloc	Output parameter for the new allocator state.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t fat_alloc_init(fat_bs_t *bs, service_id_t service_id,
+    fat_alloc_t **ralloc)
+{
+	fat_alloc_t *alloc;
+	fat_cluster_t clst, value;
+	size_t words;
+	errno_t rc;
+
+	alloc = calloc(1, sizeof(fat_alloc_t));
+	if (alloc == NULL)
+		return ENOMEM;
+
+	alloc->clusters = CC(bs) + 2;
+	words = (alloc->clusters + ALLOC_BITS - 1) / ALLOC_BITS;
+	alloc->bitmap = calloc(words, sizeof(uint32_t));
+	if (alloc->bitmap == NULL) {
+		free(alloc);
+		return ENOMEM;
+	}
+
+	/* The reserved entries and the padding are never free. */
+	alloc_bit_set(alloc, FAT_CLST_RES0);
+	alloc_bit_set(alloc, FAT_CLST_RES1);
+	for (clst = alloc->clusters; clst < words * ALLOC_BITS; clst++)
+		alloc_bit_set(alloc, clst);
+
+	if (FAT_IS_FAT12(bs)) {
+		for (clst = FAT_CLST_FIRST; clst < alloc->clusters; clst++) {
+			rc = fat_get_cluster(bs, service_id, FAT1, clst,
+			    &value);
+			if (rc != EOK)
+				goto error;
+			if (value != FAT_CLST_RES0)
+				alloc_bit_set(alloc, clst);
+			else
+				alloc->free_count++;
+		}
+	} else {
+		size_t esize = FAT_CLST_SIZE(bs);
+		size_t per_sector = BPS(bs) / esize;
+		aoff64_t sector;
+		block_t *b;
+		size_t i;
+
+		clst = 0;
+		for (sector = 0; clst < alloc->clusters; sector++) {
+			rc = block_get(&b, service_id, RSCNT(bs) + sector,
+			    BLOCK_FLAGS_NONE);
+			if (rc != EOK)
+				goto error;
+
+			for (i = 0; i < per_sector && clst < alloc->clusters;
+			    i++, clst++) {
+				if (esize == FAT32_CLST_SIZE) {
+					value = uint32_t_le2host(
+					    ((uint32_t *) b->data)[i]) &
+					    FAT32_MASK;
+				} else {
+					value = uint16_t_le2host(
+					    ((uint16_t *) b->data)[i]);
+				}
+				if (clst < FAT_CLST_FIRST)
+					continue;
+				if (value != FAT_CLST_RES0)
+					alloc_bit_set(alloc, clst);
+				else
+					alloc->free_count++;
+			}
+
+			rc = block_put(b);
+			if (rc != EOK)
+				goto error;
+		}
+	}
+
+	alloc->next_free = FAT_CLST_FIRST;
+	*ralloc = alloc;
+	return EOK;
+error:
+	fat_alloc_fini(alloc);
+	return rc;
+}
+
+/** Destroy the allocator state of a file system.
+ *
+ * @param alloc		Allocator state or NULL.
+ */
+void fat_alloc_fini(fat_alloc_t *alloc)
+{
+	if (alloc == NULL)
+		return;
+
+	free(alloc->bitmap);
+	free(alloc);
+}
+
+/** Get the allocator state of a mounted file system.
+ *
+ * @param service_id	Service ID of the file system.
+ *
+ * @return		Allocator state or NULL if the file system is not
+ *			mounted or has no free cluster bitmap.
+ */
+fat_alloc_t *fat_alloc_get(service_id_t service_id)
+{
+	void *data;
+
+	if (fs_instance_get(service_id, &data) != EOK)
+		return NULL;
+
+	return ((fat_instance_t *) data)->alloc;
+}
+
+/** Get the number of free clusters tracked by the allocator.
+ *
+ * @param alloc		Allocator state.
+ *
+ * @return		Number of free clusters.
+ */
+uint32_t fat_alloc_free_count(fat_alloc_t *alloc)
+{
+	uint32_t count;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	count = alloc->free_count;
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	return count;
+}
+
+/** Pick free clusters by scanning the first FAT.
+ *
+ * This is used for file systems without a free cluster bitmap.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Device service ID of the file system.
+ * @param nclsts	Number of clusters to pick.
+ * @param clsts		Array where to store the picked clusters.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_scan_free_clusters(fat_bs_t *bs, service_id_t service_id,
+    unsigned nclsts, fat_cluster_t *clsts)
+{
+	unsigned found = 0;
+	fat_cluster_t clst;
+	fat_cluster_t value = 0;
+	errno_t rc;
+
+	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
+	    clst++) {
+		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
+		if (rc != EOK)
+			return rc;
+
+		if (value == FAT_CLST_RES0)
+			clsts[found++] = clst;
+	}
+
+	return found == nclsts ? EOK : ENOSPC;
+}
+
 /** Allocate clusters in all copies of FAT.
  *
  * This function will attempt to allocate the requested number of clusters in
@@ -662,6 +1027,10 @@ errno_t fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
  * clusters form an independent chain (i.e. a chain which does not belong to any
  * file yet).
  *
+ * Free clusters are looked up in the in-core free cluster bitmap of the file
+ * system, if it has one, starting at the cluster following the last
+ * allocation.
+ *
  * @param bs		Buffer holding the boot sector of the file system.
  * @param service_id	Device service ID of the file system.
  * @param nclsts	Number of clusters to allocate.
@@ -676,63 +1045,62 @@ errno_t
 fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
     fat_cluster_t *mcl, fat_cluster_t *lcl)
 {
-	fat_cluster_t *lifo;    /* stack for storing free cluster numbers */
-	unsigned found = 0;     /* top of the free cluster number stack */
-	fat_cluster_t clst;
-	fat_cluster_t value = 0;
+	fat_alloc_t *alloc;
+	fat_cluster_t *clsts;
 	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
-	errno_t rc = EOK;
+	unsigned c, set = 0;
+	errno_t rc;
 
-	lifo = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
-	if (!lifo)
+	clsts = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
+	if (!clsts)
 		return ENOMEM;
-	
-	/*
-	 * Search FAT1 for unused clusters.
-	 */
+
+	alloc = fat_alloc_get(service_id);
+
 	fibril_mutex_lock(&fat_alloc_lock);
-	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
-	    clst++) {
-		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
+	if (alloc != NULL)
+		rc = alloc_pick(alloc, nclsts, clsts);
+	else
+		rc = fat_scan_free_clusters(bs, service_id, nclsts, clsts);
+	if (rc != EOK)
+		goto error;
+
+	/* Link the clusters into a chain in FAT1. */
+	for (set = 0; set < nclsts; set++) {
+		rc = fat_set_cluster(bs, service_id, FAT1, clsts[set],
+		    set + 1 == nclsts ? clst_last1 : clsts[set + 1]);
 		if (rc != EOK)
-			break;
+			goto error;
+	}
 
-		if (value == FAT_CLST_RES0) {
-			/*
-			 * The cluster is free. Put it into our stack
-			 * of found clusters and mark it as non-free.
-			 */
-			lifo[found] = clst;
-			rc = fat_set_cluster(bs, service_id, FAT1, clst,
-			    (found == 0) ?  clst_last1 : lifo[found - 1]);
-			if (rc != EOK)
-				break;
+	rc = fat_alloc_shadow_clusters(bs, service_id, clsts, nclsts);
+	if (rc != EOK)
+		goto error;
 
-			found++;
-		}
+	if (alloc != NULL) {
+		for (c = 0; c < nclsts; c++)
+			alloc_bit_set(alloc, clsts[c]);
+		alloc->free_count -= nclsts;
+		alloc->next_free = clsts[nclsts - 1] + 1;
 	}
 
-	if (rc == EOK && found == nclsts) {
-		rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
-		if (rc == EOK) {
-			*mcl = lifo[found - 1];
-			*lcl = lifo[0];
-			free(lifo);
-			fibril_mutex_unlock(&fat_alloc_lock);
-			return EOK;
-		}
-	}
+	*mcl = clsts[0];
+	*lcl = clsts[nclsts - 1];
+	free(clsts);
+	fibril_mutex_unlock(&fat_alloc_lock);
+	return EOK;
 
+error:
 	/* If something wrong - free the clusters */
-	while (found--) {
-		(void) fat_set_cluster(bs, service_id, FAT1, lifo[found],
+	while (set--) {
+		(void) fat_set_cluster(bs, service_id, FAT1, clsts[set],
 		    FAT_CLST_RES0);
 	}
 
-	free(lifo);
+	free(clsts);
 	fibril_mutex_unlock(&fat_alloc_lock);
 
-	return ENOSPC;
+	return rc;
 }
 
 /** Free clusters forming a cluster chain in all copies of FAT.
@@ -749,6 +1117,7 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 	unsigned fatno;
 	fat_cluster_t nextc = 0;
 	fat_cluster_t clst_bad = FAT_CLST_BAD(bs);
+	fat_alloc_t *alloc = fat_alloc_get(service_id);
 	errno_t rc;
 
 	/* Mark all clusters in the chain as free in all copies of FAT. */
@@ -766,6 +1135,17 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 				return rc;
 		}
 
+		/*
+		 * Only now that the cluster is free in all FATs can the
+		 * allocator hand it out again.
+		 */
+		if (alloc != NULL) {
+			fibril_mutex_lock(&fat_alloc_lock);
+			alloc_bit_clear(alloc, firstc);
+			alloc->free_count++;
+			fibril_mutex_unlock(&fat_alloc_lock);
+		}
+
 		firstc = nextc;
 	}
 
@@ -826,6 +1206,8 @@ errno_t fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
  *			argument is FAT_CLST_RES0, then all clusters will
  *			be chopped off.
  *
+ * The caller is expected to truncate the node's extent map.
+ *
  * @return		EOK on success or an error code.
  */
 errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
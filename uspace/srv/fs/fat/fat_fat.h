@@ -105,6 +105,18 @@ struct fat_bs;
 
 typedef uint32_t fat_cluster_t;
 
+/** In-core state of the cluster allocator of one mounted file system. */
+typedef struct {
+	/** Bitmap of clusters in use, one bit per FAT entry. */
+	uint32_t *bitmap;
+	/** Number of FAT entries covered by the bitmap. */
+	fat_cluster_t clusters;
+	/** Number of free clusters. */
+	uint32_t free_count;
+	/** Cluster at which the search for free clusters starts. */
+	fat_cluster_t next_free;
+} fat_alloc_t;
+
 #define fat_clusters_get(numc, bs, sid, fc) \
     fat_cluster_walk((bs), (sid), (fc), NULL, (numc), (uint32_t) -1)
 extern errno_t fat_cluster_walk(struct fat_bs *, service_id_t, fat_cluster_t,
@@ -124,6 +136,10 @@ extern errno_t fat_alloc_clusters(struct fat_bs *, service_id_t, unsigned,
 extern errno_t fat_free_clusters(struct fat_bs *, service_id_t, fat_cluster_t);
 extern errno_t fat_alloc_shadow_clusters(struct fat_bs *, service_id_t,
     fat_cluster_t *, unsigned);
+extern errno_t fat_alloc_init(struct fat_bs *, service_id_t, fat_alloc_t **);
+extern void fat_alloc_fini(fat_alloc_t *);
+extern fat_alloc_t *fat_alloc_get(service_id_t);
+extern uint32_t fat_alloc_free_count(fat_alloc_t *);
 extern errno_t fat_get_cluster(struct fat_bs *, service_id_t, unsigned,
     fat_cluster_t, fat_cluster_t *);
 extern errno_t fat_set_cluster(struct fat_bs *, service_id_t, unsigned,
@@ -111,6 +111,7 @@ static void fat_node_initialize(fat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	fs_extmap_init(&node->extmap);
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -192,6 +193,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fs_extmap_fini(&nodep->extmap);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,6 +232,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fs_extmap_fini(&nodep->extmap);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -238,6 +241,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fs_extmap_fini(&nodep->extmap);
 		fn = FS_NODE(nodep);
 	} else {
 skip_cache:
@@ -476,6 +480,7 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fs_extmap_fini(&nodep->extmap);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -569,6 +574,7 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fs_extmap_fini(&nodep->extmap);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -864,12 +870,19 @@ errno_t fat_total_block_count(service_id_t service_id, uint64_t *count)
 
 errno_t fat_free_block_count(service_id_t service_id, uint64_t *count)
 {
+	fat_alloc_t *alloc;
 	fat_bs_t *bs;
 	fat_cluster_t e0;
 	uint64_t block_count;
 	errno_t rc;
 	uint32_t cluster_no, clusters;
 
+	alloc = fat_alloc_get(service_id);
+	if (alloc != NULL) {
+		*count = fat_alloc_free_count(alloc);
+		return EOK;
+	}
+
 	block_count = 0;
 	bs = block_bb_get(service_id);
 	clusters = (SPC(bs)) ? TS(bs) / SPC(bs) : 0;
@@ -1075,12 +1088,98 @@ static errno_t fat_fsprobe(service_id_t service_id, vfs_fs_probe_info_t *info)
 	return EOK;
 }
 
+/** Get the FAT32 FS info sector and check its signatures.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param rb		Output parameter for the block holding the FS info.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_fsinfo_get(fat_bs_t *bs, service_id_t service_id,
+    block_t **rb)
+{
+	fat32_fsinfo_t *info;
+	block_t *b;
+	errno_t rc;
+
+	assert(FAT_IS_FAT32(bs));
+
+	rc = block_get(&b, service_id, uint16_t_le2host(bs->fat32.fsinfo_sec),
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK)
+		return rc;
+
+	info = (fat32_fsinfo_t *) b->data;
+
+	if (memcmp(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1)) != 0 ||
+	    memcmp(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2)) != 0 ||
+	    memcmp(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3)) != 0) {
+		(void) block_put(b);
+		return EINVAL;
+	}
+
+	*rb = b;
+	return EOK;
+}
+
+/** Start the free cluster search where the FAT32 FS info suggests.
+ *
+ * The free cluster count is not taken over since the bitmap has just been
+ * built from the FAT and is authoritative.
+ */
+static void fat_read_fat32_fsinfo(service_id_t service_id, fat_alloc_t *alloc)
+{
+	fat32_fsinfo_t *info;
+	fat_cluster_t last;
+	block_t *b;
+
+	if (fat_fsinfo_get(block_bb_get(service_id), service_id, &b) != EOK)
+		return;
+
+	info = (fat32_fsinfo_t *) b->data;
+	last = uint32_t_le2host(info->last_allocated_cluster);
+	if (last >= FAT_CLST_FIRST && last < alloc->clusters)
+		alloc->next_free = last + 1;
+
+	(void) block_put(b);
+}
+
+static errno_t fat_update_fat32_fsinfo(service_id_t service_id)
+{
+	fat_alloc_t *alloc;
+	fat32_fsinfo_t *info;
+	block_t *b;
+	errno_t rc;
+
+	rc = fat_fsinfo_get(block_bb_get(service_id), service_id, &b);
+	if (rc != EOK)
+		return rc;
+
+	info = (fat32_fsinfo_t *) b->data;
+
+	alloc = fat_alloc_get(service_id);
+	if (alloc != NULL) {
+		info->free_clusters = host2uint32_t_le(alloc->free_count);
+		info->last_allocated_cluster = host2uint32_t_le(
+		    alloc->next_free > FAT_CLST_FIRST ?
+		    alloc->next_free - 1 : (uint32_t) -1);
+	} else {
+		/* Without the bitmap, the counter is unknown. */
+		info->free_clusters = host2uint32_t_le((uint32_t) -1);
+	}
+
+	b->dirty = true;
+	return block_put(b);
+}
+
 static errno_t
 fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
     aoff64_t *size)
 {
 	enum cache_mode cmode = CACHE_MODE_WB;
 	fat_instance_t *instance;
+	fat_bs_t *bs;
 	fat_idx_t *ridxp;
 	fs_node_t *rfn;
 	errno_t rc;
@@ -1089,6 +1188,7 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	if (!instance)
 		return ENOMEM;
 	instance->lfn_enabled = true;
+	instance->alloc = NULL;
 
 	/* Parse mount options. */
 	char *mntopts = (char *) opts;
@@ -1106,12 +1206,22 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		return rc;
 	}
 
+	/*
+	 * Build the free cluster bitmap. Should this fail, the allocator
+	 * falls back to scanning the FAT.
+	 */
+	bs = block_bb_get(service_id);
+	if (fat_alloc_init(bs, service_id, &instance->alloc) == EOK &&
+	    FAT_IS_FAT32(bs))
+		fat_read_fat32_fsinfo(service_id, instance->alloc);
+
 	fibril_mutex_lock(&ridxp->lock);
 
 	rc = fs_instance_create(service_id, instance);
 	if (rc != EOK) {
 		fibril_mutex_unlock(&ridxp->lock);
 		fat_fs_close(service_id, rfn);
+		fat_alloc_fini(instance->alloc);
 		free(instance);
 		return rc;
 	}
@@ -1124,37 +1234,6 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	return EOK;
 }
 
-static errno_t fat_update_fat32_fsinfo(service_id_t service_id)
-{
-	fat_bs_t *bs;
-	fat32_fsinfo_t *info;
-	block_t *b;
-	errno_t rc;
-
-	bs = block_bb_get(service_id);
-	assert(FAT_IS_FAT32(bs));
-
-	rc = block_get(&b, service_id, uint16_t_le2host(bs->fat32.fsinfo_sec),
-	    BLOCK_FLAGS_NONE);
-	if (rc != EOK)
-		return rc;
-
-	info = (fat32_fsinfo_t *) b->data;
-
-	if (memcmp(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1)) != 0 ||
-	    memcmp(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2)) != 0 ||
-	    memcmp(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3)) != 0) {
-		(void) block_put(b);
-		return EINVAL;
-	}
-
-	/* For now, invalidate the counter. */
-	info->free_clusters = host2uint16_t_le(-1);
-
-	b->dirty = true;
-	return block_put(b);
-}
-
 static errno_t fat_unmounted(service_id_t service_id)
 {
 	fs_node_t *fn;
@@ -1201,6 +1280,7 @@ static errno_t fat_unmounted(service_id_t service_id)
 	void *data;
 	if (fs_instance_get(service_id, &data) == EOK) {
 		fs_instance_destroy(service_id);
+		fat_alloc_fini(((fat_instance_t *) data)->alloc);
 		free(data);
 	}
 
@@ -1317,6 +1397,75 @@ hit:
 	return rc;
 }
 
+static errno_t
+fat_readdir(service_id_t service_id, fs_index_t index, aoff64_t pos,
+    libfs_dirbuf_t *db, aoff64_t *npos)
+{
+	fs_node_t *fn;
+	fat_node_t *nodep;
+	fat_directory_t di;
+	char name[FAT_LFN_NAME_SIZE];
+	fat_dentry_t *d;
+	errno_t rc;
+
+	rc = fat_node_get(&fn, service_id, index);
+	if (rc != EOK)
+		return rc;
+	if (!fn)
+		return ENOENT;
+	nodep = FAT_NODE(fn);
+
+	if (nodep->type != FAT_DIRECTORY) {
+		(void) fat_node_put(fn);
+		return ENOTDIR;
+	}
+
+	*npos = pos;
+
+	rc = fat_directory_open(nodep, &di);
+	if (rc != EOK) {
+		(void) fat_node_put(fn);
+		return rc;
+	}
+
+	rc = fat_directory_seek(&di, pos);
+	if (rc == EOK) {
+		/*
+		 * The directory is walked only once per batch. The position of
+		 * the short name entry plus one is the cookie for the next
+		 * entry, just as in fat_read().
+		 */
+		while ((rc = fat_directory_read(&di, name, &d)) == EOK) {
+			bool dir = (d->attr & FAT_ATTR_SUBDIR) != 0;
+
+			rc = libfs_dirbuf_add(db, name,
+			    dir ? VFS_DT_DIR : VFS_DT_FILE, 0,
+			    dir ? 0 : uint32_t_le2host(d->size), di.pos + 1);
+			if (rc != EOK)
+				break;
+
+			*npos = di.pos + 1;
+			if (fat_directory_next(&di) != EOK)
+				break;
+		}
+	}
+
+	/*
+	 * Running out of entries or buffer space just ends the batch, unless
+	 * not even a single entry fitted into the buffer.
+	 */
+	if (rc == ENOENT || (rc == ELIMIT && db->used > 0))
+		rc = EOK;
+
+	errno_t rc2 = fat_directory_close(&di);
+	if (rc == EOK)
+		rc = rc2;
+	rc2 = fat_node_put(fn);
+	if (rc == EOK)
+		rc = rc2;
+	return rc;
+}
+
 static errno_t
 fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -1491,15 +1640,22 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 		 * The node will be shrunk, clusters will be deallocated.
 		 */
 		if (size == 0) {
+			fs_extmap_truncate(&nodep->extmap, 0);
 			rc = fat_chop_clusters(bs, nodep, FAT_CLST_RES0);
 			if (rc != EOK)
 				goto out;
 		} else {
 			fat_cluster_t lastc;
-			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
-			if (rc != EOK)
-				goto out;
+			uint32_t ncl = ROUND_UP(size, BPC(bs)) / BPC(bs);
+
+			/* Keep the mapping of the clusters which remain */
+			fs_extmap_truncate(&nodep->extmap, ncl);
+			if (!fs_extmap_lookup(&nodep->extmap, ncl - 1, &lastc)) {
+				rc = fat_cluster_walk(bs, service_id,
+				    nodep->firstc, &lastc, NULL, ncl - 1);
+				if (rc != EOK)
+					goto out;
+			}
 			rc = fat_chop_clusters(bs, nodep, lastc);
 			if (rc != EOK)
 				goto out;
@@ -1564,6 +1720,7 @@ vfs_out_ops_t fat_ops = {
 	.mounted = fat_mounted,
 	.unmounted = fat_unmounted,
 	.read = fat_read,
+	.readdir = fat_readdir,
 	.write = fat_write,
 	.truncate = fat_truncate,
 	.close = fat_close,
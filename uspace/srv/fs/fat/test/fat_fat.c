@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <block.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <libfs.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+#include "../fat.h"
+#include "../fat_dentry.h"
+#include "../fat_fat.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(fat_fat);
+
+/*
+ * In-memory FAT16 file system
+ *
+ * Only the two copies of the FAT are backed by memory, the cluster allocator
+ * does not touch the data area.
+ */
+
+#define TEST_BPS	512
+#define TEST_RSCNT	1
+#define TEST_SF		17
+#define TEST_CC		4096
+#define TEST_LAST	(FAT_CLST_FIRST + TEST_CC - 1)
+
+static uint8_t test_fat[2 * TEST_SF * TEST_BPS];
+static fat_bs_t test_boot;
+static fat_bs_t *test_bs = &test_boot;
+static fat_instance_t test_instance;
+
+errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba,
+    int flags)
+{
+	block_t *b;
+
+	if (ba < TEST_RSCNT || ba >= TEST_RSCNT + 2 * TEST_SF)
+		return EIO;
+
+	b = calloc(1, sizeof(block_t));
+	if (b == NULL)
+		return ENOMEM;
+
+	b->lba = ba;
+	b->size = TEST_BPS;
+	b->data = &test_fat[(ba - TEST_RSCNT) * TEST_BPS];
+	*block = b;
+	return EOK;
+}
+
+errno_t block_put(block_t *block)
+{
+	free(block);
+	return EOK;
+}
+
+errno_t fs_instance_get(service_id_t service_id, void **idp)
+{
+	*idp = &test_instance;
+	return EOK;
+}
+
+/** Get a FAT entry straight from the image */
+static fat_cluster_t test_entry(unsigned fatno, fat_cluster_t clst)
+{
+	uint16_t *fat = (uint16_t *) &test_fat[fatno * TEST_SF * TEST_BPS];
+
+	return uint16_t_le2host(fat[clst]);
+}
+
+/** Set a FAT entry in both copies of the image */
+static void test_set_entry(fat_cluster_t clst, fat_cluster_t value)
+{
+	uint16_t *fat1 = (uint16_t *) test_fat;
+	uint16_t *fat2 = (uint16_t *) &test_fat[TEST_SF * TEST_BPS];
+
+	fat1[clst] = host2uint16_t_le(value);
+	fat2[clst] = host2uint16_t_le(value);
+}
+
+/** Check that a chain is linked in both copies of FAT */
+static void test_check_chain(fat_cluster_t *clsts, unsigned nclsts)
+{
+	unsigned fatno;
+	unsigned c;
+
+	for (fatno = 0; fatno < 2; fatno++) {
+		for (c = 0; c < nclsts; c++) {
+			PCUT_ASSERT_INT_EQUALS(c + 1 == nclsts ?
+			    FAT_CLST_LAST1(test_bs) : clsts[c + 1],
+			    test_entry(fatno, clsts[c]));
+		}
+	}
+}
+
+/** Build the allocator state from the current image */
+static void test_mount(void)
+{
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_init(test_bs, 0,
+	    &test_instance.alloc));
+}
+
+PCUT_TEST_BEFORE
+{
+	memset(test_bs, 0, sizeof(fat_bs_t));
+	test_bs->bps = host2uint16_t_le(TEST_BPS);
+	test_bs->spc = 1;
+	test_bs->rscnt = host2uint16_t_le(TEST_RSCNT);
+	test_bs->fatcnt = 2;
+	test_bs->root_ent_max = host2uint16_t_le(TEST_BPS /
+	    sizeof(fat_dentry_t));
+	test_bs->sec_per_fat = host2uint16_t_le(TEST_SF);
+	test_bs->totsec16 = host2uint16_t_le(TEST_RSCNT + 2 * TEST_SF + 1 +
+	    TEST_CC);
+
+	memset(test_fat, 0, sizeof(test_fat));
+	test_set_entry(FAT_CLST_RES0, 0xfff8);
+	test_set_entry(FAT_CLST_RES1, 0xffff);
+
+	test_instance.alloc = NULL;
+}
+
+PCUT_TEST_AFTER
+{
+	fat_alloc_fini(test_instance.alloc);
+	test_instance.alloc = NULL;
+}
+
+/** Used clusters in the FAT are accounted for when mounting */
+PCUT_TEST(init_free_count)
+{
+	PCUT_ASSERT_TRUE(FAT_IS_FAT16(test_bs));
+
+	test_set_entry(TEST_LAST, FAT_CLST_LAST1(test_bs));
+	test_set_entry(100, FAT_CLST_BAD(test_bs));
+	test_mount();
+
+	PCUT_ASSERT_INT_EQUALS(TEST_CC - 2,
+	    fat_alloc_free_count(test_instance.alloc));
+}
+
+/** A contiguous run after the used clusters is preferred */
+PCUT_TEST(alloc_contiguous)
+{
+	fat_cluster_t clsts[] = { 7, 8, 9, 10 };
+	fat_cluster_t mcl, lcl;
+
+	test_set_entry(3, FAT_CLST_LAST1(test_bs));
+	test_set_entry(6, FAT_CLST_LAST1(test_bs));
+	test_mount();
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_clusters(test_bs, 0, 4,
+	    &mcl, &lcl));
+	PCUT_ASSERT_INT_EQUALS(7, mcl);
+	PCUT_ASSERT_INT_EQUALS(10, lcl);
+	test_check_chain(clsts, 4);
+	PCUT_ASSERT_INT_EQUALS(TEST_CC - 6,
+	    fat_alloc_free_count(test_instance.alloc));
+
+	/* The next search starts after the last allocation. */
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_clusters(test_bs, 0, 1,
+	    &mcl, &lcl));
+	PCUT_ASSERT_INT_EQUALS(11, mcl);
+	PCUT_ASSERT_INT_EQUALS(11, lcl);
+}
+
+/** Scattered clusters are used if there is no long enough run */
+PCUT_TEST(alloc_scattered)
+{
+	fat_cluster_t clsts[] = { 2, 4, 6 };
+	fat_cluster_t clst, mcl, lcl;
+
+	for (clst = 3; clst <= TEST_LAST; clst += 2)
+		test_set_entry(clst, FAT_CLST_LAST1(test_bs));
+	test_mount();
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_clusters(test_bs, 0, 3,
+	    &mcl, &lcl));
+	PCUT_ASSERT_INT_EQUALS(2, mcl);
+	PCUT_ASSERT_INT_EQUALS(6, lcl);
+	test_check_chain(clsts, 3);
+}
+
+/** The search wraps around to the start of the FAT */
+PCUT_TEST(alloc_wrap)
+{
+	fat_cluster_t clsts[] = { TEST_LAST, 5, 9 };
+	fat_cluster_t clst, mcl, lcl;
+
+	for (clst = FAT_CLST_FIRST; clst < TEST_LAST; clst++) {
+		if (clst != 5 && clst != 9)
+			test_set_entry(clst, FAT_CLST_LAST1(test_bs));
+	}
+	test_mount();
+	test_instance.alloc->next_free = TEST_LAST;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_clusters(test_bs, 0, 3,
+	    &mcl, &lcl));
+	PCUT_ASSERT_INT_EQUALS(TEST_LAST, mcl);
+	PCUT_ASSERT_INT_EQUALS(9, lcl);
+	test_check_chain(clsts, 3);
+	PCUT_ASSERT_INT_EQUALS(0, fat_alloc_free_count(test_instance.alloc));
+}
+
+/** Allocation fails without touching the FAT if there is not enough space */
+PCUT_TEST(alloc_nospace)
+{
+	fat_cluster_t clst, mcl, lcl;
+
+	for (clst = FAT_CLST_FIRST; clst <= TEST_LAST; clst++) {
+		if (clst != 20 && clst != 30)
+			test_set_entry(clst, FAT_CLST_LAST1(test_bs));
+	}
+	test_mount();
+
+	PCUT_ASSERT_ERRNO_VAL(ENOSPC, fat_alloc_clusters(test_bs, 0, 3,
+	    &mcl, &lcl));
+	PCUT_ASSERT_INT_EQUALS(FAT_CLST_RES0, test_entry(0, 20));
+	PCUT_ASSERT_INT_EQUALS(FAT_CLST_RES0, test_entry(0, 30));
+	PCUT_ASSERT_INT_EQUALS(2, fat_alloc_free_count(test_instance.alloc));
+}
+
+/** Freed clusters can be allocated again */
+PCUT_TEST(free_realloc)
+{
+	fat_cluster_t mcl, lcl, mcl2, lcl2;
+	fat_cluster_t clst;
+
+	test_mount();
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_clusters(test_bs, 0, 8,
+	    &mcl, &lcl));
+	PCUT_ASSERT_INT_EQUALS(TEST_CC - 8,
+	    fat_alloc_free_count(test_instance.alloc));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_free_clusters(test_bs, 0, mcl));
+	PCUT_ASSERT_INT_EQUALS(TEST_CC,
+	    fat_alloc_free_count(test_instance.alloc));
+	for (clst = mcl; clst <= lcl; clst++) {
+		PCUT_ASSERT_INT_EQUALS(FAT_CLST_RES0, test_entry(0, clst));
+		PCUT_ASSERT_INT_EQUALS(FAT_CLST_RES0, test_entry(1, clst));
+	}
+
+	/* Wrap around to the freed clusters. */
+	test_instance.alloc->next_free = TEST_LAST + 1;
+	PCUT_ASSERT_ERRNO_VAL(EOK, fat_alloc_clusters(test_bs, 0, 8,
+	    &mcl2, &lcl2));
+	PCUT_ASSERT_INT_EQUALS(mcl, mcl2);
+	PCUT_ASSERT_INT_EQUALS(lcl, lcl2);
+}
+
+PCUT_EXPORT(fat_fat);
@@ -67,6 +67,8 @@ typedef struct tmpfs_node {
 	size_t size;		/**< File size if type is TMPFS_FILE. */
 	void *data;		/**< File content's if type is TMPFS_FILE. */
 	list_t cs_list;		/**< Child's siblings list. */
+	link_t *cs_hint;	/**< Sibling where the last readdir stopped. */
+	aoff64_t cs_hint_pos;	/**< Position of cs_hint in cs_list. */
 } tmpfs_node_t;
 
 extern vfs_out_ops_t tmpfs_ops;
@@ -206,6 +206,8 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->size = 0;
 	nodep->data = NULL;
 	list_initialize(&nodep->cs_list);
+	nodep->cs_hint = NULL;
+	nodep->cs_hint_pos = 0;
 }
 
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
@@ -409,6 +411,8 @@ errno_t tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
 		return ENOTEMPTY;
 
+	/* Positions of the siblings that follow have shifted. */
+	parentp->cs_hint = NULL;
 	list_remove(&dentryp->link);
 	free(dentryp);
 	childp->lnkcnt--;
@@ -463,6 +467,28 @@ static errno_t tmpfs_unmounted(service_id_t service_id)
 	return EOK;
 }
 
+/** Find the directory entry at the given position.
+ *
+ * Sequential readers resume where the previous read stopped, so the position
+ * of the last visited sibling is remembered. Other positions still need to
+ * walk the list from its beginning.
+ */
+static link_t *tmpfs_dir_seek(tmpfs_node_t *nodep, aoff64_t pos)
+{
+	link_t *lnk;
+
+	if (nodep->cs_hint != NULL && nodep->cs_hint_pos == pos)
+		lnk = nodep->cs_hint;
+	else if (nodep->cs_hint != NULL && nodep->cs_hint_pos + 1 == pos)
+		lnk = list_next(nodep->cs_hint, &nodep->cs_list);
+	else
+		lnk = list_nth(&nodep->cs_list, pos);
+
+	nodep->cs_hint = lnk;
+	nodep->cs_hint_pos = pos;
+	return lnk;
+}
+
 static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *rbytes)
 {
@@ -501,12 +527,7 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 		
 		assert(nodep->type == TMPFS_DIRECTORY);
 		
-		/*
-		 * Yes, we really use O(n) algorithm here.
-		 * If it bothers someone, it could be fixed by introducing a
-		 * hash table.
-		 */
-		lnk = list_nth(&nodep->cs_list, pos);
+		lnk = tmpfs_dir_seek(nodep, pos);
 		
 		if (lnk == NULL) {
 			async_answer_0(callid, ENOENT);
@@ -524,6 +545,49 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 	return EOK;
 }
 
+static errno_t tmpfs_readdir(service_id_t service_id, fs_index_t index,
+    aoff64_t pos, libfs_dirbuf_t *db, aoff64_t *npos)
+{
+	node_key_t key = {
+		.service_id = service_id,
+		.index = index
+	};
+	
+	ht_link_t *hlp = hash_table_find(&nodes, &key);
+	if (!hlp)
+		return ENOENT;
+	
+	tmpfs_node_t *nodep = hash_table_get_inst(hlp, tmpfs_node_t, nh_link);
+	if (nodep->type != TMPFS_DIRECTORY)
+		return ENOTDIR;
+	
+	link_t *lnk = tmpfs_dir_seek(nodep, pos);
+	while (lnk != NULL) {
+		tmpfs_dentry_t *dentryp = list_get_instance(lnk,
+		    tmpfs_dentry_t, link);
+		tmpfs_node_t *childp = dentryp->node;
+		
+		errno_t rc = libfs_dirbuf_add(db, dentryp->name,
+		    childp->type == TMPFS_DIRECTORY ? VFS_DT_DIR : VFS_DT_FILE,
+		    childp->index, childp->size, pos + 1);
+		if (rc != EOK) {
+			if (db->used == 0)
+				return rc;
+			break;
+		}
+		
+		lnk = list_next(lnk, &nodep->cs_list);
+		pos++;
+	}
+	
+	/* Let the next batch continue right here. */
+	nodep->cs_hint = lnk;
+	nodep->cs_hint_pos = pos;
+	
+	*npos = pos;
+	return EOK;
+}
+
 static errno_t
 tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -659,6 +723,7 @@ vfs_out_ops_t tmpfs_ops = {
 	.mounted = tmpfs_mounted,
 	.unmounted = tmpfs_unmounted,
 	.read = tmpfs_read,
+	.readdir = tmpfs_readdir,
 	.write = tmpfs_write,
 	.truncate = tmpfs_truncate,
 	.close = tmpfs_close,
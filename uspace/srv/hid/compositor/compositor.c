@@ -82,6 +82,9 @@
 #define ANIMATE_WINDOW_TRANSFORMS 0
 #endif
 
+/** Size of the tiles the damaged area is split into for occlusion culling */
+#define COMP_TILE_SIZE  64
+
 static char *server_name;
 static sysarg_t coord_origin;
 static pixel_t bg_color;
@@ -103,6 +106,11 @@ typedef struct {
 	double angle;
 	uint8_t opacity;
 	surface_t *surface;
+	/** Bounding rectangle in global coordinates, updated on each repaint */
+	sysarg_t bnd_x;
+	sysarg_t bnd_y;
+	sysarg_t bnd_w;
+	sysarg_t bnd_h;
 } window_t;
 
 static service_id_t winreg_id;
@@ -377,6 +385,95 @@ static void comp_restrict_pointers(void)
 	fibril_mutex_unlock(&pointer_list_mtx);
 }
 
+/** Determine whether a window completely hides a rectangle.
+ *
+ * Only fully opaque windows with an integer translation are considered,
+ * as those are copied to the viewport without blending.
+ */
+static bool comp_window_covers(window_t *win,
+    sysarg_t x, sysarg_t y, sysarg_t w, sysarg_t h)
+{
+	if (!win->surface || win->opacity != 255 ||
+	    !transform_is_fast(&win->transform))
+		return false;
+
+	return (x >= win->bnd_x) && (y >= win->bnd_y) &&
+	    (x + w <= win->bnd_x + win->bnd_w) &&
+	    (y + h <= win->bnd_y + win->bnd_h);
+}
+
+/** Paint background and windows into one tile of a viewport.
+ *
+ * Windows below the topmost window that covers the whole tile are not
+ * visible and are skipped, as is the background in that case.
+ *
+ * Expects window_list_mtx to be locked and the window bounding
+ * rectangles to be up to date.
+ */
+static void comp_paint_tile(viewport_t *vp, drawctx_t *context,
+    source_t *source, sysarg_t x_tile, sysarg_t y_tile,
+    sysarg_t w_tile, sysarg_t h_tile)
+{
+	link_t *bottom = window_list.head.prev;
+	bool covered = false;
+
+	/* Find the topmost window hiding everything below it. */
+	for (link_t *link = window_list.head.next;
+	    link != &window_list.head; link = link->next) {
+		window_t *win = list_get_instance(link, window_t, link);
+		if (comp_window_covers(win, x_tile, y_tile, w_tile, h_tile)) {
+			bottom = link;
+			covered = true;
+			break;
+		}
+	}
+
+	if (!covered) {
+		/* Paint background color. */
+		for (sysarg_t y = y_tile - vp->pos.y; y < y_tile - vp->pos.y + h_tile; ++y) {
+			pixel_t *dst = pixelmap_pixel_at(
+			    surface_pixmap_access(vp->surface), x_tile - vp->pos.x, y);
+			sysarg_t count = w_tile;
+			while (count-- != 0) {
+				*dst++ = bg_color;
+			}
+		}
+	}
+
+	/* Paint the visible windows from bottom to top. */
+	for (link_t *link = bottom; link != &window_list.head; link = link->prev) {
+
+		/* Determine what part of the window intersects with the tile. */
+		window_t *win = list_get_instance(link, window_t, link);
+		if (!win->surface) {
+			continue;
+		}
+		sysarg_t x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win;
+		bool isec_win = rectangle_intersect(
+		    x_tile, y_tile, w_tile, h_tile,
+		    win->bnd_x, win->bnd_y, win->bnd_w, win->bnd_h,
+		    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
+
+		if (isec_win) {
+			/* Prepare conversion from global coordinates to viewport
+			 * coordinates. */
+			transform_t transform = win->transform;
+			double_point_t pos;
+			pos.x = vp->pos.x;
+			pos.y = vp->pos.y;
+			transform_translate(&transform, -pos.x, -pos.y);
+
+			source_set_transform(source, transform);
+			source_set_texture(source, win->surface,
+			    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+			source_set_alpha(source, PIXEL(win->opacity, 0, 0, 0));
+
+			drawctx_transfer(context,
+			    x_dmg_win - vp->pos.x, y_dmg_win - vp->pos.y, w_dmg_win, h_dmg_win);
+		}
+	}
+}
+
 static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
     sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
 {
@@ -394,20 +491,6 @@ static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
 		    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
 
 		if (isec_vp) {
-
-			/* Paint background color. */
-			for (sysarg_t y = y_dmg_vp - vp->pos.y; y <  y_dmg_vp - vp->pos.y + h_dmg_vp; ++y) {
-				pixel_t *dst = pixelmap_pixel_at(
-				    surface_pixmap_access(vp->surface), x_dmg_vp - vp->pos.x, y);
-				sysarg_t count = w_dmg_vp;
-				while (count-- != 0) {
-					*dst++ = bg_color;
-				}
-			}
-			surface_add_damaged_region(vp->surface,
-			    x_dmg_vp - vp->pos.x, y_dmg_vp - vp->pos.y, w_dmg_vp, h_dmg_vp);
-
-			transform_t transform;
 			source_t source;
 			drawctx_t context;
 
@@ -417,44 +500,37 @@ static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
 			drawctx_set_compose(&context, compose_over);
 			drawctx_set_source(&context, &source);
 
-			/* For each window. */
-			for (link_t *link = window_list.head.prev;
-			    link != &window_list.head; link = link->prev) {
-
-				/* Determine what part of the window intersects with the
-				 * updated area of the current viewport. */
-				window_t *win = list_get_instance(link, window_t, link);
-				if (!win->surface) {
-					continue;
+			list_foreach(window_list, link, window_t, win) {
+				if (win->surface) {
+					sysarg_t w_win, h_win;
+					surface_get_resolution(win->surface, &w_win, &h_win);
+					comp_coord_bounding_rect(0, 0, w_win, h_win,
+					    win->transform, &win->bnd_x, &win->bnd_y,
+					    &win->bnd_w, &win->bnd_h);
 				}
-				sysarg_t x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win;
-				surface_get_resolution(win->surface, &w_dmg_win, &h_dmg_win);
-				comp_coord_bounding_rect(0, 0, w_dmg_win, h_dmg_win, win->transform,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-				bool isec_win = rectangle_intersect(
-				    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-				    x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-
-				if (isec_win) {
-					/* Prepare conversion from global coordinates to viewport
-					 * coordinates. */
-					transform = win->transform;
-					double_point_t pos;
-					pos.x = vp->pos.x;
-					pos.y = vp->pos.y;
-					transform_translate(&transform, -pos.x, -pos.y);
-
-					source_set_transform(&source, transform);
-					source_set_texture(&source, win->surface,
-					    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
-					source_set_alpha(&source, PIXEL(win->opacity, 0, 0, 0));
-
-					drawctx_transfer(&context,
-					    x_dmg_win - vp->pos.x, y_dmg_win - vp->pos.y, w_dmg_win, h_dmg_win);
+			}
+
+			/* Paint the damaged area tile by tile. */
+			for (sysarg_t y_tile = y_dmg_vp; y_tile < y_dmg_vp + h_dmg_vp;
+			    y_tile += COMP_TILE_SIZE) {
+				sysarg_t h_tile = y_dmg_vp + h_dmg_vp - y_tile;
+				if (h_tile > COMP_TILE_SIZE)
+					h_tile = COMP_TILE_SIZE;
+
+				for (sysarg_t x_tile = x_dmg_vp; x_tile < x_dmg_vp + w_dmg_vp;
+				    x_tile += COMP_TILE_SIZE) {
+					sysarg_t w_tile = x_dmg_vp + w_dmg_vp - x_tile;
+					if (w_tile > COMP_TILE_SIZE)
+						w_tile = COMP_TILE_SIZE;
+
+					comp_paint_tile(vp, &context, &source,
+					    x_tile, y_tile, w_tile, h_tile);
 				}
 			}
 
+			surface_add_damaged_region(vp->surface,
+			    x_dmg_vp - vp->pos.x, y_dmg_vp - vp->pos.y, w_dmg_vp, h_dmg_vp);
+
 			list_foreach(pointer_list, link, pointer_t, ptr) {
 				if (ptr->ghost.surface) {
 
@@ -59,6 +59,8 @@ static errno_t handle_log_level_change(sysarg_t new_level)
 
 	log_unlock(log);
 
+	publish_log_levels();
+
 	return EOK;
 }
 
@@ -77,6 +79,8 @@ void logger_connection_handler_control(ipc_callid_t callid)
 		switch (IPC_GET_IMETHOD(call)) {
 		case LOGGER_CONTROL_SET_DEFAULT_LEVEL: {
 			errno_t rc = set_default_logging_level(IPC_GET_ARG1(call));
+			if (rc == EOK)
+				publish_log_levels();
 			async_answer_0(callid, rc);
 			break;
 		}
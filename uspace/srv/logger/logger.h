@@ -38,6 +38,7 @@
 #include <adt/list.h>
 #include <adt/prodcons.h>
 #include <io/log.h>
+#include <ipc/logger.h>
 #include <async.h>
 #include <stdbool.h>
 #include <fibril_synch.h>
@@ -74,7 +75,7 @@ struct logger_log {
 	logger_dest_t *dest;
 };
 
-#define MAX_REFERENCED_LOGS_PER_CLIENT 100
+#define MAX_REFERENCED_LOGS_PER_CLIENT LOGGER_WRITER_LOGS_MAX
 
 typedef struct {
 	size_t logs_count;
@@ -85,8 +86,10 @@ logger_log_t *find_log_by_name_and_lock(const char *name);
 logger_log_t *find_or_create_log_and_lock(const char *, sysarg_t);
 logger_log_t *find_log_by_id_and_lock(sysarg_t);
 bool shall_log_message(logger_log_t *, log_level_t);
+log_level_t get_log_level(logger_log_t *);
 void log_unlock(logger_log_t *);
 void write_to_log(logger_log_t *, log_level_t, const char *);
+void flush_log_dest(logger_dest_t *);
 void log_release(logger_log_t *);
 
 void registered_logs_init(logger_registered_logs_t *);
@@ -99,6 +102,10 @@ errno_t set_default_logging_level(log_level_t);
 
 void logger_connection_handler_control(ipc_callid_t);
 void logger_connection_handler_writer(ipc_callid_t);
+void publish_log_levels(void);
+
+bool ring_record_get(logger_ring_t *, uint32_t, uint32_t, size_t,
+    logger_record_t *);
 
 void parse_initial_settings(void);
 void parse_level_settings(char *);
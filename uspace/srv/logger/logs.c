@@ -193,6 +193,19 @@ bool shall_log_message(logger_log_t *log, log_level_t level)
 	return result;
 }
 
+/** Get the effective level of a log.
+ *
+ * @param log Log, does not need to be locked.
+ * @return Most verbose level of messages that are logged.
+ */
+log_level_t get_log_level(logger_log_t *log)
+{
+	fibril_mutex_lock(&log_list_guard);
+	log_level_t result = get_actual_log_level(log);
+	fibril_mutex_unlock(&log_list_guard);
+	return result;
+}
+
 void log_unlock(logger_log_t *log)
 {
 	assert(fibril_mutex_is_locked(&log->guard));
@@ -285,6 +298,11 @@ void log_release(logger_log_t *log)
 }
 
 
+/** Write a message to the log file.
+ *
+ * The file is not flushed, the caller is expected to call flush_log_dest()
+ * after writing a batch of messages.
+ */
 void write_to_log(logger_log_t *log, log_level_t level, const char *message)
 {
 	assert(fibril_mutex_is_locked(&log->guard));
@@ -297,12 +315,23 @@ void write_to_log(logger_log_t *log, log_level_t level, const char *message)
 		fprintf(log->dest->logfile, "[%s] %s: %s\n",
 		    log->full_name, log_level_str(level),
 		    (const char *) message);
-		fflush(log->dest->logfile);
 	}
 
 	fibril_mutex_unlock(&log->dest->guard);
 }
 
+/** Flush messages written to a log destination.
+ *
+ * @param dest Log destination, kept alive by a reference to one of its logs.
+ */
+void flush_log_dest(logger_dest_t *dest)
+{
+	fibril_mutex_lock(&dest->guard);
+	if (dest->logfile != NULL)
+		fflush(dest->logfile);
+	fibril_mutex_unlock(&dest->guard);
+}
+
 void registered_logs_init(logger_registered_logs_t *logs)
 {
 	logs->logs_count = 0;
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup logger
+ * @{
+ */
+
+/** @file Log ring shared with writer clients.
+ */
+
+#include <ipc/logger.h>
+#include <io/log.h>
+#include "logger.h"
+
+/** Read and check the record at the tail of a log ring.
+ *
+ * The ring is written by the client, which cannot be trusted. The header
+ * is copied out first so that the client cannot change it after it has
+ * been checked.
+ *
+ * @param ring Log ring.
+ * @param tail Consumer position.
+ * @param head Producer position read before the record.
+ * @param logs_count Number of logs of the client.
+ * @param hdr Place to store the header of the record.
+ * @return True if the record is valid, false otherwise.
+ */
+bool ring_record_get(logger_ring_t *ring, uint32_t tail, uint32_t head,
+    size_t logs_count, logger_record_t *hdr)
+{
+	uint32_t off = tail % LOGGER_RING_DATA_SIZE;
+
+	*hdr = *(logger_record_t *) &ring->data[off];
+
+	if (hdr->size < sizeof(logger_record_t))
+		return false;
+	if (hdr->size % LOGGER_RING_ALIGN != 0)
+		return false;
+	if (hdr->size > LOGGER_RING_DATA_SIZE - off)
+		return false;
+	if (hdr->size > head - tail)
+		return false;
+
+	/* Padding only skips the rest of the area. */
+	if (hdr->slot == LOGGER_RECORD_PAD)
+		return true;
+
+	return (hdr->slot < logs_count) && (hdr->level < LVL_LIMIT);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <io/log.h>
+#include <ipc/logger.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include "../logger.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(ring);
+
+/** Number of logs the simulated client has */
+#define LOGS_COUNT  3
+
+static logger_ring_t *ring;
+
+/** Write a record header at a given position of the ring */
+static void put_record(uint32_t pos, uint32_t size, uint16_t slot,
+    uint8_t level)
+{
+	logger_record_t *rec = (logger_record_t *)
+	    &ring->data[pos % LOGGER_RING_DATA_SIZE];
+
+	rec->size = size;
+	rec->slot = slot;
+	rec->level = level;
+	rec->reserved = 0;
+}
+
+/** Check the record at @a tail with the ring filled up to @a head */
+static bool check(uint32_t tail, uint32_t head)
+{
+	logger_record_t hdr;
+
+	return ring_record_get(ring, tail, head, LOGS_COUNT, &hdr);
+}
+
+PCUT_TEST_BEFORE
+{
+	ring = calloc(1, sizeof(logger_ring_t));
+	PCUT_ASSERT_NOT_NULL(ring);
+}
+
+PCUT_TEST_AFTER
+{
+	free(ring);
+}
+
+/** A well-formed record is accepted and its header returned */
+PCUT_TEST(valid)
+{
+	logger_record_t hdr;
+
+	put_record(0, 32, 2, LVL_NOTE);
+	PCUT_ASSERT_TRUE(ring_record_get(ring, 0, 32, LOGS_COUNT, &hdr));
+	PCUT_ASSERT_INT_EQUALS(32, hdr.size);
+	PCUT_ASSERT_INT_EQUALS(2, hdr.slot);
+	PCUT_ASSERT_INT_EQUALS(LVL_NOTE, hdr.level);
+
+	/* Positions keep growing, only their offset in the area counts */
+	uint32_t tail = 5 * LOGGER_RING_DATA_SIZE + 64;
+	put_record(tail, 16, 0, LVL_DEBUG2);
+	PCUT_ASSERT_TRUE(check(tail, tail + 16));
+}
+
+/** Padding up to the end of the area is accepted whatever its level */
+PCUT_TEST(padding)
+{
+	uint32_t tail = LOGGER_RING_DATA_SIZE - 64;
+
+	put_record(tail, 64, LOGGER_RECORD_PAD, 0xff);
+	PCUT_ASSERT_TRUE(check(tail, tail + 64 + 16));
+}
+
+/** Record sizes that do not describe a record in the ring are rejected */
+PCUT_TEST(bad_size)
+{
+	/* Shorter than the header */
+	put_record(0, 0, 0, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, 64));
+	put_record(0, sizeof(logger_record_t) - LOGGER_RING_ALIGN, 0,
+	    LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, 64));
+
+	/* Not aligned */
+	put_record(0, 20, 0, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, 64));
+
+	/* Beyond the producer position */
+	put_record(0, 64, 0, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, 32));
+
+	/* Wrapping around the end of the area */
+	uint32_t tail = LOGGER_RING_DATA_SIZE - 32;
+	put_record(tail, 64, 0, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(tail, tail + 64));
+
+	/* Padding running past the end of the area */
+	put_record(tail, 64, LOGGER_RECORD_PAD, 0);
+	PCUT_ASSERT_FALSE(check(tail, tail + 64));
+
+	/* Larger than the whole area */
+	put_record(0, UINT32_MAX & ~(LOGGER_RING_ALIGN - 1), 0, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, UINT32_MAX));
+}
+
+/** Records of unknown logs or with an invalid level are rejected */
+PCUT_TEST(bad_slot_level)
+{
+	put_record(0, 32, LOGS_COUNT, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, 32));
+
+	put_record(0, 32, LOGGER_RECORD_PAD - 1, LVL_NOTE);
+	PCUT_ASSERT_FALSE(check(0, 32));
+
+	put_record(0, 32, 0, LVL_LIMIT);
+	PCUT_ASSERT_FALSE(check(0, 32));
+}
+
+/** Changing the record after the check does not change the result */
+PCUT_TEST(copied)
+{
+	logger_record_t hdr;
+
+	put_record(0, 32, 1, LVL_WARN);
+	PCUT_ASSERT_TRUE(ring_record_get(ring, 0, 32, LOGS_COUNT, &hdr));
+
+	put_record(0, 4096, LOGS_COUNT, LVL_LIMIT);
+	PCUT_ASSERT_INT_EQUALS(32, hdr.size);
+	PCUT_ASSERT_INT_EQUALS(1, hdr.slot);
+}
+
+PCUT_EXPORT(ring);
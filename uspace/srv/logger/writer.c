@@ -35,19 +35,36 @@
 /** @file
  */
 
+#include <as.h>
+#include <assert.h>
 #include <ipc/services.h>
 #include <ipc/logger.h>
 #include <io/log.h>
 #include <io/logctl.h>
 #include <io/klog.h>
+#include <libarch/barrier.h>
 #include <ns.h>
 #include <async.h>
 #include <errno.h>
+#include <mem.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <str_error.h>
 #include "logger.h"
 
+/** Writer client. */
+typedef struct {
+	link_t link;
+	logger_registered_logs_t logs;
+	/** Log ring shared with the client or NULL. */
+	logger_ring_t *ring;
+	/** Buffer for a message copied out of the ring. */
+	char *message;
+} logger_writer_t;
+
+/** Protects the list of writers and their log tables. */
+static FIBRIL_MUTEX_INITIALIZE(writers_guard);
+static LIST_INITIALIZE(writers);
 
 static logger_log_t *handle_create_log(sysarg_t parent)
 {
@@ -63,8 +80,184 @@ static logger_log_t *handle_create_log(sysarg_t parent)
 	return log;
 }
 
-static errno_t handle_receive_message(sysarg_t log_id, sysarg_t level)
+/** Publish effective level of a log in the ring of the writer.
+ *
+ * Precondition: writers_guard is locked.
+ */
+static void writer_publish_level(logger_writer_t *writer, size_t slot)
+{
+	assert(fibril_mutex_is_locked(&writers_guard));
+
+	if (writer->ring != NULL)
+		writer->ring->level[slot] = get_log_level(writer->logs.logs[slot]);
+}
+
+/** Publish effective levels of all logs to all writers.
+ *
+ * Called whenever logging levels change.
+ */
+void publish_log_levels(void)
+{
+	fibril_mutex_lock(&writers_guard);
+	list_foreach(writers, link, logger_writer_t, writer) {
+		for (size_t i = 0; i < writer->logs.logs_count; i++)
+			writer_publish_level(writer, i);
+	}
+	fibril_mutex_unlock(&writers_guard);
+}
+
+/** Write a message to a log.
+ *
+ * Precondition: log is locked.
+ */
+static void log_message(logger_log_t *log, log_level_t level,
+    const char *message)
+{
+	if (!shall_log_message(log, level))
+		return;
+
+	KLOG_PRINTF(level, "[%s] %s: %s",
+	    log->full_name, log_level_str(level), message);
+	write_to_log(log, level, message);
+}
+
+/** Stop using the log ring of a writer. */
+static void writer_ring_detach(logger_writer_t *writer)
+{
+	fibril_mutex_lock(&writers_guard);
+	if (writer->ring != NULL)
+		as_area_destroy(writer->ring);
+	writer->ring = NULL;
+	fibril_mutex_unlock(&writers_guard);
+
+	free(writer->message);
+	writer->message = NULL;
+}
+
+/** Write out all messages in the log ring of a writer.
+ *
+ * Log files are flushed once per batch rather than once per message.
+ * When the ring is empty, the writer is asked to send LOGGER_WRITER_KICK
+ * as soon as it appends another message.
+ */
+static void writer_ring_drain(logger_writer_t *writer)
+{
+	logger_ring_t *ring = writer->ring;
+	logger_dest_t *dirty = NULL;
+
+	if (ring == NULL)
+		return;
+
+	while (true) {
+		uint32_t tail = ring->tail;
+		uint32_t head = ring->head;
+
+		/* Read records only after reading the producer position. */
+		read_barrier();
+
+		while (tail != head) {
+			uint32_t off = tail % LOGGER_RING_DATA_SIZE;
+			logger_record_t *rec = (logger_record_t *) &ring->data[off];
+			logger_record_t hdr;
+
+			if (!ring_record_get(ring, tail, head,
+			    writer->logs.logs_count, &hdr)) {
+				logger_log("writer: invalid log ring, detaching.\n");
+				if (dirty != NULL)
+					flush_log_dest(dirty);
+				writer_ring_detach(writer);
+				return;
+			}
+
+			if (hdr.slot != LOGGER_RECORD_PAD) {
+				logger_log_t *log = writer->logs.logs[hdr.slot];
+				size_t len = hdr.size - sizeof(logger_record_t);
+
+				memcpy(writer->message, rec + 1, len);
+				writer->message[len > 0 ? len - 1 : 0] = '\0';
+
+				if ((dirty != NULL) && (dirty != log->dest))
+					flush_log_dest(dirty);
+				dirty = log->dest;
+
+				fibril_mutex_lock(&log->guard);
+				log_message(log, hdr.level, writer->message);
+				log_unlock(log);
+			}
+
+			tail += hdr.size;
+
+			/* Hand the space back only after reading the record. */
+			memory_barrier();
+			ring->tail = tail;
+		}
+
+		if (dirty != NULL) {
+			flush_log_dest(dirty);
+			dirty = NULL;
+		}
+
+		ring->waiting = 1;
+
+		/* Pairs with the barrier of the client publishing a record. */
+		memory_barrier();
+		if (ring->head == ring->tail)
+			break;
+
+		ring->waiting = 0;
+	}
+}
+
+static void handle_share_ring(logger_writer_t *writer, ipc_callid_t iid)
 {
+	ipc_callid_t callid;
+	size_t size;
+	unsigned int flags;
+	void *ring;
+
+	if (!async_share_out_receive(&callid, &size, &flags)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	if ((size < sizeof(logger_ring_t)) || (writer->ring != NULL)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	char *message = malloc(LOGGER_RING_DATA_SIZE);
+	if (message == NULL) {
+		async_answer_0(callid, ENOMEM);
+		async_answer_0(iid, ENOMEM);
+		return;
+	}
+
+	errno_t rc = async_share_out_finalize(callid, &ring);
+	if ((rc != EOK) || (ring == AS_MAP_FAILED)) {
+		free(message);
+		async_answer_0(iid, ENOMEM);
+		return;
+	}
+
+	writer->message = message;
+
+	fibril_mutex_lock(&writers_guard);
+	writer->ring = ring;
+	for (size_t i = 0; i < writer->logs.logs_count; i++)
+		writer_publish_level(writer, i);
+	fibril_mutex_unlock(&writers_guard);
+
+	async_answer_0(iid, EOK);
+}
+
+static errno_t handle_receive_message(logger_writer_t *writer,
+    sysarg_t log_id, sysarg_t level)
+{
+	/* Keep the order of messages already in the ring. */
+	writer_ring_drain(writer);
+
 	logger_log_t *log = find_log_by_id_and_lock(log_id);
 	if (log == NULL)
 		return ENOENT;
@@ -74,15 +267,8 @@ static errno_t handle_receive_message(sysarg_t log_id, sysarg_t level)
 	if (rc != EOK)
 		goto leave;
 
-	if (!shall_log_message(log, level)) {
-		rc = EOK;
-		goto leave;
-	}
-
-	KLOG_PRINTF(level, "[%s] %s: %s",
-	    log->full_name, log_level_str(level),
-	    (const char *) message);
-	write_to_log(log, level, message);
+	log_message(log, level, message);
+	flush_log_dest(log->dest);
 
 	rc = EOK;
 
@@ -100,8 +286,15 @@ void logger_connection_handler_writer(ipc_callid_t callid)
 
 	logger_log("writer: new client.\n");
 
-	logger_registered_logs_t registered_logs;
-	registered_logs_init(&registered_logs);
+	logger_writer_t writer;
+	link_initialize(&writer.link);
+	registered_logs_init(&writer.logs);
+	writer.ring = NULL;
+	writer.message = NULL;
+
+	fibril_mutex_lock(&writers_guard);
+	list_append(&writer.link, &writers);
+	fibril_mutex_unlock(&writers_guard);
 
 	while (true) {
 		ipc_call_t call;
@@ -117,28 +310,48 @@ void logger_connection_handler_writer(ipc_callid_t callid)
 				async_answer_0(callid, ENOMEM);
 				break;
 			}
-			if (!register_log(&registered_logs, log)) {
+			fibril_mutex_lock(&writers_guard);
+			if (!register_log(&writer.logs, log)) {
+				fibril_mutex_unlock(&writers_guard);
 				log_unlock(log);
 				async_answer_0(callid, ELIMIT);
 				break;
 			}
+			size_t slot = writer.logs.logs_count - 1;
+			writer_publish_level(&writer, slot);
+			fibril_mutex_unlock(&writers_guard);
 			log_unlock(log);
-			async_answer_1(callid, EOK, (sysarg_t) log);
+			async_answer_2(callid, EOK, (sysarg_t) log, slot);
 			break;
 		}
 		case LOGGER_WRITER_MESSAGE: {
-			errno_t rc = handle_receive_message(IPC_GET_ARG1(call),
-			    IPC_GET_ARG2(call));
+			errno_t rc = handle_receive_message(&writer,
+			    IPC_GET_ARG1(call), IPC_GET_ARG2(call));
 			async_answer_0(callid, rc);
 			break;
 		}
+		case LOGGER_WRITER_RING:
+			handle_share_ring(&writer, callid);
+			break;
+		case LOGGER_WRITER_KICK:
+			async_answer_0(callid, EOK);
+			writer_ring_drain(&writer);
+			break;
 		default:
 			async_answer_0(callid, EINVAL);
 			break;
 		}
 	}
 
-	unregister_logs(&registered_logs);
+	/* Messages logged just before the client terminated. */
+	writer_ring_drain(&writer);
+
+	fibril_mutex_lock(&writers_guard);
+	list_remove(&writer.link);
+	fibril_mutex_unlock(&writers_guard);
+
+	writer_ring_detach(&writer);
+	unregister_logs(&writer.logs);
 	logger_log("writer: client terminated.\n");
 }
 
@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup dnsres
+ * @{
+ */
+/**
+ * @file DNS answer cache.
+ *
+ * Positive and negative answers are kept for as long as their TTL allows.
+ * Concurrent lookups of a name that is already being queried wait for
+ * the query in flight instead of sending one of their own. Entries that
+ * are used often are refreshed in the background shortly before they
+ * expire so that their users do not have to wait for the name server.
+ * An entry is never served after it expires, refreshed or not.
+ */
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <io/log.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+#include "cache.h"
+#include "query.h"
+
+/** Maximum number of cache entries */
+#define DNS_CACHE_MAX_ENTRIES  256
+
+/** Upper bound of the time an answer is kept (seconds) */
+#define DNS_CACHE_TTL_MAX  (24 * 60 * 60)
+
+/** Fraction of the TTL after which a used entry is refreshed (percent) */
+#define DNS_CACHE_REFRESH_PCT  90
+
+/** Number of hits after which an entry is considered worth refreshing */
+#define DNS_CACHE_REFRESH_HITS  2
+
+typedef enum {
+	/** Query in flight */
+	dce_pending,
+	/** Host address known */
+	dce_positive,
+	/** Name server answered there is no such address */
+	dce_negative,
+	/** Query failed, not cached */
+	dce_failed
+} dns_cache_state_t;
+
+typedef struct {
+	/** Link to dns_cache_table */
+	ht_link_t htlink;
+	/** Link to dns_cache_lru, most recently used last */
+	link_t llru;
+	/** Entry is in the table */
+	bool cached;
+	/** Number of fibrils using the entry */
+	unsigned refcnt;
+
+	/** Queried name */
+	char *name;
+	/** Query type */
+	dns_qtype_t qtype;
+
+	dns_cache_state_t state;
+	/** Query result (for dce_failed) */
+	errno_t rc;
+	/** Canonical name (for dce_positive) */
+	char *cname;
+	/** Host address (for dce_positive) */
+	inet_addr_t addr;
+
+	/** Time when the entry expires */
+	struct timeval expires;
+	/** Time after which a used entry is refreshed */
+	struct timeval refresh;
+	/** Number of hits since the entry was last filled in */
+	unsigned hits;
+	/** Refresh in progress */
+	bool refreshing;
+} dns_cache_entry_t;
+
+typedef struct {
+	const char *name;
+	dns_qtype_t qtype;
+} dns_cache_key_t;
+
+static FIBRIL_MUTEX_INITIALIZE(dns_cache_lock);
+static FIBRIL_CONDVAR_INITIALIZE(dns_cache_cv);
+static hash_table_t dns_cache_table;
+static LIST_INITIALIZE(dns_cache_lru);
+static size_t dns_cache_count;
+static dnsr_cache_stats_t dns_cache_stats;
+
+static size_t dns_cache_key_hash_fn(const dns_cache_key_t *key)
+{
+	size_t hash = 0;
+
+	/* Host names are case insensitive */
+	for (const char *cp = key->name; *cp != '\0'; cp++)
+		hash = hash_combine(hash, (uint8_t) tolower(*cp));
+
+	return hash_combine(hash, key->qtype);
+}
+
+static size_t dns_cache_hash(const ht_link_t *item)
+{
+	dns_cache_entry_t *entry = hash_table_get_inst(item, dns_cache_entry_t,
+	    htlink);
+	dns_cache_key_t key = {
+		.name = entry->name,
+		.qtype = entry->qtype
+	};
+
+	return dns_cache_key_hash_fn(&key);
+}
+
+static size_t dns_cache_key_hash(void *key)
+{
+	return dns_cache_key_hash_fn((dns_cache_key_t *) key);
+}
+
+static bool dns_cache_key_equal(void *arg, const ht_link_t *item)
+{
+	dns_cache_key_t *key = (dns_cache_key_t *) arg;
+	dns_cache_entry_t *entry = hash_table_get_inst(item, dns_cache_entry_t,
+	    htlink);
+
+	return (entry->qtype == key->qtype) &&
+	    (str_casecmp(entry->name, key->name) == 0);
+}
+
+static bool dns_cache_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	dns_cache_entry_t *entry = hash_table_get_inst(item1, dns_cache_entry_t,
+	    htlink);
+	dns_cache_key_t key = {
+		.name = entry->name,
+		.qtype = entry->qtype
+	};
+
+	return dns_cache_key_equal(&key, item2);
+}
+
+static void dns_cache_entry_destroy(dns_cache_entry_t *entry)
+{
+	free(entry->name);
+	free(entry->cname);
+	free(entry);
+}
+
+static void dns_cache_remove_callback(ht_link_t *item)
+{
+	dns_cache_entry_t *entry = hash_table_get_inst(item, dns_cache_entry_t,
+	    htlink);
+
+	list_remove(&entry->llru);
+	entry->cached = false;
+	dns_cache_count--;
+
+	/* Fibrils still using the entry will free it */
+	if (entry->refcnt == 0)
+		dns_cache_entry_destroy(entry);
+}
+
+static hash_table_ops_t dns_cache_ops = {
+	.hash = dns_cache_hash,
+	.key_hash = dns_cache_key_hash,
+	.key_equal = dns_cache_key_equal,
+	.equal = dns_cache_equal,
+	.remove_callback = dns_cache_remove_callback
+};
+
+/** Initialize DNS cache. */
+errno_t dns_cache_init(void)
+{
+	if (!hash_table_create(&dns_cache_table, 0, 0, &dns_cache_ops))
+		return ENOMEM;
+
+	return EOK;
+}
+
+/** Drop reference to a cache entry.
+ *
+ * Must be called with dns_cache_lock held.
+ */
+static void dns_cache_entry_release(dns_cache_entry_t *entry)
+{
+	assert(entry->refcnt > 0);
+	entry->refcnt--;
+
+	if ((entry->refcnt == 0) && !entry->cached)
+		dns_cache_entry_destroy(entry);
+}
+
+/** Remove entry from the cache.
+ *
+ * Must be called with dns_cache_lock held.
+ */
+static void dns_cache_entry_remove(dns_cache_entry_t *entry)
+{
+	if (entry->cached)
+		hash_table_remove_item(&dns_cache_table, &entry->htlink);
+}
+
+/** Make room for a new entry by evicting the least recently used one.
+ *
+ * Entries with a query in flight or in use are skipped.
+ * Must be called with dns_cache_lock held.
+ */
+static void dns_cache_evict(void)
+{
+	list_foreach(dns_cache_lru, llru, dns_cache_entry_t, entry) {
+		if (entry->refcnt == 0) {
+			dns_cache_entry_remove(entry);
+			dns_cache_stats.evicted++;
+			return;
+		}
+	}
+}
+
+/** Store query result in an entry.
+ *
+ * Must be called with dns_cache_lock held.
+ *
+ * @param entry Cache entry
+ * @param rc    Query result
+ * @param info  Host information (if @a rc is EOK)
+ * @param ttl   Time to live of the answer in seconds
+ */
+static void dns_cache_entry_fill(dns_cache_entry_t *entry, errno_t rc,
+    dns_host_info_t *info, uint32_t ttl)
+{
+	free(entry->cname);
+	entry->cname = NULL;
+	entry->hits = 0;
+	entry->rc = rc;
+
+	switch (rc) {
+	case EOK:
+		entry->cname = str_dup(info->cname);
+		if (entry->cname == NULL) {
+			entry->state = dce_failed;
+			entry->rc = ENOMEM;
+			break;
+		}
+
+		entry->addr = info->addr;
+		entry->state = dce_positive;
+		break;
+	case ENOENT:
+		entry->state = dce_negative;
+		break;
+	default:
+		/* Not an answer, let the next lookup try again */
+		entry->state = dce_failed;
+		break;
+	}
+
+	if ((entry->state == dce_failed) || (ttl == 0)) {
+		/* Serve the waiting fibrils, but do not keep the result */
+		dns_cache_entry_remove(entry);
+		return;
+	}
+
+	ttl = min(ttl, DNS_CACHE_TTL_MAX);
+
+	getuptime(&entry->expires);
+	entry->refresh = entry->expires;
+	/* TTL in microseconds could overflow suseconds_t */
+	entry->expires.tv_sec += ttl;
+	entry->refresh.tv_sec += ttl * DNS_CACHE_REFRESH_PCT / 100;
+}
+
+/** Copy result of a finished query out of an entry.
+ *
+ * Must be called with dns_cache_lock held.
+ */
+static errno_t dns_cache_entry_result(dns_cache_entry_t *entry,
+    dns_host_info_t *info)
+{
+	switch (entry->state) {
+	case dce_positive:
+		info->cname = str_dup(entry->cname);
+		if (info->cname == NULL)
+			return ENOMEM;
+
+		info->addr = entry->addr;
+		return EOK;
+	case dce_negative:
+		return ENOENT;
+	default:
+		return entry->rc;
+	}
+}
+
+/** Background refresh fibril. */
+static errno_t dns_cache_refresh_fibril(void *arg)
+{
+	dns_cache_entry_t *entry = (dns_cache_entry_t *) arg;
+	dns_host_info_t info;
+	uint32_t ttl;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "Refreshing '%s'", entry->name);
+
+	memset(&info, 0, sizeof(info));
+	errno_t rc = dns_name_query(entry->name, entry->qtype, &info, &ttl);
+
+	fibril_mutex_lock(&dns_cache_lock);
+
+	entry->refreshing = false;
+
+	/*
+	 * On failure keep the old answer until it expires, but do not try
+	 * again before the entry is used enough to be worth another query.
+	 */
+	if (entry->cached && ((rc == EOK) || (rc == ENOENT)))
+		dns_cache_entry_fill(entry, rc, &info, ttl);
+	else
+		entry->hits = 0;
+
+	dns_cache_entry_release(entry);
+	fibril_mutex_unlock(&dns_cache_lock);
+
+	free(info.cname);
+	return EOK;
+}
+
+/** Start background refresh of an entry if it is worth it.
+ *
+ * Must be called with dns_cache_lock held.
+ */
+static void dns_cache_entry_refresh(dns_cache_entry_t *entry,
+    struct timeval *now)
+{
+	if (entry->refreshing || (entry->hits < DNS_CACHE_REFRESH_HITS) ||
+	    tv_gt(&entry->refresh, now))
+		return;
+
+	fid_t fid = fibril_create(dns_cache_refresh_fibril, entry);
+	if (fid == 0)
+		return;
+
+	entry->refreshing = true;
+	entry->refcnt++;
+	dns_cache_stats.refreshes++;
+	fibril_add_ready(fid);
+}
+
+/** Look up host address, using the cache where possible.
+ *
+ * @param name  Host name
+ * @param qtype Query type (DTYPE_A or DTYPE_AAAA)
+ * @param info  Host information to fill in
+ *
+ * @return EOK on success
+ * @return ENOENT if there is no such address
+ * @return Other error code if the query failed
+ */
+errno_t dns_cache_query(const char *name, dns_qtype_t qtype,
+    dns_host_info_t *info)
+{
+	dns_cache_key_t key = {
+		.name = name,
+		.qtype = qtype
+	};
+	dns_cache_entry_t *entry = NULL;
+	struct timeval now;
+	errno_t rc;
+
+	fibril_mutex_lock(&dns_cache_lock);
+
+	getuptime(&now);
+
+	ht_link_t *link = hash_table_find(&dns_cache_table, &key);
+	if (link != NULL) {
+		entry = hash_table_get_inst(link, dns_cache_entry_t, htlink);
+
+		/*
+		 * An expired entry is dropped even if it is being refreshed.
+		 * The refresh only serves to avoid the wait before expiry,
+		 * it does not make the old answer valid for longer.
+		 */
+		if ((entry->state != dce_pending) &&
+		    tv_gteq(&now, &entry->expires)) {
+			dns_cache_entry_remove(entry);
+			dns_cache_stats.expired++;
+			entry = NULL;
+		}
+	}
+
+	if (entry != NULL) {
+		/* Move to the most recently used end */
+		list_remove(&entry->llru);
+		list_append(&entry->llru, &dns_cache_lru);
+
+		if (entry->state == dce_pending) {
+			dns_cache_stats.coalesced++;
+
+			entry->refcnt++;
+			while (entry->state == dce_pending)
+				fibril_condvar_wait(&dns_cache_cv, &dns_cache_lock);
+
+			rc = dns_cache_entry_result(entry, info);
+			dns_cache_entry_release(entry);
+			fibril_mutex_unlock(&dns_cache_lock);
+			return rc;
+		}
+
+		if (entry->state == dce_positive)
+			dns_cache_stats.hits++;
+		else
+			dns_cache_stats.neg_hits++;
+
+		entry->hits++;
+		dns_cache_entry_refresh(entry, &now);
+
+		rc = dns_cache_entry_result(entry, info);
+		fibril_mutex_unlock(&dns_cache_lock);
+		return rc;
+	}
+
+	dns_cache_stats.misses++;
+
+	if (dns_cache_count >= DNS_CACHE_MAX_ENTRIES)
+		dns_cache_evict();
+
+	entry = calloc(1, sizeof(dns_cache_entry_t));
+	if (entry == NULL) {
+		fibril_mutex_unlock(&dns_cache_lock);
+		return ENOMEM;
+	}
+
+	entry->name = str_dup(name);
+	if (entry->name == NULL) {
+		free(entry);
+		fibril_mutex_unlock(&dns_cache_lock);
+		return ENOMEM;
+	}
+
+	entry->qtype = qtype;
+	entry->state = dce_pending;
+	entry->refcnt = 1;
+	entry->cached = true;
+
+	hash_table_insert(&dns_cache_table, &entry->htlink);
+	list_append(&entry->llru, &dns_cache_lru);
+	dns_cache_count++;
+
+	fibril_mutex_unlock(&dns_cache_lock);
+
+	uint32_t ttl = 0;
+	rc = dns_name_query(name, qtype, info, &ttl);
+
+	fibril_mutex_lock(&dns_cache_lock);
+
+	/*
+	 * If the cache was flushed meanwhile, the entry is no longer in the
+	 * table and the answer only reaches the fibrils waiting for it.
+	 */
+	dns_cache_entry_fill(entry, rc, info, ttl);
+	dns_cache_entry_release(entry);
+	fibril_condvar_broadcast(&dns_cache_cv);
+
+	fibril_mutex_unlock(&dns_cache_lock);
+
+	return rc;
+}
+
+static bool dns_cache_flush_entry(ht_link_t *item, void *arg)
+{
+	/*
+	 * Entries with a query in flight are removed as well. The querying
+	 * fibril holds a reference, still serves the fibrils already waiting
+	 * for the answer, but no longer commits it to the cache. Later lookups
+	 * start a new query, i.e. ask the current name server.
+	 */
+	hash_table_remove_item(&dns_cache_table, item);
+	return true;
+}
+
+/** Discard all cached answers and answers to queries in flight. */
+void dns_cache_flush(void)
+{
+	fibril_mutex_lock(&dns_cache_lock);
+	hash_table_apply(&dns_cache_table, dns_cache_flush_entry, NULL);
+	fibril_mutex_unlock(&dns_cache_lock);
+}
+
+/** Get cache statistics. */
+void dns_cache_get_stats(dnsr_cache_stats_t *stats)
+{
+	fibril_mutex_lock(&dns_cache_lock);
+	*stats = dns_cache_stats;
+	stats->entries = dns_cache_count;
+	fibril_mutex_unlock(&dns_cache_lock);
+}
+
+/** @}
+ */
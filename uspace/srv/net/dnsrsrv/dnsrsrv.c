@@ -45,6 +45,7 @@
 #include <str.h>
 #include <task.h>
 
+#include "cache.h"
 #include "dns_msg.h"
 #include "dns_std.h"
 #include "query.h"
@@ -59,6 +60,12 @@ static errno_t dnsr_init(void)
 	errno_t rc;
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "dnsr_init()");
 
+	rc = dns_cache_init();
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed initializing cache.");
+		return EIO;
+	}
+
 	rc = transport_init();
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed initializing transport.");
@@ -205,9 +212,50 @@ static void dnsr_set_srvaddr_srv(dnsr_client_t *client, ipc_callid_t iid,
 		async_answer_0(iid, rc);
 	}
 	
+	/* Answers from the previous server are no longer relevant */
+	dns_cache_flush();
+	
+	async_answer_0(iid, rc);
+}
+
+static void dnsr_get_cache_stats_srv(dnsr_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "dnsr_get_cache_stats_srv()");
+	
+	ipc_callid_t callid;
+	size_t size;
+	if (!async_data_read_receive(&callid, &size)) {
+		async_answer_0(callid, EREFUSED);
+		async_answer_0(iid, EREFUSED);
+		return;
+	}
+	
+	if (size != sizeof(dnsr_cache_stats_t)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+	
+	dnsr_cache_stats_t stats;
+	dns_cache_get_stats(&stats);
+	
+	errno_t rc = async_data_read_finalize(callid, &stats, size);
+	if (rc != EOK)
+		async_answer_0(callid, rc);
+	
 	async_answer_0(iid, rc);
 }
 
+static void dnsr_cache_flush_srv(dnsr_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "dnsr_cache_flush_srv()");
+	
+	dns_cache_flush();
+	async_answer_0(iid, EOK);
+}
+
 static void dnsr_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 {
 	dnsr_client_t client;
@@ -238,6 +286,12 @@ static void dnsr_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case DNSR_SET_SRVADDR:
 			dnsr_set_srvaddr_srv(&client, callid, &call);
 			break;
+		case DNSR_GET_CACHE_STATS:
+			dnsr_get_cache_stats_srv(&client, callid, &call);
+			break;
+		case DNSR_CACHE_FLUSH:
+			dnsr_cache_flush_srv(&client, callid, &call);
+			break;
 		default:
 			async_answer_0(callid, EINVAL);
 		}
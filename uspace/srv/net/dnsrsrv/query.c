@@ -35,9 +35,11 @@
 
 #include <errno.h>
 #include <io/log.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include <str.h>
+#include "cache.h"
 #include "dns_msg.h"
 #include "dns_std.h"
 #include "dns_type.h"
@@ -46,8 +48,60 @@
 
 static uint16_t msg_id;
 
-static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
-    dns_host_info_t *info)
+/** Determine how long a negative answer may be cached.
+ *
+ * Following RFC 2308 this is the lesser of the TTL of the SOA record
+ * in the authority section and its MINIMUM field. Answers without
+ * an SOA record must not be cached.
+ *
+ * @param amsg Answer message
+ * @return Time to live in seconds
+ */
+static uint32_t dns_negative_ttl(dns_message_t *amsg)
+{
+	list_foreach(amsg->authority, msg, dns_rr_t, rr) {
+		if ((rr->rtype != DTYPE_SOA) || (rr->rclass != DC_IN))
+			continue;
+		
+		/* Skip MNAME and RNAME */
+		size_t off = rr->roff;
+		for (unsigned i = 0; i < 2; i++) {
+			char *name;
+			size_t eoff;
+			if (dns_name_decode(&amsg->pdu, off, &name, &eoff) != EOK)
+				return 0;
+			
+			free(name);
+			off = eoff;
+		}
+		
+		/* SERIAL, REFRESH, RETRY, EXPIRE, MINIMUM */
+		if ((off < rr->roff) || (off - rr->roff + 5 * sizeof(uint32_t) >
+		    rr->rdata_size))
+			return 0;
+		
+		uint32_t minimum = dns_uint32_t_decode(amsg->pdu.data + off +
+		    4 * sizeof(uint32_t), sizeof(uint32_t));
+		return min(rr->ttl, minimum);
+	}
+	
+	return 0;
+}
+
+/** Query name server for an address of a host.
+ *
+ * @param name  Host name
+ * @param qtype Query type (DTYPE_A or DTYPE_AAAA)
+ * @param info  Host information to fill in
+ * @param rttl  Place to store the time in seconds for which the answer
+ *              (positive or negative) may be cached
+ *
+ * @return EOK on success
+ * @return ENOENT if the name server answered that no such address exists
+ * @return Other error code if the query failed
+ */
+errno_t dns_name_query(const char *name, dns_qtype_t qtype,
+    dns_host_info_t *info, uint32_t *rttl)
 {
 	/* Start with the caller-provided name */
 	char *sname = str_dup(name);
@@ -98,6 +152,20 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 		return rc;
 	}
 	
+	if ((amsg->rcode != RC_OK) && (amsg->rcode != RC_NAME_ERR)) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "'%s' query failed, rcode %d",
+		    sname, amsg->rcode);
+		
+		dns_message_destroy(msg);
+		dns_message_destroy(amsg);
+		free(sname);
+		
+		return EIO;
+	}
+	
+	/* TTL of the answer is the lowest TTL in the CNAME chain */
+	uint32_t ttl = UINT32_MAX;
+	
 	list_foreach(amsg->answer, msg, dns_rr_t, rr) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - '%s' %u/%u, dsize %zu",
 		    rr->name, rr->rtype, rr->rclass, rr->rdata_size);
@@ -129,6 +197,7 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 			/* Continue looking for the more canonical name */
 			free(sname);
 			sname = cname;
+			ttl = min(ttl, rr->ttl);
 		}
 		
 		if ((qtype == DTYPE_A) && (rr->rtype == DTYPE_A) &&
@@ -146,6 +215,7 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 			
 			inet_addr_set(dns_uint32_t_decode(rr->rdata, rr->rdata_size),
 			    &info->addr);
+			*rttl = min(ttl, rr->ttl);
 			
 			dns_message_destroy(msg);
 			dns_message_destroy(amsg);
@@ -171,6 +241,7 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 			dns_addr128_t_decode(rr->rdata, rr->rdata_size, addr);
 			
 			inet_addr_set6(addr, &info->addr);
+			*rttl = min(ttl, rr->ttl);
 			
 			dns_message_destroy(msg);
 			dns_message_destroy(amsg);
@@ -182,11 +253,13 @@ static errno_t dns_name_query(const char *name, dns_qtype_t qtype,
 	
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "'%s' not resolved, fail", sname);
 	
+	*rttl = dns_negative_ttl(amsg);
+	
 	dns_message_destroy(msg);
 	dns_message_destroy(amsg);
 	free(sname);
 	
-	return EIO;
+	return ENOENT;
 }
 
 errno_t dns_name2host(const char *name, dns_host_info_t **rinfo, ip_ver_t ver)
@@ -199,22 +272,26 @@ errno_t dns_name2host(const char *name, dns_host_info_t **rinfo, ip_ver_t ver)
 	
 	switch (ver) {
 	case ip_any:
-		rc = dns_name_query(name, DTYPE_AAAA, info);
+		rc = dns_cache_query(name, DTYPE_AAAA, info);
 		
 		if (rc != EOK)
-			rc = dns_name_query(name, DTYPE_A, info);
+			rc = dns_cache_query(name, DTYPE_A, info);
 		
 		break;
 	case ip_v4:
-		rc = dns_name_query(name, DTYPE_A, info);
+		rc = dns_cache_query(name, DTYPE_A, info);
 		break;
 	case ip_v6:
-		rc = dns_name_query(name, DTYPE_AAAA, info);
+		rc = dns_cache_query(name, DTYPE_AAAA, info);
 		break;
 	default:
 		rc = EINVAL;
 	}
 	
+	/* Clients have always seen a failed resolution as EIO */
+	if (rc == ENOENT)
+		rc = EIO;
+	
 	if (rc == EOK)
 		*rinfo = info;
 	else
@@ -39,6 +39,8 @@
 #include <inet/addr.h>
 #include "dns_type.h"
 
+extern errno_t dns_name_query(const char *, dns_qtype_t, dns_host_info_t *,
+    uint32_t *);
 extern errno_t dns_name2host(const char *, dns_host_info_t **, ip_ver_t);
 extern void dns_hostinfo_destroy(dns_host_info_t *);
 
@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <async.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include <str.h>
+
+#include "../cache.h"
+#include "../query.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(cache);
+
+/*
+ * Stub name server
+ *
+ * Replaces dns_name_query() so that the cache can be tested without
+ * a network. Two name servers are simulated, each of them answering
+ * with a different address, so that it is possible to tell which one
+ * an answer came from. Queries can be held back to test what happens
+ * to queries in flight.
+ */
+
+static FIBRIL_MUTEX_INITIALIZE(stub_lock);
+static FIBRIL_CONDVAR_INITIALIZE(stub_cv);
+/** Current name server (0 or 1) */
+static unsigned stub_server;
+/** Hold queries back until cleared */
+static bool stub_hold;
+/** Number of queries held back */
+static unsigned stub_held;
+/** Number of queries received */
+static unsigned stub_queries;
+/** Time to live of the answers */
+static uint32_t stub_ttl;
+
+errno_t dns_name_query(const char *name, dns_qtype_t qtype,
+    dns_host_info_t *info, uint32_t *ttl)
+{
+	fibril_mutex_lock(&stub_lock);
+
+	/* The server the query was sent to */
+	unsigned server = stub_server;
+	stub_queries++;
+
+	stub_held++;
+	fibril_condvar_broadcast(&stub_cv);
+	while (stub_hold)
+		fibril_condvar_wait(&stub_cv, &stub_lock);
+	stub_held--;
+
+	*ttl = stub_ttl;
+	fibril_mutex_unlock(&stub_lock);
+
+	if (qtype != DTYPE_A || str_cmp(name, "nxdomain.test") == 0)
+		return ENOENT;
+	if (str_cmp(name, "unreachable.test") == 0)
+		return EIO;
+
+	info->cname = str_dup(name);
+	if (info->cname == NULL)
+		return ENOMEM;
+
+	inet_addr(&info->addr, 10, 0, 0, server + 1);
+	return EOK;
+}
+
+/** Wait until a query is held back by the stub name server */
+static void stub_wait_held(unsigned count)
+{
+	fibril_mutex_lock(&stub_lock);
+	while (stub_held < count)
+		fibril_condvar_wait(&stub_cv, &stub_lock);
+	fibril_mutex_unlock(&stub_lock);
+}
+
+/** Let queries held back by the stub name server proceed */
+static void stub_release(void)
+{
+	fibril_mutex_lock(&stub_lock);
+	stub_hold = false;
+	fibril_condvar_broadcast(&stub_cv);
+	fibril_mutex_unlock(&stub_lock);
+}
+
+/** Lookup running in a separate fibril */
+typedef struct {
+	const char *name;
+	dns_host_info_t info;
+	errno_t rc;
+	bool done;
+} test_lookup_t;
+
+static errno_t test_lookup_fibril(void *arg)
+{
+	test_lookup_t *lookup = (test_lookup_t *) arg;
+
+	lookup->rc = dns_cache_query(lookup->name, DTYPE_A, &lookup->info);
+
+	fibril_mutex_lock(&stub_lock);
+	lookup->done = true;
+	fibril_condvar_broadcast(&stub_cv);
+	fibril_mutex_unlock(&stub_lock);
+	return EOK;
+}
+
+static void test_lookup_start(test_lookup_t *lookup, const char *name)
+{
+	lookup->name = name;
+	lookup->info.cname = NULL;
+	lookup->done = false;
+
+	fid_t fid = fibril_create(test_lookup_fibril, lookup);
+	PCUT_ASSERT_TRUE(fid != 0);
+	fibril_add_ready(fid);
+}
+
+static void test_lookup_wait(test_lookup_t *lookup)
+{
+	fibril_mutex_lock(&stub_lock);
+	while (!lookup->done)
+		fibril_condvar_wait(&stub_cv, &stub_lock);
+	fibril_mutex_unlock(&stub_lock);
+}
+
+/** Look up a name and check which name server the answer came from */
+static void test_lookup_check(const char *name, unsigned server)
+{
+	dns_host_info_t info;
+	inet_addr_t addr;
+	errno_t rc;
+
+	info.cname = NULL;
+	rc = dns_cache_query(name, DTYPE_A, &info);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_STR_EQUALS(name, info.cname);
+
+	inet_addr(&addr, 10, 0, 0, server + 1);
+	PCUT_ASSERT_TRUE(inet_addr_compare(&addr, &info.addr));
+	free(info.cname);
+}
+
+PCUT_TEST_BEFORE
+{
+	static bool initialized = false;
+
+	if (!initialized) {
+		PCUT_ASSERT_ERRNO_VAL(EOK, dns_cache_init());
+		initialized = true;
+	}
+
+	dns_cache_flush();
+
+	stub_server = 0;
+	stub_hold = false;
+	stub_held = 0;
+	stub_queries = 0;
+	stub_ttl = 60;
+}
+
+/** Positive answer is cached */
+PCUT_TEST(positive)
+{
+	test_lookup_check("host.test", 0);
+	test_lookup_check("host.test", 0);
+	PCUT_ASSERT_INT_EQUALS(1, stub_queries);
+}
+
+/** Negative answer is cached */
+PCUT_TEST(negative)
+{
+	dns_host_info_t info;
+	errno_t rc;
+
+	info.cname = NULL;
+	rc = dns_cache_query("nxdomain.test", DTYPE_A, &info);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+	rc = dns_cache_query("nxdomain.test", DTYPE_A, &info);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+	PCUT_ASSERT_INT_EQUALS(1, stub_queries);
+
+	/* Different query type is a different entry */
+	rc = dns_cache_query("host.test", DTYPE_AAAA, &info);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+	PCUT_ASSERT_INT_EQUALS(2, stub_queries);
+}
+
+/** Failed query and answer with zero TTL are not cached */
+PCUT_TEST(not_cached)
+{
+	dns_host_info_t info;
+	errno_t rc;
+
+	info.cname = NULL;
+	rc = dns_cache_query("unreachable.test", DTYPE_A, &info);
+	PCUT_ASSERT_ERRNO_VAL(EIO, rc);
+	rc = dns_cache_query("unreachable.test", DTYPE_A, &info);
+	PCUT_ASSERT_ERRNO_VAL(EIO, rc);
+	PCUT_ASSERT_INT_EQUALS(2, stub_queries);
+
+	stub_ttl = 0;
+	test_lookup_check("host.test", 0);
+	test_lookup_check("host.test", 0);
+	PCUT_ASSERT_INT_EQUALS(4, stub_queries);
+}
+
+/** Flush discards cached answers */
+PCUT_TEST(flush)
+{
+	test_lookup_check("host.test", 0);
+
+	stub_server = 1;
+	test_lookup_check("host.test", 0);
+
+	dns_cache_flush();
+	test_lookup_check("host.test", 1);
+	PCUT_ASSERT_INT_EQUALS(2, stub_queries);
+}
+
+/** Identical lookups share one query */
+PCUT_TEST(coalesce)
+{
+	test_lookup_t l1, l2;
+	dnsr_cache_stats_t stats;
+	uint64_t coalesced;
+
+	dns_cache_get_stats(&stats);
+	coalesced = stats.coalesced;
+
+	stub_hold = true;
+	test_lookup_start(&l1, "host.test");
+	stub_wait_held(1);
+	test_lookup_start(&l2, "host.test");
+
+	/* Let the second lookup find the query in flight */
+	do {
+		fibril_yield();
+		dns_cache_get_stats(&stats);
+	} while (stats.coalesced == coalesced);
+
+	stub_release();
+	test_lookup_wait(&l1);
+	test_lookup_wait(&l2);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, l1.rc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, l2.rc);
+	PCUT_ASSERT_INT_EQUALS(1, stub_queries);
+
+	free(l1.info.cname);
+	free(l2.info.cname);
+}
+
+/** Answer to a query in flight during flush is not cached */
+PCUT_TEST(flush_in_flight)
+{
+	test_lookup_t lookup;
+
+	stub_hold = true;
+	test_lookup_start(&lookup, "host.test");
+	stub_wait_held(1);
+
+	/* Name server changes while the query is in flight */
+	stub_server = 1;
+	dns_cache_flush();
+
+	stub_release();
+	test_lookup_wait(&lookup);
+
+	/* The lookup itself still gets the answer */
+	PCUT_ASSERT_ERRNO_VAL(EOK, lookup.rc);
+	free(lookup.info.cname);
+
+	/* But the next lookup asks the new name server */
+	test_lookup_check("host.test", 1);
+	PCUT_ASSERT_INT_EQUALS(2, stub_queries);
+}
+
+/** Lookup started after flush does not join a query in flight */
+PCUT_TEST(flush_in_flight_new_lookup)
+{
+	test_lookup_t l1, l2;
+
+	stub_hold = true;
+	test_lookup_start(&l1, "host.test");
+	stub_wait_held(1);
+
+	stub_server = 1;
+	dns_cache_flush();
+
+	test_lookup_start(&l2, "host.test");
+	stub_wait_held(2);
+
+	stub_release();
+	test_lookup_wait(&l1);
+	test_lookup_wait(&l2);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, l1.rc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, l2.rc);
+	PCUT_ASSERT_INT_EQUALS(2, stub_queries);
+	free(l1.info.cname);
+	free(l2.info.cname);
+
+	/* The answer of the new name server is the one kept */
+	test_lookup_check("host.test", 1);
+	PCUT_ASSERT_INT_EQUALS(2, stub_queries);
+}
+
+/** Expired answer is not served while its refresh is in flight */
+PCUT_TEST(expired_while_refreshing)
+{
+	test_lookup_t lookup;
+
+	stub_ttl = 1;
+	test_lookup_check("host.test", 0);
+
+	/* Used often enough, the next lookup starts a refresh */
+	stub_hold = true;
+	test_lookup_check("host.test", 0);
+	test_lookup_check("host.test", 0);
+	stub_wait_held(1);
+
+	/* Let the answer expire with the refresh still held back */
+	async_usleep(1100000);
+
+	stub_server = 1;
+	test_lookup_start(&lookup, "host.test");
+
+	/* The lookup must send a query rather than get the old answer */
+	fibril_mutex_lock(&stub_lock);
+	while (!lookup.done && stub_held < 2)
+		fibril_condvar_wait(&stub_cv, &stub_lock);
+	fibril_mutex_unlock(&stub_lock);
+	PCUT_ASSERT_FALSE(lookup.done);
+
+	stub_release();
+	test_lookup_wait(&lookup);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, lookup.rc);
+	PCUT_ASSERT_INT_EQUALS(3, stub_queries);
+	free(lookup.info.cname);
+
+	/* The late refresh does not bring the old answer back */
+	stub_ttl = 60;
+	test_lookup_check("host.test", 1);
+}
+
+PCUT_EXPORT(cache);
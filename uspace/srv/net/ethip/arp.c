@@ -46,9 +46,6 @@
 #include "pdu.h"
 #include "std.h"
 
-/** Time to wait for ARP reply in microseconds */
-#define ARP_REQUEST_TIMEOUT (3 * 1000 * 1000)
-
 static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet);
 
 void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
@@ -63,6 +60,12 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ARP PDU decoded, opcode=%d, tpa=%x",
 	    packet.opcode, packet.target_proto_addr);
 	
+	/*
+	 * Refresh the sender's entry if we have one, even if the packet
+	 * is not addressed to us (e.g. gratuitous ARP).
+	 */
+	(void) atrans_update(packet.sender_proto_addr, packet.sender_hw_addr);
+	
 	inet_addr_t addr;
 	inet_addr_set(packet.target_proto_addr, &addr);
 	
@@ -77,6 +80,10 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 	
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Request/reply to my address");
 	
+	/* Gratuitous ARP for our own address */
+	if (packet.sender_proto_addr == laddr_v4)
+		return;
+	
 	(void) atrans_add(packet.sender_proto_addr,
 	    packet.sender_hw_addr);
 	
@@ -93,32 +100,68 @@ void arp_received(ethip_nic_t *nic, eth_frame_t *frame)
 	}
 }
 
-errno_t arp_translate(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
-    addr48_t mac_addr)
+/** Send IPv4 frame, resolving the destination link address.
+ *
+ * The frame is queued if the destination address is not resolved yet.
+ *
+ * @param nic      NIC
+ * @param src_addr Source IPv4 address
+ * @param ip_addr  Destination IPv4 address
+ * @param frame    Frame with all but the destination address filled in
+ */
+errno_t arp_send_frame(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
+    eth_frame_t *frame)
 {
 	/* Broadcast address */
 	if (ip_addr == addr32_broadcast_all_hosts) {
-		addr48(addr48_broadcast, mac_addr);
-		return EOK;
+		addr48(addr48_broadcast, frame->dest);
+		
+		void *data;
+		size_t size;
+		errno_t rc = eth_pdu_encode(frame, &data, &size);
+		if (rc != EOK)
+			return rc;
+		
+		rc = ethip_nic_send(nic, data, size);
+		free(data);
+		return rc;
 	}
-
-	errno_t rc = atrans_lookup(ip_addr, mac_addr);
-	if (rc == EOK)
-		return EOK;
 	
+	return atrans_send(nic, src_addr, ip_addr, frame);
+}
+
+/** Send ARP request.
+ *
+ * @param nic      NIC
+ * @param src_addr Source IPv4 address
+ * @param ip_addr  IPv4 address to resolve
+ * @param mac_addr Broadcast address or the last known address of the
+ *                 neighbor when reconfirming it
+ */
+errno_t arp_send_request(ethip_nic_t *nic, addr32_t src_addr,
+    addr32_t ip_addr, const addr48_t mac_addr)
+{
 	arp_eth_packet_t packet;
 	
 	packet.opcode = aop_request;
 	addr48(nic->mac_addr, packet.sender_hw_addr);
 	packet.sender_proto_addr = src_addr;
-	addr48(addr48_broadcast, packet.target_hw_addr);
+	addr48(mac_addr, packet.target_hw_addr);
 	packet.target_proto_addr = ip_addr;
 	
-	rc = arp_send_packet(nic, &packet);
-	if (rc != EOK)
-		return rc;
-	
-	return atrans_lookup_timeout(ip_addr, ARP_REQUEST_TIMEOUT, mac_addr);
+	return arp_send_packet(nic, &packet);
+}
+
+/** Announce our address with a gratuitous ARP request.
+ *
+ * Neighbors that have an entry for @a addr refresh it.
+ *
+ * @param nic  NIC
+ * @param addr Our IPv4 address
+ */
+errno_t arp_announce(ethip_nic_t *nic, addr32_t addr)
+{
+	return arp_send_request(nic, addr, addr, addr48_broadcast);
 }
 
 static errno_t arp_send_packet(ethip_nic_t *nic, arp_eth_packet_t *packet)
@@ -34,131 +34,478 @@
  * @brief
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <inet/iplink_srv.h>
+#include <io/log.h>
+#include <mem.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
+#include "arp.h"
 #include "atrans.h"
 #include "ethip.h"
+#include "ethip_nic.h"
+#include "pdu.h"
 
-/** Address translation list (of ethip_atrans_t) */
-static FIBRIL_MUTEX_INITIALIZE(atrans_list_lock);
-static LIST_INITIALIZE(atrans_list);
-static FIBRIL_CONDVAR_INITIALIZE(atrans_cv);
+/** Interval of the aging timer and of repeated requests in microseconds */
+#define ATRANS_TICK  (1000 * 1000)
 
-static ethip_atrans_t *atrans_find(addr32_t ip_addr)
+/** Time after which a reachable entry becomes stale in microseconds */
+#define ATRANS_REACHABLE_TIME  (30 * 1000 * 1000)
+
+/** Time after which an unused stale entry is discarded in microseconds */
+#define ATRANS_STALE_TIME  (10 * 60 * 1000 * 1000)
+
+/** Number of requests sent before giving up resolution or probing */
+#define ATRANS_MAX_REQUESTS  3
+
+/** Maximum number of frames queued per unresolved address */
+#define ATRANS_QUEUE_MAX  3
+
+/** Request to be sent once the table lock is released */
+typedef struct {
+	link_t req_list;
+	ethip_nic_t *nic;
+	addr32_t src_addr;
+	addr32_t ip_addr;
+	/** Broadcast for resolution, neighbor's address for probing */
+	addr48_t mac_addr;
+} atrans_req_t;
+
+/** Address translation table (of ethip_atrans_t) */
+static FIBRIL_MUTEX_INITIALIZE(atrans_lock);
+static hash_table_t atrans_table;
+static fibril_timer_t *atrans_timer;
+
+static void atrans_timer_fun(void *);
+
+static void atrans_pkt_list_free(list_t *pkts)
 {
-	list_foreach(atrans_list, atrans_list, ethip_atrans_t, atrans) {
-		if (atrans->ip_addr == ip_addr)
-			return atrans;
+	list_foreach_safe(*pkts, cur, next) {
+		ethip_atrans_pkt_t *pkt = list_get_instance(cur,
+		    ethip_atrans_pkt_t, queue);
+
+		list_remove(cur);
+		free(pkt->frame.data);
+		free(pkt);
 	}
+}
 
-	return NULL;
+static size_t atrans_ht_hash(const ht_link_t *item)
+{
+	ethip_atrans_t *atrans = hash_table_get_inst(item, ethip_atrans_t,
+	    atrans_ht);
+	return atrans->ip_addr;
 }
 
-errno_t atrans_add(addr32_t ip_addr, addr48_t mac_addr)
+static size_t atrans_ht_key_hash(void *key)
 {
-	ethip_atrans_t *atrans;
-	ethip_atrans_t *prev;
+	return *(addr32_t *) key;
+}
 
-	atrans = calloc(1, sizeof(ethip_atrans_t));
-	if (atrans == NULL)
-		return ENOMEM;
+static bool atrans_ht_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	ethip_atrans_t *a1 = hash_table_get_inst(item1, ethip_atrans_t,
+	    atrans_ht);
+	ethip_atrans_t *a2 = hash_table_get_inst(item2, ethip_atrans_t,
+	    atrans_ht);
+	return a1->ip_addr == a2->ip_addr;
+}
 
-	atrans->ip_addr = ip_addr;
-	addr48(mac_addr, atrans->mac_addr);
+static bool atrans_ht_key_equal(void *key, const ht_link_t *item)
+{
+	ethip_atrans_t *atrans = hash_table_get_inst(item, ethip_atrans_t,
+	    atrans_ht);
+	return atrans->ip_addr == *(addr32_t *) key;
+}
 
-	fibril_mutex_lock(&atrans_list_lock);
-	prev = atrans_find(ip_addr);
-	if (prev != NULL) {
-		list_remove(&prev->atrans_list);
-		free(prev);
+static void atrans_ht_remove_callback(ht_link_t *item)
+{
+	ethip_atrans_t *atrans = hash_table_get_inst(item, ethip_atrans_t,
+	    atrans_ht);
+
+	if (atrans->queue_len > 0) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Dropping %zu frames queued for "
+		    "0x%" PRIx32, atrans->queue_len, atrans->ip_addr);
 	}
 
-	list_append(&atrans->atrans_list, &atrans_list);
-	fibril_mutex_unlock(&atrans_list_lock);
-	fibril_condvar_broadcast(&atrans_cv);
+	atrans_pkt_list_free(&atrans->queue);
+	free(atrans);
+}
+
+static hash_table_ops_t atrans_ht_ops = {
+	.hash = atrans_ht_hash,
+	.key_hash = atrans_ht_key_hash,
+	.equal = atrans_ht_equal,
+	.key_equal = atrans_ht_key_equal,
+	.remove_callback = atrans_ht_remove_callback
+};
+
+/** Initialize address translation table.
+ *
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t atrans_init(void)
+{
+	if (!hash_table_create(&atrans_table, 0, 0, &atrans_ht_ops))
+		return ENOMEM;
+
+	atrans_timer = fibril_timer_create(NULL);
+	if (atrans_timer == NULL) {
+		hash_table_destroy(&atrans_table);
+		return ENOMEM;
+	}
 
+	fibril_timer_set(atrans_timer, ATRANS_TICK, atrans_timer_fun, NULL);
 	return EOK;
 }
 
-errno_t atrans_remove(addr32_t ip_addr)
+static ethip_atrans_t *atrans_find(addr32_t ip_addr)
+{
+	ht_link_t *link = hash_table_find(&atrans_table, &ip_addr);
+	if (link == NULL)
+		return NULL;
+
+	return hash_table_get_inst(link, ethip_atrans_t, atrans_ht);
+}
+
+static ethip_atrans_t *atrans_new(addr32_t ip_addr,
+    ethip_atrans_state_t state)
+{
+	ethip_atrans_t *atrans = calloc(1, sizeof(ethip_atrans_t));
+	if (atrans == NULL)
+		return NULL;
+
+	atrans->ip_addr = ip_addr;
+	atrans->state = state;
+	getuptime(&atrans->since);
+	list_initialize(&atrans->queue);
+
+	hash_table_insert(&atrans_table, &atrans->atrans_ht);
+	return atrans;
+}
+
+static errno_t atrans_send_frame(ethip_nic_t *nic, eth_frame_t *frame)
+{
+	void *data;
+	size_t size;
+
+	errno_t rc = eth_pdu_encode(frame, &data, &size);
+	if (rc != EOK)
+		return rc;
+
+	rc = ethip_nic_send(nic, data, size);
+	free(data);
+
+	return rc;
+}
+
+/** Send frames that were waiting for the address to be resolved. */
+static void atrans_pkt_list_send(list_t *pkts, ethip_nic_t *nic,
+    addr48_t mac_addr)
+{
+	list_foreach(*pkts, queue, ethip_atrans_pkt_t, pkt) {
+		addr48(mac_addr, pkt->frame.dest);
+		(void) atrans_send_frame(nic, &pkt->frame);
+	}
+
+	atrans_pkt_list_free(pkts);
+}
+
+/** Set link address of an entry.
+ *
+ * @param ip_addr   IPv4 address
+ * @param mac_addr  MAC address
+ * @param confirmed The mapping was confirmed by the neighbor (as opposed
+ *                  to overheard in a packet not addressed to us)
+ */
+static errno_t atrans_set(addr32_t ip_addr, addr48_t mac_addr,
+    bool confirmed)
 {
 	ethip_atrans_t *atrans;
+	ethip_nic_t *nic = NULL;
+	list_t pkts;
 
-	fibril_mutex_lock(&atrans_list_lock);
+	list_initialize(&pkts);
+
+	fibril_mutex_lock(&atrans_lock);
 	atrans = atrans_find(ip_addr);
 	if (atrans == NULL) {
-		fibril_mutex_unlock(&atrans_list_lock);
-		return ENOENT;
+		if (!confirmed) {
+			/* Do not create entries for all hosts we overhear */
+			fibril_mutex_unlock(&atrans_lock);
+			return EOK;
+		}
+
+		atrans = atrans_new(ip_addr, ats_reachable);
+		if (atrans == NULL) {
+			fibril_mutex_unlock(&atrans_lock);
+			return ENOMEM;
+		}
+
+		addr48(mac_addr, atrans->mac_addr);
+		fibril_mutex_unlock(&atrans_lock);
+		return EOK;
 	}
 
-	list_remove(&atrans->atrans_list);
-	fibril_mutex_unlock(&atrans_list_lock);
-	free(atrans);
+	if (confirmed || atrans->state == ats_incomplete) {
+		atrans->state = ats_reachable;
+		getuptime(&atrans->since);
+		atrans->requests = 0;
+	} else if (addr48_compare(atrans->mac_addr, mac_addr) == 0) {
+		/* Address changed, needs to be confirmed before it is trusted */
+		atrans->state = ats_stale;
+		getuptime(&atrans->since);
+		atrans->requests = 0;
+	}
+
+	addr48(mac_addr, atrans->mac_addr);
+
+	/* Take over frames waiting for resolution */
+	if (atrans->queue_len > 0) {
+		list_concat(&pkts, &atrans->queue);
+		atrans->queue_len = 0;
+		nic = atrans->nic;
+	}
+
+	fibril_mutex_unlock(&atrans_lock);
+
+	if (nic != NULL)
+		atrans_pkt_list_send(&pkts, nic, mac_addr);
 
 	return EOK;
 }
 
-static errno_t atrans_lookup_locked(addr32_t ip_addr, addr48_t mac_addr)
+/** Add address translation confirmed by the neighbor.
+ *
+ * @param ip_addr  IPv4 address
+ * @param mac_addr MAC address
+ */
+errno_t atrans_add(addr32_t ip_addr, addr48_t mac_addr)
 {
-	ethip_atrans_t *atrans = atrans_find(ip_addr);
-	if (atrans == NULL)
-		return ENOENT;
+	return atrans_set(ip_addr, mac_addr, true);
+}
 
-	addr48(atrans->mac_addr, mac_addr);
-	return EOK;
+/** Update existing address translation.
+ *
+ * Used for mappings learned from packets not addressed to us, such
+ * as gratuitous ARP. Entries are not created, only refreshed.
+ *
+ * @param ip_addr  IPv4 address
+ * @param mac_addr MAC address
+ */
+errno_t atrans_update(addr32_t ip_addr, addr48_t mac_addr)
+{
+	return atrans_set(ip_addr, mac_addr, false);
+}
+
+errno_t atrans_remove(addr32_t ip_addr)
+{
+	fibril_mutex_lock(&atrans_lock);
+	size_t removed = hash_table_remove(&atrans_table, &ip_addr);
+	fibril_mutex_unlock(&atrans_lock);
+
+	return (removed > 0) ? EOK : ENOENT;
 }
 
 errno_t atrans_lookup(addr32_t ip_addr, addr48_t mac_addr)
 {
-	errno_t rc;
+	errno_t rc = ENOENT;
 
-	fibril_mutex_lock(&atrans_list_lock);
-	rc = atrans_lookup_locked(ip_addr, mac_addr);
-	fibril_mutex_unlock(&atrans_list_lock);
+	fibril_mutex_lock(&atrans_lock);
+	ethip_atrans_t *atrans = atrans_find(ip_addr);
+	if (atrans != NULL && atrans->state != ats_incomplete) {
+		addr48(atrans->mac_addr, mac_addr);
+		rc = EOK;
+	}
+	fibril_mutex_unlock(&atrans_lock);
 
 	return rc;
 }
 
-static void atrans_lookup_timeout_handler(void *arg)
+/** Send frame to IPv4 address.
+ *
+ * If the link address of @a ip_addr is known, the frame is sent right
+ * away. Otherwise a copy of the frame is queued and sent once the
+ * address is resolved. The caller never waits for resolution.
+ *
+ * @param nic      NIC to send the frame through
+ * @param src_addr Source IPv4 address (used in ARP requests)
+ * @param ip_addr  Destination IPv4 address
+ * @param frame    Frame with all but the destination filled in
+ *
+ * @return EOK if the frame was sent or queued, an error code otherwise
+ */
+errno_t atrans_send(ethip_nic_t *nic, addr32_t src_addr, addr32_t ip_addr,
+    eth_frame_t *frame)
 {
-	bool *timedout = (bool *)arg;
+	ethip_atrans_t *atrans;
+	ethip_atrans_pkt_t *pkt;
+	bool resolve = false;
+	bool probe = false;
+	addr48_t probe_mac;
+
+	fibril_mutex_lock(&atrans_lock);
+
+	atrans = atrans_find(ip_addr);
+	if (atrans != NULL && atrans->state != ats_incomplete) {
+		addr48(atrans->mac_addr, frame->dest);
 
-	fibril_mutex_lock(&atrans_list_lock);
-	*timedout = true;
-	fibril_mutex_unlock(&atrans_list_lock);
-	fibril_condvar_broadcast(&atrans_cv);
+		if (atrans->state == ats_stale) {
+			/* Reconfirm the address while still using it */
+			atrans->state = ats_probe;
+			getuptime(&atrans->since);
+			atrans->requests = 1;
+			atrans->nic = nic;
+			atrans->src_addr = src_addr;
+			addr48(atrans->mac_addr, probe_mac);
+			probe = true;
+		}
+
+		fibril_mutex_unlock(&atrans_lock);
+
+		if (probe)
+			(void) arp_send_request(nic, src_addr, ip_addr, probe_mac);
+
+		return atrans_send_frame(nic, frame);
+	}
+
+	pkt = calloc(1, sizeof(ethip_atrans_pkt_t));
+	if (pkt == NULL) {
+		fibril_mutex_unlock(&atrans_lock);
+		return ENOMEM;
+	}
+
+	pkt->frame = *frame;
+	pkt->frame.data = malloc(frame->size);
+	if (pkt->frame.data == NULL) {
+		free(pkt);
+		fibril_mutex_unlock(&atrans_lock);
+		return ENOMEM;
+	}
+
+	memcpy(pkt->frame.data, frame->data, frame->size);
+
+	if (atrans == NULL) {
+		atrans = atrans_new(ip_addr, ats_incomplete);
+		if (atrans == NULL) {
+			free(pkt->frame.data);
+			free(pkt);
+			fibril_mutex_unlock(&atrans_lock);
+			return ENOMEM;
+		}
+
+		atrans->nic = nic;
+		atrans->src_addr = src_addr;
+		atrans->requests = 1;
+		resolve = true;
+	}
+
+	if (atrans->queue_len >= ATRANS_QUEUE_MAX) {
+		/* Drop the oldest frame */
+		ethip_atrans_pkt_t *old = list_get_instance(
+		    list_first(&atrans->queue), ethip_atrans_pkt_t, queue);
+		list_remove(&old->queue);
+		free(old->frame.data);
+		free(old);
+		atrans->queue_len--;
+	}
+
+	list_append(&pkt->queue, &atrans->queue);
+	atrans->queue_len++;
+
+	fibril_mutex_unlock(&atrans_lock);
+
+	if (resolve) {
+		(void) arp_send_request(nic, src_addr, ip_addr,
+		    addr48_broadcast);
+	}
+
+	return EOK;
 }
 
-errno_t atrans_lookup_timeout(addr32_t ip_addr, suseconds_t timeout,
-    addr48_t mac_addr)
+/** Age one address translation entry.
+ *
+ * @param item Entry
+ * @param arg  List of requests to send (of atrans_req_t)
+ */
+static bool atrans_age(ht_link_t *item, void *arg)
 {
-	fibril_timer_t *t;
-	bool timedout;
-	errno_t rc;
+	ethip_atrans_t *atrans = hash_table_get_inst(item, ethip_atrans_t,
+	    atrans_ht);
+	list_t *reqs = (list_t *) arg;
+	struct timeval now;
+	atrans_req_t *req;
 
-	t = fibril_timer_create(NULL);
-	if (t == NULL)
-		return ENOMEM;
+	getuptime(&now);
+	suseconds_t age = tv_sub_diff(&now, &atrans->since);
+
+	switch (atrans->state) {
+	case ats_incomplete:
+	case ats_probe:
+		if (atrans->requests >= ATRANS_MAX_REQUESTS) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "No ARP reply from 0x%"
+			    PRIx32, atrans->ip_addr);
+			hash_table_remove_item(&atrans_table, item);
+			break;
+		}
 
-	timedout = false;
-	fibril_timer_set(t, timeout, atrans_lookup_timeout_handler, &timedout);
+		req = calloc(1, sizeof(atrans_req_t));
+		if (req == NULL)
+			break;
 
-	fibril_mutex_lock(&atrans_list_lock);
+		req->nic = atrans->nic;
+		req->src_addr = atrans->src_addr;
+		req->ip_addr = atrans->ip_addr;
+		if (atrans->state == ats_incomplete)
+			addr48(addr48_broadcast, req->mac_addr);
+		else
+			addr48(atrans->mac_addr, req->mac_addr);
 
-	while ((rc = atrans_lookup_locked(ip_addr, mac_addr)) == ENOENT &&
-	    !timedout) {
-		fibril_condvar_wait(&atrans_cv, &atrans_list_lock);
+		list_append(&req->req_list, reqs);
+		atrans->requests++;
+		break;
+	case ats_reachable:
+		if (age >= ATRANS_REACHABLE_TIME) {
+			atrans->state = ats_stale;
+			atrans->since = now;
+		}
+		break;
+	case ats_stale:
+		if (age >= ATRANS_STALE_TIME)
+			hash_table_remove_item(&atrans_table, item);
+		break;
 	}
 
-	fibril_mutex_unlock(&atrans_list_lock);
-	(void) fibril_timer_clear(t);
-	fibril_timer_destroy(t);
+	return true;
+}
 
-	return rc;
+/** Aging timer handler. */
+static void atrans_timer_fun(void *arg)
+{
+	list_t reqs;
+
+	list_initialize(&reqs);
+
+	fibril_mutex_lock(&atrans_lock);
+	hash_table_apply(&atrans_table, atrans_age, &reqs);
+	fibril_mutex_unlock(&atrans_lock);
+
+	list_foreach_safe(reqs, cur, next) {
+		atrans_req_t *req = list_get_instance(cur, atrans_req_t,
+		    req_list);
+
+		(void) arp_send_request(req->nic, req->src_addr, req->ip_addr,
+		    req->mac_addr);
+
+		list_remove(cur);
+		free(req);
+	}
+
+	fibril_timer_set(atrans_timer, ATRANS_TICK, atrans_timer_fun, NULL);
 }
 
 /** @}
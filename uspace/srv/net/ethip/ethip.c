@@ -45,6 +45,7 @@
 #include <stdlib.h>
 #include <task.h>
 #include "arp.h"
+#include "atrans.h"
 #include "ethip.h"
 #include "ethip_nic.h"
 #include "pdu.h"
@@ -80,7 +81,14 @@ static errno_t ethip_init(void)
 {
 	async_set_fallback_port_handler(ethip_client_conn, NULL);
 	
-	errno_t rc = loc_server_register(NAME);
+	errno_t rc = atrans_init();
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed initializing address "
+		    "translation table.");
+		return rc;
+	}
+	
+	rc = loc_server_register(NAME);
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed registering server.");
 		return rc;
@@ -176,26 +184,16 @@ static errno_t ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu)
 	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
 	eth_frame_t frame;
 	
-	errno_t rc = arp_translate(nic, sdu->src, sdu->dest, frame.dest);
-	if (rc != EOK) {
-		log_msg(LOG_DEFAULT, LVL_WARN, "Failed to look up IPv4 address 0x%"
-		    PRIx32, sdu->dest);
-		return rc;
-	}
-	
 	addr48(nic->mac_addr, frame.src);
 	frame.etype_len = ETYPE_IP;
 	frame.data = sdu->data;
 	frame.size = sdu->size;
 	
-	void *data;
-	size_t size;
-	rc = eth_pdu_encode(&frame, &data, &size);
-	if (rc != EOK)
-		return rc;
-	
-	rc = ethip_nic_send(nic, data, size);
-	free(data);
+	errno_t rc = arp_send_frame(nic, sdu->src, sdu->dest, &frame);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Failed to send to IPv4 address 0x%"
+		    PRIx32, sdu->dest);
+	}
 	
 	return rc;
 }
@@ -264,7 +262,6 @@ errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size)
 		    frame.etype_len);
 	}
 	
-	free(frame.data);
 	return rc;
 }
 
@@ -298,8 +295,17 @@ static errno_t ethip_set_mac48(iplink_srv_t *srv, addr48_t *mac)
 static errno_t ethip_addr_add(iplink_srv_t *srv, inet_addr_t *addr)
 {
 	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
+	addr32_t addr_v4;
+	
+	errno_t rc = ethip_nic_addr_add(nic, addr);
+	if (rc != EOK)
+		return rc;
+	
+	/* Let neighbors refresh stale entries for this address */
+	if (inet_addr_get(addr, &addr_v4, NULL) == ip_v4)
+		(void) arp_announce(nic, addr_v4);
 	
-	return ethip_nic_addr_add(nic, addr);
+	return EOK;
 }
 
 static errno_t ethip_addr_remove(iplink_srv_t *srv, inet_addr_t *addr)
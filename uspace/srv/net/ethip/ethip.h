@@ -37,13 +37,16 @@
 #ifndef ETHIP_H_
 #define ETHIP_H_
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <async.h>
 #include <inet/iplink_srv.h>
 #include <inet/addr.h>
 #include <loc.h>
+#include <nic_iface.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/time.h>
 
 typedef struct {
 	link_t link;
@@ -62,6 +65,9 @@ typedef struct ethip_nic {
 	/** MAC address */
 	addr48_t mac_addr;
 	
+	/** Receive pool shared by the NIC driver (NULL if not provided) */
+	nic_rx_pool_t *rx_pool;
+	
 	/**
 	 * List of IP addresses configured on this link
 	 * (of the type ethip_link_addr_t)
@@ -108,13 +114,46 @@ typedef struct {
 	addr32_t target_proto_addr;
 } arp_eth_packet_t;
 
+/** Address translation state */
+typedef enum {
+	/** Resolution in progress, link address not known yet */
+	ats_incomplete,
+	/** Link address recently confirmed */
+	ats_reachable,
+	/** Link address not confirmed for some time, but still usable */
+	ats_stale,
+	/** Link address being reconfirmed with unicast requests */
+	ats_probe
+} ethip_atrans_state_t;
+
 /** Address translation table element */
 typedef struct {
-	link_t atrans_list;
+	/** Link in the address translation table */
+	ht_link_t atrans_ht;
 	addr32_t ip_addr;
 	addr48_t mac_addr;
+	ethip_atrans_state_t state;
+	/** NIC used to send requests for this address */
+	ethip_nic_t *nic;
+	/** Source address used in requests */
+	addr32_t src_addr;
+	/** Time of the last state change */
+	struct timeval since;
+	/** Number of requests sent in the current state */
+	unsigned int requests;
+	/** Frames waiting for the address to be resolved (ethip_atrans_pkt_t) */
+	list_t queue;
+	/** Number of frames in @c queue */
+	size_t queue_len;
 } ethip_atrans_t;
 
+/** Frame waiting for address resolution */
+typedef struct {
+	link_t queue;
+	/** Frame with a copy of the payload (destination not set) */
+	eth_frame_t frame;
+} ethip_atrans_pkt_t;
+
 extern errno_t ethip_iplink_init(ethip_nic_t *);
 extern errno_t ethip_received(iplink_srv_t *, void *, size_t);
 
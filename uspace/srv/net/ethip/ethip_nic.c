@@ -35,6 +35,7 @@
  */
 
 #include <adt/list.h>
+#include <as.h>
 #include <async.h>
 #include <stdbool.h>
 #include <errno.h>
@@ -138,6 +139,9 @@ static void ethip_nic_delete(ethip_nic_t *nic)
 	if (nic->svc_name != NULL)
 		free(nic->svc_name);
 	
+	if (nic->rx_pool != NULL)
+		as_area_destroy(nic->rx_pool);
+	
 	free(nic);
 }
 
@@ -284,6 +288,71 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_callid_t callid,
 	async_answer_0(callid, rc);
 }
 
+static void ethip_nic_rx_pool(ethip_nic_t *nic, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	ipc_callid_t callid;
+	size_t size;
+	unsigned int flags;
+	void *pool;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_rx_pool() nic=%p", nic);
+
+	if (!async_share_out_receive(&callid, &size, &flags)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	if (size < sizeof(nic_rx_pool_t)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	rc = async_share_out_finalize(callid, &pool);
+	if ((rc != EOK) || (pool == AS_MAP_FAILED)) {
+		async_answer_0(iid, ENOMEM);
+		return;
+	}
+
+	if (nic->rx_pool != NULL)
+		as_area_destroy(nic->rx_pool);
+
+	nic->rx_pool = (nic_rx_pool_t *) pool;
+	async_answer_0(iid, EOK);
+}
+
+static void ethip_nic_received_batch(ethip_nic_t *nic, ipc_callid_t callid,
+    ipc_call_t *call)
+{
+	size_t count = IPC_GET_ARG1(*call);
+	size_t i;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() nic=%p, "
+	    "count=%zu", nic, count);
+
+	if (nic->rx_pool == NULL || count > NIC_RX_POOL_SLOTS) {
+		async_answer_0(callid, EINVAL);
+		return;
+	}
+
+	/* Frames are parsed in place, the slots are reused after we answer */
+	for (i = 0; i < count; i++) {
+		size_t size = nic->rx_pool->desc[i].size;
+		if (size > NIC_RX_POOL_SLOT_SIZE) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Invalid frame size %zu",
+			    size);
+			continue;
+		}
+
+		(void) ethip_received(&nic->iplink, nic->rx_pool->slot[i], size);
+	}
+
+	async_answer_0(callid, EOK);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, ipc_callid_t callid,
     ipc_call_t *call)
 {
@@ -316,6 +385,12 @@ static void ethip_nic_cb_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, callid, &call);
 			break;
+		case NIC_EV_RX_POOL:
+			ethip_nic_rx_pool(nic, callid, &call);
+			break;
+		case NIC_EV_RECEIVED_BATCH:
+			ethip_nic_received_batch(nic, callid, &call);
+			break;
 		default:
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "unknown IPC method: %" PRIun, IPC_GET_IMETHOD(call));
 			async_answer_0(callid, ENOTSUP);
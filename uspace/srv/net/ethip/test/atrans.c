@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+
+#include "../arp.h"
+#include "../atrans.h"
+#include "../ethip.h"
+#include "../ethip_nic.h"
+#include "../pdu.h"
+#include "../std.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(atrans);
+
+/*
+ * Stub NIC and ARP
+ *
+ * Replace sending of frames and ARP requests so that the address
+ * translation cache can be tested without a NIC. Frames carry a single
+ * byte identifying them.
+ */
+
+#define TEST_SENT_MAX  8
+
+/** Number of ARP requests sent */
+static unsigned test_requests;
+/** Target link address of the last ARP request */
+static addr48_t test_request_mac;
+/** Identifiers of the frames sent, in order */
+static uint8_t test_sent[TEST_SENT_MAX];
+static size_t test_sent_cnt;
+/** Destination of the last frame sent */
+static addr48_t test_sent_mac;
+
+errno_t arp_send_request(ethip_nic_t *nic, addr32_t src_addr,
+    addr32_t ip_addr, const addr48_t mac_addr)
+{
+	test_requests++;
+	addr48(mac_addr, test_request_mac);
+	return EOK;
+}
+
+errno_t ethip_nic_send(ethip_nic_t *nic, void *data, size_t size)
+{
+	eth_frame_t frame;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, eth_pdu_decode(data, size, &frame));
+	PCUT_ASSERT_TRUE(test_sent_cnt < TEST_SENT_MAX);
+
+	test_sent[test_sent_cnt++] = *(uint8_t *) frame.data;
+	addr48(frame.dest, test_sent_mac);
+	return EOK;
+}
+
+/** Fake NIC, never used by the stubs */
+static ethip_nic_t test_nic;
+
+static addr32_t test_src = 0x0a000001;
+
+static addr48_t test_mac = { 0x02, 0, 0, 0, 0, 1 };
+static addr48_t test_mac2 = { 0x02, 0, 0, 0, 0, 2 };
+
+/** Send a frame identified by @a id to an IPv4 address */
+static void test_send(addr32_t ip_addr, uint8_t id)
+{
+	eth_frame_t frame;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.etype_len = ETYPE_IP;
+	frame.data = &id;
+	frame.size = 1;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_send(&test_nic, test_src, ip_addr,
+	    &frame));
+}
+
+PCUT_TEST_BEFORE
+{
+	static bool initialized = false;
+
+	if (!initialized) {
+		PCUT_ASSERT_ERRNO_VAL(EOK, atrans_init());
+		initialized = true;
+	}
+
+	test_requests = 0;
+	test_sent_cnt = 0;
+}
+
+/** Entries are added, looked up and removed */
+PCUT_TEST(add_lookup_remove)
+{
+	addr32_t addr = 0x0a00000a;
+	addr48_t mac;
+
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, atrans_lookup(addr, mac));
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_add(addr, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_lookup(addr, mac));
+	PCUT_ASSERT_TRUE(addr48_compare(mac, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_remove(addr));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, atrans_lookup(addr, mac));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, atrans_remove(addr));
+}
+
+/** Overheard mappings only refresh existing entries */
+PCUT_TEST(update)
+{
+	addr32_t addr = 0x0a00000b;
+	addr48_t mac;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_update(addr, test_mac));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, atrans_lookup(addr, mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_add(addr, test_mac));
+
+	/* A changed address is used, but reconfirmed on next use */
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_update(addr, test_mac2));
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_lookup(addr, mac));
+	PCUT_ASSERT_TRUE(addr48_compare(mac, test_mac2));
+
+	test_send(addr, 1);
+	PCUT_ASSERT_INT_EQUALS(1, test_requests);
+	PCUT_ASSERT_TRUE(addr48_compare(test_request_mac, test_mac2));
+	PCUT_ASSERT_INT_EQUALS(1, test_sent_cnt);
+	PCUT_ASSERT_TRUE(addr48_compare(test_sent_mac, test_mac2));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_remove(addr));
+}
+
+/** Frames to a known neighbor are sent right away */
+PCUT_TEST(send_resolved)
+{
+	addr32_t addr = 0x0a00000c;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_add(addr, test_mac));
+
+	test_send(addr, 1);
+
+	PCUT_ASSERT_INT_EQUALS(0, test_requests);
+	PCUT_ASSERT_INT_EQUALS(1, test_sent_cnt);
+	PCUT_ASSERT_INT_EQUALS(1, test_sent[0]);
+	PCUT_ASSERT_TRUE(addr48_compare(test_sent_mac, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_remove(addr));
+}
+
+/** Frames wait for resolution and are sent once it completes */
+PCUT_TEST(send_queued)
+{
+	addr32_t addr = 0x0a00000d;
+	addr48_t mac;
+
+	test_send(addr, 1);
+
+	/* One broadcast request, nothing sent yet */
+	PCUT_ASSERT_INT_EQUALS(1, test_requests);
+	PCUT_ASSERT_TRUE(addr48_compare(test_request_mac, addr48_broadcast));
+	PCUT_ASSERT_INT_EQUALS(0, test_sent_cnt);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, atrans_lookup(addr, mac));
+
+	/* Resolution is in progress, no more requests */
+	test_send(addr, 2);
+	PCUT_ASSERT_INT_EQUALS(1, test_requests);
+
+	/* An overheard reply completes the resolution as well */
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_update(addr, test_mac));
+
+	PCUT_ASSERT_INT_EQUALS(2, test_sent_cnt);
+	PCUT_ASSERT_INT_EQUALS(1, test_sent[0]);
+	PCUT_ASSERT_INT_EQUALS(2, test_sent[1]);
+	PCUT_ASSERT_TRUE(addr48_compare(test_sent_mac, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_remove(addr));
+}
+
+/** Only the newest frames are kept while resolving */
+PCUT_TEST(queue_limit)
+{
+	addr32_t addr = 0x0a00000e;
+	uint8_t id;
+
+	for (id = 1; id <= 5; id++)
+		test_send(addr, id);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_add(addr, test_mac));
+
+	PCUT_ASSERT_INT_EQUALS(3, test_sent_cnt);
+	PCUT_ASSERT_INT_EQUALS(3, test_sent[0]);
+	PCUT_ASSERT_INT_EQUALS(4, test_sent[1]);
+	PCUT_ASSERT_INT_EQUALS(5, test_sent[2]);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, atrans_remove(addr));
+}
+
+PCUT_EXPORT(atrans);
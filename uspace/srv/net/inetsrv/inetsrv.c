@@ -57,6 +57,7 @@
 #include "inetcfg.h"
 #include "inetping.h"
 #include "inet_link.h"
+#include "ntrans.h"
 #include "reass.h"
 #include "sroute.h"
 
@@ -87,8 +88,12 @@ static errno_t inet_init(void)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_init()");
 	
+	errno_t rc = ntrans_init();
+	if (rc != EOK)
+		return rc;
+	
 	port_id_t port;
-	errno_t rc = async_create_port(INTERFACE_INET,
+	rc = async_create_port(INTERFACE_INET,
 	    inet_default_conn, NULL, &port);
 	if (rc != EOK)
 		return rc;
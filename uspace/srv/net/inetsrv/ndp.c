@@ -44,9 +44,6 @@
 #include "inet_link.h"
 #include "ndp.h"
 
-/** Time to wait for NDP reply in microseconds */
-#define NDP_REQUEST_TIMEOUT  (3 * 1000 * 1000)
-
 static addr128_t solicited_node_ip =
     {0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0xff, 0, 0, 0};
 
@@ -139,44 +136,69 @@ errno_t ndp_received(inet_dgram_t *dgram)
 	return EOK;
 }
 
-/** Translate IPv6 to MAC address
+/** Send neighbour solicitation
  *
- * @param src  Source IPv6 address
- * @param dest Destination IPv6 address
- * @param mac  Target MAC address to be assigned
- * @param link Network interface
+ * @param ilink    Network interface
+ * @param src_addr Source IPv6 address
+ * @param ip_addr  IPv6 address to be resolved
+ * @param mac_addr Known MAC address of @a ip_addr to send a unicast probe
+ *                 to or NULL to send a multicast solicitation
  *
- * @return EOK on success
- * @return ENOENT when NDP translation failed
+ * @return EOK on success or an error code
  *
  */
-errno_t ndp_translate(addr128_t src_addr, addr128_t ip_addr, addr48_t mac_addr,
-    inet_link_t *ilink)
+errno_t ndp_send_solicitation(inet_link_t *ilink, addr128_t src_addr,
+    addr128_t ip_addr, const addr48_t mac_addr)
 {
-	if (!ilink->mac_valid) {
-		/* The link does not support NDP */
-		memset(mac_addr, 0, 6);
-		return EOK;
-	}
-	
-	errno_t rc = ntrans_lookup(ip_addr, mac_addr);
-	if (rc == EOK)
-		return EOK;
-	
 	ndp_packet_t packet;
 	
 	packet.opcode = ICMPV6_NEIGHBOUR_SOLICITATION;
 	addr48(ilink->mac, packet.sender_hw_addr);
 	addr128(src_addr, packet.sender_proto_addr);
 	addr128(ip_addr, packet.solicited_ip);
-	addr48_solicited_node(ip_addr, packet.target_hw_addr);
-	ndp_solicited_node_ip(ip_addr, packet.target_proto_addr);
 	
-	rc = ndp_send_packet(ilink, &packet);
-	if (rc != EOK)
-		return rc;
+	if (mac_addr != NULL) {
+		addr48(mac_addr, packet.target_hw_addr);
+		addr128(ip_addr, packet.target_proto_addr);
+	} else {
+		addr48_solicited_node(ip_addr, packet.target_hw_addr);
+		ndp_solicited_node_ip(ip_addr, packet.target_proto_addr);
+	}
 	
-	(void) ntrans_wait_timeout(NDP_REQUEST_TIMEOUT);
+	return ndp_send_packet(ilink, &packet);
+}
+
+/** Send datagram to IPv6 neighbour
+ *
+ * The datagram is sent immediately if the MAC address of the neighbour
+ * is known. Otherwise it is queued until the neighbour answers
+ * the solicitation.
+ *
+ * @param src_addr Source IPv6 address
+ * @param ip_addr  Destination (next hop) IPv6 address
+ * @param ilink    Network interface
+ * @param dgram    Datagram
+ * @param proto    Protocol
+ * @param ttl      Hop limit
+ * @param df       Do not fragment
+ *
+ * @return EOK if the datagram was sent or queued
+ * @return ENOMEM if not enough memory
+ *
+ */
+errno_t ndp_send_dgram(addr128_t src_addr, addr128_t ip_addr,
+    inet_link_t *ilink, inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
+    int df)
+{
+	if (!ilink->mac_valid) {
+		/* The link does not support NDP */
+		addr48_t mac_addr;
+		
+		memset(mac_addr, 0, 6);
+		return inet_link_send_dgram6(ilink, mac_addr, dgram, proto,
+		    ttl, df);
+	}
 	
-	return ntrans_lookup(ip_addr, mac_addr);
+	return ntrans_send_dgram(ilink, src_addr, ip_addr, dgram, proto,
+	    ttl, df);
 }
@@ -34,17 +34,144 @@
  * @brief
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <inet/iplink_srv.h>
+#include <io/log.h>
+#include <mem.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include "inet_link.h"
+#include "ndp.h"
 #include "ntrans.h"
 
-/** Address translation list (of inet_ntrans_t) */
-static FIBRIL_MUTEX_INITIALIZE(ntrans_list_lock);
-static LIST_INITIALIZE(ntrans_list);
-static FIBRIL_CONDVAR_INITIALIZE(ntrans_cv);
+/** Interval of the aging timer and of repeated solicitations in microseconds */
+#define NTRANS_TICK  (1000 * 1000)
+
+/** Time after which a reachable entry becomes stale in microseconds */
+#define NTRANS_REACHABLE_TIME  (30 * 1000 * 1000)
+
+/** Time after which an unused stale entry is discarded in microseconds */
+#define NTRANS_STALE_TIME  (10 * 60 * 1000 * 1000)
+
+/** Number of solicitations sent before giving up resolution or probing */
+#define NTRANS_MAX_REQUESTS  3
+
+/** Maximum number of datagrams queued per unresolved address */
+#define NTRANS_QUEUE_MAX  3
+
+/** Solicitation to be sent once the table lock is released */
+typedef struct {
+	link_t req_list;
+	inet_link_t *ilink;
+	addr128_t src_addr;
+	addr128_t ip_addr;
+	/** Send unicast probe to @c mac_addr instead of multicast */
+	bool unicast;
+	addr48_t mac_addr;
+} ntrans_req_t;
+
+/** Address translation table (of inet_ntrans_t) */
+static FIBRIL_MUTEX_INITIALIZE(ntrans_lock);
+static hash_table_t ntrans_table;
+static fibril_timer_t *ntrans_timer;
+
+static void ntrans_timer_fun(void *);
+
+static void ntrans_pkt_list_free(list_t *pkts)
+{
+	list_foreach_safe(*pkts, cur, next) {
+		inet_ntrans_pkt_t *pkt = list_get_instance(cur,
+		    inet_ntrans_pkt_t, queue);
+
+		list_remove(cur);
+		free(pkt->dgram.data);
+		free(pkt);
+	}
+}
+
+static size_t ntrans_addr_hash(const addr128_t ip_addr)
+{
+	size_t hash = 0;
+
+	for (size_t i = 0; i < 16; i++)
+		hash = (hash << 5) ^ (hash >> 27) ^ ip_addr[i];
+
+	return hash;
+}
+
+static size_t ntrans_ht_hash(const ht_link_t *item)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(item, inet_ntrans_t,
+	    ntrans_ht);
+	return ntrans_addr_hash(ntrans->ip_addr);
+}
+
+static size_t ntrans_ht_key_hash(void *key)
+{
+	return ntrans_addr_hash((uint8_t *) key);
+}
+
+static bool ntrans_ht_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	inet_ntrans_t *n1 = hash_table_get_inst(item1, inet_ntrans_t,
+	    ntrans_ht);
+	inet_ntrans_t *n2 = hash_table_get_inst(item2, inet_ntrans_t,
+	    ntrans_ht);
+	return addr128_compare(n1->ip_addr, n2->ip_addr);
+}
+
+static bool ntrans_ht_key_equal(void *key, const ht_link_t *item)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(item, inet_ntrans_t,
+	    ntrans_ht);
+	return addr128_compare(ntrans->ip_addr, (uint8_t *) key);
+}
+
+static void ntrans_ht_remove_callback(ht_link_t *item)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(item, inet_ntrans_t,
+	    ntrans_ht);
+
+	if (ntrans->queue_len > 0) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Dropping %zu datagrams queued "
+		    "for unresolved neighbor", ntrans->queue_len);
+	}
+
+	ntrans_pkt_list_free(&ntrans->queue);
+	free(ntrans);
+}
+
+static hash_table_ops_t ntrans_ht_ops = {
+	.hash = ntrans_ht_hash,
+	.key_hash = ntrans_ht_key_hash,
+	.equal = ntrans_ht_equal,
+	.key_equal = ntrans_ht_key_equal,
+	.remove_callback = ntrans_ht_remove_callback
+};
+
+/** Initialize translation table
+ *
+ * @return EOK on success
+ * @return ENOMEM if not enough memory
+ *
+ */
+errno_t ntrans_init(void)
+{
+	if (!hash_table_create(&ntrans_table, 0, 0, &ntrans_ht_ops))
+		return ENOMEM;
+
+	ntrans_timer = fibril_timer_create(NULL);
+	if (ntrans_timer == NULL) {
+		hash_table_destroy(&ntrans_table);
+		return ENOMEM;
+	}
+
+	fibril_timer_set(ntrans_timer, NTRANS_TICK, ntrans_timer_fun, NULL);
+	return EOK;
+}
 
 /** Look for address in translation table
  *
@@ -55,15 +182,33 @@ static FIBRIL_CONDVAR_INITIALIZE(ntrans_cv);
  */
 static inet_ntrans_t *ntrans_find(addr128_t ip_addr)
 {
-	list_foreach(ntrans_list, ntrans_list, inet_ntrans_t, ntrans) {
-		if (addr128_compare(ntrans->ip_addr, ip_addr))
-			return ntrans;
-	}
+	ht_link_t *link = hash_table_find(&ntrans_table, ip_addr);
+	if (link == NULL)
+		return NULL;
 
-	return NULL;
+	return hash_table_get_inst(link, inet_ntrans_t, ntrans_ht);
+}
+
+static inet_ntrans_t *ntrans_new(addr128_t ip_addr,
+    inet_ntrans_state_t state)
+{
+	inet_ntrans_t *ntrans = calloc(1, sizeof(inet_ntrans_t));
+	if (ntrans == NULL)
+		return NULL;
+
+	addr128(ip_addr, ntrans->ip_addr);
+	ntrans->state = state;
+	getuptime(&ntrans->since);
+	list_initialize(&ntrans->queue);
+
+	hash_table_insert(&ntrans_table, &ntrans->ntrans_ht);
+	return ntrans;
 }
 
 /** Add entry to translation table
+ *
+ * The neighbor is marked reachable and datagrams waiting for the
+ * address to be resolved are sent.
  *
  * @param ip_addr  IPv6 address of the new entry
  * @param mac_addr MAC address of the new entry
@@ -75,25 +220,43 @@ static inet_ntrans_t *ntrans_find(addr128_t ip_addr)
 errno_t ntrans_add(addr128_t ip_addr, addr48_t mac_addr)
 {
 	inet_ntrans_t *ntrans;
-	inet_ntrans_t *prev;
+	inet_link_t *ilink = NULL;
+	list_t pkts;
 
-	ntrans = calloc(1, sizeof(inet_ntrans_t));
-	if (ntrans == NULL)
-		return ENOMEM;
+	list_initialize(&pkts);
+
+	fibril_mutex_lock(&ntrans_lock);
+	ntrans = ntrans_find(ip_addr);
+	if (ntrans == NULL) {
+		ntrans = ntrans_new(ip_addr, nts_reachable);
+		if (ntrans == NULL) {
+			fibril_mutex_unlock(&ntrans_lock);
+			return ENOMEM;
+		}
+	}
 
-	addr128(ip_addr, ntrans->ip_addr);
 	addr48(mac_addr, ntrans->mac_addr);
+	ntrans->state = nts_reachable;
+	getuptime(&ntrans->since);
+	ntrans->requests = 0;
 
-	fibril_mutex_lock(&ntrans_list_lock);
-	prev = ntrans_find(ip_addr);
-	if (prev != NULL) {
-		list_remove(&prev->ntrans_list);
-		free(prev);
+	/* Take over datagrams waiting for resolution */
+	if (ntrans->queue_len > 0) {
+		list_concat(&pkts, &ntrans->queue);
+		ntrans->queue_len = 0;
+		ilink = ntrans->ilink;
 	}
 
-	list_append(&ntrans->ntrans_list, &ntrans_list);
-	fibril_mutex_unlock(&ntrans_list_lock);
-	fibril_condvar_broadcast(&ntrans_cv);
+	fibril_mutex_unlock(&ntrans_lock);
+
+	if (ilink != NULL) {
+		list_foreach(pkts, queue, inet_ntrans_pkt_t, pkt) {
+			(void) inet_link_send_dgram6(ilink, mac_addr, &pkt->dgram,
+			    pkt->proto, pkt->ttl, pkt->df);
+		}
+
+		ntrans_pkt_list_free(&pkts);
+	}
 
 	return EOK;
 }
@@ -108,20 +271,11 @@ errno_t ntrans_add(addr128_t ip_addr, addr48_t mac_addr)
  */
 errno_t ntrans_remove(addr128_t ip_addr)
 {
-	inet_ntrans_t *ntrans;
-
-	fibril_mutex_lock(&ntrans_list_lock);
-	ntrans = ntrans_find(ip_addr);
-	if (ntrans == NULL) {
-		fibril_mutex_unlock(&ntrans_list_lock);
-		return ENOENT;
-	}
-
-	list_remove(&ntrans->ntrans_list);
-	fibril_mutex_unlock(&ntrans_list_lock);
-	free(ntrans);
+	fibril_mutex_lock(&ntrans_lock);
+	size_t removed = hash_table_remove(&ntrans_table, ip_addr);
+	fibril_mutex_unlock(&ntrans_lock);
 
-	return EOK;
+	return (removed > 0) ? EOK : ENOENT;
 }
 
 /** Translate IPv6 address to MAC address using the translation table
@@ -135,34 +289,205 @@ errno_t ntrans_remove(addr128_t ip_addr)
  */
 errno_t ntrans_lookup(addr128_t ip_addr, addr48_t mac_addr)
 {
-	fibril_mutex_lock(&ntrans_list_lock);
+	errno_t rc = ENOENT;
+
+	fibril_mutex_lock(&ntrans_lock);
 	inet_ntrans_t *ntrans = ntrans_find(ip_addr);
-	if (ntrans == NULL) {
-		fibril_mutex_unlock(&ntrans_list_lock);
-		return ENOENT;
+	if (ntrans != NULL && ntrans->state != nts_incomplete) {
+		addr48(ntrans->mac_addr, mac_addr);
+		rc = EOK;
 	}
-	
-	fibril_mutex_unlock(&ntrans_list_lock);
-	addr48(ntrans->mac_addr, mac_addr);
-	return EOK;
+	fibril_mutex_unlock(&ntrans_lock);
+
+	return rc;
 }
 
-/** Wait on translation table CV for some time
+/** Send datagram to a neighbor
  *
- * @param timeout Timeout in microseconds
+ * If the link address of @a ip_addr is known, the datagram is sent right
+ * away. Otherwise a copy of the datagram is queued and sent once the
+ * address is resolved. The caller never waits for resolution.
  *
- * @return EOK if woken up by another fibril
- * @return ETIMEOUT if timed out
+ * @param ilink    Link to send the datagram through
+ * @param src_addr Source IPv6 address (used in solicitations)
+ * @param ip_addr  Neighbor IPv6 address
+ * @param dgram    Datagram
+ * @param proto    Protocol
+ * @param ttl      Hop limit
+ * @param df       Do not fragment
+ *
+ * @return EOK if the datagram was sent or queued
+ * @return ENOMEM if not enough memory
  *
  */
-errno_t ntrans_wait_timeout(suseconds_t timeout)
+errno_t ntrans_send_dgram(inet_link_t *ilink, addr128_t src_addr,
+    addr128_t ip_addr, inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
+    int df)
 {
-	fibril_mutex_lock(&ntrans_list_lock);
-	errno_t rc = fibril_condvar_wait_timeout(&ntrans_cv, &ntrans_list_lock,
-	    timeout);
-	fibril_mutex_unlock(&ntrans_list_lock);
-	
-	return rc;
+	inet_ntrans_t *ntrans;
+	inet_ntrans_pkt_t *pkt;
+	addr48_t mac_addr;
+	bool resolve = false;
+	bool probe = false;
+
+	fibril_mutex_lock(&ntrans_lock);
+
+	ntrans = ntrans_find(ip_addr);
+	if (ntrans != NULL && ntrans->state != nts_incomplete) {
+		addr48(ntrans->mac_addr, mac_addr);
+
+		if (ntrans->state == nts_stale) {
+			/* Reconfirm the address while still using it */
+			ntrans->state = nts_probe;
+			getuptime(&ntrans->since);
+			ntrans->requests = 1;
+			ntrans->ilink = ilink;
+			addr128(src_addr, ntrans->src_addr);
+			probe = true;
+		}
+
+		fibril_mutex_unlock(&ntrans_lock);
+
+		if (probe)
+			(void) ndp_send_solicitation(ilink, src_addr, ip_addr,
+			    mac_addr);
+
+		return inet_link_send_dgram6(ilink, mac_addr, dgram, proto, ttl,
+		    df);
+	}
+
+	pkt = calloc(1, sizeof(inet_ntrans_pkt_t));
+	if (pkt == NULL) {
+		fibril_mutex_unlock(&ntrans_lock);
+		return ENOMEM;
+	}
+
+	pkt->dgram = *dgram;
+	pkt->proto = proto;
+	pkt->ttl = ttl;
+	pkt->df = df;
+	pkt->dgram.data = malloc(dgram->size);
+	if (pkt->dgram.data == NULL) {
+		free(pkt);
+		fibril_mutex_unlock(&ntrans_lock);
+		return ENOMEM;
+	}
+
+	memcpy(pkt->dgram.data, dgram->data, dgram->size);
+
+	if (ntrans == NULL) {
+		ntrans = ntrans_new(ip_addr, nts_incomplete);
+		if (ntrans == NULL) {
+			free(pkt->dgram.data);
+			free(pkt);
+			fibril_mutex_unlock(&ntrans_lock);
+			return ENOMEM;
+		}
+
+		ntrans->ilink = ilink;
+		addr128(src_addr, ntrans->src_addr);
+		ntrans->requests = 1;
+		resolve = true;
+	}
+
+	if (ntrans->queue_len >= NTRANS_QUEUE_MAX) {
+		/* Drop the oldest datagram */
+		inet_ntrans_pkt_t *old = list_get_instance(
+		    list_first(&ntrans->queue), inet_ntrans_pkt_t, queue);
+		list_remove(&old->queue);
+		free(old->dgram.data);
+		free(old);
+		ntrans->queue_len--;
+	}
+
+	list_append(&pkt->queue, &ntrans->queue);
+	ntrans->queue_len++;
+
+	fibril_mutex_unlock(&ntrans_lock);
+
+	if (resolve)
+		(void) ndp_send_solicitation(ilink, src_addr, ip_addr, NULL);
+
+	return EOK;
+}
+
+/** Age one translation table entry
+ *
+ * @param item Entry
+ * @param arg  List of solicitations to send (of ntrans_req_t)
+ */
+static bool ntrans_age(ht_link_t *item, void *arg)
+{
+	inet_ntrans_t *ntrans = hash_table_get_inst(item, inet_ntrans_t,
+	    ntrans_ht);
+	list_t *reqs = (list_t *) arg;
+	struct timeval now;
+	ntrans_req_t *req;
+
+	getuptime(&now);
+	suseconds_t age = tv_sub_diff(&now, &ntrans->since);
+
+	switch (ntrans->state) {
+	case nts_incomplete:
+	case nts_probe:
+		if (ntrans->requests >= NTRANS_MAX_REQUESTS) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "No NDP advertisement "
+			    "from neighbor");
+			hash_table_remove_item(&ntrans_table, item);
+			break;
+		}
+
+		req = calloc(1, sizeof(ntrans_req_t));
+		if (req == NULL)
+			break;
+
+		req->ilink = ntrans->ilink;
+		addr128(ntrans->src_addr, req->src_addr);
+		addr128(ntrans->ip_addr, req->ip_addr);
+		req->unicast = (ntrans->state == nts_probe);
+		addr48(ntrans->mac_addr, req->mac_addr);
+
+		list_append(&req->req_list, reqs);
+		ntrans->requests++;
+		break;
+	case nts_reachable:
+		if (age >= NTRANS_REACHABLE_TIME) {
+			ntrans->state = nts_stale;
+			ntrans->since = now;
+		}
+		break;
+	case nts_stale:
+		if (age >= NTRANS_STALE_TIME)
+			hash_table_remove_item(&ntrans_table, item);
+		break;
+	}
+
+	return true;
+}
+
+/** Aging timer handler */
+static void ntrans_timer_fun(void *arg)
+{
+	list_t reqs;
+
+	list_initialize(&reqs);
+
+	fibril_mutex_lock(&ntrans_lock);
+	hash_table_apply(&ntrans_table, ntrans_age, &reqs);
+	fibril_mutex_unlock(&ntrans_lock);
+
+	list_foreach_safe(reqs, cur, next) {
+		ntrans_req_t *req = list_get_instance(cur, ntrans_req_t,
+		    req_list);
+
+		(void) ndp_send_solicitation(req->ilink, req->src_addr,
+		    req->ip_addr, req->unicast ? req->mac_addr : NULL);
+
+		list_remove(cur);
+		free(req);
+	}
+
+	fibril_timer_set(ntrans_timer, NTRANS_TICK, ntrans_timer_fun, NULL);
 }
 
 /** @}
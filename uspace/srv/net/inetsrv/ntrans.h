@@ -37,20 +37,62 @@
 #ifndef NTRANS_H_
 #define NTRANS_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <inet/iplink_srv.h>
 #include <inet/addr.h>
+#include <sys/time.h>
+#include "inetsrv.h"
+
+/** Address translation state */
+typedef enum {
+	/** Resolution in progress, link address not known yet */
+	nts_incomplete,
+	/** Link address recently confirmed */
+	nts_reachable,
+	/** Link address not confirmed for some time, but still usable */
+	nts_stale,
+	/** Link address being reconfirmed with unicast solicitations */
+	nts_probe
+} inet_ntrans_state_t;
 
 /** Address translation table element */
 typedef struct {
-	link_t ntrans_list;
+	/** Link in the address translation table */
+	ht_link_t ntrans_ht;
 	addr128_t ip_addr;
 	addr48_t mac_addr;
+	inet_ntrans_state_t state;
+	/** Link used to send solicitations for this address */
+	inet_link_t *ilink;
+	/** Source address used in solicitations */
+	addr128_t src_addr;
+	/** Time of the last state change */
+	struct timeval since;
+	/** Number of solicitations sent in the current state */
+	unsigned int requests;
+	/** Datagrams waiting for the address to be resolved (inet_ntrans_pkt_t) */
+	list_t queue;
+	/** Number of datagrams in @c queue */
+	size_t queue_len;
 } inet_ntrans_t;
 
+/** Datagram waiting for address resolution */
+typedef struct {
+	link_t queue;
+	/** Datagram with a copy of the data */
+	inet_dgram_t dgram;
+	uint8_t proto;
+	uint8_t ttl;
+	int df;
+} inet_ntrans_pkt_t;
+
+extern errno_t ntrans_init(void);
 extern errno_t ntrans_add(addr128_t, addr48_t);
 extern errno_t ntrans_remove(addr128_t);
 extern errno_t ntrans_lookup(addr128_t, addr48_t);
-extern errno_t ntrans_wait_timeout(suseconds_t);
+extern errno_t ntrans_send_dgram(inet_link_t *, addr128_t, addr128_t,
+    inet_dgram_t *, uint8_t, uint8_t, int);
 
 #endif
 
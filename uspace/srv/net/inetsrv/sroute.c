@@ -34,21 +34,500 @@
  * @brief
  */
 
+#include <adt/hash.h>
 #include <bitops.h>
+#include <compiler/barrier.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
+#include <libarch/barrier.h>
 #include <ipc/loc.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <str.h>
 #include "sroute.h"
 #include "inetsrv.h"
 #include "inet_link.h"
 
+/** Number of entries in the route cache (must be a power of two) */
+#define SROUTE_CACHE_SIZE  256
+
+/** Maximum key length in bits */
+#define SROUTE_KEY_BITS  128
+
+/** Node of the path-compressed routing trie
+ *
+ * Each node covers the prefix formed by the first @c plen bits of @c key.
+ * Nodes with a route attached represent a destination network, nodes
+ * without a route only branch on the bit following the prefix.
+ */
+typedef struct sroute_node {
+	/** Prefix (bits beyond @c plen are zero) */
+	uint8_t key[SROUTE_KEY_BITS / 8];
+	/** Prefix length in bits */
+	uint8_t plen;
+	/** Route for this prefix or @c NULL for branch nodes */
+	inet_sroute_t *sroute;
+	/** Number of routes with exactly this prefix */
+	unsigned int nroutes;
+	/** Subtries for the next bit being zero or one */
+	struct sroute_node *child[2];
+} sroute_node_t;
+
+/** Routing tries */
+typedef struct {
+	/** Trie of IPv4 routes */
+	sroute_node_t *v4;
+	/** Trie of IPv6 routes */
+	sroute_node_t *v6;
+} sroute_trie_t;
+
+/** Route cache entry
+ *
+ * Entries are read without locking. A writer makes @c seq odd while
+ * it updates the entry, readers retry or give up if @c seq was odd or
+ * changed while they were reading the entry.
+ */
+typedef struct {
+	/** Sequence number of the entry */
+	unsigned int seq;
+	/** Cache generation the entry was filled in */
+	unsigned int gen;
+	/** Destination address */
+	inet_addr_t addr;
+	/** Route found for the destination (@c NULL if there is none) */
+	inet_sroute_t *sroute;
+} sroute_cache_entry_t;
+
 static FIBRIL_MUTEX_INITIALIZE(sroute_list_lock);
 static LIST_INITIALIZE(sroute_list);
 static sysarg_t sroute_id = 0;
 
+/** Protects sroute_trie (held for reading during lookups) */
+static FIBRIL_RWLOCK_INITIALIZE(sroute_trie_lock);
+static sroute_trie_t sroute_trie;
+/** The trie could not be built, lookups fall back to sroute_list */
+static bool sroute_trie_invalid = false;
+
+/** Serializes writers of sroute_cache and sroute_cache_gen */
+static FIBRIL_MUTEX_INITIALIZE(sroute_cache_lock);
+static sroute_cache_entry_t sroute_cache[SROUTE_CACHE_SIZE];
+/** Incremented on every routing table change, entries of older
+ * generations are not valid. Starts at one so that the zeroed entries
+ * are not valid either.
+ */
+static unsigned int sroute_cache_gen = 1;
+
+/** Get bit @a idx of a trie key (bit 0 is the most significant). */
+static unsigned int sroute_key_bit(const uint8_t *key, unsigned int idx)
+{
+	return (key[idx / 8] >> (7 - (idx % 8))) & 1;
+}
+
+/** Get number of leading bits two keys have in common.
+ *
+ * @param a    First key
+ * @param b    Second key
+ * @param bits Maximum number of bits to compare
+ * @return     Length of the common prefix, at most @a bits
+ */
+static unsigned int sroute_key_match(const uint8_t *a, const uint8_t *b,
+    unsigned int bits)
+{
+	unsigned int i = 0;
+
+	while (i + 8 <= bits && a[i / 8] == b[i / 8])
+		i += 8;
+
+	while (i < bits && sroute_key_bit(a, i) == sroute_key_bit(b, i))
+		i++;
+
+	return i;
+}
+
+/** Convert address to a trie key.
+ *
+ * @param addr Address
+ * @param key  Place to store the key
+ * @return     IP version of the address
+ */
+static ip_ver_t sroute_addr_key(const inet_addr_t *addr, uint8_t *key)
+{
+	addr32_t v4;
+	ip_ver_t ver;
+
+	memset(key, 0, SROUTE_KEY_BITS / 8);
+	ver = inet_addr_get(addr, &v4, NULL);
+
+	switch (ver) {
+	case ip_v4:
+		key[0] = (v4 >> 24) & 0xff;
+		key[1] = (v4 >> 16) & 0xff;
+		key[2] = (v4 >> 8) & 0xff;
+		key[3] = v4 & 0xff;
+		break;
+	case ip_v6:
+		memcpy(key, addr->addr6, 16);
+		break;
+	default:
+		break;
+	}
+
+	return ver;
+}
+
+/** Get the trie holding routes of the destination network of a route.
+ *
+ * @param sroute Route
+ * @param key    Place to store the destination network key
+ * @param plen   Place to store the destination network prefix length
+ * @return       Place holding the trie root or @c NULL if the
+ *               destination is neither IPv4 nor IPv6
+ */
+static sroute_node_t **sroute_dest_trie(inet_sroute_t *sroute, uint8_t *key,
+    unsigned int *plen)
+{
+	inet_addr_t dest;
+	uint8_t dest_bits;
+
+	ip_ver_t ver = inet_naddr_get(&sroute->dest, NULL, NULL, &dest_bits);
+	inet_naddr_addr(&sroute->dest, &dest);
+	(void) sroute_addr_key(&dest, key);
+
+	switch (ver) {
+	case ip_v4:
+		*plen = min(dest_bits, 32);
+		return &sroute_trie.v4;
+	case ip_v6:
+		*plen = min(dest_bits, 128);
+		return &sroute_trie.v6;
+	default:
+		return NULL;
+	}
+}
+
+static sroute_node_t *sroute_node_new(const uint8_t *key, unsigned int plen,
+    inet_sroute_t *sroute)
+{
+	sroute_node_t *node = calloc(1, sizeof(sroute_node_t));
+	if (node == NULL)
+		return NULL;
+
+	/* Copy the first plen bits of the key */
+	memcpy(node->key, key, (plen + 7) / 8);
+	if (plen % 8 != 0)
+		node->key[plen / 8] &= (uint8_t) (0xff << (8 - plen % 8));
+
+	node->plen = plen;
+	node->sroute = sroute;
+	node->nroutes = (sroute != NULL) ? 1 : 0;
+	return node;
+}
+
+static void sroute_node_destroy(sroute_node_t *node)
+{
+	if (node == NULL)
+		return;
+
+	sroute_node_destroy(node->child[0]);
+	sroute_node_destroy(node->child[1]);
+	free(node);
+}
+
+/** Insert route into a trie.
+ *
+ * If there already is a route with the same destination, the trie
+ * is left unchanged so that the route added first takes precedence.
+ *
+ * @param np     Place holding the trie root
+ * @param key    Destination network
+ * @param plen   Destination network prefix length
+ * @param sroute Route
+ * @return       EOK on success, ENOMEM if out of memory
+ */
+static errno_t sroute_trie_insert(sroute_node_t **np, const uint8_t *key,
+    unsigned int plen, inet_sroute_t *sroute)
+{
+	sroute_node_t *node;
+	sroute_node_t *leaf;
+	unsigned int m;
+
+	while (*np != NULL) {
+		node = *np;
+		m = sroute_key_match(node->key, key, min(node->plen, plen));
+
+		if (m == node->plen) {
+			if (m == plen) {
+				if (node->sroute == NULL)
+					node->sroute = sroute;
+				node->nroutes++;
+				return EOK;
+			}
+
+			/* Node prefix is a prefix of the key, descend */
+			np = &node->child[sroute_key_bit(key, node->plen)];
+			continue;
+		}
+
+		if (m == plen) {
+			/* The new route covers the node */
+			leaf = sroute_node_new(key, plen, sroute);
+			if (leaf == NULL)
+				return ENOMEM;
+
+			leaf->child[sroute_key_bit(node->key, plen)] = node;
+			*np = leaf;
+			return EOK;
+		}
+
+		/* The prefixes diverge at bit m, insert a branch node */
+		leaf = sroute_node_new(key, plen, sroute);
+		if (leaf == NULL)
+			return ENOMEM;
+
+		sroute_node_t *branch = sroute_node_new(key, m, NULL);
+		if (branch == NULL) {
+			free(leaf);
+			return ENOMEM;
+		}
+
+		branch->child[sroute_key_bit(key, m)] = leaf;
+		branch->child[sroute_key_bit(node->key, m)] = node;
+		*np = branch;
+		return EOK;
+	}
+
+	*np = sroute_node_new(key, plen, sroute);
+	if (*np == NULL)
+		return ENOMEM;
+
+	return EOK;
+}
+
+/** Find the trie node with exactly the given prefix.
+ *
+ * @param node Trie root
+ * @param key  Destination network
+ * @param plen Destination network prefix length
+ * @return     Node or @c NULL if there is none
+ */
+static sroute_node_t *sroute_trie_find(sroute_node_t *node, const uint8_t *key,
+    unsigned int plen)
+{
+	while (node != NULL && node->plen <= plen) {
+		if (sroute_key_match(node->key, key, node->plen) < node->plen)
+			return NULL;
+
+		if (node->plen == plen)
+			return node;
+
+		node = node->child[sroute_key_bit(key, node->plen)];
+	}
+
+	return NULL;
+}
+
+/** Remove route from a trie.
+ *
+ * Nodes which are left without a route and with less than two children
+ * are removed on the way back, so that the trie stays path-compressed.
+ *
+ * @param np     Place holding the trie root
+ * @param key    Destination network
+ * @param plen   Destination network prefix length
+ * @param sroute Route being removed
+ * @param next   Remaining route with the same destination which takes
+ *               over if @a sroute is the one in the trie, or @c NULL
+ */
+static void sroute_trie_remove(sroute_node_t **np, const uint8_t *key,
+    unsigned int plen, inet_sroute_t *sroute, inet_sroute_t *next)
+{
+	sroute_node_t *node = *np;
+
+	if (node == NULL || node->plen > plen ||
+	    sroute_key_match(node->key, key, node->plen) < node->plen)
+		return;
+
+	if (node->plen < plen) {
+		sroute_trie_remove(&node->child[sroute_key_bit(key, node->plen)],
+		    key, plen, sroute, next);
+	} else {
+		if (node->nroutes > 0)
+			node->nroutes--;
+		if (node->sroute == sroute)
+			node->sroute = next;
+	}
+
+	if (node->sroute != NULL ||
+	    (node->child[0] != NULL && node->child[1] != NULL))
+		return;
+
+	*np = (node->child[0] != NULL) ? node->child[0] : node->child[1];
+	free(node);
+}
+
+/** Find the longest matching prefix in a trie.
+ *
+ * @param node Trie root
+ * @param key  Destination address
+ * @param bits Length of the address in bits
+ * @return     Most specific route or @c NULL if there is none
+ */
+static inet_sroute_t *sroute_trie_lookup(sroute_node_t *node,
+    const uint8_t *key, unsigned int bits)
+{
+	inet_sroute_t *best = NULL;
+
+	while (node != NULL) {
+		if (sroute_key_match(node->key, key, node->plen) < node->plen)
+			break;
+
+		if (node->sroute != NULL)
+			best = node->sroute;
+
+		if (node->plen >= bits)
+			break;
+
+		node = node->child[sroute_key_bit(key, node->plen)];
+	}
+
+	return best;
+}
+
+/** Destroy the routing tries and fall back to linear lookup.
+ *
+ * Called with sroute_trie_lock held for writing.
+ */
+static void sroute_trie_invalidate(void)
+{
+	log_msg(LOG_DEFAULT, LVL_ERROR, "Out of memory building "
+	    "routing table, using linear lookup.");
+
+	sroute_node_destroy(sroute_trie.v4);
+	sroute_node_destroy(sroute_trie.v6);
+	sroute_trie.v4 = NULL;
+	sroute_trie.v6 = NULL;
+	sroute_trie_invalid = true;
+}
+
+/** Build the routing tries from scratch.
+ *
+ * Only used to recover after the tries could not be updated for lack
+ * of memory. Called with sroute_list_lock held and sroute_trie_lock
+ * held for writing.
+ */
+static void sroute_trie_rebuild(void)
+{
+	uint8_t key[SROUTE_KEY_BITS / 8];
+	unsigned int plen;
+
+	sroute_trie_invalid = false;
+
+	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
+		sroute_node_t **root = sroute_dest_trie(sroute, key, &plen);
+		if (root == NULL)
+			continue;
+
+		if (sroute_trie_insert(root, key, plen, sroute) != EOK) {
+			sroute_trie_invalidate();
+			return;
+		}
+	}
+}
+
+/** Invalidate all route cache entries. */
+static void sroute_cache_invalidate(void)
+{
+	fibril_mutex_lock(&sroute_cache_lock);
+	write_barrier();
+	sroute_cache_gen++;
+	fibril_mutex_unlock(&sroute_cache_lock);
+}
+
+/** Look up a destination in the route cache without locking.
+ *
+ * @param idx     Cache index of the destination
+ * @param addr    Destination address
+ * @param rsroute Place to store the cached route (may be @c NULL)
+ * @return        @c true if the destination was found in the cache
+ */
+static bool sroute_cache_get(size_t idx, inet_addr_t *addr,
+    inet_sroute_t **rsroute)
+{
+	sroute_cache_entry_t *entry = &sroute_cache[idx];
+
+	unsigned int seq = ACCESS_ONCE(entry->seq);
+	read_barrier();
+
+	if ((seq & 1) != 0)
+		return false;
+
+	bool hit = (entry->gen == ACCESS_ONCE(sroute_cache_gen)) &&
+	    inet_addr_compare(&entry->addr, addr);
+	inet_sroute_t *sroute = entry->sroute;
+
+	read_barrier();
+	if (ACCESS_ONCE(entry->seq) != seq || !hit)
+		return false;
+
+	*rsroute = sroute;
+	return true;
+}
+
+/** Store a lookup result in the route cache.
+ *
+ * @param idx    Cache index of the destination
+ * @param gen    Cache generation at the start of the lookup
+ * @param addr   Destination address
+ * @param sroute Route found (may be @c NULL)
+ */
+static void sroute_cache_put(size_t idx, unsigned int gen, inet_addr_t *addr,
+    inet_sroute_t *sroute)
+{
+	sroute_cache_entry_t *entry = &sroute_cache[idx];
+
+	fibril_mutex_lock(&sroute_cache_lock);
+
+	/* Do not cache the result if the table changed in the meantime */
+	if (gen == sroute_cache_gen) {
+		ACCESS_ONCE(entry->seq)++;
+		write_barrier();
+
+		entry->gen = gen;
+		entry->addr = *addr;
+		entry->sroute = sroute;
+
+		write_barrier();
+		ACCESS_ONCE(entry->seq)++;
+	}
+
+	fibril_mutex_unlock(&sroute_cache_lock);
+}
+
+static size_t sroute_cache_index(const inet_addr_t *addr)
+{
+	uint32_t h = 0;
+
+	switch (addr->version) {
+	case ip_v4:
+		h = addr->addr;
+		break;
+	case ip_v6:
+		for (size_t i = 0; i < 16; i += 4) {
+			h ^= ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3];
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash_mix32(h) & (SROUTE_CACHE_SIZE - 1);
+}
+
 inet_sroute_t *inet_sroute_new(void)
 {
 	inet_sroute_t *sroute = calloc(1, sizeof(inet_sroute_t));
@@ -76,23 +555,95 @@ void inet_sroute_delete(inet_sroute_t *sroute)
 
 void inet_sroute_add(inet_sroute_t *sroute)
 {
+	uint8_t key[SROUTE_KEY_BITS / 8];
+	unsigned int plen;
+
 	fibril_mutex_lock(&sroute_list_lock);
 	list_append(&sroute->sroute_list, &sroute_list);
+
+	fibril_rwlock_write_lock(&sroute_trie_lock);
+
+	if (sroute_trie_invalid) {
+		sroute_trie_rebuild();
+	} else {
+		sroute_node_t **root = sroute_dest_trie(sroute, key, &plen);
+		if (root != NULL &&
+		    sroute_trie_insert(root, key, plen, sroute) != EOK)
+			sroute_trie_invalidate();
+	}
+
+	fibril_rwlock_write_unlock(&sroute_trie_lock);
+	sroute_cache_invalidate();
+
 	fibril_mutex_unlock(&sroute_list_lock);
 }
 
+/** Find the first route in sroute_list with a given destination.
+ *
+ * @param key  Destination network
+ * @param plen Destination network prefix length
+ * @return     Route or @c NULL if there is none
+ */
+static inet_sroute_t *sroute_list_find_dest(const uint8_t *key,
+    unsigned int plen)
+{
+	uint8_t skey[SROUTE_KEY_BITS / 8];
+	unsigned int splen;
+
+	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
+		if (sroute_dest_trie(sroute, skey, &splen) == NULL ||
+		    splen != plen)
+			continue;
+
+		if (sroute_key_match(skey, key, plen) == plen)
+			return sroute;
+	}
+
+	return NULL;
+}
+
 void inet_sroute_remove(inet_sroute_t *sroute)
 {
+	uint8_t key[SROUTE_KEY_BITS / 8];
+	unsigned int plen;
+
 	fibril_mutex_lock(&sroute_list_lock);
 	list_remove(&sroute->sroute_list);
+
+	fibril_rwlock_write_lock(&sroute_trie_lock);
+
+	if (sroute_trie_invalid) {
+		sroute_trie_rebuild();
+	} else {
+		sroute_node_t **root = sroute_dest_trie(sroute, key, &plen);
+		if (root != NULL) {
+			/*
+			 * Only search for a route taking over the destination
+			 * if there are more routes with the same destination.
+			 */
+			inet_sroute_t *next = NULL;
+			sroute_node_t *node = sroute_trie_find(*root, key, plen);
+			if (node != NULL && node->sroute == sroute &&
+			    node->nroutes > 1)
+				next = sroute_list_find_dest(key, plen);
+
+			sroute_trie_remove(root, key, plen, sroute, next);
+		}
+	}
+
+	fibril_rwlock_write_unlock(&sroute_trie_lock);
+	sroute_cache_invalidate();
+
 	fibril_mutex_unlock(&sroute_list_lock);
 }
 
-/** Find static route object matching address @a addr.
+/** Find static route object matching address @a addr by walking the list.
+ *
+ * Used only if the routing trie could not be built.
  *
  * @param addr	Address
  */
-inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
+static inet_sroute_t *inet_sroute_find_linear(inet_addr_t *addr)
 {
 	ip_ver_t addr_ver = inet_addr_get(addr, NULL, NULL);
 	
@@ -123,10 +674,57 @@ inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
 		}
 	}
 	
+	fibril_mutex_unlock(&sroute_list_lock);
+	
+	return best;
+}
+
+/** Find static route object matching address @a addr.
+ *
+ * The most specific route is looked up in the route cache first and
+ * then in the routing trie. Cache hits do not take any lock.
+ *
+ * @param addr	Address
+ */
+inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
+{
+	inet_sroute_t *best;
+	uint8_t key[SROUTE_KEY_BITS / 8];
+	size_t idx = sroute_cache_index(addr);
+	
+	if (sroute_cache_get(idx, addr, &best))
+		return best;
+	
+	unsigned int gen = ACCESS_ONCE(sroute_cache_gen);
+	read_barrier();
+	
+	ip_ver_t ver = sroute_addr_key(addr, key);
+	
+	fibril_rwlock_read_lock(&sroute_trie_lock);
+	
+	if (sroute_trie_invalid) {
+		fibril_rwlock_read_unlock(&sroute_trie_lock);
+		return inet_sroute_find_linear(addr);
+	}
+	
+	switch (ver) {
+	case ip_v4:
+		best = sroute_trie_lookup(sroute_trie.v4, key, 32);
+		break;
+	case ip_v6:
+		best = sroute_trie_lookup(sroute_trie.v6, key, 128);
+		break;
+	default:
+		best = NULL;
+		break;
+	}
+	
+	fibril_rwlock_read_unlock(&sroute_trie_lock);
+	
 	if (best == NULL)
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: Not found");
 	
-	fibril_mutex_unlock(&sroute_list_lock);
+	sroute_cache_put(idx, gen, addr, best);
 	
 	return best;
 }
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+
+#include "../inet_link.h"
+#include "../ndp.h"
+#include "../ntrans.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(ntrans);
+
+/*
+ * Stub link and NDP
+ *
+ * Replace sending of datagrams and solicitations so that the neighbor
+ * cache can be tested without a link. Datagrams carry a single byte
+ * identifying them.
+ */
+
+#define TEST_SENT_MAX  8
+
+/** Number of solicitations sent */
+static unsigned test_solicits;
+/** Whether the last solicitation was unicast */
+static bool test_solicit_unicast;
+/** Identifiers of the datagrams sent, in order */
+static uint8_t test_sent[TEST_SENT_MAX];
+static size_t test_sent_cnt;
+/** Link address the last datagram was sent to */
+static addr48_t test_sent_mac;
+
+errno_t ndp_send_solicitation(inet_link_t *ilink, addr128_t src_addr,
+    addr128_t ip_addr, const addr48_t mac_addr)
+{
+	test_solicits++;
+	test_solicit_unicast = (mac_addr != NULL);
+	return EOK;
+}
+
+errno_t inet_link_send_dgram6(inet_link_t *ilink, addr48_t ldest,
+    inet_dgram_t *dgram, uint8_t proto, uint8_t ttl, int df)
+{
+	PCUT_ASSERT_TRUE(test_sent_cnt < TEST_SENT_MAX);
+	PCUT_ASSERT_INT_EQUALS(1, dgram->size);
+
+	test_sent[test_sent_cnt++] = *(uint8_t *) dgram->data;
+	addr48(ldest, test_sent_mac);
+	return EOK;
+}
+
+/** Fake link, never used by the stubs */
+static inet_link_t test_ilink;
+
+static addr128_t test_src = {
+	0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1
+};
+
+static addr48_t test_mac = { 0x02, 0, 0, 0, 0, 1 };
+
+/** Set up a link-local neighbor address */
+static void test_addr(addr128_t addr, uint8_t last)
+{
+	memset(addr, 0, sizeof(addr128_t));
+	addr[0] = 0xfe;
+	addr[1] = 0x80;
+	addr[15] = last;
+}
+
+/** Send a datagram identified by @a id to a neighbor */
+static void test_send(addr128_t ip_addr, uint8_t id)
+{
+	inet_dgram_t dgram;
+
+	memset(&dgram, 0, sizeof(dgram));
+	dgram.data = &id;
+	dgram.size = 1;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_send_dgram(&test_ilink, test_src,
+	    ip_addr, &dgram, 0, 64, 0));
+}
+
+PCUT_TEST_BEFORE
+{
+	static bool initialized = false;
+
+	if (!initialized) {
+		PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_init());
+		initialized = true;
+	}
+
+	test_solicits = 0;
+	test_solicit_unicast = false;
+	test_sent_cnt = 0;
+}
+
+/** Entries are added, looked up and removed */
+PCUT_TEST(add_lookup_remove)
+{
+	addr128_t addr;
+	addr48_t mac;
+
+	test_addr(addr, 10);
+
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, ntrans_lookup(addr, mac));
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_add(addr, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_lookup(addr, mac));
+	PCUT_ASSERT_TRUE(addr48_compare(mac, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_remove(addr));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, ntrans_lookup(addr, mac));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, ntrans_remove(addr));
+}
+
+/** Datagrams to a known neighbor are sent right away */
+PCUT_TEST(send_resolved)
+{
+	addr128_t addr;
+
+	test_addr(addr, 11);
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_add(addr, test_mac));
+
+	test_send(addr, 1);
+
+	PCUT_ASSERT_INT_EQUALS(0, test_solicits);
+	PCUT_ASSERT_INT_EQUALS(1, test_sent_cnt);
+	PCUT_ASSERT_INT_EQUALS(1, test_sent[0]);
+	PCUT_ASSERT_TRUE(addr48_compare(test_sent_mac, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_remove(addr));
+}
+
+/** Datagrams wait for resolution and are sent once it completes */
+PCUT_TEST(send_queued)
+{
+	addr128_t addr;
+	addr48_t mac;
+
+	test_addr(addr, 12);
+
+	test_send(addr, 1);
+
+	/* One multicast solicitation, nothing sent yet */
+	PCUT_ASSERT_INT_EQUALS(1, test_solicits);
+	PCUT_ASSERT_FALSE(test_solicit_unicast);
+	PCUT_ASSERT_INT_EQUALS(0, test_sent_cnt);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, ntrans_lookup(addr, mac));
+
+	/* Resolution is in progress, no more solicitations */
+	test_send(addr, 2);
+	PCUT_ASSERT_INT_EQUALS(1, test_solicits);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_add(addr, test_mac));
+
+	PCUT_ASSERT_INT_EQUALS(2, test_sent_cnt);
+	PCUT_ASSERT_INT_EQUALS(1, test_sent[0]);
+	PCUT_ASSERT_INT_EQUALS(2, test_sent[1]);
+	PCUT_ASSERT_TRUE(addr48_compare(test_sent_mac, test_mac));
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_remove(addr));
+}
+
+/** Only the newest datagrams are kept while resolving */
+PCUT_TEST(queue_limit)
+{
+	addr128_t addr;
+	uint8_t id;
+
+	test_addr(addr, 13);
+
+	for (id = 1; id <= 5; id++)
+		test_send(addr, id);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_add(addr, test_mac));
+
+	PCUT_ASSERT_INT_EQUALS(3, test_sent_cnt);
+	PCUT_ASSERT_INT_EQUALS(3, test_sent[0]);
+	PCUT_ASSERT_INT_EQUALS(4, test_sent[1]);
+	PCUT_ASSERT_INT_EQUALS(5, test_sent[2]);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_remove(addr));
+}
+
+/** Removing an unresolved entry drops its queue */
+PCUT_TEST(remove_queued)
+{
+	addr128_t addr;
+
+	test_addr(addr, 14);
+
+	test_send(addr, 1);
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_remove(addr));
+
+	/* A new resolution starts from scratch */
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_add(addr, test_mac));
+	PCUT_ASSERT_INT_EQUALS(0, test_sent_cnt);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, ntrans_remove(addr));
+}
+
+PCUT_EXPORT(ntrans);
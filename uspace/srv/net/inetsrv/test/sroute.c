@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <inet/addr.h>
+#include <pcut/pcut.h>
+
+#include "../inetsrv.h"
+#include "../sroute.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(sroute);
+
+/** Create and add an IPv4 static route */
+static inet_sroute_t *test_sroute_add(uint8_t a, uint8_t b, uint8_t c,
+    uint8_t d, uint8_t prefix)
+{
+	inet_sroute_t *sroute = inet_sroute_new();
+	PCUT_ASSERT_NOT_NULL(sroute);
+
+	inet_naddr(&sroute->dest, a, b, c, d, prefix);
+	inet_sroute_add(sroute);
+	return sroute;
+}
+
+/** Remove and destroy a static route */
+static void test_sroute_remove(inet_sroute_t *sroute)
+{
+	inet_sroute_remove(sroute);
+	inet_sroute_delete(sroute);
+}
+
+/** Look up the route for an IPv4 address */
+static inet_sroute_t *test_sroute_find(uint8_t a, uint8_t b, uint8_t c,
+    uint8_t d)
+{
+	inet_addr_t addr;
+
+	inet_addr(&addr, a, b, c, d);
+	return inet_sroute_find(&addr);
+}
+
+/** The most specific route is found */
+PCUT_TEST(longest_prefix)
+{
+	inet_sroute_t *rdef = test_sroute_add(0, 0, 0, 0, 0);
+	inet_sroute_t *r8 = test_sroute_add(10, 0, 0, 0, 8);
+	inet_sroute_t *r16 = test_sroute_add(10, 1, 0, 0, 16);
+	inet_sroute_t *r24 = test_sroute_add(10, 1, 2, 0, 24);
+	inet_sroute_t *r32 = test_sroute_add(10, 1, 2, 3, 32);
+
+	PCUT_ASSERT_EQUALS(r32, test_sroute_find(10, 1, 2, 3));
+	PCUT_ASSERT_EQUALS(r24, test_sroute_find(10, 1, 2, 4));
+	PCUT_ASSERT_EQUALS(r16, test_sroute_find(10, 1, 3, 1));
+	PCUT_ASSERT_EQUALS(r8, test_sroute_find(10, 2, 0, 1));
+	PCUT_ASSERT_EQUALS(rdef, test_sroute_find(192, 168, 0, 1));
+
+	/* Repeated lookups are served from the cache */
+	PCUT_ASSERT_EQUALS(r24, test_sroute_find(10, 1, 2, 4));
+	PCUT_ASSERT_EQUALS(rdef, test_sroute_find(192, 168, 0, 1));
+
+	test_sroute_remove(r32);
+	test_sroute_remove(r24);
+	test_sroute_remove(r16);
+	test_sroute_remove(r8);
+	test_sroute_remove(rdef);
+}
+
+/** Routes inserted out of order and with diverging prefixes */
+PCUT_TEST(diverging_prefixes)
+{
+	inet_sroute_t *ra = test_sroute_add(192, 168, 1, 0, 24);
+	inet_sroute_t *rb = test_sroute_add(192, 168, 2, 0, 24);
+	inet_sroute_t *rc = test_sroute_add(192, 168, 0, 0, 16);
+
+	PCUT_ASSERT_EQUALS(ra, test_sroute_find(192, 168, 1, 10));
+	PCUT_ASSERT_EQUALS(rb, test_sroute_find(192, 168, 2, 10));
+	PCUT_ASSERT_EQUALS(rc, test_sroute_find(192, 168, 3, 10));
+	PCUT_ASSERT_NULL(test_sroute_find(192, 169, 1, 10));
+
+	test_sroute_remove(rc);
+	test_sroute_remove(rb);
+	test_sroute_remove(ra);
+}
+
+/** Adding and removing routes invalidates cached lookups */
+PCUT_TEST(invalidation)
+{
+	inet_sroute_t *r8 = test_sroute_add(10, 0, 0, 0, 8);
+
+	PCUT_ASSERT_EQUALS(r8, test_sroute_find(10, 1, 2, 3));
+	PCUT_ASSERT_NULL(test_sroute_find(172, 16, 0, 1));
+
+	/* A more specific route overrides the cached result */
+	inet_sroute_t *r16 = test_sroute_add(10, 1, 0, 0, 16);
+	PCUT_ASSERT_EQUALS(r16, test_sroute_find(10, 1, 2, 3));
+
+	/* A cached negative result is dropped */
+	inet_sroute_t *rdef = test_sroute_add(0, 0, 0, 0, 0);
+	PCUT_ASSERT_EQUALS(rdef, test_sroute_find(172, 16, 0, 1));
+
+	/* Removing the more specific route falls back to the covering one */
+	test_sroute_remove(r16);
+	PCUT_ASSERT_EQUALS(r8, test_sroute_find(10, 1, 2, 3));
+
+	test_sroute_remove(r8);
+	PCUT_ASSERT_EQUALS(rdef, test_sroute_find(10, 1, 2, 3));
+
+	test_sroute_remove(rdef);
+	PCUT_ASSERT_NULL(test_sroute_find(10, 1, 2, 3));
+	PCUT_ASSERT_NULL(test_sroute_find(172, 16, 0, 1));
+}
+
+/** Of several routes to the same destination, the first one added wins */
+PCUT_TEST(same_destination)
+{
+	inet_sroute_t *r1 = test_sroute_add(10, 0, 0, 0, 8);
+	inet_sroute_t *r2 = test_sroute_add(10, 0, 0, 0, 8);
+	inet_sroute_t *r3 = test_sroute_add(10, 0, 0, 0, 8);
+
+	PCUT_ASSERT_EQUALS(r1, test_sroute_find(10, 1, 1, 1));
+
+	/* Removing a route which is not in use changes nothing */
+	test_sroute_remove(r2);
+	PCUT_ASSERT_EQUALS(r1, test_sroute_find(10, 1, 1, 1));
+
+	/* The next route takes over */
+	test_sroute_remove(r1);
+	PCUT_ASSERT_EQUALS(r3, test_sroute_find(10, 1, 1, 1));
+
+	test_sroute_remove(r3);
+	PCUT_ASSERT_NULL(test_sroute_find(10, 1, 1, 1));
+}
+
+/** IPv4 and IPv6 routes do not interfere */
+PCUT_TEST(ipv6)
+{
+	inet_sroute_t *r4 = test_sroute_add(0, 0, 0, 0, 0);
+	inet_sroute_t *r6 = inet_sroute_new();
+	PCUT_ASSERT_NOT_NULL(r6);
+
+	inet_naddr6(&r6->dest, 0x2001, 0xdb8, 0, 0, 0, 0, 0, 0, 32);
+	inet_sroute_add(r6);
+
+	inet_addr_t addr;
+	inet_addr6(&addr, 0x2001, 0xdb8, 1, 2, 3, 4, 5, 6);
+	PCUT_ASSERT_EQUALS(r6, inet_sroute_find(&addr));
+
+	inet_addr6(&addr, 0x2001, 0xdb9, 1, 2, 3, 4, 5, 6);
+	PCUT_ASSERT_NULL(inet_sroute_find(&addr));
+
+	PCUT_ASSERT_EQUALS(r4, test_sroute_find(32, 1, 13, 184));
+
+	test_sroute_remove(r6);
+	test_sroute_remove(r4);
+}
+
+PCUT_EXPORT(sroute);
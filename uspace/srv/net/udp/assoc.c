@@ -34,7 +34,10 @@
  * @file UDP associations
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
+#include <assert.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <fibril_synch.h>
@@ -50,13 +53,119 @@
 #include "udp_inet.h"
 #include "udp_type.h"
 
-static LIST_INITIALIZE(assoc_list);
-static FIBRIL_MUTEX_INITIALIZE(assoc_list_lock);
+/*
+ * The association map allocates ports and detects conflicts. Incoming
+ * datagrams are demultiplexed using two hash tables instead: associations
+ * with a remote endpoint are keyed by the full endpoint pair, listening
+ * associations by their local port.
+ */
+static FIBRIL_RWLOCK_INITIALIZE(assoc_list_lock);
+static hash_table_t assoc_conn_table;
+static hash_table_t assoc_listen_table;
 static amap_t *amap;
 
 static udp_assoc_t *udp_assoc_find_ref(inet_ep2_t *);
 static errno_t udp_assoc_queue_msg(udp_assoc_t *, inet_ep2_t *, udp_msg_t *);
 
+static size_t udp_addr_hash(inet_addr_t *addr)
+{
+	size_t hash = addr->version;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (size_t i = 0; i < 16; i += 4) {
+			hash = hash_combine(hash, ((uint32_t) addr->addr6[i] << 24) |
+			    ((uint32_t) addr->addr6[i + 1] << 16) |
+			    ((uint32_t) addr->addr6[i + 2] << 8) |
+			    addr->addr6[i + 3]);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+static size_t udp_epp_hash(inet_ep2_t *epp)
+{
+	size_t hash = udp_addr_hash(&epp->remote.addr);
+
+	hash = hash_combine(hash, epp->remote.port);
+	hash = hash_combine(hash, udp_addr_hash(&epp->local.addr));
+	return hash_combine(hash, epp->local.port);
+}
+
+static size_t assoc_conn_hash(const ht_link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item, udp_assoc_t, hlink);
+	return udp_epp_hash(&assoc->ident);
+}
+
+static size_t assoc_conn_key_hash(void *key)
+{
+	return udp_epp_hash((inet_ep2_t *) key);
+}
+
+static bool assoc_conn_key_equal(void *key, const ht_link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item, udp_assoc_t, hlink);
+	inet_ep2_t *epp = (inet_ep2_t *) key;
+
+	return assoc->ident.remote.port == epp->remote.port &&
+	    assoc->ident.local.port == epp->local.port &&
+	    inet_addr_compare(&assoc->ident.remote.addr, &epp->remote.addr) &&
+	    inet_addr_compare(&assoc->ident.local.addr, &epp->local.addr);
+}
+
+static bool assoc_conn_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item1, udp_assoc_t, hlink);
+	return assoc_conn_key_equal(&assoc->ident, item2);
+}
+
+static size_t assoc_listen_hash(const ht_link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item, udp_assoc_t, hlink);
+	return hash_mix(assoc->ident.local.port);
+}
+
+static size_t assoc_listen_key_hash(void *key)
+{
+	return hash_mix(*(uint16_t *) key);
+}
+
+static bool assoc_listen_key_equal(void *key, const ht_link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item, udp_assoc_t, hlink);
+	return assoc->ident.local.port == *(uint16_t *) key;
+}
+
+static bool assoc_listen_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	udp_assoc_t *assoc = hash_table_get_inst(item1, udp_assoc_t, hlink);
+	return assoc_listen_key_equal(&assoc->ident.local.port, item2);
+}
+
+static hash_table_ops_t assoc_conn_ops = {
+	.hash = assoc_conn_hash,
+	.key_hash = assoc_conn_key_hash,
+	.key_equal = assoc_conn_key_equal,
+	.equal = assoc_conn_equal,
+	.remove_callback = NULL
+};
+
+static hash_table_ops_t assoc_listen_ops = {
+	.hash = assoc_listen_hash,
+	.key_hash = assoc_listen_key_hash,
+	.key_equal = assoc_listen_key_equal,
+	.equal = assoc_listen_equal,
+	.remove_callback = NULL
+};
+
 /** Initialize associations. */
 errno_t udp_assocs_init(void)
 {
@@ -68,9 +177,32 @@ errno_t udp_assocs_init(void)
 		return ENOMEM;
 	}
 
+	if (!hash_table_create(&assoc_conn_table, 0, 0, &assoc_conn_ops)) {
+		amap_destroy(amap);
+		return ENOMEM;
+	}
+
+	if (!hash_table_create(&assoc_listen_table, 0, 0, &assoc_listen_ops)) {
+		hash_table_destroy(&assoc_conn_table);
+		amap_destroy(amap);
+		return ENOMEM;
+	}
+
 	return EOK;
 }
 
+/** Finalize associations. */
+void udp_assocs_fini(void)
+{
+	assert(hash_table_empty(&assoc_conn_table));
+	assert(hash_table_empty(&assoc_listen_table));
+
+	hash_table_destroy(&assoc_listen_table);
+	hash_table_destroy(&assoc_conn_table);
+	amap_destroy(amap);
+	amap = NULL;
+}
+
 /** Create new association structure.
  *
  * @param epp		Endpoint pair (will be copied)
@@ -173,8 +305,8 @@ void udp_assoc_delete(udp_assoc_t *assoc)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: udp_assoc_delete(%p)", assoc->name, assoc);
 
 	assert(assoc->deleted == false);
-	udp_assoc_delref(assoc);
 	assoc->deleted = true;
+	udp_assoc_delref(assoc);
 }
 
 /** Enlist association.
@@ -187,18 +319,25 @@ errno_t udp_assoc_add(udp_assoc_t *assoc)
 	errno_t rc;
 
 	udp_assoc_addref(assoc);
-	fibril_mutex_lock(&assoc_list_lock);
+	fibril_rwlock_write_lock(&assoc_list_lock);
 
 	rc = amap_insert(amap, &assoc->ident, assoc, af_allow_system, &aepp);
 	if (rc != EOK) {
 		udp_assoc_delref(assoc);
-		fibril_mutex_unlock(&assoc_list_lock);
+		fibril_rwlock_write_unlock(&assoc_list_lock);
 		return rc;
 	}
 
 	assoc->ident = aepp;
-	list_append(&assoc->link, &assoc_list);
-	fibril_mutex_unlock(&assoc_list_lock);
+
+	/* The association map only allows fully specified remote endpoints */
+	assoc->connected = !inet_addr_is_any(&aepp.remote.addr);
+	if (assoc->connected)
+		hash_table_insert(&assoc_conn_table, &assoc->hlink);
+	else
+		hash_table_insert(&assoc_listen_table, &assoc->hlink);
+
+	fibril_rwlock_write_unlock(&assoc_list_lock);
 
 	return EOK;
 }
@@ -209,10 +348,13 @@ errno_t udp_assoc_add(udp_assoc_t *assoc)
  */
 void udp_assoc_remove(udp_assoc_t *assoc)
 {
-	fibril_mutex_lock(&assoc_list_lock);
+	fibril_rwlock_write_lock(&assoc_list_lock);
 	amap_remove(amap, &assoc->ident);
-	list_remove(&assoc->link);
-	fibril_mutex_unlock(&assoc_list_lock);
+	if (assoc->connected)
+		hash_table_remove_item(&assoc_conn_table, &assoc->hlink);
+	else
+		hash_table_remove_item(&assoc_listen_table, &assoc->hlink);
+	fibril_rwlock_write_unlock(&assoc_list_lock);
 	udp_assoc_delref(assoc);
 }
 
@@ -404,35 +546,76 @@ static errno_t udp_assoc_queue_msg(udp_assoc_t *assoc, inet_ep2_t *epp,
 	return EOK;
 }
 
+/** Find listening association best matching an endpoint pair.
+ *
+ * Same precedence as amap_find_match() is used: an association bound to
+ * the local address comes first, then one bound to the local link, then
+ * one listening on all addresses.
+ *
+ * @param epp	Endpoint pair
+ * @return	Association or NULL if not found.
+ */
+static udp_assoc_t *udp_assoc_find_listener(inet_ep2_t *epp)
+{
+	udp_assoc_t *link_match = NULL;
+	udp_assoc_t *any_match = NULL;
+	ht_link_t *first;
+	ht_link_t *link;
+
+	first = hash_table_find(&assoc_listen_table, &epp->local.port);
+	link = first;
+	while (link != NULL) {
+		udp_assoc_t *assoc = hash_table_get_inst(link, udp_assoc_t,
+		    hlink);
+
+		if (!inet_addr_is_any(&assoc->ident.local.addr)) {
+			if (inet_addr_compare(&assoc->ident.local.addr,
+			    &epp->local.addr))
+				return assoc;
+		} else if (assoc->ident.local_link != 0) {
+			if (epp->local_link != 0 &&
+			    assoc->ident.local_link == epp->local_link)
+				link_match = assoc;
+		} else {
+			any_match = assoc;
+		}
+
+		/* Listeners sharing the port are visited in a cycle */
+		link = hash_table_find_next(&assoc_listen_table, link);
+		if (link == first)
+			break;
+	}
+
+	return (link_match != NULL) ? link_match : any_match;
+}
+
 /** Find association structure for specified endpoint pair.
  *
  * An association is uniquely identified by an endpoint pair. Look up our
- * association map and return association structure based on endpoint pair.
- * The association reference count is bumped by one.
+ * association tables and return association structure based on endpoint
+ * pair. The association reference count is bumped by one.
  *
  * @param epp	Endpoint pair
  * @return	Association structure or NULL if not found.
  */
 static udp_assoc_t *udp_assoc_find_ref(inet_ep2_t *epp)
 {
-	errno_t rc;
-	void *arg;
 	udp_assoc_t *assoc;
+	ht_link_t *link;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_assoc_find_ref(%p)", epp);
-	fibril_mutex_lock(&assoc_list_lock);
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "udp_assoc_find_ref(%p)", epp);
+	fibril_rwlock_read_lock(&assoc_list_lock);
 
-	rc = amap_find_match(amap, epp, &arg);
-	if (rc != EOK) {
-		assert(rc == ENOENT);
-		fibril_mutex_unlock(&assoc_list_lock);
-		return NULL;
-	}
+	link = hash_table_find(&assoc_conn_table, epp);
+	if (link != NULL)
+		assoc = hash_table_get_inst(link, udp_assoc_t, hlink);
+	else
+		assoc = udp_assoc_find_listener(epp);
 
-	assoc = (udp_assoc_t *)arg;
-	udp_assoc_addref(assoc);
+	if (assoc != NULL)
+		udp_assoc_addref(assoc);
 
-	fibril_mutex_unlock(&assoc_list_lock);
+	fibril_rwlock_read_unlock(&assoc_list_lock);
 	return assoc;
 }
 
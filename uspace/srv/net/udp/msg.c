@@ -34,7 +34,10 @@
  * @file UDP message
  */
 
+#include <errno.h>
 #include <io/log.h>
+#include <ipc/udp.h>
+#include <mem.h>
 #include <stdlib.h>
 
 #include "msg.h"
@@ -53,6 +56,68 @@ void udp_msg_delete(udp_msg_t *msg)
 	free(msg);
 }
 
+/** Get message from a part of batch buffer.
+ *
+ * The buffer is shared with the client, which can modify it at any time.
+ * The header is therefore copied and validated first. @a msg then points
+ * to the message data in the buffer.
+ *
+ * @param part Part of batch buffer (UDP_BATCH_PART_SIZE bytes)
+ * @param off  Offset of the message, updated to the next message
+ * @param bmsg Place to store copy of message header
+ * @param msg  Place to store message (data is not copied)
+ *
+ * @return EOK on success, EINVAL if the message does not fit in @a part
+ */
+errno_t udp_msg_batch_get(void *part, size_t *off, udp_batch_msg_t *bmsg,
+    udp_msg_t *msg)
+{
+	uint8_t *bp = (uint8_t *) part + *off;
+
+	if (UDP_BATCH_PART_SIZE - *off < sizeof(udp_batch_msg_t))
+		return EINVAL;
+
+	memcpy(bmsg, bp, sizeof(udp_batch_msg_t));
+
+	if (bmsg->size > UDP_BATCH_PART_SIZE - *off - sizeof(udp_batch_msg_t))
+		return EINVAL;
+
+	msg->data = bp + sizeof(udp_batch_msg_t);
+	msg->data_size = bmsg->size;
+
+	*off += UDP_BATCH_MSG_SPACE(bmsg->size);
+	return EOK;
+}
+
+/** Put message into a part of batch buffer.
+ *
+ * @param part     Part of batch buffer (UDP_BATCH_PART_SIZE bytes)
+ * @param off      Offset to put the message at, updated past the message
+ * @param assoc_id Association ID
+ * @param remote   Remote endpoint
+ * @param msg      Message
+ *
+ * @return @c true on success, @c false if the message does not fit
+ */
+bool udp_msg_batch_put(void *part, size_t *off, sysarg_t assoc_id,
+    inet_ep_t *remote, udp_msg_t *msg)
+{
+	size_t space = UDP_BATCH_MSG_SPACE(msg->data_size);
+
+	if (space > UDP_BATCH_PART_SIZE - *off)
+		return false;
+
+	udp_batch_msg_t *bmsg = (udp_batch_msg_t *) ((uint8_t *) part + *off);
+	bmsg->assoc_id = assoc_id;
+	bmsg->remote = *remote;
+	bmsg->has_remote = true;
+	bmsg->size = msg->data_size;
+	memcpy(bmsg + 1, msg->data, msg->data_size);
+
+	*off += space;
+	return true;
+}
+
 /**
  * @}
  */
@@ -35,10 +35,17 @@
 #ifndef MSG_H
 #define MSG_H
 
+#include <inet/endpoint.h>
+#include <ipc/udp.h>
+#include <stdbool.h>
 #include "udp_type.h"
 
 extern udp_msg_t *udp_msg_new(void);
 extern void udp_msg_delete(udp_msg_t *);
+extern errno_t udp_msg_batch_get(void *, size_t *, udp_batch_msg_t *,
+    udp_msg_t *);
+extern bool udp_msg_batch_put(void *, size_t *, sysarg_t, inet_ep_t *,
+    udp_msg_t *);
 
 #endif
 
@@ -34,6 +34,7 @@
  * @file HelenOS service implementation
  */
 
+#include <as.h>
 #include <async.h>
 #include <errno.h>
 #include <inet/endpoint.h>
@@ -667,6 +668,147 @@ static void udp_rmsg_discard_srv(udp_client_t *client, ipc_callid_t iid,
 	async_answer_0(iid, EOK);
 }
 
+/** Set up buffer for batched transfers.
+ *
+ * Handle client request to share a buffer used for sending and receiving
+ * multiple messages per request.
+ *
+ * @param client   UDP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void udp_batch_share_srv(udp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	ipc_callid_t callid;
+	size_t size;
+	unsigned int flags;
+	void *batch;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_batch_share_srv()");
+
+	if (!async_share_out_receive(&callid, &size, &flags)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	if (size != UDP_BATCH_SIZE || client->batch != NULL) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	errno_t rc = async_share_out_finalize(callid, &batch);
+	if (rc != EOK || batch == AS_MAP_FAILED) {
+		async_answer_0(iid, ENOMEM);
+		return;
+	}
+
+	client->batch = batch;
+	async_answer_0(iid, EOK);
+}
+
+/** Send batch of messages via association.
+ *
+ * Handle client request to send messages placed in the sending part of
+ * the batch buffer. Sending stops at the first message that fails.
+ *
+ * @param client   UDP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void udp_assoc_send_batch_srv(udp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	udp_cassoc_t *cassoc;
+	udp_batch_msg_t bmsg;
+	udp_msg_t msg;
+	size_t count;
+	size_t sent;
+	size_t off;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_assoc_send_batch_srv()");
+
+	if (client->batch == NULL) {
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	rc = udp_cassoc_get(client, IPC_GET_ARG1(*icall), &cassoc);
+	if (rc != EOK) {
+		async_answer_0(iid, rc);
+		return;
+	}
+
+	count = IPC_GET_ARG2(*icall);
+	off = 0;
+
+	for (sent = 0; sent < count; sent++) {
+		rc = udp_msg_batch_get(client->batch + UDP_BATCH_TX_OFF, &off,
+		    &bmsg, &msg);
+		if (rc != EOK)
+			break;
+
+		rc = udp_assoc_send(cassoc->assoc,
+		    bmsg.has_remote ? &bmsg.remote : NULL, &msg);
+		if (rc != EOK)
+			break;
+	}
+
+	async_answer_1(iid, rc, sent);
+}
+
+/** Receive batch of messages.
+ *
+ * Handle client request to move as many received messages as fit into
+ * the receiving part of the batch buffer.
+ *
+ * @param client   UDP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void udp_rmsg_recv_batch_srv(udp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	udp_crcv_queue_entry_t *enext;
+	size_t count;
+	size_t off;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_rmsg_recv_batch_srv()");
+
+	if (client->batch == NULL) {
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	enext = udp_rmsg_get_next(client);
+	if (enext == NULL) {
+		async_answer_0(iid, ENOENT);
+		return;
+	}
+
+	count = 0;
+	off = 0;
+
+	while (enext != NULL) {
+		/* Messages that do not fit are left for UDP_RMSG_READ */
+		if (!udp_msg_batch_put(client->batch + UDP_BATCH_RX_OFF, &off,
+		    enext->cassoc->id, &enext->epp.remote, enext->msg))
+			break;
+
+		list_remove(&enext->link);
+		udp_msg_delete(enext->msg);
+		free(enext);
+
+		count++;
+		enext = udp_rmsg_get_next(client);
+	}
+
+	async_answer_1(iid, EOK, count);
+}
+
 /** Handle UDP client connection.
  *
  * @param iid   Connect call ID
@@ -684,6 +826,7 @@ static void udp_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "udp_client_conn()");
 
 	client.sess = NULL;
+	client.batch = NULL;
 	list_initialize(&client.cassoc);
 	list_initialize(&client.crcv_queue);
 
@@ -726,6 +869,15 @@ static void udp_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case UDP_RMSG_DISCARD:
 			udp_rmsg_discard_srv(&client, callid, &call);
 			break;
+		case UDP_BATCH_SHARE:
+			udp_batch_share_srv(&client, callid, &call);
+			break;
+		case UDP_ASSOC_SEND_BATCH:
+			udp_assoc_send_batch_srv(&client, callid, &call);
+			break;
+		case UDP_RMSG_RECV_BATCH:
+			udp_rmsg_recv_batch_srv(&client, callid, &call);
+			break;
 		default:
 			async_answer_0(callid, ENOTSUP);
 			break;
@@ -745,6 +897,9 @@ static void udp_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 
 	if (client.sess != NULL)
 		async_hangup(client.sess);
+
+	if (client.batch != NULL)
+		as_area_destroy(client.batch);
 }
 
 /** Initialize UDP service.
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+
+#include "../assoc.h"
+#include "../msg.h"
+#include "../udp_type.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(assoc);
+
+/** Association the last message was delivered to */
+static udp_assoc_t *test_rcv_assoc;
+/** Number of messages delivered */
+static unsigned test_rcv_count;
+
+static void test_recv_msg(void *arg, inet_ep2_t *epp, udp_msg_t *msg)
+{
+	test_rcv_assoc = (udp_assoc_t *) arg;
+	test_rcv_count++;
+	udp_msg_delete(msg);
+}
+
+static udp_assoc_cb_t test_assoc_cb = {
+	.recv_msg = test_recv_msg
+};
+
+/** Create and add association.
+ *
+ * @param local_addr Local address or 0 for any
+ * @param local_port Local port
+ * @param local_link Local link or 0 for any
+ * @param remote_addr Remote address or 0 for none
+ * @param remote_port Remote port
+ */
+static udp_assoc_t *test_assoc_add(uint8_t local_addr, uint16_t local_port,
+    service_id_t local_link, uint8_t remote_addr, uint16_t remote_port)
+{
+	udp_assoc_t *assoc;
+	inet_ep2_t epp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	if (local_addr != 0)
+		inet_addr(&epp.local.addr, 10, 0, 0, local_addr);
+	epp.local.port = local_port;
+	epp.local_link = local_link;
+	if (remote_addr != 0) {
+		inet_addr(&epp.remote.addr, 10, 0, 0, remote_addr);
+		epp.remote.port = remote_port;
+	}
+
+	assoc = udp_assoc_new(&epp, &test_assoc_cb, NULL);
+	PCUT_ASSERT_NOT_NULL(assoc);
+	assoc->cb_arg = assoc;
+
+	rc = udp_assoc_add(assoc);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	return assoc;
+}
+
+static void test_assoc_remove(udp_assoc_t *assoc)
+{
+	udp_assoc_remove(assoc);
+	udp_assoc_delete(assoc);
+}
+
+/** Deliver datagram and return the association that received it.
+ *
+ * @return Association or NULL if the datagram was dropped
+ */
+static udp_assoc_t *test_deliver(uint8_t local_addr, uint16_t local_port,
+    service_id_t local_link, uint8_t remote_addr, uint16_t remote_port)
+{
+	inet_ep2_t epp;
+	udp_msg_t *msg;
+	unsigned count;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 10, 0, 0, local_addr);
+	epp.local.port = local_port;
+	epp.local_link = local_link;
+	inet_addr(&epp.remote.addr, 10, 0, 0, remote_addr);
+	epp.remote.port = remote_port;
+
+	msg = udp_msg_new();
+	PCUT_ASSERT_NOT_NULL(msg);
+
+	count = test_rcv_count;
+	test_rcv_assoc = NULL;
+	udp_assoc_received(&epp, msg);
+
+	if (test_rcv_count == count)
+		return NULL;
+
+	PCUT_ASSERT_INT_EQUALS(count + 1, test_rcv_count);
+	return test_rcv_assoc;
+}
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-udp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = udp_assocs_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_rcv_count = 0;
+}
+
+PCUT_TEST_AFTER
+{
+	udp_assocs_fini();
+}
+
+/** Datagram for unknown port is dropped */
+PCUT_TEST(no_match)
+{
+	udp_assoc_t *assoc = test_assoc_add(0, 2000, 0, 0, 0);
+
+	PCUT_ASSERT_NULL(test_deliver(1, 2001, 1, 2, 3000));
+	PCUT_ASSERT_EQUALS(assoc, test_deliver(1, 2000, 1, 2, 3000));
+
+	test_assoc_remove(assoc);
+	PCUT_ASSERT_NULL(test_deliver(1, 2000, 1, 2, 3000));
+}
+
+/** Association with remote endpoint takes precedence over a listener */
+PCUT_TEST(connected)
+{
+	udp_assoc_t *listener = test_assoc_add(0, 2000, 0, 0, 0);
+	udp_assoc_t *conn = test_assoc_add(1, 2000, 0, 2, 3000);
+
+	PCUT_ASSERT_EQUALS(conn, test_deliver(1, 2000, 1, 2, 3000));
+
+	/* Remote port, remote address or local address differ */
+	PCUT_ASSERT_EQUALS(listener, test_deliver(1, 2000, 1, 2, 3001));
+	PCUT_ASSERT_EQUALS(listener, test_deliver(1, 2000, 1, 3, 3000));
+	PCUT_ASSERT_EQUALS(listener, test_deliver(4, 2000, 1, 2, 3000));
+
+	test_assoc_remove(conn);
+	PCUT_ASSERT_EQUALS(listener, test_deliver(1, 2000, 1, 2, 3000));
+	test_assoc_remove(listener);
+}
+
+/** Listener bound to address comes first, then link, then any address */
+PCUT_TEST(listener_precedence)
+{
+	udp_assoc_t *any = test_assoc_add(0, 2000, 0, 0, 0);
+	udp_assoc_t *link = test_assoc_add(0, 2000, 5, 0, 0);
+	udp_assoc_t *addr = test_assoc_add(1, 2000, 0, 0, 0);
+
+	PCUT_ASSERT_EQUALS(addr, test_deliver(1, 2000, 5, 2, 3000));
+	PCUT_ASSERT_EQUALS(addr, test_deliver(1, 2000, 6, 2, 3000));
+	PCUT_ASSERT_EQUALS(link, test_deliver(4, 2000, 5, 2, 3000));
+	PCUT_ASSERT_EQUALS(any, test_deliver(4, 2000, 6, 2, 3000));
+
+	test_assoc_remove(addr);
+	PCUT_ASSERT_EQUALS(link, test_deliver(1, 2000, 5, 2, 3000));
+
+	test_assoc_remove(link);
+	PCUT_ASSERT_EQUALS(any, test_deliver(1, 2000, 5, 2, 3000));
+
+	test_assoc_remove(any);
+	PCUT_ASSERT_NULL(test_deliver(1, 2000, 5, 2, 3000));
+}
+
+/** Many associations sharing the local endpoint */
+PCUT_TEST(many)
+{
+	udp_assoc_t *assoc[64];
+	size_t i;
+
+	for (i = 0; i < 64; i++)
+		assoc[i] = test_assoc_add(1, 2000, 0, 2, 3000 + i);
+
+	for (i = 0; i < 64; i++) {
+		PCUT_ASSERT_EQUALS(assoc[i],
+		    test_deliver(1, 2000, 1, 2, 3000 + i));
+	}
+
+	PCUT_ASSERT_NULL(test_deliver(1, 2000, 1, 2, 3000 + 64));
+
+	for (i = 0; i < 64; i += 2)
+		test_assoc_remove(assoc[i]);
+
+	for (i = 0; i < 64; i++) {
+		PCUT_ASSERT_EQUALS((i % 2) != 0 ? assoc[i] : NULL,
+		    test_deliver(1, 2000, 1, 2, 3000 + i));
+	}
+
+	for (i = 1; i < 64; i += 2)
+		test_assoc_remove(assoc[i]);
+}
+
+PCUT_EXPORT(assoc);
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <ipc/udp.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../msg.h"
+#include "../udp_type.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(msg);
+
+/** Part of batch buffer, aligned like the shared buffer */
+static sysarg_t test_part[UDP_BATCH_PART_SIZE / sizeof(sysarg_t)];
+
+static void test_ep(inet_ep_t *ep, uint8_t addr, uint16_t port)
+{
+	inet_ep_init(ep);
+	inet_addr(&ep->addr, 10, 0, 0, addr);
+	ep->port = port;
+}
+
+/** Messages put into batch buffer are read back unchanged */
+PCUT_TEST(put_get)
+{
+	uint8_t data[100];
+	udp_batch_msg_t bmsg;
+	udp_msg_t msg;
+	inet_ep_t remote;
+	size_t off;
+	size_t i;
+	errno_t rc;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	/* Sizes that need padding and an empty message */
+	off = 0;
+	for (i = 0; i < 3; i++) {
+		test_ep(&remote, i + 1, 3000 + i);
+		msg.data = data;
+		msg.data_size = 13 * i;
+		PCUT_ASSERT_TRUE(udp_msg_batch_put(test_part, &off, 42 + i,
+		    &remote, &msg));
+		PCUT_ASSERT_INT_EQUALS(0, off % sizeof(sysarg_t));
+	}
+
+	size_t end = off;
+	off = 0;
+	for (i = 0; i < 3; i++) {
+		rc = udp_msg_batch_get(test_part, &off, &bmsg, &msg);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		test_ep(&remote, i + 1, 3000 + i);
+		PCUT_ASSERT_INT_EQUALS(42 + i, bmsg.assoc_id);
+		PCUT_ASSERT_TRUE(bmsg.has_remote);
+		PCUT_ASSERT_TRUE(inet_addr_compare(&remote.addr,
+		    &bmsg.remote.addr));
+		PCUT_ASSERT_INT_EQUALS(remote.port, bmsg.remote.port);
+		PCUT_ASSERT_INT_EQUALS(13 * i, msg.data_size);
+		PCUT_ASSERT_INT_EQUALS(0, memcmp(data, msg.data, 13 * i));
+	}
+
+	PCUT_ASSERT_INT_EQUALS(end, off);
+}
+
+/** Putting stops at the first message that does not fit */
+PCUT_TEST(put_full)
+{
+	uint8_t *data;
+	udp_batch_msg_t bmsg;
+	udp_msg_t msg;
+	inet_ep_t remote;
+	size_t count;
+	size_t off;
+	errno_t rc;
+
+	data = calloc(1, UDP_BATCH_PART_SIZE);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	test_ep(&remote, 1, 3000);
+	msg.data = data;
+	msg.data_size = 1000;
+
+	off = 0;
+	count = 0;
+	while (udp_msg_batch_put(test_part, &off, 1, &remote, &msg))
+		count++;
+
+	PCUT_ASSERT_INT_EQUALS(UDP_BATCH_PART_SIZE /
+	    UDP_BATCH_MSG_SPACE(1000), count);
+	PCUT_ASSERT_TRUE(UDP_BATCH_PART_SIZE - off < UDP_BATCH_MSG_SPACE(1000));
+
+	/* Message larger than the whole part never fits */
+	off = 0;
+	msg.data_size = UDP_BATCH_PART_SIZE;
+	PCUT_ASSERT_FALSE(udp_msg_batch_put(test_part, &off, 1, &remote,
+	    &msg));
+	PCUT_ASSERT_INT_EQUALS(0, off);
+
+	/* Message filling the part exactly */
+	msg.data_size = UDP_BATCH_PART_SIZE - sizeof(udp_batch_msg_t);
+	PCUT_ASSERT_TRUE(udp_msg_batch_put(test_part, &off, 1, &remote,
+	    &msg));
+	PCUT_ASSERT_INT_EQUALS(UDP_BATCH_PART_SIZE, off);
+
+	off = 0;
+	rc = udp_msg_batch_get(test_part, &off, &bmsg, &msg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(UDP_BATCH_PART_SIZE, off);
+
+	/* Nothing more to get */
+	rc = udp_msg_batch_get(test_part, &off, &bmsg, &msg);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	free(data);
+}
+
+/** Message with size reaching past the buffer is rejected */
+PCUT_TEST(get_bad_size)
+{
+	udp_batch_msg_t *hdr;
+	udp_batch_msg_t bmsg;
+	udp_msg_t msg;
+	size_t off;
+	errno_t rc;
+
+	hdr = (udp_batch_msg_t *) test_part;
+	memset(hdr, 0, sizeof(udp_batch_msg_t));
+
+	hdr->size = UDP_BATCH_PART_SIZE - sizeof(udp_batch_msg_t) + 1;
+	off = 0;
+	rc = udp_msg_batch_get(test_part, &off, &bmsg, &msg);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	PCUT_ASSERT_INT_EQUALS(0, off);
+
+	/* Huge size must not wrap around */
+	hdr->size = SIZE_MAX;
+	rc = udp_msg_batch_get(test_part, &off, &bmsg, &msg);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* Header itself does not fit */
+	off = UDP_BATCH_PART_SIZE - sizeof(udp_batch_msg_t) + sizeof(sysarg_t);
+	rc = udp_msg_batch_get(test_part, &off, &bmsg, &msg);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+PCUT_EXPORT(msg);
@@ -35,6 +35,7 @@
 #ifndef UDP_TYPE_H
 #define UDP_TYPE_H
 
+#include <adt/hash_table.h>
 #include <async.h>
 #include <fibril.h>
 #include <fibril_synch.h>
@@ -99,7 +100,10 @@ typedef struct {
  */
 typedef struct {
 	char *name;
-	link_t link;
+	/** Link to connected or listening association table */
+	ht_link_t hlink;
+	/** Association has a remote endpoint (is in the connected table) */
+	bool connected;
 
 	/** Association identification (endpoint pair) */
 	inet_ep2_t ident;
@@ -173,6 +177,8 @@ typedef struct udp_client {
 	list_t cassoc; /* of udp_cassoc_t */
 	/** Client receive queue */
 	list_t crcv_queue;
+	/** Buffer shared by client for batched transfers or @c NULL */
+	void *batch;
 } udp_client_t;
 
 #endif
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup ipcbench
+ * @{
+ */
+/**
+ * @file
+ * Echo server for the IPC benchmark
+ *
+ * Every request is handled with the least possible work so that the
+ * benchmark measures the cost of the IPC primitives themselves.
+ */
+
+#include <as.h>
+#include <async.h>
+#include <errno.h>
+#include <ipc/ipcbench.h>
+#include <ipc/ns.h>
+#include <ipc/services.h>
+#include <loc.h>
+#include <ns.h>
+#include <stdio.h>
+#include <str_error.h>
+#include <task.h>
+
+#define NAME  "ipcbench-echo"
+
+/** Source and sink of data transfers */
+static uint8_t data_buf[IPCBENCH_DATA_MAX];
+
+/** Area shared in to clients */
+static void *share_area;
+
+static void ipcbench_echo_data_read(ipc_callid_t iid)
+{
+	ipc_callid_t callid;
+	size_t size;
+
+	if (!async_data_read_receive(&callid, &size)) {
+		async_answer_0(callid, EREFUSED);
+		async_answer_0(iid, EREFUSED);
+		return;
+	}
+
+	if (size > IPCBENCH_DATA_MAX) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	errno_t rc = async_data_read_finalize(callid, data_buf, size);
+	async_answer_0(iid, rc);
+}
+
+static void ipcbench_echo_data_write(ipc_callid_t iid)
+{
+	ipc_callid_t callid;
+	size_t size;
+
+	if (!async_data_write_receive(&callid, &size)) {
+		async_answer_0(callid, EREFUSED);
+		async_answer_0(iid, EREFUSED);
+		return;
+	}
+
+	if (size > IPCBENCH_DATA_MAX) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	errno_t rc = async_data_write_finalize(callid, data_buf, size);
+	async_answer_0(iid, rc);
+}
+
+static void ipcbench_echo_share_in(ipc_callid_t iid)
+{
+	ipc_callid_t callid;
+	size_t size;
+
+	if (!async_share_in_receive(&callid, &size)) {
+		async_answer_0(callid, EREFUSED);
+		async_answer_0(iid, EREFUSED);
+		return;
+	}
+
+	if (size > IPCBENCH_DATA_MAX) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	errno_t rc = async_share_in_finalize(callid, share_area,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	async_answer_0(iid, rc);
+}
+
+static void ipcbench_echo_share_out(ipc_callid_t iid)
+{
+	ipc_callid_t callid;
+	size_t size;
+	unsigned int flags;
+	void *area;
+
+	if (!async_share_out_receive(&callid, &size, &flags)) {
+		async_answer_0(callid, EREFUSED);
+		async_answer_0(iid, EREFUSED);
+		return;
+	}
+
+	errno_t rc = async_share_out_finalize(callid, &area);
+	if ((rc != EOK) || (area == AS_MAP_FAILED)) {
+		async_answer_0(iid, ENOMEM);
+		return;
+	}
+
+	as_area_destroy(area);
+	async_answer_0(iid, EOK);
+}
+
+static void ipcbench_echo_forward(ipc_callid_t iid)
+{
+	async_sess_t *sess = ns_session_get();
+	if (sess == NULL) {
+		async_answer_0(iid, EIO);
+		return;
+	}
+
+	async_exch_t *exch = async_exchange_begin(sess);
+	errno_t rc = async_forward_fast(iid, exch, NS_PING, 0, 0, IPC_FF_NONE);
+	async_exchange_end(exch);
+
+	if (rc != EOK)
+		async_answer_0(iid, rc);
+}
+
+static void ipcbench_echo_connection(ipc_callid_t iid, ipc_call_t *icall,
+    void *arg)
+{
+	/* Accept the connection */
+	async_answer_0(iid, EOK);
+
+	while (true) {
+		ipc_call_t call;
+		ipc_callid_t callid = async_get_call(&call);
+
+		if (!IPC_GET_IMETHOD(call)) {
+			async_answer_0(callid, EOK);
+			break;
+		}
+
+		switch (IPC_GET_IMETHOD(call)) {
+		case IPCBENCH_PING:
+			async_answer_0(callid, EOK);
+			break;
+		case IPCBENCH_ECHO:
+			async_answer_5(callid, EOK, IPC_GET_ARG1(call),
+			    IPC_GET_ARG2(call), IPC_GET_ARG3(call),
+			    IPC_GET_ARG4(call), IPC_GET_ARG5(call));
+			break;
+		case IPCBENCH_DATA_READ:
+			ipcbench_echo_data_read(callid);
+			break;
+		case IPCBENCH_DATA_WRITE:
+			ipcbench_echo_data_write(callid);
+			break;
+		case IPCBENCH_SHARE_IN:
+			ipcbench_echo_share_in(callid);
+			break;
+		case IPCBENCH_SHARE_OUT:
+			ipcbench_echo_share_out(callid);
+			break;
+		case IPCBENCH_FORWARD:
+			ipcbench_echo_forward(callid);
+			break;
+		default:
+			async_answer_0(callid, EINVAL);
+			break;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	service_id_t sid;
+	errno_t rc;
+
+	printf("%s: IPC benchmark echo server\n", NAME);
+
+	share_area = as_area_create(AS_AREA_ANY, IPCBENCH_DATA_MAX,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (share_area == AS_MAP_FAILED) {
+		printf("%s: Failed creating shared area.\n", NAME);
+		return ENOMEM;
+	}
+
+	async_set_fallback_port_handler(ipcbench_echo_connection, NULL);
+
+	rc = loc_server_register(NAME);
+	if (rc != EOK) {
+		printf("%s: Failed registering server: %s\n", NAME, str_error(rc));
+		return rc;
+	}
+
+	rc = loc_service_register(SERVICE_NAME_IPCBENCH, &sid);
+	if (rc != EOK) {
+		printf("%s: Failed registering service: %s\n", NAME, str_error(rc));
+		return rc;
+	}
+
+	printf("%s: Accepting connections\n", NAME);
+	task_retval(0);
+	async_manager();
+
+	/* Not reached */
+	return 0;
+}
+
+/** @}
+ */
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <pcut/pcut.h>
+#include <stdio.h>
+
+#include "../vfs.h"
+
+PCUT_INIT
+
+PCUT_TEST_SUITE(dcache);
+
+/** Maximum number of cached names, as in vfs_dcache.c */
+#define TEST_DCACHE_MAX	1024
+
+enum {
+	test_fs_handle = 1,
+	test_service_id = 10,
+	/** Index of the root directory */
+	test_root = 1
+};
+
+static vfs_triplet_t test_triplet(fs_index_t index)
+{
+	vfs_triplet_t tri = {
+		.fs_handle = test_fs_handle,
+		.service_id = test_service_id,
+		.index = index
+	};
+
+	return tri;
+}
+
+/** Cache name @a name found in directory @a dir with index @a index */
+static void test_insert(fs_index_t dir, const char *name, fs_index_t index,
+    vfs_node_type_t type)
+{
+	vfs_triplet_t parent = test_triplet(dir);
+	vfs_lookup_res_t res = {
+		.triplet = test_triplet(index),
+		.type = type,
+		.size = 0
+	};
+
+	vfs_dcache_insert(&parent, name, &res, vfs_dcache_generation());
+}
+
+/** Cache the fact that name @a name does not exist in directory @a dir */
+static void test_insert_negative(fs_index_t dir, const char *name)
+{
+	vfs_triplet_t parent = test_triplet(dir);
+
+	vfs_dcache_insert(&parent, name, NULL, vfs_dcache_generation());
+}
+
+static errno_t test_find(fs_index_t dir, const char *name,
+    vfs_lookup_res_t *res)
+{
+	vfs_triplet_t parent = test_triplet(dir);
+
+	return vfs_dcache_lookup(&parent, name, res);
+}
+
+/** Check that @a name in @a dir is cached as node @a index */
+static void test_found(fs_index_t dir, const char *name,
+    fs_index_t index)
+{
+	vfs_lookup_res_t res;
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(dir, name, &res));
+	PCUT_ASSERT_INT_EQUALS(test_fs_handle, res.triplet.fs_handle);
+	PCUT_ASSERT_INT_EQUALS(test_service_id, res.triplet.service_id);
+	PCUT_ASSERT_INT_EQUALS(index, res.triplet.index);
+}
+
+static void test_invalidate(fs_index_t dir, const char *name)
+{
+	vfs_triplet_t parent = test_triplet(dir);
+
+	vfs_dcache_invalidate(&parent, name);
+}
+
+PCUT_TEST_BEFORE
+{
+	static bool initialized = false;
+	vfs_pair_t pair = {
+		.fs_handle = test_fs_handle,
+		.service_id = test_service_id
+	};
+
+	if (!initialized) {
+		PCUT_ASSERT_TRUE(vfs_dcache_init());
+		initialized = true;
+	}
+
+	vfs_dcache_flush(&pair);
+}
+
+/** Positive and negative entries are found, others are not */
+PCUT_TEST(lookup)
+{
+	vfs_lookup_res_t res;
+
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "a", &res));
+
+	test_insert(test_root, "a", 2, VFS_NODE_FILE);
+	test_insert_negative(test_root, "b");
+
+	test_found(test_root, "a", 2);
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(test_root, "a", &res));
+	PCUT_ASSERT_INT_EQUALS(VFS_NODE_FILE, res.type);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "b", &res));
+
+	/* Same name in another directory */
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(2, "a", &res));
+	/* Names are case sensitive and not prefixes */
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "A", &res));
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "ab", &res));
+}
+
+/** Result of a lookup that raced with an invalidation is not cached */
+PCUT_TEST(stale_insert)
+{
+	vfs_triplet_t parent = test_triplet(test_root);
+	vfs_lookup_res_t res = {
+		.triplet = test_triplet(2),
+		.type = VFS_NODE_FILE,
+		.size = 0
+	};
+	unsigned gen;
+
+	gen = vfs_dcache_generation();
+	test_invalidate(test_root, "a");
+	vfs_dcache_insert(&parent, "a", &res, gen);
+
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "a", &res));
+}
+
+/** Creating a name replaces its negative entry */
+PCUT_TEST(create)
+{
+	vfs_lookup_res_t res;
+
+	test_insert_negative(test_root, "a");
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "a", &res));
+
+	/* VFS invalidates the name after the file system created it */
+	test_invalidate(test_root, "a");
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "a", &res));
+
+	test_insert(test_root, "a", 2, VFS_NODE_FILE);
+	test_found(test_root, "a", 2);
+}
+
+/** Unlinking a file or a directory */
+PCUT_TEST(unlink)
+{
+	vfs_triplet_t dir = test_triplet(3);
+	vfs_lookup_res_t res;
+
+	test_insert(test_root, "file", 2, VFS_NODE_FILE);
+	test_insert(test_root, "dir", 3, VFS_NODE_DIRECTORY);
+	test_insert(3, "x", 4, VFS_NODE_FILE);
+	test_insert_negative(3, "y");
+
+	/* Unlink the file */
+	test_invalidate(test_root, "file");
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "file", &res));
+	test_found(test_root, "dir", 3);
+
+	/*
+	 * Unlink the directory. The names inside it go as well, the index
+	 * may be reused by the file system.
+	 */
+	test_invalidate(test_root, "dir");
+	vfs_dcache_invalidate_dir(&dir);
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "dir", &res));
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(3, "x", &res));
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(3, "y", &res));
+}
+
+/** Renaming a name goes through link and unlink */
+PCUT_TEST(rename)
+{
+	vfs_lookup_res_t res;
+
+	test_insert(test_root, "old", 2, VFS_NODE_FILE);
+	test_insert(test_root, "dir", 3, VFS_NODE_DIRECTORY);
+	test_insert_negative(3, "new");
+	test_insert(test_root, "other", 4, VFS_NODE_FILE);
+
+	/* Link the node under the new name, then unlink the old name */
+	test_invalidate(3, "new");
+	test_invalidate(test_root, "old");
+
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(3, "new", &res));
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "old", &res));
+	test_found(test_root, "dir", 3);
+	test_found(test_root, "other", 4);
+
+	/* The next lookups cache the new state */
+	test_insert(3, "new", 2, VFS_NODE_FILE);
+	test_insert_negative(test_root, "old");
+	test_found(3, "new", 2);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "old", &res));
+}
+
+/** Unmounting drops the names in and of the file system instance */
+PCUT_TEST(flush)
+{
+	vfs_triplet_t mp = test_triplet(3);
+	vfs_triplet_t root = {
+		.fs_handle = test_fs_handle + 1,
+		.service_id = test_service_id,
+		.index = 0
+	};
+	vfs_pair_t pair = {
+		.fs_handle = root.fs_handle,
+		.service_id = root.service_id
+	};
+	vfs_lookup_res_t res = {
+		.triplet = root,
+		.type = VFS_NODE_DIRECTORY,
+		.size = 0
+	};
+
+	/* Name of the mounted root and a name inside the mounted instance */
+	test_insert(test_root, "mnt", 3, VFS_NODE_DIRECTORY);
+	vfs_dcache_insert(&mp, "root", &res, vfs_dcache_generation());
+	vfs_dcache_insert(&root, "x", NULL, vfs_dcache_generation());
+
+	vfs_dcache_flush(&pair);
+
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, vfs_dcache_lookup(&mp, "root", &res));
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, vfs_dcache_lookup(&root, "x", &res));
+	test_found(test_root, "mnt", 3);
+}
+
+/** Size of a dropped node is copied into its entries */
+PCUT_TEST(node_update)
+{
+	vfs_node_t node;
+	vfs_lookup_res_t res;
+
+	test_insert(test_root, "a", 2, VFS_NODE_FILE);
+	test_insert(3, "b", 2, VFS_NODE_FILE);
+
+	node.fs_handle = test_fs_handle;
+	node.service_id = test_service_id;
+	node.index = 2;
+	node.size = 42;
+	vfs_dcache_node_update(&node);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(test_root, "a", &res));
+	PCUT_ASSERT_INT_EQUALS(42, res.size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(3, "b", &res));
+	PCUT_ASSERT_INT_EQUALS(42, res.size);
+}
+
+/** Node with two names in one directory, i.e. a hard link */
+PCUT_TEST(hard_link)
+{
+	vfs_node_t node;
+	vfs_lookup_res_t res;
+
+	test_insert(test_root, "a", 2, VFS_NODE_FILE);
+	test_insert(test_root, "b", 2, VFS_NODE_FILE);
+	test_insert(test_root, "c", 3, VFS_NODE_FILE);
+
+	node.fs_handle = test_fs_handle;
+	node.service_id = test_service_id;
+	node.index = 2;
+	node.size = 42;
+	vfs_dcache_node_update(&node);
+
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(test_root, "a", &res));
+	PCUT_ASSERT_INT_EQUALS(42, res.size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(test_root, "b", &res));
+	PCUT_ASSERT_INT_EQUALS(42, res.size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(test_root, "c", &res));
+	PCUT_ASSERT_INT_EQUALS(0, res.size);
+
+	/* Unlinking one name leaves the other */
+	test_invalidate(test_root, "a");
+	node.size = 43;
+	vfs_dcache_node_update(&node);
+
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "a", &res));
+	test_found(test_root, "b", 2);
+	PCUT_ASSERT_ERRNO_VAL(EOK, test_find(test_root, "b", &res));
+	PCUT_ASSERT_INT_EQUALS(43, res.size);
+}
+
+/** Least recently used names are evicted */
+PCUT_TEST(lru)
+{
+	vfs_lookup_res_t res;
+	char name[16];
+	int i;
+
+	for (i = 0; i < TEST_DCACHE_MAX; i++) {
+		snprintf(name, sizeof(name), "%d", i);
+		test_insert_negative(test_root, name);
+	}
+
+	/* Use the first name so that the second one is the oldest */
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "0", &res));
+
+	test_insert_negative(test_root, "new");
+
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "new", &res));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "0", &res));
+	PCUT_ASSERT_ERRNO_VAL(EAGAIN, test_find(test_root, "1", &res));
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, test_find(test_root, "2", &res));
+}
+
+PCUT_EXPORT(dcache);
@@ -100,6 +100,22 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 	
+	/*
+	 * Initialize the name lookup cache.
+	 */
+	if (!vfs_dcache_init()) {
+		printf("%s: Failed to initialize name lookup cache\n", NAME);
+		return ENOMEM;
+	}
+	
+	/*
+	 * Initialize the pager's page cache.
+	 */
+	if (!vfs_pager_init()) {
+		printf("%s: Failed to initialize page cache\n", NAME);
+		return ENOMEM;
+	}
+	
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
@@ -122,6 +122,11 @@ typedef struct _vfs_node {
 	fibril_rwlock_t contents_rwlock;
 	
 	struct _vfs_node *mount;
+
+	/** Pages of the node held by the pager. */
+	list_t pager_pages;
+	/** Incremented whenever the pages are invalidated. */
+	unsigned pager_gen;
 } vfs_node_t;
 
 /**
@@ -143,6 +148,11 @@ typedef struct {
 
 	/** Append on write. */
 	bool append;
+
+	/** Access pattern advised by the client. */
+	vfs_advice_t advice;
+	/** End of the data already requested by read-ahead. */
+	aoff64_t ra_pos;
 } vfs_file_t;
 
 extern fibril_mutex_t nodes_mutex;
@@ -180,6 +190,16 @@ extern errno_t vfs_get_fstypes(vfs_fstypes_t *);
 extern errno_t vfs_lookup_internal(vfs_node_t *, char *, int, vfs_lookup_res_t *);
 extern errno_t vfs_link_internal(vfs_node_t *, char *, vfs_triplet_t *);
 
+extern bool vfs_dcache_init(void);
+extern unsigned vfs_dcache_generation(void);
+extern errno_t vfs_dcache_lookup(vfs_triplet_t *, const char *,
+    vfs_lookup_res_t *);
+extern void vfs_dcache_insert(vfs_triplet_t *, const char *,
+    vfs_lookup_res_t *, unsigned);
+extern void vfs_dcache_invalidate(vfs_triplet_t *, const char *);
+extern void vfs_dcache_invalidate_dir(vfs_triplet_t *);
+extern void vfs_dcache_flush(vfs_pair_t *);
+
 extern bool vfs_nodes_init(void);
 extern vfs_node_t *vfs_node_get(vfs_lookup_res_t *);
 extern vfs_node_t *vfs_node_peek(vfs_lookup_res_t *result);
@@ -197,21 +217,27 @@ extern errno_t vfs_wait_handle_internal(bool, int *);
 
 extern vfs_file_t *vfs_file_get(int);
 extern void vfs_file_put(vfs_file_t *);
+extern vfs_file_t *vfs_pager_file_get(sysarg_t);
 extern errno_t vfs_fd_assign(vfs_file_t *, int);
 extern errno_t vfs_fd_alloc(vfs_file_t **file, bool desc, int *);
 extern errno_t vfs_fd_free(int);
 
 extern void vfs_node_addref(vfs_node_t *);
 extern void vfs_node_delref(vfs_node_t *);
+extern void vfs_dcache_node_update(vfs_node_t *);
 extern errno_t vfs_open_node_remote(vfs_node_t *);
 
+extern errno_t vfs_op_advise(int fd, vfs_advice_t);
 extern errno_t vfs_op_clone(int oldfd, int newfd, bool desc, int *);
 extern errno_t vfs_op_fsprobe(const char *, service_id_t, vfs_fs_probe_info_t *);
 extern errno_t vfs_op_mount(int mpfd, unsigned servid, unsigned flags, unsigned instance, const char *opts, const char *fsname, int *outfd);
 extern errno_t vfs_op_mtab_get(void);
 extern errno_t vfs_op_open(int fd, int flags);
+extern errno_t vfs_op_pager_ref(int fd, sysarg_t *out_id);
 extern errno_t vfs_op_put(int fd);
 extern errno_t vfs_op_read(int fd, aoff64_t, size_t *out_bytes);
+extern errno_t vfs_op_readdir(int fd, aoff64_t, unsigned flags,
+    size_t *out_bytes, aoff64_t *out_pos);
 extern errno_t vfs_op_rename(int basefd, char *old, char *new);
 extern errno_t vfs_op_resize(int fd, int64_t size);
 extern errno_t vfs_op_stat(int fd);
@@ -225,6 +251,8 @@ extern errno_t vfs_op_write(int fd, aoff64_t, size_t *out_bytes);
 
 extern void vfs_register(ipc_callid_t, ipc_call_t *);
 
+extern bool vfs_pager_init(void);
+extern void vfs_pager_invalidate(vfs_node_t *);
 extern void vfs_page_in(ipc_callid_t, ipc_call_t *);
 
 typedef struct {
@@ -232,7 +260,8 @@ typedef struct {
 	size_t size;
 } rdwr_io_chunk_t;
 
-extern errno_t vfs_rdwr_internal(int, aoff64_t, bool, rdwr_io_chunk_t *);
+extern errno_t vfs_rdwr_internal(vfs_file_t *, aoff64_t, bool,
+    rdwr_io_chunk_t *);
 
 extern void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg);
 
@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2018 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file vfs_dcache.c
+ * @brief Name lookup cache.
+ *
+ * The cache remembers the result of looking up a single name in a directory,
+ * including the fact that the name does not exist. Paths whose components are
+ * all cached are resolved without asking the file system servers.
+ */
+
+#include "vfs.h"
+#include <stdlib.h>
+#include <str.h>
+#include <fibril_synch.h>
+#include <adt/hash_table.h>
+#include <adt/hash.h>
+#include <adt/list.h>
+#include <assert.h>
+
+/** Maximum number of cached names. */
+#define DCACHE_MAX	1024
+
+/** Cached result of a name lookup. */
+typedef struct {
+	/** Link in dcache_names, keyed by the parent and the name. */
+	ht_link_t nlink;
+	/** Link in dcache_children, keyed by the child. Positive only. */
+	ht_link_t clink;
+	/** Link in dcache_lru, most recently used first. */
+	link_t lru_link;
+
+	vfs_triplet_t parent;
+	char *name;
+	/** The name does not exist in the parent directory. */
+	bool negative;
+	/** Lookup result of a positive entry. */
+	vfs_lookup_res_t res;
+} vfs_dentry_t;
+
+typedef struct {
+	vfs_triplet_t *parent;
+	const char *name;
+} dcache_key_t;
+
+static FIBRIL_MUTEX_INITIALIZE(dcache_mutex);
+static hash_table_t dcache_names;
+static hash_table_t dcache_children;
+static LIST_INITIALIZE(dcache_lru);
+static size_t dcache_count;
+
+/** Incremented by each invalidation, see vfs_dcache_generation(). */
+static unsigned dcache_gen;
+
+static size_t triplet_hash(vfs_triplet_t *tri)
+{
+	size_t hash = hash_combine(tri->fs_handle, tri->index);
+	return hash_combine(hash, tri->service_id);
+}
+
+static bool triplet_equal(vfs_triplet_t *a, vfs_triplet_t *b)
+{
+	return a->fs_handle == b->fs_handle &&
+	    a->service_id == b->service_id && a->index == b->index;
+}
+
+static size_t names_key_hash(void *key)
+{
+	dcache_key_t *dkey = key;
+	size_t hash = triplet_hash(dkey->parent);
+	const char *c;
+
+	for (c = dkey->name; *c != '\0'; c++)
+		hash = hash_combine(hash, (uint8_t) *c);
+
+	return hash;
+}
+
+static size_t names_hash(const ht_link_t *item)
+{
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, nlink);
+	dcache_key_t key = {
+		.parent = &dentry->parent,
+		.name = dentry->name
+	};
+
+	return names_key_hash(&key);
+}
+
+static bool names_key_equal(void *key, const ht_link_t *item)
+{
+	dcache_key_t *dkey = key;
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, nlink);
+
+	return triplet_equal(dkey->parent, &dentry->parent) &&
+	    str_cmp(dkey->name, dentry->name) == 0;
+}
+
+static hash_table_ops_t names_ops = {
+	.hash = names_hash,
+	.key_hash = names_key_hash,
+	.key_equal = names_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL,
+};
+
+static size_t children_key_hash(void *key)
+{
+	return triplet_hash(key);
+}
+
+static size_t children_hash(const ht_link_t *item)
+{
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, clink);
+	return triplet_hash(&dentry->res.triplet);
+}
+
+static bool children_key_equal(void *key, const ht_link_t *item)
+{
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, clink);
+	return triplet_equal(key, &dentry->res.triplet);
+}
+
+static bool children_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	vfs_dentry_t *dentry = hash_table_get_inst(item1, vfs_dentry_t, clink);
+	return children_key_equal(&dentry->res.triplet, item2);
+}
+
+static hash_table_ops_t children_ops = {
+	.hash = children_hash,
+	.key_hash = children_key_hash,
+	.key_equal = children_key_equal,
+	.equal = children_equal,
+	.remove_callback = NULL,
+};
+
+/** Initialize the name lookup cache.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_dcache_init(void)
+{
+	if (!hash_table_create(&dcache_names, 0, 0, &names_ops))
+		return false;
+
+	if (!hash_table_create(&dcache_children, 0, 0, &children_ops)) {
+		hash_table_destroy(&dcache_names);
+		return false;
+	}
+
+	return true;
+}
+
+/** Remove an entry from the cache and free it.
+ *
+ * Must be called with dcache_mutex held.
+ */
+static void dcache_remove(vfs_dentry_t *dentry)
+{
+	hash_table_remove_item(&dcache_names, &dentry->nlink);
+	if (!dentry->negative)
+		hash_table_remove_item(&dcache_children, &dentry->clink);
+	list_remove(&dentry->lru_link);
+	dcache_count--;
+
+	free(dentry->name);
+	free(dentry);
+}
+
+/** Get the current generation of the cache.
+ *
+ * A caller that looks up a name in a file system server reads the generation
+ * before sending the request and passes it to vfs_dcache_insert(). The result
+ * is then only cached if no name has been invalidated in between, which
+ * could otherwise leave a stale entry behind.
+ *
+ * @return		Current generation.
+ */
+unsigned vfs_dcache_generation(void)
+{
+	unsigned gen;
+
+	fibril_mutex_lock(&dcache_mutex);
+	gen = dcache_gen;
+	fibril_mutex_unlock(&dcache_mutex);
+
+	return gen;
+}
+
+/** Look up a name in the cache.
+ *
+ * @param parent	Directory to look the name up in.
+ * @param name		Name to look up.
+ * @param res		Place to store the lookup result of a positive entry.
+ *
+ * @return		EOK if a positive entry was found, ENOENT if a negative
+ *			entry was found, EAGAIN if the name is not cached.
+ */
+errno_t vfs_dcache_lookup(vfs_triplet_t *parent, const char *name,
+    vfs_lookup_res_t *res)
+{
+	dcache_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+	errno_t rc = EAGAIN;
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	ht_link_t *item = hash_table_find(&dcache_names, &key);
+	if (item != NULL) {
+		vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t,
+		    nlink);
+
+		list_remove(&dentry->lru_link);
+		list_prepend(&dentry->lru_link, &dcache_lru);
+
+		if (dentry->negative) {
+			rc = ENOENT;
+		} else {
+			*res = dentry->res;
+			rc = EOK;
+		}
+	}
+
+	fibril_mutex_unlock(&dcache_mutex);
+	return rc;
+}
+
+/** Insert the result of a name lookup into the cache.
+ *
+ * @param parent	Directory the name was looked up in.
+ * @param name		Name that was looked up.
+ * @param res		Lookup result or NULL if the name does not exist.
+ * @param gen		Cache generation read before the lookup started.
+ */
+void vfs_dcache_insert(vfs_triplet_t *parent, const char *name,
+    vfs_lookup_res_t *res, unsigned gen)
+{
+	dcache_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	vfs_dentry_t *dentry = malloc(sizeof(vfs_dentry_t));
+	if (dentry == NULL)
+		return;
+
+	dentry->name = str_dup(name);
+	if (dentry->name == NULL) {
+		free(dentry);
+		return;
+	}
+
+	dentry->parent = *parent;
+	dentry->negative = (res == NULL);
+	if (res != NULL)
+		dentry->res = *res;
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	if (gen != dcache_gen || hash_table_find(&dcache_names, &key) != NULL) {
+		/* Stale result or somebody was faster. */
+		fibril_mutex_unlock(&dcache_mutex);
+		free(dentry->name);
+		free(dentry);
+		return;
+	}
+
+	if (dcache_count == DCACHE_MAX) {
+		vfs_dentry_t *victim = list_get_instance(list_last(&dcache_lru),
+		    vfs_dentry_t, lru_link);
+		dcache_remove(victim);
+	}
+
+	hash_table_insert(&dcache_names, &dentry->nlink);
+	if (!dentry->negative)
+		hash_table_insert(&dcache_children, &dentry->clink);
+	list_prepend(&dentry->lru_link, &dcache_lru);
+	dcache_count++;
+
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+/** Invalidate a name in the cache.
+ *
+ * This must be called whenever a name is created or removed.
+ *
+ * @param parent	Directory containing the name.
+ * @param name		Name to invalidate.
+ */
+void vfs_dcache_invalidate(vfs_triplet_t *parent, const char *name)
+{
+	dcache_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	dcache_gen++;
+	ht_link_t *item = hash_table_find(&dcache_names, &key);
+	if (item != NULL)
+		dcache_remove(hash_table_get_inst(item, vfs_dentry_t, nlink));
+
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+typedef struct {
+	vfs_pair_t *pair;
+	vfs_triplet_t *dir;
+} dcache_flush_arg_t;
+
+static bool dcache_flush_visitor(ht_link_t *item, void *arg)
+{
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, nlink);
+	dcache_flush_arg_t *fa = arg;
+	vfs_triplet_t *parent = &dentry->parent;
+
+	if (fa->dir != NULL) {
+		if (triplet_equal(parent, fa->dir))
+			dcache_remove(dentry);
+	} else if ((parent->fs_handle == fa->pair->fs_handle &&
+	    parent->service_id == fa->pair->service_id) ||
+	    (!dentry->negative &&
+	    dentry->res.triplet.fs_handle == fa->pair->fs_handle &&
+	    dentry->res.triplet.service_id == fa->pair->service_id)) {
+		dcache_remove(dentry);
+	}
+
+	return true;
+}
+
+/** Invalidate all names in a directory.
+ *
+ * This is needed when a directory is removed, as the file system may reuse
+ * its index for a new node.
+ *
+ * @param dir		Directory.
+ */
+void vfs_dcache_invalidate_dir(vfs_triplet_t *dir)
+{
+	dcache_flush_arg_t fa = {
+		.pair = NULL,
+		.dir = dir
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+	dcache_gen++;
+	hash_table_apply(&dcache_names, dcache_flush_visitor, &fa);
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+/** Invalidate all names of a file system instance.
+ *
+ * @param pair		File system instance being unmounted.
+ */
+void vfs_dcache_flush(vfs_pair_t *pair)
+{
+	dcache_flush_arg_t fa = {
+		.pair = pair,
+		.dir = NULL
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+	dcache_gen++;
+	hash_table_apply(&dcache_names, dcache_flush_visitor, &fa);
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+/** Update the cached size of a node.
+ *
+ * The size of a file can only change while VFS holds its node. Updating the
+ * positive entries when the node is dropped keeps them accurate.
+ *
+ * @param node		Node being dropped.
+ */
+void vfs_dcache_node_update(vfs_node_t *node)
+{
+	vfs_triplet_t tri = {
+		.fs_handle = node->fs_handle,
+		.service_id = node->service_id,
+		.index = node->index
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	/* A node has more names if it is hard-linked */
+	ht_link_t *first = hash_table_find(&dcache_children, &tri);
+	ht_link_t *item = first;
+	while (item != NULL) {
+		vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t,
+		    clink);
+		dentry->res.size = node->size;
+
+		/* The names of the node are visited in a cycle */
+		item = hash_table_find_next(&dcache_children, item);
+		if (item == first)
+			break;
+	}
+
+	fibril_mutex_unlock(&dcache_mutex);
+}
+
+/**
+ * @}
+ */
@@ -55,6 +55,10 @@ typedef struct {
 	fibril_condvar_t cv;
 	list_t passed_handles;
 	vfs_file_t **files;
+	/** Files kept open for paged areas. */
+	list_t pager_refs;
+	/** Last pager ID handed out. */
+	sysarg_t pager_last_id;
 } vfs_client_data_t;
 
 typedef struct {
@@ -63,7 +67,14 @@ typedef struct {
 	int permissions;
 } vfs_boxed_handle_t;
 
+typedef struct {
+	link_t link;
+	sysarg_t id;
+	vfs_file_t *file;
+} vfs_pager_ref_t;
+
 static errno_t _vfs_fd_free(vfs_client_data_t *, int);
+static errno_t vfs_file_delref(vfs_client_data_t *, vfs_file_t *);
 
 /** Initialize the table of open files. */
 static bool vfs_files_init(vfs_client_data_t *vfs_data)
@@ -106,6 +117,17 @@ static void vfs_files_done(vfs_client_data_t *vfs_data)
 		bh = list_get_instance(lnk, vfs_boxed_handle_t, link);
 		free(bh);
 	}
+	
+	fibril_mutex_lock(&vfs_data->lock);
+	while (!list_empty(&vfs_data->pager_refs)) {
+		vfs_pager_ref_t *ref = list_get_instance(
+		    list_first(&vfs_data->pager_refs), vfs_pager_ref_t, link);
+		
+		list_remove(&ref->link);
+		(void) vfs_file_delref(vfs_data, ref->file);
+		free(ref);
+	}
+	fibril_mutex_unlock(&vfs_data->lock);
 }
 
 void *vfs_client_data_create(void)
@@ -118,6 +140,8 @@ void *vfs_client_data_create(void)
 		fibril_condvar_initialize(&vfs_data->cv);
 		list_initialize(&vfs_data->passed_handles);
 		vfs_data->files = NULL;
+		list_initialize(&vfs_data->pager_refs);
+		vfs_data->pager_last_id = 0;
 	}
 	
 	return vfs_data;
@@ -382,6 +406,83 @@ void vfs_file_put(vfs_file_t *file)
 	_vfs_file_put(VFS_DATA, file);
 }
 
+/** Keep an open file for the VFS pager.
+ *
+ * Areas paged in by the VFS pager refer to the file by the returned ID
+ * rather than by a file descriptor. The client can close the descriptor
+ * once the area is created. The kernel does not tell the pager when an area
+ * goes away, so the file is kept open until the client terminates.
+ *
+ * @param fd		File descriptor of a file opened for reading.
+ * @param out_id	Place to store the pager ID.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t vfs_op_pager_ref(int fd, sysarg_t *out_id)
+{
+	vfs_client_data_t *vfs_data = VFS_DATA;
+	
+	vfs_pager_ref_t *ref = malloc(sizeof(vfs_pager_ref_t));
+	if (ref == NULL)
+		return ENOMEM;
+	
+	vfs_file_t *file = _vfs_file_get(vfs_data, fd);
+	if (file == NULL) {
+		free(ref);
+		return EBADF;
+	}
+	
+	if (!file->open_read || file->node->type != VFS_NODE_FILE) {
+		_vfs_file_put(vfs_data, file);
+		free(ref);
+		return EINVAL;
+	}
+	
+	fibril_mutex_lock(&vfs_data->lock);
+	vfs_file_addref(vfs_data, file);
+	ref->file = file;
+	ref->id = ++vfs_data->pager_last_id;
+	list_append(&ref->link, &vfs_data->pager_refs);
+	fibril_mutex_unlock(&vfs_data->lock);
+	
+	*out_id = ref->id;
+	_vfs_file_put(vfs_data, file);
+	return EOK;
+}
+
+/** Find the file kept open for the VFS pager under a given ID.
+ *
+ * @param id		Pager ID returned by vfs_op_pager_ref().
+ *
+ * @return		VFS file structure, release with vfs_file_put().
+ */
+vfs_file_t *vfs_pager_file_get(sysarg_t id)
+{
+	vfs_client_data_t *vfs_data = VFS_DATA;
+	vfs_file_t *file = NULL;
+	
+	fibril_mutex_lock(&vfs_data->lock);
+	list_foreach(vfs_data->pager_refs, link, vfs_pager_ref_t, ref) {
+		if (ref->id == id) {
+			file = ref->file;
+			vfs_file_addref(vfs_data, file);
+			break;
+		}
+	}
+	fibril_mutex_unlock(&vfs_data->lock);
+	
+	if (file == NULL)
+		return NULL;
+	
+	fibril_mutex_lock(&file->_lock);
+	if (file->node == NULL) {
+		_vfs_file_put(vfs_data, file);
+		return NULL;
+	}
+	
+	return file;
+}
+
 void vfs_op_pass_handle(task_id_t donor_id, task_id_t acceptor_id, int donor_fd)
 {
 	vfs_client_data_t *donor_data = NULL;
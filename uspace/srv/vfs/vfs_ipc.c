@@ -34,6 +34,15 @@
 #include <str.h>
 #include <vfs/canonify.h>
 
+static void vfs_in_advise(ipc_callid_t rid, ipc_call_t *request)
+{
+	int fd = IPC_GET_ARG1(*request);
+	vfs_advice_t advice = (vfs_advice_t) IPC_GET_ARG2(*request);
+	
+	errno_t rc = vfs_op_advise(fd, advice);
+	async_answer_0(rid, rc);
+}
+
 static void vfs_in_clone(ipc_callid_t rid, ipc_call_t *request)
 {
 	int oldfd = IPC_GET_ARG1(*request);
@@ -164,6 +173,15 @@ static void vfs_in_open(ipc_callid_t rid, ipc_call_t *request)
 	async_answer_0(rid, rc);
 }
 
+static void vfs_in_pager_ref(ipc_callid_t rid, ipc_call_t *request)
+{
+	int fd = IPC_GET_ARG1(*request);
+	
+	sysarg_t id = 0;
+	errno_t rc = vfs_op_pager_ref(fd, &id);
+	async_answer_1(rid, rc, id);
+}
+
 static void vfs_in_put(ipc_callid_t rid, ipc_call_t *request)
 {
 	int fd = IPC_GET_ARG1(*request);
@@ -182,6 +200,19 @@ static void vfs_in_read(ipc_callid_t rid, ipc_call_t *request)
 	async_answer_1(rid, rc, bytes);
 }
 
+static void vfs_in_readdir(ipc_callid_t rid, ipc_call_t *request)
+{
+	int fd = IPC_GET_ARG1(*request);
+	aoff64_t pos = MERGE_LOUP32(IPC_GET_ARG2(*request),
+	    IPC_GET_ARG3(*request));
+	unsigned flags = IPC_GET_ARG4(*request);
+
+	size_t bytes = 0;
+	aoff64_t npos = pos;
+	errno_t rc = vfs_op_readdir(fd, pos, flags, &bytes, &npos);
+	async_answer_3(rid, rc, bytes, LOWER32(npos), UPPER32(npos));
+}
+
 static void vfs_in_rename(ipc_callid_t rid, ipc_call_t *request)
 {
 	/* The common base directory. */
@@ -332,6 +363,9 @@ void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 			break;
 		
 		switch (IPC_GET_IMETHOD(call)) {
+		case VFS_IN_ADVISE:
+			vfs_in_advise(callid, &call);
+			break;
 		case VFS_IN_CLONE:
 			vfs_in_clone(callid, &call);
 			break;
@@ -347,12 +381,18 @@ void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case VFS_IN_OPEN:
 			vfs_in_open(callid, &call);
 			break;
+		case VFS_IN_PAGER_REF:
+			vfs_in_pager_ref(callid, &call);
+			break;
 		case VFS_IN_PUT:
 			vfs_in_put(callid, &call);
 			break;
 		case VFS_IN_READ:
 			vfs_in_read(callid, &call);
 			break;
+		case VFS_IN_READDIR:
+			vfs_in_readdir(callid, &call);
+			break;
 		case VFS_IN_REGISTER:
 			vfs_register(callid, &call);
 			cont = false;
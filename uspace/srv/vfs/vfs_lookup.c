@@ -202,6 +202,8 @@ errno_t vfs_link_internal(vfs_node_t *base, char *path, vfs_triplet_t *child)
 	if (orig_rc != EOK)
 		rc = orig_rc;
 	
+	vfs_dcache_invalidate(triplet, component);
+	
 out:
 	return rc;
 }
@@ -237,12 +239,212 @@ static errno_t out_lookup(vfs_triplet_t *base, size_t *pfirst, size_t *plen,
 	return EOK;
 }
 
+/** Cross the mount points stacked on a node.
+ *
+ * @param cur      Node to start with, replaced by the root of the file system
+ *                 mounted on it, if any.
+ * @param disable  Fail if there is a mount point to cross.
+ *
+ * @return EOK on success or EXDEV.
+ *
+ */
+static errno_t lookup_cross_mounts(vfs_lookup_res_t *cur, bool disable)
+{
+	vfs_node_t *node = vfs_node_peek(cur);
+	if (!node)
+		return EOK;
+	
+	if (node->mount && disable) {
+		vfs_node_put(node);
+		return EXDEV;
+	}
+	
+	while (node->mount) {
+		vfs_node_addref(node->mount);
+		vfs_node_t *nnode = node->mount;
+		vfs_node_put(node);
+		node = nnode;
+	}
+	
+	/* The node knows the most recent size. */
+	cur->triplet = *((vfs_triplet_t *) node);
+	cur->type = node->type;
+	cur->size = node->size;
+	vfs_node_put(node);
+	return EOK;
+}
+
+/** Look up a single name in a directory.
+ *
+ * The name lookup cache is consulted first. On a miss, the name is looked up
+ * by the file system server and the result is cached, including the fact
+ * that the name does not exist. File systems whose name space can change
+ * behind the back of VFS, such as locfs, do not set cache_lookups in their
+ * vfs_info_t and the cache is bypassed for them.
+ *
+ * @param dir   Directory to look the name up in.
+ * @param name  Name to look up.
+ * @param res   Place to store the lookup result.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static errno_t lookup_component(vfs_lookup_res_t *dir, const char *name,
+    vfs_lookup_res_t *res)
+{
+	char path[NAME_MAX + 2];
+	vfs_lookup_res_t tres;
+	plb_entry_t entry;
+	size_t first;
+	errno_t rc;
+	
+	vfs_info_t *fs_info = fs_handle_to_info(dir->triplet.fs_handle);
+	bool cache = (fs_info != NULL) && fs_info->cache_lookups;
+	
+	if (cache) {
+		rc = vfs_dcache_lookup(&dir->triplet, name, res);
+		if (rc != EAGAIN)
+			return rc;
+	}
+	
+	unsigned gen = vfs_dcache_generation();
+	
+	path[0] = '/';
+	str_cpy(path + 1, NAME_MAX + 1, name);
+	size_t len = str_size(path);
+	
+	rc = plb_insert_entry(&entry, path, &first, len);
+	if (rc != EOK)
+		return rc;
+	
+	size_t next = first;
+	size_t nlen = len;
+	rc = out_lookup(&dir->triplet, &next, &nlen, L_NONE, &tres);
+	plb_clear_entry(&entry, first, len);
+	if (rc != EOK)
+		return rc;
+	
+	if (nlen > 0) {
+		/* The file system stopped at the directory itself. */
+		if (cache)
+			vfs_dcache_insert(&dir->triplet, name, NULL, gen);
+		return ENOENT;
+	}
+	
+	if (cache)
+		vfs_dcache_insert(&dir->triplet, name, &tres, gen);
+	*res = tres;
+	return EOK;
+}
+
+/** Resolve a path one name at a time using the name lookup cache.
+ *
+ * This is used for lookups which do not modify the namespace. A path whose
+ * names are all cached is resolved without contacting any file system server.
+ *
+ * @param base    The file from which to perform the lookup.
+ * @param path    Path to be resolved.
+ * @param lflag   Flags to be used during lookup.
+ * @param result  Empty structure where the lookup result will be stored.
+ *                Can be NULL.
+ * @param len     Length of the path.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static errno_t lookup_cached(vfs_node_t *base, char *path, int lflag,
+    vfs_lookup_res_t *result, size_t len)
+{
+	char component[NAME_MAX + 1];
+	vfs_lookup_res_t cur;
+	size_t pos = 0;
+	errno_t rc;
+	
+	cur.triplet = *((vfs_triplet_t *) base);
+	cur.type = base->type;
+	cur.size = base->size;
+	
+	rc = lookup_cross_mounts(&cur, lflag & L_DISABLE_MOUNTS);
+	if (rc != EOK)
+		return rc;
+	
+	while (true) {
+		while (pos < len && path[pos] == '/')
+			pos++;
+		if (pos == len)
+			break;
+		
+		size_t clen = 0;
+		while (pos < len && path[pos] != '/') {
+			if (clen == NAME_MAX)
+				return ENAMETOOLONG;
+			component[clen++] = path[pos++];
+		}
+		component[clen] = '\0';
+		
+		if (cur.type == VFS_NODE_FILE)
+			return ENOTDIR;
+		
+		vfs_lookup_res_t next;
+		rc = lookup_component(&cur, component, &next);
+		if (rc != EOK)
+			return rc;
+		cur = next;
+		
+		while (pos < len && path[pos] == '/')
+			pos++;
+		
+		if (pos < len) {
+			rc = lookup_cross_mounts(&cur, lflag & L_DISABLE_MOUNTS);
+		} else if (!(lflag & (L_MP | L_DISABLE_MOUNTS))) {
+			/* The found file may be a mount point. Try to cross it. */
+			rc = lookup_cross_mounts(&cur, false);
+		}
+		if (rc != EOK)
+			return rc;
+	}
+	
+	if ((lflag & L_FILE) && cur.type == VFS_NODE_DIRECTORY)
+		return EISDIR;
+	if ((lflag & L_DIRECTORY) && cur.type == VFS_NODE_FILE)
+		return ENOTDIR;
+	
+	if (result != NULL)
+		*result = cur;
+	return EOK;
+}
+
+/** Invalidate the name created or removed by a lookup.
+ *
+ * @param dir   Directory containing the name.
+ * @param path  Path whose last component is the name.
+ * @param len   Length of the path.
+ *
+ */
+static void lookup_invalidate(vfs_triplet_t *dir, char *path, size_t len)
+{
+	char component[NAME_MAX + 1];
+	size_t start = len;
+	
+	while (start > 0 && path[start - 1] != '/')
+		start--;
+	if (len - start > NAME_MAX)
+		return;
+	
+	memcpy(component, path + start, len - start);
+	component[len - start] = '\0';
+	vfs_dcache_invalidate(dir, component);
+}
+
 static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
     vfs_lookup_res_t *result, size_t len)
 {
 	size_t first;
 	errno_t rc;
 
+	if (!(lflag & (L_CREATE | L_UNLINK)))
+		return lookup_cached(base, path, lflag, result, len);
+
 	plb_entry_t entry;
 	rc = plb_insert_entry(&entry, path, &first, len);
 	if (rc != EOK)
@@ -252,6 +454,8 @@ static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 	size_t nlen = len;
 	
 	vfs_lookup_res_t res;
+	vfs_triplet_t dir;
+	bool dir_valid = false;
 	
 	/* Resolve path as long as there are mount points to cross. */
 	while (nlen > 0) {
@@ -264,6 +468,8 @@ static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 			base = base->mount;
 		}
 		
+		dir = *((vfs_triplet_t *) base);
+		dir_valid = true;
 		rc = out_lookup((vfs_triplet_t *) base, &next, &nlen, lflag,
 		    &res);
 		if (rc != EOK)
@@ -317,6 +523,14 @@ static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 	}
 	
 out:
+	/* The name may have been created or removed, forget it. */
+	if (dir_valid) {
+		lookup_invalidate(&dir, path, len);
+		if (rc == EOK && (lflag & L_UNLINK) &&
+		    res.type == VFS_NODE_DIRECTORY)
+			vfs_dcache_invalidate_dir(&res.triplet);
+	}
+	
 	plb_clear_entry(&entry, first, len);
 	return rc;
 }
@@ -124,6 +124,10 @@ void vfs_node_delref(vfs_node_t *node)
 	fibril_mutex_unlock(&nodes_mutex);
 	
 	if (free_node) {
+		/* Cached lookup results now have to carry the size. */
+		vfs_dcache_node_update(node);
+		vfs_pager_invalidate(node);
+		
 		/*
 		 * VFS_OUT_DESTROY will free up the file's resources if there
 		 * are no more hard links.
@@ -150,6 +154,7 @@ void vfs_node_forget(vfs_node_t *node)
 	fibril_mutex_lock(&nodes_mutex);
 	hash_table_remove_item(&nodes, &node->nh_link);
 	fibril_mutex_unlock(&nodes_mutex);
+	vfs_pager_invalidate(node);
 	free(node);
 }
 
@@ -184,6 +189,7 @@ vfs_node_t *vfs_node_get(vfs_lookup_res_t *result)
 		node->size = result->size;
 		node->type = result->type;
 		fibril_rwlock_initialize(&node->contents_rwlock);
+		list_initialize(&node->pager_pages);
 		hash_table_insert(&nodes, &node->nh_link);
 	} else {
 		node = hash_table_get_inst(tmp, vfs_node_t, nh_link);
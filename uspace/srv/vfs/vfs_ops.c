@@ -50,6 +50,9 @@
 #include <assert.h>
 #include <vfs/canonify.h>
 
+/** Amount of data VFS keeps read ahead of sequential readers. */
+#define VFS_READAHEAD_WINDOW	(128 * 1024)
+
 /* Forward declarations of static functions. */
 static errno_t vfs_truncate_internal(fs_handle_t, service_id_t, fs_index_t,
     aoff64_t);
@@ -85,6 +88,28 @@ static void out_destroy(vfs_triplet_t *file)
 	vfs_exchange_release(exch);
 }
 
+errno_t vfs_op_advise(int fd, vfs_advice_t advice)
+{
+	switch (advice) {
+	case VFS_ADVICE_NORMAL:
+	case VFS_ADVICE_SEQUENTIAL:
+	case VFS_ADVICE_RANDOM:
+		break;
+	default:
+		return EINVAL;
+	}
+	
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+	
+	file->advice = advice;
+	file->ra_pos = 0;
+	
+	vfs_file_put(file);
+	return EOK;
+}
+
 errno_t vfs_op_clone(int oldfd, int newfd, bool desc, int *out_fd)
 {
 	errno_t rc;
@@ -405,8 +430,8 @@ static errno_t rdwr_ipc_internal(async_exch_t *exch, vfs_file_t *file, aoff64_t
 	return (errno_t) rc;
 }
 
-static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
-    void *ipc_cb_data)
+static errno_t vfs_rdwr_file(vfs_file_t *file, aoff64_t pos, bool read,
+    rdwr_ipc_cb_t ipc_cb, void *ipc_cb_data)
 {
 	/*
 	 * The following code strongly depends on the fact that the files data
@@ -418,15 +443,8 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	 * open files supports parallel access!
 	 */
 	
-	/* Lookup the file structure corresponding to the file descriptor. */
-	vfs_file_t *file = vfs_file_get(fd);
-	if (!file)
-		return EBADF;
-	
-	if ((read && !file->open_read) || (!read && !file->open_write)) {
-		vfs_file_put(file);
+	if ((read && !file->open_read) || (!read && !file->open_write))
 		return EINVAL;
-	}
 	
 	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
 	assert(fs_info);
@@ -458,7 +476,6 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 				fibril_rwlock_write_unlock(
 				    &file->node->contents_rwlock);
 			}
-			vfs_file_put(file);
 			return EINVAL;
 		}
 		
@@ -481,6 +498,10 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 	
+	/* Pages read by the pager no longer reflect the file. */
+	if (!read && rc == EOK)
+		vfs_pager_invalidate(file->node);
+	
 	/* Unlock the VFS node. */
 	if (rlock) {
 		fibril_rwlock_read_unlock(&file->node->contents_rwlock);
@@ -493,19 +514,225 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 		fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	}
 	
-	vfs_file_put(file);	
+	return rc;
+}
 
+static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
+    void *ipc_cb_data)
+{
+	/* Lookup the file structure corresponding to the file descriptor. */
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+	
+	errno_t rc = vfs_rdwr_file(file, pos, read, ipc_cb, ipc_cb_data);
+	vfs_file_put(file);
+	
 	return rc;
 }
 
-errno_t vfs_rdwr_internal(int fd, aoff64_t pos, bool read, rdwr_io_chunk_t *chunk)
+errno_t vfs_rdwr_internal(vfs_file_t *file, aoff64_t pos, bool read,
+    rdwr_io_chunk_t *chunk)
+{
+	return vfs_rdwr_file(file, pos, read, rdwr_ipc_internal, chunk);
+}
+
+typedef struct {
+	vfs_node_t *node;
+	aoff64_t pos;
+	size_t size;
+} vfs_readahead_t;
+
+/** Read a window of a file into a scratch buffer and throw it away.
+ *
+ * The point is to make the file system server pull the data from the
+ * underlying device into its block cache while the client is still busy
+ * with the data it has already received. The data read here are not kept
+ * by VFS, so this only helps file systems which have a block cache (see
+ * vfs_info_t.read_ahead).
+ */
+static errno_t vfs_readahead_fibril(void *arg)
 {
-	return vfs_rdwr(fd, pos, read, rdwr_ipc_internal, chunk);
+	vfs_readahead_t *ra = (vfs_readahead_t *) arg;
+	vfs_node_t *node = ra->node;
+	
+	void *buf = malloc(ra->size);
+	if (buf != NULL) {
+		fibril_rwlock_read_lock(&node->contents_rwlock);
+		async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
+		
+		size_t done = 0;
+		while (done < ra->size) {
+			aoff64_t pos = ra->pos + done;
+			ipc_call_t answer;
+			aid_t msg = async_send_fast(exch, VFS_OUT_READ,
+			    node->service_id, node->index, LOWER32(pos),
+			    UPPER32(pos), &answer);
+			if (msg == 0)
+				break;
+			
+			errno_t rc = async_data_read_start(exch, buf,
+			    ra->size - done);
+			if (rc != EOK) {
+				async_forget(msg);
+				break;
+			}
+			
+			async_wait_for(msg, &rc);
+			size_t nread = IPC_GET_ARG1(answer);
+			if (rc != EOK || nread == 0)
+				break;
+			
+			done += nread;
+		}
+		
+		vfs_exchange_release(exch);
+		fibril_rwlock_read_unlock(&node->contents_rwlock);
+		free(buf);
+	}
+	
+	vfs_node_delref(node);
+	free(ra);
+	return EOK;
+}
+
+/** Keep the read-ahead window of a sequentially read file filled.
+ *
+ * Nothing is done for file systems that do not keep file data in a block
+ * cache, reading ahead would only double the work for them.
+ *
+ * @param fd  File the client has just read from.
+ * @param end Position right after the data the client has received.
+ */
+static void vfs_readahead(int fd, aoff64_t end)
+{
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return;
+	
+	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
+	if (file->advice != VFS_ADVICE_SEQUENTIAL ||
+	    file->node->type != VFS_NODE_FILE ||
+	    fs_info == NULL || !fs_info->read_ahead) {
+		vfs_file_put(file);
+		return;
+	}
+	
+	/* Restart the window if the client seeked or overtook read-ahead. */
+	if (end > file->ra_pos || end + 2 * VFS_READAHEAD_WINDOW < file->ra_pos)
+		file->ra_pos = end;
+	
+	/* Refill only once half of the window has been consumed. */
+	aoff64_t limit = min(end + VFS_READAHEAD_WINDOW, file->node->size);
+	if (file->ra_pos >= limit ||
+	    file->ra_pos - end >= VFS_READAHEAD_WINDOW / 2) {
+		vfs_file_put(file);
+		return;
+	}
+	
+	vfs_readahead_t *ra = malloc(sizeof(vfs_readahead_t));
+	if (ra == NULL) {
+		vfs_file_put(file);
+		return;
+	}
+	
+	ra->node = file->node;
+	ra->pos = file->ra_pos;
+	ra->size = limit - file->ra_pos;
+	
+	fid_t fid = fibril_create(vfs_readahead_fibril, ra);
+	if (fid == 0) {
+		free(ra);
+		vfs_file_put(file);
+		return;
+	}
+	
+	vfs_node_addref(ra->node);
+	file->ra_pos = limit;
+	vfs_file_put(file);
+	
+	fibril_add_ready(fid);
 }
 
 errno_t vfs_op_read(int fd, aoff64_t pos, size_t *out_bytes)
 {
-	return vfs_rdwr(fd, pos, true, rdwr_ipc_client, out_bytes);
+	errno_t rc = vfs_rdwr(fd, pos, true, rdwr_ipc_client, out_bytes);
+	if (rc == EOK && *out_bytes > 0)
+		vfs_readahead(fd, pos + *out_bytes);
+	
+	return rc;
+}
+
+/** Read a batch of directory entries.
+ *
+ * The client's IPC_M_DATA_READ is forwarded to the file system server along
+ * with a VFS_OUT_READDIR request, so the entries are copied directly into the
+ * client buffer.
+ *
+ * @param fd		Open directory.
+ * @param pos		Position to resume reading at.
+ * @param flags		VFS_READDIR_* flags.
+ * @param out_bytes	Number of bytes stored into the client buffer.
+ * @param out_pos	Position to resume the next batch at.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t vfs_op_readdir(int fd, aoff64_t pos, unsigned flags,
+    size_t *out_bytes, aoff64_t *out_pos)
+{
+	ipc_callid_t callid;
+	if (!async_data_read_receive(&callid, NULL)) {
+		async_answer_0(callid, EINVAL);
+		return EINVAL;
+	}
+	
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		async_answer_0(callid, EBADF);
+		return EBADF;
+	}
+	
+	if (!file->open_read || file->node->type != VFS_NODE_DIRECTORY) {
+		vfs_file_put(file);
+		async_answer_0(callid, EINVAL);
+		return EINVAL;
+	}
+	
+	fibril_rwlock_read_lock(&file->node->contents_rwlock);
+	
+	/*
+	 * Make sure that no one is modifying the namespace while we are in
+	 * readdir().
+	 */
+	fibril_rwlock_read_lock(&namespace_rwlock);
+	
+	async_exch_t *exch = vfs_exchange_grab(file->node->fs_handle);
+	
+	ipc_call_t answer;
+	aid_t msg = async_send_5(exch, VFS_OUT_READDIR, file->node->service_id,
+	    file->node->index, LOWER32(pos), UPPER32(pos), flags, &answer);
+	
+	errno_t rc = async_forward_fast(callid, exch, 0, 0, 0,
+	    IPC_FF_ROUTE_FROM_ME);
+	if (rc != EOK) {
+		async_forget(msg);
+		async_answer_0(callid, rc);
+	} else
+		async_wait_for(msg, &rc);
+	
+	vfs_exchange_release(exch);
+	
+	fibril_rwlock_read_unlock(&namespace_rwlock);
+	fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+	
+	vfs_file_put(file);
+	
+	if (rc != EOK)
+		return rc;
+	
+	*out_bytes = IPC_GET_ARG1(answer);
+	*out_pos = MERGE_LOUP32(IPC_GET_ARG2(answer), IPC_GET_ARG3(answer));
+	return EOK;
 }
 
 errno_t vfs_op_rename(int basefd, char *old, char *new)
@@ -619,8 +846,10 @@ errno_t vfs_op_resize(int fd, int64_t size)
 	
 	errno_t rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
-	if (rc == EOK)
+	if (rc == EOK) {
 		file->node->size = size;
+		vfs_pager_invalidate(file->node);
+	}
 	
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -815,6 +1044,12 @@ errno_t vfs_op_unmount(int mpfd)
 		return rc;
 	}
 	
+	vfs_pair_t pair = {
+		.fs_handle = mp->node->mount->fs_handle,
+		.service_id = mp->node->mount->service_id
+	};
+	vfs_dcache_flush(&pair);
+	
 	vfs_node_forget(mp->node->mount);
 	vfs_node_put(mp->node);
 	mp->node->mount = NULL;
@@ -36,26 +36,177 @@
  */
 
 #include "vfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <async.h>
 #include <fibril_synch.h>
 #include <errno.h>
 #include <as.h>
+#include <stdlib.h>
 
-void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
-{
-	aoff64_t offset = IPC_GET_ARG1(*request);
-	size_t page_size = IPC_GET_ARG2(*request);
-	int fd = IPC_GET_ARG3(*request);
+/** Maximum number of pages kept in the page cache. */
+#define PAGER_CACHE_MAX  1024
+
+/**
+ * Pages handed out to the kernel are kept mapped in VFS so that all tasks
+ * paging in the same part of the same file get a reference to the same frame.
+ * Frames stay alive for as long as any task maps them, the cache only decides
+ * which of them VFS can hand out again without reading the file.
+ */
+typedef struct {
+	/** Link in pager_pages. */
+	ht_link_t link;
+	/** Link in the node's pager_pages list. */
+	link_t node_link;
+	/** Link in pager_lru, most recently used first. */
+	link_t lru_link;
+
+	vfs_node_t *node;
+	aoff64_t offset;
+	/** Page-sized anonymous area holding the data. */
 	void *page;
-	errno_t rc;
+} pager_page_t;
+
+typedef struct {
+	vfs_node_t *node;
+	aoff64_t offset;
+} pager_key_t;
+
+static FIBRIL_MUTEX_INITIALIZE(pager_mutex);
+static hash_table_t pager_pages;
+static LIST_INITIALIZE(pager_lru);
+static size_t pager_count;
+
+static size_t pager_key_hash(void *key)
+{
+	pager_key_t *pkey = (pager_key_t *) key;
+	return hash_combine((size_t) pkey->node,
+	    hash_mix64(pkey->offset));
+}
+
+static size_t pager_hash(const ht_link_t *item)
+{
+	pager_page_t *pp = hash_table_get_inst(item, pager_page_t, link);
+	pager_key_t pkey = {
+		.node = pp->node,
+		.offset = pp->offset
+	};
+	return pager_key_hash(&pkey);
+}
+
+static bool pager_key_equal(void *key, const ht_link_t *item)
+{
+	pager_key_t *pkey = (pager_key_t *) key;
+	pager_page_t *pp = hash_table_get_inst(item, pager_page_t, link);
+	return pp->node == pkey->node && pp->offset == pkey->offset;
+}
+
+static void pager_remove_callback(ht_link_t *item)
+{
+	pager_page_t *pp = hash_table_get_inst(item, pager_page_t, link);
+
+	list_remove(&pp->node_link);
+	list_remove(&pp->lru_link);
+	pager_count--;
+
+	/* Tasks which have the page mapped keep their frame reference. */
+	as_area_destroy(pp->page);
+	free(pp);
+}
+
+static hash_table_ops_t pager_ops = {
+	.hash = pager_hash,
+	.key_hash = pager_key_hash,
+	.key_equal = pager_key_equal,
+	.equal = NULL,
+	.remove_callback = pager_remove_callback
+};
+
+bool vfs_pager_init(void)
+{
+	return hash_table_create(&pager_pages, 0, 0, &pager_ops);
+}
+
+/** Drop all cached pages of a node.
+ *
+ * Called whenever the contents of the node change or the node goes away.
+ * Tasks that have already faulted in a page keep seeing its old contents.
+ *
+ * @param node	VFS node.
+ */
+void vfs_pager_invalidate(vfs_node_t *node)
+{
+	fibril_mutex_lock(&pager_mutex);
+	node->pager_gen++;
+	while (!list_empty(&node->pager_pages)) {
+		pager_page_t *pp = list_get_instance(
+		    list_first(&node->pager_pages), pager_page_t, node_link);
+		hash_table_remove_item(&pager_pages, &pp->link);
+	}
+	fibril_mutex_unlock(&pager_mutex);
+}
 
-	page = as_area_create(AS_AREA_ANY, page_size,
+/** Find a cached page and take it to the front of the LRU list.
+ *
+ * @return Address of the page or NULL if it is not cached.
+ */
+static void *pager_cache_get(vfs_node_t *node, aoff64_t offset)
+{
+	pager_key_t pkey = {
+		.node = node,
+		.offset = offset
+	};
+
+	ht_link_t *lnk = hash_table_find(&pager_pages, &pkey);
+	if (lnk == NULL)
+		return NULL;
+
+	pager_page_t *pp = hash_table_get_inst(lnk, pager_page_t, link);
+	list_remove(&pp->lru_link);
+	list_prepend(&pp->lru_link, &pager_lru);
+	return pp->page;
+}
+
+/** Insert a freshly read page into the cache.
+ *
+ * @return EOK if the page is now owned by the cache, an error code if the
+ *         caller should dispose of it.
+ */
+static errno_t pager_cache_put(vfs_node_t *node, aoff64_t offset, void *page)
+{
+	pager_page_t *pp = malloc(sizeof(pager_page_t));
+	if (pp == NULL)
+		return ENOMEM;
+
+	while (pager_count >= PAGER_CACHE_MAX) {
+		pager_page_t *victim = list_get_instance(list_last(&pager_lru),
+		    pager_page_t, lru_link);
+		hash_table_remove_item(&pager_pages, &victim->link);
+	}
+
+	link_initialize(&pp->node_link);
+	link_initialize(&pp->lru_link);
+	pp->node = node;
+	pp->offset = offset;
+	pp->page = page;
+
+	hash_table_insert(&pager_pages, &pp->link);
+	list_append(&pp->node_link, &node->pager_pages);
+	list_prepend(&pp->lru_link, &pager_lru);
+	pager_count++;
+	return EOK;
+}
+
+static void *pager_read(vfs_file_t *file, aoff64_t offset, size_t page_size,
+    errno_t *rc)
+{
+	void *page = as_area_create(AS_AREA_ANY, page_size,
 	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
 	    AS_AREA_UNPAGED);
-
 	if (page == AS_MAP_FAILED) {
-		async_answer_0(rid, ENOMEM);
-		return;
+		*rc = ENOMEM;
+		return NULL;
 	}
 
 	rdwr_io_chunk_t chunk = {
@@ -66,8 +217,8 @@ void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
 	size_t total = 0;
 	aoff64_t pos = offset;
 	do {
-		rc = vfs_rdwr_internal(fd, pos, true, &chunk);
-		if (rc != EOK)
+		*rc = vfs_rdwr_internal(file, pos, true, &chunk);
+		if (*rc != EOK)
 			break;
 		if (chunk.size == 0)
 			break;
@@ -77,15 +228,85 @@ void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
 		chunk.size = page_size - total;
 	} while (total < page_size);
 
-	async_answer_1(rid, rc, (sysarg_t) page);
+	if (*rc != EOK) {
+		as_area_destroy(page);
+		return NULL;
+	}
+
+	return page;
+}
+
+/** Handle a page-in request from the kernel.
+ *
+ * The request carries the offset of the faulting page within the paged area
+ * and the pager ID of the file the area is backed by (see vfs_op_pager_ref()).
+ * The second and third pager IDs hold the file offset the area starts at,
+ * which lets a single file back several areas (e.g. individual ELF segments).
+ */
+void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
+{
+	aoff64_t offset = IPC_GET_ARG1(*request);
+	size_t page_size = IPC_GET_ARG2(*request);
+	sysarg_t id = IPC_GET_ARG3(*request);
+	aoff64_t base = MERGE_LOUP32(IPC_GET_ARG4(*request),
+	    IPC_GET_ARG5(*request));
+	unsigned gen;
+	void *page;
+	errno_t rc;
+
+	offset += base;
+
+	vfs_file_t *file = vfs_pager_file_get(id);
+	if (!file) {
+		async_answer_0(rid, EBADF);
+		return;
+	}
+
+	vfs_node_t *node = file->node;
 
 	/*
-	 * FIXME: 
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
+	 * The answer is sent with pager_mutex held so that the page cannot be
+	 * evicted and unmapped before the kernel takes its frame reference.
 	 */
-	as_area_destroy(page);
+	fibril_mutex_lock(&pager_mutex);
+	page = pager_cache_get(node, offset);
+	if (page != NULL)
+		async_answer_1(rid, EOK, (sysarg_t) page);
+	gen = node->pager_gen;
+	fibril_mutex_unlock(&pager_mutex);
+
+	if (page != NULL) {
+		vfs_file_put(file);
+		return;
+	}
+
+	page = pager_read(file, offset, page_size, &rc);
+	if (page == NULL) {
+		async_answer_0(rid, rc);
+		vfs_file_put(file);
+		return;
+	}
+
+	fibril_mutex_lock(&pager_mutex);
+
+	/*
+	 * Hand out the cached copy if some other fibril raced us to it, so
+	 * that all tasks end up sharing the same frame. If the node was
+	 * written to while the page was being read, the page may hold stale
+	 * data and must not be cached.
+	 */
+	void *cached = pager_cache_get(node, offset);
+	if (cached == NULL && node->pager_gen == gen &&
+	    pager_cache_put(node, offset, page) == EOK)
+		cached = page;
+
+	async_answer_1(rid, EOK, (sysarg_t) (cached != NULL ? cached : page));
+	fibril_mutex_unlock(&pager_mutex);
+
+	if (cached != page)
+		as_area_destroy(page);
+
+	vfs_file_put(file);
 }
 
 /**